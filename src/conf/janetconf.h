@@ -26,6 +26,7 @@
 /* #define JANET_NO_PROCESSES */
 /* #define JANET_NO_ASSEMBLER */
 /* #define JANET_NO_PEG */
+/* #define JANET_NO_TYPED_ARRAY */
 /* #define JANET_NO_NET */
 /* #define JANET_NO_INT_TYPES */
 /* #define JANET_NO_EV */
@@ -35,6 +36,7 @@
 /* #define JANET_NO_THREADS */
 /* #define JANET_NO_FFI */
 /* #define JANET_NO_FFI_JIT */
+/* #define JANET_NO_SIMD */
 
 /* Other settings */
 /* #define JANET_DEBUG */
@@ -51,7 +53,10 @@
 /* #define JANET_ARCH_NAME pdp-8 */
 /* #define JANET_EV_NO_EPOLL */
 /* #define JANET_EV_NO_KQUEUE */
+/* #define JANET_EV_URING */
 /* #define JANET_NO_INTERPRETER_INTERRUPT */
+/* #define JANET_GC_SLAB */
+/* #define JANET_JIT */
 
 /* Custom vm allocator support */
 /* #include <mimalloc.h> */
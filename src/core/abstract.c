@@ -97,12 +97,28 @@ size_t janet_os_rwlock_size(void) {
     return sizeof(void *);
 }
 
-static int32_t janet_incref(JanetAbstractHead *ab) {
-    return InterlockedIncrement((LONG volatile *) &ab->gc.data.refcount);
+static int32_t janet_incref(JanetGCObject *gc) {
+    return InterlockedIncrement((LONG volatile *) &gc->data.refcount);
 }
 
-static int32_t janet_decref(JanetAbstractHead *ab) {
-    return InterlockedDecrement((LONG volatile *) &ab->gc.data.refcount);
+static int32_t janet_decref(JanetGCObject *gc) {
+    return InterlockedDecrement((LONG volatile *) &gc->data.refcount);
+}
+
+void *janet_atomic_load_ptr(void **slot) {
+    return InterlockedCompareExchangePointer((PVOID volatile *) slot, NULL, NULL);
+}
+
+int janet_atomic_cas_ptr(void **slot, void *expected, void *value) {
+    return InterlockedCompareExchangePointer((PVOID volatile *) slot, value, expected) == expected;
+}
+
+uint32_t janet_atomic_load_u32(uint32_t *slot) {
+    return (uint32_t) InterlockedCompareExchange((LONG volatile *) slot, 0, 0);
+}
+
+void janet_atomic_store_u32(uint32_t *slot, uint32_t value) {
+    InterlockedExchange((LONG volatile *) slot, (LONG) value);
 }
 
 void janet_os_mutex_init(JanetOSMutex *mutex) {
@@ -157,12 +173,28 @@ size_t janet_os_rwlock_size(void) {
     return sizeof(pthread_rwlock_t);
 }
 
-static int32_t janet_incref(JanetAbstractHead *ab) {
-    return __atomic_add_fetch(&ab->gc.data.refcount, 1, __ATOMIC_RELAXED);
+static int32_t janet_incref(JanetGCObject *gc) {
+    return __atomic_add_fetch(&gc->data.refcount, 1, __ATOMIC_RELAXED);
 }
 
-static int32_t janet_decref(JanetAbstractHead *ab) {
-    return __atomic_add_fetch(&ab->gc.data.refcount, -1, __ATOMIC_RELAXED);
+static int32_t janet_decref(JanetGCObject *gc) {
+    return __atomic_add_fetch(&gc->data.refcount, -1, __ATOMIC_RELAXED);
+}
+
+void *janet_atomic_load_ptr(void **slot) {
+    return __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+}
+
+int janet_atomic_cas_ptr(void **slot, void *expected, void *value) {
+    return __atomic_compare_exchange_n(slot, &expected, value, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+uint32_t janet_atomic_load_u32(uint32_t *slot) {
+    return __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+}
+
+void janet_atomic_store_u32(uint32_t *slot, uint32_t value) {
+    __atomic_store_n(slot, value, __ATOMIC_RELEASE);
 }
 
 void janet_os_mutex_init(JanetOSMutex *mutex) {
@@ -212,11 +244,49 @@ void janet_os_rwlock_wunlock(JanetOSRWLock *rwlock) {
 #endif
 
 int32_t janet_abstract_incref(void *abst) {
-    return janet_incref(janet_abstract_head(abst));
+    return janet_incref(&janet_abstract_head(abst)->gc);
 }
 
 int32_t janet_abstract_decref(void *abst) {
-    return janet_decref(janet_abstract_head(abst));
+    return janet_decref(&janet_abstract_head(abst)->gc);
+}
+
+/*
+ * Threaded strings
+ */
+
+/* Copy a string into a reference counted block outside of any heap so that
+ * it can be passed between threads by pointer. The caller owns the single
+ * reference the string starts with. */
+const uint8_t *janet_string_threaded(const uint8_t *bytes, int32_t len) {
+    JanetStringHead *head = janet_malloc(sizeof(JanetStringHead) + (size_t) len + 1);
+    if (NULL == head) {
+        JANET_OUT_OF_MEMORY;
+    }
+    head->gc.flags = JANET_MEMORY_THREADED_STRING;
+    head->gc.data.next = NULL; /* Clear memory for address sanitizers */
+    head->gc.data.refcount = 1;
+    head->length = len;
+    head->hash = janet_string_calchash(bytes, len);
+    uint8_t *data = (uint8_t *) head->data;
+    safe_memcpy(data, bytes, len);
+    data[len] = 0;
+    return data;
+}
+
+int janet_string_is_threaded(const uint8_t *str) {
+    return (janet_string_head(str)->gc.flags & JANET_MEM_TYPEBITS) == JANET_MEMORY_THREADED_STRING;
+}
+
+int32_t janet_string_incref(const uint8_t *str) {
+    return janet_incref(&janet_string_head(str)->gc);
+}
+
+/* Drop a reference to a threaded string, freeing it with the last one */
+int32_t janet_string_decref(const uint8_t *str) {
+    int32_t count = janet_decref(&janet_string_head(str)->gc);
+    if (0 == count) janet_free(janet_string_head(str));
+    return count;
 }
 
 #endif
@@ -120,6 +120,107 @@ Janet janet_array_peek(JanetArray *array) {
     }
 }
 
+/* Array views. A view is a range of the items of an array or tuple that
+ * keeps a reference to its parent instead of copying. Views of arrays see
+ * later changes to the array, and only the items that are still there if
+ * the array shrinks. */
+
+typedef struct {
+    Janet parent;
+    int32_t start;
+    int32_t length;
+} JanetArraySlice;
+
+int32_t janet_array_view_items(void *p, const Janet **data) {
+    JanetArraySlice *view = (JanetArraySlice *) p;
+    const Janet *items = NULL;
+    int32_t len = 0;
+    janet_indexed_view(view->parent, &items, &len);
+    int32_t n = len - view->start;
+    if (n > view->length) n = view->length;
+    if (n <= 0) {
+        *data = items;
+        return 0;
+    }
+    *data = items + view->start;
+    return n;
+}
+
+static int array_view_gcmark(void *p, size_t s) {
+    (void) s;
+    janet_mark(((JanetArraySlice *) p)->parent);
+    return 0;
+}
+
+static int array_view_get(void *p, Janet key, Janet *out) {
+    const Janet *items;
+    if (!janet_checkint(key)) return 0;
+    int32_t index = janet_unwrap_integer(key);
+    int32_t n = janet_array_view_items(p, &items);
+    if (index < 0 || index >= n) return 0;
+    *out = items[index];
+    return 1;
+}
+
+static Janet array_view_next(void *p, Janet key) {
+    const Janet *items;
+    int32_t n = janet_array_view_items(p, &items);
+    if (janet_checktype(key, JANET_NIL)) {
+        return n > 0 ? janet_wrap_integer(0) : janet_wrap_nil();
+    }
+    if (!janet_checkint(key)) return janet_wrap_nil();
+    int32_t next = janet_unwrap_integer(key) + 1;
+    return (next > 0 && next < n) ? janet_wrap_integer(next) : janet_wrap_nil();
+}
+
+static size_t array_view_length(void *p, size_t s) {
+    (void) s;
+    const Janet *items;
+    return (size_t) janet_array_view_items(p, &items);
+}
+
+static void array_view_marshal(void *p, JanetMarshalContext *ctx) {
+    JanetArraySlice *view = (JanetArraySlice *) p;
+    janet_marshal_abstract(ctx, p);
+    janet_marshal_janet(ctx, view->parent);
+    janet_marshal_int(ctx, view->start);
+    janet_marshal_int(ctx, view->length);
+}
+
+static void *array_view_unmarshal(JanetMarshalContext *ctx) {
+    JanetArraySlice *view = janet_unmarshal_abstract(ctx, sizeof(JanetArraySlice));
+    view->parent = janet_wrap_nil();
+    view->start = 0;
+    view->length = 0;
+    Janet parent = janet_unmarshal_janet(ctx);
+    int32_t start = janet_unmarshal_int(ctx);
+    int32_t length = janet_unmarshal_int(ctx);
+    if (!janet_checktypes(parent, JANET_TFLAG_INDEXED) || start < 0 || length < 0) {
+        janet_panic("invalid array view");
+    }
+    view->parent = parent;
+    view->start = start;
+    view->length = length;
+    return view;
+}
+
+const JanetAbstractType janet_array_view_type = {
+    "core/array-view",
+    NULL,
+    array_view_gcmark,
+    array_view_get,
+    NULL, /* put */
+    array_view_marshal,
+    array_view_unmarshal,
+    NULL, /* tostring */
+    NULL, /* compare */
+    NULL, /* hash */
+    array_view_next,
+    NULL, /* call */
+    array_view_length,
+    JANET_ATEND_LENGTH
+};
+
 /* C Functions */
 
 JANET_CORE_FN(cfun_array_new,
@@ -222,6 +323,29 @@ JANET_CORE_FN(cfun_array_slice,
     return janet_wrap_array(array);
 }
 
+JANET_CORE_FN(cfun_array_view,
+              "(array/view arrtup &opt start end)",
+              "Takes a slice of an array, tuple, or array view like `array/slice`, but without copying. "
+              "Returns a read-only core/array-view that refers to the items of arrtup, and can be "
+              "indexed, iterated, and passed to functions that take an array or tuple. A view of an "
+              "array sees later changes to the array. Use `array/slice` or `tuple/slice` on a view "
+              "to copy its items out, so the parent can be garbage collected.") {
+    JanetRange range = janet_getslice(argc, argv);
+    janet_getindexed(argv, 0);
+    Janet parent = argv[0];
+    int32_t start = range.start;
+    JanetArraySlice *inner = janet_checkabstract(parent, &janet_array_view_type);
+    if (NULL != inner) {
+        parent = inner->parent;
+        start += inner->start;
+    }
+    JanetArraySlice *view = janet_abstract(&janet_array_view_type, sizeof(JanetArraySlice));
+    view->parent = parent;
+    view->start = start;
+    view->length = range.end - range.start;
+    return janet_wrap_abstract(view);
+}
+
 JANET_CORE_FN(cfun_array_concat,
               "(array/concat arr & parts)",
               "Concatenates a variable number of arrays (and tuples) into the first argument, "
@@ -359,6 +483,7 @@ void janet_lib_array(JanetTable *env) {
         JANET_CORE_REG("array/push", cfun_array_push),
         JANET_CORE_REG("array/ensure", cfun_array_ensure),
         JANET_CORE_REG("array/slice", cfun_array_slice),
+        JANET_CORE_REG("array/view", cfun_array_view),
         JANET_CORE_REG("array/concat", cfun_array_concat),
         JANET_CORE_REG("array/insert", cfun_array_insert),
         JANET_CORE_REG("array/remove", cfun_array_remove),
@@ -367,4 +492,5 @@ void janet_lib_array(JanetTable *env) {
         JANET_REG_END
     };
     janet_core_cfuns_ext(env, NULL, array_cfuns);
+    janet_register_abstract_type(&janet_array_view_type);
 }
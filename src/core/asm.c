@@ -66,6 +66,8 @@ struct JanetAssembler {
 static const JanetInstructionDef janet_ops[] = {
     {"add", JOP_ADD},
     {"addim", JOP_ADD_IMMEDIATE},
+    {"addimjmp", JOP_ADD_IMMEDIATE_JUMP},
+    {"addn", JOP_ADD_NUMBER},
     {"band", JOP_BAND},
     {"bnot", JOP_BNOT},
     {"bor", JOP_BOR},
@@ -77,14 +79,22 @@ static const JanetInstructionDef janet_ops[] = {
     {"div", JOP_DIVIDE},
     {"divf", JOP_DIVIDE_FLOOR},
     {"divim", JOP_DIVIDE_IMMEDIATE},
+    {"divn", JOP_DIVIDE_NUMBER},
     {"eq", JOP_EQUALS},
     {"eqim", JOP_EQUALS_IMMEDIATE},
+    {"eqimjmpno", JOP_EQUALS_IMMEDIATE_JUMP_IF_NOT},
+    {"eqjmpno", JOP_EQUALS_JUMP_IF_NOT},
     {"err", JOP_ERROR},
     {"get", JOP_GET},
     {"geti", JOP_GET_INDEX},
     {"gt", JOP_GREATER_THAN},
     {"gte", JOP_GREATER_THAN_EQUAL},
+    {"gtejmpno", JOP_GREATER_THAN_EQUAL_JUMP_IF_NOT},
+    {"gten", JOP_GREATER_THAN_EQUAL_NUMBER},
     {"gtim", JOP_GREATER_THAN_IMMEDIATE},
+    {"gtimjmpno", JOP_GREATER_THAN_IMMEDIATE_JUMP_IF_NOT},
+    {"gtjmpno", JOP_GREATER_THAN_JUMP_IF_NOT},
+    {"gtn", JOP_GREATER_THAN_NUMBER},
     {"in", JOP_IN},
     {"jmp", JOP_JUMP},
     {"jmpif", JOP_JUMP_IF},
@@ -92,6 +102,8 @@ static const JanetInstructionDef janet_ops[] = {
     {"jmpnn", JOP_JUMP_IF_NOT_NIL},
     {"jmpno", JOP_JUMP_IF_NOT},
     {"ldc", JOP_LOAD_CONSTANT},
+    {"ldccall", JOP_LOAD_CONSTANT_CALL},
+    {"ldcget", JOP_LOAD_CONSTANT_GET},
     {"ldf", JOP_LOAD_FALSE},
     {"ldi", JOP_LOAD_INTEGER},
     {"ldn", JOP_LOAD_NIL},
@@ -101,7 +113,12 @@ static const JanetInstructionDef janet_ops[] = {
     {"len", JOP_LENGTH},
     {"lt", JOP_LESS_THAN},
     {"lte", JOP_LESS_THAN_EQUAL},
+    {"ltejmpno", JOP_LESS_THAN_EQUAL_JUMP_IF_NOT},
+    {"lten", JOP_LESS_THAN_EQUAL_NUMBER},
     {"ltim", JOP_LESS_THAN_IMMEDIATE},
+    {"ltimjmpno", JOP_LESS_THAN_IMMEDIATE_JUMP_IF_NOT},
+    {"ltjmpno", JOP_LESS_THAN_JUMP_IF_NOT},
+    {"ltn", JOP_LESS_THAN_NUMBER},
     {"mkarr", JOP_MAKE_ARRAY},
     {"mkbtp", JOP_MAKE_BRACKET_TUPLE},
     {"mkbuf", JOP_MAKE_BUFFER},
@@ -114,8 +131,11 @@ static const JanetInstructionDef janet_ops[] = {
     {"movn", JOP_MOVE_NEAR},
     {"mul", JOP_MULTIPLY},
     {"mulim", JOP_MULTIPLY_IMMEDIATE},
+    {"muln", JOP_MULTIPLY_NUMBER},
     {"neq", JOP_NOT_EQUALS},
     {"neqim", JOP_NOT_EQUALS_IMMEDIATE},
+    {"neqimjmpno", JOP_NOT_EQUALS_IMMEDIATE_JUMP_IF_NOT},
+    {"neqjmpno", JOP_NOT_EQUALS_JUMP_IF_NOT},
     {"next", JOP_NEXT},
     {"noop", JOP_NOOP},
     {"prop", JOP_PROPAGATE},
@@ -123,6 +143,7 @@ static const JanetInstructionDef janet_ops[] = {
     {"push2", JOP_PUSH_2},
     {"push3", JOP_PUSH_3},
     {"pusha", JOP_PUSH_ARRAY},
+    {"pushcall", JOP_PUSH_CALL},
     {"put", JOP_PUT},
     {"puti", JOP_PUT_INDEX},
     {"rem", JOP_REMAINDER},
@@ -139,6 +160,7 @@ static const JanetInstructionDef janet_ops[] = {
     {"sruim", JOP_SHIFT_RIGHT_UNSIGNED_IMMEDIATE},
     {"sub", JOP_SUBTRACT},
     {"subim", JOP_SUBTRACT_IMMEDIATE},
+    {"subn", JOP_SUBTRACT_NUMBER},
     {"tcall", JOP_TAILCALL},
     {"tchck", JOP_TYPECHECK}
 };
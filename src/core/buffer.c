@@ -505,6 +505,111 @@ JANET_CORE_FN(cfun_buffer_format,
     return argv[0];
 }
 
+/* Buffer pools */
+
+/* Set on buffers that sit in a pool's free list */
+#define JANET_BUFFER_FLAG_POOLED 0x20000
+
+typedef struct {
+    JanetArray *free;
+    int32_t capacity;
+    int32_t max_free;
+} JanetBufferPool;
+
+static int bufferpool_gcmark(void *p, size_t s) {
+    (void) s;
+    JanetBufferPool *pool = (JanetBufferPool *) p;
+    janet_mark(janet_wrap_array(pool->free));
+    return 0;
+}
+
+static int bufferpool_get(void *p, Janet key, Janet *out);
+
+const JanetAbstractType janet_buffer_pool_type = {
+    "core/buffer-pool",
+    NULL,
+    bufferpool_gcmark,
+    bufferpool_get,
+    JANET_ATEND_GET
+};
+
+static JanetBuffer *bufferpool_acquire(JanetBufferPool *pool) {
+    if (pool->free->count > 0) {
+        JanetBuffer *buffer = janet_unwrap_buffer(janet_array_pop(pool->free));
+        buffer->gc.flags &= ~JANET_BUFFER_FLAG_POOLED;
+        return buffer;
+    }
+    return janet_buffer(pool->capacity);
+}
+
+static void bufferpool_release(JanetBufferPool *pool, JanetBuffer *buffer) {
+    if (buffer->gc.flags & JANET_BUFFER_FLAG_POOLED) {
+        janet_panic("buffer already released");
+    }
+    janet_buffer_can_realloc(buffer);
+    buffer->count = 0;
+    if (pool->free->count < pool->max_free) {
+        buffer->gc.flags |= JANET_BUFFER_FLAG_POOLED;
+        janet_array_push(pool->free, janet_wrap_buffer(buffer));
+    }
+}
+
+/* Get a buffer argument for reads that may also be a buffer pool */
+JanetBuffer *janet_optreadbuffer(const Janet *argv, int32_t argc, int32_t n, int32_t dflt_len) {
+    if (n < argc) {
+        JanetBufferPool *pool = janet_checkabstract(argv[n], &janet_buffer_pool_type);
+        if (NULL != pool) return bufferpool_acquire(pool);
+    }
+    return janet_optbuffer(argv, argc, n, dflt_len);
+}
+
+JANET_CORE_FN(cfun_buffer_pool,
+              "(buffer/pool &opt capacity max-free)",
+              "Create a pool of reusable buffers. New buffers are created with `capacity` bytes "
+              "(default 1024), and at most `max-free` released buffers (default 64) are kept for reuse. "
+              "A pool can be passed in place of a buffer to `ev/read`, `net/read`, `net/chunk`, "
+              "`net/recv-from` and `file/read`, which then read into a buffer acquired from the pool.") {
+    janet_arity(argc, 0, 2);
+    int32_t capacity = janet_optnat(argv, argc, 0, 1024);
+    int32_t max_free = janet_optnat(argv, argc, 1, 64);
+    JanetArray *free = janet_array(0);
+    JanetBufferPool *pool = janet_abstract(&janet_buffer_pool_type, sizeof(JanetBufferPool));
+    pool->free = free;
+    pool->capacity = capacity;
+    pool->max_free = max_free;
+    return janet_wrap_abstract(pool);
+}
+
+JANET_CORE_FN(cfun_buffer_acquire,
+              "(buffer/acquire pool)",
+              "Take an empty buffer from a buffer pool, creating a new one if the pool has no free buffers.") {
+    janet_fixarity(argc, 1);
+    JanetBufferPool *pool = janet_getabstract(argv, 0, &janet_buffer_pool_type);
+    return janet_wrap_buffer(bufferpool_acquire(pool));
+}
+
+JANET_CORE_FN(cfun_buffer_release,
+              "(buffer/release pool buffer)",
+              "Return a buffer to a buffer pool so a later acquire can reuse its memory. The buffer is "
+              "cleared but keeps its capacity, and must not be used again until it is acquired. Returns nil.") {
+    janet_fixarity(argc, 2);
+    JanetBufferPool *pool = janet_getabstract(argv, 0, &janet_buffer_pool_type);
+    bufferpool_release(pool, janet_getbuffer(argv, 1));
+    return janet_wrap_nil();
+}
+
+static const JanetMethod bufferpool_methods[] = {
+    {"acquire", cfun_buffer_acquire},
+    {"release", cfun_buffer_release},
+    {NULL, NULL}
+};
+
+static int bufferpool_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD)) return 0;
+    return janet_getmethod(janet_unwrap_keyword(key), bufferpool_methods, out);
+}
+
 void janet_lib_buffer(JanetTable *env) {
     JanetRegExt buffer_cfuns[] = {
         JANET_CORE_REG("buffer/new", cfun_buffer_new),
@@ -525,6 +630,9 @@ void janet_lib_buffer(JanetTable *env) {
         JANET_CORE_REG("buffer/bit-toggle", cfun_buffer_bittoggle),
         JANET_CORE_REG("buffer/blit", cfun_buffer_blit),
         JANET_CORE_REG("buffer/format", cfun_buffer_format),
+        JANET_CORE_REG("buffer/pool", cfun_buffer_pool),
+        JANET_CORE_REG("buffer/acquire", cfun_buffer_acquire),
+        JANET_CORE_REG("buffer/release", cfun_buffer_release),
         JANET_REG_END
     };
     janet_core_cfuns_ext(env, NULL, buffer_cfuns);
@@ -106,15 +106,1214 @@ enum JanetInstructionType janet_instructions[JOP_INSTRUCTION_COUNT] = {
     JINT_SSS, /* JOP_NEXT */
     JINT_SSS, /* JOP_NOT_EQUALS, */
     JINT_SSI, /* JOP_NOT_EQUALS_IMMEDIATE, */
-    JINT_SSS /* JOP_CANCEL, */
+    JINT_SSS, /* JOP_CANCEL, */
+    JINT_SSS, /* JOP_LESS_THAN_JUMP_IF_NOT */
+    JINT_SSI, /* JOP_LESS_THAN_IMMEDIATE_JUMP_IF_NOT */
+    JINT_SSS, /* JOP_LESS_THAN_EQUAL_JUMP_IF_NOT */
+    JINT_SSS, /* JOP_GREATER_THAN_JUMP_IF_NOT */
+    JINT_SSI, /* JOP_GREATER_THAN_IMMEDIATE_JUMP_IF_NOT */
+    JINT_SSS, /* JOP_GREATER_THAN_EQUAL_JUMP_IF_NOT */
+    JINT_SSS, /* JOP_EQUALS_JUMP_IF_NOT */
+    JINT_SSI, /* JOP_EQUALS_IMMEDIATE_JUMP_IF_NOT */
+    JINT_SSS, /* JOP_NOT_EQUALS_JUMP_IF_NOT */
+    JINT_SSI, /* JOP_NOT_EQUALS_IMMEDIATE_JUMP_IF_NOT */
+    JINT_SSI, /* JOP_ADD_IMMEDIATE_JUMP */
+    JINT_SC, /* JOP_LOAD_CONSTANT_GET */
+    JINT_SC, /* JOP_LOAD_CONSTANT_CALL */
+    JINT_S, /* JOP_PUSH_CALL */
+    JINT_SSS, /* JOP_ADD_NUMBER */
+    JINT_SSS, /* JOP_SUBTRACT_NUMBER */
+    JINT_SSS, /* JOP_MULTIPLY_NUMBER */
+    JINT_SSS, /* JOP_DIVIDE_NUMBER */
+    JINT_SSS, /* JOP_LESS_THAN_NUMBER */
+    JINT_SSS, /* JOP_LESS_THAN_EQUAL_NUMBER */
+    JINT_SSS, /* JOP_GREATER_THAN_NUMBER */
+    JINT_SSS /* JOP_GREATER_THAN_EQUAL_NUMBER */
 };
 
+/* Instruction pairs that have a fused form. A fused instruction has the operands
+ * of the first instruction of the pair, and after doing its work goes straight
+ * to the second instruction, which stays in place after it. */
+static const uint8_t janet_fused_ops[][3] = {
+    {JOP_LESS_THAN, JOP_JUMP_IF_NOT, JOP_LESS_THAN_JUMP_IF_NOT},
+    {JOP_LESS_THAN_IMMEDIATE, JOP_JUMP_IF_NOT, JOP_LESS_THAN_IMMEDIATE_JUMP_IF_NOT},
+    {JOP_LESS_THAN_EQUAL, JOP_JUMP_IF_NOT, JOP_LESS_THAN_EQUAL_JUMP_IF_NOT},
+    {JOP_GREATER_THAN, JOP_JUMP_IF_NOT, JOP_GREATER_THAN_JUMP_IF_NOT},
+    {JOP_GREATER_THAN_IMMEDIATE, JOP_JUMP_IF_NOT, JOP_GREATER_THAN_IMMEDIATE_JUMP_IF_NOT},
+    {JOP_GREATER_THAN_EQUAL, JOP_JUMP_IF_NOT, JOP_GREATER_THAN_EQUAL_JUMP_IF_NOT},
+    {JOP_EQUALS, JOP_JUMP_IF_NOT, JOP_EQUALS_JUMP_IF_NOT},
+    {JOP_EQUALS_IMMEDIATE, JOP_JUMP_IF_NOT, JOP_EQUALS_IMMEDIATE_JUMP_IF_NOT},
+    {JOP_NOT_EQUALS, JOP_JUMP_IF_NOT, JOP_NOT_EQUALS_JUMP_IF_NOT},
+    {JOP_NOT_EQUALS_IMMEDIATE, JOP_JUMP_IF_NOT, JOP_NOT_EQUALS_IMMEDIATE_JUMP_IF_NOT},
+    {JOP_ADD_IMMEDIATE, JOP_JUMP, JOP_ADD_IMMEDIATE_JUMP},
+    {JOP_LOAD_CONSTANT, JOP_GET, JOP_LOAD_CONSTANT_GET},
+    {JOP_LOAD_CONSTANT, JOP_CALL, JOP_LOAD_CONSTANT_CALL},
+    {JOP_PUSH, JOP_CALL, JOP_PUSH_CALL}
+};
+
+/* Instructions with a form for operands that are known to be numbers */
+static const uint8_t janet_typed_ops[][2] = {
+    {JOP_ADD, JOP_ADD_NUMBER},
+    {JOP_SUBTRACT, JOP_SUBTRACT_NUMBER},
+    {JOP_MULTIPLY, JOP_MULTIPLY_NUMBER},
+    {JOP_DIVIDE, JOP_DIVIDE_NUMBER},
+    {JOP_LESS_THAN, JOP_LESS_THAN_NUMBER},
+    {JOP_LESS_THAN_EQUAL, JOP_LESS_THAN_EQUAL_NUMBER},
+    {JOP_GREATER_THAN, JOP_GREATER_THAN_NUMBER},
+    {JOP_GREATER_THAN_EQUAL, JOP_GREATER_THAN_EQUAL_NUMBER}
+};
+
+/* Rewrite instruction pairs to fused instructions. Both instructions of a
+ * pair are still executed, so jumps into the middle of a pair and breakpoints
+ * work as before. This should be the last pass, as other passes do not know about
+ * fused instructions. */
+void janet_bytecode_fuse(JanetFuncDef *def) {
+    for (int32_t i = 0; i + 1 < def->bytecode_length; i++) {
+        uint32_t instr = def->bytecode[i];
+        uint32_t next = def->bytecode[i + 1] & 0x7F;
+        for (size_t j = 0; j < sizeof(janet_fused_ops) / sizeof(janet_fused_ops[0]); j++) {
+            if ((instr & 0x7F) == janet_fused_ops[j][0] && next == janet_fused_ops[j][1]) {
+                def->bytecode[i] = (instr & ~0x7Fu) | janet_fused_ops[j][2];
+                break;
+            }
+        }
+    }
+}
+
+/* Get the plain form of an instruction. This is the first instruction of a
+ * fused pair, or the checked form of a typed instruction. */
+uint32_t janet_bytecode_unfuse(uint32_t instr) {
+    for (size_t j = 0; j < sizeof(janet_fused_ops) / sizeof(janet_fused_ops[0]); j++) {
+        if ((instr & 0x7F) == janet_fused_ops[j][2]) {
+            return (instr & ~0x7Fu) | janet_fused_ops[j][0];
+        }
+    }
+    for (size_t j = 0; j < sizeof(janet_typed_ops) / sizeof(janet_typed_ops[0]); j++) {
+        if ((instr & 0x7F) == janet_typed_ops[j][1]) {
+            return (instr & ~0x7Fu) | janet_typed_ops[j][0];
+        }
+    }
+    return instr;
+}
+
+/* Get the local slots an instruction uses, whether it reads or writes them.
+ * Returns the number of slots put in slots. */
+static int janet_instr_locals(uint32_t instr, int32_t *slots) {
+    switch (janet_instructions[instr & 0x7F]) {
+        default:
+        case JINT_0:
+        case JINT_L:
+            return 0;
+        case JINT_S:
+            slots[0] = (int32_t)(instr >> 8);
+            return 1;
+        case JINT_SL:
+        case JINT_ST:
+        case JINT_SI:
+        case JINT_SU:
+        case JINT_SD:
+        case JINT_SC:
+        case JINT_SES:
+            slots[0] = (int32_t)((instr >> 8) & 0xFF);
+            return 1;
+        case JINT_SS:
+            slots[0] = (int32_t)((instr >> 8) & 0xFF);
+            slots[1] = (int32_t)(instr >> 16);
+            return 2;
+        case JINT_SSI:
+        case JINT_SSU:
+            slots[0] = (int32_t)((instr >> 8) & 0xFF);
+            slots[1] = (int32_t)((instr >> 16) & 0xFF);
+            return 2;
+        case JINT_SSS:
+            slots[0] = (int32_t)((instr >> 8) & 0xFF);
+            slots[1] = (int32_t)((instr >> 16) & 0xFF);
+            slots[2] = (int32_t)(instr >> 24);
+            return 3;
+    }
+}
+
+/* Check if an instruction only writes to its A slot, and only reads its other slots. */
+static int janet_instr_writes_a(uint32_t instr) {
+    switch (instr & 0x7F) {
+        default:
+            return 0;
+        case JOP_ADD_IMMEDIATE:
+        case JOP_ADD:
+        case JOP_SUBTRACT_IMMEDIATE:
+        case JOP_SUBTRACT:
+        case JOP_MULTIPLY_IMMEDIATE:
+        case JOP_MULTIPLY:
+        case JOP_DIVIDE_IMMEDIATE:
+        case JOP_DIVIDE:
+        case JOP_DIVIDE_FLOOR:
+        case JOP_MODULO:
+        case JOP_REMAINDER:
+        case JOP_BAND:
+        case JOP_BOR:
+        case JOP_BXOR:
+        case JOP_BNOT:
+        case JOP_SHIFT_LEFT:
+        case JOP_SHIFT_LEFT_IMMEDIATE:
+        case JOP_SHIFT_RIGHT:
+        case JOP_SHIFT_RIGHT_IMMEDIATE:
+        case JOP_SHIFT_RIGHT_UNSIGNED:
+        case JOP_SHIFT_RIGHT_UNSIGNED_IMMEDIATE:
+        case JOP_MOVE_NEAR:
+        case JOP_GREATER_THAN:
+        case JOP_GREATER_THAN_IMMEDIATE:
+        case JOP_LESS_THAN:
+        case JOP_LESS_THAN_IMMEDIATE:
+        case JOP_EQUALS:
+        case JOP_EQUALS_IMMEDIATE:
+        case JOP_COMPARE:
+        case JOP_LOAD_INTEGER:
+        case JOP_LOAD_CONSTANT:
+        case JOP_CALL:
+        case JOP_IN:
+        case JOP_GET:
+        case JOP_GET_INDEX:
+        case JOP_LENGTH:
+        case JOP_GREATER_THAN_EQUAL:
+        case JOP_LESS_THAN_EQUAL:
+        case JOP_NOT_EQUALS:
+        case JOP_NOT_EQUALS_IMMEDIATE:
+        case JOP_ADD_NUMBER:
+        case JOP_SUBTRACT_NUMBER:
+        case JOP_MULTIPLY_NUMBER:
+        case JOP_DIVIDE_NUMBER:
+        case JOP_LESS_THAN_NUMBER:
+        case JOP_LESS_THAN_EQUAL_NUMBER:
+        case JOP_GREATER_THAN_NUMBER:
+        case JOP_GREATER_THAN_EQUAL_NUMBER:
+            return 1;
+    }
+}
+
+/* Copy propagation. Where an instruction writes a temporary slot that is then
+ * only moved to another slot, write the other slot directly and drop the move.
+ * Input is assumed valid, unfused bytecode. */
+void janet_bytecode_copyprop(JanetFuncDef *def) {
+    if (def->bytecode_length < 2) return;
+    JanetSArenaMark mark = janet_sarena_mark();
+    /* Count uses of each slot, and find jump targets */
+    int32_t *uses = janet_sarena_alloc(sizeof(int32_t) * (size_t)(def->slotcount + 1));
+    uint8_t *targets = janet_sarena_alloc((size_t) def->bytecode_length + 1);
+    memset(uses, 0, sizeof(int32_t) * (size_t)(def->slotcount + 1));
+    memset(targets, 0, (size_t) def->bytecode_length + 1);
+    for (int32_t i = 0; i < def->bytecode_length; i++) {
+        uint32_t instr = def->bytecode[i];
+        int32_t slots[3];
+        int n = janet_instr_locals(instr, slots);
+        for (int k = 0; k < n; k++) {
+            if (slots[k] < def->slotcount) uses[slots[k]]++;
+        }
+        int32_t target = -1;
+        switch (instr & 0x7F) {
+            case JOP_JUMP:
+                target = i + (((int32_t)instr) >> 8);
+                break;
+            case JOP_JUMP_IF:
+            case JOP_JUMP_IF_NOT:
+            case JOP_JUMP_IF_NIL:
+            case JOP_JUMP_IF_NOT_NIL:
+                target = i + (((int32_t)instr) >> 16);
+                break;
+        }
+        if (target >= 0 && target <= def->bytecode_length) targets[target] = 1;
+    }
+    /* Parameters, captured slots and named slots are never temporaries */
+    int32_t params = def->arity + ((def->flags & JANET_FUNCDEF_FLAG_VARARG) ? 1 : 0);
+    for (int32_t i = 0; i < params && i < def->slotcount; i++) {
+        uses[i] = -1;
+    }
+    if (def->closure_bitset != NULL) {
+        for (int32_t i = 0; i < def->slotcount; i++) {
+            if (def->closure_bitset[i >> 5] & (1U << (i & 31))) uses[i] = -1;
+        }
+    }
+    for (int32_t i = 0; i < def->symbolmap_length; i++) {
+        uint32_t slot = def->symbolmap[i].slot_index;
+        if (def->symbolmap[i].birth_pc < UINT32_MAX && slot < (uint32_t) def->slotcount) uses[slot] = -1;
+    }
+    /* Rewrite a write to a temporary followed by a move out of it */
+    for (int32_t i = 1; i < def->bytecode_length; i++) {
+        uint32_t move = def->bytecode[i];
+        if ((move & 0x7F) != JOP_MOVE_NEAR || targets[i]) continue;
+        uint32_t dest = (move >> 8) & 0xFF;
+        uint32_t temp = move >> 16;
+        if (dest == temp || temp >= (uint32_t) def->slotcount || uses[temp] != 2) continue;
+        uint32_t prev = def->bytecode[i - 1];
+        if (!janet_instr_writes_a(prev) || ((prev >> 8) & 0xFF) != temp) continue;
+        def->bytecode[i - 1] = (prev & ~0xFF00u) | (dest << 8);
+        def->bytecode[i] = JOP_NOOP;
+        uses[temp] = 0;
+    }
+    janet_sarena_reset(mark);
+}
+
+/* Replace instructions that can never run with noops. Input is assumed valid,
+ * unfused bytecode. */
+void janet_bytecode_remove_unreachable(JanetFuncDef *def) {
+    if (def->bytecode_length == 0) return;
+    JanetSArenaMark mark = janet_sarena_mark();
+    uint8_t *reached = janet_sarena_alloc((size_t) def->bytecode_length);
+    int32_t *work = janet_sarena_alloc(sizeof(int32_t) * (size_t)(2 * def->bytecode_length + 1));
+    memset(reached, 0, (size_t) def->bytecode_length);
+    int32_t top = 0;
+    work[top++] = 0;
+    while (top > 0) {
+        int32_t i = work[--top];
+        if (i < 0 || i >= def->bytecode_length || reached[i]) continue;
+        reached[i] = 1;
+        uint32_t instr = def->bytecode[i];
+        switch (instr & 0x7F) {
+            case JOP_RETURN:
+            case JOP_RETURN_NIL:
+            case JOP_TAILCALL:
+            case JOP_ERROR:
+                break;
+            case JOP_JUMP:
+                work[top++] = i + (((int32_t)instr) >> 8);
+                break;
+            case JOP_JUMP_IF:
+            case JOP_JUMP_IF_NOT:
+            case JOP_JUMP_IF_NIL:
+            case JOP_JUMP_IF_NOT_NIL:
+                work[top++] = i + (((int32_t)instr) >> 16);
+                work[top++] = i + 1;
+                break;
+            default:
+                work[top++] = i + 1;
+                break;
+        }
+    }
+    for (int32_t i = 0; i < def->bytecode_length; i++) {
+        if (!reached[i]) def->bytecode[i] = JOP_NOOP;
+    }
+    janet_sarena_reset(mark);
+}
+
+/* What type inference knows about a slot */
+typedef struct {
+    uint32_t types; /* Bit set of the types the slot can have */
+    int32_t copy; /* Slot this slot is an unchanged copy of, or -1 */
+    int32_t constant; /* Index of the constant in the slot, or -1 */
+    int32_t fact; /* One of JANET_FACT_* */
+    int32_t subject; /* Slot the fact is about */
+    uint32_t fact_types; /* For JANET_FACT_TYPE_IS, the types the subject has if this slot is truthy */
+} JanetSlotInfo;
+
+#define JANET_TI_ANY 0xFFFFu
+
+#define JANET_FACT_NONE 0
+#define JANET_FACT_TYPE_OF 1 /* Slot holds (type subject) */
+#define JANET_FACT_TYPE_IS 2 /* Slot holds (= (type subject) :some-type) */
+
+typedef struct {
+    JanetFuncDef *def;
+    int32_t nslots;
+    const uint8_t *captured; /* Slots closures can change. Nothing is known about them. */
+} JanetTypeInference;
+
+static void janet_ti_clear(JanetSlotInfo *info) {
+    info->types = JANET_TI_ANY;
+    info->copy = -1;
+    info->constant = -1;
+    info->fact = JANET_FACT_NONE;
+    info->subject = -1;
+    info->fact_types = 0;
+}
+
+/* Slot about to be written. Copies of it and facts about it no longer hold. */
+static JanetSlotInfo *janet_ti_write(JanetTypeInference *ti, JanetSlotInfo *st, int32_t slot) {
+    if (slot >= ti->nslots) return NULL;
+    for (int32_t i = 0; i < ti->nslots; i++) {
+        if (st[i].copy == slot) st[i].copy = -1;
+        if (st[i].fact != JANET_FACT_NONE && st[i].subject == slot) st[i].fact = JANET_FACT_NONE;
+    }
+    janet_ti_clear(st + slot);
+    return ti->captured[slot] ? NULL : st + slot;
+}
+
+static void janet_ti_set(JanetTypeInference *ti, JanetSlotInfo *st, int32_t slot, uint32_t types) {
+    JanetSlotInfo *info = janet_ti_write(ti, st, slot);
+    if (info) info->types = types;
+}
+
+static uint32_t janet_ti_types(JanetTypeInference *ti, JanetSlotInfo *st, int32_t slot) {
+    return slot < ti->nslots ? st[slot].types : JANET_TI_ANY;
+}
+
+/* Slot whose value this slot holds, or -1 if nothing can be said about it */
+static int32_t janet_ti_root(JanetTypeInference *ti, JanetSlotInfo *st, int32_t slot) {
+    if (slot >= ti->nslots || ti->captured[slot]) return -1;
+    return st[slot].copy >= 0 ? st[slot].copy : slot;
+}
+
+/* On a branch where slot is truthy, apply the fact about it */
+static void janet_ti_assume(JanetTypeInference *ti, JanetSlotInfo *st, int32_t slot) {
+    if (slot >= ti->nslots || st[slot].fact != JANET_FACT_TYPE_IS) return;
+    int32_t subject = st[slot].subject;
+    uint32_t types = st[slot].fact_types;
+    for (int32_t i = 0; i < ti->nslots; i++) {
+        if (i == subject || st[i].copy == subject) st[i].types &= types;
+    }
+}
+
+/* Check if a constant is a keyword naming a type, and get its type flag */
+static uint32_t janet_ti_typename(Janet x) {
+    if (!janet_checktype(x, JANET_KEYWORD)) return 0;
+    const uint8_t *kw = janet_unwrap_keyword(x);
+    for (int i = 0; i < 16; i++) {
+        if (i != JANET_ABSTRACT && !janet_cstrcmp(kw, janet_type_names[i])) return 1u << i;
+    }
+    return 0;
+}
+
+static int janet_ti_cfun(JanetTypeInference *ti, JanetSlotInfo *st, int32_t slot, int (*pred)(JanetCFunction)) {
+    if (slot >= ti->nslots || st[slot].constant < 0) return 0;
+    Janet x = ti->def->constants[st[slot].constant];
+    return janet_checktype(x, JANET_CFUNCTION) && pred(janet_unwrap_cfunction(x));
+}
+
+/* Merge the state of one path into the state at a join point. Returns
+ * non-zero if the state at the join point changed. */
+static int janet_ti_merge(JanetTypeInference *ti, JanetSlotInfo *into, const JanetSlotInfo *from) {
+    int changed = 0;
+    for (int32_t i = 0; i < ti->nslots; i++) {
+        JanetSlotInfo *a = into + i;
+        const JanetSlotInfo *b = from + i;
+        if ((a->types | b->types) != a->types) {
+            a->types |= b->types;
+            changed = 1;
+        }
+        if (a->copy != b->copy && a->copy >= 0) {
+            a->copy = -1;
+            changed = 1;
+        }
+        if (a->constant != b->constant && a->constant >= 0) {
+            a->constant = -1;
+            changed = 1;
+        }
+        if (a->fact != JANET_FACT_NONE &&
+                (a->fact != b->fact || a->subject != b->subject || a->fact_types != b->fact_types)) {
+            a->fact = JANET_FACT_NONE;
+            changed = 1;
+        }
+    }
+    return changed;
+}
+
+#define JANET_TI_NUMBERS(a, b) \
+    (janet_ti_types(ti, st, (a)) == JANET_TFLAG_NUMBER && janet_ti_types(ti, st, (b)) == JANET_TFLAG_NUMBER)
+
+/* Update the state for one instruction that is not a jump. If rewrite is set,
+ * also use the state before the instruction to pick a typed form of it. */
+static void janet_ti_step(JanetTypeInference *ti, JanetSlotInfo *st, int32_t i, int32_t *pushed, int rewrite) {
+    JanetFuncDef *def = ti->def;
+    uint32_t instr = def->bytecode[i];
+    uint32_t op = instr & 0x7F;
+    int32_t a = (int32_t)((instr >> 8) & 0xFF);
+    int32_t b = (int32_t)((instr >> 16) & 0xFF);
+    int32_t c = (int32_t)(instr >> 24);
+    int32_t d = (int32_t)(instr >> 8);
+    int32_t e = (int32_t)(instr >> 16);
+    switch (op) {
+        default: {
+            /* Nothing known about this instruction */
+            for (int32_t k = 0; k < ti->nslots; k++) janet_ti_clear(st + k);
+            *pushed = -1;
+            break;
+        }
+        case JOP_NOOP:
+        case JOP_PUT:
+        case JOP_PUT_INDEX:
+        case JOP_SET_UPVALUE:
+            break;
+        case JOP_PUSH:
+            *pushed = (*pushed == -2) ? janet_ti_root(ti, st, d) : -1;
+            break;
+        case JOP_PUSH_2:
+        case JOP_PUSH_3:
+        case JOP_PUSH_ARRAY:
+            *pushed = -1;
+            break;
+        case JOP_TYPECHECK: {
+            int32_t root = janet_ti_root(ti, st, a);
+            if (root < 0) break;
+            for (int32_t k = 0; k < ti->nslots; k++) {
+                if (k == root || st[k].copy == root) st[k].types &= (uint32_t) e;
+            }
+            break;
+        }
+        case JOP_MOVE_NEAR:
+        case JOP_MOVE_FAR: {
+            int32_t dest = op == JOP_MOVE_NEAR ? a : e;
+            int32_t src = op == JOP_MOVE_NEAR ? e : a;
+            if (dest == src) break;
+            JanetSlotInfo from;
+            if (src < ti->nslots) {
+                from = st[src];
+            } else {
+                janet_ti_clear(&from);
+            }
+            int32_t root = janet_ti_root(ti, st, src);
+            JanetSlotInfo *info = janet_ti_write(ti, st, dest);
+            if (info) {
+                /* The fact may have been about dest itself */
+                if (from.fact != JANET_FACT_NONE && from.subject == dest) from.fact = JANET_FACT_NONE;
+                *info = from;
+                info->copy = (root == dest) ? -1 : root;
+            }
+            break;
+        }
+        case JOP_LOAD_NIL:
+            janet_ti_set(ti, st, d, JANET_TFLAG_NIL);
+            break;
+        case JOP_LOAD_TRUE:
+        case JOP_LOAD_FALSE:
+            janet_ti_set(ti, st, d, JANET_TFLAG_BOOLEAN);
+            break;
+        case JOP_LOAD_INTEGER:
+            janet_ti_set(ti, st, a, JANET_TFLAG_NUMBER);
+            break;
+        case JOP_LOAD_CONSTANT: {
+            JanetSlotInfo *info = janet_ti_write(ti, st, a);
+            if (info && e < def->constants_length) {
+                info->types = 1u << janet_type(def->constants[e]);
+                info->constant = e;
+            }
+            break;
+        }
+        case JOP_ADD:
+        case JOP_SUBTRACT:
+        case JOP_MULTIPLY:
+        case JOP_DIVIDE:
+        case JOP_DIVIDE_FLOOR:
+        case JOP_MODULO:
+        case JOP_REMAINDER:
+        case JOP_BAND:
+        case JOP_BOR:
+        case JOP_BXOR:
+        case JOP_SHIFT_LEFT:
+        case JOP_SHIFT_RIGHT:
+        case JOP_SHIFT_RIGHT_UNSIGNED:
+        case JOP_ADD_NUMBER:
+        case JOP_SUBTRACT_NUMBER:
+        case JOP_MULTIPLY_NUMBER:
+        case JOP_DIVIDE_NUMBER: {
+            /* Other types can overload arithmetic to return anything */
+            int numbers = JANET_TI_NUMBERS(b, c);
+            if (rewrite && numbers) {
+                for (size_t j = 0; j < sizeof(janet_typed_ops) / sizeof(janet_typed_ops[0]); j++) {
+                    if (janet_typed_ops[j][0] == op) {
+                        def->bytecode[i] = (instr & ~0x7Fu) | janet_typed_ops[j][1];
+                    }
+                }
+            }
+            janet_ti_set(ti, st, a, numbers ? JANET_TFLAG_NUMBER : JANET_TI_ANY);
+            break;
+        }
+        case JOP_ADD_IMMEDIATE:
+        case JOP_SUBTRACT_IMMEDIATE:
+        case JOP_MULTIPLY_IMMEDIATE:
+        case JOP_DIVIDE_IMMEDIATE:
+        case JOP_SHIFT_LEFT_IMMEDIATE:
+        case JOP_SHIFT_RIGHT_IMMEDIATE:
+        case JOP_SHIFT_RIGHT_UNSIGNED_IMMEDIATE:
+            janet_ti_set(ti, st, a, janet_ti_types(ti, st, b) == JANET_TFLAG_NUMBER
+                         ? JANET_TFLAG_NUMBER : JANET_TI_ANY);
+            break;
+        case JOP_BNOT:
+            janet_ti_set(ti, st, a, janet_ti_types(ti, st, e) == JANET_TFLAG_NUMBER
+                         ? JANET_TFLAG_NUMBER : JANET_TI_ANY);
+            break;
+        case JOP_LESS_THAN:
+        case JOP_LESS_THAN_EQUAL:
+        case JOP_GREATER_THAN:
+        case JOP_GREATER_THAN_EQUAL:
+        case JOP_LESS_THAN_NUMBER:
+        case JOP_LESS_THAN_EQUAL_NUMBER:
+        case JOP_GREATER_THAN_NUMBER:
+        case JOP_GREATER_THAN_EQUAL_NUMBER:
+            /* A comparison followed by a conditional jump is fused later, which is faster still */
+            if (rewrite && JANET_TI_NUMBERS(b, c) &&
+                    !(i + 1 < def->bytecode_length && (def->bytecode[i + 1] & 0x7F) == JOP_JUMP_IF_NOT)) {
+                for (size_t j = 0; j < sizeof(janet_typed_ops) / sizeof(janet_typed_ops[0]); j++) {
+                    if (janet_typed_ops[j][0] == op) {
+                        def->bytecode[i] = (instr & ~0x7Fu) | janet_typed_ops[j][1];
+                    }
+                }
+            }
+            janet_ti_set(ti, st, a, JANET_TFLAG_BOOLEAN);
+            break;
+        case JOP_EQUALS: {
+            /* Look for (= (type x) :some-type) */
+            int32_t subject = -1;
+            uint32_t types = 0;
+            if (b < ti->nslots && c < ti->nslots) {
+                if (st[b].fact == JANET_FACT_TYPE_OF && st[c].constant >= 0) {
+                    subject = st[b].subject;
+                    types = janet_ti_typename(def->constants[st[c].constant]);
+                } else if (st[c].fact == JANET_FACT_TYPE_OF && st[b].constant >= 0) {
+                    subject = st[c].subject;
+                    types = janet_ti_typename(def->constants[st[b].constant]);
+                }
+            }
+            JanetSlotInfo *info = janet_ti_write(ti, st, a);
+            if (info) {
+                info->types = JANET_TFLAG_BOOLEAN;
+                if (types && subject >= 0 && subject != a) {
+                    info->fact = JANET_FACT_TYPE_IS;
+                    info->subject = subject;
+                    info->fact_types = types;
+                }
+            }
+            break;
+        }
+        case JOP_LESS_THAN_IMMEDIATE:
+        case JOP_GREATER_THAN_IMMEDIATE:
+        case JOP_EQUALS_IMMEDIATE:
+        case JOP_NOT_EQUALS:
+        case JOP_NOT_EQUALS_IMMEDIATE:
+            janet_ti_set(ti, st, a, JANET_TFLAG_BOOLEAN);
+            break;
+        case JOP_COMPARE:
+            janet_ti_set(ti, st, a, JANET_TFLAG_NUMBER);
+            break;
+        case JOP_CALL: {
+            if (janet_ti_cfun(ti, st, e, janet_math_returns_number)) {
+                janet_ti_set(ti, st, a, JANET_TFLAG_NUMBER);
+            } else if (*pushed >= 0 && *pushed != a && janet_ti_cfun(ti, st, e, janet_core_is_type)) {
+                int32_t subject = *pushed;
+                JanetSlotInfo *info = janet_ti_write(ti, st, a);
+                if (info) {
+                    info->types = JANET_TFLAG_KEYWORD;
+                    info->fact = JANET_FACT_TYPE_OF;
+                    info->subject = subject;
+                }
+            } else {
+                janet_ti_set(ti, st, a, JANET_TI_ANY);
+            }
+            *pushed = -2;
+            break;
+        }
+        case JOP_IN:
+        case JOP_GET:
+        case JOP_GET_INDEX:
+        case JOP_LENGTH:
+        case JOP_CLOSURE:
+        case JOP_LOAD_UPVALUE:
+        case JOP_NEXT:
+        case JOP_RESUME:
+        case JOP_SIGNAL:
+        case JOP_PROPAGATE:
+        case JOP_CANCEL:
+            janet_ti_set(ti, st, a, JANET_TI_ANY);
+            break;
+        case JOP_LOAD_SELF:
+        case JOP_MAKE_ARRAY:
+        case JOP_MAKE_BUFFER:
+        case JOP_MAKE_STRING:
+        case JOP_MAKE_STRUCT:
+        case JOP_MAKE_TABLE:
+        case JOP_MAKE_TUPLE:
+        case JOP_MAKE_BRACKET_TUPLE:
+            janet_ti_set(ti, st, d, JANET_TI_ANY);
+            break;
+    }
+}
+
+#undef JANET_TI_NUMBERS
+
+/* Find the types of slots with forward data flow analysis, and use typed
+ * instructions for arithmetic and comparisons on slots that are known to hold
+ * numbers. Types come from literals, arithmetic on numbers, math functions and
+ * checks of the form (= (type x) :number). Input is assumed valid, unfused
+ * bytecode. */
+void janet_bytecode_typeopt(JanetFuncDef *def) {
+    int32_t n = def->bytecode_length;
+    int32_t nslots = def->slotcount;
+    if (n == 0 || nslots == 0) return;
+    /* Without a closure bitset, closures may change any slot */
+    if ((def->flags & JANET_FUNCDEF_FLAG_NEEDSENV) && def->closure_bitset == NULL) return;
+
+    JanetSArenaMark mark = janet_sarena_mark();
+
+    /* Find the instructions that start blocks */
+    int32_t *block = janet_sarena_alloc(sizeof(int32_t) * (size_t) n);
+    int32_t nblocks = 0;
+    for (int32_t i = 0; i < n; i++) block[i] = -1;
+    block[0] = 0;
+    for (int32_t i = 0; i < n; i++) {
+        uint32_t instr = def->bytecode[i];
+        int32_t target = -1;
+        switch (instr & 0x7F) {
+            default:
+                continue;
+            case JOP_JUMP:
+                target = i + (((int32_t)instr) >> 8);
+                break;
+            case JOP_JUMP_IF:
+            case JOP_JUMP_IF_NOT:
+            case JOP_JUMP_IF_NIL:
+            case JOP_JUMP_IF_NOT_NIL:
+                target = i + (((int32_t)instr) >> 16);
+                break;
+            case JOP_RETURN:
+            case JOP_RETURN_NIL:
+            case JOP_TAILCALL:
+            case JOP_ERROR:
+                break;
+        }
+        if (target >= 0 && target < n) block[target] = 0;
+        if (i + 1 < n) block[i + 1] = 0;
+    }
+    for (int32_t i = 0; i < n; i++) {
+        if (block[i] == 0) block[i] = nblocks++;
+    }
+    if ((int64_t) nblocks * nslots > (1 << 20)) {
+        janet_sarena_reset(mark);
+        return;
+    }
+
+    JanetTypeInference ti;
+    ti.def = def;
+    ti.nslots = nslots;
+    uint8_t *captured = janet_sarena_alloc((size_t) nslots);
+    for (int32_t i = 0; i < nslots; i++) {
+        captured[i] = def->closure_bitset != NULL && (def->closure_bitset[i >> 5] & (1U << (i & 31)));
+    }
+    ti.captured = captured;
+
+    /* State at the start of each block, and a work list of blocks */
+    JanetSlotInfo *states = janet_sarena_alloc(sizeof(JanetSlotInfo) * (size_t) nblocks * (size_t) nslots);
+    uint8_t *reached = janet_sarena_alloc((size_t) nblocks);
+    uint8_t *queued = janet_sarena_alloc((size_t) nblocks);
+    int32_t *starts = janet_sarena_alloc(sizeof(int32_t) * (size_t) nblocks);
+    int32_t *work = janet_sarena_alloc(sizeof(int32_t) * (size_t) nblocks);
+    JanetSlotInfo *st = janet_sarena_alloc(sizeof(JanetSlotInfo) * (size_t) nslots);
+    JanetSlotInfo *taken = janet_sarena_alloc(sizeof(JanetSlotInfo) * (size_t) nslots);
+    memset(reached, 0, (size_t) nblocks);
+    memset(queued, 0, (size_t) nblocks);
+    for (int32_t i = 0; i < n; i++) {
+        if (block[i] >= 0) starts[block[i]] = i;
+    }
+    for (int32_t i = 0; i < nslots; i++) janet_ti_clear(states + i);
+    reached[0] = 1;
+    queued[0] = 1;
+    int32_t top = 0;
+    work[top++] = 0;
+
+    /* Run the analysis until nothing changes, then once more over every block to rewrite */
+    for (int rewrite = 0; rewrite < 2; rewrite++) {
+        if (rewrite) {
+            top = 0;
+            for (int32_t k = 0; k < nblocks; k++) {
+                if (reached[k]) work[top++] = k;
+            }
+        }
+        while (top > 0) {
+            int32_t k = work[--top];
+            queued[k] = 0;
+            memcpy(st, states + (size_t) k * nslots, sizeof(JanetSlotInfo) * (size_t) nslots);
+            /* The slot pushed since the last call in this block, -2 if there
+             * are no pushes and -1 if there is more than one. This is enough
+             * for type, which fails unless it gets exactly one argument. */
+            int32_t pushed = -2;
+            int32_t i = starts[k];
+            int32_t next = -1;
+            int32_t target = -1;
+            int has_taken = 0;
+            for (;;) {
+                uint32_t instr = def->bytecode[i];
+                uint32_t op = instr & 0x7F;
+                int done = 1;
+                switch (op) {
+                    case JOP_RETURN:
+                    case JOP_RETURN_NIL:
+                    case JOP_TAILCALL:
+                    case JOP_ERROR:
+                        break;
+                    case JOP_JUMP:
+                        target = i + (((int32_t)instr) >> 8);
+                        break;
+                    case JOP_JUMP_IF:
+                    case JOP_JUMP_IF_NOT:
+                    case JOP_JUMP_IF_NIL:
+                    case JOP_JUMP_IF_NOT_NIL: {
+                        int32_t slot = (int32_t)((instr >> 8) & 0xFF);
+                        target = i + (((int32_t)instr) >> 16);
+                        next = i + 1;
+                        has_taken = 1;
+                        memcpy(taken, st, sizeof(JanetSlotInfo) * (size_t) nslots);
+                        if (op == JOP_JUMP_IF) janet_ti_assume(&ti, taken, slot);
+                        if (op == JOP_JUMP_IF_NOT) janet_ti_assume(&ti, st, slot);
+                        break;
+                    }
+                    default:
+                        janet_ti_step(&ti, st, i, &pushed, rewrite);
+                        if (i + 1 < n && block[i + 1] < 0) {
+                            i++;
+                            done = 0;
+                        } else {
+                            next = i + 1;
+                        }
+                        break;
+                }
+                if (done) break;
+            }
+            if (rewrite) continue;
+            /* Pass the state on to the following blocks */
+            for (int side = 0; side < 2; side++) {
+                int32_t to = side ? target : next;
+                JanetSlotInfo *from = (side && has_taken) ? taken : st;
+                if (to < 0 || to >= n) continue;
+                int32_t kk = block[to];
+                JanetSlotInfo *into = states + (size_t) kk * nslots;
+                int changed;
+                if (!reached[kk]) {
+                    memcpy(into, from, sizeof(JanetSlotInfo) * (size_t) nslots);
+                    reached[kk] = 1;
+                    changed = 1;
+                } else {
+                    changed = janet_ti_merge(&ti, into, from);
+                }
+                if (changed && !queued[kk]) {
+                    queued[kk] = 1;
+                    work[top++] = kk;
+                }
+            }
+        }
+    }
+
+    janet_sarena_reset(mark);
+}
+
+/* Get the slot an instruction writes, or -1. Other slots it uses are read. */
+static int32_t janet_instr_write(uint32_t instr) {
+    switch (instr & 0x7F) {
+        case JOP_LOAD_NIL:
+        case JOP_LOAD_TRUE:
+        case JOP_LOAD_FALSE:
+        case JOP_LOAD_SELF:
+        case JOP_MAKE_ARRAY:
+        case JOP_MAKE_BUFFER:
+        case JOP_MAKE_STRING:
+        case JOP_MAKE_STRUCT:
+        case JOP_MAKE_TABLE:
+        case JOP_MAKE_TUPLE:
+        case JOP_MAKE_BRACKET_TUPLE:
+            return (int32_t)(instr >> 8);
+        case JOP_MOVE_FAR:
+            return (int32_t)(instr >> 16);
+        case JOP_CLOSURE:
+        case JOP_LOAD_UPVALUE:
+        case JOP_NEXT:
+        case JOP_RESUME:
+        case JOP_SIGNAL:
+        case JOP_PROPAGATE:
+        case JOP_CANCEL:
+        case JOP_MOVE_NEAR:
+            return (int32_t)((instr >> 8) & 0xFF);
+        default:
+            return janet_instr_writes_a(instr) ? (int32_t)((instr >> 8) & 0xFF) : -1;
+    }
+}
+
+/* Follow the functions made by the instructions marked in sources through the
+ * slots of def, and check that they are only ever called. Tail calls replace the
+ * current frame, so they only count as calls if allow_tail is set. This is
+ * forward data flow over a bit set of the slots that may hold such a function. */
+static int janet_functions_escape(JanetFuncDef *def, const uint8_t *sources, int allow_tail) {
+    int32_t n = def->bytecode_length;
+    int32_t words = (def->slotcount + 31) >> 5;
+    if (n == 0 || words == 0) return 0;
+    if ((int64_t) n * words > (1 << 20)) return 1;
+    JanetSArenaMark mark = janet_sarena_mark();
+    uint32_t *states = janet_sarena_alloc(sizeof(uint32_t) * (size_t) n * (size_t) words);
+    uint32_t *st = janet_sarena_alloc(sizeof(uint32_t) * (size_t) words);
+    uint8_t *queued = janet_sarena_alloc((size_t) n);
+    uint8_t *seen = janet_sarena_alloc((size_t) n);
+    int32_t *work = janet_sarena_alloc(sizeof(int32_t) * (size_t) n);
+    memset(states, 0, sizeof(uint32_t) * (size_t) n * (size_t) words);
+    memset(queued, 0, (size_t) n);
+    memset(seen, 0, (size_t) n);
+    int32_t top = 0;
+    work[top++] = 0;
+    queued[0] = 1;
+    seen[0] = 1;
+    int escapes = 0;
+#define TAINTED(s) ((s) < def->slotcount && (st[(s) >> 5] & (1U << ((s) & 31))))
+    while (!escapes && top > 0) {
+        int32_t i = work[--top];
+        queued[i] = 0;
+        memcpy(st, states + (size_t) i * words, sizeof(uint32_t) * (size_t) words);
+        uint32_t instr = janet_bytecode_unfuse(def->bytecode[i]);
+        uint32_t op = instr & 0x7F;
+        int32_t slots[3];
+        int nslots = janet_instr_locals(instr, slots);
+        int32_t write = janet_instr_write(instr);
+        int tainted = 0;
+        for (int k = 0; k < nslots; k++) {
+            int32_t slot = slots[k];
+            if (slot == write || !TAINTED(slot)) continue;
+            if (op == JOP_CALL || op == JOP_MOVE_NEAR || op == JOP_MOVE_FAR ||
+                    (op == JOP_TAILCALL && allow_tail)) {
+                tainted = 1;
+            } else {
+                escapes = 1;
+            }
+        }
+        /* A call writes its result over the function slot, and a self move does nothing */
+        if (op == JOP_CALL && write == (int32_t)(instr >> 16)) tainted = 0;
+        if (op == JOP_MOVE_NEAR && write == (int32_t)(instr >> 16)) tainted = TAINTED(write);
+        if (op == JOP_MOVE_FAR && write == (int32_t)((instr >> 8) & 0xFF)) tainted = TAINTED(write);
+        if (write >= 0 && write < def->slotcount) {
+            st[write >> 5] &= ~(1U << (write & 31));
+            if (sources[i] || ((op == JOP_MOVE_NEAR || op == JOP_MOVE_FAR) && tainted)) {
+                /* Closures can read captured slots at any time */
+                if (def->closure_bitset != NULL && (def->closure_bitset[write >> 5] & (1U << (write & 31)))) {
+                    escapes = 1;
+                }
+                st[write >> 5] |= 1U << (write & 31);
+            }
+        }
+        int32_t next[2] = {-1, -1};
+        switch (op) {
+            case JOP_RETURN:
+            case JOP_RETURN_NIL:
+            case JOP_TAILCALL:
+            case JOP_ERROR:
+                break;
+            case JOP_JUMP:
+                next[0] = i + (((int32_t)instr) >> 8);
+                break;
+            case JOP_JUMP_IF:
+            case JOP_JUMP_IF_NOT:
+            case JOP_JUMP_IF_NIL:
+            case JOP_JUMP_IF_NOT_NIL:
+                next[0] = i + (((int32_t)instr) >> 16);
+                next[1] = i + 1;
+                break;
+            default:
+                next[0] = i + 1;
+                break;
+        }
+        for (int k = 0; k < 2; k++) {
+            int32_t to = next[k];
+            if (to < 0 || to >= n) continue;
+            uint32_t *into = states + (size_t) to * words;
+            int changed = 0;
+            for (int32_t w = 0; w < words; w++) {
+                if ((into[w] | st[w]) != into[w]) {
+                    into[w] |= st[w];
+                    changed = 1;
+                }
+            }
+            if ((changed || !seen[to]) && !queued[to]) {
+                queued[to] = 1;
+                seen[to] = 1;
+                work[top++] = to;
+            }
+        }
+    }
+#undef TAINTED
+    janet_sarena_reset(mark);
+    return escapes;
+}
+
+/* Mark a function whose closures over its own frame are only ever called while
+ * that frame is live. Such closures cannot be reached once the function returns,
+ * so its environment does not need to be copied off the stack. Input is assumed
+ * valid bytecode. */
+void janet_bytecode_noescape(JanetFuncDef *def) {
+    if (!(def->flags & JANET_FUNCDEF_FLAG_NEEDSENV) || def->bytecode_length == 0) return;
+    JanetSArenaMark mark = janet_sarena_mark();
+    uint8_t *sources = janet_sarena_alloc((size_t) def->bytecode_length);
+    memset(sources, 0, (size_t) def->bytecode_length);
+    int ok = 1;
+    for (int32_t i = 0; ok && i < def->bytecode_length; i++) {
+        uint32_t instr = def->bytecode[i];
+        if ((instr & 0x7F) != JOP_CLOSURE) continue;
+        JanetFuncDef *child = def->defs[instr >> 16];
+        int captures = 0;
+        for (int32_t j = 0; j < child->environments_length; j++) {
+            int32_t inherit = child->environments[j];
+            if (inherit == -1 || inherit >= def->environments_length) captures = 1;
+        }
+        if (!captures) continue;
+        sources[i] = 1;
+        /* Closures inside the child could pass the environment on */
+        if (child->defs_length) ok = 0;
+        /* The child can only call itself */
+        if (ok && child->bytecode_length) {
+            uint8_t *selves = janet_sarena_alloc((size_t) child->bytecode_length);
+            int any = 0;
+            for (int32_t j = 0; j < child->bytecode_length; j++) {
+                selves[j] = (child->bytecode[j] & 0x7F) == JOP_LOAD_SELF;
+                any |= selves[j];
+            }
+            if (any && janet_functions_escape(child, selves, 1)) ok = 0;
+        }
+    }
+    if (ok && !janet_functions_escape(def, sources, 0)) {
+        def->flags |= JANET_FUNCDEF_FLAG_NOESCAPE;
+    }
+    janet_sarena_reset(mark);
+}
+
+/* Put new local slots into an instruction, in the order janet_instr_locals gets them.
+ * Slots must fit in 8 bits. */
+static uint32_t janet_instr_set_locals(uint32_t instr, const int32_t *slots) {
+    switch (janet_instructions[instr & 0x7F]) {
+        default:
+        case JINT_0:
+        case JINT_L:
+            return instr;
+        case JINT_S:
+            return (instr & 0xFFu) | ((uint32_t) slots[0] << 8);
+        case JINT_SL:
+        case JINT_ST:
+        case JINT_SI:
+        case JINT_SU:
+        case JINT_SD:
+        case JINT_SC:
+        case JINT_SES:
+            return (instr & 0xFFFF00FFu) | ((uint32_t) slots[0] << 8);
+        case JINT_SS:
+            return (instr & 0xFFu) | ((uint32_t) slots[0] << 8) | ((uint32_t) slots[1] << 16);
+        case JINT_SSI:
+        case JINT_SSU:
+            return (instr & 0xFF0000FFu) | ((uint32_t) slots[0] << 8) | ((uint32_t) slots[1] << 16);
+        case JINT_SSS:
+            return (instr & 0xFFu) | ((uint32_t) slots[0] << 8) |
+                   ((uint32_t) slots[1] << 16) | ((uint32_t) slots[2] << 24);
+    }
+}
+
+/* Renumber the slots of a function so that slots whose values are never live
+ * at the same time share a slot. The compiler only frees a slot when the name
+ * it holds goes out of scope, so long functions use many more slots than they
+ * need, and every call clears slotcount slots. This is linear scan allocation
+ * over live intervals: a slot is live from its first to its last use, widened
+ * over every loop it is live in, and slots that may be read before they are
+ * written keep the nil they start with by being live from the start. The first
+ * params slots hold the arguments. They and captured slots keep their numbers, and named slots are live for all of
+ * their scope so the debugger sees them. Input is assumed valid, unfused bytecode. */
+void janet_bytecode_regalloc(JanetFuncDef *def, int32_t params) {
+    int32_t n = def->bytecode_length;
+    int32_t nslots = def->slotcount;
+    if (n == 0 || nslots < 2 || nslots > 256) return;
+    /* An environment without a capture set keeps the whole frame */
+    if ((def->flags & JANET_FUNCDEF_FLAG_NEEDSENV) && def->closure_bitset == NULL) return;
+    JanetSArenaMark mark = janet_sarena_mark();
+    int32_t *start = janet_sarena_alloc(sizeof(int32_t) * 256);
+    int32_t *end = janet_sarena_alloc(sizeof(int32_t) * 256);
+    int32_t *map = janet_sarena_alloc(sizeof(int32_t) * 256);
+    int32_t *busy = janet_sarena_alloc(sizeof(int32_t) * 256);
+    int32_t *order = janet_sarena_alloc(sizeof(int32_t) * 256);
+    uint8_t *fixed = janet_sarena_alloc(256);
+    /* Slots that are definitely written on entry to each instruction */
+    uint32_t *written = janet_sarena_alloc(sizeof(uint32_t) * 8 * (size_t) n);
+    for (int32_t s = 0; s < nslots; s++) {
+        start[s] = INT32_MAX;
+        end[s] = -1;
+        map[s] = -1;
+        fixed[s] = 0;
+    }
+    int ok = 1;
+    for (int32_t i = 0; ok && i < n; i++) {
+        int32_t slots[3];
+        int count = janet_instr_locals(def->bytecode[i], slots);
+        for (int k = 0; k < count; k++) {
+            int32_t s = slots[k];
+            if (s >= nslots) {
+                ok = 0;
+                break;
+            }
+            if (i < start[s]) start[s] = i;
+            if (i > end[s]) end[s] = i;
+        }
+    }
+    if (!ok) goto done;
+    if (params > nslots) goto done;
+    for (int32_t s = 0; s < params; s++) {
+        fixed[s] = 1;
+        start[s] = 0;
+        if (end[s] < 0) end[s] = 0;
+    }
+    if (def->closure_bitset != NULL) {
+        for (int32_t s = 0; s < nslots; s++) {
+            if (def->closure_bitset[s >> 5] & (1U << (s & 31))) {
+                fixed[s] = 1;
+                start[s] = 0;
+                end[s] = n - 1;
+            }
+        }
+    }
+    for (int32_t i = 0; i < def->symbolmap_length; i++) {
+        JanetSymbolMap *sm = def->symbolmap + i;
+        if (sm->birth_pc == UINT32_MAX || sm->slot_index >= (uint32_t) nslots) continue;
+        int32_t s = (int32_t) sm->slot_index;
+        int32_t birth = (int32_t) sm->birth_pc;
+        int32_t death = sm->death_pc >= (uint32_t) n ? n - 1 : (int32_t) sm->death_pc;
+        if (birth < start[s]) start[s] = birth;
+        if (death > end[s]) end[s] = death;
+    }
+
+    /* Forward data flow for slots that are definitely written. Unvisited
+     * instructions start with every slot written, and only ever lose slots. */
+    memset(written, 0xFF, sizeof(uint32_t) * 8 * (size_t) n);
+    memset(written, 0, sizeof(uint32_t) * 8);
+    for (int32_t s = 0; s < params; s++) written[s >> 5] |= 1U << (s & 31);
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int32_t i = 0; i < n; i++) {
+            uint32_t instr = def->bytecode[i];
+            uint32_t out[8];
+            memcpy(out, written + 8 * i, sizeof(out));
+            int32_t w = janet_instr_write(instr);
+            if (w >= 0 && w < nslots) out[w >> 5] |= 1U << (w & 31);
+            int32_t succ[2];
+            int nsucc = 0;
+            switch (instr & 0x7F) {
+                case JOP_JUMP:
+                    succ[nsucc++] = i + (((int32_t)instr) >> 8);
+                    break;
+                case JOP_JUMP_IF:
+                case JOP_JUMP_IF_NOT:
+                case JOP_JUMP_IF_NIL:
+                case JOP_JUMP_IF_NOT_NIL:
+                    succ[nsucc++] = i + (((int32_t)instr) >> 16);
+                    succ[nsucc++] = i + 1;
+                    break;
+                case JOP_RETURN:
+                case JOP_RETURN_NIL:
+                case JOP_TAILCALL:
+                case JOP_ERROR:
+                    break;
+                default:
+                    succ[nsucc++] = i + 1;
+                    break;
+            }
+            for (int k = 0; k < nsucc; k++) {
+                if (succ[k] < 0 || succ[k] >= n) continue;
+                uint32_t *in = written + 8 * succ[k];
+                for (int j = 0; j < 8; j++) {
+                    uint32_t next = in[j] & out[j];
+                    if (next != in[j]) {
+                        in[j] = next;
+                        changed = 1;
+                    }
+                }
+            }
+        }
+    }
+    for (int32_t i = 0; i < n; i++) {
+        uint32_t instr = def->bytecode[i];
+        int32_t slots[3];
+        int count = janet_instr_locals(instr, slots);
+        int skip = janet_instr_write(instr) < 0 ? -1 : ((instr & 0x7F) == JOP_MOVE_FAR ? 1 : 0);
+        for (int k = 0; k < count; k++) {
+            int32_t s = slots[k];
+            if (k != skip && !(written[8 * i + (s >> 5)] & (1U << (s & 31)))) start[s] = 0;
+        }
+    }
+
+    /* Widen intervals over the loops they are live in */
+    changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int32_t i = 0; i < n; i++) {
+            uint32_t instr = def->bytecode[i];
+            int32_t target;
+            switch (instr & 0x7F) {
+                default:
+                    continue;
+                case JOP_JUMP:
+                    target = i + (((int32_t)instr) >> 8);
+                    break;
+                case JOP_JUMP_IF:
+                case JOP_JUMP_IF_NOT:
+                case JOP_JUMP_IF_NIL:
+                case JOP_JUMP_IF_NOT_NIL:
+                    target = i + (((int32_t)instr) >> 16);
+                    break;
+            }
+            if (target > i) continue;
+            for (int32_t s = 0; s < nslots; s++) {
+                if (start[s] > i || end[s] < target) continue;
+                if (start[s] > target) {
+                    start[s] = target;
+                    changed = 1;
+                }
+                if (end[s] < i) {
+                    end[s] = i;
+                    changed = 1;
+                }
+            }
+        }
+    }
+
+    /* Give each interval, in order of start, the lowest slot free by then */
+    int32_t norder = 0;
+    int32_t newcount = params;
+    for (int32_t s = 0; s < nslots; s++) {
+        busy[s] = -1;
+    }
+    for (int32_t s = 0; s < nslots; s++) {
+        if (fixed[s]) {
+            map[s] = s;
+            busy[s] = end[s];
+            if (s + 1 > newcount) newcount = s + 1;
+        } else if (end[s] >= 0) {
+            int32_t j = norder++;
+            while (j > 0 && start[order[j - 1]] > start[s]) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = s;
+        }
+    }
+    for (int32_t j = 0; j < norder; j++) {
+        int32_t s = order[j];
+        int32_t k = 0;
+        while (busy[k] >= start[s]) k++;
+        map[s] = k;
+        busy[k] = end[s];
+        if (k + 1 > newcount) newcount = k + 1;
+    }
+    if (newcount >= nslots) goto done;
+
+    /* Rewrite */
+    for (int32_t i = 0; i < n; i++) {
+        int32_t slots[3];
+        int count = janet_instr_locals(def->bytecode[i], slots);
+        if (count == 0) continue;
+        for (int k = 0; k < count; k++) slots[k] = map[slots[k]];
+        def->bytecode[i] = janet_instr_set_locals(def->bytecode[i], slots);
+    }
+    for (int32_t i = 0; i < def->symbolmap_length; i++) {
+        JanetSymbolMap *sm = def->symbolmap + i;
+        if (sm->birth_pc == UINT32_MAX || sm->slot_index >= (uint32_t) nslots) continue;
+        sm->slot_index = (uint32_t) map[sm->slot_index];
+    }
+    def->slotcount = newcount;
+
+done:
+    janet_sarena_reset(mark);
+}
+
 /* Remove all noops while preserving jumps and debugging information.
  * Useful as part of a filtering compiler pass. */
 void janet_bytecode_remove_noops(JanetFuncDef *def) {
 
     /* Get an instruction rewrite map so we can rewrite jumps */
-    uint32_t *pc_map = janet_smalloc(sizeof(uint32_t) * (1 + def->bytecode_length));
+    JanetSArenaMark mark = janet_sarena_mark();
+    uint32_t *pc_map = janet_sarena_alloc(sizeof(uint32_t) * (1 + def->bytecode_length));
     uint32_t new_bytecode_length = 0;
     for (int32_t i = 0; i < def->bytecode_length; i++) {
         uint32_t instr = def->bytecode[i];
@@ -173,7 +1372,7 @@ void janet_bytecode_remove_noops(JanetFuncDef *def) {
 
     def->bytecode_length = new_bytecode_length;
     def->bytecode = janet_realloc(def->bytecode, def->bytecode_length * sizeof(uint32_t));
-    janet_sfree(pc_map);
+    janet_sarena_reset(mark);
 }
 
 /* Remove redundant loads, moves and other instructions if possible and convert them to
@@ -519,6 +1718,10 @@ JanetFuncDef *janet_funcdef_alloc(void) {
     def->bytecode_length = 0;
     def->environments_length = 0;
     def->symbolmap_length = 0;
+#ifdef JANET_JIT
+    def->jit_count = 0;
+    def->jit = NULL;
+#endif
     return def;
 }
 
@@ -25,6 +25,7 @@
 #include <janet.h>
 #include "state.h"
 #include "fiber.h"
+#include "util.h"
 #endif
 
 #ifndef JANET_SINGLE_THREADED
@@ -418,10 +419,10 @@ JanetRange janet_getslice(int32_t argc, const Janet *argv) {
 Janet janet_dyn(const char *name) {
     if (!janet_vm.fiber) {
         if (!janet_vm.top_dyns) return janet_wrap_nil();
-        return janet_table_get(janet_vm.top_dyns, janet_ckeywordv(name));
+        return janet_dyn_get(janet_vm.top_dyns, janet_ckeywordv(name));
     }
     if (janet_vm.fiber->env) {
-        return janet_table_get(janet_vm.fiber->env, janet_ckeywordv(name));
+        return janet_dyn_get(janet_vm.fiber->env, janet_ckeywordv(name));
     } else {
         return janet_wrap_nil();
     }
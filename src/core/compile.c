@@ -134,6 +134,7 @@ void janetc_scope(JanetScope *s, JanetCompiler *c, int flags, const char *name)
     scope.envs = NULL;
     scope.defs = NULL;
     scope.bytecode_start = janet_v_count(c->buffer);
+    scope.params = 0;
     scope.flags = flags;
     scope.parent = c->scope;
     janetc_regalloc_init(&scope.ua);
@@ -525,8 +526,66 @@ void janetc_throwaway(JanetFopts opts, Janet x) {
     }
 }
 
+/* Check if a core function has no side effects, so calls to it with constant
+ * arguments can be evaluated at compile time */
+static int janetc_pure(JanetFunction *f) {
+    switch (f->def->flags & JANET_FUNCDEF_FLAG_TAG) {
+        default:
+            return 0;
+        case JANET_FUN_ADD:
+        case JANET_FUN_SUBTRACT:
+        case JANET_FUN_MULTIPLY:
+        case JANET_FUN_DIVIDE:
+        case JANET_FUN_DIVIDE_FLOOR:
+        case JANET_FUN_MODULO:
+        case JANET_FUN_REMAINDER:
+        case JANET_FUN_BAND:
+        case JANET_FUN_BOR:
+        case JANET_FUN_BXOR:
+        case JANET_FUN_LSHIFT:
+        case JANET_FUN_RSHIFT:
+        case JANET_FUN_RSHIFTU:
+        case JANET_FUN_BNOT:
+        case JANET_FUN_GT:
+        case JANET_FUN_LT:
+        case JANET_FUN_GTE:
+        case JANET_FUN_LTE:
+        case JANET_FUN_EQ:
+        case JANET_FUN_NEQ:
+        case JANET_FUN_CMP:
+            return 1;
+    }
+}
+
+/* Evaluate a call to a pure core function on constant numbers. */
+static int janetc_fold(JanetFunction *f, JanetSlot *slots, Janet *out) {
+    Janet args[8];
+    int32_t n = janet_v_count(slots);
+    if (n > 8 || !janetc_pure(f)) return 0;
+    for (int32_t i = 0; i < n; i++) {
+        if (!(slots[i].flags & JANET_SLOT_CONSTANT)) return 0;
+        if (!janet_checktype(slots[i].constant, JANET_NUMBER)) return 0;
+        args[i] = slots[i].constant;
+    }
+    /* Objects made so far by the compiler are not rooted */
+    int lock = janet_gclock();
+    JanetSignal status = janet_pcall(f, n, args, out, NULL);
+    janet_gcunlock(lock);
+    return status == JANET_SIGNAL_OK;
+}
+
+/* Check if a function was marked with :inline where it was defined */
+static int janetc_marked_inline(JanetCompiler *c, Janet head, Janet fun) {
+    if (!janet_checktype(head, JANET_SYMBOL)) return 0;
+    Janet entry = janet_table_get(c->env, head);
+    if (!janet_checktype(entry, JANET_TABLE)) return 0;
+    JanetTable *t = janet_unwrap_table(entry);
+    return janet_truthy(janet_table_get(t, janet_ckeywordv("inline"))) &&
+           janet_equals(janet_table_get(t, janet_ckeywordv("value")), fun);
+}
+
 /* Compile a call or tailcall instruction */
-static JanetSlot janetc_call(JanetFopts opts, JanetSlot *slots, JanetSlot fun) {
+static JanetSlot janetc_call(JanetFopts opts, JanetSlot *slots, JanetSlot fun, Janet head) {
     JanetSlot retslot;
     JanetCompiler *c = opts.compiler;
     int specialized = 0;
@@ -534,17 +593,33 @@ static JanetSlot janetc_call(JanetFopts opts, JanetSlot *slots, JanetSlot fun) {
         if (janet_checktype(fun.constant, JANET_FUNCTION)) {
             JanetFunction *f = janet_unwrap_function(fun.constant);
             const JanetFunOptimizer *o = janetc_funopt(f->def->flags);
-            if (o && (!o->can_optimize || o->can_optimize(opts, slots))) {
+            Janet folded;
+            if (c->optimize && janetc_fold(f, slots, &folded)) {
+                specialized = 1;
+                retslot = janetc_cslot(folded);
+            } else if (o && (!o->can_optimize || o->can_optimize(opts, slots))) {
                 specialized = 1;
                 retslot = o->optimize(opts, slots);
+            } else if (c->optimize) {
+                int32_t max_length = janetc_marked_inline(c, head, fun.constant)
+                                     ? JANET_INLINE_MAX_MARKED : JANET_INLINE_MAX;
+                if (janetc_can_inline(f->def, janet_v_count(slots), max_length)) {
+                    retslot = janetc_gettarget(opts);
+                    if (janetc_emit_inline(c, f->def, slots, retslot)) {
+                        specialized = 1;
+                    } else {
+                        janetc_freeslot(c, retslot);
+                    }
+                }
             }
         }
-        /* TODO janet function inlining (no c functions)*/
     }
     if (!specialized) {
         int32_t min_arity = janetc_pushslots(c, slots);
-        /* Check for provably incorrect function calls */
-        if (fun.flags & JANET_SLOT_CONSTANT) {
+        /* Check for provably incorrect function calls. Functions hoisted by the
+         * optimizer are skipped so that *optimize* does not change which
+         * programs compile. */
+        if ((fun.flags & JANET_SLOT_CONSTANT) && !(fun.flags & JANET_SLOT_HOISTED)) {
 
             /* Check for bad arity type if fun is a constant */
             switch (janet_type(fun.constant)) {
@@ -811,7 +886,7 @@ JanetSlot janetc_value(JanetFopts opts, Janet x) {
                 } else {
                     JanetSlot head = janetc_value(subopts, tup[0]);
                     subopts.flags = JANET_FUNCTION | JANET_CFUNCTION;
-                    ret = janetc_call(opts, janetc_toslots(c, tup + 1, janet_tuple_length(tup) - 1), head);
+                    ret = janetc_call(opts, janetc_toslots(c, tup + 1, janet_tuple_length(tup) - 1), head, tup[0]);
                     janetc_freeslot(c, head);
                 }
                 ret.flags &= ~JANET_SLOT_SPLICED;
@@ -998,11 +1073,22 @@ JanetFuncDef *janetc_pop_funcdef(JanetCompiler *c) {
     if (def->symbolmap_length) def->flags |= JANET_FUNCDEF_FLAG_HASSYMBOLMAP;
 
     /* Pop the scope */
+    int32_t params = scope->params;
     janetc_popscope(c);
 
     /* Do basic optimization */
+    if (c->optimize) {
+        janet_bytecode_copyprop(def);
+        janet_bytecode_remove_unreachable(def);
+    }
     janet_bytecode_movopt(def);
+    if (c->optimize) {
+        janet_bytecode_typeopt(def);
+        janet_bytecode_noescape(def);
+    }
+    janet_bytecode_regalloc(def, params);
     janet_bytecode_remove_noops(def);
+    janet_bytecode_fuse(def);
 
     return def;
 }
@@ -1018,6 +1104,7 @@ static void janetc_init(JanetCompiler *c, JanetTable *env, const uint8_t *where,
     c->current_mapping.line = -1;
     c->current_mapping.column = -1;
     c->lints = lints;
+    c->optimize = janet_truthy(janet_table_get(env, janet_ckeywordv("optimize")));
     /* Init result */
     c->result.error = NULL;
     c->result.status = JANET_COMPILE_OK;
@@ -90,6 +90,7 @@ typedef struct JanetSpecial JanetSpecial;
 #define JANET_SLOT_DEP_WARN 0x400000
 #define JANET_SLOT_DEP_ERROR 0x800000
 #define JANET_SLOT_SPLICED 0x1000000
+#define JANET_SLOT_HOISTED 0x2000000 /* fn form made constant by the optimizer */
 
 #define JANET_SLOTTYPE_ANY 0xFFFF
 
@@ -154,6 +155,7 @@ struct JanetScope {
     JanetEnvRef *envs;
 
     int32_t bytecode_start;
+    int32_t params; /* Slots at the start of the frame that hold the arguments */
     int flags;
 };
 
@@ -183,8 +185,17 @@ struct JanetCompiler {
 
     /* Collect linting results */
     JanetArray *lints;
+
+    /* Fold constants, inline small functions and remove dead code. Set
+     * from *optimize*. */
+    int optimize;
 };
 
+/* Longest functions, in instructions, that are inlined when optimizing.
+ * Functions marked with :inline can be longer. */
+#define JANET_INLINE_MAX 12
+#define JANET_INLINE_MAX_MARKED 128
+
 #define JANET_FOPTS_TAIL 0x10000
 #define JANET_FOPTS_HINT 0x20000
 #define JANET_FOPTS_DROP 0x40000
@@ -271,5 +282,12 @@ JanetSlot janetc_resolve(JanetCompiler *c, const uint8_t *sym);
 /* Bytecode optimization */
 void janet_bytecode_movopt(JanetFuncDef *def);
 void janet_bytecode_remove_noops(JanetFuncDef *def);
+void janet_bytecode_fuse(JanetFuncDef *def);
+uint32_t janet_bytecode_unfuse(uint32_t instr);
+void janet_bytecode_copyprop(JanetFuncDef *def);
+void janet_bytecode_remove_unreachable(JanetFuncDef *def);
+void janet_bytecode_typeopt(JanetFuncDef *def);
+void janet_bytecode_noescape(JanetFuncDef *def);
+void janet_bytecode_regalloc(JanetFuncDef *def, int32_t params);
 
 #endif
@@ -264,7 +264,7 @@ JANET_CORE_FN(janet_core_dyn,
     janet_arity(argc, 1, 2);
     Janet value;
     if (janet_vm.fiber->env) {
-        value = janet_table_get(janet_vm.fiber->env, argv[0]);
+        value = janet_dyn_get(janet_vm.fiber->env, argv[0]);
     } else {
         value = janet_wrap_nil();
     }
@@ -497,6 +497,67 @@ JANET_CORE_FN(janet_core_gccollect,
     return janet_wrap_nil();
 }
 
+static Janet janet_gc_histogram(const uint64_t *buckets) {
+    JanetArray *array = janet_array(JANET_GC_HISTOGRAM_BUCKETS);
+    for (int i = 0; i < JANET_GC_HISTOGRAM_BUCKETS; i++) {
+        array->data[i] = janet_wrap_number((double) buckets[i]);
+    }
+    array->count = JANET_GC_HISTOGRAM_BUCKETS;
+    return janet_wrap_array(array);
+}
+
+JANET_CORE_FN(janet_core_gcstats,
+              "(gc/stats)",
+              "Get statistics about the garbage collector as a table with the following keys:\n\n"
+              "* :collections - number of collections run\n\n"
+              "* :allocated - bytes allocated or reported as GC pressure since the last collection. "
+              "A collection runs when this reaches `(gcinterval)`\n\n"
+              "* :total-allocated - bytes of heap object headers allocated since the VM started, "
+              "not including the buffers they own\n\n"
+              "* :heap-objects - number of objects currently in the heap, including garbage\n\n"
+              "* :live-objects and :live-bytes - objects and bytes reached by the last collection\n\n"
+              "* :heap-limit - the limit set with `gcsetheaplimit`, or 0 if there is none\n\n"
+              "* :limit-errors - errors raised for going over the heap limit\n\n"
+              "* :types - a table mapping the kind of heap object to a table of its live :count and :bytes\n\n"
+              "* :mark-time and :sweep-time - total seconds spent marking and sweeping\n\n"
+              "* :mark-histogram and :sweep-histogram - arrays of pause counts, where the "
+              "count at index i is the number of pauses shorter than 2^i microseconds, and "
+              "the last count is the number of all longer pauses.") {
+    (void) argv;
+    janet_fixarity(argc, 0);
+    static const char *const type_names[JANET_GC_MEMORY_TYPES] = {
+        NULL, "string", "symbol", "array", "tuple", "table", "struct", "fiber",
+        "buffer", "function", "abstract", "funcenv", "funcdef", NULL, NULL
+    };
+    const JanetGCStats *stats = janet_gcstats();
+    JanetTable *types = janet_table(JANET_GC_MEMORY_TYPES);
+    size_t live_objects = 0, live_bytes = 0;
+    for (int i = 0; i < JANET_GC_MEMORY_TYPES; i++) {
+        if (NULL == type_names[i]) continue;
+        JanetTable *entry = janet_table(2);
+        janet_table_put(entry, janet_ckeywordv("count"), janet_wrap_number((double) stats->live_count[i]));
+        janet_table_put(entry, janet_ckeywordv("bytes"), janet_wrap_number((double) stats->live_bytes[i]));
+        janet_table_put(types, janet_ckeywordv(type_names[i]), janet_wrap_table(entry));
+        live_objects += stats->live_count[i];
+        live_bytes += stats->live_bytes[i];
+    }
+    JanetTable *t = janet_table(12);
+    janet_table_put(t, janet_ckeywordv("collections"), janet_wrap_number((double) stats->collections));
+    janet_table_put(t, janet_ckeywordv("allocated"), janet_wrap_number((double) janet_vm.next_collection));
+    janet_table_put(t, janet_ckeywordv("total-allocated"), janet_wrap_number((double) stats->total_allocated));
+    janet_table_put(t, janet_ckeywordv("heap-objects"), janet_wrap_number((double) janet_vm.block_count));
+    janet_table_put(t, janet_ckeywordv("live-objects"), janet_wrap_number((double) live_objects));
+    janet_table_put(t, janet_ckeywordv("live-bytes"), janet_wrap_number((double) live_bytes));
+    janet_table_put(t, janet_ckeywordv("heap-limit"), janet_wrap_number((double) janet_vm.heap_limit));
+    janet_table_put(t, janet_ckeywordv("limit-errors"), janet_wrap_number((double) stats->limit_errors));
+    janet_table_put(t, janet_ckeywordv("types"), janet_wrap_table(types));
+    janet_table_put(t, janet_ckeywordv("mark-time"), janet_wrap_number(stats->mark_ns / 1e9));
+    janet_table_put(t, janet_ckeywordv("sweep-time"), janet_wrap_number(stats->sweep_ns / 1e9));
+    janet_table_put(t, janet_ckeywordv("mark-histogram"), janet_gc_histogram(stats->mark_histogram));
+    janet_table_put(t, janet_ckeywordv("sweep-histogram"), janet_gc_histogram(stats->sweep_histogram));
+    return janet_wrap_table(t);
+}
+
 JANET_CORE_FN(janet_core_gcsetinterval,
               "(gcsetinterval interval)",
               "Set an integer number of bytes to allocate before running garbage collection. "
@@ -523,6 +584,47 @@ JANET_CORE_FN(janet_core_gcinterval,
     return janet_wrap_number((double) janet_vm.gc_interval);
 }
 
+JANET_CORE_FN(janet_core_gcsetsweepstep,
+              "(gcsetsweepstep step)",
+              "Enable incremental sweeping to bound garbage collection pauses. After each mark phase, "
+              "at most `step` heap objects are swept at a time, and the rest of the heap is swept "
+              "in slices of `step` objects as the program runs. Small values give shorter pauses "
+              "but hold on to garbage for longer. A step of 0, the default, sweeps the whole heap at once.") {
+    janet_fixarity(argc, 1);
+    janet_vm.gc_sweep_step = janet_getsize(argv, 0);
+    return janet_wrap_nil();
+}
+
+JANET_CORE_FN(janet_core_gcsweepstep,
+              "(gcsweepstep)",
+              "Returns the number of heap objects swept per slice of garbage collection, "
+              "or 0 if incremental sweeping is disabled.") {
+    (void) argv;
+    janet_fixarity(argc, 0);
+    return janet_wrap_number((double) janet_vm.gc_sweep_step);
+}
+
+JANET_CORE_FN(janet_core_gcsetheaplimit,
+              "(gcsetheaplimit limit)",
+              "Limit the heap of the current thread to about `limit` bytes of live objects, counted "
+              "like :live-bytes in `gc/stats`. Once the heap may have grown past the limit, the next "
+              "allocation in the interpreter runs a collection, and if the live objects still take up "
+              "at least `limit` bytes, raises an error in the running fiber that can be caught like any "
+              "other error. Native code that allocates a lot in one call is only checked after it "
+              "returns. A limit of 0, the default, removes the limit.") {
+    janet_fixarity(argc, 1);
+    janet_gcsetlimit(janet_getsize(argv, 0));
+    return janet_wrap_nil();
+}
+
+JANET_CORE_FN(janet_core_gcheaplimit,
+              "(gcheaplimit)",
+              "Returns the heap limit of the current thread in bytes, or 0 if there is no limit.") {
+    (void) argv;
+    janet_fixarity(argc, 0);
+    return janet_wrap_number((double) janet_vm.heap_limit);
+}
+
 JANET_CORE_FN(janet_core_type,
               "(type x)",
               "Returns the type of `x` as a keyword. `x` is one of:\n\n"
@@ -550,6 +652,10 @@ JANET_CORE_FN(janet_core_type,
     }
 }
 
+int janet_core_is_type(JanetCFunction f) {
+    return f == janet_core_type;
+}
+
 JANET_CORE_FN(janet_core_hash,
               "(hash value)",
               "Gets a hash for any value. The hash is an integer can be used "
@@ -1013,6 +1119,11 @@ static void janet_load_libs(JanetTable *env) {
         JANET_CORE_REG("gccollect", janet_core_gccollect),
         JANET_CORE_REG("gcsetinterval", janet_core_gcsetinterval),
         JANET_CORE_REG("gcinterval", janet_core_gcinterval),
+        JANET_CORE_REG("gcsetsweepstep", janet_core_gcsetsweepstep),
+        JANET_CORE_REG("gcsweepstep", janet_core_gcsweepstep),
+        JANET_CORE_REG("gcsetheaplimit", janet_core_gcsetheaplimit),
+        JANET_CORE_REG("gcheaplimit", janet_core_gcheaplimit),
+        JANET_CORE_REG("gc/stats", janet_core_gcstats),
         JANET_CORE_REG("type", janet_core_type),
         JANET_CORE_REG("hash", janet_core_hash),
         JANET_CORE_REG("getline", janet_core_getline),
@@ -1038,6 +1149,8 @@ static void janet_load_libs(JanetTable *env) {
     janet_lib_buffer(env);
     janet_lib_table(env);
     janet_lib_struct(env);
+    janet_lib_hamt(env);
+    janet_lib_sort(env);
     janet_lib_fiber(env);
     janet_lib_os(env);
     janet_lib_parse(env);
@@ -1051,6 +1164,9 @@ static void janet_load_libs(JanetTable *env) {
 #ifdef JANET_ASSEMBLER
     janet_lib_asm(env);
 #endif
+#ifdef JANET_TYPED_ARRAY
+    janet_lib_typed_array(env);
+#endif
 #ifdef JANET_INT_TYPES
     janet_lib_inttypes(env);
 #endif
@@ -1250,13 +1366,25 @@ JanetTable *janet_core_env(JanetTable *replacements) {
 
     JanetTable *dict = janet_core_lookup_table(replacements);
 
-    /* Unmarshal bytecode */
+    /* Unmarshal bytecode. With threads, all VMs in the process share one copy
+     * of the core bytecode and cfunction registry. */
+#ifdef JANET_EV
+    static JanetImageCode *janet_core_code = NULL;
+    Janet marsh_out = janet_unmarshal_shared(
+                          janet_core_image,
+                          janet_core_image_size,
+                          JANET_MARSHAL_TRUSTED,
+                          dict,
+                          &janet_core_code);
+    janet_registry_share();
+#else
     Janet marsh_out = janet_unmarshal(
                           janet_core_image,
                           janet_core_image_size,
-                          0,
+                          JANET_MARSHAL_TRUSTED,
                           dict,
                           NULL);
+#endif
 
     /* Memoize */
     janet_gcroot(marsh_out);
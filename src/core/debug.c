@@ -26,6 +26,7 @@
 #include "gc.h"
 #include "state.h"
 #include "util.h"
+#include "fiber.h"
 #include "vector.h"
 #endif
 
@@ -37,13 +38,20 @@
 void janet_debug_break(JanetFuncDef *def, int32_t pc) {
     if (pc >= def->bytecode_length || pc < 0)
         janet_panic("invalid bytecode offset");
+    janet_def_unshare(def);
     def->bytecode[pc] |= 0x80;
+#ifdef JANET_JIT
+    /* Native code does not stop at breakpoints */
+    janet_jit_disable(def);
+#endif
 }
 
 /* Remove a break point from a function */
 void janet_debug_unbreak(JanetFuncDef *def, int32_t pc) {
     if (pc >= def->bytecode_length || pc < 0)
         janet_panic("invalid bytecode offset");
+    /* Shared code never has break points */
+    if (def->gc.flags & JANET_FUNCDEF_SHARED_CODE) return;
     def->bytecode[pc] &= ~((uint32_t)0x80);
 }
 
@@ -55,6 +63,7 @@ void janet_debug_find(
     JanetFuncDef **def_out, int32_t *pc_out,
     const uint8_t *source, int32_t sourceLine, int32_t sourceColumn) {
     /* Scan the heap for right func def */
+    janet_gc_sweep_finish();
     JanetGCObject *current = janet_vm.blocks;
     /* Keep track of the best source mapping we have seen so far */
     int32_t besti = -1;
@@ -281,7 +290,10 @@ static Janet doframe(JanetStackFrame *frame) {
     int32_t off;
     JanetTable *t = janet_table(3);
     JanetFuncDef *def = NULL;
+    /* The function and slots of the frame may hold closures over live frames */
+    janet_env_escape(frame->env);
     if (frame->func) {
+        janet_function_escape(frame->func);
         janet_table_put(t, janet_ckeywordv("function"), janet_wrap_function(frame->func));
         def = frame->func->def;
         if (def->name) {
@@ -423,6 +435,546 @@ JANET_CORE_FN(cfun_debug_step,
     return out;
 }
 
+/*
+ * Sampling profiler
+ */
+
+typedef struct {
+    JanetVM *vm;
+    JanetBuffer buffer;
+    JanetStackFrame **frames;
+#ifdef JANET_EV
+    volatile int running;
+    double interval;
+#ifdef JANET_WINDOWS
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+#endif
+} JanetProfiler;
+
+#ifdef JANET_EV
+
+/* Timer thread - periodically asks the profiled vm for a sample */
+#ifdef JANET_WINDOWS
+static DWORD WINAPI janet_profiler_body(LPVOID ptr) {
+    JanetProfiler *prof = (JanetProfiler *)ptr;
+    DWORD ms = (DWORD)(prof->interval * 1000);
+    while (prof->running) {
+        Sleep(ms ? ms : 1);
+        janet_interpreter_sample(prof->vm);
+    }
+    return 0;
+}
+#else
+static void *janet_profiler_body(void *ptr) {
+    JanetProfiler *prof = (JanetProfiler *)ptr;
+    struct timespec ts;
+    ts.tv_sec = (time_t) prof->interval;
+    ts.tv_nsec = (long)((prof->interval - (double) ts.tv_sec) * 1000000000.0);
+    while (prof->running) {
+        struct timespec rem = ts;
+        while (nanosleep(&rem, &rem) == -1 && errno == EINTR);
+        janet_interpreter_sample(prof->vm);
+    }
+    return NULL;
+}
+#endif
+
+#endif
+
+/* Write one frame of a folded stack */
+static void janet_profile_frame(JanetBuffer *buf, JanetStackFrame *frame) {
+    if (frame->func) {
+        JanetFuncDef *def = frame->func->def;
+        janet_buffer_push_cstring(buf, def->name ? (const char *)def->name : "<anonymous>");
+        if (def->source) {
+            janet_buffer_push_u8(buf, ' ');
+            janet_buffer_push_string(buf, def->source);
+        }
+        if (frame->pc && def->sourcemap) {
+            int32_t off = (int32_t)(frame->pc - def->bytecode);
+            janet_formatb(buf, ":%d", def->sourcemap[off].line);
+        }
+    } else {
+        JanetCFunction cfun = (JanetCFunction)(frame->pc);
+        JanetCFunRegistry *reg = cfun ? janet_registry_get(cfun) : NULL;
+        if (NULL != reg && NULL != reg->name) {
+            if (reg->name_prefix) {
+                janet_buffer_push_cstring(buf, reg->name_prefix);
+                janet_buffer_push_u8(buf, '/');
+            }
+            janet_buffer_push_cstring(buf, reg->name);
+        } else {
+            janet_buffer_push_cstring(buf, "<cfunction>");
+        }
+    }
+}
+
+/* Record the stack of the current fiber. Called from the interpreter loop
+ * when janet_vm.profile_sample is set, with the pc of the top frame committed. */
+void janet_profile_sample(void) {
+    janet_vm.profile_sample = 0;
+    JanetProfiler *prof = (JanetProfiler *) janet_vm.profiler;
+    if (NULL == prof || NULL == janet_vm.fiber) return;
+
+    /* Include the fibers that resumed the current fiber if we can reach it
+     * from the root fiber. */
+    JanetFiber *fiber = janet_vm.root_fiber;
+    while (fiber && fiber != janet_vm.fiber) fiber = fiber->child;
+    fiber = fiber ? janet_vm.root_fiber : janet_vm.fiber;
+
+    /* Collect frames outermost first */
+    janet_v_empty(prof->frames);
+    for (; fiber; fiber = fiber->child) {
+        int32_t start = janet_v_count(prof->frames);
+        int32_t i = fiber->frame;
+        while (i > 0) {
+            JanetStackFrame *frame = (JanetStackFrame *)(fiber->data + i - JANET_FRAME_SIZE);
+            janet_v_push(prof->frames, frame);
+            i = frame->prevframe;
+        }
+        for (int32_t lo = start, hi = janet_v_count(prof->frames) - 1; lo < hi; lo++, hi--) {
+            JanetStackFrame *tmp = prof->frames[lo];
+            prof->frames[lo] = prof->frames[hi];
+            prof->frames[hi] = tmp;
+        }
+        if (fiber == janet_vm.fiber) break;
+    }
+    if (0 == janet_v_count(prof->frames)) return;
+
+    /* Build the folded stack. Keys are symbols so that repeated stacks are
+     * found in the symbol cache without a new allocation. */
+    JanetBuffer *buf = &prof->buffer;
+    buf->count = 0;
+    for (int32_t i = 0; i < janet_v_count(prof->frames); i++) {
+        if (i) janet_buffer_push_u8(buf, ';');
+        janet_profile_frame(buf, prof->frames[i]);
+    }
+    Janet key = janet_wrap_symbol(janet_symbol(buf->data, buf->count));
+    Janet count = janet_table_get(janet_vm.profile_samples, key);
+    double n = janet_checktype(count, JANET_NUMBER) ? janet_unwrap_number(count) : 0;
+    janet_table_put(janet_vm.profile_samples, key, janet_wrap_number(n + 1));
+}
+
+/* Stop the profiler and release its resources. Returns the sample table. */
+static JanetTable *janet_profile_stop(void) {
+    JanetProfiler *prof = (JanetProfiler *) janet_vm.profiler;
+    JanetTable *samples = janet_vm.profile_samples;
+    if (NULL == prof) return NULL;
+#ifdef JANET_EV
+    if (prof->running) {
+        prof->running = 0;
+#ifdef JANET_WINDOWS
+        WaitForSingleObject(prof->thread, INFINITE);
+        CloseHandle(prof->thread);
+#else
+        pthread_join(prof->thread, NULL);
+#endif
+    }
+#endif
+    janet_buffer_deinit(&prof->buffer);
+    janet_v_free(prof->frames);
+    janet_free(prof);
+    janet_vm.profiler = NULL;
+    janet_vm.profile_samples = NULL;
+    janet_vm.profile_sample = 0;
+    janet_gcunroot(janet_wrap_table(samples));
+    return samples;
+}
+
+void janet_profile_deinit(void) {
+    janet_profile_stop();
+}
+
+JANET_CORE_FN(cfun_debug_profile_start,
+              "(debug/profile-start &opt interval)",
+              "Start the sampling profiler for the current thread. Every `interval` seconds "
+              "(default 0.001), the stack of the running fiber is recorded at the next function call "
+              "or backwards jump. Samples are collected until `debug/profile-stop` is called. "
+              "An interval of 0 starts the profiler without a timer, so samples are only taken when "
+              "requested with `janet_interpreter_sample` from C. Returns nil.") {
+    janet_arity(argc, 0, 1);
+    double interval = janet_optnumber(argv, argc, 0, 0.001);
+    if (!(interval >= 0)) janet_panicf("expected non-negative interval, got %v", argv[0]);
+    if (NULL != janet_vm.profiler) janet_panic("profiler is already running");
+#ifndef JANET_EV
+    if (interval > 0) janet_panic("profiler timer not supported in this build, use an interval of 0");
+#endif
+    JanetProfiler *prof = janet_malloc(sizeof(JanetProfiler));
+    if (NULL == prof) {
+        JANET_OUT_OF_MEMORY;
+    }
+    prof->vm = &janet_vm;
+    prof->frames = NULL;
+    janet_buffer_init(&prof->buffer, 256);
+#ifdef JANET_EV
+    prof->interval = interval;
+    prof->running = interval > 0;
+    if (prof->running) {
+#ifdef JANET_WINDOWS
+        prof->thread = CreateThread(NULL, 0, janet_profiler_body, prof, 0, NULL);
+        int err = NULL == prof->thread;
+#else
+        int err = pthread_create(&prof->thread, NULL, janet_profiler_body, prof);
+#endif
+        if (err) {
+            janet_buffer_deinit(&prof->buffer);
+            janet_free(prof);
+            janet_panic("failed to start profiler thread");
+        }
+    }
+#endif
+    janet_vm.profile_samples = janet_table(0);
+    janet_gcroot(janet_wrap_table(janet_vm.profile_samples));
+    janet_vm.profiler = prof;
+    return janet_wrap_nil();
+}
+
+JANET_CORE_FN(cfun_debug_profile_stop,
+              "(debug/profile-stop &opt format)",
+              "Stop the sampling profiler started with `debug/profile-start` and return the samples. "
+              "Each sample is a folded stack - a string of frames separated by semicolons, outermost "
+              "first, where each frame is the function name followed by its source file and line. "
+              "By default, returns a table mapping folded stacks to sample counts. If `format` is :folded, "
+              "returns a buffer with one `stack count` line per stack, which can be used directly "
+              "by flame graph tools.") {
+    janet_arity(argc, 0, 1);
+    int folded = 0;
+    if (argc > 0 && !janet_checktype(argv[0], JANET_NIL)) {
+        const uint8_t *format = janet_getkeyword(argv, 0);
+        if (!janet_cstrcmp(format, "folded")) {
+            folded = 1;
+        } else if (janet_cstrcmp(format, "table")) {
+            janet_panicf("unknown profile format %v", argv[0]);
+        }
+    }
+    JanetTable *samples = janet_profile_stop();
+    if (NULL == samples) janet_panic("profiler is not running");
+    if (folded) {
+        JanetBuffer *buffer = janet_buffer(0);
+        for (int32_t i = 0; i < samples->capacity; i++) {
+            JanetKV *kv = samples->data + i;
+            if (janet_checktype(kv->key, JANET_NIL)) continue;
+            janet_buffer_push_string(buffer, janet_unwrap_symbol(kv->key));
+            janet_formatb(buffer, " %d\n", (int32_t) janet_unwrap_number(kv->value));
+        }
+        return janet_wrap_buffer(buffer);
+    }
+    JanetTable *out = janet_table(samples->count);
+    for (int32_t i = 0; i < samples->capacity; i++) {
+        JanetKV *kv = samples->data + i;
+        if (janet_checktype(kv->key, JANET_NIL)) continue;
+        janet_table_put(out, janet_wrap_string(janet_unwrap_symbol(kv->key)), kv->value);
+    }
+    return janet_wrap_table(out);
+}
+
+/*
+ * Tracing
+ */
+
+struct JanetTraceRing {
+    JanetTraceRecord *records;
+    uint32_t mask;
+    uint32_t head; /* Only written by the thread producing events */
+    uint32_t tail; /* Only written by the thread taking events */
+    uint32_t dropped;
+};
+
+#ifdef JANET_EV
+#define janet_trace_load(x) janet_atomic_load_u32(&(x))
+#define janet_trace_store(x, v) janet_atomic_store_u32(&(x), (v))
+#else
+#define janet_trace_load(x) (x)
+#define janet_trace_store(x, v) ((x) = (v))
+#endif
+
+static uint64_t janet_trace_clock(void) {
+#ifdef JANET_GETTIME
+    struct timespec t;
+    janet_gettime(&t, JANET_TIME_MONOTONIC);
+    return (uint64_t) t.tv_sec * 1000000000 + (uint64_t) t.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+/* Build an event and pass it to the trace hook. Callers check that the hook
+ * is set with the janet_trace_event macro. */
+void janet_trace_emit(JanetTraceEventType type, const void *fiber, const void *subject,
+                      const uint8_t *name, int64_t value) {
+    JanetTraceEvent event;
+    event.type = type;
+    event.value = value;
+    event.time = janet_trace_clock();
+    event.fiber = fiber;
+    event.subject = subject;
+    event.name = (const char *) name;
+    janet_vm.trace_hook(&event, janet_vm.trace_data);
+}
+
+/* Install a hook that receives trace events from the current thread, or
+ * remove it if hook is NULL. The hook must not call into the Janet VM. */
+void janet_trace_sethook(JanetTraceHook hook, void *data) {
+    janet_vm.trace_hook = hook;
+    janet_vm.trace_data = data;
+}
+
+/* Create a ring buffer of trace events. The capacity is rounded up to a
+ * power of two. Install it on a thread with
+ * janet_trace_sethook(janet_trace_ring_hook, ring). */
+JanetTraceRing *janet_trace_ring_new(int32_t capacity) {
+    uint32_t cap = 16;
+    while (cap < (uint32_t) capacity && cap < 0x1000000) cap <<= 1;
+    JanetTraceRing *ring = janet_malloc(sizeof(JanetTraceRing));
+    if (NULL == ring) {
+        JANET_OUT_OF_MEMORY;
+    }
+    ring->records = janet_malloc(cap * sizeof(JanetTraceRecord));
+    if (NULL == ring->records) {
+        JANET_OUT_OF_MEMORY;
+    }
+    ring->mask = cap - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+    return ring;
+}
+
+void janet_trace_ring_free(JanetTraceRing *ring) {
+    janet_free(ring->records);
+    janet_free(ring);
+}
+
+/* Trace hook that copies each event into a ring. Events are dropped when the
+ * ring is full, so the traced thread never waits. A ring has one producer and
+ * one consumer, so it should only be installed on one thread, and only one
+ * thread should call janet_trace_ring_pop on it. */
+void janet_trace_ring_hook(const JanetTraceEvent *event, void *data) {
+    JanetTraceRing *ring = (JanetTraceRing *) data;
+    uint32_t head = ring->head;
+    if (head - janet_trace_load(ring->tail) > ring->mask) {
+        janet_trace_store(ring->dropped, ring->dropped + 1);
+        return;
+    }
+    JanetTraceRecord *record = ring->records + (head & ring->mask);
+    record->event = *event;
+    if (NULL != event->name) {
+        size_t len = strlen(event->name);
+        if (len >= JANET_TRACE_NAME_SIZE) len = JANET_TRACE_NAME_SIZE - 1;
+        memcpy(record->name, event->name, len);
+        record->name[len] = '\0';
+    }
+    janet_trace_store(ring->head, head + 1);
+}
+
+/* Take the oldest event from a ring. Returns 0 if the ring is empty. */
+int janet_trace_ring_pop(JanetTraceRing *ring, JanetTraceRecord *record) {
+    uint32_t tail = ring->tail;
+    if (tail == janet_trace_load(ring->head)) return 0;
+    *record = ring->records[tail & ring->mask];
+    if (NULL != record->event.name) record->event.name = record->name;
+    janet_trace_store(ring->tail, tail + 1);
+    return 1;
+}
+
+/* Number of events dropped because the ring was full */
+uint32_t janet_trace_ring_dropped(JanetTraceRing *ring) {
+    return janet_trace_load(ring->dropped);
+}
+
+void janet_trace_deinit(void) {
+    janet_vm.trace_hook = NULL;
+    janet_vm.trace_data = NULL;
+    if (NULL != janet_vm.trace_ring) {
+        janet_trace_ring_free(janet_vm.trace_ring);
+        janet_vm.trace_ring = NULL;
+    }
+}
+
+static const char *const janet_trace_type_names[] = {
+    "call",
+    "return",
+    "spawn",
+    "resume",
+    "yield",
+    "gc-begin",
+    "gc-end",
+    "listen",
+    "unlisten"
+};
+
+static void janet_trace_json_string(JanetBuffer *buf, const char *str) {
+    janet_buffer_push_u8(buf, '"');
+    for (; *str; str++) {
+        uint8_t c = (uint8_t) *str;
+        if (c == '"' || c == '\\') {
+            janet_buffer_push_u8(buf, '\\');
+            janet_buffer_push_u8(buf, c);
+        } else if (c < 0x20) {
+            janet_formatb(buf, "\\u%04x", c);
+        } else {
+            janet_buffer_push_u8(buf, c);
+        }
+    }
+    janet_buffer_push_u8(buf, '"');
+}
+
+/* Number fibers in the order they first appear, as Chrome trace thread ids */
+static int32_t janet_trace_fiber_id(JanetTable *ids, const void *fiber) {
+    if (NULL == fiber) return 0;
+    Janet key = janet_wrap_pointer((void *) fiber);
+    Janet id = janet_table_get(ids, key);
+    if (janet_checktype(id, JANET_NIL)) {
+        id = janet_wrap_integer(ids->count + 1);
+        janet_table_put(ids, key, id);
+    }
+    return janet_unwrap_integer(id);
+}
+
+/* Write one event in the Chrome trace event format */
+static void janet_trace_chrome(JanetBuffer *buf, JanetTable *ids, const JanetTraceEvent *event) {
+    const char *name = janet_trace_type_names[event->type];
+    const char *cat = "ev";
+    const char *ph = "i";
+    switch (event->type) {
+        case JANET_TRACE_CALL:
+        case JANET_TRACE_RETURN:
+            name = event->name ? event->name : "<anonymous>";
+            cat = "function";
+            ph = event->type == JANET_TRACE_CALL ? "B" : "E";
+            break;
+        case JANET_TRACE_GC_BEGIN:
+        case JANET_TRACE_GC_END:
+            name = "gc";
+            cat = "gc";
+            ph = event->type == JANET_TRACE_GC_BEGIN ? "B" : "E";
+            break;
+        default:
+            break;
+    }
+    janet_buffer_push_cstring(buf, "{\"name\":");
+    janet_trace_json_string(buf, name);
+    janet_formatb(buf, ",\"cat\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%d",
+                  cat, ph, (double) event->time / 1000.0, janet_trace_fiber_id(ids, event->fiber));
+    switch (event->type) {
+        default:
+            break;
+        case JANET_TRACE_FIBER_SPAWN:
+            janet_formatb(buf, ",\"s\":\"t\",\"args\":{\"fiber\":%d}", janet_trace_fiber_id(ids, event->subject));
+            break;
+        case JANET_TRACE_FIBER_RESUME:
+        case JANET_TRACE_FIBER_YIELD:
+            janet_formatb(buf, ",\"s\":\"t\",\"args\":{\"signal\":\"%s\"}",
+                          janet_signal_names[event->value]);
+            break;
+        case JANET_TRACE_LISTEN:
+        case JANET_TRACE_UNLISTEN:
+            janet_formatb(buf, ",\"s\":\"t\",\"args\":{\"mask\":%d}", (int) event->value);
+            break;
+        case JANET_TRACE_GC_BEGIN:
+        case JANET_TRACE_GC_END:
+            janet_formatb(buf, ",\"args\":{\"heap-live\":%.0f}", (double) event->value);
+            break;
+    }
+    janet_buffer_push_u8(buf, '}');
+}
+
+/* Returns 1 if events should be formatted as a Chrome trace */
+static int janet_trace_getformat(int32_t argc, Janet *argv) {
+    janet_arity(argc, 0, 1);
+    if (argc == 0 || janet_checktype(argv[0], JANET_NIL)) return 0;
+    const uint8_t *format = janet_getkeyword(argv, 0);
+    if (!janet_cstrcmp(format, "chrome")) return 1;
+    if (janet_cstrcmp(format, "array")) janet_panicf("unknown trace format %v", argv[0]);
+    return 0;
+}
+
+/* Take all events from a ring */
+static Janet janet_trace_take(JanetTraceRing *ring, int chrome) {
+    JanetTraceRecord record;
+    if (chrome) {
+        JanetBuffer *buf = janet_buffer(1024);
+        JanetTable *ids = janet_table(0);
+        int first = 1;
+        janet_buffer_push_cstring(buf, "{\"traceEvents\":[");
+        while (janet_trace_ring_pop(ring, &record)) {
+            if (!first) janet_buffer_push_u8(buf, ',');
+            first = 0;
+            janet_trace_chrome(buf, ids, &record.event);
+        }
+        janet_formatb(buf, "],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":%.0f}}",
+                      (double) janet_trace_ring_dropped(ring));
+        return janet_wrap_buffer(buf);
+    }
+    JanetArray *events = janet_array(0);
+    while (janet_trace_ring_pop(ring, &record)) {
+        const JanetTraceEvent *event = &record.event;
+        int is_signal = event->type == JANET_TRACE_FIBER_RESUME || event->type == JANET_TRACE_FIBER_YIELD;
+        JanetKV *st = janet_struct_begin(3 + (NULL != event->name) + (NULL != event->fiber) + (NULL != event->subject));
+        janet_struct_put(st, janet_ckeywordv("type"), janet_ckeywordv(janet_trace_type_names[event->type]));
+        janet_struct_put(st, janet_ckeywordv("time"), janet_wrap_number((double) event->time));
+        janet_struct_put(st, janet_ckeywordv("value"), is_signal
+                         ? janet_ckeywordv(janet_signal_names[event->value])
+                         : janet_wrap_number((double) event->value));
+        if (event->fiber) janet_struct_put(st, janet_ckeywordv("fiber"), janet_wrap_pointer((void *) event->fiber));
+        if (event->subject) janet_struct_put(st, janet_ckeywordv("subject"), janet_wrap_pointer((void *) event->subject));
+        if (event->name) janet_struct_put(st, janet_ckeywordv("name"), janet_cstringv(event->name));
+        janet_array_push(events, janet_wrap_struct(janet_struct_end(st)));
+    }
+    return janet_wrap_array(events);
+}
+
+JANET_CORE_FN(cfun_debug_trace_start,
+              "(debug/trace-start &opt capacity)",
+              "Start recording trace events on the current thread in a ring buffer of up to `capacity` "
+              "events (default 65536). Calls to and returns from functions marked with `trace` are "
+              "recorded instead of printed, along with fibers spawned and resumed by the event loop, "
+              "garbage collections, and event listeners. When the buffer is full, new events are "
+              "dropped until events are taken with `debug/trace-events`. Returns nil.") {
+    janet_arity(argc, 0, 1);
+    int32_t capacity = janet_optnat(argv, argc, 0, 65536);
+    if (capacity < 1 || capacity > 0x1000000) {
+        janet_panicf("expected capacity between 1 and %d, got %v", 0x1000000, argv[0]);
+    }
+    if (NULL != janet_vm.trace_ring) janet_panic("tracing is already running");
+    if (NULL != janet_vm.trace_hook) janet_panic("a trace hook is already installed");
+    janet_vm.trace_ring = janet_trace_ring_new(capacity);
+    janet_trace_sethook(janet_trace_ring_hook, janet_vm.trace_ring);
+    return janet_wrap_nil();
+}
+
+JANET_CORE_FN(cfun_debug_trace_events,
+              "(debug/trace-events &opt format)",
+              "Take the events recorded since `debug/trace-start` or the last call to `debug/trace-events`. "
+              "By default, returns an array of structs with the keys :type, :time in nanoseconds "
+              "of a monotonic clock, :value, :fiber for the fiber that was running, :subject for the "
+              "function, fiber, or stream the event is about, and :name for function calls and returns. "
+              "The :value is the argument count of a call, the signal of a fiber resume or yield, the "
+              "live heap size in bytes for garbage collections, and the event mask of a listener. "
+              "Fibers and subjects are pointers that identify objects, and may not be live. "
+              "If format is :chrome, returns a buffer of JSON in the Chrome trace event format, which "
+              "can be opened with Perfetto or chrome://tracing.") {
+    int chrome = janet_trace_getformat(argc, argv);
+    if (NULL == janet_vm.trace_ring) janet_panic("tracing is not running");
+    return janet_trace_take(janet_vm.trace_ring, chrome);
+}
+
+JANET_CORE_FN(cfun_debug_trace_stop,
+              "(debug/trace-stop &opt format)",
+              "Stop recording trace events started with `debug/trace-start`, and return the events "
+              "not yet taken in the same format as `debug/trace-events`.") {
+    int chrome = janet_trace_getformat(argc, argv);
+    if (NULL == janet_vm.trace_ring) janet_panic("tracing is not running");
+    janet_trace_sethook(NULL, NULL);
+    Janet out = janet_trace_take(janet_vm.trace_ring, chrome);
+    janet_trace_ring_free(janet_vm.trace_ring);
+    janet_vm.trace_ring = NULL;
+    return out;
+}
+
 /* Module entry point */
 void janet_lib_debug(JanetTable *env) {
     JanetRegExt debug_cfuns[] = {
@@ -435,6 +987,11 @@ void janet_lib_debug(JanetTable *env) {
         JANET_CORE_REG("debug/stacktrace", cfun_debug_stacktrace),
         JANET_CORE_REG("debug/lineage", cfun_debug_lineage),
         JANET_CORE_REG("debug/step", cfun_debug_step),
+        JANET_CORE_REG("debug/profile-start", cfun_debug_profile_start),
+        JANET_CORE_REG("debug/profile-stop", cfun_debug_profile_stop),
+        JANET_CORE_REG("debug/trace-start", cfun_debug_trace_start),
+        JANET_CORE_REG("debug/trace-events", cfun_debug_trace_events),
+        JANET_CORE_REG("debug/trace-stop", cfun_debug_trace_stop),
         JANET_REG_END
     };
     janet_core_cfuns_ext(env, NULL, debug_cfuns);
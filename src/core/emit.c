@@ -335,3 +335,145 @@ int32_t janetc_emit_sss(JanetCompiler *c, uint8_t op, JanetSlot s1, JanetSlot s2
     janetc_free_regnear(c, s1, reg1, JANETC_REGTEMP_0);
     return label;
 }
+
+/* Check if calls to def with argc arguments can be replaced by its body. Only
+ * functions with a fixed arity that do not make closures, use upvalues or
+ * refer to themselves qualify. */
+int janetc_can_inline(JanetFuncDef *def, int32_t argc, int32_t max_length) {
+    if (def->bytecode_length == 0 || def->bytecode_length > max_length) return 0;
+    if (def->flags & (JANET_FUNCDEF_FLAG_VARARG | JANET_FUNCDEF_FLAG_STRUCTARG | JANET_FUNCDEF_FLAG_NEEDSENV)) return 0;
+    if (def->arity != argc || def->min_arity != argc || def->max_arity != argc) return 0;
+    if (def->defs_length || def->environments_length || def->closure_bitset) return 0;
+    if (def->slotcount > 0xFF) return 0;
+    for (int32_t i = 0; i < def->bytecode_length; i++) {
+        switch (janet_bytecode_unfuse(def->bytecode[i]) & 0x7F) {
+            case JOP_LOAD_SELF:
+            case JOP_LOAD_UPVALUE:
+            case JOP_SET_UPVALUE:
+            case JOP_CLOSURE:
+                return 0;
+            default:
+                break;
+        }
+    }
+    return 1;
+}
+
+static int janetc_inline_exit(uint32_t op) {
+    return op == JOP_RETURN || op == JOP_RETURN_NIL || op == JOP_TAILCALL;
+}
+
+/* Emit the body of def in place of a call to it, with the result in dest. Each
+ * slot of def gets a fresh near register. Returns 0 without emitting anything if
+ * there are not enough near registers. */
+int janetc_emit_inline(JanetCompiler *c, JanetFuncDef *def, JanetSlot *args, JanetSlot dest) {
+    int32_t n = def->bytecode_length;
+    int32_t *regs = janet_smalloc(sizeof(int32_t) * (size_t)(def->slotcount + 1));
+    int32_t *pos = janet_smalloc(sizeof(int32_t) * (size_t)(n + 1));
+
+    /* Registers for the slots of def, and one for the result */
+    int32_t nregs = 0;
+    int near_dest = dest.envindex < 0 && dest.index >= 0 && dest.index <= 0xFF;
+    while (nregs < def->slotcount + (near_dest ? 0 : 1)) {
+        int32_t reg = janetc_regalloc_1(&c->scope->ra);
+        regs[nregs++] = reg;
+        if (reg > 0xFF) {
+            for (int32_t i = 0; i < nregs; i++) janetc_regalloc_free(&c->scope->ra, regs[i]);
+            janet_sfree(regs);
+            janet_sfree(pos);
+            return 0;
+        }
+    }
+    uint32_t res = (uint32_t)(near_dest ? dest.index : regs[def->slotcount]);
+
+    /* Arguments go in the first slots */
+    for (int32_t i = 0; i < def->arity; i++) {
+        JanetSlot param;
+        param.flags = JANET_SLOTTYPE_ANY;
+        param.index = regs[i];
+        param.envindex = -1;
+        param.constant = janet_wrap_nil();
+        janetc_copy(c, param, args[i]);
+    }
+
+    /* Exits become a write to the result and a jump to the end */
+    int32_t at = 0;
+    for (int32_t i = 0; i < n; i++) {
+        pos[i] = at;
+        at += (janetc_inline_exit(def->bytecode[i] & 0x7F) && i != n - 1) ? 2 : 1;
+    }
+    pos[n] = at;
+
+#define RA ((uint32_t) regs[(instr >> 8) & 0xFF] << 8)
+#define RB ((uint32_t) regs[(instr >> 16) & 0xFF] << 16)
+#define RC ((uint32_t) regs[instr >> 24] << 24)
+    for (int32_t i = 0; i < n; i++) {
+        /* Break points stay with the original */
+        uint32_t instr = janet_bytecode_unfuse(def->bytecode[i] & ~0x80u);
+        uint32_t op = instr & 0x7F;
+        if (op == JOP_RETURN) {
+            janetc_emit(c, JOP_MOVE_NEAR | (res << 8) | ((uint32_t) regs[instr >> 8] << 16));
+        } else if (op == JOP_RETURN_NIL) {
+            janetc_emit(c, JOP_LOAD_NIL | (res << 8));
+        } else if (op == JOP_TAILCALL) {
+            janetc_emit(c, JOP_CALL | (res << 8) | ((uint32_t) regs[instr >> 8] << 16));
+        } else {
+            switch (janet_instructions[op]) {
+                default:
+                    break;
+                case JINT_L: {
+                    int32_t target = i + (((int32_t) instr) >> 8);
+                    instr = op | ((uint32_t)(pos[target] - pos[i]) << 8);
+                    break;
+                }
+                case JINT_SL: {
+                    int32_t target = i + (((int32_t) instr) >> 16);
+                    instr = op | RA | ((uint32_t)(pos[target] - pos[i]) << 16);
+                    break;
+                }
+                case JINT_S:
+                    instr = op | ((uint32_t) regs[instr >> 8] << 8);
+                    break;
+                case JINT_ST:
+                case JINT_SI:
+                case JINT_SU:
+                    instr = op | RA | (instr & 0xFFFF0000u);
+                    break;
+                case JINT_SC:
+                    instr = op | RA | ((uint32_t) janetc_const(c, def->constants[instr >> 16]) << 16);
+                    break;
+                case JINT_SS:
+                    instr = op | RA | ((uint32_t) regs[instr >> 16] << 16);
+                    break;
+                case JINT_SSI:
+                case JINT_SSU:
+                    instr = op | RA | RB | (instr & 0xFF000000u);
+                    break;
+                case JINT_SSS:
+                    instr = op | RA | RB | RC;
+                    break;
+            }
+            janetc_emit(c, instr);
+            continue;
+        }
+        if (i != n - 1) {
+            janetc_emit(c, JOP_JUMP | ((uint32_t)(pos[n] - pos[i] - 1) << 8));
+        }
+    }
+#undef RA
+#undef RB
+#undef RC
+
+    if (!near_dest) {
+        JanetSlot result;
+        result.flags = JANET_SLOTTYPE_ANY;
+        result.index = (int32_t) res;
+        result.envindex = -1;
+        result.constant = janet_wrap_nil();
+        janetc_copy(c, dest, result);
+    }
+    for (int32_t i = 0; i < nregs; i++) janetc_regalloc_free(&c->scope->ra, regs[i]);
+    janet_sfree(regs);
+    janet_sfree(pos);
+    return 1;
+}
@@ -48,4 +48,8 @@ int janetc_sequal(JanetSlot x, JanetSlot y);
 /* Move value from one slot to another. Cannot copy to constant slots. */
 void janetc_copy(JanetCompiler *c, JanetSlot dest, JanetSlot src);
 
+/* Replace calls to small functions with their bodies */
+int janetc_can_inline(JanetFuncDef *def, int32_t argc, int32_t max_length);
+int janetc_emit_inline(JanetCompiler *c, JanetFuncDef *def, JanetSlot *args, JanetSlot dest);
+
 #endif
@@ -35,6 +35,10 @@
 #ifdef JANET_WINDOWS
 #include <winsock2.h>
 #include <windows.h>
+#include <io.h>
+#ifdef JANET_NET
+#include <mswsock.h>
+#endif
 #else
 #include <pthread.h>
 #include <limits.h>
@@ -49,10 +53,25 @@
 #include <netdb.h>
 #include <sys/socket.h>
 #include <sys/wait.h>
+#include <sys/uio.h>
+#include <poll.h>
+#ifdef JANET_LINUX
+#include <sys/sendfile.h>
+#endif
 #ifdef JANET_EV_EPOLL
 #include <sys/epoll.h>
 #include <sys/timerfd.h>
 #endif
+#ifdef JANET_EV_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#ifndef IORING_FEAT_EXT_ARG
+/* Headers are too old for the features we need */
+#undef JANET_EV_URING
+#endif
+#endif
 #ifdef JANET_EV_KQUEUE
 #include <sys/event.h>
 #endif
@@ -67,17 +86,39 @@ typedef struct {
         JANET_CP_MODE_WRITE,
         JANET_CP_MODE_CHOICE_READ,
         JANET_CP_MODE_CHOICE_WRITE,
-        JANET_CP_MODE_CLOSE
+        JANET_CP_MODE_CLOSE,
+        JANET_CP_MODE_READ_MANY
     } mode;
 } JanetChannelPending;
 
+/* A wake up message for a fiber waiting on a threaded channel in another
+ * thread. Wake ups are collected while the channel is locked and posted
+ * after it is unlocked. */
+typedef struct {
+    JanetVM *vm;
+    JanetEVGenericMessage msg;
+} JanetChannelWakeup;
+
+typedef struct JanetSelectSet JanetSelectSet;
+
+/* A select set that is notified when a channel becomes readable */
+typedef struct {
+    JanetSelectSet *set;
+    int32_t index;
+} JanetChannelWatcher;
+
 typedef struct {
     JanetQueue items;
     JanetQueue read_pending;
     JanetQueue write_pending;
+    int32_t read_prune_at;
+    int32_t write_prune_at;
     int32_t limit;
     int closed;
     int is_threaded;
+    JanetChannelWatcher *watchers;
+    int32_t watcher_count;
+    int32_t watcher_capacity;
 #ifdef JANET_WINDOWS
     CRITICAL_SECTION lock;
 #else
@@ -97,15 +138,19 @@ typedef struct {
 typedef struct {
     JanetEVGenericMessage msg;
     JanetThreadedCallback cb;
+    int threaded; /* Result of a threaded call, for ev/stats */
 } JanetSelfPipeEvent;
 
 /* Structure used to initialize threads in the thread pool
  * (same head structure as self pipe event)*/
-typedef struct {
+typedef struct JanetEVThreadInit {
     JanetEVGenericMessage msg;
     JanetThreadedCallback cb;
+    int threaded;
     JanetThreadedSubroutine subr;
     JanetHandle write_pipe;
+    struct JanetEVThreadInit *next;
+    int long_running;
 } JanetEVThreadInit;
 
 #define JANET_MAX_Q_CAPACITY 0x7FFFFFF
@@ -178,6 +223,17 @@ static JanetTimestamp ts_delta(JanetTimestamp ts, double delta) {
     return ts;
 }
 
+/* Timeouts of a second or more that only guard against stuck operations
+ * are rounded up to a multiple of JANET_TIMEOUT_SLACK milliseconds, so that
+ * timeouts set at about the same time expire together and the event loop
+ * wakes up less often. */
+#define JANET_TIMEOUT_SLACK 16
+static JanetTimestamp ts_delta_coarse(JanetTimestamp ts, double delta) {
+    JanetTimestamp when = ts_delta(ts, delta);
+    if (delta < 1.0 || when > INT64_MAX - JANET_TIMEOUT_SLACK) return when;
+    return ((when + JANET_TIMEOUT_SLACK - 1) / JANET_TIMEOUT_SLACK) * JANET_TIMEOUT_SLACK;
+}
+
 /* Look at the next timeout value without
  * removing it. */
 static int peek_timeout(JanetTimeout *out) {
@@ -186,10 +242,8 @@ static int peek_timeout(JanetTimeout *out) {
     return 1;
 }
 
-/* Remove the next timeout from the priority queue */
-static void pop_timeout(size_t index) {
-    if (janet_vm.tq_count <= index) return;
-    janet_vm.tq[index] = janet_vm.tq[--janet_vm.tq_count];
+/* Move a timeout down the heap until both of its children expire later */
+static void sift_down_timeout(size_t index) {
     for (;;) {
         size_t left = (index << 1) + 1;
         size_t right = left + 1;
@@ -208,11 +262,54 @@ static void pop_timeout(size_t index) {
     }
 }
 
+/* Remove the next timeout from the priority queue */
+static void pop_timeout(size_t index) {
+    if (janet_vm.tq_count <= index) return;
+    janet_vm.tq[index] = janet_vm.tq[--janet_vm.tq_count];
+    sift_down_timeout(index);
+}
+
+/* Check if a timeout can no longer fire, either because the fiber has been
+ * rescheduled since the timeout was set, or because the fiber checked by a
+ * deadline has finished. */
+static int timeout_is_stale(JanetTimeout *to) {
+    if (to->curr_fiber != NULL) {
+        return !janet_fiber_can_resume(to->curr_fiber);
+    }
+    return to->fiber->sched_id != to->sched_id;
+}
+
+/* Remove stale timeouts from the heap and rebuild it. Cancelled timeouts are
+ * otherwise only dropped when they reach the top of the heap, so with many
+ * long timeouts the heap would fill up with dead entries. */
+static void compact_timeouts(void) {
+    size_t count = 0;
+    for (size_t i = 0; i < janet_vm.tq_count; i++) {
+        JanetTimeout *to = janet_vm.tq + i;
+        if (timeout_is_stale(to)) {
+            if (to->curr_fiber != NULL) {
+                janet_table_remove(&janet_vm.active_tasks, janet_wrap_fiber(to->curr_fiber));
+            }
+            continue;
+        }
+        janet_vm.tq[count++] = *to;
+    }
+    janet_vm.tq_count = count;
+    /* Heapify bottom up */
+    for (size_t i = count / 2; i-- > 0;) {
+        sift_down_timeout(i);
+    }
+}
+
 /* Add a timeout to the timeout min heap */
 static void add_timeout(JanetTimeout to) {
     size_t oldcount = janet_vm.tq_count;
     size_t newcount = oldcount + 1;
     if (newcount > janet_vm.tq_capacity) {
+        /* Drop stale timeouts, then grow or shrink the heap so it is half full */
+        compact_timeouts();
+        oldcount = janet_vm.tq_count;
+        newcount = oldcount + 1;
         size_t newcap = 2 * newcount;
         JanetTimeout *tq = janet_realloc(janet_vm.tq, newcap * sizeof(JanetTimeout));
         if (NULL == tq) {
@@ -278,6 +375,8 @@ static JanetListenerState *janet_listen_impl(JanetStream *stream, JanetListener
     janet_vm.listeners[index] = state;
     state->_index = index;
 
+    janet_trace_event(JANET_TRACE_LISTEN, state->fiber, stream, NULL, mask);
+
     /* Emit INIT event for convenience */
     state->event = user;
     state->machine(state, JANET_ASYNC_EVENT_INIT);
@@ -287,6 +386,7 @@ static JanetListenerState *janet_listen_impl(JanetStream *stream, JanetListener
 /* Indicate we are no longer listening for an event. This
  * frees the memory of the state machine as well. */
 static void janet_unlisten_impl(JanetListenerState *state, int is_gc) {
+    janet_trace_event(JANET_TRACE_UNLISTEN, state->fiber, state->stream, NULL, state->_mask);
     state->machine(state, JANET_ASYNC_EVENT_DEINIT);
     /* Remove state machine from poll list */
     JanetListenerState **iter = &(state->stream->state);
@@ -325,6 +425,9 @@ JanetStream *janet_stream(JanetHandle handle, uint32_t flags, const JanetMethod
     stream->flags = flags;
     stream->state = NULL;
     stream->_mask = 0;
+#ifdef JANET_EV_URING
+    stream->_slot = -1;
+#endif
     if (methods == NULL) methods = ev_default_stream_methods;
     stream->methods = methods;
     return stream;
@@ -437,6 +540,9 @@ static void *janet_stream_unmarshal(JanetMarshalContext *ctx) {
     /* Can't share listening state and such across threads */
     p->_mask = 0;
     p->state = NULL;
+#ifdef JANET_EV_URING
+    p->_slot = -1;
+#endif
     p->flags = (uint32_t) janet_unmarshal_int(ctx);
     p->methods =  janet_unmarshal_ptr(ctx);
 #ifdef JANET_WINDOWS
@@ -473,6 +579,7 @@ void janet_schedule_signal(JanetFiber *fiber, Janet value, JanetSignal sig) {
     if (!(fiber->gc.flags & JANET_FIBER_FLAG_ROOT)) {
         Janet task_element = janet_wrap_fiber(fiber);
         janet_table_put(&janet_vm.active_tasks, task_element, janet_wrap_true());
+        janet_trace_event(JANET_TRACE_FIBER_SPAWN, janet_vm.fiber, fiber, NULL, 0);
     }
     JanetTask t = { fiber, value, sig, ++fiber->sched_id };
     fiber->gc.flags |= JANET_FIBER_FLAG_ROOT;
@@ -499,6 +606,11 @@ void janet_fiber_did_resume(JanetFiber *fiber) {
 /* Mark all pending tasks */
 void janet_ev_mark(void) {
 
+    /* Slow task hook */
+    if (NULL != janet_vm.ev_stats.slow_hook) {
+        janet_mark(janet_wrap_function(janet_vm.ev_stats.slow_hook));
+    }
+
     /* Pending tasks */
     JanetTask *tasks = janet_vm.spawn.data;
     if (janet_vm.spawn.head <= janet_vm.spawn.tail) {
@@ -563,14 +675,19 @@ void janet_ev_init_common(void) {
     janet_table_init_raw(&janet_vm.threaded_abstracts, 0);
     janet_table_init_raw(&janet_vm.active_tasks, 0);
     janet_rng_seed(&janet_vm.ev_rng, 0);
+    memset(&janet_vm.ev_stats, 0, sizeof(janet_vm.ev_stats));
+    janet_vm.preempt = NULL;
 #ifndef JANET_WINDOWS
     pthread_attr_init(&janet_vm.new_thread_attr);
     pthread_attr_setdetachstate(&janet_vm.new_thread_attr, PTHREAD_CREATE_DETACHED);
 #endif
 }
 
+static void janet_preempt_stop(void);
+
 /* Common deinit code */
 void janet_ev_deinit_common(void) {
+    janet_preempt_stop();
     janet_q_deinit(&janet_vm.spawn);
     janet_free(janet_vm.tq);
     janet_free(janet_vm.listeners);
@@ -592,7 +709,7 @@ void janet_await(void) {
 void janet_addtimeout(double sec) {
     JanetFiber *fiber = janet_vm.root_fiber;
     JanetTimeout to;
-    to.when = ts_delta(ts_now(), sec);
+    to.when = ts_delta_coarse(ts_now(), sec);
     to.fiber = fiber;
     to.curr_fiber = NULL;
     to.sched_id = fiber->sched_id;
@@ -660,10 +777,18 @@ static int janet_chan_unpack(JanetChannel *chan, Janet *x, int is_cleanup) {
     }
 }
 
+/* Minimum number of pending entries before a queue is pruned */
+#define JANET_CHAN_PRUNE_MIN 16
+
 static void janet_chan_init(JanetChannel *chan, int32_t limit, int threaded) {
     chan->limit = limit;
     chan->closed = 0;
     chan->is_threaded = threaded;
+    chan->read_prune_at = JANET_CHAN_PRUNE_MIN;
+    chan->write_prune_at = JANET_CHAN_PRUNE_MIN;
+    chan->watchers = NULL;
+    chan->watcher_count = 0;
+    chan->watcher_capacity = 0;
     janet_q_init(&chan->items);
     janet_q_init(&chan->read_pending);
     janet_q_init(&chan->write_pending);
@@ -695,6 +820,7 @@ static void janet_chan_deinit(JanetChannel *chan) {
         janet_q_deinit(&chan->read_pending);
         janet_q_deinit(&chan->write_pending);
         janet_q_deinit(&chan->items);
+        janet_free(chan->watchers);
     }
     janet_os_mutex_deinit((JanetOSMutex *) &chan->lock);
 }
@@ -732,6 +858,9 @@ static int janet_chanat_mark(void *p, size_t s) {
     JanetChannel *chan = p;
     janet_chanat_mark_fq(&chan->read_pending);
     janet_chanat_mark_fq(&chan->write_pending);
+    for (int32_t i = 0; i < chan->watcher_count; i++) {
+        janet_mark(janet_wrap_abstract(chan->watchers[i].set));
+    }
     JanetQueue *items = &chan->items;
     Janet *data = chan->items.data;
     if (items->head <= items->tail) {
@@ -768,6 +897,37 @@ static Janet make_close_result(JanetChannel *channel) {
     return janet_wrap_tuple(janet_tuple_end(tup));
 }
 
+/* Most events posted with one write to a self-pipe. Small enough that a
+ * batch stays under the minimum PIPE_BUF of 512 bytes, so writes are atomic. */
+#define JANET_EV_POST_BATCH 8
+static void janet_ev_post_events(JanetVM *vm, JanetCallback cb, const JanetEVGenericMessage *msgs, int32_t n);
+static void janet_thread_chan_cb(JanetEVGenericMessage msg);
+
+/* Post wake up messages, with one write for each run of messages to the
+ * same thread. */
+static void janet_chan_post(const JanetChannelWakeup *wakes, int32_t n) {
+    JanetEVGenericMessage batch[JANET_EV_POST_BATCH];
+    int32_t count = 0;
+    for (int32_t i = 0; i < n; i++) {
+        if (NULL == wakes[i].vm) continue;
+        batch[count++] = wakes[i].msg;
+        if (count == JANET_EV_POST_BATCH || i + 1 == n || wakes[i + 1].vm != wakes[i].vm) {
+            janet_ev_post_events(wakes[i].vm, janet_thread_chan_cb, batch, count);
+            count = 0;
+        }
+    }
+}
+
+static void janet_chan_wakeup(JanetChannelWakeup *wake, JanetChannelPending *pending,
+                              JanetChannel *channel, Janet x) {
+    wake->vm = pending->thread;
+    wake->msg.tag = pending->mode;
+    wake->msg.fiber = pending->fiber;
+    wake->msg.argi = (int32_t) pending->sched_id;
+    wake->msg.argp = channel;
+    wake->msg.argj = x;
+}
+
 /* Callback to use for scheduling a fiber from another thread. */
 static void janet_thread_chan_cb(JanetEVGenericMessage msg) {
     uint32_t sched_id = (uint32_t) msg.argi;
@@ -775,70 +935,90 @@ static void janet_thread_chan_cb(JanetEVGenericMessage msg) {
     int mode = msg.tag;
     JanetChannel *channel = (JanetChannel *) msg.argp;
     Janet x = msg.argj;
-    janet_chan_lock(channel);
-    if (fiber->sched_id == sched_id) {
-        if (mode == JANET_CP_MODE_CHOICE_READ) {
-            janet_assert(!janet_chan_unpack(channel, &x, 0), "packing error");
-            janet_schedule(fiber, make_read_result(channel, x));
-        } else if (mode == JANET_CP_MODE_CHOICE_WRITE) {
-            janet_schedule(fiber, make_write_result(channel));
-        } else if (mode == JANET_CP_MODE_READ) {
-            janet_assert(!janet_chan_unpack(channel, &x, 0), "packing error");
-            janet_schedule(fiber, x);
-        } else if (mode == JANET_CP_MODE_WRITE) {
-            janet_schedule(fiber, janet_wrap_channel(channel));
-        } else { /* (mode == JANET_CP_MODE_CLOSE) */
-            janet_schedule(fiber, janet_wrap_nil());
-        }
-    } else if (mode != JANET_CP_MODE_CLOSE) {
+    JanetChannelWakeup wake;
+    wake.vm = NULL;
+    int is_current = fiber->sched_id == sched_id;
+    if (!is_current && mode != JANET_CP_MODE_CLOSE) {
         /* Fiber has already been cancelled or resumed. */
         /* Resend event to another waiting thread, depending on mode */
-        int is_read = (mode == JANET_CP_MODE_CHOICE_READ) || (mode == JANET_CP_MODE_READ);
+        int is_read = (mode == JANET_CP_MODE_CHOICE_READ) ||
+                      (mode == JANET_CP_MODE_READ) ||
+                      (mode == JANET_CP_MODE_READ_MANY);
+        JanetChannelPending pending;
+        janet_chan_lock(channel);
         if (is_read) {
-            JanetChannelPending reader;
-            if (!janet_q_pop(&channel->read_pending, &reader, sizeof(reader))) {
-                JanetVM *vm = reader.thread;
-                JanetEVGenericMessage msg;
-                msg.tag = reader.mode;
-                msg.fiber = reader.fiber;
-                msg.argi = (int32_t) reader.sched_id;
-                msg.argp = channel;
-                msg.argj = x;
-                janet_ev_post_event(vm, janet_thread_chan_cb, msg);
+            if (!janet_q_pop(&channel->read_pending, &pending, sizeof(pending))) {
+                janet_chan_wakeup(&wake, &pending, channel, x);
             }
         } else {
-            JanetChannelPending writer;
-            if (!janet_q_pop(&channel->write_pending, &writer, sizeof(writer))) {
-                JanetVM *vm = writer.thread;
-                JanetEVGenericMessage msg;
-                msg.tag = writer.mode;
-                msg.fiber = writer.fiber;
-                msg.argi = (int32_t) writer.sched_id;
-                msg.argp = channel;
-                msg.argj = janet_wrap_nil();
-                janet_ev_post_event(vm, janet_thread_chan_cb, msg);
+            if (!janet_q_pop(&channel->write_pending, &pending, sizeof(pending))) {
+                janet_chan_wakeup(&wake, &pending, channel, janet_wrap_nil());
             }
         }
+        janet_chan_unlock(channel);
+        janet_chan_post(&wake, 1);
+        return;
+    }
+    if (!is_current) return;
+    /* Unmarshal values outside of the channel lock */
+    if (mode == JANET_CP_MODE_CHOICE_READ) {
+        janet_assert(!janet_chan_unpack(channel, &x, 0), "packing error");
+        janet_schedule(fiber, make_read_result(channel, x));
+    } else if (mode == JANET_CP_MODE_READ) {
+        janet_assert(!janet_chan_unpack(channel, &x, 0), "packing error");
+        janet_schedule(fiber, x);
+    } else if (mode == JANET_CP_MODE_READ_MANY) {
+        janet_assert(!janet_chan_unpack(channel, &x, 0), "packing error");
+        janet_schedule(fiber, janet_wrap_array(janet_array_n(&x, 1)));
+    } else if (mode == JANET_CP_MODE_CHOICE_WRITE) {
+        janet_schedule(fiber, make_write_result(channel));
+    } else if (mode == JANET_CP_MODE_WRITE) {
+        janet_schedule(fiber, janet_wrap_channel(channel));
+    } else { /* (mode == JANET_CP_MODE_CLOSE) */
+        janet_schedule(fiber, janet_wrap_nil());
     }
-    janet_chan_unlock(channel);
 }
 
-/* Push a value to a channel, and return 1 if channel should block, zero otherwise.
- * If the push would block, will add to the write_pending queue in the channel.
- * Handles both threaded and unthreaded channels. */
-static int janet_channel_push_with_lock(JanetChannel *channel, Janet x, int mode) {
+/* Drop pending entries for fibers that were resumed or canceled after they
+ * started waiting, such as the clauses of an ev/select that did not fire.
+ * Only done for channels local to this thread, once the queue has doubled in
+ * size since it was last pruned. */
+static void janet_chan_prune_pending(JanetChannel *channel, JanetQueue *queue, int32_t *prune_at) {
+    if (janet_chan_is_threaded(channel)) return;
+    int32_t count = janet_q_count(queue);
+    if (count < *prune_at) return;
+    JanetChannelPending pending;
+    for (int32_t i = 0; i < count; i++) {
+        janet_q_pop(queue, &pending, sizeof(pending));
+        if (pending.fiber->sched_id == pending.sched_id) {
+            janet_q_push(queue, &pending, sizeof(pending));
+        }
+    }
+    count = janet_q_count(queue);
+    *prune_at = (count * 2 > JANET_CHAN_PRUNE_MIN) ? count * 2 : JANET_CHAN_PRUNE_MIN;
+}
+
+static int janet_select_set_notify(JanetChannel *channel, Janet x, int is_close);
+
+/* Add the current root fiber to one of the pending queues of a channel. */
+static void janet_channel_add_pending(JanetQueue *queue, int mode) {
+    JanetChannelPending pending;
+    pending.thread = &janet_vm;
+    pending.fiber = janet_vm.root_fiber;
+    pending.sched_id = janet_vm.root_fiber->sched_id;
+    pending.mode = mode;
+    janet_q_push(queue, &pending, sizeof(pending));
+}
+
+/* Push a packed value to a channel while holding the channel lock. Returns 1 if
+ * the writer should block and has been added to the write_pending queue, -1 if
+ * the channel overflowed, and 0 otherwise. Writers never block with mode 2. A
+ * reader on another thread is not woken directly, but through *wake. */
+static int janet_channel_push_locked(JanetChannel *channel, Janet x, int mode, JanetChannelWakeup *wake) {
     JanetChannelPending reader;
     int is_empty;
-    if (janet_chan_pack(channel, &x)) {
-        janet_chan_unlock(channel);
-        janet_panicf("failed to pack value for channel: %v", x);
-    }
-    if (channel->closed) {
-        janet_chan_unlock(channel);
-        janet_panic("cannot write to closed channel");
-    }
-    int is_threaded = janet_chan_is_threaded(channel);
-    if (is_threaded) {
+    wake->vm = NULL;
+    if (janet_chan_is_threaded(channel)) {
         /* don't dereference fiber from another thread */
         is_empty = janet_q_pop(&channel->read_pending, &reader, sizeof(reader));
     } else {
@@ -847,103 +1027,129 @@ static int janet_channel_push_with_lock(JanetChannel *channel, Janet x, int mode
         } while (!is_empty && (reader.sched_id != reader.fiber->sched_id));
     }
     if (is_empty) {
-        /* No pending reader */
+        /* No pending reader, but maybe a select set with a waiting fiber */
+        if (channel->watcher_count && janet_select_set_notify(channel, x, 0)) {
+            return 0;
+        }
         if (janet_q_push(&channel->items, &x, sizeof(Janet))) {
-            janet_chan_unlock(channel);
-            janet_panicf("channel overflow: %v", x);
+            return -1;
         } else if (janet_q_count(&channel->items) > channel->limit) {
             /* No root fiber, we are in completion on a root fiber. Don't block. */
-            if (mode == 2) {
-                janet_chan_unlock(channel);
-                return 0;
-            }
+            if (mode == 2) return 0;
             /* Pushed successfully, but should block. */
-            JanetChannelPending pending;
-            pending.thread = &janet_vm;
-            pending.fiber = janet_vm.root_fiber,
-            pending.sched_id = janet_vm.root_fiber->sched_id,
-            pending.mode = mode ? JANET_CP_MODE_CHOICE_WRITE : JANET_CP_MODE_WRITE;
-            janet_q_push(&channel->write_pending, &pending, sizeof(pending));
-            janet_chan_unlock(channel);
-            if (is_threaded) {
-                janet_gcroot(janet_wrap_fiber(pending.fiber));
-            }
+            janet_chan_prune_pending(channel, &channel->write_pending, &channel->write_prune_at);
+            janet_channel_add_pending(&channel->write_pending,
+                                      mode ? JANET_CP_MODE_CHOICE_WRITE : JANET_CP_MODE_WRITE);
             return 1;
         }
-    } else {
+    } else if (janet_chan_is_threaded(channel)) {
         /* Pending reader */
-        if (is_threaded) {
-            JanetVM *vm = reader.thread;
-            JanetEVGenericMessage msg;
-            msg.tag = reader.mode;
-            msg.fiber = reader.fiber;
-            msg.argi = (int32_t) reader.sched_id;
-            msg.argp = channel;
-            msg.argj = x;
-            janet_ev_post_event(vm, janet_thread_chan_cb, msg);
-        } else {
-            if (reader.mode == JANET_CP_MODE_CHOICE_READ) {
-                janet_schedule(reader.fiber, make_read_result(channel, x));
-            } else {
-                janet_schedule(reader.fiber, x);
-            }
-        }
+        janet_chan_wakeup(wake, &reader, channel, x);
+    } else if (reader.mode == JANET_CP_MODE_CHOICE_READ) {
+        janet_schedule(reader.fiber, make_read_result(channel, x));
+    } else if (reader.mode == JANET_CP_MODE_READ_MANY) {
+        janet_schedule(reader.fiber, janet_wrap_array(janet_array_n(&x, 1)));
+    } else {
+        janet_schedule(reader.fiber, x);
     }
-    janet_chan_unlock(channel);
     return 0;
 }
 
+/* Finish a push after the channel has been unlocked. */
+static int janet_channel_push_finish(JanetChannel *channel, Janet x, int status, JanetChannelWakeup *wake) {
+    if (status < 0) {
+        janet_panicf("channel overflow: %v", x);
+    }
+    janet_chan_post(wake, 1);
+    if (status && janet_chan_is_threaded(channel)) {
+        janet_gcroot(janet_wrap_fiber(janet_vm.root_fiber));
+    }
+    return status;
+}
+
+/* Push a value to a channel, and return 1 if channel should block, zero otherwise.
+ * If the push would block, will add to the write_pending queue in the channel.
+ * Handles both threaded and unthreaded channels. Expects the channel to be
+ * locked, and unlocks it. */
+static int janet_channel_push_with_lock(JanetChannel *channel, Janet x, int mode) {
+    JanetChannelWakeup wake;
+    if (janet_chan_pack(channel, &x)) {
+        janet_chan_unlock(channel);
+        janet_panicf("failed to pack value for channel: %v", x);
+    }
+    if (channel->closed) {
+        janet_chan_unlock(channel);
+        janet_panic("cannot write to closed channel");
+    }
+    int status = janet_channel_push_locked(channel, x, mode, &wake);
+    janet_chan_unlock(channel);
+    return janet_channel_push_finish(channel, x, status, &wake);
+}
+
+/* Same as janet_channel_push_with_lock, but values are marshalled before
+ * taking the channel lock. */
 static int janet_channel_push(JanetChannel *channel, Janet x, int mode) {
+    JanetChannelWakeup wake;
+    if (janet_chan_pack(channel, &x)) {
+        janet_panicf("failed to pack value for channel: %v", x);
+    }
     janet_chan_lock(channel);
-    return janet_channel_push_with_lock(channel, x, mode);
+    if (channel->closed) {
+        janet_chan_unlock(channel);
+        janet_chan_unpack(channel, &x, 1);
+        janet_panic("cannot write to closed channel");
+    }
+    int status = janet_channel_push_locked(channel, x, mode, &wake);
+    janet_chan_unlock(channel);
+    return janet_channel_push_finish(channel, x, status, &wake);
 }
 
-/* Pop from a channel - returns 1 if item was obtained, 0 otherwise. The item
- * is returned by reference. If the pop would block, will add to the read_pending
- * queue in the channel. */
-static int janet_channel_pop_with_lock(JanetChannel *channel, Janet *item, int is_choice) {
+/* Pop a packed value from a channel while holding the channel lock. Returns 1
+ * if an item was obtained, otherwise adds the current root fiber to the
+ * read_pending queue with the given mode and returns 0. A writer on another
+ * thread is not woken directly, but through *wake. */
+static int janet_channel_pop_locked(JanetChannel *channel, Janet *item, int mode, JanetChannelWakeup *wake) {
     JanetChannelPending writer;
+    wake->vm = NULL;
     if (channel->closed) {
-        janet_chan_unlock(channel);
         *item = janet_wrap_nil();
         return 1;
     }
-    int is_threaded = janet_chan_is_threaded(channel);
     if (janet_q_pop(&channel->items, item, sizeof(Janet))) {
         /* Queue empty */
-        JanetChannelPending pending;
-        pending.thread = &janet_vm;
-        pending.fiber = janet_vm.root_fiber,
-        pending.sched_id = janet_vm.root_fiber->sched_id;
-        pending.mode = is_choice ? JANET_CP_MODE_CHOICE_READ : JANET_CP_MODE_READ;
-        janet_q_push(&channel->read_pending, &pending, sizeof(pending));
-        janet_chan_unlock(channel);
-        if (is_threaded) {
-            janet_gcroot(janet_wrap_fiber(pending.fiber));
-        }
+        janet_chan_prune_pending(channel, &channel->read_pending, &channel->read_prune_at);
+        janet_channel_add_pending(&channel->read_pending, mode);
         return 0;
     }
-    janet_assert(!janet_chan_unpack(channel, item, 0), "bad channel packing");
     if (!janet_q_pop(&channel->write_pending, &writer, sizeof(writer))) {
         /* Pending writer */
-        if (is_threaded) {
-            JanetVM *vm = writer.thread;
-            JanetEVGenericMessage msg;
-            msg.tag = writer.mode;
-            msg.fiber = writer.fiber;
-            msg.argi = (int32_t) writer.sched_id;
-            msg.argp = channel;
-            msg.argj = janet_wrap_nil();
-            janet_ev_post_event(vm, janet_thread_chan_cb, msg);
+        if (janet_chan_is_threaded(channel)) {
+            janet_chan_wakeup(wake, &writer, channel, janet_wrap_nil());
+        } else if (writer.mode == JANET_CP_MODE_CHOICE_WRITE) {
+            janet_schedule(writer.fiber, make_write_result(channel));
         } else {
-            if (writer.mode == JANET_CP_MODE_CHOICE_WRITE) {
-                janet_schedule(writer.fiber, make_write_result(channel));
-            } else {
-                janet_schedule(writer.fiber, janet_wrap_abstract(channel));
-            }
+            janet_schedule(writer.fiber, janet_wrap_abstract(channel));
         }
     }
+    return 1;
+}
+
+/* Pop from a channel - returns 1 if item was obtained, 0 otherwise. The item
+ * is returned by reference. If the pop would block, will add to the read_pending
+ * queue in the channel. Expects the channel to be locked, and unlocks it. */
+static int janet_channel_pop_with_lock(JanetChannel *channel, Janet *item, int is_choice) {
+    JanetChannelWakeup wake;
+    int mode = is_choice ? JANET_CP_MODE_CHOICE_READ : JANET_CP_MODE_READ;
+    int status = janet_channel_pop_locked(channel, item, mode, &wake);
     janet_chan_unlock(channel);
+    if (!status) {
+        if (janet_chan_is_threaded(channel)) {
+            janet_gcroot(janet_wrap_fiber(janet_vm.root_fiber));
+        }
+        return 0;
+    }
+    janet_assert(!janet_chan_unpack(channel, item, 0), "bad channel packing");
+    janet_chan_post(&wake, 1);
     return 1;
 }
 
@@ -994,6 +1200,101 @@ JANET_CORE_FN(cfun_channel_pop,
     janet_await();
 }
 
+JANET_CORE_FN(cfun_channel_push_many,
+              "(ev/give-many channel values)",
+              "Write each of the indexed `values` to a channel in order. The channel is locked once for all "
+              "of the values, and readers waiting in other threads are woken with one event write per batch. "
+              "Suspends the current fiber once if the channel is full after the writes. "
+              "Returns the channel.") {
+    janet_fixarity(argc, 2);
+    JanetChannel *channel = janet_getchannel(argv, 0);
+    JanetView view = janet_getindexed(argv, 1);
+    if (view.len == 0) return argv[0];
+    Janet *items = janet_smalloc(sizeof(Janet) * (size_t) view.len);
+    JanetChannelWakeup *wakes = janet_smalloc(sizeof(JanetChannelWakeup) * (size_t) view.len);
+    for (int32_t i = 0; i < view.len; i++) {
+        items[i] = view.items[i];
+        if (janet_chan_pack(channel, items + i)) {
+            janet_panicf("failed to pack value for channel: %v", view.items[i]);
+        }
+    }
+    janet_chan_lock(channel);
+    if (channel->closed) {
+        janet_chan_unlock(channel);
+        for (int32_t i = 0; i < view.len; i++) {
+            janet_chan_unpack(channel, items + i, 1);
+        }
+        janet_panic("cannot write to closed channel");
+    }
+    int32_t nwakes = 0;
+    for (int32_t i = 0; i < view.len; i++) {
+        if (janet_channel_push_locked(channel, items[i], 2, wakes + nwakes) < 0) {
+            janet_chan_unlock(channel);
+            janet_chan_post(wakes, nwakes);
+            janet_panicf("channel overflow: %v", view.items[i]);
+        }
+        if (NULL != wakes[nwakes].vm) nwakes++;
+    }
+    int should_block = janet_q_count(&channel->items) > channel->limit;
+    if (should_block) {
+        janet_channel_add_pending(&channel->write_pending, JANET_CP_MODE_WRITE);
+    }
+    janet_chan_unlock(channel);
+    janet_chan_post(wakes, nwakes);
+    janet_sfree(wakes);
+    janet_sfree(items);
+    if (should_block) {
+        if (janet_chan_is_threaded(channel)) {
+            janet_gcroot(janet_wrap_fiber(janet_vm.root_fiber));
+        }
+        janet_await();
+    }
+    return argv[0];
+}
+
+JANET_CORE_FN(cfun_channel_pop_many,
+              "(ev/take-many channel n)",
+              "Read up to `n` values that are waiting in a channel into a new array, locking the channel once. "
+              "If no values are waiting, suspends the current fiber until one is written, and returns an "
+              "array of that value. Returns nil if the channel is closed.") {
+    janet_fixarity(argc, 2);
+    JanetChannel *channel = janet_getchannel(argv, 0);
+    int32_t n = janet_getnat(argv, 1);
+    if (n == 0) return janet_wrap_array(janet_array(0));
+    janet_chan_lock(channel);
+    if (channel->closed) {
+        janet_chan_unlock(channel);
+        return janet_wrap_nil();
+    }
+    int32_t count = janet_q_count(&channel->items);
+    if (count == 0) {
+        Janet item;
+        JanetChannelWakeup wake;
+        janet_channel_pop_locked(channel, &item, JANET_CP_MODE_READ_MANY, &wake);
+        janet_chan_unlock(channel);
+        if (janet_chan_is_threaded(channel)) {
+            janet_gcroot(janet_wrap_fiber(janet_vm.root_fiber));
+        }
+        janet_await();
+    }
+    if (count > n) count = n;
+    JanetArray *array = janet_array(count);
+    JanetChannelWakeup *wakes = janet_smalloc(sizeof(JanetChannelWakeup) * (size_t) count);
+    int32_t nwakes = 0;
+    for (int32_t i = 0; i < count; i++) {
+        janet_channel_pop_locked(channel, array->data + i, JANET_CP_MODE_READ, wakes + nwakes);
+        if (NULL != wakes[nwakes].vm) nwakes++;
+    }
+    array->count = count;
+    janet_chan_unlock(channel);
+    for (int32_t i = 0; i < count; i++) {
+        janet_assert(!janet_chan_unpack(channel, array->data + i, 0), "bad channel packing");
+    }
+    janet_chan_post(wakes, nwakes);
+    janet_sfree(wakes);
+    return janet_wrap_array(array);
+}
+
 static void chan_unlock_args(const Janet *argv, int32_t n) {
     for (int32_t i = 0; i < n; i++) {
         int32_t len;
@@ -1194,67 +1495,297 @@ JANET_CORE_FN(cfun_channel_close,
                 }
             }
         }
+        if (channel->watcher_count) {
+            janet_select_set_notify(channel, janet_wrap_nil(), 1);
+        }
     }
     janet_chan_unlock(channel);
     return argv[0];
 }
 
-static const JanetMethod ev_chanat_methods[] = {
-    {"select", cfun_channel_choice},
-    {"rselect", cfun_channel_rchoice},
-    {"count", cfun_channel_count},
-    {"take", cfun_channel_pop},
-    {"give", cfun_channel_push},
-    {"capacity", cfun_channel_capacity},
-    {"full", cfun_channel_full},
-    {"close", cfun_channel_close},
-    {NULL, NULL}
-};
+/*
+ * Select sets
+ */
 
-static int janet_chanat_get(void *p, Janet key, Janet *out) {
-    (void) p;
-    if (!janet_checktype(key, JANET_KEYWORD)) return 0;
-    return janet_getmethod(janet_unwrap_keyword(key), ev_chanat_methods, out);
-}
+/* A fixed set of channels that a fiber can wait on repeatedly. The set is
+ * registered with each channel once, and channels push their index onto the
+ * ready queue when a value arrives, so waiting does not scan every channel. */
+struct JanetSelectSet {
+    JanetChannel **channels;
+    uint8_t *queued;
+    int32_t count;
+    int closed;
+    JanetQueue ready;
+    JanetFiber *fiber;
+    uint32_t sched_id;
+};
 
-static Janet janet_chanat_next(void *p, Janet key) {
-    (void) p;
-    return janet_nextmethod(ev_chanat_methods, key);
+static int janet_select_set_gc(void *p, size_t s) {
+    (void) s;
+    JanetSelectSet *set = p;
+    janet_free(set->channels);
+    janet_free(set->queued);
+    janet_q_deinit(&set->ready);
+    return 0;
 }
 
-static void janet_chanat_marshal(void *p, JanetMarshalContext *ctx) {
-    JanetChannel *channel = (JanetChannel *)p;
-    janet_marshal_abstract(ctx, channel);
-    janet_marshal_byte(ctx, channel->closed);
-    janet_marshal_int(ctx, channel->limit);
-    int32_t count = janet_q_count(&channel->items);
-    janet_marshal_int(ctx, count);
-    JanetQueue *items = &channel->items;
-    Janet *data = channel->items.data;
-    if (items->head <= items->tail) {
-        for (int32_t i = items->head; i < items->tail; i++)
-            janet_marshal_janet(ctx, data[i]);
-    } else {
-        for (int32_t i = items->head; i < items->capacity; i++)
-            janet_marshal_janet(ctx, data[i]);
-        for (int32_t i = 0; i < items->tail; i++)
-            janet_marshal_janet(ctx, data[i]);
+static int janet_select_set_mark(void *p, size_t s) {
+    (void) s;
+    JanetSelectSet *set = p;
+    for (int32_t i = 0; i < set->count; i++) {
+        janet_mark(janet_wrap_abstract(set->channels[i]));
     }
-}
-
-static void *janet_chanat_unmarshal(JanetMarshalContext *ctx) {
-    JanetChannel *abst = janet_unmarshal_abstract(ctx, sizeof(JanetChannel));
-    uint8_t is_closed = janet_unmarshal_byte(ctx);
-    int32_t limit = janet_unmarshal_int(ctx);
-    int32_t count = janet_unmarshal_int(ctx);
-    if (count < 0) janet_panic("invalid negative channel count");
-    janet_chan_init(abst, limit, 0);
-    abst->closed = !!is_closed;
-    for (int32_t i = 0; i < count; i++) {
-        Janet item = janet_unmarshal_janet(ctx);
-        janet_q_push(&abst->items, &item, sizeof(item));
+    if (NULL != set->fiber) {
+        janet_mark(janet_wrap_fiber(set->fiber));
     }
-    return abst;
+    return 0;
+}
+
+static int janet_select_set_get(void *p, Janet key, Janet *out);
+static Janet janet_select_set_next(void *p, Janet key);
+
+static const JanetAbstractType janet_select_set_type = {
+    "core/select-set",
+    janet_select_set_gc,
+    janet_select_set_mark,
+    janet_select_set_get,
+    NULL, /* put */
+    NULL, /* marshal */
+    NULL, /* unmarshal */
+    NULL, /* tostring */
+    NULL, /* compare */
+    NULL, /* hash */
+    janet_select_set_next,
+    JANET_ATEND_NEXT
+};
+
+/* Check for a fiber waiting on the set that has not since been resumed or canceled. */
+static int janet_select_set_waiting(JanetSelectSet *set) {
+    if (NULL != set->fiber && set->fiber->sched_id != set->sched_id) {
+        set->fiber = NULL;
+    }
+    return NULL != set->fiber;
+}
+
+static void janet_select_set_queue(JanetSelectSet *set, int32_t index) {
+    if (set->queued[index]) return;
+    set->queued[index] = 1;
+    janet_q_push(&set->ready, &index, sizeof(index));
+}
+
+/* Notify the select sets watching a channel that a value was written with no
+ * pending reader, or that the channel was closed. A written value is handed
+ * directly to a fiber waiting on one of the sets, in which case this returns 1.
+ * Otherwise the channel is queued as ready in each set. */
+static int janet_select_set_notify(JanetChannel *channel, Janet x, int is_close) {
+    if (is_close) {
+        for (int32_t i = 0; i < channel->watcher_count; i++) {
+            JanetChannelWatcher watcher = channel->watchers[i];
+            if (janet_select_set_waiting(watcher.set)) {
+                janet_schedule(watcher.set->fiber, make_close_result(channel));
+                watcher.set->fiber = NULL;
+            } else {
+                janet_select_set_queue(watcher.set, watcher.index);
+            }
+        }
+        return 0;
+    }
+    for (int32_t i = 0; i < channel->watcher_count; i++) {
+        JanetSelectSet *set = channel->watchers[i].set;
+        if (janet_select_set_waiting(set)) {
+            janet_schedule(set->fiber, make_read_result(channel, x));
+            set->fiber = NULL;
+            return 1;
+        }
+    }
+    for (int32_t i = 0; i < channel->watcher_count; i++) {
+        JanetChannelWatcher watcher = channel->watchers[i];
+        janet_select_set_queue(watcher.set, watcher.index);
+    }
+    return 0;
+}
+
+static void janet_select_set_unregister(JanetSelectSet *set) {
+    for (int32_t i = 0; i < set->count; i++) {
+        JanetChannel *chan = set->channels[i];
+        int32_t j = 0;
+        for (int32_t k = 0; k < chan->watcher_count; k++) {
+            if (chan->watchers[k].set != set) {
+                chan->watchers[j++] = chan->watchers[k];
+            }
+        }
+        chan->watcher_count = j;
+    }
+}
+
+JANET_CORE_FN(cfun_select_set_new,
+              "(ev/select-set & channels)",
+              "Create a select set that reads from a fixed group of channels. Use `ev/select-take` "
+              "to wait on the set. Unlike `ev/select`, the set is registered with each channel "
+              "once, and channels notify the set when values arrive, so waiting on a set of "
+              "thousands of channels does not scan each of them. Threaded channels are not "
+              "supported. Close the set with `ev/select-close` when it is no longer needed.") {
+    for (int32_t i = 0; i < argc; i++) {
+        JanetChannel *chan = janet_getchannel(argv, i);
+        if (janet_chan_is_threaded(chan)) {
+            janet_panicf("bad slot #%d, select sets do not support threaded channels", i);
+        }
+    }
+    JanetSelectSet *set = janet_abstract(&janet_select_set_type, sizeof(JanetSelectSet));
+    set->count = 0;
+    set->closed = 0;
+    set->fiber = NULL;
+    set->sched_id = 0;
+    janet_q_init(&set->ready);
+    set->channels = janet_malloc(sizeof(JanetChannel *) * (size_t)(argc ? argc : 1));
+    set->queued = janet_calloc((size_t)(argc ? argc : 1), 1);
+    if (NULL == set->channels || NULL == set->queued) {
+        JANET_OUT_OF_MEMORY;
+    }
+    for (int32_t i = 0; i < argc; i++) {
+        JanetChannel *chan = janet_getchannel(argv, i);
+        set->channels[i] = chan;
+        if (chan->watcher_count == chan->watcher_capacity) {
+            int32_t newcap = chan->watcher_capacity ? chan->watcher_capacity * 2 : 1;
+            JanetChannelWatcher *watchers = janet_realloc(chan->watchers, sizeof(JanetChannelWatcher) * (size_t) newcap);
+            if (NULL == watchers) {
+                JANET_OUT_OF_MEMORY;
+            }
+            chan->watchers = watchers;
+            chan->watcher_capacity = newcap;
+        }
+        chan->watchers[chan->watcher_count].set = set;
+        chan->watchers[chan->watcher_count].index = i;
+        chan->watcher_count++;
+        set->count++;
+        if (chan->closed || janet_q_count(&chan->items) > 0) {
+            janet_select_set_queue(set, i);
+        }
+    }
+    return janet_wrap_abstract(set);
+}
+
+JANET_CORE_FN(cfun_select_set_take,
+              "(ev/select-take set)",
+              "Take a value from whichever channel in a select set has one, blocking until a value "
+              "is written if none are waiting. Returns a tuple [:take chan x], or [:close chan] the "
+              "first time a channel in the set is seen to be closed. Channels are served in the order "
+              "they became ready. Only one fiber can wait on a set at a time.") {
+    janet_fixarity(argc, 1);
+    JanetSelectSet *set = janet_getabstract(argv, 0, &janet_select_set_type);
+    if (set->closed) janet_panic("select set is closed");
+    int32_t index;
+    while (!janet_q_pop(&set->ready, &index, sizeof(index))) {
+        set->queued[index] = 0;
+        JanetChannel *chan = set->channels[index];
+        if (chan->closed) return make_close_result(chan);
+        /* Another reader may have taken the value first */
+        if (janet_q_count(&chan->items) == 0) continue;
+        Janet item;
+        janet_channel_pop(chan, &item, 1);
+        if (janet_q_count(&chan->items) > 0) {
+            janet_select_set_queue(set, index);
+        }
+        return make_read_result(chan, item);
+    }
+    if (janet_select_set_waiting(set)) {
+        janet_panic("another fiber is already waiting on this select set");
+    }
+    set->fiber = janet_vm.root_fiber;
+    set->sched_id = janet_vm.root_fiber->sched_id;
+    janet_await();
+}
+
+JANET_CORE_FN(cfun_select_set_close,
+              "(ev/select-close set)",
+              "Close a select set and unregister it from its channels. A fiber waiting on the set "
+              "is resumed with nil. Returns the set.") {
+    janet_fixarity(argc, 1);
+    JanetSelectSet *set = janet_getabstract(argv, 0, &janet_select_set_type);
+    if (set->closed) return argv[0];
+    janet_select_set_unregister(set);
+    set->closed = 1;
+    set->count = 0;
+    if (janet_select_set_waiting(set)) {
+        janet_schedule(set->fiber, janet_wrap_nil());
+        set->fiber = NULL;
+    }
+    return argv[0];
+}
+
+static const JanetMethod ev_select_set_methods[] = {
+    {"take", cfun_select_set_take},
+    {"close", cfun_select_set_close},
+    {NULL, NULL}
+};
+
+static int janet_select_set_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD)) return 0;
+    return janet_getmethod(janet_unwrap_keyword(key), ev_select_set_methods, out);
+}
+
+static Janet janet_select_set_next(void *p, Janet key) {
+    (void) p;
+    return janet_nextmethod(ev_select_set_methods, key);
+}
+
+static const JanetMethod ev_chanat_methods[] = {
+    {"select", cfun_channel_choice},
+    {"rselect", cfun_channel_rchoice},
+    {"count", cfun_channel_count},
+    {"take", cfun_channel_pop},
+    {"give", cfun_channel_push},
+    {"capacity", cfun_channel_capacity},
+    {"full", cfun_channel_full},
+    {"close", cfun_channel_close},
+    {NULL, NULL}
+};
+
+static int janet_chanat_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD)) return 0;
+    return janet_getmethod(janet_unwrap_keyword(key), ev_chanat_methods, out);
+}
+
+static Janet janet_chanat_next(void *p, Janet key) {
+    (void) p;
+    return janet_nextmethod(ev_chanat_methods, key);
+}
+
+static void janet_chanat_marshal(void *p, JanetMarshalContext *ctx) {
+    JanetChannel *channel = (JanetChannel *)p;
+    janet_marshal_abstract(ctx, channel);
+    janet_marshal_byte(ctx, channel->closed);
+    janet_marshal_int(ctx, channel->limit);
+    int32_t count = janet_q_count(&channel->items);
+    janet_marshal_int(ctx, count);
+    JanetQueue *items = &channel->items;
+    Janet *data = channel->items.data;
+    if (items->head <= items->tail) {
+        for (int32_t i = items->head; i < items->tail; i++)
+            janet_marshal_janet(ctx, data[i]);
+    } else {
+        for (int32_t i = items->head; i < items->capacity; i++)
+            janet_marshal_janet(ctx, data[i]);
+        for (int32_t i = 0; i < items->tail; i++)
+            janet_marshal_janet(ctx, data[i]);
+    }
+}
+
+static void *janet_chanat_unmarshal(JanetMarshalContext *ctx) {
+    JanetChannel *abst = janet_unmarshal_abstract(ctx, sizeof(JanetChannel));
+    uint8_t is_closed = janet_unmarshal_byte(ctx);
+    int32_t limit = janet_unmarshal_int(ctx);
+    int32_t count = janet_unmarshal_int(ctx);
+    if (count < 0) janet_panic("invalid negative channel count");
+    janet_chan_init(abst, limit, 0);
+    abst->closed = !!is_closed;
+    for (int32_t i = 0; i < count; i++) {
+        Janet item = janet_unmarshal_janet(ctx);
+        janet_q_push(&abst->items, &item, sizeof(item));
+    }
+    return abst;
 }
 
 const JanetAbstractType janet_channel_type = {
@@ -1283,7 +1814,139 @@ int janet_loop_done(void) {
              janet_vm.extra_listeners);
 }
 
+static double ev_clock(void) {
+    struct timespec spec;
+    janet_gettime(&spec, JANET_TIME_MONOTONIC);
+    return (double) spec.tv_sec + (double) spec.tv_nsec * 1e-9;
+}
+
+/* Record how many fibers one pass of the loop resumed and how long they ran */
+static void ev_stats_run(int32_t resumed, double start) {
+    JanetEVStats *stats = &janet_vm.ev_stats;
+    int bucket = 0;
+    while (resumed > 0 && bucket < JANET_EV_STATS_BUCKETS - 1) {
+        resumed >>= 1;
+        bucket++;
+    }
+    stats->resume_buckets[bucket]++;
+    stats->run_time += ev_clock() - start;
+}
+
+/* Report a fiber that ran too long without yielding to the slow task hook */
+static void ev_slow_task(JanetFiber *fiber, double elapsed) {
+    JanetEVStats *stats = &janet_vm.ev_stats;
+    stats->slow_tasks++;
+    if (NULL == stats->slow_hook) return;
+    Janet args[2] = {janet_wrap_fiber(fiber), janet_wrap_number(elapsed)};
+    JanetFiber *hook = janet_fiber(stats->slow_hook, 64, 2, args);
+    if (NULL == hook) return;
+    janet_schedule(hook, janet_wrap_nil());
+}
+
+/*
+ * Time slice preemption. A timer thread watches the deadline of the task
+ * the loop is running and interrupts the interpreter once it has passed.
+ * The task is suspended at its next function call or backwards jump, and
+ * the loop puts it back at the end of the spawn queue.
+ */
+
+typedef struct {
+    JanetVM *vm;
+    volatile int running;
+    volatile int requested; /* Set by the timer thread after interrupting the vm */
+    volatile double deadline; /* When the running task should yield, 0 between tasks */
+    volatile double quantum;
+#ifdef JANET_WINDOWS
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+} JanetPreempt;
+
+/* Interrupt the vm if the running task is past its deadline. Returns how
+ * long the timer thread should sleep before checking again. */
+static double janet_preempt_check(JanetPreempt *p, double *fired) {
+    double wait = p->quantum * 0.5;
+    double deadline = p->deadline;
+    if (deadline <= 0 || deadline == *fired) return wait;
+    double now = ev_clock();
+    if (now >= deadline) {
+        *fired = deadline;
+        janet_interpreter_interrupt(p->vm);
+        p->requested = 1;
+    } else if (deadline - now < wait) {
+        wait = deadline - now;
+    }
+    return wait;
+}
+
+#ifdef JANET_WINDOWS
+static DWORD WINAPI janet_preempt_body(LPVOID ptr) {
+    JanetPreempt *p = (JanetPreempt *)ptr;
+    double fired = 0;
+    while (p->running) {
+        DWORD ms = (DWORD)(janet_preempt_check(p, &fired) * 1000);
+        Sleep(ms ? ms : 1);
+    }
+    return 0;
+}
+#else
+static void *janet_preempt_body(void *ptr) {
+    JanetPreempt *p = (JanetPreempt *)ptr;
+    double fired = 0;
+    while (p->running) {
+        double wait = janet_preempt_check(p, &fired);
+        struct timespec ts;
+        ts.tv_sec = (time_t) wait;
+        ts.tv_nsec = (long)((wait - (double) ts.tv_sec) * 1000000000.0);
+        while (nanosleep(&ts, &ts) == -1 && errno == EINTR);
+    }
+    return NULL;
+}
+#endif
+
+static void janet_preempt_start(double quantum) {
+    JanetPreempt *p = janet_malloc(sizeof(JanetPreempt));
+    if (NULL == p) {
+        JANET_OUT_OF_MEMORY;
+    }
+    p->vm = &janet_vm;
+    p->running = 1;
+    p->requested = 0;
+    p->deadline = 0;
+    p->quantum = quantum;
+#ifdef JANET_WINDOWS
+    p->thread = CreateThread(NULL, 0, janet_preempt_body, p, 0, NULL);
+    int err = NULL == p->thread;
+#else
+    int err = pthread_create(&p->thread, NULL, janet_preempt_body, p);
+#endif
+    if (err) {
+        janet_free(p);
+        janet_panic("failed to start preemption timer thread");
+    }
+    janet_vm.preempt = p;
+}
+
+static void janet_preempt_stop(void) {
+    JanetPreempt *p = (JanetPreempt *) janet_vm.preempt;
+    if (NULL == p) return;
+    p->running = 0;
+#ifdef JANET_WINDOWS
+    WaitForSingleObject(p->thread, INFINITE);
+    CloseHandle(p->thread);
+#else
+    pthread_join(p->thread, NULL);
+#endif
+    if (p->requested) janet_vm.auto_suspend = 0;
+    janet_free(p);
+    janet_vm.preempt = NULL;
+}
+
 JanetFiber *janet_loop1(void) {
+    JanetEVStats *stats = &janet_vm.ev_stats;
+    stats->iterations++;
+
     /* Schedule expired timers */
     JanetTimeout to;
     JanetTimestamp now = ts_now();
@@ -1306,6 +1969,8 @@ JanetFiber *janet_loop1(void) {
     }
 
     /* Run scheduled fibers */
+    double run_start = ev_clock();
+    int32_t resumed = 0;
     while (janet_vm.spawn.head != janet_vm.spawn.tail) {
         JanetTask task = {NULL, janet_wrap_nil(), JANET_SIGNAL_OK, 0};
         janet_q_pop(&janet_vm.spawn, &task, sizeof(task));
@@ -1313,7 +1978,35 @@ JanetFiber *janet_loop1(void) {
         task.fiber->gc.flags &= ~(JANET_FIBER_EV_FLAG_CANCELED | JANET_FIBER_EV_FLAG_SUSPENDED);
         if (task.expected_sched_id != task.fiber->sched_id) continue;
         Janet res;
+        resumed++;
+        double slow_threshold = stats->slow_threshold;
+        double task_start = slow_threshold > 0 ? ev_clock() : 0;
+        JanetPreempt *preempt = (JanetPreempt *) janet_vm.preempt;
+        if (NULL != preempt) {
+            double slice = task.fiber->time_slice > 0 ? task.fiber->time_slice : preempt->quantum;
+            preempt->deadline = ev_clock() + slice;
+        }
+        janet_trace_event(JANET_TRACE_FIBER_RESUME, task.fiber, task.fiber, NULL, task.sig);
         JanetSignal sig = janet_continue_signal(task.fiber, task.value, &res, task.sig);
+        janet_trace_event(JANET_TRACE_FIBER_YIELD, task.fiber, task.fiber, NULL, sig);
+        int preempted = 0;
+        preempt = (JanetPreempt *) janet_vm.preempt;
+        if (NULL != preempt) {
+            preempt->deadline = 0;
+            if (preempt->requested) {
+                preempt->requested = 0;
+                if (sig == JANET_SIGNAL_INTERRUPT) {
+                    preempted = 1;
+                } else {
+                    /* The task yielded before it saw the interrupt */
+                    janet_vm.auto_suspend = 0;
+                }
+            }
+        }
+        if (slow_threshold > 0) {
+            double elapsed = ev_clock() - task_start;
+            if (elapsed > slow_threshold) ev_slow_task(task.fiber, elapsed);
+        }
         if (!janet_fiber_can_resume(task.fiber)) {
             janet_table_remove(&janet_vm.active_tasks, janet_wrap_fiber(task.fiber));
         }
@@ -1323,6 +2016,12 @@ JanetFiber *janet_loop1(void) {
             task.fiber->gc.flags |= JANET_FIBER_EV_FLAG_SUSPENDED;
             janet_ev_inc_refcount();
         }
+        if (preempted) {
+            /* Requeue the task, and poll for events before running it again */
+            stats->preemptions++;
+            janet_schedule(task.fiber, janet_wrap_nil());
+            break;
+        }
         if (NULL == sv) {
             if (!is_suspended) {
                 janet_stacktrace_ext(task.fiber, res, "");
@@ -1336,9 +2035,13 @@ JanetFiber *janet_loop1(void) {
         }
         if (sig == JANET_SIGNAL_INTERRUPT) {
             /* On interrupts, return the interrupted fiber immediately */
+            stats->resumes += resumed;
+            ev_stats_run(resumed, run_start);
             return task.fiber;
         }
     }
+    stats->resumes += resumed;
+    ev_stats_run(resumed, run_start);
 
     /* Poll for events */
     if (janet_vm.listener_count || janet_vm.tq_count || janet_vm.extra_listeners) {
@@ -1347,21 +2050,22 @@ JanetFiber *janet_loop1(void) {
         int has_timeout;
         /* Drop timeouts that are no longer needed */
         while ((has_timeout = peek_timeout(&to))) {
+            if (!timeout_is_stale(&to)) break;
             if (to.curr_fiber != NULL) {
-                if (!janet_fiber_can_resume(to.curr_fiber)) {
-                    janet_table_remove(&janet_vm.active_tasks, janet_wrap_fiber(to.curr_fiber));
-                    pop_timeout(0);
-                    continue;
-                }
-            } else if (to.fiber->sched_id != to.sched_id) {
-                pop_timeout(0);
-                continue;
+                janet_table_remove(&janet_vm.active_tasks, janet_wrap_fiber(to.curr_fiber));
             }
-            break;
+            pop_timeout(0);
+        }
+        /* Don't block if a preempted task is still waiting to run */
+        if (janet_vm.spawn.head != janet_vm.spawn.tail) {
+            has_timeout = 1;
+            to.when = ts_now();
         }
         /* Run polling implementation only if pending timeouts or pending events */
         if (janet_vm.tq_count || janet_vm.listener_count || janet_vm.extra_listeners) {
+            double poll_start = ev_clock();
             janet_loop1_impl(has_timeout, to.when);
+            stats->poll_time += ev_clock() - poll_start;
         }
     }
 
@@ -1410,6 +2114,7 @@ static void janet_ev_setup_selfpipe(void) {
 static void janet_ev_handle_selfpipe(void) {
     JanetSelfPipeEvent response;
     while (read(janet_vm.selfpipe[0], &response, sizeof(response)) > 0) {
+        if (response.threaded) janet_vm.ev_stats.threaded_calls--;
         if (NULL != response.cb) {
             response.cb(response.msg);
         }
@@ -1479,6 +2184,7 @@ void janet_loop1_impl(int has_timeout, JanetTimestamp to) {
         if (0 == completionKey) {
             /* Custom event */
             JanetSelfPipeEvent *response = (JanetSelfPipeEvent *)(overlapped);
+            if (response->threaded) janet_vm.ev_stats.threaded_calls--;
             if (NULL != response->cb) {
                 response->cb(response->msg);
             }
@@ -1544,8 +2250,370 @@ static void janet_epoll_sync_callback(JanetEVGenericMessage msg) {
     }
 }
 
+#ifdef JANET_EV_URING
+
+/*
+ * io_uring implementation. Streams are polled with one shot IORING_OP_POLL_ADD
+ * requests instead of being registered with epoll. Polls are queued while fibers run
+ * and submitted in one batch together with the wait for completions, so each
+ * loop iteration is a single io_uring_enter call. Timeouts are passed to
+ * io_uring_enter directly and replace the timerfd.
+ *
+ * Each polled stream owns a slot. The user_data of a poll holds the slot index and
+ * the slot generation at the time the poll was armed, so completions for polls that
+ * were replaced or cancelled after their stream stopped listening are ignored.
+ */
+
+#define JANET_URING_ENTRIES 256
+#define JANET_URING_SELFPIPE UINT64_MAX
+#define JANET_URING_IGNORE (UINT64_MAX - 1)
+
+typedef struct {
+    JanetStream *stream; /* NULL if the slot is free */
+    uint32_t gen;
+    int armed; /* Poll events of the armed poll, or -1 if not armed */
+    int dirty;
+} JanetUringSlot;
+
+typedef struct JanetUring {
+    int fd;
+    void *ring;
+    size_t ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_khead;
+    unsigned *sq_ktail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned *sq_array;
+    unsigned sq_tail;
+    unsigned *cq_khead;
+    unsigned *cq_ktail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+    JanetUringSlot *slots;
+    int32_t slot_count;
+    int32_t slot_cap;
+    int32_t free_slot; /* Head of the free list, linked through gen of free slots */
+    int32_t *dirty;
+    int32_t dirty_count;
+    int32_t dirty_cap;
+} JanetUring;
+
+static int janet_uring_enter(JanetUring *u, unsigned min_complete, unsigned flags, void *arg, size_t argsz) {
+    __atomic_store_n(u->sq_ktail, u->sq_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = u->sq_tail - __atomic_load_n(u->sq_khead, __ATOMIC_ACQUIRE);
+    return (int) syscall(__NR_io_uring_enter, u->fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+/* Submit queued requests without waiting */
+static void janet_uring_submit(JanetUring *u) {
+    int status;
+    do {
+        status = janet_uring_enter(u, 0, 0, NULL, 0);
+    } while (status == -1 && errno == EINTR);
+    if (status == -1 && errno != EBUSY && errno != EAGAIN) {
+        JANET_EXIT("failed to submit io_uring requests");
+    }
+}
+
+static struct io_uring_sqe *janet_uring_sqe(JanetUring *u) {
+    while (u->sq_tail - __atomic_load_n(u->sq_khead, __ATOMIC_ACQUIRE) >= u->sq_entries) {
+        janet_uring_submit(u);
+    }
+    unsigned index = u->sq_tail & u->sq_mask;
+    struct io_uring_sqe *sqe = u->sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    u->sq_array[index] = index;
+    u->sq_tail++;
+    return sqe;
+}
+
+static void janet_uring_poll(JanetUring *u, int fd, int events, uint64_t user_data) {
+    struct io_uring_sqe *sqe = janet_uring_sqe(u);
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll_events = (uint16_t) events;
+    sqe->user_data = user_data;
+}
+
+static void janet_uring_poll_remove(JanetUring *u, uint64_t target) {
+    struct io_uring_sqe *sqe = janet_uring_sqe(u);
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = JANET_URING_IGNORE;
+}
+
+static uint64_t janet_uring_user_data(JanetUringSlot *slot, int32_t index) {
+    return ((uint64_t) slot->gen << 32) | (uint32_t) index;
+}
+
+/* Queue a slot to have its poll armed or updated before the next wait */
+static void janet_uring_mark_dirty(JanetUring *u, int32_t index) {
+    JanetUringSlot *slot = u->slots + index;
+    if (slot->dirty) return;
+    if (u->dirty_count == u->dirty_cap) {
+        int32_t newcap = u->dirty_cap ? u->dirty_cap * 2 : 16;
+        int32_t *newdirty = janet_realloc(u->dirty, newcap * sizeof(int32_t));
+        if (NULL == newdirty) {
+            JANET_OUT_OF_MEMORY;
+        }
+        u->dirty = newdirty;
+        u->dirty_cap = newcap;
+    }
+    slot->dirty = 1;
+    u->dirty[u->dirty_count++] = index;
+}
+
+static int32_t janet_uring_slot_alloc(JanetUring *u, JanetStream *stream) {
+    int32_t index;
+    if (u->free_slot >= 0) {
+        index = u->free_slot;
+        u->free_slot = (int32_t) u->slots[index].armed;
+    } else {
+        if (u->slot_count == u->slot_cap) {
+            int32_t newcap = u->slot_cap ? u->slot_cap * 2 : 16;
+            JanetUringSlot *newslots = janet_realloc(u->slots, newcap * sizeof(JanetUringSlot));
+            if (NULL == newslots) {
+                JANET_OUT_OF_MEMORY;
+            }
+            u->slots = newslots;
+            u->slot_cap = newcap;
+        }
+        index = u->slot_count++;
+        u->slots[index].gen = 0;
+    }
+    JanetUringSlot *slot = u->slots + index;
+    slot->stream = stream;
+    slot->armed = -1;
+    slot->dirty = 0;
+    return index;
+}
+
+/* Stop polling a stream. The cancelled poll's completion carries an old
+ * generation and is ignored. */
+static void janet_uring_slot_free(JanetUring *u, int32_t index) {
+    JanetUringSlot *slot = u->slots + index;
+    if (slot->armed >= 0) {
+        janet_uring_poll_remove(u, janet_uring_user_data(slot, index));
+        /* Drop the kernel's reference to the file now, in case the stream is about to close */
+        janet_uring_submit(u);
+    }
+    slot->stream->_slot = -1;
+    slot->stream = NULL;
+    slot->gen++;
+    /* Free slots are linked through armed; dirty ones are skipped at flush */
+    slot->armed = (int) u->free_slot;
+    u->free_slot = index;
+}
+
+static int make_uring_events(int mask) {
+    int events = 0;
+    if (mask & JANET_ASYNC_LISTEN_READ)
+        events |= POLLIN;
+    if (mask & JANET_ASYNC_LISTEN_WRITE)
+        events |= POLLOUT;
+    return events;
+}
+
+/* Arm polls for all streams whose listeners changed */
+static void janet_uring_flush(JanetUring *u) {
+    for (int32_t i = 0; i < u->dirty_count; i++) {
+        int32_t index = u->dirty[i];
+        JanetUringSlot *slot = u->slots + index;
+        if (!slot->dirty) continue;
+        slot->dirty = 0;
+        if (NULL == slot->stream) continue;
+        int events = make_uring_events(slot->stream->_mask);
+        if (slot->armed >= 0) {
+            if ((slot->armed & events) == events) continue;
+            janet_uring_poll_remove(u, janet_uring_user_data(slot, index));
+        }
+        slot->gen++;
+        slot->armed = events;
+        janet_uring_poll(u, slot->stream->handle, events, janet_uring_user_data(slot, index));
+    }
+    u->dirty_count = 0;
+}
+
+static JanetUring *janet_uring_init(void) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int) syscall(__NR_io_uring_setup, JANET_URING_ENTRIES, &params);
+    if (fd < 0) return NULL;
+    unsigned needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((params.features & needed) != needed) {
+        close(fd);
+        return NULL;
+    }
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    size_t ring_size = sq_size > cq_size ? sq_size : cq_size;
+    size_t sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    void *sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        munmap(ring, ring_size);
+        close(fd);
+        return NULL;
+    }
+    JanetUring *u = janet_malloc(sizeof(JanetUring));
+    if (NULL == u) {
+        JANET_OUT_OF_MEMORY;
+    }
+    char *base = ring;
+    u->fd = fd;
+    u->ring = ring;
+    u->ring_size = ring_size;
+    u->sqes = sqes;
+    u->sqes_size = sqes_size;
+    u->sq_khead = (unsigned *)(base + params.sq_off.head);
+    u->sq_ktail = (unsigned *)(base + params.sq_off.tail);
+    u->sq_mask = *(unsigned *)(base + params.sq_off.ring_mask);
+    u->sq_entries = *(unsigned *)(base + params.sq_off.ring_entries);
+    u->sq_array = (unsigned *)(base + params.sq_off.array);
+    u->sq_tail = *u->sq_ktail;
+    u->cq_khead = (unsigned *)(base + params.cq_off.head);
+    u->cq_ktail = (unsigned *)(base + params.cq_off.tail);
+    u->cq_mask = *(unsigned *)(base + params.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(base + params.cq_off.cqes);
+    u->slots = NULL;
+    u->slot_count = 0;
+    u->slot_cap = 0;
+    u->free_slot = -1;
+    u->dirty = NULL;
+    u->dirty_count = 0;
+    u->dirty_cap = 0;
+    return u;
+}
+
+static void janet_uring_deinit(JanetUring *u) {
+    munmap(u->sqes, u->sqes_size);
+    munmap(u->ring, u->ring_size);
+    close(u->fd);
+    janet_free(u->slots);
+    janet_free(u->dirty);
+    janet_free(u);
+}
+
+static JanetListenerState *janet_uring_listen(JanetStream *stream, JanetListener behavior, int mask, size_t size, void *user) {
+    JanetUring *u = janet_vm.uring;
+    JanetListenerState *state = janet_listen_impl(stream, behavior, mask, size, user);
+    if (stream->_slot < 0) {
+        stream->_slot = janet_uring_slot_alloc(u, stream);
+    }
+    janet_uring_mark_dirty(u, stream->_slot);
+    return state;
+}
+
+/* Polls are one shot, so a smaller mask takes effect when the poll is armed again */
+static void janet_uring_unlisten(JanetListenerState *state, int is_gc) {
+    JanetStream *stream = state->stream;
+    janet_unlisten_impl(state, is_gc);
+    if (NULL == stream->state && stream->_slot >= 0) {
+        janet_uring_slot_free(janet_vm.uring, stream->_slot);
+    }
+}
+
+static void janet_uring_complete(JanetUring *u, struct io_uring_cqe *cqe) {
+    uint64_t user_data = cqe->user_data;
+    if (user_data == JANET_URING_IGNORE) return;
+    if (user_data == JANET_URING_SELFPIPE) {
+        janet_ev_handle_selfpipe();
+        janet_uring_poll(u, janet_vm.selfpipe[0], POLLIN, JANET_URING_SELFPIPE);
+        return;
+    }
+    int32_t index = (int32_t)(uint32_t) user_data;
+    if (index >= u->slot_count) return;
+    JanetUringSlot *slot = u->slots + index;
+    if (NULL == slot->stream || slot->gen != (uint32_t)(user_data >> 32)) return;
+    slot->armed = -1;
+    JanetStream *stream = slot->stream;
+    int mask = cqe->res < 0 ? POLLERR : cqe->res;
+    JanetListenerState *state = stream->state;
+    while (NULL != state) {
+        state->event = cqe;
+        JanetListenerState *next_state = state->_next;
+        JanetAsyncStatus status1 = JANET_ASYNC_STATUS_NOT_DONE;
+        JanetAsyncStatus status2 = JANET_ASYNC_STATUS_NOT_DONE;
+        JanetAsyncStatus status3 = JANET_ASYNC_STATUS_NOT_DONE;
+        JanetAsyncStatus status4 = JANET_ASYNC_STATUS_NOT_DONE;
+        if (mask & POLLOUT)
+            status1 = state->machine(state, JANET_ASYNC_EVENT_WRITE);
+        if (mask & POLLIN)
+            status2 = state->machine(state, JANET_ASYNC_EVENT_READ);
+        if (mask & POLLERR)
+            status3 = state->machine(state, JANET_ASYNC_EVENT_ERR);
+        if ((mask & POLLHUP) && !(mask & (POLLOUT | POLLIN)))
+            status4 = state->machine(state, JANET_ASYNC_EVENT_HUP);
+        if (status1 == JANET_ASYNC_STATUS_DONE ||
+                status2 == JANET_ASYNC_STATUS_DONE ||
+                status3 == JANET_ASYNC_STATUS_DONE ||
+                status4 == JANET_ASYNC_STATUS_DONE)
+            janet_uring_unlisten(state, 0);
+        state = next_state;
+    }
+    /* Poll again for the listeners that are left */
+    if (stream->_slot == index) {
+        janet_uring_mark_dirty(u, index);
+    }
+    /* Close the stream if requested and no more listeners are left */
+    if ((stream->flags & JANET_STREAM_TOCLOSE) && !stream->state) {
+        janet_stream_close(stream);
+    }
+}
+
+static void janet_uring_loop1(int has_timeout, JanetTimestamp timeout) {
+    JanetUring *u = janet_vm.uring;
+    janet_uring_flush(u);
+
+    /* Submit polls and wait for completions in one call */
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (has_timeout) {
+        JanetTimestamp now = ts_now();
+        JanetTimestamp wait = timeout > now ? timeout - now : 0;
+        ts.tv_sec = wait / 1000;
+        ts.tv_nsec = (wait % 1000) * 1000000;
+        arg.ts = (uint64_t)(uintptr_t) &ts;
+    }
+    int status;
+    do {
+        status = janet_uring_enter(u, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    } while (status == -1 && errno == EINTR);
+    if (status == -1 && errno != ETIME && errno != EBUSY && errno != EAGAIN) {
+        JANET_EXIT("failed to poll events");
+    }
+
+    /* Step state machines. Copy each completion out first, since handling it can queue more requests. */
+    for (;;) {
+        unsigned head = *u->cq_khead;
+        if (head == __atomic_load_n(u->cq_ktail, __ATOMIC_ACQUIRE)) break;
+        struct io_uring_cqe cqe = u->cqes[head & u->cq_mask];
+        __atomic_store_n(u->cq_khead, head + 1, __ATOMIC_RELEASE);
+        janet_uring_complete(u, &cqe);
+    }
+}
+
+/*
+ * End io_uring implementation
+ */
+
+#endif
+
 /* Wait for the next event */
 JanetListenerState *janet_listen(JanetStream *stream, JanetListener behavior, int mask, size_t size, void *user) {
+#ifdef JANET_EV_URING
+    if (NULL != janet_vm.uring) {
+        return janet_uring_listen(stream, behavior, mask, size, user);
+    }
+#endif
     int is_first = !(stream->state);
     int op = is_first ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
     JanetListenerState *state = janet_listen_impl(stream, behavior, mask, size, user);
@@ -1579,6 +2647,12 @@ JanetListenerState *janet_listen(JanetStream *stream, JanetListener behavior, in
 
 /* Tell system we are done listening for a certain event */
 static void janet_unlisten(JanetListenerState *state, int is_gc) {
+#ifdef JANET_EV_URING
+    if (NULL != janet_vm.uring) {
+        janet_uring_unlisten(state, is_gc);
+        return;
+    }
+#endif
     JanetStream *stream = state->stream;
     if (!(stream->flags & JANET_STREAM_CLOSED)) {
         /* Use flag to indicate state is not registered in epoll */
@@ -1603,6 +2677,12 @@ static void janet_unlisten(JanetListenerState *state, int is_gc) {
 
 #define JANET_EPOLL_MAX_EVENTS 64
 void janet_loop1_impl(int has_timeout, JanetTimestamp timeout) {
+#ifdef JANET_EV_URING
+    if (NULL != janet_vm.uring) {
+        janet_uring_loop1(has_timeout, timeout);
+        return;
+    }
+#endif
     struct itimerspec its;
     if (janet_vm.timer_enabled || has_timeout) {
         memset(&its, 0, sizeof(its));
@@ -1669,6 +2749,15 @@ void janet_loop1_impl(int has_timeout, JanetTimestamp timeout) {
 void janet_ev_init(void) {
     janet_ev_init_common();
     janet_ev_setup_selfpipe();
+#ifdef JANET_EV_URING
+    janet_vm.uring = janet_uring_init();
+    if (NULL != janet_vm.uring) {
+        janet_vm.epoll = -1;
+        janet_vm.timerfd = -1;
+        janet_uring_poll(janet_vm.uring, janet_vm.selfpipe[0], POLLIN, JANET_URING_SELFPIPE);
+        return;
+    }
+#endif
     janet_vm.epoll = epoll_create1(EPOLL_CLOEXEC);
     janet_vm.timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
     janet_vm.timer_enabled = 0;
@@ -1687,8 +2776,16 @@ error:
 
 void janet_ev_deinit(void) {
     janet_ev_deinit_common();
-    close(janet_vm.epoll);
-    close(janet_vm.timerfd);
+#ifdef JANET_EV_URING
+    if (NULL != janet_vm.uring) {
+        janet_uring_deinit(janet_vm.uring);
+        janet_vm.uring = NULL;
+    } else
+#endif
+    {
+        close(janet_vm.epoll);
+        close(janet_vm.timerfd);
+    }
     janet_ev_cleanup_selfpipe();
     janet_vm.epoll = 0;
 }
@@ -2027,44 +3124,216 @@ void janet_ev_post_event(JanetVM *vm, JanetCallback cb, JanetEVGenericMessage ms
     if (NULL == event) {
         JANET_OUT_OF_MEMORY;
     }
-    event->msg = msg;
-    event->cb = cb;
-    janet_assert(PostQueuedCompletionStatus(iocp,
-                                            sizeof(JanetSelfPipeEvent),
-                                            0,
-                                            (LPOVERLAPPED) event),
-                 "failed to post completion event");
-#else
-    JanetSelfPipeEvent event;
-    memset(&event, 0, sizeof(event));
-    event.msg = msg;
-    event.cb = cb;
-    int fd = vm->selfpipe[1];
-    /* handle a bit of back pressure before giving up. */
-    int tries = 4;
-    while (tries > 0) {
-        int status;
-        do {
-            status = write(fd, &event, sizeof(event));
-        } while (status == -1 && errno == EINTR);
-        if (status > 0) break;
-        sleep(0);
-        tries--;
+    event->msg = msg;
+    event->cb = cb;
+    event->threaded = 0;
+    janet_assert(PostQueuedCompletionStatus(iocp,
+                                            sizeof(JanetSelfPipeEvent),
+                                            0,
+                                            (LPOVERLAPPED) event),
+                 "failed to post completion event");
+#else
+    JanetSelfPipeEvent event;
+    memset(&event, 0, sizeof(event));
+    event.msg = msg;
+    event.cb = cb;
+    int fd = vm->selfpipe[1];
+    /* handle a bit of back pressure before giving up. */
+    int tries = 4;
+    while (tries > 0) {
+        int status;
+        do {
+            status = write(fd, &event, sizeof(event));
+        } while (status == -1 && errno == EINTR);
+        if (status > 0) break;
+        sleep(0);
+        tries--;
+    }
+    janet_assert(tries > 0, "failed to write event to self-pipe");
+#endif
+}
+
+/* Post several messages to the same event loop. On posix, the messages are
+ * written to the self-pipe with a single write. */
+static void janet_ev_post_events(JanetVM *vm, JanetCallback cb, const JanetEVGenericMessage *msgs, int32_t n) {
+#ifdef JANET_WINDOWS
+    for (int32_t i = 0; i < n; i++) {
+        janet_ev_post_event(vm, cb, msgs[i]);
+    }
+#else
+    JanetSelfPipeEvent events[JANET_EV_POST_BATCH];
+    vm = vm ? vm : &janet_vm;
+    int fd = vm->selfpipe[1];
+    while (n > 0) {
+        int32_t count = n > JANET_EV_POST_BATCH ? JANET_EV_POST_BATCH : n;
+        memset(events, 0, sizeof(events));
+        for (int32_t i = 0; i < count; i++) {
+            events[i].msg = msgs[i];
+            events[i].cb = cb;
+        }
+        /* handle a bit of back pressure before giving up. */
+        int tries = 4;
+        while (tries > 0) {
+            int status;
+            do {
+                status = write(fd, events, count * sizeof(JanetSelfPipeEvent));
+            } while (status == -1 && errno == EINTR);
+            if (status > 0) break;
+            sleep(0);
+            tries--;
+        }
+        janet_assert(tries > 0, "failed to write event to self-pipe");
+        msgs += count;
+        n -= count;
+    }
+#endif
+}
+
+/*
+ * Threaded calls
+ *
+ * Threaded calls are run on a process wide pool of worker threads. Workers are
+ * created on demand, up to a maximum, and idle workers exit after a short timeout.
+ * When all workers are busy, calls are queued until a worker is free. Calls that
+ * may run indefinitely (ev/thread) never wait in the queue and are never counted
+ * against the maximum, so they cannot starve other threaded calls.
+ */
+
+/* Default maximum number of pooled worker threads. Can be overridden at runtime with the
+ * JANET_THREAD_POOL_SIZE environment variable or with ev/pool-size. */
+#ifndef JANET_THREAD_POOL_SIZE
+#define JANET_THREAD_POOL_SIZE 64
+#endif
+
+/* How long an idle worker waits for a new job before exiting, in milliseconds */
+#ifndef JANET_THREAD_POOL_IDLE_MS
+#define JANET_THREAD_POOL_IDLE_MS 5000
+#endif
+
+static struct {
+    JanetEVThreadInit *head;
+    JanetEVThreadInit *tail;
+    size_t queued;
+    size_t idle;
+    size_t workers; /* idle workers + workers running pooled jobs */
+    size_t max_workers;
+#ifdef JANET_WINDOWS
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE cond;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+#endif
+} janet_pool = {
+    NULL, NULL, 0, 0, 0, 0,
+#ifndef JANET_WINDOWS
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER
+#endif
+};
+
+static size_t janet_pool_size_from_env(void) {
+    const char *size_env = getenv("JANET_THREAD_POOL_SIZE");
+    if (NULL != size_env) {
+        long size = strtol(size_env, NULL, 10);
+        if (size > 0) return (size_t) size;
+    }
+    return JANET_THREAD_POOL_SIZE;
+}
+
+#ifdef JANET_WINDOWS
+
+static void janet_pool_init(void) {
+    /* Same scheme as the environment lock in os.c - the first thread to get here sets up the pool */
+    static volatile long pool_initializing = 0;
+    static volatile long pool_initialized = 0;
+    if (!InterlockedExchange(&pool_initializing, 1)) {
+        InitializeCriticalSection(&janet_pool.lock);
+        InitializeConditionVariable(&janet_pool.cond);
+        janet_pool.max_workers = janet_pool_size_from_env();
+        InterlockedOr(&pool_initialized, 1);
+    } else {
+        while (!InterlockedOr(&pool_initialized, 0)) {
+            Sleep(0);
+        }
+    }
+}
+
+static void janet_pool_lock(void) {
+    EnterCriticalSection(&janet_pool.lock);
+}
+
+static void janet_pool_unlock(void) {
+    LeaveCriticalSection(&janet_pool.lock);
+}
+
+static void janet_pool_signal(int all) {
+    if (all) {
+        WakeAllConditionVariable(&janet_pool.cond);
+    } else {
+        WakeConditionVariable(&janet_pool.cond);
+    }
+}
+
+/* Returns 0 on timeout */
+static int janet_pool_wait(void) {
+    return SleepConditionVariableCS(&janet_pool.cond, &janet_pool.lock, JANET_THREAD_POOL_IDLE_MS) ||
+           GetLastError() != ERROR_TIMEOUT;
+}
+
+#else
+
+static pthread_once_t janet_pool_once = PTHREAD_ONCE_INIT;
+
+static void janet_pool_init_once(void) {
+    janet_pool.max_workers = janet_pool_size_from_env();
+}
+
+static void janet_pool_init(void) {
+    pthread_once(&janet_pool_once, janet_pool_init_once);
+}
+
+static void janet_pool_lock(void) {
+    pthread_mutex_lock(&janet_pool.lock);
+}
+
+static void janet_pool_unlock(void) {
+    pthread_mutex_unlock(&janet_pool.lock);
+}
+
+static void janet_pool_signal(int all) {
+    if (all) {
+        pthread_cond_broadcast(&janet_pool.cond);
+    } else {
+        pthread_cond_signal(&janet_pool.cond);
+    }
+}
+
+/* Returns 0 on timeout */
+static int janet_pool_wait(void) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += JANET_THREAD_POOL_IDLE_MS / 1000;
+    deadline.tv_nsec += (JANET_THREAD_POOL_IDLE_MS % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
     }
-    janet_assert(tries > 0, "failed to write event to self-pipe");
-#endif
+    int status;
+    do {
+        status = pthread_cond_timedwait(&janet_pool.cond, &janet_pool.lock, &deadline);
+    } while (status == EINTR);
+    return status != ETIMEDOUT;
 }
 
-/*
- * Threaded calls
- */
+#endif
 
-#ifdef JANET_WINDOWS
-static DWORD WINAPI janet_thread_body(LPVOID ptr) {
-    JanetEVThreadInit *init = (JanetEVThreadInit *)ptr;
+/* Run a single threaded call and post the result back to the calling thread's event loop. */
+static void janet_pool_run_job(JanetEVThreadInit *init) {
     JanetEVGenericMessage msg = init->msg;
     JanetThreadedSubroutine subr = init->subr;
     JanetThreadedCallback cb = init->cb;
+#ifdef JANET_WINDOWS
     JanetHandle iocp = init->write_pipe;
     /* Reuse memory from thread init for returning data */
     init->msg = subr(msg);
@@ -2074,20 +3343,14 @@ static DWORD WINAPI janet_thread_body(LPVOID ptr) {
                                             0,
                                             (LPOVERLAPPED) init),
                  "failed to post completion event");
-    return 0;
-}
 #else
-static void *janet_thread_body(void *ptr) {
-    JanetEVThreadInit *init = (JanetEVThreadInit *)ptr;
-    JanetEVGenericMessage msg = init->msg;
-    JanetThreadedSubroutine subr = init->subr;
-    JanetThreadedCallback cb = init->cb;
     int fd = init->write_pipe;
     janet_free(init);
     JanetSelfPipeEvent response;
     memset(&response, 0, sizeof(response));
     response.msg = subr(msg);
     response.cb = cb;
+    response.threaded = 1;
     /* handle a bit of back pressure before giving up. */
     int tries = 4;
     while (tries > 0) {
@@ -2099,11 +3362,59 @@ static void *janet_thread_body(void *ptr) {
         sleep(1);
         tries--;
     }
+#endif
+}
+
+/* Main loop of a worker thread. Runs jobs until there is no work for a while, or until
+ * the pool has been shrunk below the current number of workers. */
+static void janet_pool_worker(JanetEVThreadInit *init) {
+    for (;;) {
+        int long_running = init->long_running;
+        janet_pool_run_job(init);
+        janet_pool_lock();
+        if (long_running) {
+            /* Rejoin the pool if there is room */
+            if (janet_pool.workers >= janet_pool.max_workers) break;
+            janet_pool.workers++;
+        } else if (janet_pool.workers > janet_pool.max_workers) {
+            janet_pool.workers--;
+            break;
+        }
+        janet_pool.idle++;
+        while (NULL == janet_pool.head) {
+            int woken = janet_pool_wait();
+            if ((!woken && NULL == janet_pool.head) || janet_pool.workers > janet_pool.max_workers) {
+                janet_pool.idle--;
+                janet_pool.workers--;
+                janet_pool_unlock();
+                return;
+            }
+        }
+        janet_pool.idle--;
+        init = janet_pool.head;
+        janet_pool.head = init->next;
+        if (NULL == janet_pool.head) janet_pool.tail = NULL;
+        janet_pool.queued--;
+        if (init->long_running) janet_pool.workers--;
+        janet_pool_unlock();
+    }
+    janet_pool_unlock();
+}
+
+#ifdef JANET_WINDOWS
+static DWORD WINAPI janet_thread_body(LPVOID ptr) {
+    janet_pool_worker((JanetEVThreadInit *) ptr);
+    return 0;
+}
+#else
+static void *janet_thread_body(void *ptr) {
+    janet_pool_worker((JanetEVThreadInit *) ptr);
     return NULL;
 }
 #endif
 
-void janet_ev_threaded_call(JanetThreadedSubroutine fp, JanetEVGenericMessage arguments, JanetThreadedCallback cb) {
+static void janet_ev_threaded_call_impl(JanetThreadedSubroutine fp, JanetEVGenericMessage arguments,
+                                        JanetThreadedCallback cb, int long_running) {
     JanetEVThreadInit *init = janet_malloc(sizeof(JanetEVThreadInit));
     if (NULL == init) {
         JANET_OUT_OF_MEMORY;
@@ -2111,27 +3422,67 @@ void janet_ev_threaded_call(JanetThreadedSubroutine fp, JanetEVGenericMessage ar
     init->msg = arguments;
     init->subr = fp;
     init->cb = cb;
-
+    init->threaded = 1;
+    init->next = NULL;
+    init->long_running = long_running;
 #ifdef JANET_WINDOWS
     init->write_pipe = janet_vm.iocp;
-    HANDLE thread_handle = CreateThread(NULL, 0, janet_thread_body, init, 0, NULL);
-    if (NULL == thread_handle) {
-        janet_free(init);
-        janet_panic("failed to create thread");
-    }
-    CloseHandle(thread_handle); /* detach from thread */
 #else
     init->write_pipe = janet_vm.selfpipe[1];
-    pthread_t waiter_thread;
-    int err = pthread_create(&waiter_thread, &janet_vm.new_thread_attr, janet_thread_body, init);
-    if (err) {
-        janet_free(init);
-        janet_panicf("%s", strerror(err));
+#endif
+
+    /* Hand off to an idle worker, or queue if the pool is saturated. Otherwise, start a new worker. */
+    janet_pool_init();
+    janet_pool_lock();
+    int spawn = long_running
+                ? (janet_pool.idle <= janet_pool.queued)
+                : (janet_pool.idle <= janet_pool.queued && janet_pool.workers < janet_pool.max_workers);
+    if (spawn) {
+        if (!long_running) janet_pool.workers++;
+    } else {
+        if (NULL == janet_pool.tail) {
+            janet_pool.head = init;
+        } else {
+            janet_pool.tail->next = init;
+        }
+        janet_pool.tail = init;
+        janet_pool.queued++;
+        janet_pool_signal(0);
     }
+    janet_pool_unlock();
+
+    if (spawn) {
+#ifdef JANET_WINDOWS
+        HANDLE thread_handle = CreateThread(NULL, 0, janet_thread_body, init, 0, NULL);
+        int failed = NULL == thread_handle;
+        if (!failed) CloseHandle(thread_handle); /* detach from thread */
+#else
+        pthread_t worker_thread;
+        int err = pthread_create(&worker_thread, &janet_vm.new_thread_attr, janet_thread_body, init);
+        int failed = err != 0;
+#endif
+        if (failed) {
+            if (!long_running) {
+                janet_pool_lock();
+                janet_pool.workers--;
+                janet_pool_unlock();
+            }
+            janet_free(init);
+#ifdef JANET_WINDOWS
+            janet_panic("failed to create thread");
+#else
+            janet_panicf("%s", strerror(err));
 #endif
+        }
+    }
 
     /* Increment ev refcount so we don't quit while waiting for a subprocess */
     janet_ev_inc_refcount();
+    janet_vm.ev_stats.threaded_calls++;
+}
+
+void janet_ev_threaded_call(JanetThreadedSubroutine fp, JanetEVGenericMessage arguments, JanetThreadedCallback cb) {
+    janet_ev_threaded_call_impl(fp, arguments, cb, 0);
 }
 
 /* Default callback for janet_ev_threaded_await. */
@@ -2462,6 +3813,275 @@ void janet_ev_recvchunk(JanetStream *stream, JanetBuffer *buf, int32_t nbytes, i
 void janet_ev_recvfrom(JanetStream *stream, JanetBuffer *buf, int32_t nbytes, int flags) {
     janet_ev_read_generic(stream, buf, nbytes, 0, JANET_ASYNC_READMODE_RECVFROM, flags);
 }
+
+/*
+ * State machines for batches of datagrams. Linux moves a whole batch with one
+ * recvmmsg or sendmmsg call, other systems loop over recvfrom and sendto until
+ * the socket would block.
+ */
+
+/* Most datagrams to move per event */
+#define JANET_EV_MANY_MAX 256
+
+#ifndef JANET_WINDOWS
+
+typedef struct {
+    JanetListenerState head;
+    JanetArray *buffers;
+    JanetArray *addresses; /* May be NULL */
+    int32_t nbytes;
+    int flags;
+} StateRecvMany;
+
+/* Store the address of datagram i, reusing the address object already there if it fits */
+static void recv_many_address(JanetArray *addresses, int32_t i, const struct sockaddr_storage *saddr, socklen_t socklen) {
+    if (i < addresses->count && janet_checkabstract(addresses->data[i], &janet_address_type)) {
+        void *abst = janet_unwrap_abstract(addresses->data[i]);
+        if (janet_abstract_size(abst) == (size_t) socklen) {
+            memcpy(abst, saddr, socklen);
+            return;
+        }
+    }
+    void *abst = janet_abstract(&janet_address_type, socklen);
+    memcpy(abst, saddr, socklen);
+    if (i < addresses->count) {
+        addresses->data[i] = janet_wrap_abstract(abst);
+    } else {
+        janet_array_push(addresses, janet_wrap_abstract(abst));
+    }
+}
+
+static JanetAsyncStatus handle_recv_many(JanetListenerState *s) {
+    StateRecvMany *state = (StateRecvMany *) s;
+    JanetArray *buffers = state->buffers;
+    int32_t count = buffers->count > JANET_EV_MANY_MAX ? JANET_EV_MANY_MAX : buffers->count;
+    for (int32_t i = 0; i < count; i++) {
+        if (!janet_checktype(buffers->data[i], JANET_BUFFER)) {
+            janet_cancel(s->fiber, janet_cstringv("expected array of buffers"));
+            return JANET_ASYNC_STATUS_DONE;
+        }
+        janet_buffer_ensure(janet_unwrap_buffer(buffers->data[i]), state->nbytes, 1);
+    }
+    JanetSArenaMark mark = janet_sarena_mark();
+    struct sockaddr_storage *saddrs = janet_sarena_alloc(count * sizeof(struct sockaddr_storage));
+    socklen_t *socklens = janet_sarena_alloc(count * sizeof(socklen_t));
+    int32_t *lens = janet_sarena_alloc(count * sizeof(int32_t));
+    int32_t n = 0;
+    int err = 0;
+#ifdef JANET_LINUX
+    struct mmsghdr *msgs = janet_sarena_alloc(count * sizeof(struct mmsghdr));
+    struct iovec *iovs = janet_sarena_alloc(count * sizeof(struct iovec));
+    memset(msgs, 0, count * sizeof(struct mmsghdr));
+    for (int32_t i = 0; i < count; i++) {
+        JanetBuffer *buffer = janet_unwrap_buffer(buffers->data[i]);
+        iovs[i].iov_base = buffer->data;
+        iovs[i].iov_len = (size_t) state->nbytes;
+        msgs[i].msg_hdr.msg_iov = iovs + i;
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = saddrs + i;
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+    }
+    int status;
+    do {
+        status = recvmmsg(s->stream->handle, msgs, (unsigned int) count, state->flags, NULL);
+    } while (status == -1 && errno == EINTR);
+    if (status == -1) {
+        err = errno;
+    } else {
+        n = status;
+        for (int32_t i = 0; i < n; i++) {
+            lens[i] = (int32_t) msgs[i].msg_len;
+            socklens[i] = msgs[i].msg_hdr.msg_namelen;
+        }
+    }
+#else
+    while (n < count) {
+        JanetBuffer *buffer = janet_unwrap_buffer(buffers->data[n]);
+        socklens[n] = sizeof(struct sockaddr_storage);
+        ssize_t nread;
+        do {
+            nread = recvfrom(s->stream->handle, buffer->data, state->nbytes, state->flags,
+                             (struct sockaddr *)(saddrs + n), socklens + n);
+        } while (nread == -1 && errno == EINTR);
+        if (nread == -1) {
+            if (n == 0) err = errno;
+            break;
+        }
+        lens[n++] = (int32_t) nread;
+    }
+#endif
+    if (n == 0) {
+        janet_sarena_reset(mark);
+        if (err == EAGAIN || err == EWOULDBLOCK) return JANET_ASYNC_STATUS_NOT_DONE;
+        errno = err;
+        janet_cancel(s->fiber, janet_ev_lasterr());
+        return JANET_ASYNC_STATUS_DONE;
+    }
+    for (int32_t i = 0; i < n; i++) {
+        janet_unwrap_buffer(buffers->data[i])->count = lens[i];
+        if (NULL != state->addresses) {
+            recv_many_address(state->addresses, i, saddrs + i, socklens[i]);
+        }
+    }
+    janet_sarena_reset(mark);
+    janet_schedule(s->fiber, janet_wrap_integer(n));
+    return JANET_ASYNC_STATUS_DONE;
+}
+
+JanetAsyncStatus ev_machine_recv_many(JanetListenerState *s, JanetAsyncEvent event) {
+    StateRecvMany *state = (StateRecvMany *) s;
+    switch (event) {
+        default:
+            break;
+        case JANET_ASYNC_EVENT_MARK:
+            janet_mark(janet_wrap_array(state->buffers));
+            if (NULL != state->addresses) janet_mark(janet_wrap_array(state->addresses));
+            break;
+        case JANET_ASYNC_EVENT_CLOSE:
+        case JANET_ASYNC_EVENT_ERR:
+            janet_schedule(s->fiber, janet_wrap_nil());
+            return JANET_ASYNC_STATUS_DONE;
+        case JANET_ASYNC_EVENT_HUP:
+        case JANET_ASYNC_EVENT_READ:
+            return handle_recv_many(s);
+    }
+    return JANET_ASYNC_STATUS_NOT_DONE;
+}
+
+typedef struct {
+    JanetListenerState head;
+    JanetTuple packets;
+    JanetTuple dests; /* One address for all packets, or one address per packet */
+    int32_t index;
+    int flags;
+} StateSendMany;
+
+static JanetAsyncStatus handle_send_many(JanetListenerState *s) {
+    StateSendMany *state = (StateSendMany *) s;
+    int32_t len = janet_tuple_length(state->packets);
+    int one_dest = janet_tuple_length(state->dests) == 1;
+    while (state->index < len) {
+        int32_t batch = len - state->index;
+        if (batch > JANET_EV_MANY_MAX) batch = JANET_EV_MANY_MAX;
+        int32_t n = 0;
+        int err = 0;
+#ifdef JANET_LINUX
+        JanetSArenaMark mark = janet_sarena_mark();
+        struct mmsghdr *msgs = janet_sarena_alloc(batch * sizeof(struct mmsghdr));
+        struct iovec *iovs = janet_sarena_alloc(batch * sizeof(struct iovec));
+        memset(msgs, 0, batch * sizeof(struct mmsghdr));
+        for (int32_t i = 0; i < batch; i++) {
+            int32_t j = state->index + i;
+            const uint8_t *bytes;
+            int32_t blen;
+            janet_bytes_view(state->packets[j], &bytes, &blen);
+            void *dest = janet_unwrap_abstract(state->dests[one_dest ? 0 : j]);
+            iovs[i].iov_base = (void *) bytes;
+            iovs[i].iov_len = (size_t) blen;
+            msgs[i].msg_hdr.msg_iov = iovs + i;
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = dest;
+            msgs[i].msg_hdr.msg_namelen = (socklen_t) janet_abstract_size(dest);
+        }
+        int status;
+        do {
+            status = sendmmsg(s->stream->handle, msgs, (unsigned int) batch, state->flags);
+        } while (status == -1 && errno == EINTR);
+        janet_sarena_reset(mark);
+        if (status == -1) {
+            err = errno;
+        } else {
+            n = status;
+        }
+#else
+        while (n < batch) {
+            int32_t j = state->index + n;
+            const uint8_t *bytes;
+            int32_t blen;
+            janet_bytes_view(state->packets[j], &bytes, &blen);
+            void *dest = janet_unwrap_abstract(state->dests[one_dest ? 0 : j]);
+            ssize_t nwrote;
+            do {
+                nwrote = sendto(s->stream->handle, bytes, blen, state->flags,
+                                (struct sockaddr *) dest, janet_abstract_size(dest));
+            } while (nwrote == -1 && errno == EINTR);
+            if (nwrote == -1) {
+                if (n == 0) err = errno;
+                break;
+            }
+            n++;
+        }
+#endif
+        if (n == 0) {
+            if (err == EAGAIN || err == EWOULDBLOCK) return JANET_ASYNC_STATUS_NOT_DONE;
+            errno = err;
+            janet_cancel(s->fiber, janet_ev_lasterr());
+            return JANET_ASYNC_STATUS_DONE;
+        }
+        state->index += n;
+        if (n < batch) return JANET_ASYNC_STATUS_NOT_DONE;
+    }
+    janet_schedule(s->fiber, janet_wrap_nil());
+    return JANET_ASYNC_STATUS_DONE;
+}
+
+JanetAsyncStatus ev_machine_send_many(JanetListenerState *s, JanetAsyncEvent event) {
+    StateSendMany *state = (StateSendMany *) s;
+    switch (event) {
+        default:
+            break;
+        case JANET_ASYNC_EVENT_MARK:
+            janet_mark(janet_wrap_tuple(state->packets));
+            janet_mark(janet_wrap_tuple(state->dests));
+            break;
+        case JANET_ASYNC_EVENT_CLOSE:
+            janet_cancel(s->fiber, janet_cstringv("stream closed"));
+            return JANET_ASYNC_STATUS_DONE;
+        case JANET_ASYNC_EVENT_ERR:
+            janet_cancel(s->fiber, janet_cstringv("stream err"));
+            return JANET_ASYNC_STATUS_DONE;
+        case JANET_ASYNC_EVENT_WRITE:
+            return handle_send_many(s);
+    }
+    return JANET_ASYNC_STATUS_NOT_DONE;
+}
+
+#endif
+
+void janet_ev_recvmany(JanetStream *stream, JanetArray *buffers, JanetArray *addresses, int32_t nbytes, int flags) {
+#ifdef JANET_WINDOWS
+    (void) stream;
+    (void) buffers;
+    (void) addresses;
+    (void) nbytes;
+    (void) flags;
+    janet_panic("receiving many datagrams at once is not supported on this platform");
+#else
+    StateRecvMany *state = (StateRecvMany *) janet_listen(stream, ev_machine_recv_many,
+                           JANET_ASYNC_LISTEN_READ, sizeof(StateRecvMany), NULL);
+    state->buffers = buffers;
+    state->addresses = addresses;
+    state->nbytes = nbytes;
+    state->flags = flags;
+#endif
+}
+
+void janet_ev_sendmany(JanetStream *stream, JanetTuple packets, JanetTuple dests, int flags) {
+#ifdef JANET_WINDOWS
+    (void) stream;
+    (void) packets;
+    (void) dests;
+    (void) flags;
+    janet_panic("sending many datagrams at once is not supported on this platform");
+#else
+    StateSendMany *state = (StateSendMany *) janet_listen(stream, ev_machine_send_many,
+                           JANET_ASYNC_LISTEN_WRITE, sizeof(StateSendMany), NULL);
+    state->packets = packets;
+    state->dests = dests;
+    state->index = 0;
+    state->flags = flags;
+#endif
+}
 #endif
 
 /*
@@ -2472,7 +4092,9 @@ typedef enum {
     JANET_ASYNC_WRITEMODE_WRITE,
     JANET_ASYNC_WRITEMODE_SEND,
     JANET_ASYNC_WRITEMODE_SENDTO,
-    JANET_ASYNC_WRITEMODE_CONNECT
+    JANET_ASYNC_WRITEMODE_CONNECT,
+    JANET_ASYNC_WRITEMODE_SENDFILE,
+    JANET_ASYNC_WRITEMODE_SPLICE
 } JanetWriteMode;
 
 typedef struct {
@@ -2480,52 +4102,253 @@ typedef struct {
     union {
         JanetBuffer *buf;
         const uint8_t *str;
+        void *abst; /* File or stream to send from in SENDFILE mode */
+        const Janet *items; /* Tuple of byte sequences if is_vector */
     } src;
     int is_buffer;
+    int is_vector;
     JanetWriteMode mode;
-    void *dest_abst;
+    void *dest_abst; /* Address in SENDTO mode, stream to move bytes into in SPLICE mode */
+    /* SENDFILE and SPLICE. In SPLICE mode the listener is on the source stream. */
+    JanetHandle src_handle;
+    int64_t offset; /* Also the number of bytes written so far if is_vector */
+    int64_t remaining; /* -1 to copy until end of file */
+    int64_t total;
 #ifdef JANET_WINDOWS
     OVERLAPPED overlapped;
     DWORD flags;
 #ifdef JANET_NET
-    WSABUF wbuf;
-#endif
-#else
-    int flags;
-    int32_t start;
+    WSABUF wbuf;
+#endif
+#else
+    int flags;
+    int32_t start;
+#endif
+} StateWrite;
+
+static JanetAsyncStatus handle_connect(JanetListenerState *s) {
+#ifdef JANET_WINDOWS
+    int res = 0;
+    int size = sizeof(res);
+    int r = getsockopt((SOCKET)s->stream->handle, SOL_SOCKET, SO_ERROR, (char *)&res, &size);
+#else
+    int res = 0;
+    socklen_t size = sizeof res;
+    int r = getsockopt(s->stream->handle, SOL_SOCKET, SO_ERROR, &res, &size);
+#endif
+    if (r == 0) {
+        if (res == 0) {
+            janet_schedule(s->fiber, janet_wrap_abstract(s->stream));
+        } else {
+            s->stream->flags |= JANET_STREAM_TOCLOSE;
+            janet_cancel(s->fiber, janet_cstringv(strerror(res)));
+        }
+    } else {
+        s->stream->flags |= JANET_STREAM_TOCLOSE;
+        janet_cancel(s->fiber, janet_ev_lasterr());
+    }
+    return JANET_ASYNC_STATUS_DONE;
+}
+
+/* Largest copy to ask the kernel for at once */
+#define JANET_SENDFILE_CHUNK 0x7FFFF000
+
+static size_t sendfile_chunk(StateWrite *state) {
+    if (state->remaining < 0 || state->remaining > JANET_SENDFILE_CHUNK) return JANET_SENDFILE_CHUNK;
+    return (size_t) state->remaining;
+}
+
+/* Account for n bytes copied in SENDFILE or SPLICE mode. n is 0 at end of file. */
+static JanetAsyncStatus sendfile_advance(JanetListenerState *s, int64_t n) {
+    StateWrite *state = (StateWrite *) s;
+    state->offset += n;
+    state->total += n;
+    if (state->remaining > 0) state->remaining -= n;
+    if (n == 0 || state->remaining == 0) {
+        janet_schedule(s->fiber, janet_wrap_number((double) state->total));
+        return JANET_ASYNC_STATUS_DONE;
+    }
+    return JANET_ASYNC_STATUS_NOT_DONE;
+}
+
+#ifdef JANET_WINDOWS
+#ifdef JANET_NET
+static JanetAsyncStatus handle_transmit_file(JanetListenerState *s) {
+    StateWrite *state = (StateWrite *) s;
+    LARGE_INTEGER offset;
+    offset.QuadPart = state->offset;
+    memset(&(state->overlapped), 0, sizeof(OVERLAPPED));
+    state->overlapped.Offset = offset.LowPart;
+    state->overlapped.OffsetHigh = (DWORD) offset.HighPart;
+    s->tag = &state->overlapped;
+    DWORD chunk = (DWORD) sendfile_chunk(state);
+    if (!TransmitFile((SOCKET) s->stream->handle, state->src_handle, chunk, 0, &state->overlapped, NULL, 0)) {
+        if (WSA_IO_PENDING != WSAGetLastError()) {
+            janet_cancel(s->fiber, janet_ev_lasterr());
+            return JANET_ASYNC_STATUS_DONE;
+        }
+    }
+    return JANET_ASYNC_STATUS_NOT_DONE;
+}
+#endif
+#else
+
+/* Copy up to len bytes of the file src at offset into dest. Returns the number
+ * of bytes copied, 0 at end of file, or -1 with errno set. */
+static int64_t janet_sendfile_impl(int dest, int src, int64_t offset, size_t len) {
+#if defined(JANET_LINUX)
+    off_t off = (off_t) offset;
+    ssize_t n;
+    do {
+        n = sendfile(dest, src, &off, len);
+    } while (n == -1 && errno == EINTR);
+    return (int64_t) n;
+#elif defined(__FreeBSD__) || defined(__DragonFly__) || defined(JANET_APPLE)
+    /* A non-blocking socket may take some bytes and then fail with EAGAIN */
+    off_t sbytes;
+    int status;
+    do {
+#ifdef JANET_APPLE
+        sbytes = (off_t) len;
+        status = sendfile(src, dest, (off_t) offset, &sbytes, NULL, 0);
+#else
+        sbytes = 0;
+        status = sendfile(src, dest, (off_t) offset, len, NULL, &sbytes, 0);
+#endif
+    } while (status == -1 && errno == EINTR && sbytes == 0);
+    if (status == -1 && sbytes == 0) return -1;
+    return (int64_t) sbytes;
+#else
+    /* No sendfile, so copy through a small buffer. Since the copy is by offset,
+     * bytes that could not be written are read again next time. */
+    uint8_t buf[0x4000];
+    if (len > sizeof(buf)) len = sizeof(buf);
+    ssize_t nread;
+    do {
+        nread = pread(src, buf, len, (off_t) offset);
+    } while (nread == -1 && errno == EINTR);
+    if (nread <= 0) return (int64_t) nread;
+    ssize_t nwrote;
+    do {
+        nwrote = write(dest, buf, (size_t) nread);
+    } while (nwrote == -1 && errno == EINTR);
+    return (int64_t) nwrote;
+#endif
+}
+
+/* Most pieces of a vectored write to pass to one writev or sendmsg call */
+#define JANET_WRITE_IOV_MAX 64
+
+static JanetAsyncStatus handle_write_vector(JanetListenerState *s) {
+    StateWrite *state = (StateWrite *) s;
+    const Janet *items = state->src.items;
+    int32_t count = janet_tuple_length(items);
+    struct iovec iov[JANET_WRITE_IOV_MAX];
+    int iovcnt = 0;
+    int more = 0;
+    size_t pending = 0;
+    int64_t skip = state->offset;
+    for (int32_t i = 0; i < count; i++) {
+        const uint8_t *bytes;
+        int32_t len;
+        janet_bytes_view(items[i], &bytes, &len);
+        if (skip >= len) {
+            skip -= len;
+            continue;
+        }
+        if (iovcnt == JANET_WRITE_IOV_MAX) {
+            more = 1;
+            break;
+        }
+        iov[iovcnt].iov_base = (void *)(bytes + skip);
+        iov[iovcnt].iov_len = (size_t)(len - skip);
+        pending += iov[iovcnt].iov_len;
+        skip = 0;
+        iovcnt++;
+    }
+    if (iovcnt == 0) {
+        janet_schedule(s->fiber, janet_wrap_nil());
+        return JANET_ASYNC_STATUS_DONE;
+    }
+    ssize_t nwrote;
+    do {
+#ifdef JANET_NET
+        if (state->mode == JANET_ASYNC_WRITEMODE_SEND) {
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = iovcnt;
+            nwrote = sendmsg(s->stream->handle, &msg, state->flags);
+        } else
 #endif
-} StateWrite;
+        {
+            nwrote = writev(s->stream->handle, iov, iovcnt);
+        }
+    } while (nwrote == -1 && errno == EINTR);
+    if (nwrote == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return JANET_ASYNC_STATUS_NOT_DONE;
+        janet_cancel(s->fiber, janet_ev_lasterr());
+        return JANET_ASYNC_STATUS_DONE;
+    }
+    if (nwrote == 0) {
+        janet_cancel(s->fiber, janet_cstringv("disconnect"));
+        return JANET_ASYNC_STATUS_DONE;
+    }
+    state->offset += nwrote;
+    if ((size_t) nwrote == pending && !more) {
+        janet_schedule(s->fiber, janet_wrap_nil());
+        return JANET_ASYNC_STATUS_DONE;
+    }
+    return JANET_ASYNC_STATUS_NOT_DONE;
+}
 
-static JanetAsyncStatus handle_connect(JanetListenerState *s) {
-#ifdef JANET_WINDOWS
-    int res = 0;
-    int size = sizeof(res);
-    int r = getsockopt((SOCKET)s->stream->handle, SOL_SOCKET, SO_ERROR, (char *)&res, &size);
+static JanetAsyncStatus handle_sendfile(JanetListenerState *s) {
+    StateWrite *state = (StateWrite *) s;
+    int64_t n;
+    if (state->mode == JANET_ASYNC_WRITEMODE_SPLICE) {
+#ifdef JANET_LINUX
+        JanetStream *dest = state->dest_abst;
+        ssize_t nmoved;
+        do {
+            nmoved = splice(s->stream->handle, NULL, dest->handle, NULL, sendfile_chunk(state),
+                            SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        } while (nmoved == -1 && errno == EINTR);
+        n = (int64_t) nmoved;
 #else
-    int res = 0;
-    socklen_t size = sizeof res;
-    int r = getsockopt(s->stream->handle, SOL_SOCKET, SO_ERROR, &res, &size);
+        n = -1;
+        errno = ENOSYS;
 #endif
-    if (r == 0) {
-        if (res == 0) {
-            janet_schedule(s->fiber, janet_wrap_abstract(s->stream));
-        } else {
-            s->stream->flags |= JANET_STREAM_TOCLOSE;
-            janet_cancel(s->fiber, janet_cstringv(strerror(res)));
-        }
     } else {
-        s->stream->flags |= JANET_STREAM_TOCLOSE;
+        n = janet_sendfile_impl(s->stream->handle, state->src_handle, state->offset, sendfile_chunk(state));
+    }
+    if (n == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return JANET_ASYNC_STATUS_NOT_DONE;
         janet_cancel(s->fiber, janet_ev_lasterr());
+        return JANET_ASYNC_STATUS_DONE;
     }
-    return JANET_ASYNC_STATUS_DONE;
+    return sendfile_advance(s, n);
 }
 
+#endif
+
 JanetAsyncStatus ev_machine_write(JanetListenerState *s, JanetAsyncEvent event) {
     StateWrite *state = (StateWrite *) s;
     switch (event) {
         default:
             break;
         case JANET_ASYNC_EVENT_MARK:
+            if (state->is_vector) {
+                janet_mark(janet_wrap_tuple(state->src.items));
+                break;
+            }
+            if (state->mode == JANET_ASYNC_WRITEMODE_SENDFILE) {
+                janet_mark(janet_wrap_abstract(state->src.abst));
+                break;
+            }
+            if (state->mode == JANET_ASYNC_WRITEMODE_SPLICE) {
+                janet_mark(janet_wrap_abstract(state->dest_abst));
+                break;
+            }
             janet_mark(state->is_buffer
                        ? janet_wrap_buffer(state->src.buf)
                        : janet_wrap_string(state->src.str));
@@ -2538,6 +4361,14 @@ JanetAsyncStatus ev_machine_write(JanetListenerState *s, JanetAsyncEvent event)
             return JANET_ASYNC_STATUS_DONE;
 #ifdef JANET_WINDOWS
         case JANET_ASYNC_EVENT_COMPLETE: {
+#ifdef JANET_NET
+            if (state->mode == JANET_ASYNC_WRITEMODE_SENDFILE) {
+                if (sendfile_advance(s, s->bytes) == JANET_ASYNC_STATUS_DONE) {
+                    return JANET_ASYNC_STATUS_DONE;
+                }
+                return handle_transmit_file(s);
+            }
+#endif
             /* Called when write finished */
             if (s->bytes == 0 && (state->mode != JANET_ASYNC_WRITEMODE_SENDTO)) {
                 janet_cancel(s->fiber, janet_cstringv("disconnect"));
@@ -2553,6 +4384,9 @@ JanetAsyncStatus ev_machine_write(JanetListenerState *s, JanetAsyncEvent event)
             if (state->mode == JANET_ASYNC_WRITEMODE_CONNECT) {
                 return handle_connect(s);
             }
+            if (state->mode == JANET_ASYNC_WRITEMODE_SENDFILE) {
+                return handle_transmit_file(s);
+            }
 #endif
             /* Begin write */
             int32_t len;
@@ -2614,14 +4448,32 @@ JanetAsyncStatus ev_machine_write(JanetListenerState *s, JanetAsyncEvent event)
             janet_cancel(s->fiber, janet_cstringv("stream err"));
             return JANET_ASYNC_STATUS_DONE;
         case JANET_ASYNC_EVENT_HUP:
+            /* A pipe with no writers left is at end of file */
+            if (state->mode == JANET_ASYNC_WRITEMODE_SPLICE) {
+                return handle_sendfile(s);
+            }
             janet_cancel(s->fiber, janet_cstringv("stream hup"));
             return JANET_ASYNC_STATUS_DONE;
+        case JANET_ASYNC_EVENT_READ:
+            if (state->mode == JANET_ASYNC_WRITEMODE_SPLICE) {
+                return handle_sendfile(s);
+            }
+            break;
         case JANET_ASYNC_EVENT_WRITE: {
 #ifdef JANET_NET
             if (state->mode == JANET_ASYNC_WRITEMODE_CONNECT) {
                 return handle_connect(s);
             }
 #endif
+            if (state->mode == JANET_ASYNC_WRITEMODE_SENDFILE) {
+                return handle_sendfile(s);
+            }
+            if (state->mode == JANET_ASYNC_WRITEMODE_SPLICE) {
+                break;
+            }
+            if (state->is_vector) {
+                return handle_write_vector(s);
+            }
             int32_t start, len;
             const uint8_t *bytes;
             start = state->start;
@@ -2687,6 +4539,7 @@ static void janet_ev_write_generic(JanetStream *stream, void *buf, void *dest_ab
     StateWrite *state = (StateWrite *) janet_listen(stream, ev_machine_write,
                         JANET_ASYNC_LISTEN_WRITE, sizeof(StateWrite), NULL);
     state->is_buffer = is_buffer;
+    state->is_vector = 0;
     state->src.buf = buf;
     state->dest_abst = dest_abst;
     state->mode = mode;
@@ -2699,6 +4552,36 @@ static void janet_ev_write_generic(JanetStream *stream, void *buf, void *dest_ab
 #endif
 }
 
+/* Write a tuple of byte sequences in one go */
+static void janet_ev_write_vector_generic(JanetStream *stream, JanetTuple items, JanetWriteMode mode, int flags) {
+#ifdef JANET_WINDOWS
+    /* The IOCP write path has no vectored form, so join the pieces instead */
+    JanetBuffer *joined = janet_buffer(0);
+    for (int32_t i = 0; i < janet_tuple_length(items); i++) {
+        const uint8_t *bytes;
+        int32_t len;
+        janet_bytes_view(items[i], &bytes, &len);
+        janet_buffer_push_bytes(joined, bytes, len);
+    }
+    janet_ev_write_generic(stream, joined, NULL, mode, 1, flags);
+#else
+    StateWrite *state = (StateWrite *) janet_listen(stream, ev_machine_write,
+                        JANET_ASYNC_LISTEN_WRITE, sizeof(StateWrite), NULL);
+    state->is_buffer = 0;
+    state->is_vector = 1;
+    state->src.items = items;
+    state->dest_abst = NULL;
+    state->mode = mode;
+    state->offset = 0;
+    state->start = 0;
+    state->flags = flags;
+#endif
+}
+
+void janet_ev_write_vector(JanetStream *stream, JanetTuple items) {
+    janet_ev_write_vector_generic(stream, items, JANET_ASYNC_WRITEMODE_WRITE, 0);
+}
+
 void janet_ev_write_buffer(JanetStream *stream, JanetBuffer *buf) {
     janet_ev_write_generic(stream, buf, NULL, JANET_ASYNC_WRITEMODE_WRITE, 1, 0);
 }
@@ -2716,6 +4599,10 @@ void janet_ev_send_string(JanetStream *stream, JanetString str, int flags) {
     janet_ev_write_generic(stream, (void *) str, NULL, JANET_ASYNC_WRITEMODE_SEND, 0, flags);
 }
 
+void janet_ev_send_vector(JanetStream *stream, JanetTuple items, int flags) {
+    janet_ev_write_vector_generic(stream, items, JANET_ASYNC_WRITEMODE_SEND, flags);
+}
+
 void janet_ev_sendto_buffer(JanetStream *stream, JanetBuffer *buf, void *dest, int flags) {
     janet_ev_write_generic(stream, buf, dest, JANET_ASYNC_WRITEMODE_SENDTO, 1, flags);
 }
@@ -2727,7 +4614,82 @@ void janet_ev_sendto_string(JanetStream *stream, JanetString str, void *dest, in
 void janet_ev_connect(JanetStream *stream, int flags) {
     janet_ev_write_generic(stream, NULL, NULL, JANET_ASYNC_WRITEMODE_CONNECT, 0, flags);
 }
+
+void janet_ev_sendfile(JanetStream *stream, Janet file, int64_t offset, int64_t length) {
+    JanetHandle handle;
+    void *abst;
+    if (janet_checkabstract(file, &janet_file_type)) {
+        JanetFile *iof = janet_unwrap_abstract(file);
+        if (iof->flags & JANET_FILE_CLOSED) janet_panic("file is closed");
+        /* Buffered writes must reach the file before the kernel reads it */
+        fflush(iof->file);
+#ifdef JANET_WINDOWS
+        handle = (HANDLE) _get_osfhandle(_fileno(iof->file));
+#else
+        handle = fileno(iof->file);
+#endif
+        abst = iof;
+    } else if (janet_checkabstract(file, &janet_stream_type)) {
+        JanetStream *src = janet_unwrap_abstract(file);
+        if (src->flags & JANET_STREAM_CLOSED) janet_panic("stream is closed");
+        handle = src->handle;
+        abst = src;
+    } else {
+        janet_panicf("expected core/file or core/stream, got %v", file);
+    }
+    if (offset < 0) janet_panic("expected non-negative offset");
+#ifdef JANET_WINDOWS
+    /* TransmitFile needs an explicit length */
+    if (length < 0) {
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(handle, &size)) janet_panicv(janet_ev_lasterr());
+        length = size.QuadPart > offset ? size.QuadPart - offset : 0;
+    }
+#endif
+    StateWrite *state = (StateWrite *) janet_listen(stream, ev_machine_write,
+                        JANET_ASYNC_LISTEN_WRITE, sizeof(StateWrite), NULL);
+    state->is_buffer = 0;
+    state->is_vector = 0;
+    state->src.abst = abst;
+    state->dest_abst = NULL;
+    state->mode = JANET_ASYNC_WRITEMODE_SENDFILE;
+    state->src_handle = handle;
+    state->offset = offset;
+    state->remaining = length;
+    state->total = 0;
+#ifdef JANET_WINDOWS
+    state->flags = 0;
+    ev_machine_write((JanetListenerState *) state, JANET_ASYNC_EVENT_USER);
+#else
+    state->start = 0;
+    state->flags = 0;
+#endif
+}
+#endif
+
+void janet_ev_splice(JanetStream *dest, JanetStream *src, int64_t length) {
+#ifdef JANET_LINUX
+    if (dest->flags & JANET_STREAM_CLOSED) janet_panic("stream is closed");
+    StateWrite *state = (StateWrite *) janet_listen(src, ev_machine_write,
+                        JANET_ASYNC_LISTEN_READ, sizeof(StateWrite), NULL);
+    state->is_buffer = 0;
+    state->is_vector = 0;
+    state->src.abst = NULL;
+    state->dest_abst = dest;
+    state->mode = JANET_ASYNC_WRITEMODE_SPLICE;
+    state->src_handle = src->handle;
+    state->offset = 0;
+    state->remaining = length;
+    state->total = 0;
+    state->start = 0;
+    state->flags = 0;
+#else
+    (void) dest;
+    (void) src;
+    (void) length;
+    janet_panic("ev/splice is not supported on this platform");
 #endif
+}
 
 /* For a pipe ID */
 #ifdef JANET_WINDOWS
@@ -2848,6 +4810,16 @@ JANET_CORE_FN(cfun_ev_go,
 }
 
 #define JANET_THREAD_SUPERVISOR_FLAG 0x100
+#define JANET_THREAD_CORE_ENV_FLAG 0x10
+
+/* Get make-image-dict or load-image-dict from the core environment. Threads
+ * started with the :e flag send core values by name through these. */
+static JanetTable *janet_thread_image_dict(const char *name) {
+    Janet dict = janet_wrap_nil();
+    janet_resolve(janet_core_env(NULL), janet_csymbol(name), &dict);
+    if (!janet_checktype(dict, JANET_TABLE)) janet_panicf("expected %s to be a table", name);
+    return janet_unwrap_table(dict);
+}
 
 /* For ev/thread - Run an interpreter in the new thread. */
 static JanetEVGenericMessage janet_go_thread_subr(JanetEVGenericMessage args) {
@@ -2900,10 +4872,16 @@ static JanetEVGenericMessage janet_go_thread_subr(JanetEVGenericMessage args) {
             nextbytes += count * sizeof(JanetCFunRegistry);
         }
 
+        /* Load a fresh core environment to link core values against */
+        JanetTable *reg = NULL;
+        if (flags & JANET_THREAD_CORE_ENV_FLAG) {
+            reg = janet_thread_image_dict("load-image-dict");
+        }
+
         Janet fiberv = janet_unmarshal(nextbytes, endbytes - nextbytes,
-                                       JANET_MARSHAL_UNSAFE, NULL, &nextbytes);
+                                       JANET_MARSHAL_UNSAFE, reg, &nextbytes);
         Janet value = janet_unmarshal(nextbytes, endbytes - nextbytes,
-                                      JANET_MARSHAL_UNSAFE, NULL, &nextbytes);
+                                      JANET_MARSHAL_UNSAFE, reg, &nextbytes);
         JanetFiber *fiber;
         if (!janet_checktype(fiberv, JANET_FIBER)) {
             if (!janet_checktype(fiberv, JANET_FUNCTION)) {
@@ -2924,6 +4902,10 @@ static JanetEVGenericMessage janet_go_thread_subr(JanetEVGenericMessage args) {
         } else {
             fiber = janet_unwrap_fiber(fiberv);
         }
+        if ((flags & JANET_THREAD_CORE_ENV_FLAG) && NULL == fiber->env) {
+            fiber->env = janet_table(0);
+            fiber->env->proto = janet_core_env(NULL);
+        }
         if (flags & 0x8) {
             if (NULL == fiber->env) fiber->env = janet_table(0);
             janet_table_put(fiber->env, janet_ckeywordv("task-id"), value);
@@ -2974,13 +4956,16 @@ JANET_CORE_FN(cfun_ev_thread,
               "* `:n` - return immediately\n"
               "* `:t` - set the task-id of the new thread to value. The task-id is passed in messages to the supervisor channel.\n"
               "* `:a` - don't copy abstract registry to new thread (performance optimization)\n"
-              "* `:c` - don't copy cfunction registry to new thread (performance optimization)") {
+              "* `:c` - don't copy cfunction registry to new thread (performance optimization)\n"
+              "* `:e` - load the core environment in the new thread and link values from it by name "
+              "instead of copying them. This makes threads that use the standard library, for example "
+              "to `require` modules or evaluate code, much cheaper to start.") {
     janet_arity(argc, 1, 4);
     Janet value = argc >= 2 ? argv[1] : janet_wrap_nil();
     if (!janet_checktype(argv[0], JANET_FUNCTION)) janet_getfiber(argv, 0);
     uint64_t flags = 0;
     if (argc >= 3) {
-        flags = janet_getflags(argv, 2, "nact");
+        flags = janet_getflags(argv, 2, "nacte");
     }
     void *supervisor = janet_optabstract(argv, argc, 3, &janet_channel_type, janet_vm.root_fiber->supervisor_channel);
     if (NULL != supervisor) flags |= JANET_THREAD_SUPERVISOR_FLAG;
@@ -3003,21 +4988,174 @@ JANET_CORE_FN(cfun_ev_thread,
         janet_buffer_push_bytes(buffer, (uint8_t *) &temp, sizeof(temp));
         janet_buffer_push_bytes(buffer, (uint8_t *) janet_vm.registry, (int32_t) janet_vm.registry_count * sizeof(JanetCFunRegistry));
     }
-    janet_marshal(buffer, argv[0], NULL, JANET_MARSHAL_UNSAFE);
-    janet_marshal(buffer, value, NULL, JANET_MARSHAL_UNSAFE);
+    JanetTable *rreg = NULL;
+    if (flags & JANET_THREAD_CORE_ENV_FLAG) {
+        rreg = janet_thread_image_dict("make-image-dict");
+    }
+    janet_marshal(buffer, argv[0], rreg, JANET_MARSHAL_UNSAFE);
+    janet_marshal(buffer, value, rreg, JANET_MARSHAL_UNSAFE);
+    /* Threads run for an unbounded amount of time, so never make them wait for a pooled worker */
+    JanetEVGenericMessage arguments;
+    memset(&arguments, 0, sizeof(arguments));
+    arguments.tag = (uint32_t) flags;
+    arguments.argi = (uint32_t) janet_vm.sandbox_flags;
+    arguments.argp = buffer;
     if (flags & 0x1) {
         /* Return immediately */
-        JanetEVGenericMessage arguments;
-        memset(&arguments, 0, sizeof(arguments));
-        arguments.tag = (uint32_t) flags;
-        arguments.argi = (uint32_t) janet_vm.sandbox_flags;
-        arguments.argp = buffer;
         arguments.fiber = NULL;
-        janet_ev_threaded_call(janet_go_thread_subr, arguments, janet_ev_default_threaded_callback);
+        janet_ev_threaded_call_impl(janet_go_thread_subr, arguments, janet_ev_default_threaded_callback, 1);
         return janet_wrap_nil();
     } else {
-        janet_ev_threaded_await(janet_go_thread_subr, (uint32_t) flags, (uint32_t) janet_vm.sandbox_flags, buffer);
+        arguments.fiber = janet_root_fiber();
+        janet_gcroot(janet_wrap_fiber(arguments.fiber));
+        janet_ev_threaded_call_impl(janet_go_thread_subr, arguments, janet_ev_default_threaded_callback, 1);
+        janet_await();
+    }
+}
+
+JANET_CORE_FN(cfun_ev_pool_size,
+              "(ev/pool-size &opt size)",
+              "Get or set the maximum number of worker threads used for threaded calls, such as "
+              "`os/proc-wait` and `os/shell`. Worker threads are shared by all threads in the process "
+              "and are created on demand - once all workers are busy, further calls wait in a queue. "
+              "Threads started with `ev/thread` never wait for a worker. The default size is taken from "
+              "the JANET_THREAD_POOL_SIZE environment variable if set. Returns the previous maximum.") {
+    janet_arity(argc, 0, 1);
+    janet_pool_init();
+    janet_pool_lock();
+    size_t old_size = janet_pool.max_workers;
+    janet_pool_unlock();
+    if (argc > 0) {
+        size_t size = janet_getsize(argv, 0);
+        if (size == 0) janet_panic("expected positive pool size");
+        janet_pool_lock();
+        janet_pool.max_workers = size;
+        /* Wake idle workers so surplus threads can exit */
+        janet_pool_signal(1);
+        janet_pool_unlock();
+    }
+    return janet_wrap_number((double) old_size);
+}
+
+JANET_CORE_FN(cfun_ev_stats,
+              "(ev/stats &opt reset)",
+              "Get statistics about the event loop on the current thread as a struct with these keys:\n\n"
+              "* `:iterations` - passes through the event loop.\n"
+              "* `:resumes` - fibers resumed by the event loop.\n"
+              "* `:resume-histogram` - a tuple counting the iterations that resumed 0, 1, 2-3, 4-7, 8-15, "
+              "16-31, 32-63, and 64 or more fibers.\n"
+              "* `:run-time` - seconds spent running fibers.\n"
+              "* `:poll-time` - seconds spent waiting for events.\n"
+              "* `:slow-tasks` - resumes that ran longer than the `ev/slow-task-hook` threshold.\n"
+              "* `:preemptions` - fibers suspended by `ev/preempt` for running past their time slice.\n"
+              "* `:spawn-queue` - fibers scheduled to run.\n"
+              "* `:listeners` - stream operations waiting for events.\n"
+              "* `:timeouts` - pending timeouts and deadlines.\n"
+              "* `:threaded-calls` - threaded calls that have not returned yet.\n\n"
+              "If `reset` is truthy, the counters and times are set back to zero after reading them.") {
+    janet_arity(argc, 0, 1);
+    JanetEVStats *stats = &janet_vm.ev_stats;
+    Janet buckets[JANET_EV_STATS_BUCKETS];
+    for (int i = 0; i < JANET_EV_STATS_BUCKETS; i++) {
+        buckets[i] = janet_wrap_number((double) stats->resume_buckets[i]);
+    }
+    JanetKV *st = janet_struct_begin(11);
+    janet_struct_put(st, janet_ckeywordv("iterations"), janet_wrap_number((double) stats->iterations));
+    janet_struct_put(st, janet_ckeywordv("resumes"), janet_wrap_number((double) stats->resumes));
+    janet_struct_put(st, janet_ckeywordv("resume-histogram"),
+                     janet_wrap_tuple(janet_tuple_n(buckets, JANET_EV_STATS_BUCKETS)));
+    janet_struct_put(st, janet_ckeywordv("run-time"), janet_wrap_number(stats->run_time));
+    janet_struct_put(st, janet_ckeywordv("poll-time"), janet_wrap_number(stats->poll_time));
+    janet_struct_put(st, janet_ckeywordv("slow-tasks"), janet_wrap_number((double) stats->slow_tasks));
+    janet_struct_put(st, janet_ckeywordv("preemptions"), janet_wrap_number((double) stats->preemptions));
+    janet_struct_put(st, janet_ckeywordv("spawn-queue"), janet_wrap_integer(janet_q_count(&janet_vm.spawn)));
+    janet_struct_put(st, janet_ckeywordv("listeners"), janet_wrap_number((double) janet_vm.listener_count));
+    janet_struct_put(st, janet_ckeywordv("timeouts"), janet_wrap_number((double) janet_vm.tq_count));
+    janet_struct_put(st, janet_ckeywordv("threaded-calls"), janet_wrap_integer(stats->threaded_calls));
+    if (argc > 0 && janet_truthy(argv[0])) {
+        stats->iterations = 0;
+        stats->resumes = 0;
+        memset(stats->resume_buckets, 0, sizeof(stats->resume_buckets));
+        stats->slow_tasks = 0;
+        stats->preemptions = 0;
+        stats->run_time = 0;
+        stats->poll_time = 0;
+    }
+    return janet_wrap_struct(janet_struct_end(st));
+}
+
+JANET_CORE_FN(cfun_ev_slow_task_hook,
+              "(ev/slow-task-hook &opt threshold hook)",
+              "Watch for fibers that run longer than `threshold` seconds before yielding to the event loop, "
+              "which keeps every other fiber on the thread waiting. Each time that happens, `hook` is called "
+              "in a new fiber with the slow fiber and the number of seconds it ran, and the `:slow-tasks` "
+              "count in `ev/stats` goes up. `hook` may be nil to only count slow tasks. Call with no "
+              "arguments or a threshold of 0 to stop watching. Returns the previous threshold.") {
+    janet_arity(argc, 0, 2);
+    JanetEVStats *stats = &janet_vm.ev_stats;
+    double old = stats->slow_threshold;
+    double threshold = janet_optnumber(argv, argc, 0, 0);
+    if (!(threshold >= 0)) janet_panicf("expected non-negative threshold, got %v", argv[0]);
+    JanetFunction *hook = NULL;
+    if (argc > 1 && !janet_checktype(argv[1], JANET_NIL)) hook = janet_getfunction(argv, 1);
+    stats->slow_threshold = threshold;
+    stats->slow_hook = threshold > 0 ? hook : NULL;
+    return janet_wrap_number(old);
+}
+
+JANET_CORE_FN(cfun_ev_share_symbols,
+              "(ev/share-symbols)",
+              "Intern symbols and keywords in a table shared by all threads in the process, so that "
+              "each symbol has one copy in memory, and symbols sent to other threads with `ev/thread` "
+              "or thread channels are passed by pointer instead of being copied and interned again. "
+              "Symbols made after this call are never freed. Sharing cannot be turned off. Returns "
+              "true if symbols were already shared.") {
+    (void) argv;
+    janet_fixarity(argc, 0);
+    return janet_wrap_boolean(janet_share_symbols());
+}
+
+JANET_CORE_FN(cfun_ev_preempt,
+              "(ev/preempt &opt quantum)",
+              "Turn on time slice preemption for the event loop on the current thread. A fiber resumed by "
+              "the event loop that runs longer than `quantum` seconds without yielding is suspended at its "
+              "next function call or backwards jump and put at the back of the queue of fibers waiting to "
+              "run, so a long computation can't starve timers, streams, and other fibers. The fiber picks up "
+              "where it left off the next time it runs. Use `ev/time-slice` to give a fiber its own budget. "
+              "Call with no arguments or a quantum of 0 to turn preemption off. Returns the previous quantum.") {
+    janet_arity(argc, 0, 1);
+    double quantum = janet_optnumber(argv, argc, 0, 0);
+    if (!(quantum >= 0)) janet_panicf("expected non-negative quantum, got %v", argv[0]);
+#ifdef JANET_NO_INTERPRETER_INTERRUPT
+    if (quantum > 0) janet_panic("preemption not supported in this build");
+#endif
+    JanetPreempt *p = (JanetPreempt *) janet_vm.preempt;
+    double old = p ? p->quantum : 0;
+    if (NULL != p && quantum > 0) {
+        p->quantum = quantum;
+    } else if (NULL != p) {
+        janet_preempt_stop();
+    } else if (quantum > 0) {
+        janet_preempt_start(quantum);
+    }
+    return janet_wrap_number(old);
+}
+
+JANET_CORE_FN(cfun_ev_time_slice,
+              "(ev/time-slice fiber &opt seconds)",
+              "Set how many seconds `fiber` may run before it is preempted while `ev/preempt` is on. Latency "
+              "sensitive fibers can be given a short budget so they yield often, and batch work a long one. "
+              "A budget of 0 uses the quantum passed to `ev/preempt`, and math/inf lets the fiber run until "
+              "it yields on its own. Without `seconds`, leaves the budget unchanged. Returns the previous budget.") {
+    janet_arity(argc, 1, 2);
+    JanetFiber *fiber = janet_getfiber(argv, 0);
+    double old = fiber->time_slice;
+    if (argc > 1) {
+        double seconds = janet_getnumber(argv, 1);
+        if (!(seconds >= 0)) janet_panicf("expected non-negative time slice, got %v", argv[1]);
+        fiber->time_slice = seconds;
     }
+    return janet_wrap_number(old);
 }
 
 JANET_CORE_FN(cfun_ev_give_supervisor,
@@ -3060,13 +5198,14 @@ JANET_CORE_FN(cfun_ev_deadline,
               "Set a deadline for a fiber `tocheck`. If `tocheck` is not finished after `sec` seconds, "
               "`tocancel` will be canceled as with `ev/cancel`. "
               "If `tocancel` and `tocheck` are not given, they default to `(fiber/root)` and "
-              "`(fiber/current)` respectively. Returns `tocancel`.") {
+              "`(fiber/current)` respectively. Deadlines of a second or more may expire up to 16 "
+              "milliseconds late so that they can be handled together. Returns `tocancel`.") {
     janet_arity(argc, 1, 3);
     double sec = janet_getnumber(argv, 0);
     JanetFiber *tocancel = janet_optfiber(argv, argc, 1, janet_vm.root_fiber);
     JanetFiber *tocheck = janet_optfiber(argv, argc, 2, janet_vm.fiber);
     JanetTimeout to;
-    to.when = ts_delta(ts_now(), sec);
+    to.when = ts_delta_coarse(ts_now(), sec);
     to.fiber = tocancel;
     to.curr_fiber = tocheck;
     to.is_error = 0;
@@ -3105,7 +5244,7 @@ JANET_CORE_FN(janet_cfun_stream_read,
     janet_arity(argc, 2, 4);
     JanetStream *stream = janet_getabstract(argv, 0, &janet_stream_type);
     janet_stream_flags(stream, JANET_STREAM_READABLE);
-    JanetBuffer *buffer = janet_optbuffer(argv, argc, 2, 10);
+    JanetBuffer *buffer = janet_optreadbuffer(argv, argc, 2, 10);
     double to = janet_optnumber(argv, argc, 3, INFINITY);
     if (janet_keyeq(argv[1], "all")) {
         if (to != INFINITY) janet_addtimeout(to);
@@ -3126,23 +5265,42 @@ JANET_CORE_FN(janet_cfun_stream_chunk,
     JanetStream *stream = janet_getabstract(argv, 0, &janet_stream_type);
     janet_stream_flags(stream, JANET_STREAM_READABLE);
     int32_t n = janet_getnat(argv, 1);
-    JanetBuffer *buffer = janet_optbuffer(argv, argc, 2, 10);
+    JanetBuffer *buffer = janet_optreadbuffer(argv, argc, 2, 10);
     double to = janet_optnumber(argv, argc, 3, INFINITY);
     if (to != INFINITY) janet_addtimeout(to);
     janet_ev_readchunk(stream, buffer, n);
     janet_await();
 }
 
+/* Get the pieces of a vectored write from an array or tuple of byte sequences.
+ * Arrays are copied so that later changes do not affect the write. */
+JanetTuple janet_ev_write_items(const Janet *argv, int32_t n) {
+    JanetView view = janet_getindexed(argv, n);
+    for (int32_t i = 0; i < view.len; i++) {
+        if (!janet_checktypes(view.items[i], JANET_TFLAG_BYTES)) {
+            janet_panicf("expected bytes in write list, got %v", view.items[i]);
+        }
+    }
+    if (janet_checktype(argv[n], JANET_TUPLE)) return janet_unwrap_tuple(argv[n]);
+    return janet_tuple_n(view.items, view.len);
+}
+
 JANET_CORE_FN(janet_cfun_stream_write,
               "(ev/write stream data &opt timeout)",
               "Write data to a stream, suspending the current fiber until the write "
-              "completes. Takes an optional timeout in seconds, after which will return nil. "
+              "completes. `data` can also be an array or tuple of byte sequences, which are "
+              "written in order with as few system calls as possible. "
+              "Takes an optional timeout in seconds, after which will return nil. "
               "Returns nil, or raises an error if the write failed.") {
     janet_arity(argc, 2, 3);
     JanetStream *stream = janet_getabstract(argv, 0, &janet_stream_type);
     janet_stream_flags(stream, JANET_STREAM_WRITABLE);
     double to = janet_optnumber(argv, argc, 2, INFINITY);
-    if (janet_checktype(argv[1], JANET_BUFFER)) {
+    if (janet_checktypes(argv[1], JANET_TFLAG_INDEXED)) {
+        JanetTuple items = janet_ev_write_items(argv, 1);
+        if (to != INFINITY) janet_addtimeout(to);
+        janet_ev_write_vector(stream, items);
+    } else if (janet_checktype(argv[1], JANET_BUFFER)) {
         if (to != INFINITY) janet_addtimeout(to);
         janet_ev_write_buffer(stream, janet_getbuffer(argv, 1));
     } else {
@@ -3153,6 +5311,423 @@ JANET_CORE_FN(janet_cfun_stream_write,
     janet_await();
 }
 
+JANET_CORE_FN(janet_cfun_stream_splice,
+              "(ev/splice dest src &opt length timeout)",
+              "Move bytes from stream `src` to stream `dest` without copying them through a buffer, "
+              "suspending the current fiber until `length` bytes have been moved or `src` reaches end of file. "
+              "One of the streams must be a pipe. Only available on Linux. "
+              "Takes an optional timeout in seconds, after which will return nil. "
+              "Returns the number of bytes moved.") {
+    janet_arity(argc, 2, 4);
+    JanetStream *dest = janet_getabstract(argv, 0, &janet_stream_type);
+    JanetStream *src = janet_getabstract(argv, 1, &janet_stream_type);
+    janet_stream_flags(dest, JANET_STREAM_WRITABLE);
+    janet_stream_flags(src, JANET_STREAM_READABLE);
+    int64_t length = janet_optinteger64(argv, argc, 2, -1);
+    if (length < -1 || (length == -1 && argc > 2 && !janet_checktype(argv[2], JANET_NIL))) {
+        janet_panic("expected non-negative length");
+    }
+    double to = janet_optnumber(argv, argc, 3, INFINITY);
+    if (length == 0) return janet_wrap_integer(0);
+    if (to != INFINITY) janet_addtimeout(to);
+    janet_ev_splice(dest, src, length);
+    janet_await();
+}
+
+#ifndef JANET_WINDOWS
+
+/*
+ * Buffered streams. Reads and writes on regular files block even when the
+ * descriptor is non-blocking, so buffered streams make their system calls on
+ * the thread pool and the event loop keeps running. Reads fill a read ahead
+ * buffer, and writes are collected in a write behind buffer that is written
+ * out when it fills up, on flush, and on close. Windows file streams are
+ * already asynchronous through IOCP.
+ */
+
+#define JANET_BSTREAM_DEFAULT_SIZE 65536
+
+typedef enum {
+    JANET_BSTREAM_READ,
+    JANET_BSTREAM_READ_ALL,
+    JANET_BSTREAM_READ_UNTIL,
+    JANET_BSTREAM_FLUSH,
+    JANET_BSTREAM_CLOSE
+} JanetBStreamOp;
+
+typedef struct {
+    JanetStream *stream;
+    /* The operation in progress */
+    JanetFiber *fiber;
+    uint32_t sched_id;
+    JanetBStreamOp op;
+    JanetBuffer *out;
+    const uint8_t *delim;
+    int32_t want;
+    int32_t got;
+    int busy;
+    int eof;
+    int err;
+    /* Read ahead buffer, with unread bytes in [rstart, rend) */
+    int32_t size;
+    uint8_t *rbuf;
+    int32_t rstart;
+    int32_t rend;
+    /* Write behind buffer */
+    uint8_t *wbuf;
+    int32_t wcount;
+    int32_t wcap;
+} JanetBStream;
+
+static int bstream_gc(void *p, size_t size) {
+    (void) size;
+    JanetBStream *bs = p;
+    janet_free(bs->rbuf);
+    janet_free(bs->wbuf);
+    return 0;
+}
+
+static int bstream_mark(void *p, size_t size) {
+    (void) size;
+    JanetBStream *bs = p;
+    janet_mark(janet_wrap_abstract(bs->stream));
+    if (bs->fiber) janet_mark(janet_wrap_fiber(bs->fiber));
+    if (bs->out) janet_mark(janet_wrap_buffer(bs->out));
+    if (bs->delim) janet_mark(janet_wrap_string(bs->delim));
+    return 0;
+}
+
+static int bstream_getter(void *p, Janet key, Janet *out);
+
+static const JanetAbstractType janet_bstream_type = {
+    "core/buffered-stream",
+    bstream_gc,
+    bstream_mark,
+    bstream_getter,
+    JANET_ATEND_GET
+};
+
+#define JANET_BSTREAM_IO_READ 0
+#define JANET_BSTREAM_IO_WRITE 1
+
+/* Wait for a non-blocking descriptor to be ready from a pool thread */
+static void bstream_poll(int fd, short events) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+    poll(&pfd, 1, -1);
+}
+
+/* Runs on the thread pool. The loop thread does not touch the buffers while
+ * busy is set. */
+static JanetEVGenericMessage bstream_io_subr(JanetEVGenericMessage msg) {
+    JanetBStream *bs = msg.argp;
+    int fd = bs->stream->handle;
+    ssize_t n;
+    if (msg.tag == JANET_BSTREAM_IO_READ) {
+        for (;;) {
+            do {
+                n = read(fd, bs->rbuf + bs->rend, (size_t)(bs->size - bs->rend));
+            } while (n < 0 && errno == EINTR);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                bstream_poll(fd, POLLIN);
+                continue;
+            }
+            break;
+        }
+        if (n < 0) bs->err = errno;
+        msg.argi = n < 0 ? -1 : (int32_t) n;
+    } else {
+        int32_t done = 0;
+        while (done < bs->wcount) {
+            do {
+                n = write(fd, bs->wbuf + done, (size_t)(bs->wcount - done));
+            } while (n < 0 && errno == EINTR);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                bstream_poll(fd, POLLOUT);
+                continue;
+            }
+            if (n < 0) {
+                bs->err = errno;
+                break;
+            }
+            done += (int32_t) n;
+        }
+        msg.argi = done;
+    }
+    return msg;
+}
+
+static void bstream_callback(JanetEVGenericMessage msg);
+
+static void bstream_start_io(JanetBStream *bs, int tag) {
+    JanetEVGenericMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.tag = tag;
+    msg.argp = bs;
+    bs->busy = 1;
+    janet_gcroot(janet_wrap_abstract(bs));
+    janet_ev_threaded_call(bstream_io_subr, msg, bstream_callback);
+}
+
+/* Move bytes from the read ahead buffer to the output buffer */
+static void bstream_take(JanetBStream *bs, int32_t n) {
+    janet_buffer_push_bytes(bs->out, bs->rbuf + bs->rstart, n);
+    bs->rstart += n;
+    bs->got += n;
+    if (bs->rstart == bs->rend) bs->rstart = bs->rend = 0;
+}
+
+/* Try to finish the current operation with what is in the buffers. Returns 1
+ * and sets result when done. Otherwise, starts the next system call on the
+ * thread pool and returns 0. */
+static int bstream_advance(JanetBStream *bs, Janet *result) {
+    int32_t avail = bs->rend - bs->rstart;
+    switch (bs->op) {
+        case JANET_BSTREAM_READ:
+            if (avail > 0) {
+                bstream_take(bs, avail < bs->want ? avail : bs->want);
+                *result = janet_wrap_buffer(bs->out);
+                return 1;
+            }
+            break;
+        case JANET_BSTREAM_READ_ALL:
+            if (avail > 0) bstream_take(bs, avail);
+            break;
+        case JANET_BSTREAM_READ_UNTIL: {
+            int32_t dlen = janet_string_length(bs->delim);
+            const uint8_t *start = bs->rbuf + bs->rstart;
+            for (int32_t i = 0; i + dlen <= avail; i++) {
+                if (start[i] == bs->delim[0] && !memcmp(start + i, bs->delim, dlen)) {
+                    bstream_take(bs, i + dlen);
+                    *result = janet_wrap_buffer(bs->out);
+                    return 1;
+                }
+            }
+            /* Keep a tail that could be the start of a delimiter */
+            int32_t keep = bs->eof ? 0 : dlen - 1;
+            if (avail > keep) bstream_take(bs, avail - keep);
+            break;
+        }
+        case JANET_BSTREAM_FLUSH:
+        case JANET_BSTREAM_CLOSE:
+            if (bs->wcount > 0) {
+                bstream_start_io(bs, JANET_BSTREAM_IO_WRITE);
+                return 0;
+            }
+            if (bs->op == JANET_BSTREAM_CLOSE) janet_stream_close(bs->stream);
+            *result = janet_wrap_nil();
+            return 1;
+    }
+    if (bs->eof) {
+        *result = bs->got ? janet_wrap_buffer(bs->out) : janet_wrap_nil();
+        return 1;
+    }
+    if (bs->rstart > 0) {
+        memmove(bs->rbuf, bs->rbuf + bs->rstart, bs->rend - bs->rstart);
+        bs->rend -= bs->rstart;
+        bs->rstart = 0;
+    }
+    bstream_start_io(bs, JANET_BSTREAM_IO_READ);
+    return 0;
+}
+
+static void bstream_finish(JanetBStream *bs) {
+    bs->fiber = NULL;
+    bs->out = NULL;
+    bs->delim = NULL;
+}
+
+static void bstream_callback(JanetEVGenericMessage msg) {
+    janet_ev_dec_refcount();
+    JanetBStream *bs = msg.argp;
+    JanetFiber *fiber = bs->fiber;
+    int err = 0;
+    bs->busy = 0;
+    janet_gcunroot(janet_wrap_abstract(bs));
+    if (msg.tag == JANET_BSTREAM_IO_READ) {
+        if (msg.argi < 0) {
+            err = bs->err;
+        } else if (msg.argi == 0) {
+            bs->eof = 1;
+        } else {
+            bs->rend += msg.argi;
+        }
+    } else {
+        bs->wcount -= msg.argi;
+        if (bs->wcount > 0) {
+            memmove(bs->wbuf, bs->wbuf + msg.argi, bs->wcount);
+            err = bs->err;
+        }
+    }
+    /* Don't resume a fiber that was canceled or resumed while we were waiting */
+    int live = fiber->sched_id == bs->sched_id;
+    if (err) {
+        bstream_finish(bs);
+        if (live) janet_cancel(fiber, janet_cstringv(strerror(err)));
+        return;
+    }
+    if (!live) {
+        bstream_finish(bs);
+        return;
+    }
+    Janet result;
+    if (bstream_advance(bs, &result)) {
+        bstream_finish(bs);
+        janet_schedule(fiber, result);
+    }
+}
+
+/* Start an operation from a cfunction. Returns the result if it can finish
+ * right away, and otherwise suspends the current fiber. */
+static Janet bstream_run(JanetBStream *bs, JanetBStreamOp op) {
+    Janet result;
+    bs->op = op;
+    bs->got = 0;
+    bs->fiber = janet_vm.root_fiber;
+    bs->sched_id = bs->fiber->sched_id;
+    if (bstream_advance(bs, &result)) {
+        bstream_finish(bs);
+        return result;
+    }
+    janet_await();
+}
+
+static JanetBStream *bstream_get(Janet *argv, int flags) {
+    JanetBStream *bs = janet_getabstract(argv, 0, &janet_bstream_type);
+    if (bs->busy || bs->fiber) janet_panic("buffered stream is in use by another fiber");
+    if (bs->stream->flags & JANET_STREAM_CLOSED) janet_panic("stream is closed");
+    if (flags && !(bs->stream->flags & flags)) {
+        janet_panic(flags == JANET_STREAM_READABLE ? "stream is not readable" : "stream is not writable");
+    }
+    return bs;
+}
+
+static Janet bstream_read(int32_t argc, Janet *argv) {
+    janet_arity(argc, 2, 3);
+    JanetBStream *bs = bstream_get(argv, JANET_STREAM_READABLE);
+    bs->out = janet_optbuffer(argv, argc, 2, 10);
+    if (janet_keyeq(argv[1], "all")) {
+        bs->want = INT32_MAX;
+        return bstream_run(bs, JANET_BSTREAM_READ_ALL);
+    }
+    bs->want = janet_getnat(argv, 1);
+    if (bs->want == 0) {
+        JanetBuffer *out = bs->out;
+        bstream_finish(bs);
+        return janet_wrap_buffer(out);
+    }
+    return bstream_run(bs, JANET_BSTREAM_READ);
+}
+
+static Janet bstream_read_until(JanetBStream *bs, const uint8_t *delim, JanetBuffer *out) {
+    if (janet_string_length(delim) < 1 || janet_string_length(delim) >= bs->size) {
+        janet_panicf("delimiter must be between 1 and %d bytes", bs->size - 1);
+    }
+    bs->out = out;
+    bs->delim = delim;
+    return bstream_run(bs, JANET_BSTREAM_READ_UNTIL);
+}
+
+static Janet bstream_cfun_read_until(int32_t argc, Janet *argv) {
+    janet_arity(argc, 2, 3);
+    JanetBStream *bs = bstream_get(argv, JANET_STREAM_READABLE);
+    JanetByteView view = janet_getbytes(argv, 1);
+    return bstream_read_until(bs, janet_string(view.bytes, view.len), janet_optbuffer(argv, argc, 2, 10));
+}
+
+static Janet bstream_cfun_read_line(int32_t argc, Janet *argv) {
+    janet_arity(argc, 1, 2);
+    JanetBStream *bs = bstream_get(argv, JANET_STREAM_READABLE);
+    return bstream_read_until(bs, janet_cstring("\n"), janet_optbuffer(argv, argc, 1, 10));
+}
+
+static Janet bstream_cfun_write(int32_t argc, Janet *argv) {
+    janet_fixarity(argc, 2);
+    JanetBStream *bs = bstream_get(argv, JANET_STREAM_WRITABLE);
+    JanetByteView bytes = janet_getbytes(argv, 1);
+    if (bs->wcount + (int64_t) bytes.len > bs->wcap) {
+        int64_t newcap = (int64_t) bs->wcount + bytes.len;
+        if (newcap < bs->size) newcap = bs->size;
+        if (newcap > INT32_MAX) janet_panic("write too large");
+        uint8_t *next = janet_realloc(bs->wbuf, (size_t) newcap);
+        if (NULL == next) {
+            JANET_OUT_OF_MEMORY;
+        }
+        bs->wbuf = next;
+        bs->wcap = (int32_t) newcap;
+    }
+    safe_memcpy(bs->wbuf + bs->wcount, bytes.bytes, bytes.len);
+    bs->wcount += bytes.len;
+    if (bs->wcount < bs->size) return janet_wrap_nil();
+    return bstream_run(bs, JANET_BSTREAM_FLUSH);
+}
+
+static Janet bstream_cfun_flush(int32_t argc, Janet *argv) {
+    janet_fixarity(argc, 1);
+    JanetBStream *bs = bstream_get(argv, 0);
+    return bstream_run(bs, JANET_BSTREAM_FLUSH);
+}
+
+static Janet bstream_cfun_close(int32_t argc, Janet *argv) {
+    janet_fixarity(argc, 1);
+    JanetBStream *bs = janet_getabstract(argv, 0, &janet_bstream_type);
+    if (bs->stream->flags & JANET_STREAM_CLOSED) return janet_wrap_nil();
+    bs = bstream_get(argv, 0);
+    return bstream_run(bs, JANET_BSTREAM_CLOSE);
+}
+
+static const JanetMethod bstream_methods[] = {
+    {"read", bstream_read},
+    {"read-until", bstream_cfun_read_until},
+    {"read-line", bstream_cfun_read_line},
+    {"write", bstream_cfun_write},
+    {"flush", bstream_cfun_flush},
+    {"close", bstream_cfun_close},
+    {NULL, NULL}
+};
+
+static int bstream_getter(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD)) return 0;
+    return janet_getmethod(janet_unwrap_keyword(key), bstream_methods, out);
+}
+
+JANET_CORE_FN(janet_cfun_stream_buffered,
+              "(ev/buffered stream &opt size)",
+              "Wrap a stream, such as a file opened with `os/open`, in a buffered stream. The system calls "
+              "of a buffered stream run on the thread pool, so reading and writing regular files does not "
+              "block other fibers on the event loop. Reads fill a read ahead buffer of `size` bytes (default "
+              "65536), and writes are collected in a write behind buffer that is written out once it holds "
+              "`size` bytes, on `:flush`, and on `:close`. Buffered streams have the following methods:\n\n"
+              "* `(:read bs n &opt buf)` - read up to `n` bytes, or until end of file if `n` is `:all`. "
+              "Returns nil at end of file.\n"
+              "* `(:read-until bs delim &opt buf)` - read up to and including the byte sequence `delim`, or "
+              "until end of file. Returns nil at end of file.\n"
+              "* `(:read-line bs &opt buf)` - same as `(:read-until bs \"\\n\" buf)`.\n"
+              "* `(:write bs data)` - add bytes to the write buffer, waiting for a write if it is full.\n"
+              "* `(:flush bs)` - write out the write buffer.\n"
+              "* `(:close bs)` - flush and close the underlying stream.\n\n"
+              "Only one fiber can use a buffered stream at a time. Buffered data that was not flushed is "
+              "lost if the buffered stream is garbage collected. Not available on Windows.") {
+    janet_arity(argc, 1, 2);
+    JanetStream *stream = janet_getabstract(argv, 0, &janet_stream_type);
+    int32_t size = janet_optnat(argv, argc, 1, JANET_BSTREAM_DEFAULT_SIZE);
+    if (size < 16) size = 16;
+    JanetBStream *bs = janet_abstract(&janet_bstream_type, sizeof(JanetBStream));
+    memset(bs, 0, sizeof(JanetBStream));
+    bs->stream = stream;
+    bs->size = size;
+    bs->rbuf = janet_malloc((size_t) size);
+    if (NULL == bs->rbuf) {
+        JANET_OUT_OF_MEMORY;
+    }
+    return janet_wrap_abstract(bs);
+}
+
+#endif
+
 static int mutexgc(void *p, size_t size) {
     (void) size;
     janet_os_mutex_deinit(p);
@@ -3267,20 +5842,52 @@ JANET_CORE_FN(janet_cfun_ev_all_tasks,
     return janet_wrap_array(array);
 }
 
+JANET_CORE_FN(janet_cfun_ev_fiber_stats,
+              "(ev/fiber-stats)",
+              "Get a table describing fiber memory in the current thread with the following keys:\n\n"
+              "* :fibers - number of fibers in the heap, including garbage\n\n"
+              "* :stack-bytes - bytes of stack memory owned by those fibers\n\n"
+              "* :pooled - number of stacks of collected fibers kept for reuse\n\n"
+              "* :pooled-bytes - bytes of stack memory kept for reuse") {
+    janet_fixarity(argc, 0);
+    (void) argv;
+    size_t pooled_bytes = 0;
+    for (int32_t i = 0; i < janet_vm.fiber_pool_count; i++) {
+        pooled_bytes += sizeof(Janet) * (size_t) janet_vm.fiber_pool[i].capacity;
+    }
+    JanetTable *t = janet_table(4);
+    janet_table_put(t, janet_ckeywordv("fibers"), janet_wrap_number((double) janet_vm.fiber_count));
+    janet_table_put(t, janet_ckeywordv("stack-bytes"), janet_wrap_number((double) janet_vm.fiber_stack_bytes));
+    janet_table_put(t, janet_ckeywordv("pooled"), janet_wrap_number((double) janet_vm.fiber_pool_count));
+    janet_table_put(t, janet_ckeywordv("pooled-bytes"), janet_wrap_number((double) pooled_bytes));
+    return janet_wrap_table(t);
+}
+
 void janet_lib_ev(JanetTable *env) {
     JanetRegExt ev_cfuns_ext[] = {
         JANET_CORE_REG("ev/give", cfun_channel_push),
         JANET_CORE_REG("ev/take", cfun_channel_pop),
+        JANET_CORE_REG("ev/give-many", cfun_channel_push_many),
+        JANET_CORE_REG("ev/take-many", cfun_channel_pop_many),
         JANET_CORE_REG("ev/full", cfun_channel_full),
         JANET_CORE_REG("ev/capacity", cfun_channel_capacity),
         JANET_CORE_REG("ev/count", cfun_channel_count),
         JANET_CORE_REG("ev/select", cfun_channel_choice),
         JANET_CORE_REG("ev/rselect", cfun_channel_rchoice),
+        JANET_CORE_REG("ev/select-set", cfun_select_set_new),
+        JANET_CORE_REG("ev/select-take", cfun_select_set_take),
+        JANET_CORE_REG("ev/select-close", cfun_select_set_close),
         JANET_CORE_REG("ev/chan", cfun_channel_new),
         JANET_CORE_REG("ev/thread-chan", cfun_channel_new_threaded),
         JANET_CORE_REG("ev/chan-close", cfun_channel_close),
         JANET_CORE_REG("ev/go", cfun_ev_go),
         JANET_CORE_REG("ev/thread", cfun_ev_thread),
+        JANET_CORE_REG("ev/pool-size", cfun_ev_pool_size),
+        JANET_CORE_REG("ev/share-symbols", cfun_ev_share_symbols),
+        JANET_CORE_REG("ev/stats", cfun_ev_stats),
+        JANET_CORE_REG("ev/slow-task-hook", cfun_ev_slow_task_hook),
+        JANET_CORE_REG("ev/preempt", cfun_ev_preempt),
+        JANET_CORE_REG("ev/time-slice", cfun_ev_time_slice),
         JANET_CORE_REG("ev/give-supervisor", cfun_ev_give_supervisor),
         JANET_CORE_REG("ev/sleep", cfun_ev_sleep),
         JANET_CORE_REG("ev/deadline", cfun_ev_deadline),
@@ -3289,6 +5896,10 @@ void janet_lib_ev(JanetTable *env) {
         JANET_CORE_REG("ev/read", janet_cfun_stream_read),
         JANET_CORE_REG("ev/chunk", janet_cfun_stream_chunk),
         JANET_CORE_REG("ev/write", janet_cfun_stream_write),
+        JANET_CORE_REG("ev/splice", janet_cfun_stream_splice),
+#ifndef JANET_WINDOWS
+        JANET_CORE_REG("ev/buffered", janet_cfun_stream_buffered),
+#endif
         JANET_CORE_REG("ev/lock", janet_cfun_mutex),
         JANET_CORE_REG("ev/acquire-lock", janet_cfun_mutex_acquire),
         JANET_CORE_REG("ev/release-lock", janet_cfun_mutex_release),
@@ -3298,6 +5909,7 @@ void janet_lib_ev(JanetTable *env) {
         JANET_CORE_REG("ev/release-rlock", janet_cfun_rwlock_read_release),
         JANET_CORE_REG("ev/release-wlock", janet_cfun_rwlock_write_release),
         JANET_CORE_REG("ev/all-tasks", janet_cfun_ev_all_tasks),
+        JANET_CORE_REG("ev/fiber-stats", janet_cfun_ev_fiber_stats),
         JANET_REG_END
     };
 
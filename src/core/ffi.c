@@ -174,6 +174,9 @@ typedef struct {
     uint32_t word_count;
     uint32_t variant;
     uint32_t stack_count;
+    /* Set when every argument is a scalar that fits in a single register and the
+     * return value comes back in registers, so calls can skip janet_ffi_write_one. */
+    uint32_t registers_only;
     JanetFFICallingConvention cc;
     JanetFFIMapping ret;
     JanetFFIMapping args[JANET_FFI_MAX_ARGS];
@@ -772,6 +775,7 @@ JANET_CORE_FN(cfun_ffi_signature,
     uint32_t variant = 0;
     uint32_t arg_count = argc - 2;
     uint32_t stack_count = 0;
+    uint32_t registers_only = 0;
     JanetFFICallingConvention cc = decode_ffi_cc(janet_getkeyword(argv, 0));
     JanetFFIType ret_type = decode_ffi_type(argv[1]);
     JanetFFIMapping ret = {
@@ -957,6 +961,17 @@ JANET_CORE_FN(cfun_ffi_signature,
                     break;
                 }
             }
+
+            registers_only = (stack_count == 0) &&
+                             (ret.spec != JANET_SYSV64_MEMORY) &&
+                             (ret.type.array_count < 0) &&
+                             (ret.type.prim != JANET_FFI_TYPE_STRUCT);
+            for (uint32_t i = 0; i < arg_count && registers_only; i++) {
+                JanetFFIMapping arg = mappings[i];
+                registers_only = (arg.spec == JANET_SYSV64_INTEGER || arg.spec == JANET_SYSV64_SSE) &&
+                                 (arg.type.array_count < 0) &&
+                                 (arg.type.prim != JANET_FFI_TYPE_STRUCT);
+            }
         }
         break;
 #endif
@@ -970,6 +985,7 @@ JANET_CORE_FN(cfun_ffi_signature,
     abst->arg_count = arg_count;
     abst->variant = variant;
     abst->stack_count = stack_count;
+    abst->registers_only = registers_only;
     memcpy(abst->args, mappings, sizeof(JanetFFIMapping) * JANET_FFI_MAX_ARGS);
     return janet_wrap_abstract(abst);
 }
@@ -1007,7 +1023,39 @@ typedef sysv64_intsse_return janet_sysv64_variant_3(uint64_t a, uint64_t b, uint
 typedef sysv64_sseint_return janet_sysv64_variant_4(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t e, uint64_t f,
         double r1, double r2, double r3, double r4, double r5, double r6, double r7, double r8);
 
-static Janet janet_ffi_sysv64(JanetFFISignature *signature, void *function_pointer, const Janet *argv) {
+/* Convert a scalar argument to a full integer register. Narrow integers are sign or zero
+ * extended so the upper bits of the register are never left uninitialized. */
+static uint64_t janet_ffi_sysv64_word(const Janet *argv, int32_t n, JanetFFIPrimType prim) {
+    switch (prim) {
+        default:
+            janet_panic("nyi");
+        case JANET_FFI_TYPE_PTR:
+            return (uint64_t) janet_ffi_getpointer(argv, n);
+        case JANET_FFI_TYPE_STRING:
+            return (uint64_t) janet_getcstring(argv, n);
+        case JANET_FFI_TYPE_BOOL:
+            return (uint64_t) janet_getboolean(argv, n);
+        case JANET_FFI_TYPE_INT8:
+            return (uint64_t)(int64_t)(int8_t) janet_getinteger(argv, n);
+        case JANET_FFI_TYPE_INT16:
+            return (uint64_t)(int64_t)(int16_t) janet_getinteger(argv, n);
+        case JANET_FFI_TYPE_INT32:
+            return (uint64_t)(int64_t) janet_getinteger(argv, n);
+        case JANET_FFI_TYPE_INT64:
+            return (uint64_t) janet_getinteger64(argv, n);
+        case JANET_FFI_TYPE_UINT8:
+            return (uint8_t) janet_getuinteger64(argv, n);
+        case JANET_FFI_TYPE_UINT16:
+            return (uint16_t) janet_getuinteger64(argv, n);
+        case JANET_FFI_TYPE_UINT32:
+            return (uint32_t) janet_getuinteger64(argv, n);
+        case JANET_FFI_TYPE_UINT64:
+            return janet_getuinteger64(argv, n);
+    }
+}
+
+/* Arguments are read from argv starting at index base. */
+static Janet janet_ffi_sysv64(JanetFFISignature *signature, void *function_pointer, const Janet *argv, int32_t base) {
     union {
         sysv64_int_return int_return;
         sysv64_sse_return sse_return;
@@ -1023,10 +1071,24 @@ static Janet janet_ffi_sysv64(JanetFFISignature *signature, void *function_point
         ret_mem = alloca(type_size(signature->ret.type));
         regs[0] = (uint64_t) ret_mem;
     }
+    if (signature->registers_only) {
+        for (uint32_t i = 0; i < signature->arg_count; i++) {
+            const JanetFFIMapping *arg = signature->args + i;
+            int32_t n = i + base;
+            if (arg->spec == JANET_SYSV64_INTEGER) {
+                regs[arg->offset] = janet_ffi_sysv64_word(argv, n, arg->type.prim);
+            } else if (arg->type.prim == JANET_FFI_TYPE_FLOAT) {
+                ((float *)(fp_regs + arg->offset))[0] = (float) janet_getnumber(argv, n);
+            } else {
+                fp_regs[arg->offset] = janet_getnumber(argv, n);
+            }
+        }
+        goto call;
+    }
     uint64_t *stack = alloca(sizeof(uint64_t) * signature->stack_count);
     for (uint32_t i = 0; i < signature->arg_count; i++) {
         uint64_t *to;
-        int32_t n = i + 2;
+        int32_t n = i + base;
         JanetFFIMapping arg = signature->args[i];
         switch (arg.spec) {
             default:
@@ -1064,6 +1126,7 @@ static Janet janet_ffi_sysv64(JanetFFISignature *signature, void *function_point
         janet_ffi_write_one(to, argv, n, arg.type, JANET_FFI_MAX_RECUR);
     }
 
+call:
     switch (signature->variant) {
         case 0:
             retu.int_return = ((janet_sysv64_variant_1 *)(function_pointer))(
@@ -1142,7 +1205,7 @@ typedef double (win64_variant_f_ffif)(double, double, uint64_t, double);
 typedef double (win64_variant_f_fffi)(double, double, double, uint64_t);
 typedef double (win64_variant_f_ffff)(double, double, double, double);
 
-static Janet janet_ffi_win64(JanetFFISignature *signature, void *function_pointer, const Janet *argv) {
+static Janet janet_ffi_win64(JanetFFISignature *signature, void *function_pointer, const Janet *argv, int32_t base) {
     union {
         uint64_t integer;
         double real;
@@ -1161,7 +1224,7 @@ static Janet janet_ffi_win64(JanetFFISignature *signature, void *function_pointe
     size_t stack_shift = 2;
     uint64_t *stack = alloca(stack_size);
     for (uint32_t i = 0; i < signature->arg_count; i++) {
-        int32_t n = i + 2;
+        int32_t n = i + base;
         JanetFFIMapping arg = signature->args[i];
         if (arg.spec == JANET_WIN64_STACK) {
             janet_ffi_write_one(stack + arg.offset, argv, n, arg.type, JANET_FFI_MAX_RECUR);
@@ -1294,6 +1357,53 @@ static Janet janet_ffi_win64(JanetFFISignature *signature, void *function_pointe
 
 #endif
 
+static Janet janet_ffi_dispatch(JanetFFISignature *signature, void *function_pointer, const Janet *argv, int32_t base) {
+    switch (signature->cc) {
+        default:
+        case JANET_FFI_CC_NONE:
+            (void) function_pointer;
+            (void) argv;
+            (void) base;
+            janet_panic("calling convention not supported");
+#ifdef JANET_FFI_WIN64_ENABLED
+        case JANET_FFI_CC_WIN_64:
+            return janet_ffi_win64(signature, function_pointer, argv, base);
+#endif
+#ifdef JANET_FFI_SYSV64_ENABLED
+        case JANET_FFI_CC_SYSV_64:
+            return janet_ffi_sysv64(signature, function_pointer, argv, base);
+#endif
+    }
+}
+
+/* A function pointer bound to a signature with ffi/bind */
+typedef struct {
+    void *function_pointer;
+    Janet pointer;
+    JanetFFISignature *signature;
+} JanetFFIFunction;
+
+static int janet_ffi_function_mark(void *p, size_t s) {
+    (void) s;
+    JanetFFIFunction *fn = p;
+    janet_mark(fn->pointer);
+    janet_mark(janet_wrap_abstract(fn->signature));
+    return 0;
+}
+
+static Janet janet_ffi_function_call(void *p, int32_t argc, Janet *argv) {
+    janet_sandbox_assert(JANET_SANDBOX_FFI_USE);
+    JanetFFIFunction *fn = p;
+    janet_fixarity(argc, fn->signature->arg_count);
+    return janet_ffi_dispatch(fn->signature, fn->function_pointer, argv, 0);
+}
+
+static const JanetAbstractType janet_function_type = {
+    .name = "core/ffi-function",
+    .gcmark = janet_ffi_function_mark,
+    .call = janet_ffi_function_call
+};
+
 /* Allocate executable memory chunks in sizes of a page. Ideally we would keep
  * an allocator around so that multiple JIT allocations would point to the same
  * region but it isn't really worth it. */
@@ -1361,20 +1471,23 @@ JANET_CORE_FN(cfun_ffi_call,
     void *function_pointer = janet_ffi_get_callable_pointer(argv, 0);
     JanetFFISignature *signature = janet_getabstract(argv, 1, &janet_signature_type);
     janet_fixarity(argc - 2, signature->arg_count);
-    switch (signature->cc) {
-        default:
-        case JANET_FFI_CC_NONE:
-            (void) function_pointer;
-            janet_panic("calling convention not supported");
-#ifdef JANET_FFI_WIN64_ENABLED
-        case JANET_FFI_CC_WIN_64:
-            return janet_ffi_win64(signature, function_pointer, argv);
-#endif
-#ifdef JANET_FFI_SYSV64_ENABLED
-        case JANET_FFI_CC_SYSV_64:
-            return janet_ffi_sysv64(signature, function_pointer, argv);
-#endif
-    }
+    return janet_ffi_dispatch(signature, function_pointer, argv, 2);
+}
+
+JANET_CORE_FN(cfun_ffi_bind,
+              "(ffi/bind pointer signature)",
+              "Bind a function pointer to a signature, returning a callable value. Calling the "
+              "result with arguments is equivalent to `(ffi/call pointer signature ;args)` but skips "
+              "decoding the pointer and signature on every call.") {
+    janet_sandbox_assert(JANET_SANDBOX_FFI_USE);
+    janet_fixarity(argc, 2);
+    void *function_pointer = janet_ffi_get_callable_pointer(argv, 0);
+    JanetFFISignature *signature = janet_getabstract(argv, 1, &janet_signature_type);
+    JanetFFIFunction *fn = janet_abstract(&janet_function_type, sizeof(JanetFFIFunction));
+    fn->function_pointer = function_pointer;
+    fn->pointer = argv[0];
+    fn->signature = signature;
+    return janet_wrap_abstract(fn);
 }
 
 JANET_CORE_FN(cfun_ffi_buffer_write,
@@ -1420,6 +1533,142 @@ JANET_CORE_FN(cfun_ffi_buffer_read,
     }
 }
 
+static JanetFFIStruct *janet_ffi_getstruct(const Janet *argv, int32_t n) {
+    JanetFFIType type = decode_ffi_type(argv[n]);
+    if (type.prim != JANET_FFI_TYPE_STRUCT || type.array_count >= 0) {
+        janet_panicf("bad slot #%d, expected struct type, got %v", n, argv[n]);
+    }
+    return type.st;
+}
+
+/* Get a pointer to len bytes at offset from either a raw pointer or a byte sequence. Raw
+ * pointers are not bounds checked. */
+static uint8_t *janet_ffi_getrange(const Janet *argv, int32_t n, size_t offset, size_t len) {
+    if (janet_checktype(argv[n], JANET_POINTER)) {
+        return (uint8_t *) janet_unwrap_pointer(argv[n]) + offset;
+    }
+    JanetByteView bytes = janet_getbytes(argv, n);
+    if ((size_t) bytes.len < offset + len) janet_panic("index out of range");
+    return (uint8_t *) bytes.bytes + offset;
+}
+
+static uint32_t janet_ffi_getfield(JanetFFIStruct *st, const Janet *argv, int32_t n) {
+    int32_t field = janet_getnat(argv, n);
+    if ((uint32_t) field >= st->field_count) {
+        janet_panicf("field index %d out of range [0, %d)", field, (int32_t) st->field_count);
+    }
+    return (uint32_t) field;
+}
+
+JANET_CORE_FN(cfun_ffi_read_columns,
+              "(ffi/read-columns struct-type bytes count &opt offset)",
+              "Parse `count` consecutive native structs out of a buffer into columns. Returns an array "
+              "with one array per struct field, so that the nth element of each column comes from the nth "
+              "struct. Unlike calling `ffi/read` in a loop, no tuple is created per struct. `bytes` can also be "
+              "a raw pointer, although this is unsafe.") {
+    janet_sandbox_assert(JANET_SANDBOX_FFI_USE);
+    janet_arity(argc, 3, 4);
+    JanetFFIStruct *st = janet_ffi_getstruct(argv, 0);
+    int32_t count = janet_getnat(argv, 2);
+    size_t offset = (size_t) janet_optnat(argv, argc, 3, 0);
+    const uint8_t *from = janet_ffi_getrange(argv, 1, offset, (size_t) st->size * count);
+    JanetArray *columns = janet_array(st->field_count);
+    for (uint32_t i = 0; i < st->field_count; i++) {
+        JanetFFIStructMember member = st->fields[i];
+        JanetArray *column = janet_array(count);
+        const uint8_t *cursor = from + member.offset;
+        for (int32_t j = 0; j < count; j++) {
+            column->data[column->count++] = janet_ffi_read_one(cursor, member.type, JANET_FFI_MAX_RECUR);
+            cursor += st->size;
+        }
+        janet_array_push(columns, janet_wrap_array(column));
+    }
+    return janet_wrap_array(columns);
+}
+
+JANET_CORE_FN(cfun_ffi_write_columns,
+              "(ffi/write-columns struct-type columns &opt buffer index)",
+              "Append native structs to a buffer from columns of field values. `columns` must contain one "
+              "indexed collection per struct field, all of the same length. This is the inverse of "
+              "`ffi/read-columns`. Returns a modifed buffer or a new buffer if one is not supplied.") {
+    janet_sandbox_assert(JANET_SANDBOX_FFI_USE);
+    janet_arity(argc, 2, 4);
+    JanetFFIStruct *st = janet_ffi_getstruct(argv, 0);
+    JanetView columns = janet_getindexed(argv, 1);
+    if ((uint32_t) columns.len != st->field_count) {
+        janet_panicf("wrong number of columns, expected %d, got %d", (int32_t) st->field_count, columns.len);
+    }
+    int32_t count = 0;
+    for (int32_t i = 0; i < columns.len; i++) {
+        JanetView column = janet_getindexed(columns.items, i);
+        if (i == 0) {
+            count = column.len;
+        } else if (column.len != count) {
+            janet_panicf("column %d has length %d, expected %d", i, column.len, count);
+        }
+    }
+    int64_t total = (int64_t) st->size * count;
+    if (total > INT32_MAX) janet_panic("columns too large");
+    JanetBuffer *buffer = janet_optbuffer(argv, argc, 2, (int32_t) total);
+    int32_t index = janet_optnat(argv, argc, 3, 0);
+    int32_t old_count = buffer->count;
+    if (index > old_count) janet_panic("index out of bounds");
+    buffer->count = index;
+    janet_buffer_extra(buffer, (int32_t) total);
+    buffer->count = old_count;
+    uint8_t *to = buffer->data + index;
+    memset(to, 0, (size_t) total);
+    for (int32_t i = 0; i < columns.len; i++) {
+        JanetFFIStructMember member = st->fields[i];
+        JanetView column = janet_getindexed(columns.items, i);
+        uint8_t *cursor = to + member.offset;
+        for (int32_t j = 0; j < count; j++) {
+            janet_ffi_write_one(cursor, column.items, j, member.type, JANET_FFI_MAX_RECUR);
+            cursor += st->size;
+        }
+    }
+    index += (int32_t) total;
+    if (buffer->count < index) buffer->count = index;
+    return janet_wrap_buffer(buffer);
+}
+
+JANET_CORE_FN(cfun_ffi_read_field,
+              "(ffi/read-field struct-type field bytes &opt index offset)",
+              "Read a single field of the struct at position `index` in an array of native structs "
+              "starting at `offset` in `bytes`, without converting the rest of the struct. `field` is "
+              "the index of the field in the struct type. `bytes` can also be a raw pointer, although "
+              "this is unsafe.") {
+    janet_sandbox_assert(JANET_SANDBOX_FFI_USE);
+    janet_arity(argc, 3, 5);
+    JanetFFIStruct *st = janet_ffi_getstruct(argv, 0);
+    uint32_t field = janet_ffi_getfield(st, argv, 1);
+    size_t index = (size_t) janet_optnat(argv, argc, 3, 0);
+    size_t offset = (size_t) janet_optnat(argv, argc, 4, 0);
+    JanetFFIStructMember member = st->fields[field];
+    offset += index * st->size + member.offset;
+    const uint8_t *from = janet_ffi_getrange(argv, 2, offset, type_size(member.type));
+    return janet_ffi_read_one(from, member.type, JANET_FFI_MAX_RECUR);
+}
+
+JANET_CORE_FN(cfun_ffi_write_field,
+              "(ffi/write-field struct-type field value bytes &opt index offset)",
+              "Overwrite a single field of the struct at position `index` in an array of native "
+              "structs starting at `offset` in `bytes`. `bytes` must be a buffer large enough to hold "
+              "the struct, or a raw pointer, although this is unsafe. Returns `bytes`.") {
+    janet_sandbox_assert(JANET_SANDBOX_FFI_USE);
+    janet_arity(argc, 4, 6);
+    JanetFFIStruct *st = janet_ffi_getstruct(argv, 0);
+    uint32_t field = janet_ffi_getfield(st, argv, 1);
+    size_t index = (size_t) janet_optnat(argv, argc, 4, 0);
+    size_t offset = (size_t) janet_optnat(argv, argc, 5, 0);
+    JanetFFIStructMember member = st->fields[field];
+    offset += index * st->size + member.offset;
+    if (!janet_checktype(argv[3], JANET_POINTER)) janet_getbuffer(argv, 3);
+    uint8_t *to = janet_ffi_getrange(argv, 3, offset, type_size(member.type));
+    janet_ffi_write_one(to, argv, 2, member.type, JANET_FFI_MAX_RECUR);
+    return argv[3];
+}
+
 JANET_CORE_FN(cfun_ffi_get_callback_trampoline,
               "(ffi/trampoline cc)",
               "Get a native function pointer that can be used as a callback and passed to C libraries. "
@@ -1573,9 +1822,14 @@ void janet_lib_ffi(JanetTable *env) {
         JANET_CORE_REG("ffi/close", janet_core_native_close),
         JANET_CORE_REG("ffi/signature", cfun_ffi_signature),
         JANET_CORE_REG("ffi/call", cfun_ffi_call),
+        JANET_CORE_REG("ffi/bind", cfun_ffi_bind),
         JANET_CORE_REG("ffi/struct", cfun_ffi_struct),
         JANET_CORE_REG("ffi/write", cfun_ffi_buffer_write),
         JANET_CORE_REG("ffi/read", cfun_ffi_buffer_read),
+        JANET_CORE_REG("ffi/read-columns", cfun_ffi_read_columns),
+        JANET_CORE_REG("ffi/write-columns", cfun_ffi_write_columns),
+        JANET_CORE_REG("ffi/read-field", cfun_ffi_read_field),
+        JANET_CORE_REG("ffi/write-field", cfun_ffi_write_field),
         JANET_CORE_REG("ffi/size", cfun_ffi_size),
         JANET_CORE_REG("ffi/align", cfun_ffi_align),
         JANET_CORE_REG("ffi/trampoline", cfun_ffi_get_callback_trampoline),
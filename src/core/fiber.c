@@ -42,6 +42,7 @@ static void fiber_reset(JanetFiber *fiber) {
     fiber->waiting = NULL;
     fiber->sched_id = 0;
     fiber->supervisor_channel = NULL;
+    fiber->time_slice = 0;
 #endif
     janet_fiber_set_status(fiber, JANET_STATUS_NEW);
 }
@@ -52,16 +53,67 @@ static JanetFiber *fiber_alloc(int32_t capacity) {
     if (capacity < 32) {
         capacity = 32;
     }
-    fiber->capacity = capacity;
-    data = janet_malloc(sizeof(Janet) * (size_t) capacity);
-    if (NULL == data) {
-        JANET_OUT_OF_MEMORY;
+    int32_t n = janet_vm.fiber_pool_count;
+    if (n > 0 && janet_vm.fiber_pool[n - 1].capacity >= capacity) {
+        /* Reuse the stack of a collected fiber */
+        janet_vm.fiber_pool_count = n - 1;
+        data = janet_vm.fiber_pool[n - 1].data;
+        capacity = janet_vm.fiber_pool[n - 1].capacity;
+    } else {
+        /* Drop a pooled stack that is too small so it does not block the pool */
+        if (n > 0) {
+            janet_vm.fiber_pool_count = n - 1;
+            janet_free(janet_vm.fiber_pool[n - 1].data);
+        }
+        data = janet_malloc(sizeof(Janet) * (size_t) capacity);
+        if (NULL == data) {
+            JANET_OUT_OF_MEMORY;
+        }
+        janet_vm.next_collection += sizeof(Janet) * capacity;
     }
-    janet_vm.next_collection += sizeof(Janet) * capacity;
+    fiber->capacity = capacity;
     fiber->data = data;
+    janet_vm.fiber_count++;
+    janet_vm.fiber_stack_bytes += sizeof(Janet) * (size_t) capacity;
     return fiber;
 }
 
+/* Release the stack of a collected fiber, keeping small stacks for reuse */
+void janet_fiber_free_stack(JanetFiber *fiber) {
+    janet_vm.fiber_count--;
+    janet_vm.fiber_stack_bytes -= sizeof(Janet) * (size_t) fiber->capacity;
+    if (NULL == fiber->data) return;
+    if (fiber->capacity <= JANET_FIBER_POOL_STACK &&
+            janet_vm.fiber_pool_count < JANET_FIBER_POOL_SIZE) {
+        JanetFiberStack *entry = janet_vm.fiber_pool + janet_vm.fiber_pool_count++;
+        entry->data = fiber->data;
+        entry->capacity = fiber->capacity;
+    } else {
+        janet_free(fiber->data);
+    }
+}
+
+/* Free all pooled fiber stacks */
+void janet_fiber_pool_clear(void) {
+    for (int32_t i = 0; i < janet_vm.fiber_pool_count; i++) {
+        janet_free(janet_vm.fiber_pool[i].data);
+    }
+    janet_vm.fiber_pool_count = 0;
+}
+
+/* Shrink the stack of a fiber that is not running if most of it is
+ * unused, for example after a deep recursion. Called by the GC. */
+void janet_fiber_trim(JanetFiber *fiber) {
+    if (janet_fiber_status(fiber) == JANET_STATUS_ALIVE) return;
+    int32_t needed = fiber->stacktop < 16 ? 32 : 2 * fiber->stacktop;
+    if (fiber->capacity <= JANET_FIBER_POOL_STACK || needed > fiber->capacity / 4) return;
+    Janet *newData = janet_realloc(fiber->data, sizeof(Janet) * (size_t) needed);
+    if (NULL == newData) return;
+    janet_vm.fiber_stack_bytes -= sizeof(Janet) * (size_t)(fiber->capacity - needed);
+    fiber->data = newData;
+    fiber->capacity = needed;
+}
+
 /* Create a new fiber with argn values on the stack by reusing a fiber. */
 JanetFiber *janet_fiber_reset(JanetFiber *fiber, JanetFunction *callee, int32_t argc, const Janet *argv) {
     int32_t newstacktop;
@@ -123,6 +175,7 @@ void janet_fiber_setcapacity(JanetFiber *fiber, int32_t n) {
     fiber->data = newData;
     fiber->capacity = n;
     janet_vm.next_collection += sizeof(Janet) * diff;
+    janet_vm.fiber_stack_bytes += sizeof(Janet) * diff;
 }
 
 /* Grow fiber if needed */
@@ -247,22 +300,51 @@ int janet_fiber_funcframe(JanetFiber *fiber, JanetFunction *func) {
     return 0;
 }
 
+/* Escape analysis only follows closures through bytecode. Introspection
+ * such as debug/stack can still hand out closures over a live frame, so it
+ * marks their environments to be kept when the frame returns. */
+void janet_env_escape(JanetFuncEnv *env) {
+    if (env) env->gc.flags |= JANET_FUNCENV_FLAG_ESCAPED;
+}
+
+void janet_function_escape(JanetFunction *func) {
+    for (int32_t i = 0; i < func->def->environments_length; i++) {
+        janet_env_escape(func->envs[i]);
+    }
+}
+
 /* If a frame has a closure environment, detach it from
  * the stack and have it keep its own values */
 static void janet_env_detach(JanetFuncEnv *env) {
     /* Check for closure environment */
     if (env) {
-        janet_env_valid(env);
+        if (!janet_env_valid(env)) return;
+        Janet *values = env->as.fiber->data + env->offset;
+        JanetFuncDef *def = janet_stack_frame(values)->func->def;
+        uint32_t *bitset = def->closure_bitset;
         int32_t len = env->length;
+        if ((def->flags & JANET_FUNCDEF_FLAG_NOESCAPE) &&
+                !(env->gc.flags & JANET_FUNCENV_FLAG_ESCAPED)) {
+            /* No closure over this frame outlives it */
+            len = 0;
+        } else if (bitset) {
+            /* Only keep slots up to the last captured one */
+            while (len > 0 && !(bitset[(len - 1) >> 5] & (1U << ((len - 1) & 31)))) len--;
+        }
+        if (len == 0) {
+            env->offset = 0;
+            env->length = 0;
+            env->as.values = NULL;
+            return;
+        }
         size_t s = sizeof(Janet) * (size_t) len;
         Janet *vmem = janet_malloc(s);
         janet_vm.next_collection += (uint32_t) s;
         if (NULL == vmem) {
             JANET_OUT_OF_MEMORY;
         }
-        Janet *values = env->as.fiber->data + env->offset;
         safe_memcpy(vmem, values, s);
-        uint32_t *bitset = janet_stack_frame(values)->func->def->closure_bitset;
+        env->length = len;
         if (bitset) {
             /* Clear unneeded references in closure environment */
             for (int32_t i = 0; i < len; i += 32) {
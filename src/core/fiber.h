@@ -60,6 +60,11 @@
 #define JANET_FIBER_EV_FLAG_SUSPENDED 0x20000
 #define JANET_FIBER_FLAG_ROOT 0x40000
 
+/* Set on a closure environment that may be reached after its frame returns,
+ * even though escape analysis marked the function JANET_FUNCDEF_FLAG_NOESCAPE.
+ * Such environments are always copied off the stack. */
+#define JANET_FUNCENV_FLAG_ESCAPED 0x10000
+
 #define janet_fiber_set_status(f, s) do {\
     (f)->flags &= ~JANET_FIBER_STATUS_MASK;\
     (f)->flags |= (s) << JANET_FIBER_STATUS_OFFSET;\
@@ -68,6 +73,9 @@
 #define janet_stack_frame(s) ((JanetStackFrame *)((s) - JANET_FRAME_SIZE))
 #define janet_fiber_frame(f) janet_stack_frame((f)->data + (f)->frame)
 void janet_fiber_setcapacity(JanetFiber *fiber, int32_t n);
+void janet_fiber_free_stack(JanetFiber *fiber);
+void janet_fiber_pool_clear(void);
+void janet_fiber_trim(JanetFiber *fiber);
 void janet_fiber_push(JanetFiber *fiber, Janet x);
 void janet_fiber_push2(JanetFiber *fiber, Janet x, Janet y);
 void janet_fiber_push3(JanetFiber *fiber, Janet x, Janet y, Janet z);
@@ -75,6 +83,8 @@ void janet_fiber_pushn(JanetFiber *fiber, const Janet *arr, int32_t n);
 int janet_fiber_funcframe(JanetFiber *fiber, JanetFunction *func);
 int janet_fiber_funcframe_tail(JanetFiber *fiber, JanetFunction *func);
 void janet_fiber_cframe(JanetFiber *fiber, JanetCFunction cfun);
+void janet_env_escape(JanetFuncEnv *env);
+void janet_function_escape(JanetFunction *func);
 void janet_fiber_popframe(JanetFiber *fiber);
 void janet_env_maybe_detach(JanetFuncEnv *env);
 int janet_env_valid(JanetFuncEnv *env);
@@ -47,6 +47,13 @@ static void janet_mark_abstract(void *adata);
 /* Local state that is only temporary for gc */
 static JANET_THREAD_LOCAL uint32_t depth = JANET_RECURSION_GUARD;
 static JANET_THREAD_LOCAL size_t orig_rootcount;
+static JANET_THREAD_LOCAL JanetTable **weak_tables;
+
+/* Count a live object found during the mark phase */
+#define janet_gc_count(type, nbytes) do { \
+    janet_vm.gc_stats.live_count[(type)]++; \
+    janet_vm.gc_stats.live_bytes[(type)] += (nbytes); \
+} while (0)
 
 /* Hint to the GC that we may need to collect */
 void janet_gcpressure(size_t s) {
@@ -97,11 +104,26 @@ void janet_mark(Janet x) {
 }
 
 static void janet_mark_string(const uint8_t *str) {
-    janet_gc_mark(janet_string_head(str));
+    JanetStringHead *head = janet_string_head(str);
+    if (janet_gc_reachable(head))
+        return;
+#ifdef JANET_EV
+    /* Threaded strings are shared with other threads and live outside the heap,
+     * so like threaded abstract types they are marked in the threaded_abstracts table. */
+    if ((head->gc.flags & JANET_MEM_TYPEBITS) == JANET_MEMORY_THREADED_STRING) {
+        janet_table_put(&janet_vm.threaded_abstracts, janet_wrap_pointer((void *) str), janet_wrap_true());
+        return;
+    }
+#endif
+    janet_gc_mark(head);
+    janet_gc_count(head->gc.flags & JANET_MEM_TYPEBITS, sizeof(JanetStringHead) + head->length + 1);
 }
 
 static void janet_mark_buffer(JanetBuffer *buffer) {
+    if (janet_gc_reachable(buffer))
+        return;
     janet_gc_mark(buffer);
+    janet_gc_count(JANET_MEMORY_BUFFER, sizeof(JanetBuffer) + buffer->capacity);
 }
 
 static void janet_mark_abstract(void *adata) {
@@ -116,6 +138,7 @@ static void janet_mark_abstract(void *adata) {
     if (janet_gc_reachable(janet_abstract_head(adata)))
         return;
     janet_gc_mark(janet_abstract_head(adata));
+    janet_gc_count(JANET_MEMORY_ABSTRACT, sizeof(JanetAbstractHead) + janet_abstract_size(adata));
     if (janet_abstract_head(adata)->type->gcmark) {
         janet_abstract_head(adata)->type->gcmark(adata, janet_abstract_size(adata));
     }
@@ -146,6 +169,7 @@ static void janet_mark_array(JanetArray *array) {
     if (janet_gc_reachable(array))
         return;
     janet_gc_mark(array);
+    janet_gc_count(JANET_MEMORY_ARRAY, sizeof(JanetArray) + array->capacity * sizeof(Janet));
     janet_mark_many(array->data, array->count);
 }
 
@@ -154,7 +178,21 @@ recur: /* Manual tail recursion */
     if (janet_gc_reachable(table))
         return;
     janet_gc_mark(table);
-    janet_mark_kvs(table->data, table->capacity);
+    janet_gc_count(JANET_MEMORY_TABLE, sizeof(JanetTable) + table->capacity * sizeof(JanetKV));
+    int32_t weak = table->gc.flags & (JANET_TABLE_FLAG_WEAK_KEYS | JANET_TABLE_FLAG_WEAK_VALUES);
+    if (weak) {
+        /* Only mark the strong half of each entry. Entries whose weak half is
+         * not marked by anything else are removed before the sweep. */
+        janet_v_push(weak_tables, table);
+        for (int32_t i = 0; i < table->capacity; i++) {
+            JanetKV *kv = table->data + i;
+            if (janet_checktype(kv->key, JANET_NIL)) continue;
+            if (!(weak & JANET_TABLE_FLAG_WEAK_KEYS)) janet_mark(kv->key);
+            if (!(weak & JANET_TABLE_FLAG_WEAK_VALUES)) janet_mark(kv->value);
+        }
+    } else {
+        janet_mark_kvs(table->data, table->capacity);
+    }
     if (table->proto) {
         table = table->proto;
         goto recur;
@@ -166,6 +204,7 @@ recur:
     if (janet_gc_reachable(janet_struct_head(st)))
         return;
     janet_gc_mark(janet_struct_head(st));
+    janet_gc_count(JANET_MEMORY_STRUCT, sizeof(JanetStructHead) + janet_struct_capacity(st) * sizeof(JanetKV));
     janet_mark_kvs(st, janet_struct_capacity(st));
     st = janet_struct_proto(st);
     if (st) goto recur;
@@ -175,6 +214,7 @@ static void janet_mark_tuple(const Janet *tuple) {
     if (janet_gc_reachable(janet_tuple_head(tuple)))
         return;
     janet_gc_mark(janet_tuple_head(tuple));
+    janet_gc_count(JANET_MEMORY_TUPLE, sizeof(JanetTupleHead) + janet_tuple_length(tuple) * sizeof(Janet));
     janet_mark_many(tuple, janet_tuple_length(tuple));
 }
 
@@ -188,9 +228,11 @@ static void janet_mark_funcenv(JanetFuncEnv *env) {
     janet_env_maybe_detach(env);
     if (env->offset > 0) {
         /* On stack */
+        janet_gc_count(JANET_MEMORY_FUNCENV, sizeof(JanetFuncEnv));
         janet_mark_fiber(env->as.fiber);
     } else {
         /* Not on stack */
+        janet_gc_count(JANET_MEMORY_FUNCENV, sizeof(JanetFuncEnv) + env->length * sizeof(Janet));
         janet_mark_many(env->as.values, env->length);
     }
 }
@@ -201,6 +243,15 @@ static void janet_mark_funcdef(JanetFuncDef *def) {
     if (janet_gc_reachable(def))
         return;
     janet_gc_mark(def);
+    /* Shared code is not counted against this VM */
+    size_t code = (def->gc.flags & JANET_FUNCDEF_SHARED_CODE) ? 0 :
+                  def->bytecode_length * sizeof(uint32_t) +
+                  (def->sourcemap ? def->bytecode_length * sizeof(JanetSourceMapping) : 0);
+    janet_gc_count(JANET_MEMORY_FUNCDEF, sizeof(JanetFuncDef) + code +
+                   def->constants_length * sizeof(Janet) +
+                   def->defs_length * sizeof(JanetFuncDef *) +
+                   def->environments_length * sizeof(int32_t) +
+                   def->symbolmap_length * sizeof(JanetSymbolMap));
     janet_mark_many(def->constants, def->constants_length);
     for (i = 0; i < def->defs_length; ++i) {
         janet_mark_funcdef(def->defs[i]);
@@ -223,6 +274,8 @@ static void janet_mark_function(JanetFunction *func) {
     if (janet_gc_reachable(func))
         return;
     janet_gc_mark(func);
+    janet_gc_count(JANET_MEMORY_FUNCTION, sizeof(JanetFunction) +
+                   (NULL != func->def ? func->def->environments_length * sizeof(JanetFuncEnv *) : 0));
     if (NULL != func->def) {
         /* this should always be true, except if function is only partially constructed */
         numenvs = func->def->environments_length;
@@ -240,6 +293,8 @@ recur:
     if (janet_gc_reachable(fiber))
         return;
     janet_gc_mark(fiber);
+    janet_fiber_trim(fiber);
+    janet_gc_count(JANET_MEMORY_FIBER, sizeof(JanetFiber) + fiber->capacity * sizeof(Janet));
 
     janet_mark(fiber->last_value);
 
@@ -293,7 +348,7 @@ static void janet_deinit_block(JanetGCObject *mem) {
             janet_free(((JanetTable *) mem)->data);
             break;
         case JANET_MEMORY_FIBER:
-            janet_free(((JanetFiber *)mem)->data);
+            janet_fiber_free_stack((JanetFiber *)mem);
             break;
         case JANET_MEMORY_BUFFER:
             janet_buffer_deinit((JanetBuffer *) mem);
@@ -317,52 +372,276 @@ static void janet_deinit_block(JanetGCObject *mem) {
             janet_free(def->defs);
             janet_free(def->environments);
             janet_free(def->constants);
-            janet_free(def->bytecode);
-            janet_free(def->sourcemap);
+            if (!(def->gc.flags & JANET_FUNCDEF_SHARED_CODE)) {
+                janet_free(def->bytecode);
+                janet_free(def->sourcemap);
+            }
             janet_free(def->closure_bitset);
             janet_free(def->symbolmap);
+#ifdef JANET_JIT
+            janet_jit_free(def);
+#endif
         }
         break;
     }
 }
 
-/* Iterate over all allocated memory, and free memory that is not
- * marked as reachable. Flip the gc color flag for next sweep. */
-void janet_sweep() {
-    JanetGCObject *previous = NULL;
-    JanetGCObject *current = janet_vm.blocks;
-    JanetGCObject *next;
-    while (NULL != current) {
-        next = current->data.next;
+#ifdef JANET_GC_SLAB
+
+/* Slab allocator for small GC objects. Objects are carved out of fixed size slabs,
+ * with one list of slabs that have free blocks per size class. Slabs are aligned
+ * to their size so that the slab that owns a block can be found by masking the
+ * block address - blocks need no extra header. Slabs are returned to the OS as soon
+ * as they contain no live blocks. Slab memory is not allocated with janet_malloc. */
+
+#ifdef JANET_WINDOWS
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+
+#define JANET_SLAB_SIZE 0x4000
+#define JANET_SLAB_GRANULE 16
+#define JANET_SLAB_MAX (JANET_SLAB_CLASSES * JANET_SLAB_GRANULE)
+#define JANET_SLAB_HEADER 64
+
+typedef struct JanetSlabBlock {
+    struct JanetSlabBlock *next;
+} JanetSlabBlock;
+
+struct JanetSlab {
+    JanetSlab *next;
+    JanetSlab *prev;
+    JanetSlabBlock *free;
+    char *bump; /* Start of the never allocated tail of the slab */
+    uint32_t live;
+    uint32_t block_size;
+    uint32_t size_class;
+    int available; /* Is this slab in janet_vm.slabs? */
+};
+
+static JanetSlab *janet_slab_of(void *block) {
+    return (JanetSlab *)((uintptr_t) block & ~((uintptr_t) JANET_SLAB_SIZE - 1));
+}
+
+static int janet_slab_full(JanetSlab *slab) {
+    return NULL == slab->free && slab->bump + slab->block_size > (char *) slab + JANET_SLAB_SIZE;
+}
+
+static void janet_slab_link(JanetSlab *slab) {
+    JanetSlab **head = janet_vm.slabs + slab->size_class;
+    slab->prev = NULL;
+    slab->next = *head;
+    if (NULL != *head) (*head)->prev = slab;
+    *head = slab;
+    slab->available = 1;
+}
+
+static void janet_slab_unlink(JanetSlab *slab) {
+    if (NULL != slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        janet_vm.slabs[slab->size_class] = slab->next;
+    }
+    if (NULL != slab->next) slab->next->prev = slab->prev;
+    slab->available = 0;
+}
+
+static JanetSlab *janet_slab_new(uint32_t size_class) {
+    void *mem;
+#ifdef JANET_WINDOWS
+    mem = _aligned_malloc(JANET_SLAB_SIZE, JANET_SLAB_SIZE);
+#else
+    if (posix_memalign(&mem, JANET_SLAB_SIZE, JANET_SLAB_SIZE)) mem = NULL;
+#endif
+    if (NULL == mem) {
+        JANET_OUT_OF_MEMORY;
+    }
+    JanetSlab *slab = (JanetSlab *) mem;
+    slab->free = NULL;
+    slab->bump = (char *) mem + JANET_SLAB_HEADER;
+    slab->live = 0;
+    slab->size_class = size_class;
+    slab->block_size = (size_class + 1) * JANET_SLAB_GRANULE;
+    janet_slab_link(slab);
+    return slab;
+}
+
+static void janet_slab_release(JanetSlab *slab) {
+#ifdef JANET_WINDOWS
+    _aligned_free(slab);
+#else
+    free(slab);
+#endif
+}
+
+static void *janet_slab_alloc(size_t size) {
+    uint32_t size_class = (uint32_t)((size + JANET_SLAB_GRANULE - 1) / JANET_SLAB_GRANULE - 1);
+    JanetSlab *slab = janet_vm.slabs[size_class];
+    if (NULL == slab) slab = janet_slab_new(size_class);
+    void *block;
+    if (NULL != slab->free) {
+        block = slab->free;
+        slab->free = slab->free->next;
+    } else {
+        block = slab->bump;
+        slab->bump += slab->block_size;
+    }
+    slab->live++;
+    if (janet_slab_full(slab)) janet_slab_unlink(slab);
+    return block;
+}
+
+static void janet_slab_free(void *block) {
+    JanetSlab *slab = janet_slab_of(block);
+    JanetSlabBlock *b = (JanetSlabBlock *) block;
+    b->next = slab->free;
+    slab->free = b;
+    if (--slab->live == 0) {
+        if (slab->available) janet_slab_unlink(slab);
+        janet_slab_release(slab);
+    } else if (!slab->available) {
+        janet_slab_link(slab);
+    }
+}
+
+#endif
+
+/* Return the memory of a block to the allocator */
+static void janet_free_block(JanetGCObject *mem) {
+#ifdef JANET_GC_SLAB
+    if (mem->flags & JANET_MEM_SLAB) {
+        janet_slab_free(mem);
+        return;
+    }
+#endif
+    janet_free(mem);
+}
+
+/* Pause timing for GC statistics */
+static uint64_t janet_gc_clock(void) {
+#ifdef JANET_GETTIME
+    struct timespec t;
+    janet_gettime(&t, JANET_TIME_MONOTONIC);
+    return (uint64_t) t.tv_sec * 1000000000 + (uint64_t) t.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+static void janet_gc_record_pause(uint64_t *histogram, uint64_t *total, uint64_t start) {
+    uint64_t elapsed = janet_gc_clock() - start;
+    uint64_t micros = elapsed / 1000;
+    int bucket = 0;
+    while (micros && bucket < JANET_GC_HISTOGRAM_BUCKETS - 1) {
+        micros >>= 1;
+        bucket++;
+    }
+    histogram[bucket]++;
+    *total += elapsed;
+}
+
+/* Sweep up to budget blocks from the list of blocks left over from the last
+ * mark phase. Surviving blocks are moved back onto the heap list, and have their
+ * mark cleared for the next collection. Returns 1 when nothing is left to sweep. */
+static int janet_sweep_blocks(size_t budget) {
+    JanetGCObject *current = janet_vm.sweep_blocks;
+    while (NULL != current && budget) {
+        JanetGCObject *next = current->data.next;
         if (current->flags & (JANET_MEM_REACHABLE | JANET_MEM_DISABLED)) {
-            previous = current;
             current->flags &= ~JANET_MEM_REACHABLE;
+            current->data.next = janet_vm.blocks;
+            janet_vm.blocks = current;
         } else {
             janet_vm.block_count--;
             janet_deinit_block(current);
-            if (NULL != previous) {
-                previous->data.next = next;
-            } else {
-                janet_vm.blocks = next;
-            }
-            janet_free(current);
+            janet_free_block(current);
         }
         current = next;
+        budget--;
+    }
+    janet_vm.sweep_blocks = current;
+    return NULL == current;
+}
+
+/* Check if a value survives the sweep after a mark phase. Values shared
+ * between threads are always considered alive. */
+static int janet_gc_survives(Janet x) {
+    JanetGCObject *head;
+    switch (janet_type(x)) {
+        default:
+            return 1;
+        case JANET_STRING:
+        case JANET_KEYWORD:
+        case JANET_SYMBOL:
+            head = (JanetGCObject *) janet_string_head(janet_unwrap_string(x));
+            break;
+        case JANET_STRUCT:
+            head = (JanetGCObject *) janet_struct_head(janet_unwrap_struct(x));
+            break;
+        case JANET_TUPLE:
+            head = (JanetGCObject *) janet_tuple_head(janet_unwrap_tuple(x));
+            break;
+        case JANET_ABSTRACT:
+            head = (JanetGCObject *) janet_abstract_head(janet_unwrap_abstract(x));
+            break;
+        case JANET_ARRAY:
+        case JANET_TABLE:
+        case JANET_BUFFER:
+        case JANET_FIBER:
+        case JANET_FUNCTION:
+            head = (JanetGCObject *) janet_unwrap_pointer(x);
+            break;
+    }
+    int type = head->flags & JANET_MEM_TYPEBITS;
+    if (type == JANET_MEMORY_THREADED_ABSTRACT || type == JANET_MEMORY_THREADED_STRING) return 1;
+    return (head->flags & (JANET_MEM_REACHABLE | JANET_MEM_DISABLED)) != 0;
+}
+
+/* Remove the entries of weak tables that refer to garbage. Must run after
+ * marking and before any block is freed. */
+static void janet_gc_prune_weak(void) {
+    for (int32_t i = 0; i < janet_v_count(weak_tables); i++) {
+        JanetTable *table = weak_tables[i];
+        int32_t weak = table->gc.flags & (JANET_TABLE_FLAG_WEAK_KEYS | JANET_TABLE_FLAG_WEAK_VALUES);
+        for (int32_t j = 0; j < table->capacity; j++) {
+            JanetKV *kv = table->data + j;
+            if (janet_checktype(kv->key, JANET_NIL)) continue;
+            if (((weak & JANET_TABLE_FLAG_WEAK_KEYS) && !janet_gc_survives(kv->key)) ||
+                    ((weak & JANET_TABLE_FLAG_WEAK_VALUES) && !janet_gc_survives(kv->value))) {
+                janet_table_remove(table, kv->key);
+            }
+        }
     }
+    janet_v_free(weak_tables);
+    weak_tables = NULL;
+}
+
+/* Start sweeping after a mark phase. The whole heap is moved onto the list of
+ * blocks to sweep, so blocks allocated before sweeping is finished never need to
+ * be visited. */
+static void janet_sweep_begin(void) {
+    janet_gc_sweep_finish();
+    janet_gc_prune_weak();
+    janet_vm.sweep_blocks = janet_vm.blocks;
+    janet_vm.blocks = NULL;
 #ifdef JANET_EV
-    /* Sweep threaded abstract types for references to decrement */
+    /* Sweep threaded abstract types and strings for references to decrement */
     JanetKV *items = janet_vm.threaded_abstracts.data;
     for (int32_t i = 0; i < janet_vm.threaded_abstracts.capacity; i++) {
-        if (janet_checktype(items[i].key, JANET_ABSTRACT)) {
+        if (janet_checktype(items[i].key, JANET_NIL)) continue;
 
-            /* If item was not visited during the mark phase, then this
-             * abstract type isn't present in the heap and needs its refcount
-             * decremented, and shouuld be removed from table. If the refcount is
-             * then 0, the item will be collected. This ensures that only one interpreter
-             * will clean up the threaded abstract. */
+        /* If item was not visited during the mark phase, then this
+         * value isn't present in the heap and needs its refcount
+         * decremented, and should be removed from table. If the refcount is
+         * then 0, the item will be collected. This ensures that only one interpreter
+         * will clean up the threaded value. */
 
-            /* If not visited... */
-            if (!janet_truthy(items[i].value)) {
+        /* If not visited... */
+        if (!janet_truthy(items[i].value)) {
+            if (janet_checktype(items[i].key, JANET_POINTER)) {
+                janet_string_decref((const uint8_t *) janet_unwrap_pointer(items[i].key));
+            } else {
                 void *abst = janet_unwrap_abstract(items[i].key);
                 if (0 == janet_abstract_decref(abst)) {
                     /* Run finalizer */
@@ -370,41 +649,112 @@ void janet_sweep() {
                     if (head->type->gc) {
                         janet_assert(!head->type->gc(head->data, head->size), "finalizer failed");
                     }
-                    /* Mark as tombstone in place */
-                    items[i].key = janet_wrap_nil();
-                    items[i].value = janet_wrap_false();
-                    janet_vm.threaded_abstracts.deleted++;
-                    janet_vm.threaded_abstracts.count--;
                     /* Free memory */
                     janet_free(janet_abstract_head(abst));
                 }
             }
-
-            /* Reset for next sweep */
-            items[i].value = janet_wrap_false();
+            /* Mark as tombstone in place, as this heap no longer holds a reference */
+            items[i].key = janet_wrap_nil();
+            janet_vm.threaded_abstracts.deleted++;
+            janet_vm.threaded_abstracts.count--;
         }
+
+        /* Reset for next sweep */
+        items[i].value = janet_wrap_false();
     }
 #endif
 }
 
+/* Run one slice of an incremental sweep, if one is in progress. */
+void janet_gc_sweep_step(void) {
+    if (NULL != janet_vm.sweep_blocks) {
+        uint64_t start = janet_gc_clock();
+        janet_sweep_blocks(janet_vm.gc_sweep_step ? janet_vm.gc_sweep_step : SIZE_MAX);
+        janet_gc_record_pause(janet_vm.gc_stats.sweep_histogram, &janet_vm.gc_stats.sweep_ns, start);
+    }
+}
+
+/* Finish an incremental sweep, if one is in progress. */
+void janet_gc_sweep_finish(void) {
+    if (NULL != janet_vm.sweep_blocks) {
+        uint64_t start = janet_gc_clock();
+        janet_sweep_blocks(SIZE_MAX);
+        janet_gc_record_pause(janet_vm.gc_stats.sweep_histogram, &janet_vm.gc_stats.sweep_ns, start);
+    }
+}
+
+/* Give a funcdef its own copy of code shared with other VMs so that it can be
+ * changed. Stack frames in this VM that are running the shared copy move to the
+ * new one. Other VMs keep running the shared copy, which is never freed. */
+void janet_def_unshare(JanetFuncDef *def) {
+    if (!(def->gc.flags & JANET_FUNCDEF_SHARED_CODE)) return;
+    uint32_t *old = def->bytecode;
+    uint32_t *bytecode = janet_malloc(sizeof(uint32_t) * (size_t) def->bytecode_length);
+    if (NULL == bytecode) {
+        JANET_OUT_OF_MEMORY;
+    }
+    safe_memcpy(bytecode, old, sizeof(uint32_t) * (size_t) def->bytecode_length);
+    if (NULL != def->sourcemap) {
+        JanetSourceMapping *sourcemap = janet_malloc(sizeof(JanetSourceMapping) * (size_t) def->bytecode_length);
+        if (NULL == sourcemap) {
+            JANET_OUT_OF_MEMORY;
+        }
+        safe_memcpy(sourcemap, def->sourcemap, sizeof(JanetSourceMapping) * (size_t) def->bytecode_length);
+        def->sourcemap = sourcemap;
+    }
+    def->bytecode = bytecode;
+    def->gc.flags &= ~JANET_FUNCDEF_SHARED_CODE;
+    /* Put every block back on one list, then fix up the frames of all fibers */
+    janet_gc_sweep_finish();
+    for (JanetGCObject *current = janet_vm.blocks; NULL != current; current = current->data.next) {
+        if ((current->flags & JANET_MEM_TYPEBITS) != JANET_MEMORY_FIBER) continue;
+        JanetFiber *fiber = (JanetFiber *) current;
+        int32_t i = fiber->frame;
+        while (i > 0) {
+            JanetStackFrame *frame = (JanetStackFrame *)(fiber->data + i - JANET_FRAME_SIZE);
+            if (NULL != frame->func && frame->func->def == def &&
+                    frame->pc >= old && frame->pc < old + def->bytecode_length) {
+                frame->pc = bytecode + (frame->pc - old);
+            }
+            i = frame->prevframe;
+        }
+    }
+}
+
+/* Iterate over all allocated memory, and free memory that is not
+ * marked as reachable. Flip the gc color flag for next sweep. */
+void janet_sweep() {
+    janet_sweep_begin();
+    janet_sweep_blocks(SIZE_MAX);
+}
+
 /* Allocate some memory that is tracked for garbage collection */
 void *janet_gcalloc(enum JanetMemoryType type, size_t size) {
     JanetGCObject *mem;
 
     /* Make sure everything is inited */
     janet_assert(NULL != janet_vm.cache, "please initialize janet before use");
-    mem = janet_malloc(size);
+#ifdef JANET_GC_SLAB
+    if (size <= JANET_SLAB_MAX) {
+        mem = janet_slab_alloc(size);
+        mem->flags = type | JANET_MEM_SLAB;
+    } else
+#endif
+    {
+        mem = janet_malloc(size);
 
-    /* Check for bad malloc */
-    if (NULL == mem) {
-        JANET_OUT_OF_MEMORY;
-    }
+        /* Check for bad malloc */
+        if (NULL == mem) {
+            JANET_OUT_OF_MEMORY;
+        }
 
-    /* Configure block */
-    mem->flags = type;
+        /* Configure block */
+        mem->flags = type;
+    }
 
     /* Prepend block to heap list */
     janet_vm.next_collection += size;
+    janet_vm.gc_stats.total_allocated += size;
     mem->data.next = janet_vm.blocks;
     janet_vm.blocks = mem;
     janet_vm.block_count++;
@@ -412,6 +762,21 @@ void *janet_gcalloc(enum JanetMemoryType type, size_t size) {
     return (void *)mem;
 }
 
+/* Track a block from janet_malloc for garbage collection, as if it had
+ * come from janet_gcalloc. Builders use this to hand over storage they
+ * grew with janet_realloc without copying it. */
+void *janet_gcadopt(enum JanetMemoryType type, void *block, size_t size) {
+    JanetGCObject *mem = (JanetGCObject *) block;
+    janet_assert(NULL != janet_vm.cache, "please initialize janet before use");
+    mem->flags = type;
+    janet_vm.next_collection += size;
+    janet_vm.gc_stats.total_allocated += size;
+    mem->data.next = janet_vm.blocks;
+    janet_vm.blocks = mem;
+    janet_vm.block_count++;
+    return block;
+}
+
 static void free_one_scratch(JanetScratch *s) {
     if (NULL != s->finalize) {
         s->finalize((char *) s->mem);
@@ -432,10 +797,38 @@ static JanetScratch *janet_mem2scratch(void *mem) {
     return s - 1;
 }
 
+/* Check the heap limit once this much more memory has been allocated */
+static void janet_gc_update_headroom(void) {
+    size_t live = janet_vm.gc_stats.heap_live;
+    size_t limit = janet_vm.heap_limit;
+    janet_vm.gc_headroom = limit == 0 ? SIZE_MAX : live < limit ? limit - live : 0;
+}
+
+/* Limit the bytes the heap may keep alive. Past the limit, the interpreter
+ * runs a collection and raises an error in the running fiber if that did not
+ * free enough memory. A limit of 0 removes the limit. */
+void janet_gcsetlimit(size_t limit) {
+    janet_vm.heap_limit = limit;
+    janet_gc_update_headroom();
+}
+
+void janet_gc_safepoint(void) {
+    janet_collect();
+    if (janet_vm.heap_limit && !janet_vm.gc_suspend &&
+            janet_vm.gc_stats.heap_live >= janet_vm.heap_limit) {
+        janet_vm.gc_stats.limit_errors++;
+        /* Leave a little room so that error handlers can run and drop references */
+        janet_vm.gc_headroom = janet_vm.heap_limit / 16;
+        janet_panicf("heap limit of %v bytes exceeded", janet_wrap_number((double) janet_vm.heap_limit));
+    }
+}
+
 /* Run garbage collection */
 void janet_collect(void) {
     uint32_t i;
     if (janet_vm.gc_suspend) return;
+    /* Marks left over from the last collection would hide live blocks from the mark phase */
+    janet_gc_sweep_finish();
     depth = JANET_RECURSION_GUARD;
     /* Try and prevent many major collections back to back.
      * A full collection will take O(janet_vm.block_count) time.
@@ -445,6 +838,11 @@ void janet_collect(void) {
     if (janet_vm.block_count * 8 > janet_vm.gc_interval) {
         janet_vm.gc_interval = janet_vm.block_count * sizeof(JanetGCObject);
     }
+    janet_trace_event(JANET_TRACE_GC_BEGIN, janet_vm.fiber, NULL, NULL, janet_vm.gc_stats.heap_live);
+    uint64_t start = janet_gc_clock();
+    janet_vm.gc_stats.collections++;
+    memset(janet_vm.gc_stats.live_count, 0, sizeof(janet_vm.gc_stats.live_count));
+    memset(janet_vm.gc_stats.live_bytes, 0, sizeof(janet_vm.gc_stats.live_bytes));
     orig_rootcount = janet_vm.root_count;
 #ifdef JANET_EV
     janet_ev_mark();
@@ -456,9 +854,33 @@ void janet_collect(void) {
         Janet x = janet_vm.roots[--janet_vm.root_count];
         janet_mark(x);
     }
-    janet_sweep();
+    /* Inline and dynamic binding caches do not mark their keys, and a collected
+     * key may be allocated again at the same address with different contents. */
+    memset(janet_vm.inline_cache, 0, JANET_INLINE_CACHE_SIZE * sizeof(JanetInlineCache));
+    memset(janet_vm.dyn_cache, 0, JANET_DYN_CACHE_SIZE * sizeof(JanetInlineCache));
+    janet_gc_record_pause(janet_vm.gc_stats.mark_histogram, &janet_vm.gc_stats.mark_ns, start);
+    janet_vm.gc_stats.heap_live = 0;
+    for (i = 0; i < JANET_GC_MEMORY_TYPES; i++) {
+        janet_vm.gc_stats.heap_live += janet_vm.gc_stats.live_bytes[i];
+    }
+    janet_gc_update_headroom();
+    start = janet_gc_clock();
+    if (janet_vm.gc_sweep_step) {
+        /* Incremental mode - the rest of the heap is swept in slices at VM safe points */
+        janet_sweep_begin();
+        janet_sweep_blocks(janet_vm.gc_sweep_step);
+    } else {
+        janet_sweep();
+    }
+    janet_gc_record_pause(janet_vm.gc_stats.sweep_histogram, &janet_vm.gc_stats.sweep_ns, start);
     janet_vm.next_collection = 0;
     janet_free_all_scratch();
+    janet_trace_event(JANET_TRACE_GC_END, janet_vm.fiber, NULL, NULL, janet_vm.gc_stats.heap_live);
+}
+
+/* Get statistics about the GC */
+const JanetGCStats *janet_gcstats(void) {
+    return &janet_vm.gc_stats;
 }
 
 /* Add a root value to the GC. This prevents the GC from removing a value
@@ -527,7 +949,9 @@ void janet_clear_memory(void) {
 #ifdef JANET_EV
     JanetKV *items = janet_vm.threaded_abstracts.data;
     for (int32_t i = 0; i < janet_vm.threaded_abstracts.capacity; i++) {
-        if (janet_checktype(items[i].key, JANET_ABSTRACT)) {
+        if (janet_checktype(items[i].key, JANET_POINTER)) {
+            janet_string_decref((const uint8_t *) janet_unwrap_pointer(items[i].key));
+        } else if (janet_checktype(items[i].key, JANET_ABSTRACT)) {
             void *abst = janet_unwrap_abstract(items[i].key);
             if (0 == janet_abstract_decref(abst)) {
                 JanetAbstractHead *head = janet_abstract_head(abst);
@@ -539,16 +963,24 @@ void janet_clear_memory(void) {
         }
     }
 #endif
+    janet_gc_sweep_finish();
     JanetGCObject *current = janet_vm.blocks;
     while (NULL != current) {
         janet_deinit_block(current);
         JanetGCObject *next = current->data.next;
-        janet_free(current);
+        janet_free_block(current);
         current = next;
     }
     janet_vm.blocks = NULL;
+    janet_fiber_pool_clear();
     janet_free_all_scratch();
     janet_free(janet_vm.scratch_mem);
+    JanetSArenaMark empty = {NULL, 0};
+    janet_sarena_reset(empty);
+    janet_free(janet_vm.sarena_spare);
+    janet_vm.sarena_spare = NULL;
+    janet_free(janet_vm.sarena_marks);
+    janet_vm.sarena_marks = NULL;
 }
 
 /* Primitives for suspending GC. */
@@ -629,3 +1061,69 @@ void janet_sfree(void *mem) {
     }
     JANET_EXIT("invalid janet_sfree");
 }
+
+/* Scratch arena API */
+
+#define JANET_SARENA_CHUNK_SIZE 0x10000
+
+JanetSArenaMark janet_sarena_mark(void) {
+    JanetSArenaMark mark;
+    mark.chunk = janet_vm.sarena;
+    mark.used = janet_vm.sarena ? janet_vm.sarena->used : 0;
+    return mark;
+}
+
+/* Keep the largest released chunk as the spare */
+static void janet_sarena_release(JanetSArenaChunk *chunk) {
+    if (NULL == janet_vm.sarena_spare) {
+        janet_vm.sarena_spare = chunk;
+    } else if (janet_vm.sarena_spare->size < chunk->size) {
+        janet_free(janet_vm.sarena_spare);
+        janet_vm.sarena_spare = chunk;
+    } else {
+        janet_free(chunk);
+    }
+}
+
+void janet_sarena_reset(JanetSArenaMark mark) {
+    while (janet_vm.sarena != mark.chunk) {
+        JanetSArenaChunk *chunk = janet_vm.sarena;
+        if (NULL == chunk) {
+            JANET_EXIT("invalid janet_sarena_reset");
+        }
+        janet_vm.sarena = chunk->prev;
+        janet_sarena_release(chunk);
+    }
+    if (NULL != janet_vm.sarena) {
+        janet_vm.sarena->used = mark.used;
+    }
+}
+
+void *janet_sarena_alloc(size_t size) {
+    const size_t align = sizeof(long long);
+    if (size > SIZE_MAX - align - sizeof(JanetSArenaChunk)) {
+        JANET_OUT_OF_MEMORY;
+    }
+    size = (size + align - 1) & ~(align - 1);
+    JanetSArenaChunk *chunk = janet_vm.sarena;
+    if (NULL == chunk || chunk->size - chunk->used < size) {
+        JanetSArenaChunk *spare = janet_vm.sarena_spare;
+        if (NULL != spare && spare->size >= size) {
+            chunk = spare;
+            janet_vm.sarena_spare = NULL;
+        } else {
+            size_t chunk_size = size > JANET_SARENA_CHUNK_SIZE ? size : JANET_SARENA_CHUNK_SIZE;
+            chunk = janet_malloc(sizeof(JanetSArenaChunk) + chunk_size);
+            if (NULL == chunk) {
+                JANET_OUT_OF_MEMORY;
+            }
+            chunk->size = chunk_size;
+        }
+        chunk->used = 0;
+        chunk->prev = janet_vm.sarena;
+        janet_vm.sarena = chunk;
+    }
+    void *mem = (char *)(chunk->mem) + chunk->used;
+    chunk->used += size;
+    return mem;
+}
@@ -34,6 +34,13 @@
 #define JANET_MEM_TYPEBITS 0xFF
 #define JANET_MEM_REACHABLE 0x100
 #define JANET_MEM_DISABLED 0x200
+#define JANET_MEM_SLAB 0x400
+
+/* Weak tables do not keep the keys or values in them alive. Other table
+ * flags are JANET_TABLE_FLAG_STACK (table.c), and JANET_TABLE_FLAG_PROTO and
+ * JANET_TABLE_FLAG_VERSIONED (state.h). */
+#define JANET_TABLE_FLAG_WEAK_KEYS 0x40000
+#define JANET_TABLE_FLAG_WEAK_VALUES 0x80000
 
 #define janet_gc_settype(m, t) ((janet_gc_header(m)->flags |= (0xFF & (t))))
 #define janet_gc_type(m) (janet_gc_header(m)->flags & 0xFF)
@@ -57,10 +64,22 @@ enum JanetMemoryType {
     JANET_MEMORY_FUNCENV,
     JANET_MEMORY_FUNCDEF,
     JANET_MEMORY_THREADED_ABSTRACT,
+    JANET_MEMORY_THREADED_STRING,
+    JANET_MEMORY_SHARED_SYMBOL,
 };
 
 /* To allocate collectable memory, one must call janet_alloc, initialize the memory,
  * and then call when janet_enablegc when it is initailize and reachable by the gc (on the JANET stack) */
 void *janet_gcalloc(enum JanetMemoryType type, size_t size);
+void *janet_gcadopt(enum JanetMemoryType type, void *block, size_t size);
+
+/* Incremental sweeping. janet_collect leaves unswept blocks behind if
+ * janet_vm.gc_sweep_step is non-zero. */
+void janet_gc_sweep_step(void);
+void janet_gc_sweep_finish(void);
+
+/* Collect from the interpreter loop, and raise an error if the heap is
+ * still over janet_vm.heap_limit afterwards. */
+void janet_gc_safepoint(void);
 
 #endif
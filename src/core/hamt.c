@@ -0,0 +1,559 @@
+/*
+* Copyright (c) 2023 Calvin Rose
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to
+* deal in the Software without restriction, including without limitation the
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+* sell copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#ifndef JANET_AMALG
+#include "features.h"
+#include <janet.h>
+#include "util.h"
+#include <math.h>
+#endif
+
+/* Persistent hash maps, stored as hash array mapped tries. Each update
+ * copies only the nodes on the path to the changed key, so many versions of
+ * a large map share almost all of their memory.
+ *
+ * Nodes are tuples that are never handed to user code. A node starts with a
+ * bitmap of the 5 bit hash fragments that hold a key value pair, and a bitmap
+ * of the fragments that hold a child node. The pairs follow in fragment
+ * order, then the children. Keys whose 32 bit hashes are equal end up in a
+ * collision node, which has nil bitmaps and a flat list of pairs. Removing
+ * keys pulls single pairs back up into their parent, so every map has as few
+ * nodes as possible. */
+
+#define HAMT_BITS 5
+#define HAMT_MASK 0x1F
+#define HAMT_ENTRIES 2
+
+typedef struct {
+    const Janet *root;
+    int32_t count;
+    uint64_t hash;
+} JanetHamt;
+
+static int32_t hamt_popcount(uint32_t x) {
+#if defined(__GNUC__)
+    return __builtin_popcount(x);
+#else
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    return (int32_t)((((x + (x >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#endif
+}
+
+#define hamt_iscollision(node) janet_checktype((node)[0], JANET_NIL)
+#define hamt_datamap(node) ((uint32_t) janet_unwrap_number((node)[0]))
+#define hamt_nodemap(node) ((uint32_t) janet_unwrap_number((node)[1]))
+#define hamt_frag(hash, shift) (1u << (((hash) >> (shift)) & HAMT_MASK))
+#define hamt_child(node, i) janet_unwrap_tuple((node)[i])
+
+/* Allocate a node with room for length slots, including the bitmaps */
+static Janet *hamt_node(int collision, uint32_t datamap, uint32_t nodemap, int32_t length) {
+    Janet *node = janet_tuple_begin(length);
+    janet_tuple_hash(node) = 0;
+    if (collision) {
+        node[0] = janet_wrap_nil();
+        node[1] = janet_wrap_nil();
+    } else {
+        node[0] = janet_wrap_number(datamap);
+        node[1] = janet_wrap_number(nodemap);
+    }
+    return node;
+}
+
+/* Copy a node with room for extra more slots */
+static Janet *hamt_copy(const Janet *node, uint32_t datamap, uint32_t nodemap, int32_t extra) {
+    int32_t length = janet_tuple_length(node);
+    Janet *copy = hamt_node(hamt_iscollision(node), datamap, nodemap, length + extra);
+    if (extra >= 0) {
+        safe_memcpy(copy + HAMT_ENTRIES, node + HAMT_ENTRIES, (length - HAMT_ENTRIES) * sizeof(Janet));
+    }
+    return copy;
+}
+
+/* Index of the first child of a node */
+static int32_t hamt_children(const Janet *node) {
+    return HAMT_ENTRIES + 2 * hamt_popcount(hamt_datamap(node));
+}
+
+/* A node that holds a single pair, and can be stored in its parent instead */
+static int hamt_issingle(const Janet *node) {
+    return janet_tuple_length(node) == HAMT_ENTRIES + 2 &&
+           (hamt_iscollision(node) || hamt_nodemap(node) == 0);
+}
+
+static const Janet *hamt_find(const Janet *node, Janet key, uint32_t hash) {
+    for (int shift = 0;; shift += HAMT_BITS) {
+        if (hamt_iscollision(node)) {
+            int32_t length = janet_tuple_length(node);
+            for (int32_t i = HAMT_ENTRIES; i < length; i += 2) {
+                if (janet_equals(node[i], key)) return node + i;
+            }
+            return NULL;
+        }
+        uint32_t bit = hamt_frag(hash, shift);
+        uint32_t datamap = hamt_datamap(node);
+        uint32_t nodemap = hamt_nodemap(node);
+        if (datamap & bit) {
+            const Janet *kv = node + HAMT_ENTRIES + 2 * hamt_popcount(datamap & (bit - 1));
+            return janet_equals(kv[0], key) ? kv : NULL;
+        }
+        if (!(nodemap & bit)) return NULL;
+        node = hamt_child(node, hamt_children(node) + hamt_popcount(nodemap & (bit - 1)));
+    }
+}
+
+/* Make the smallest subtree that holds two pairs with different keys */
+static const Janet *hamt_merge(int shift, Janet k1, Janet v1, uint32_t h1, Janet k2, Janet v2, uint32_t h2) {
+    Janet *node;
+    if (shift >= 32) {
+        node = hamt_node(1, 0, 0, HAMT_ENTRIES + 4);
+        node[2] = k1;
+        node[3] = v1;
+        node[4] = k2;
+        node[5] = v2;
+        return node;
+    }
+    uint32_t b1 = hamt_frag(h1, shift);
+    uint32_t b2 = hamt_frag(h2, shift);
+    if (b1 == b2) {
+        node = hamt_node(0, 0, b1, HAMT_ENTRIES + 1);
+        node[2] = janet_wrap_tuple(hamt_merge(shift + HAMT_BITS, k1, v1, h1, k2, v2, h2));
+        return node;
+    }
+    node = hamt_node(0, b1 | b2, 0, HAMT_ENTRIES + 4);
+    int first = b1 < b2 ? 2 : 4;
+    node[first] = k1;
+    node[first + 1] = v1;
+    node[6 - first] = k2;
+    node[7 - first] = v2;
+    return node;
+}
+
+/* Return the node with key mapped to value. Sets *added if the key is new,
+ * otherwise stores the previous value in *old. */
+static const Janet *hamt_assoc(const Janet *node, int shift, Janet key, uint32_t hash,
+                               Janet value, int *added, Janet *old) {
+    int32_t length = janet_tuple_length(node);
+    Janet *copy;
+    if (hamt_iscollision(node)) {
+        for (int32_t i = HAMT_ENTRIES; i < length; i += 2) {
+            if (janet_equals(node[i], key)) {
+                *old = node[i + 1];
+                if (janet_equals(*old, value)) return node;
+                copy = hamt_copy(node, 0, 0, 0);
+                copy[i + 1] = value;
+                return copy;
+            }
+        }
+        *added = 1;
+        copy = hamt_copy(node, 0, 0, 2);
+        copy[length] = key;
+        copy[length + 1] = value;
+        return copy;
+    }
+    uint32_t bit = hamt_frag(hash, shift);
+    uint32_t datamap = hamt_datamap(node);
+    uint32_t nodemap = hamt_nodemap(node);
+    int32_t children = hamt_children(node);
+    if (datamap & bit) {
+        int32_t i = HAMT_ENTRIES + 2 * hamt_popcount(datamap & (bit - 1));
+        if (janet_equals(node[i], key)) {
+            *old = node[i + 1];
+            if (janet_equals(*old, value)) return node;
+            copy = hamt_copy(node, datamap, nodemap, 0);
+            copy[i + 1] = value;
+            return copy;
+        }
+        /* Push the existing pair and the new one down into a child */
+        *added = 1;
+        const Janet *child = hamt_merge(shift + HAMT_BITS, node[i], node[i + 1],
+                                        (uint32_t) janet_hash(node[i]), key, value, hash);
+        int32_t c = children - 2 + hamt_popcount(nodemap & (bit - 1));
+        copy = hamt_node(0, datamap ^ bit, nodemap | bit, length - 1);
+        safe_memcpy(copy + HAMT_ENTRIES, node + HAMT_ENTRIES, (i - HAMT_ENTRIES) * sizeof(Janet));
+        safe_memcpy(copy + i, node + i + 2, (c - i) * sizeof(Janet));
+        copy[c] = janet_wrap_tuple(child);
+        safe_memcpy(copy + c + 1, node + c + 2, (length - c - 2) * sizeof(Janet));
+        return copy;
+    }
+    if (nodemap & bit) {
+        int32_t c = children + hamt_popcount(nodemap & (bit - 1));
+        const Janet *child = hamt_child(node, c);
+        const Janet *newchild = hamt_assoc(child, shift + HAMT_BITS, key, hash, value, added, old);
+        if (newchild == child) return node;
+        copy = hamt_copy(node, datamap, nodemap, 0);
+        copy[c] = janet_wrap_tuple(newchild);
+        return copy;
+    }
+    /* Add a pair to this node */
+    *added = 1;
+    int32_t i = HAMT_ENTRIES + 2 * hamt_popcount(datamap & (bit - 1));
+    copy = hamt_node(0, datamap | bit, nodemap, length + 2);
+    safe_memcpy(copy + HAMT_ENTRIES, node + HAMT_ENTRIES, (i - HAMT_ENTRIES) * sizeof(Janet));
+    copy[i] = key;
+    copy[i + 1] = value;
+    safe_memcpy(copy + i + 2, node + i, (length - i) * sizeof(Janet));
+    return copy;
+}
+
+/* Return the node without key. Stores the removed value in *old, and returns
+ * node itself if the key is not present. */
+static const Janet *hamt_dissoc(const Janet *node, int shift, Janet key, uint32_t hash, Janet *old) {
+    int32_t length = janet_tuple_length(node);
+    Janet *copy;
+    if (hamt_iscollision(node)) {
+        for (int32_t i = HAMT_ENTRIES; i < length; i += 2) {
+            if (janet_equals(node[i], key)) {
+                *old = node[i + 1];
+                copy = hamt_node(1, 0, 0, length - 2);
+                safe_memcpy(copy + HAMT_ENTRIES, node + HAMT_ENTRIES, (i - HAMT_ENTRIES) * sizeof(Janet));
+                safe_memcpy(copy + i, node + i + 2, (length - i - 2) * sizeof(Janet));
+                return copy;
+            }
+        }
+        return node;
+    }
+    uint32_t bit = hamt_frag(hash, shift);
+    uint32_t datamap = hamt_datamap(node);
+    uint32_t nodemap = hamt_nodemap(node);
+    int32_t children = hamt_children(node);
+    if (datamap & bit) {
+        int32_t i = HAMT_ENTRIES + 2 * hamt_popcount(datamap & (bit - 1));
+        if (!janet_equals(node[i], key)) return node;
+        *old = node[i + 1];
+        copy = hamt_node(0, datamap ^ bit, nodemap, length - 2);
+        safe_memcpy(copy + HAMT_ENTRIES, node + HAMT_ENTRIES, (i - HAMT_ENTRIES) * sizeof(Janet));
+        safe_memcpy(copy + i, node + i + 2, (length - i - 2) * sizeof(Janet));
+        return copy;
+    }
+    if (nodemap & bit) {
+        int32_t c = children + hamt_popcount(nodemap & (bit - 1));
+        const Janet *child = hamt_child(node, c);
+        const Janet *newchild = hamt_dissoc(child, shift + HAMT_BITS, key, hash, old);
+        if (newchild == child) return node;
+        if (!hamt_issingle(newchild)) {
+            copy = hamt_copy(node, datamap, nodemap, 0);
+            copy[c] = janet_wrap_tuple(newchild);
+            return copy;
+        }
+        /* Pull the last pair of the child up into this node */
+        int32_t i = HAMT_ENTRIES + 2 * hamt_popcount(datamap & (bit - 1));
+        copy = hamt_node(0, datamap | bit, nodemap ^ bit, length + 1);
+        safe_memcpy(copy + HAMT_ENTRIES, node + HAMT_ENTRIES, (i - HAMT_ENTRIES) * sizeof(Janet));
+        copy[i] = newchild[2];
+        copy[i + 1] = newchild[3];
+        safe_memcpy(copy + i + 2, node + i, (c - i) * sizeof(Janet));
+        safe_memcpy(copy + c + 2, node + c + 1, (length - c - 1) * sizeof(Janet));
+        return copy;
+    }
+    return node;
+}
+
+/* First key of a node in iteration order, or nil if the node is empty */
+static Janet hamt_first(const Janet *node) {
+    for (;;) {
+        int32_t length = janet_tuple_length(node);
+        if (length == HAMT_ENTRIES) return janet_wrap_nil();
+        if (hamt_iscollision(node) || hamt_datamap(node)) return node[2];
+        node = hamt_child(node, HAMT_ENTRIES);
+    }
+}
+
+/* Key after key in iteration order, or nil if key is the last in node */
+static Janet hamt_after(const Janet *node, int shift, Janet key, uint32_t hash) {
+    int32_t length = janet_tuple_length(node);
+    int32_t next;
+    if (hamt_iscollision(node)) {
+        for (int32_t i = HAMT_ENTRIES; i < length; i += 2) {
+            if (janet_equals(node[i], key)) {
+                return i + 2 < length ? node[i + 2] : janet_wrap_nil();
+            }
+        }
+        return janet_wrap_nil();
+    }
+    uint32_t bit = hamt_frag(hash, shift);
+    uint32_t datamap = hamt_datamap(node);
+    uint32_t nodemap = hamt_nodemap(node);
+    int32_t children = hamt_children(node);
+    if (datamap & bit) {
+        int32_t i = HAMT_ENTRIES + 2 * hamt_popcount(datamap & (bit - 1));
+        if (!janet_equals(node[i], key)) return janet_wrap_nil();
+        if (i + 2 < children) return node[i + 2];
+        next = children;
+    } else if (nodemap & bit) {
+        int32_t c = children + hamt_popcount(nodemap & (bit - 1));
+        Janet after = hamt_after(hamt_child(node, c), shift + HAMT_BITS, key, hash);
+        if (!janet_checktype(after, JANET_NIL)) return after;
+        next = c + 1;
+    } else {
+        return janet_wrap_nil();
+    }
+    return next < length ? hamt_first(hamt_child(node, next)) : janet_wrap_nil();
+}
+
+/* Call fn on every pair under node until it returns non-zero */
+static int hamt_walk(const Janet *node, int (*fn)(void *, Janet, Janet), void *data) {
+    int32_t length = janet_tuple_length(node);
+    int32_t children = hamt_iscollision(node) ? length : hamt_children(node);
+    for (int32_t i = HAMT_ENTRIES; i < children; i += 2) {
+        if (fn(data, node[i], node[i + 1])) return 1;
+    }
+    for (int32_t i = children; i < length; i++) {
+        if (hamt_walk(hamt_child(node, i), fn, data)) return 1;
+    }
+    return 0;
+}
+
+/* Abstract type */
+
+static void hamt_init(JanetHamt *m) {
+    m->root = hamt_node(0, 0, 0, HAMT_ENTRIES);
+    m->count = 0;
+    m->hash = JANET_KV_HASH_INIT;
+}
+
+/* Update a map that is still being built. Nil values remove keys. */
+static void hamt_set(JanetHamt *m, Janet key, Janet value) {
+    Janet old = janet_wrap_nil();
+    if (janet_checktype(key, JANET_NIL)) return;
+    if (janet_checktype(key, JANET_NUMBER) && isnan(janet_unwrap_number(key))) return;
+    uint32_t hash = (uint32_t) janet_hash(key);
+    if (janet_checktype(value, JANET_NIL)) {
+        m->root = hamt_dissoc(m->root, 0, key, hash, &old);
+        if (!janet_checktype(old, JANET_NIL)) {
+            m->count--;
+            m->hash -= janet_kv_hashpair(key, old);
+        }
+        return;
+    }
+    int added = 0;
+    const Janet *root = hamt_assoc(m->root, 0, key, hash, value, &added, &old);
+    if (root == m->root) return;
+    m->root = root;
+    if (added) {
+        if (m->count == INT32_MAX) janet_panic("hamt too large");
+        m->count++;
+    } else {
+        m->hash -= janet_kv_hashpair(key, old);
+    }
+    m->hash += janet_kv_hashpair(key, value);
+}
+
+static int hamt_gcmark(void *p, size_t size) {
+    (void) size;
+    janet_mark(janet_wrap_tuple(((JanetHamt *) p)->root));
+    return 0;
+}
+
+static int hamt_get(void *p, Janet key, Janet *out) {
+    const Janet *kv = hamt_find(((JanetHamt *) p)->root, key, (uint32_t) janet_hash(key));
+    if (NULL == kv) return 0;
+    *out = kv[1];
+    return 1;
+}
+
+static Janet hamt_next(void *p, Janet key) {
+    JanetHamt *m = (JanetHamt *) p;
+    if (janet_checktype(key, JANET_NIL)) return hamt_first(m->root);
+    return hamt_after(m->root, 0, key, (uint32_t) janet_hash(key));
+}
+
+static size_t hamt_length(void *p, size_t size) {
+    (void) size;
+    return (size_t)((JanetHamt *) p)->count;
+}
+
+static int32_t hamt_hash(void *p, size_t size) {
+    (void) size;
+    return janet_hash_fold(((JanetHamt *) p)->hash);
+}
+
+static int hamt_missing(void *p, Janet key, Janet value) {
+    const Janet *kv = hamt_find((const Janet *) p, key, (uint32_t) janet_hash(key));
+    return NULL == kv || !janet_equals(kv[1], value);
+}
+
+/* Maps with the same pairs compare equal. Other maps are ordered by size
+ * and hash, with their addresses breaking the rare remaining ties. */
+static int hamt_compare(void *lhs, void *rhs) {
+    JanetHamt *a = (JanetHamt *) lhs;
+    JanetHamt *b = (JanetHamt *) rhs;
+    if (a->count != b->count) return a->count < b->count ? -1 : 1;
+    uint32_t ha = (uint32_t) janet_hash_fold(a->hash);
+    uint32_t hb = (uint32_t) janet_hash_fold(b->hash);
+    if (ha != hb) return ha < hb ? -1 : 1;
+    if (a->root == b->root || !hamt_walk(a->root, hamt_missing, (void *) b->root)) return 0;
+    return a < b ? -1 : 1;
+}
+
+static int hamt_marshal_pair(void *p, Janet key, Janet value) {
+    JanetMarshalContext *ctx = (JanetMarshalContext *) p;
+    janet_marshal_janet(ctx, key);
+    janet_marshal_janet(ctx, value);
+    return 0;
+}
+
+static void hamt_marshal(void *p, JanetMarshalContext *ctx) {
+    JanetHamt *m = (JanetHamt *) p;
+    janet_marshal_abstract(ctx, p);
+    janet_marshal_int(ctx, m->count);
+    hamt_walk(m->root, hamt_marshal_pair, ctx);
+}
+
+static void *hamt_unmarshal(JanetMarshalContext *ctx) {
+    JanetHamt *m = janet_unmarshal_abstract(ctx, sizeof(JanetHamt));
+    hamt_init(m);
+    int32_t count = janet_unmarshal_int(ctx);
+    if (count < 0) janet_panic("invalid hamt size");
+    for (int32_t i = 0; i < count; i++) {
+        Janet key = janet_unmarshal_janet(ctx);
+        Janet value = janet_unmarshal_janet(ctx);
+        hamt_set(m, key, value);
+    }
+    return m;
+}
+
+const JanetAbstractType janet_hamt_type = {
+    "core/hamt",
+    NULL,
+    hamt_gcmark,
+    hamt_get,
+    NULL, /* put */
+    hamt_marshal,
+    hamt_unmarshal,
+    NULL, /* tostring */
+    hamt_compare,
+    hamt_hash,
+    hamt_next,
+    NULL, /* call */
+    hamt_length,
+    JANET_ATEND_LENGTH
+};
+
+static JanetHamt *hamt_clone(const JanetHamt *m) {
+    JanetHamt *copy = janet_abstract(&janet_hamt_type, sizeof(JanetHamt));
+    *copy = *m;
+    return copy;
+}
+
+static int hamt_set_pair(void *p, Janet key, Janet value) {
+    hamt_set((JanetHamt *) p, key, value);
+    return 0;
+}
+
+/* C Functions */
+
+JANET_CORE_FN(cfun_hamt_new,
+              "(hamt/new & kvs)",
+              "Create a persistent hash map from key value pairs. A hamt is an immutable "
+              "map like a struct, but `hamt/put` and `hamt/remove` make new versions in "
+              "O(log n) time and space by sharing memory with the old version. Use "
+              "`get`, `length`, and `next` to read a hamt.") {
+    if (argc & 1)
+        janet_panic("expected even number of arguments");
+    JanetHamt *m = janet_abstract(&janet_hamt_type, sizeof(JanetHamt));
+    hamt_init(m);
+    for (int32_t i = 0; i < argc; i += 2) {
+        hamt_set(m, argv[i], argv[i + 1]);
+    }
+    return janet_wrap_abstract(m);
+}
+
+JANET_CORE_FN(cfun_hamt_put,
+              "(hamt/put m & kvs)",
+              "Return a new hamt with the key value pairs kvs added to m. A nil value "
+              "removes its key. The original hamt is not changed.") {
+    janet_arity(argc, 1, -1);
+    JanetHamt *m = janet_getabstract(argv, 0, &janet_hamt_type);
+    if (!(argc & 1))
+        janet_panic("expected odd number of arguments");
+    JanetHamt *copy = hamt_clone(m);
+    for (int32_t i = 1; i < argc; i += 2) {
+        hamt_set(copy, argv[i], argv[i + 1]);
+    }
+    return janet_wrap_abstract(copy);
+}
+
+JANET_CORE_FN(cfun_hamt_remove,
+              "(hamt/remove m & ks)",
+              "Return a new hamt without the keys ks. The original hamt is not changed.") {
+    janet_arity(argc, 1, -1);
+    JanetHamt *m = janet_getabstract(argv, 0, &janet_hamt_type);
+    JanetHamt *copy = hamt_clone(m);
+    for (int32_t i = 1; i < argc; i++) {
+        hamt_set(copy, argv[i], janet_wrap_nil());
+    }
+    return janet_wrap_abstract(copy);
+}
+
+JANET_CORE_FN(cfun_hamt_merge,
+              "(hamt/merge m & colls)",
+              "Return a new hamt with all pairs of the tables, structs, or hamts in colls "
+              "added to m. Later values replace earlier ones. The original hamt is not changed.") {
+    janet_arity(argc, 1, -1);
+    JanetHamt *m = janet_getabstract(argv, 0, &janet_hamt_type);
+    JanetHamt *copy = hamt_clone(m);
+    for (int32_t i = 1; i < argc; i++) {
+        JanetHamt *other = janet_checkabstract(argv[i], &janet_hamt_type);
+        if (NULL != other) {
+            hamt_walk(other->root, hamt_set_pair, copy);
+            continue;
+        }
+        JanetDictView view = janet_getdictionary(argv, i);
+        for (int32_t j = 0; j < view.cap; j++) {
+            const JanetKV *kv = view.kvs + j;
+            if (!janet_checktype(kv->key, JANET_NIL)) {
+                hamt_set(copy, kv->key, kv->value);
+            }
+        }
+    }
+    return janet_wrap_abstract(copy);
+}
+
+static int hamt_struct_pair(void *p, Janet key, Janet value) {
+    janet_struct_put((JanetKV *) p, key, value);
+    return 0;
+}
+
+JANET_CORE_FN(cfun_hamt_to_struct,
+              "(hamt/to-struct m)",
+              "Convert a hamt to a struct with the same pairs.") {
+    janet_fixarity(argc, 1);
+    JanetHamt *m = janet_getabstract(argv, 0, &janet_hamt_type);
+    JanetKV *st = janet_struct_begin(m->count);
+    hamt_walk(m->root, hamt_struct_pair, st);
+    return janet_wrap_struct(janet_struct_end(st));
+}
+
+/* Load the hamt module */
+void janet_lib_hamt(JanetTable *env) {
+    JanetRegExt hamt_cfuns[] = {
+        JANET_CORE_REG("hamt/new", cfun_hamt_new),
+        JANET_CORE_REG("hamt/put", cfun_hamt_put),
+        JANET_CORE_REG("hamt/remove", cfun_hamt_remove),
+        JANET_CORE_REG("hamt/merge", cfun_hamt_merge),
+        JANET_CORE_REG("hamt/to-struct", cfun_hamt_to_struct),
+        JANET_REG_END
+    };
+    janet_core_cfuns_ext(env, NULL, hamt_cfuns);
+    janet_register_abstract_type(&janet_hamt_type);
+}
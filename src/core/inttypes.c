@@ -72,15 +72,22 @@ static void *int64_unmarshal(JanetMarshalContext *ctx) {
 }
 
 static void it_s64_tostring(void *p, JanetBuffer *buffer) {
-    char str[32];
-    sprintf(str, "%" PRId64, *((int64_t *)p));
-    janet_buffer_push_cstring(buffer, str);
+    uint8_t str[24];
+    int64_t x = *((int64_t *)p);
+    int32_t len = 0;
+    uint64_t mag = (uint64_t) x;
+    if (x < 0) {
+        str[len++] = '-';
+        mag = 0 - mag;
+    }
+    len += janet_u64_digits(str + len, mag);
+    janet_buffer_push_bytes(buffer, str, len);
 }
 
 static void it_u64_tostring(void *p, JanetBuffer *buffer) {
-    char str[32];
-    sprintf(str, "%" PRIu64, *((uint64_t *)p));
-    janet_buffer_push_cstring(buffer, str);
+    uint8_t str[24];
+    int32_t len = janet_u64_digits(str, *((uint64_t *)p));
+    janet_buffer_push_bytes(buffer, str, len);
 }
 
 const JanetAbstractType janet_s64_type = {
@@ -641,6 +648,59 @@ static JanetMethod it_u64_methods[] = {
     {NULL, NULL}
 };
 
+/* Methods for each JanetIntOp, in order, as {method, rmethod}. */
+static const JanetCFunction it_s64_binops[][2] = {
+    {cfun_it_s64_add, cfun_it_s64_add},
+    {cfun_it_s64_sub, cfun_it_s64_subi},
+    {cfun_it_s64_mul, cfun_it_s64_mul},
+    {cfun_it_s64_div, cfun_it_s64_divi},
+    {cfun_it_s64_divf, cfun_it_s64_divfi},
+    {cfun_it_s64_mod, cfun_it_s64_modi},
+    {cfun_it_s64_rem, cfun_it_s64_remi},
+    {cfun_it_s64_and, cfun_it_s64_and},
+    {cfun_it_s64_or, cfun_it_s64_or},
+    {cfun_it_s64_xor, cfun_it_s64_xor},
+    {cfun_it_s64_lshift, NULL},
+    {cfun_it_s64_rshift, NULL}
+};
+
+static const JanetCFunction it_u64_binops[][2] = {
+    {cfun_it_u64_add, cfun_it_u64_add},
+    {cfun_it_u64_sub, cfun_it_u64_subi},
+    {cfun_it_u64_mul, cfun_it_u64_mul},
+    {cfun_it_u64_div, cfun_it_u64_divi},
+    {cfun_it_u64_div, cfun_it_u64_divi},
+    {cfun_it_u64_mod, cfun_it_u64_modi},
+    {cfun_it_u64_rem, cfun_it_u64_remi},
+    {cfun_it_u64_and, cfun_it_u64_and},
+    {cfun_it_u64_or, cfun_it_u64_or},
+    {cfun_it_u64_xor, cfun_it_u64_xor},
+    {cfun_it_u64_lshift, NULL},
+    {cfun_it_u64_rshift, NULL}
+};
+
+/* Arithmetic fast path for the VM. Calls the same method that janet_binop_call
+ * would find, without looking it up by name. Returns 0 if neither operand is an
+ * int/s64 or int/u64 that would handle the operation. */
+int janet_int_binop(JanetIntOp op, Janet lhs, Janet rhs, Janet *out) {
+    Janet argv[2];
+    JanetIntType type = janet_is_int(lhs);
+    int reverse = 0;
+    if (type == JANET_INT_NONE) {
+        /* Only numbers are known not to have a method of their own */
+        if (!janet_checktype(lhs, JANET_NUMBER)) return 0;
+        type = janet_is_int(rhs);
+        if (type == JANET_INT_NONE) return 0;
+        reverse = 1;
+    }
+    JanetCFunction fn = (type == JANET_INT_S64 ? it_s64_binops : it_u64_binops)[op][reverse];
+    if (NULL == fn) return 0;
+    argv[0] = reverse ? rhs : lhs;
+    argv[1] = reverse ? lhs : rhs;
+    *out = fn(2, argv);
+    return 1;
+}
+
 static Janet janet_int64_next(void *p, Janet key) {
     (void) p;
     return janet_nextmethod(it_s64_methods, key);
@@ -189,12 +189,7 @@ JANET_CORE_FN(cfun_io_fread,
     janet_arity(argc, 2, 3);
     JanetFile *iof = janet_getabstract(argv, 0, &janet_file_type);
     if (iof->flags & JANET_FILE_CLOSED) janet_panic("file is closed");
-    JanetBuffer *buffer;
-    if (argc == 2) {
-        buffer = janet_buffer(0);
-    } else {
-        buffer = janet_getbuffer(argv, 2);
-    }
+    JanetBuffer *buffer = janet_optreadbuffer(argv, argc, 2, 0);
     int32_t bufstart = buffer->count;
     if (janet_checktype(argv[1], JANET_KEYWORD)) {
         const uint8_t *sym = janet_unwrap_keyword(argv[1]);
@@ -556,6 +551,17 @@ JANET_CORE_FN(cfun_io_xprin,
     return cfun_io_print_impl_x(argc, argv, 0, NULL, 1, argv[0]);
 }
 
+struct PrintfWriter {
+    FILE *file;
+    int32_t failed;
+};
+
+static void printf_write(void *data, const uint8_t *bytes, int32_t len) {
+    struct PrintfWriter *w = data;
+    if (w->failed) return;
+    if (1 != fwrite(bytes, len, 1, w->file)) w->failed = len;
+}
+
 static Janet cfun_io_printf_impl_x(int32_t argc, Janet *argv, int newline,
                                    FILE *dflt_file, int32_t offset, Janet x) {
     FILE *f;
@@ -597,19 +603,22 @@ static Janet cfun_io_printf_impl_x(int32_t argc, Janet *argv, int newline,
             break;
         }
     }
+    /* Write to the file in chunks as the output is formatted, so that printing
+     * a large value does not need a buffer as large as the output. */
+    struct PrintfWriter w;
+    w.file = f;
+    w.failed = 0;
     JanetBuffer *buf = janet_buffer(10);
-    janet_buffer_format(buf, fmt, offset, argc, argv);
-    if (newline) janet_buffer_push_u8(buf, '\n');
-    if (buf->count) {
-        if (1 != fwrite(buf->data, buf->count, 1, f)) {
-            janet_panicf("could not print %d bytes to file", buf->count);
-        }
-    }
+    janet_buffer_format_to(buf, fmt, offset, argc, argv, printf_write, &w);
+    if (newline) printf_write(&w, (const uint8_t *) "\n", 1);
     /* Clear buffer to make things easier for GC */
     buf->count = 0;
     buf->capacity = 0;
     janet_free(buf->data);
     buf->data = NULL;
+    if (w.failed) {
+        janet_panicf("could not print %d bytes to file", w.failed);
+    }
     return janet_wrap_nil();
 }
 
@@ -0,0 +1,517 @@
+/*
+* Copyright (c) 2023 Calvin Rose
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to
+* deal in the Software without restriction, including without limitation the
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+* sell copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#ifndef JANET_AMALG
+#include "features.h"
+#include <janet.h>
+#include "state.h"
+#include "util.h"
+#include "vector.h"
+#endif
+
+/* Baseline JIT. Translates a funcdef's bytecode instruction by instruction
+ * to native code that works directly on the fiber stack, like the interpreter.
+ * Only the numeric fast paths of arithmetic, comparisons, moves, loads and jumps
+ * are translated. Every other instruction, and any operand that is not a finite
+ * number, leaves native code and returns the index of the instruction to resume
+ * at in the interpreter. Since native code keeps no state of its own between
+ * instructions, the interpreter can enter it again at any instruction. */
+
+#ifdef JANET_JIT
+
+#if defined(JANET_NANBOX_64) && (defined(__x86_64__) || defined(_M_X64))
+#define JANET_JIT_X64
+#endif
+
+#ifdef JANET_JIT_X64
+
+#ifdef JANET_WINDOWS
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#include <stddef.h>
+
+/* Native code for a funcdef */
+typedef struct {
+    uint8_t *code;
+    size_t size;
+    int32_t *offsets; /* Native offset of each instruction */
+} JanetJit;
+
+typedef uint32_t (*JanetJitFn)(Janet *stack, JanetVM *vm, const uint8_t *entry);
+
+/* A rel32 to patch once all code is emitted */
+typedef struct {
+    int32_t at;
+    int32_t index;
+    int exit;
+} JanetJitFixup;
+
+typedef struct {
+    JanetBuffer code;
+    JanetJitFixup *fixups;
+    int32_t *offsets;
+    int32_t *exits;
+} JanetJitState;
+
+/* Nanbox constants */
+#define JIT_FALSE (janet_nanbox_tag(JANET_BOOLEAN))
+#define JIT_NIL (janet_nanbox_tag(JANET_NIL) | 1)
+/* Doubled bits of a value are below this if the value is a finite number */
+#define JIT_FINITE_LIMIT 0xFFE0000000000000llu
+
+static void jit_bytes(JanetJitState *s, const char *bytes, int32_t n) {
+    janet_buffer_push_bytes(&s->code, (const uint8_t *) bytes, n);
+}
+
+static void jit_u32(JanetJitState *s, uint32_t x) {
+    uint8_t b[4] = {x & 0xFF, (x >> 8) & 0xFF, (x >> 16) & 0xFF, (x >> 24) & 0xFF};
+    janet_buffer_push_bytes(&s->code, b, 4);
+}
+
+static void jit_u64(JanetJitState *s, uint64_t x) {
+    jit_u32(s, (uint32_t) x);
+    jit_u32(s, (uint32_t)(x >> 32));
+}
+
+/* Emit a rel32 jump or conditional jump to an instruction, or to the exit for an instruction. */
+static void jit_jump(JanetJitState *s, const char *op, int32_t oplen, int32_t index, int exit) {
+    jit_bytes(s, op, oplen);
+    JanetJitFixup fixup;
+    fixup.at = s->code.count;
+    fixup.index = index;
+    fixup.exit = exit;
+    janet_v_push(s->fixups, fixup);
+    jit_u32(s, 0);
+}
+
+#define jit_je(s, i, x) jit_jump((s), "\x0F\x84", 2, (i), (x))
+#define jit_jne(s, i, x) jit_jump((s), "\x0F\x85", 2, (i), (x))
+#define jit_jae(s, i, x) jit_jump((s), "\x0F\x83", 2, (i), (x))
+#define jit_jmp(s, i, x) jit_jump((s), "\xE9", 1, (i), (x))
+
+/* mov reg, [r8 + 8 * slot] and mov [r8 + 8 * slot], reg */
+static void jit_slot(JanetJitState *s, const char *op, int32_t slot) {
+    jit_bytes(s, op, 3);
+    jit_u32(s, (uint32_t) slot * 8);
+}
+
+#define jit_load_rax(s, slot) jit_slot((s), "\x49\x8B\x80", (slot))
+#define jit_store_rax(s, slot) jit_slot((s), "\x49\x89\x80", (slot))
+#define jit_store_rcx(s, slot) jit_slot((s), "\x49\x89\x88", (slot))
+#define jit_store_r10(s, slot) jit_slot((s), "\x4D\x89\x90", (slot))
+
+static void jit_store_xmm0(JanetJitState *s, int32_t slot) {
+    jit_bytes(s, "\xF2\x41\x0F\x11\x80", 5);
+    jit_u32(s, (uint32_t) slot * 8);
+}
+
+static void jit_mov_rax_imm(JanetJitState *s, uint64_t x) {
+    jit_bytes(s, "\x48\xB8", 2);
+    jit_u64(s, x);
+}
+
+/* Load a slot into xmm0 or xmm1, leaving native code at instruction i
+ * if it is not a finite number. */
+static void jit_load_number(JanetJitState *s, int32_t slot, int xmm, int32_t i) {
+    jit_load_rax(s, slot);
+    jit_bytes(s, "\x48\x8D\x14\x00", 4); /* lea rdx, [rax + rax] */
+    jit_bytes(s, "\x4C\x39\xDA", 3); /* cmp rdx, r11 */
+    jit_jae(s, i, 1);
+    jit_bytes(s, xmm ? "\x66\x48\x0F\x6E\xC8" : "\x66\x48\x0F\x6E\xC0", 5); /* movq xmmN, rax */
+}
+
+static void jit_load_immediate(JanetJitState *s, double x) {
+    Janet j = janet_wrap_number(x);
+    jit_mov_rax_imm(s, j.u64);
+    jit_bytes(s, "\x66\x48\x0F\x6E\xC8", 5); /* movq xmm1, rax */
+}
+
+/* xmm0 = xmm0 op xmm1, stored in slot */
+static void jit_arith(JanetJitState *s, uint8_t op, int32_t dest) {
+    char bytes[4] = {'\xF2', '\x0F', (char) op, '\xC1'};
+    jit_bytes(s, bytes, 4);
+    jit_store_xmm0(s, dest);
+}
+
+/* Compare xmm0 and xmm1, and store the boolean result in slot */
+static void jit_compare(JanetJitState *s, uint8_t setcc, int32_t dest) {
+    char bytes[3] = {'\x0F', (char) setcc, '\xC0'};
+    jit_bytes(s, "\x66\x0F\x2E\xC1", 4); /* ucomisd xmm0, xmm1 */
+    jit_bytes(s, bytes, 3); /* setcc al */
+    jit_bytes(s, "\x0F\xB6\xC0", 3); /* movzx eax, al */
+    jit_bytes(s, "\x4C\x09\xD0", 3); /* or rax, r10 */
+    jit_store_rax(s, dest);
+}
+
+/* Leave native code at instruction i if the interpreter wants to suspend or sample */
+static void jit_check_flags(JanetJitState *s, int32_t i) {
+#ifndef JANET_NO_INTERPRETER_INTERRUPT
+    jit_bytes(s, "\x41\x83\xB9", 3); /* cmp dword [r9 + disp32], 0 */
+    jit_u32(s, (uint32_t) offsetof(JanetVM, auto_suspend));
+    jit_bytes(s, "\x00", 1);
+    jit_jne(s, i, 1);
+#endif
+    jit_bytes(s, "\x41\x83\xB9", 3);
+    jit_u32(s, (uint32_t) offsetof(JanetVM, profile_sample));
+    jit_bytes(s, "\x00", 1);
+    jit_jne(s, i, 1);
+}
+
+/* Emit the return to the interpreter at instruction i */
+static void jit_exit(JanetJitState *s, int32_t i) {
+    jit_bytes(s, "\xB8", 1); /* mov eax, i */
+    jit_u32(s, (uint32_t) i);
+    jit_bytes(s, "\xC3", 1); /* ret */
+}
+
+/* Operands of fused instructions are the operands of the first instruction */
+static uint32_t jit_unfuse(uint32_t op) {
+    switch (op) {
+        default:
+            return op;
+        case JOP_LESS_THAN_JUMP_IF_NOT:
+            return JOP_LESS_THAN;
+        case JOP_LESS_THAN_IMMEDIATE_JUMP_IF_NOT:
+            return JOP_LESS_THAN_IMMEDIATE;
+        case JOP_LESS_THAN_EQUAL_JUMP_IF_NOT:
+            return JOP_LESS_THAN_EQUAL;
+        case JOP_GREATER_THAN_JUMP_IF_NOT:
+            return JOP_GREATER_THAN;
+        case JOP_GREATER_THAN_IMMEDIATE_JUMP_IF_NOT:
+            return JOP_GREATER_THAN_IMMEDIATE;
+        case JOP_GREATER_THAN_EQUAL_JUMP_IF_NOT:
+            return JOP_GREATER_THAN_EQUAL;
+        case JOP_EQUALS_JUMP_IF_NOT:
+            return JOP_EQUALS;
+        case JOP_EQUALS_IMMEDIATE_JUMP_IF_NOT:
+            return JOP_EQUALS_IMMEDIATE;
+        case JOP_NOT_EQUALS_JUMP_IF_NOT:
+            return JOP_NOT_EQUALS;
+        case JOP_NOT_EQUALS_IMMEDIATE_JUMP_IF_NOT:
+            return JOP_NOT_EQUALS_IMMEDIATE;
+        case JOP_ADD_IMMEDIATE_JUMP:
+            return JOP_ADD_IMMEDIATE;
+        case JOP_LOAD_CONSTANT_GET:
+        case JOP_LOAD_CONSTANT_CALL:
+            return JOP_LOAD_CONSTANT;
+        case JOP_PUSH_CALL:
+            return JOP_PUSH;
+        /* Typed instructions still leave native code for operands that are not finite */
+        case JOP_ADD_NUMBER:
+            return JOP_ADD;
+        case JOP_SUBTRACT_NUMBER:
+            return JOP_SUBTRACT;
+        case JOP_MULTIPLY_NUMBER:
+            return JOP_MULTIPLY;
+        case JOP_DIVIDE_NUMBER:
+            return JOP_DIVIDE;
+        case JOP_LESS_THAN_NUMBER:
+            return JOP_LESS_THAN;
+        case JOP_LESS_THAN_EQUAL_NUMBER:
+            return JOP_LESS_THAN_EQUAL;
+        case JOP_GREATER_THAN_NUMBER:
+            return JOP_GREATER_THAN;
+        case JOP_GREATER_THAN_EQUAL_NUMBER:
+            return JOP_GREATER_THAN_EQUAL;
+    }
+}
+
+#define IA ((instr >> 8) & 0xFF)
+#define IB ((instr >> 16) & 0xFF)
+#define IC (instr >> 24)
+#define ID (instr >> 8)
+#define IE (instr >> 16)
+#define ICS (((int32_t) instr) >> 24)
+#define IDS (((int32_t) instr) >> 8)
+#define IES (((int32_t) instr) >> 16)
+
+static void jit_instruction(JanetJitState *s, JanetFuncDef *def, int32_t i) {
+    uint32_t instr = def->bytecode[i];
+    uint32_t op = jit_unfuse(instr & 0xFF);
+    switch (op) {
+        default:
+            /* Also catches breakpoints */
+            jit_exit(s, i);
+            break;
+        case JOP_NOOP:
+            break;
+        case JOP_ADD_IMMEDIATE:
+        case JOP_SUBTRACT_IMMEDIATE:
+        case JOP_MULTIPLY_IMMEDIATE:
+        case JOP_DIVIDE_IMMEDIATE: {
+            jit_load_number(s, IB, 0, i);
+            jit_load_immediate(s, (double) ICS);
+            jit_arith(s, op == JOP_ADD_IMMEDIATE ? 0x58
+                      : op == JOP_SUBTRACT_IMMEDIATE ? 0x5C
+                      : op == JOP_MULTIPLY_IMMEDIATE ? 0x59 : 0x5E, IA);
+            break;
+        }
+        case JOP_ADD:
+        case JOP_SUBTRACT:
+        case JOP_MULTIPLY:
+        case JOP_DIVIDE: {
+            jit_load_number(s, IB, 0, i);
+            jit_load_number(s, IC, 1, i);
+            jit_arith(s, op == JOP_ADD ? 0x58 : op == JOP_SUBTRACT ? 0x5C : op == JOP_MULTIPLY ? 0x59 : 0x5E, IA);
+            break;
+        }
+        case JOP_LESS_THAN:
+        case JOP_LESS_THAN_EQUAL:
+        case JOP_GREATER_THAN:
+        case JOP_GREATER_THAN_EQUAL:
+        case JOP_EQUALS:
+        case JOP_NOT_EQUALS: {
+            jit_load_number(s, IB, 0, i);
+            jit_load_number(s, IC, 1, i);
+            jit_compare(s, op == JOP_LESS_THAN ? 0x92
+                        : op == JOP_LESS_THAN_EQUAL ? 0x96
+                        : op == JOP_GREATER_THAN ? 0x97
+                        : op == JOP_GREATER_THAN_EQUAL ? 0x93
+                        : op == JOP_EQUALS ? 0x94 : 0x95, IA);
+            break;
+        }
+        case JOP_LESS_THAN_IMMEDIATE:
+        case JOP_GREATER_THAN_IMMEDIATE:
+        case JOP_EQUALS_IMMEDIATE:
+        case JOP_NOT_EQUALS_IMMEDIATE: {
+            jit_load_number(s, IB, 0, i);
+            jit_load_immediate(s, (double) ICS);
+            jit_compare(s, op == JOP_LESS_THAN_IMMEDIATE ? 0x92
+                        : op == JOP_GREATER_THAN_IMMEDIATE ? 0x97
+                        : op == JOP_EQUALS_IMMEDIATE ? 0x94 : 0x95, IA);
+            break;
+        }
+        case JOP_MOVE_NEAR:
+            jit_load_rax(s, IE);
+            jit_store_rax(s, IA);
+            break;
+        case JOP_MOVE_FAR:
+            jit_load_rax(s, IA);
+            jit_store_rax(s, IE);
+            break;
+        case JOP_LOAD_NIL:
+            jit_store_rcx(s, ID);
+            break;
+        case JOP_LOAD_FALSE:
+            jit_store_r10(s, ID);
+            break;
+        case JOP_LOAD_TRUE:
+            jit_bytes(s, "\x49\x8D\x42\x01", 4); /* lea rax, [r10 + 1] */
+            jit_store_rax(s, ID);
+            break;
+        case JOP_LOAD_INTEGER:
+            jit_mov_rax_imm(s, janet_wrap_number((double) IES).u64);
+            jit_store_rax(s, IA);
+            break;
+        case JOP_LOAD_CONSTANT:
+            jit_mov_rax_imm(s, def->constants[IE].u64);
+            jit_store_rax(s, IA);
+            break;
+        case JOP_JUMP:
+            if (IDS <= 0) jit_check_flags(s, i);
+            jit_jmp(s, i + IDS, 0);
+            break;
+        case JOP_JUMP_IF:
+        case JOP_JUMP_IF_NOT:
+        case JOP_JUMP_IF_NIL:
+        case JOP_JUMP_IF_NOT_NIL: {
+            int32_t target = i + IES;
+            if (IES <= 0) jit_check_flags(s, i);
+            jit_load_rax(s, IA);
+            if (op == JOP_JUMP_IF_NIL || op == JOP_JUMP_IF_NOT_NIL) {
+                jit_bytes(s, "\x48\x39\xC8", 3); /* cmp rax, rcx */
+                if (op == JOP_JUMP_IF_NIL) {
+                    jit_je(s, target, 0);
+                } else {
+                    jit_jne(s, target, 0);
+                }
+            } else if (op == JOP_JUMP_IF_NOT) {
+                jit_bytes(s, "\x4C\x39\xD0", 3); /* cmp rax, r10 */
+                jit_je(s, target, 0);
+                jit_bytes(s, "\x48\x39\xC8", 3); /* cmp rax, rcx */
+                jit_je(s, target, 0);
+            } else {
+                jit_bytes(s, "\x4C\x39\xD0", 3);
+                jit_je(s, i + 1, 0);
+                jit_bytes(s, "\x48\x39\xC8", 3);
+                jit_je(s, i + 1, 0);
+                jit_jmp(s, target, 0);
+            }
+            break;
+        }
+    }
+}
+
+/* Map executable memory and copy code into it */
+static uint8_t *jit_map(const uint8_t *bytes, size_t size) {
+#ifdef JANET_WINDOWS
+    uint8_t *ptr = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (NULL == ptr) return NULL;
+    memcpy(ptr, bytes, size);
+    DWORD old = 0;
+    if (!VirtualProtect(ptr, size, PAGE_EXECUTE_READ, &old)) {
+        VirtualFree(ptr, 0, MEM_RELEASE);
+        return NULL;
+    }
+    return ptr;
+#else
+    uint8_t *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) return NULL;
+    memcpy(ptr, bytes, size);
+    if (mprotect(ptr, size, PROT_READ | PROT_EXEC) == -1) {
+        munmap(ptr, size);
+        return NULL;
+    }
+    return ptr;
+#endif
+}
+
+static void jit_unmap(uint8_t *code, size_t size) {
+#ifdef JANET_WINDOWS
+    (void) size;
+    VirtualFree(code, 0, MEM_RELEASE);
+#else
+    munmap(code, size);
+#endif
+}
+
+int janet_jit_compile(JanetFuncDef *def) {
+    int32_t len = def->bytecode_length;
+    JanetJitState s;
+    janet_buffer_init(&s.code, 64 + 32 * len);
+    s.fixups = NULL;
+    s.offsets = janet_malloc(sizeof(int32_t) * len);
+    s.exits = janet_malloc(sizeof(int32_t) * len);
+    if (NULL == s.offsets || NULL == s.exits) {
+        JANET_OUT_OF_MEMORY;
+    }
+
+    /* Prologue - move arguments to r8 (stack) and r9 (vm), load constants,
+     * and jump to the entry instruction. Only volatile registers are used, so
+     * there is nothing to save. */
+#ifdef JANET_WINDOWS
+    jit_bytes(&s, "\x4C\x89\xC0", 3); /* mov rax, r8 */
+    jit_bytes(&s, "\x49\x89\xD1", 3); /* mov r9, rdx */
+    jit_bytes(&s, "\x49\x89\xC8", 3); /* mov r8, rcx */
+#else
+    jit_bytes(&s, "\x48\x89\xD0", 3); /* mov rax, rdx */
+    jit_bytes(&s, "\x49\x89\xF8", 3); /* mov r8, rdi */
+    jit_bytes(&s, "\x49\x89\xF1", 3); /* mov r9, rsi */
+#endif
+    jit_bytes(&s, "\x49\xBA", 2); /* mov r10, false */
+    jit_u64(&s, JIT_FALSE);
+    jit_bytes(&s, "\x49\xBB", 2); /* mov r11, finite limit */
+    jit_u64(&s, JIT_FINITE_LIMIT);
+    jit_bytes(&s, "\x48\xB9", 2); /* mov rcx, nil */
+    jit_u64(&s, JIT_NIL);
+    jit_bytes(&s, "\xFF\xE0", 2); /* jmp rax */
+
+    for (int32_t i = 0; i < len; i++) {
+        s.offsets[i] = s.code.count;
+        s.exits[i] = -1;
+        jit_instruction(&s, def, i);
+    }
+
+    /* Out of line exits for failed checks */
+    for (int32_t i = 0; i < janet_v_count(s.fixups); i++) {
+        JanetJitFixup *f = s.fixups + i;
+        if (f->exit && s.exits[f->index] < 0) {
+            s.exits[f->index] = s.code.count;
+            jit_exit(&s, f->index);
+        }
+    }
+    for (int32_t i = 0; i < janet_v_count(s.fixups); i++) {
+        JanetJitFixup *f = s.fixups + i;
+        int32_t target = f->exit ? s.exits[f->index] : s.offsets[f->index];
+        uint32_t rel = (uint32_t)(target - (f->at + 4));
+        uint8_t *p = s.code.data + f->at;
+        p[0] = rel & 0xFF;
+        p[1] = (rel >> 8) & 0xFF;
+        p[2] = (rel >> 16) & 0xFF;
+        p[3] = (rel >> 24) & 0xFF;
+    }
+
+    JanetJit *jit = janet_malloc(sizeof(JanetJit));
+    if (NULL == jit) {
+        JANET_OUT_OF_MEMORY;
+    }
+    jit->size = s.code.count;
+    jit->code = jit_map(s.code.data, jit->size);
+    jit->offsets = s.offsets;
+    janet_buffer_deinit(&s.code);
+    janet_v_free(s.fixups);
+    janet_free(s.exits);
+    if (NULL == jit->code) {
+        janet_free(jit->offsets);
+        janet_free(jit);
+        def->jit_count = -1;
+        return 0;
+    }
+    def->jit = jit;
+    return 1;
+}
+
+uint32_t janet_jit_run(JanetFuncDef *def, Janet *stack, const uint32_t *pc) {
+    JanetJit *jit = (JanetJit *) def->jit;
+    JanetJitFn fn = (JanetJitFn) jit->code;
+    return fn(stack, &janet_vm, jit->code + jit->offsets[pc - def->bytecode]);
+}
+
+void janet_jit_free(JanetFuncDef *def) {
+    JanetJit *jit = (JanetJit *) def->jit;
+    if (NULL == jit) return;
+    jit_unmap(jit->code, jit->size);
+    janet_free(jit->offsets);
+    janet_free(jit);
+    def->jit = NULL;
+}
+
+#else
+
+/* No backend for this platform - never compile anything */
+
+int janet_jit_compile(JanetFuncDef *def) {
+    def->jit_count = -1;
+    return 0;
+}
+
+uint32_t janet_jit_run(JanetFuncDef *def, Janet *stack, const uint32_t *pc) {
+    (void) stack;
+    return (uint32_t)(pc - def->bytecode);
+}
+
+void janet_jit_free(JanetFuncDef *def) {
+    def->jit = NULL;
+}
+
+#endif
+
+/* Drop native code for a funcdef and never compile it again. Needed when
+ * breakpoints are set, as native code does not check for them. */
+void janet_jit_disable(JanetFuncDef *def) {
+    janet_jit_free(def);
+    def->jit_count = -1;
+}
+
+#endif
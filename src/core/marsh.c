@@ -30,16 +30,42 @@
 #include "util.h"
 #endif
 
+#if defined(JANET_EV) && !defined(JANET_WINDOWS)
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+/* An entry in the map of values that have been marshalled. Values are
+ * compared by identity, using the number bits or heap pointer. */
+typedef struct {
+    uint64_t bits;
+    int32_t type;
+    int32_t id;
+} MarshalSeen;
+
 typedef struct {
     JanetBuffer *buf;
-    JanetTable seen;
+    MarshalSeen *seen;
+    int32_t seen_count;
+    int32_t seen_capacity;
     JanetTable *rreg;
     JanetFuncEnv **seen_envs;
     JanetFuncDef **seen_defs;
     int32_t nextid;
     int maybe_cycles;
+    JanetMarshalWriter writer;
+    void *userdata;
 } MarshalState;
 
+/* Size of the chunks handed to a marshal writer, and of the initial read
+ * window when unmarshalling from a reader. */
+#define JANET_MARSH_CHUNK 0x10000
+
+/* Strings at least this long are passed between threads by reference in
+ * unsafe mode instead of being copied into the marshalled output. */
+#define JANET_MARSH_SHARE_STRING 4096
+
 /* Lead bytes in marshaling protocol */
 enum {
     LB_REAL = 200,
@@ -68,7 +94,10 @@ enum {
     LB_STRUCT_PROTO, /* 223 */
 #ifdef JANET_EV
     LB_THREADED_ABSTRACT, /* 224 */
-    LB_POINTER_BUFFER, /* 224 */
+    LB_POINTER_BUFFER, /* 225 */
+    LB_THREADED_STRING, /* 226 */
+    LB_SHARED_SYMBOL, /* 227 */
+    LB_SHARED_KEYWORD, /* 228 */
 #endif
 } LeadBytes;
 
@@ -126,6 +155,20 @@ JanetTable *janet_env_lookup(JanetTable *env) {
     return renv;
 }
 
+/* When marshalling to a writer, hand off the buffered output once it
+ * reaches the chunk size. Nothing is ever patched after it is pushed, so
+ * written bytes do not need to be kept. */
+static void marshal_flush(MarshalState *st) {
+    if (st->buf->count) {
+        st->writer(st->userdata, st->buf->data, (size_t) st->buf->count);
+        st->buf->count = 0;
+    }
+}
+
+#define MARSH_CHECK_FLUSH(st) do { \
+    if ((st)->writer && (st)->buf->count >= JANET_MARSH_CHUNK) marshal_flush(st); \
+} while (0)
+
 /* Marshal an integer onto the buffer */
 static void pushint(MarshalState *st, int32_t x) {
     if (x >= 0 && x < 128) {
@@ -144,18 +187,28 @@ static void pushint(MarshalState *st, int32_t x) {
         intbuf[4] = x & 0xFF;
         janet_buffer_push_bytes(st->buf, intbuf, 5);
     }
+    MARSH_CHECK_FLUSH(st);
 }
 
 static void pushbyte(MarshalState *st, uint8_t b) {
     janet_buffer_push_u8(st->buf, b);
+    MARSH_CHECK_FLUSH(st);
 }
 
 static void pushbytes(MarshalState *st, const uint8_t *bytes, int32_t len) {
+    if (st->writer && len >= JANET_MARSH_CHUNK) {
+        /* Large payloads go straight to the writer without a copy */
+        marshal_flush(st);
+        st->writer(st->userdata, bytes, (size_t) len);
+        return;
+    }
     janet_buffer_push_bytes(st->buf, bytes, len);
+    MARSH_CHECK_FLUSH(st);
 }
 
 static void pushpointer(MarshalState *st, const void *ptr) {
     janet_buffer_push_bytes(st->buf, (const uint8_t *) &ptr, sizeof(ptr));
+    MARSH_CHECK_FLUSH(st);
 }
 
 /* Marshal a size_t onto the buffer */
@@ -388,18 +441,69 @@ void janet_marshal_janet(JanetMarshalContext *ctx, Janet x) {
     marshal_one(st, x, ctx->flags + 1);
 }
 
+static uint64_t marshal_seen_bits(Janet x) {
+    if (janet_checktype(x, JANET_NUMBER)) {
+        double d = janet_unwrap_number(x);
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        return bits;
+    }
+    return (uint64_t)(uintptr_t) janet_unwrap_pointer(x);
+}
+
+/* Find the slot for a value in the seen map, which must not be full */
+static MarshalSeen *marshal_seen_find(MarshalSeen *seen, int32_t capacity, uint64_t bits, int32_t type) {
+    uint32_t mask = (uint32_t) capacity - 1;
+    uint32_t i = (uint32_t) janet_hash_u64(bits) & mask;
+    while (seen[i].type >= 0 && (seen[i].bits != bits || seen[i].type != type)) {
+        i = (i + 1) & mask;
+    }
+    return seen + i;
+}
+
+/* Get the reference id of a value, or -1 if it has not been seen */
+static int32_t marshal_seen_get(MarshalState *st, Janet x) {
+    if (!st->seen_count) return -1;
+    MarshalSeen *slot = marshal_seen_find(st->seen, st->seen_capacity,
+                                          marshal_seen_bits(x), janet_type(x));
+    return slot->type < 0 ? -1 : slot->id;
+}
+
+static void marshal_seen_put(MarshalState *st, Janet x) {
+    /* Keep the map at most half full */
+    if (2 * (st->seen_count + 1) > st->seen_capacity) {
+        int32_t capacity = st->seen_capacity ? 2 * st->seen_capacity : 64;
+        /* Scratch memory is reclaimed if marshalling panics */
+        MarshalSeen *seen = janet_smalloc(sizeof(MarshalSeen) * (size_t) capacity);
+        for (int32_t i = 0; i < capacity; i++) seen[i].type = -1;
+        for (int32_t i = 0; i < st->seen_capacity; i++) {
+            if (st->seen[i].type < 0) continue;
+            *marshal_seen_find(seen, capacity, st->seen[i].bits, st->seen[i].type) = st->seen[i];
+        }
+        janet_sfree(st->seen);
+        st->seen = seen;
+        st->seen_capacity = capacity;
+    }
+    uint64_t bits = marshal_seen_bits(x);
+    int32_t type = janet_type(x);
+    MarshalSeen *slot = marshal_seen_find(st->seen, st->seen_capacity, bits, type);
+    if (slot->type < 0) st->seen_count++;
+    slot->bits = bits;
+    slot->type = type;
+    slot->id = st->nextid++;
+}
+
 #ifdef JANET_MARSHAL_DEBUG
 #define MARK_SEEN() \
     do { if (st->maybe_cycles) { \
-        Janet _check = janet_table_get(&st->seen, x); \
-        if (!janet_checktype(_check, JANET_NIL)) janet_eprintf("double MARK_SEEN on %v\n", x); \
+        if (marshal_seen_get(st, x) >= 0) janet_eprintf("double MARK_SEEN on %v\n", x); \
         janet_eprintf("made reference %d (%t) to %v\n", st->nextid, x, x); \
-        janet_table_put(&st->seen, x, janet_wrap_integer(st->nextid++)); \
+        marshal_seen_put(st, x); \
     } } while (0)
 #else
 #define MARK_SEEN() \
     do { if (st->maybe_cycles) { \
-        janet_table_put(&st->seen, x, janet_wrap_integer(st->nextid++)); \
+        marshal_seen_put(st, x); \
     } } while (0)
 #endif
 
@@ -467,10 +571,10 @@ static void marshal_one(MarshalState *st, Janet x, int flags) {
     {
         Janet check;
         if (st->maybe_cycles) {
-            check = janet_table_get(&st->seen, x);
-            if (janet_checkint(check)) {
+            int32_t id = marshal_seen_get(st, x);
+            if (id >= 0) {
                 pushbyte(st, LB_REFERENCE);
-                pushint(st, janet_unwrap_integer(check));
+                pushint(st, id);
                 return;
             }
         }
@@ -523,6 +627,26 @@ static void marshal_one(MarshalState *st, Janet x, int flags) {
             int32_t length = janet_string_length(str);
             /* Record reference */
             MARK_SEEN();
+#ifdef JANET_EV
+            if ((flags & JANET_MARSHAL_UNSAFE) && type != JANET_STRING && janet_symbol_is_shared(str)) {
+                pushbyte(st, type == JANET_SYMBOL ? LB_SHARED_SYMBOL : LB_SHARED_KEYWORD);
+                pushpointer(st, str);
+                return;
+            }
+            if ((flags & JANET_MARSHAL_UNSAFE) && type == JANET_STRING &&
+                    (length >= JANET_MARSH_SHARE_STRING || janet_string_is_threaded(str))) {
+                /* The reference in transit is released when the message is unmarshalled */
+                const uint8_t *shared = str;
+                if (janet_string_is_threaded(str)) {
+                    janet_string_incref(str);
+                } else {
+                    shared = janet_string_threaded(str, length);
+                }
+                pushbyte(st, LB_THREADED_STRING);
+                pushpointer(st, shared);
+                return;
+            }
+#endif
             uint8_t lb = (type == JANET_STRING) ? LB_STRING :
                          (type == JANET_SYMBOL) ? LB_SYMBOL :
                          LB_KEYWORD;
@@ -651,6 +775,21 @@ static void marshal_one(MarshalState *st, Janet x, int flags) {
 #undef MARK_SEEN
 }
 
+static void marshal_run(MarshalState *st, Janet x, JanetTable *rreg, int flags) {
+    st->nextid = 0;
+    st->seen_defs = NULL;
+    st->seen_envs = NULL;
+    st->rreg = rreg;
+    st->maybe_cycles = !(flags & JANET_MARSHAL_NO_CYCLES);
+    st->seen = NULL;
+    st->seen_count = 0;
+    st->seen_capacity = 0;
+    marshal_one(st, x, flags);
+    janet_sfree(st->seen);
+    janet_v_free(st->seen_envs);
+    janet_v_free(st->seen_defs);
+}
+
 void janet_marshal(
     JanetBuffer *buf,
     Janet x,
@@ -658,48 +797,124 @@ void janet_marshal(
     int flags) {
     MarshalState st;
     st.buf = buf;
-    st.nextid = 0;
-    st.seen_defs = NULL;
-    st.seen_envs = NULL;
-    st.rreg = rreg;
-    st.maybe_cycles = !(flags & JANET_MARSHAL_NO_CYCLES);
-    janet_table_init(&st.seen, 0);
-    marshal_one(&st, x, flags);
-    janet_table_deinit(&st.seen);
-    janet_v_free(st.seen_envs);
-    janet_v_free(st.seen_defs);
+    st.writer = NULL;
+    st.userdata = NULL;
+    marshal_run(&st, x, rreg, flags);
+}
+
+void janet_marshal_to(
+    JanetMarshalWriter writer,
+    void *userdata,
+    Janet x,
+    JanetTable *rreg,
+    int flags) {
+    MarshalState st;
+    /* A garbage collected buffer is not leaked if marshalling panics */
+    st.buf = janet_buffer(JANET_MARSH_CHUNK);
+    st.writer = writer;
+    st.userdata = userdata;
+    marshal_run(&st, x, rreg, flags);
+    marshal_flush(&st);
 }
 
+#ifdef JANET_EV
+
+/* Bytecode and source map of one funcdef in a shared image. The source map
+ * size is its encoded size, so that later loads can skip over it. */
+typedef struct {
+    uint32_t *bytecode;
+    JanetSourceMapping *sourcemap;
+    int32_t bytecode_length;
+    int32_t sourcemap_size;
+} JanetSharedDef;
+
+/* Code arrays of every funcdef in an image, in the order they are read */
+struct JanetImageCode {
+    int32_t count;
+    JanetSharedDef defs[];
+};
+
+#endif
+
 typedef struct {
     jmp_buf err;
     Janet *lookup;
     JanetTable *reg;
     JanetFuncEnv **lookup_envs;
     JanetFuncDef **lookup_defs;
+#ifdef JANET_EV
+    /* Only used when loading a shared image. Funcdefs take their code from
+     * code if it is set, or else add their code to record. */
+    JanetImageCode *code;
+    JanetSharedDef *record;
+    int recording;
+#endif
     const uint8_t *start;
     const uint8_t *end;
+    /* Only used when pulling input from a reader. The window holds the
+     * unread input between start and end, and discarded counts the bytes
+     * already dropped from the front of it. */
+    JanetUnmarshalReader reader;
+    void *userdata;
+    uint8_t *window;
+    size_t capacity;
+    size_t discarded;
 } UnmarshalState;
 
-#define MARSH_EOS(st, data) do { \
-    if ((data) >= (st)->end) janet_panic("unexpected end of source");\
+/* Offset of data from the beginning of the whole input, for error messages */
+static size_t marsh_index(UnmarshalState *st, const uint8_t *data) {
+    return st->discarded + (size_t)(data - st->start);
+}
+
+/* Make n bytes available at data by moving the unread input to the front
+ * of the window and filling the rest from the reader. Returns the new
+ * location of data. */
+static const uint8_t *marsh_refill(UnmarshalState *st, const uint8_t *data, size_t n) {
+    if (NULL == st->reader) janet_panic("unexpected end of source");
+    size_t unread = (size_t)(st->end - data);
+    size_t capacity = n > JANET_MARSH_CHUNK ? n : JANET_MARSH_CHUNK;
+    memmove(st->window, data, unread);
+    st->discarded += (size_t)(data - st->start);
+    /* Grow for large items, and shrink back once they are consumed */
+    if (capacity > st->capacity || st->capacity > 4 * capacity) {
+        st->window = janet_srealloc(st->window, capacity);
+        st->capacity = capacity;
+    }
+    while (unread < n) {
+        size_t got = st->reader(st->userdata, st->window + unread, st->capacity - unread);
+        if (got == 0) {
+            st->start = st->window;
+            st->end = st->window + unread;
+            janet_panic("unexpected end of source");
+        }
+        unread += got;
+    }
+    st->start = st->window;
+    st->end = st->window + unread;
+    return st->window;
+}
+
+/* Make sure the n bytes starting at data are available */
+#define MARSH_NEED(st, data, n) do { \
+    if ((size_t)((st)->end - (data)) < (size_t)(n)) (data) = marsh_refill((st), (data), (n)); \
 } while (0)
 
 /* Helper to read a 32 bit integer from an unmarshal state */
 static int32_t readint(UnmarshalState *st, const uint8_t **atdata) {
     const uint8_t *data = *atdata;
     int32_t ret;
-    MARSH_EOS(st, data);
+    MARSH_NEED(st, data, 1);
     if (*data < 128) {
         ret = *data++;
     } else if (*data < 192) {
-        MARSH_EOS(st, data + 1);
+        MARSH_NEED(st, data, 2);
         uint32_t uret = ((data[0] & 0x3F) << 8) + data[1];
         /* Sign extend 18 MSBs */
         uret |= (uret >> 13) ? 0xFFFFC000 : 0;
         ret = (int32_t)uret;
         data += 2;
     } else if (*data == LB_INTEGER) {
-        MARSH_EOS(st, data + 4);
+        MARSH_NEED(st, data, 5);
         uint32_t ui = ((uint32_t)(data[1]) << 24) |
                       ((uint32_t)(data[2]) << 16) |
                       ((uint32_t)(data[3]) << 8) |
@@ -709,7 +924,7 @@ static int32_t readint(UnmarshalState *st, const uint8_t **atdata) {
     } else {
         janet_panicf("expected integer, got byte %x at index %d",
                      *data,
-                     data - st->start);
+                     (int) marsh_index(st, data));
         ret = 0;
     }
     *atdata = data;
@@ -729,7 +944,7 @@ static int32_t readnat(UnmarshalState *st, const uint8_t **atdata) {
 static uint64_t read64(UnmarshalState *st, const uint8_t **atdata) {
     uint64_t ret;
     const uint8_t *data = *atdata;
-    MARSH_EOS(st, data);
+    MARSH_NEED(st, data, 1);
     if (*data <= 0xF0) {
         /* Single byte */
         ret = *data;
@@ -739,7 +954,7 @@ static uint64_t read64(UnmarshalState *st, const uint8_t **atdata) {
         int nbytes = *data - 0xF0;
         ret = 0;
         if (nbytes > 8) janet_panic("invalid 64 bit integer");
-        MARSH_EOS(st, data + nbytes);
+        MARSH_NEED(st, data, nbytes + 1);
         for (int i = nbytes; i > 0; i--)
             ret = (ret << 8) + data[i];
         *atdata = data + nbytes + 1;
@@ -795,7 +1010,7 @@ static const uint8_t *unmarshal_one_env(
     const uint8_t *data,
     JanetFuncEnv **out,
     int flags) {
-    MARSH_EOS(st, data);
+    MARSH_NEED(st, data, 1);
     if (*data == LB_FUNCENV_REF) {
         data++;
         int32_t index = readint(st, &data);
@@ -818,6 +1033,8 @@ static const uint8_t *unmarshal_one_env(
             env->as.fiber = janet_unwrap_fiber(fiberv);
             /* Negative offset indicates untrusted input */
             env->offset = -offset;
+            /* Closures over the copied frame can be reached from other unmarshalled values */
+            janet_env_escape(env);
         } else {
             /* Off stack variant */
             if (length == 0) {
@@ -840,7 +1057,7 @@ static const uint8_t *unmarshal_one_env(
 /* Unmarshal a series of u32s */
 static const uint8_t *janet_unmarshal_u32s(UnmarshalState *st, const uint8_t *data, uint32_t *into, int32_t n) {
     for (int32_t i = 0; i < n; i++) {
-        MARSH_EOS(st, data + 3);
+        MARSH_NEED(st, data, 4);
         into[i] =
             (uint32_t)(data[0]) |
             ((uint32_t)(data[1]) << 8) |
@@ -857,7 +1074,7 @@ static const uint8_t *unmarshal_one_def(
     const uint8_t *data,
     JanetFuncDef **out,
     int flags) {
-    MARSH_EOS(st, data);
+    MARSH_NEED(st, data, 1);
     if (*data == LB_FUNCDEF_REF) {
         data++;
         int32_t index = readint(st, &data);
@@ -868,6 +1085,10 @@ static const uint8_t *unmarshal_one_def(
         /* Initialize with values that will not break garbage collection
          * if unmarshalling fails. */
         JanetFuncDef *def = janet_gcalloc(JANET_MEMORY_FUNCDEF, sizeof(JanetFuncDef));
+#ifdef JANET_JIT
+        def->jit_count = 0;
+        def->jit = NULL;
+#endif
         def->environments_length = 0;
         def->defs_length = 0;
         def->constants_length = 0;
@@ -882,6 +1103,17 @@ static const uint8_t *unmarshal_one_def(
         def->sourcemap = NULL;
         def->symbolmap = NULL;
         def->symbolmap_length = 0;
+#ifdef JANET_EV
+        int32_t index = janet_v_count(st->lookup_defs);
+        JanetSharedDef *shared = NULL;
+        if (NULL != st->code) {
+            if (index >= st->code->count) janet_panic("shared image does not match");
+            shared = st->code->defs + index;
+        } else if (st->recording) {
+            JanetSharedDef empty = {NULL, NULL, 0, 0};
+            janet_v_push(st->record, empty);
+        }
+#endif
         janet_v_push(st->lookup_defs, def);
 
         /* Set default lengths to zero */
@@ -957,12 +1189,30 @@ static const uint8_t *unmarshal_one_def(
         }
 
         /* Unmarshal bytecode */
-        def->bytecode = janet_malloc(sizeof(uint32_t) * bytecode_length);
-        if (!def->bytecode) {
-            JANET_OUT_OF_MEMORY;
+#ifdef JANET_EV
+        if (NULL != shared) {
+            if (shared->bytecode_length != bytecode_length) janet_panic("shared image does not match");
+            MARSH_NEED(st, data, sizeof(uint32_t) * (size_t) bytecode_length);
+            data += sizeof(uint32_t) * (size_t) bytecode_length;
+            def->bytecode = shared->bytecode;
+            def->bytecode_length = bytecode_length;
+            def->gc.flags |= JANET_FUNCDEF_SHARED_CODE;
+        } else
+#endif
+        {
+            def->bytecode = janet_malloc(sizeof(uint32_t) * bytecode_length);
+            if (!def->bytecode) {
+                JANET_OUT_OF_MEMORY;
+            }
+            data = janet_unmarshal_u32s(st, data, def->bytecode, bytecode_length);
+            def->bytecode_length = bytecode_length;
+#ifdef JANET_EV
+            if (st->recording) {
+                st->record[index].bytecode = def->bytecode;
+                st->record[index].bytecode_length = bytecode_length;
+            }
+#endif
         }
-        data = janet_unmarshal_u32s(st, data, def->bytecode, bytecode_length);
-        def->bytecode_length = bytecode_length;
 
         /* Unmarshal environments */
         if (def->flags & JANET_FUNCDEF_FLAG_HASENVS) {
@@ -993,7 +1243,18 @@ static const uint8_t *unmarshal_one_def(
         def->defs_length = defs_length;
 
         /* Unmarshal source maps if needed */
+#ifdef JANET_EV
+        if ((def->flags & JANET_FUNCDEF_FLAG_HASSOURCEMAP) && NULL != shared) {
+            if (NULL == shared->sourcemap) janet_panic("shared image does not match");
+            MARSH_NEED(st, data, shared->sourcemap_size);
+            data += shared->sourcemap_size;
+            def->sourcemap = shared->sourcemap;
+        } else
+#endif
         if (def->flags & JANET_FUNCDEF_FLAG_HASSOURCEMAP) {
+#ifdef JANET_EV
+            size_t sourcemap_start = marsh_index(st, data);
+#endif
             int32_t current = 0;
             def->sourcemap = janet_malloc(sizeof(JanetSourceMapping) * (size_t) bytecode_length);
             if (!def->sourcemap) {
@@ -1004,6 +1265,12 @@ static const uint8_t *unmarshal_one_def(
                 def->sourcemap[i].line = current;
                 def->sourcemap[i].column = readint(st, &data);
             }
+#ifdef JANET_EV
+            if (st->recording) {
+                st->record[index].sourcemap = def->sourcemap;
+                st->record[index].sourcemap_size = (int32_t)(marsh_index(st, data) - sourcemap_start);
+            }
+#endif
         } else {
             def->sourcemap = NULL;
         }
@@ -1019,7 +1286,7 @@ static const uint8_t *unmarshal_one_def(
         }
 
         /* Validate */
-        if (janet_verify(def))
+        if (!(flags & JANET_MARSHAL_TRUSTED) && janet_verify(def))
             janet_panic("funcdef has invalid bytecode");
 
         /* Set def */
@@ -1051,7 +1318,9 @@ static const uint8_t *unmarshal_one_fiber(
     fiber->waiting = NULL;
     fiber->sched_id = 0;
     fiber->supervisor_channel = NULL;
+    fiber->time_slice = 0;
 #endif
+    janet_vm.fiber_count++;
 
     /* Push fiber to seen stack */
     janet_v_push(st->lookup, janet_wrap_fiber(fiber));
@@ -1077,6 +1346,7 @@ static const uint8_t *unmarshal_one_fiber(
     if (!fiber->data) {
         JANET_OUT_OF_MEMORY;
     }
+    janet_vm.fiber_stack_bytes += sizeof(Janet) * (size_t) fiber->capacity;
     for (int32_t i = 0; i < fiber->capacity; i++) {
         fiber->data[i] = janet_wrap_nil();
     }
@@ -1181,7 +1451,7 @@ static const uint8_t *unmarshal_one_fiber(
 
 void janet_unmarshal_ensure(JanetMarshalContext *ctx, size_t size) {
     UnmarshalState *st = (UnmarshalState *)(ctx->u_state);
-    MARSH_EOS(st, ctx->data + size);
+    MARSH_NEED(st, ctx->data, size + 1);
 }
 
 int32_t janet_unmarshal_int(JanetMarshalContext *ctx) {
@@ -1204,7 +1474,7 @@ void *janet_unmarshal_ptr(JanetMarshalContext *ctx) {
     }
     UnmarshalState *st = (UnmarshalState *)(ctx->u_state);
     void *ptr;
-    MARSH_EOS(st, ctx->data + sizeof(void *) - 1);
+    MARSH_NEED(st, ctx->data, sizeof(void *));
     memcpy((char *) &ptr, ctx->data, sizeof(void *));
     ctx->data += sizeof(void *);
     return ptr;
@@ -1212,13 +1482,13 @@ void *janet_unmarshal_ptr(JanetMarshalContext *ctx) {
 
 uint8_t janet_unmarshal_byte(JanetMarshalContext *ctx) {
     UnmarshalState *st = (UnmarshalState *)(ctx->u_state);
-    MARSH_EOS(st, ctx->data);
+    MARSH_NEED(st, ctx->data, 1);
     return *(ctx->data++);
 }
 
 void janet_unmarshal_bytes(JanetMarshalContext *ctx, uint8_t *dest, size_t len) {
     UnmarshalState *st = (UnmarshalState *)(ctx->u_state);
-    MARSH_EOS(st, ctx->data + len - 1);
+    MARSH_NEED(st, ctx->data, len);
     safe_memcpy(dest, ctx->data, len);
     ctx->data += len;
 }
@@ -1270,7 +1540,7 @@ static const uint8_t *unmarshal_one(
     int flags) {
     uint8_t lead;
     MARSH_STACKCHECK;
-    MARSH_EOS(st, data);
+    MARSH_NEED(st, data, 1);
     lead = data[0];
     if (lead < LB_REAL) {
         *out = janet_wrap_integer(readint(st, &data));
@@ -1288,7 +1558,7 @@ static const uint8_t *unmarshal_one(
             return data + 1;
         case LB_INTEGER:
             /* Long integer */
-            MARSH_EOS(st, data + 4);
+            MARSH_NEED(st, data, 5);
             uint32_t ui = ((uint32_t)(data[4])) |
                           ((uint32_t)(data[3]) << 8) |
                           ((uint32_t)(data[2]) << 16) |
@@ -1303,7 +1573,7 @@ static const uint8_t *unmarshal_one(
                 double d;
                 uint8_t bytes[8];
             } u;
-            MARSH_EOS(st, data + 8);
+            MARSH_NEED(st, data, 9);
 #ifdef JANET_BIG_ENDIAN
             u.bytes[0] = data[8];
             u.bytes[1] = data[7];
@@ -1327,7 +1597,7 @@ static const uint8_t *unmarshal_one(
         case LB_REGISTRY: {
             data++;
             int32_t len = readnat(st, &data);
-            MARSH_EOS(st, data - 1 + len);
+            MARSH_NEED(st, data, len);
             if (lead == LB_STRING) {
                 const uint8_t *str = janet_string(data, len);
                 *out = janet_wrap_string(str);
@@ -1399,7 +1669,7 @@ static const uint8_t *unmarshal_one(
             int32_t len = readnat(st, &data);
             /* DOS check */
             if (lead != LB_REFERENCE) {
-                MARSH_EOS(st, data - 1 + len);
+                MARSH_NEED(st, data, len);
             }
             if (lead == LB_ARRAY) {
                 /* Array */
@@ -1443,7 +1713,8 @@ static const uint8_t *unmarshal_one(
                 *out = st->lookup[len];
             } else {
                 /* Table */
-                JanetTable *t = janet_table(len);
+                /* Size the table so that filling it never rehashes */
+                JanetTable *t = janet_table(len > 0 && len < INT32_MAX / 2 ? 2 * len - 1 : len);
                 *out = janet_wrap_table(t);
                 janet_v_push(st->lookup, *out);
                 if (lead == LB_TABLE_PROTO) {
@@ -1462,12 +1733,12 @@ static const uint8_t *unmarshal_one(
             return data;
         }
         case LB_UNSAFE_POINTER: {
-            MARSH_EOS(st, data + sizeof(void *));
+            MARSH_NEED(st, data, sizeof(void *) + 1);
             data++;
             if (!(flags & JANET_MARSHAL_UNSAFE)) {
                 janet_panicf("unsafe flag not given, "
                              "will not unmarshal raw pointer at index %d",
-                             (int)(data - st->start));
+                             (int) marsh_index(st, data));
             }
             union {
                 void *ptr;
@@ -1484,7 +1755,7 @@ static const uint8_t *unmarshal_one(
             data++;
             int32_t count = readnat(st, &data);
             int32_t capacity = readnat(st, &data);
-            MARSH_EOS(st, data + sizeof(void *));
+            MARSH_NEED(st, data, sizeof(void *) + 1);
             union {
                 void *ptr;
                 uint8_t bytes[sizeof(void *)];
@@ -1492,7 +1763,7 @@ static const uint8_t *unmarshal_one(
             if (!(flags & JANET_MARSHAL_UNSAFE)) {
                 janet_panicf("unsafe flag not given, "
                              "will not unmarshal raw pointer at index %d",
-                             (int)(data - st->start));
+                             (int) marsh_index(st, data));
             }
             memcpy(u.bytes, data, sizeof(void *));
             data += sizeof(void *);
@@ -1503,12 +1774,12 @@ static const uint8_t *unmarshal_one(
         }
 #endif
         case LB_UNSAFE_CFUNCTION: {
-            MARSH_EOS(st, data + sizeof(JanetCFunction));
+            MARSH_NEED(st, data, sizeof(JanetCFunction) + 1);
             data++;
             if (!(flags & JANET_MARSHAL_UNSAFE)) {
                 janet_panicf("unsafe flag not given, "
                              "will not unmarshal function pointer at index %d",
-                             (int)(data - st->start));
+                             (int) marsh_index(st, data));
             }
             union {
                 JanetCFunction ptr;
@@ -1522,12 +1793,12 @@ static const uint8_t *unmarshal_one(
         }
 #ifdef JANET_EV
         case LB_THREADED_ABSTRACT: {
-            MARSH_EOS(st, data + sizeof(void *));
+            MARSH_NEED(st, data, sizeof(void *) + 1);
             data++;
             if (!(flags & JANET_MARSHAL_UNSAFE)) {
                 janet_panicf("unsafe flag not given, "
                              "will not unmarshal threaded abstract pointer at index %d",
-                             (int)(data - st->start));
+                             (int) marsh_index(st, data));
             }
             union {
                 void *ptr;
@@ -1555,11 +1826,65 @@ static const uint8_t *unmarshal_one(
             janet_v_push(st->lookup, *out);
             return data;
         }
+        case LB_THREADED_STRING: {
+            MARSH_NEED(st, data, sizeof(void *) + 1);
+            data++;
+            if (!(flags & JANET_MARSHAL_UNSAFE)) {
+                janet_panicf("unsafe flag not given, "
+                             "will not unmarshal threaded string pointer at index %d",
+                             (int) marsh_index(st, data));
+            }
+            union {
+                const uint8_t *ptr;
+                uint8_t bytes[sizeof(void *)];
+            } u;
+            memcpy(u.bytes, data, sizeof(void *));
+            data += sizeof(void *);
+
+            if (flags & JANET_MARSHAL_DECREF) {
+                janet_string_decref(u.ptr);
+                *out = janet_wrap_nil();
+            } else {
+                *out = janet_wrap_string(u.ptr);
+                Janet key = janet_wrap_pointer((void *) u.ptr);
+                Janet check = janet_table_get(&janet_vm.threaded_abstracts, key);
+                if (janet_checktype(check, JANET_NIL)) {
+                    /* Transfers reference from the message to the current heap */
+                    janet_table_put(&janet_vm.threaded_abstracts, key, janet_wrap_false());
+                } else {
+                    /* Heap reference already accounted for, remove the message reference. */
+                    janet_string_decref(u.ptr);
+                }
+            }
+
+            janet_v_push(st->lookup, *out);
+            return data;
+        }
+        case LB_SHARED_SYMBOL:
+        case LB_SHARED_KEYWORD: {
+            MARSH_NEED(st, data, sizeof(void *) + 1);
+            data++;
+            if (!(flags & JANET_MARSHAL_UNSAFE)) {
+                janet_panicf("unsafe flag not given, "
+                             "will not unmarshal shared symbol pointer at index %d",
+                             (int) marsh_index(st, data));
+            }
+            union {
+                const uint8_t *ptr;
+                uint8_t bytes[sizeof(void *)];
+            } u;
+            memcpy(u.bytes, data, sizeof(void *));
+            data += sizeof(void *);
+            const uint8_t *sym = janet_symbol_adopt(u.ptr);
+            *out = lead == LB_SHARED_SYMBOL ? janet_wrap_symbol(sym) : janet_wrap_keyword(sym);
+            janet_v_push(st->lookup, *out);
+            return data;
+        }
 #endif
         default: {
             janet_panicf("unknown byte %x at index %d",
                          *data,
-                         (int)(data - st->start));
+                         (int) marsh_index(st, data));
             return NULL;
         }
     }
@@ -1578,6 +1903,16 @@ Janet janet_unmarshal(
     st.lookup_envs = NULL;
     st.lookup = NULL;
     st.reg = reg;
+#ifdef JANET_EV
+    st.code = NULL;
+    st.record = NULL;
+    st.recording = 0;
+#endif
+    st.reader = NULL;
+    st.userdata = NULL;
+    st.window = NULL;
+    st.capacity = 0;
+    st.discarded = 0;
     Janet out;
     const uint8_t *nextbytes = unmarshal_one(&st, bytes, &out, flags);
     if (next) *next = nextbytes;
@@ -1587,6 +1922,97 @@ Janet janet_unmarshal(
     return out;
 }
 
+#ifdef JANET_EV
+
+/* Unmarshal an image whose bytecode and source maps are shared by every VM in
+ * the process that loads it. *code holds the shared arrays. If it is NULL, the
+ * arrays of this copy are published there, unless another thread publishes
+ * first. The shared arrays are never freed, so only use this for images that
+ * live as long as the process, such as the core image. */
+Janet janet_unmarshal_shared(
+    const uint8_t *bytes,
+    size_t len,
+    int flags,
+    JanetTable *reg,
+    JanetImageCode **code) {
+    UnmarshalState st;
+    st.start = bytes;
+    st.end = bytes + len;
+    st.lookup_defs = NULL;
+    st.lookup_envs = NULL;
+    st.lookup = NULL;
+    st.reg = reg;
+    st.code = janet_atomic_load_ptr((void **) code);
+    st.record = NULL;
+    st.recording = NULL == st.code;
+    st.reader = NULL;
+    st.userdata = NULL;
+    st.window = NULL;
+    st.capacity = 0;
+    st.discarded = 0;
+    Janet out;
+    unmarshal_one(&st, bytes, &out, flags);
+    if (st.recording) {
+        int32_t count = janet_v_count(st.record);
+        JanetImageCode *mine = janet_malloc(sizeof(JanetImageCode) + sizeof(JanetSharedDef) * (size_t) count);
+        if (NULL == mine) {
+            JANET_OUT_OF_MEMORY;
+        }
+        mine->count = count;
+        safe_memcpy(mine->defs, st.record, sizeof(JanetSharedDef) * (size_t) count);
+        if (janet_atomic_cas_ptr((void **) code, NULL, mine)) {
+            /* The arrays now belong to the process */
+            for (int32_t i = 0; i < count; i++) {
+                st.lookup_defs[i]->gc.flags |= JANET_FUNCDEF_SHARED_CODE;
+            }
+        } else {
+            /* Another thread was first, keep our own copy */
+            janet_free(mine);
+        }
+    }
+    janet_v_free(st.record);
+    janet_v_free(st.lookup_defs);
+    janet_v_free(st.lookup_envs);
+    janet_v_free(st.lookup);
+    return out;
+}
+
+#endif
+
+Janet janet_unmarshal_from(
+    JanetUnmarshalReader reader,
+    void *userdata,
+    int flags,
+    JanetTable *reg,
+    size_t *unread) {
+    UnmarshalState st;
+    st.lookup_defs = NULL;
+    st.lookup_envs = NULL;
+    st.lookup = NULL;
+    st.reg = reg;
+#ifdef JANET_EV
+    st.code = NULL;
+    st.record = NULL;
+    st.recording = 0;
+#endif
+    st.reader = reader;
+    st.userdata = userdata;
+    /* Scratch memory so the window is reclaimed if unmarshalling panics */
+    st.window = janet_smalloc(JANET_MARSH_CHUNK);
+    st.capacity = JANET_MARSH_CHUNK;
+    st.discarded = 0;
+    st.start = st.window;
+    st.end = st.window;
+    Janet out;
+    const uint8_t *nextbytes = unmarshal_one(&st, st.window, &out, flags);
+    if (unread) *unread = (size_t)(st.end - nextbytes);
+    janet_sfree(st.window);
+    janet_v_free(st.lookup_defs);
+    janet_v_free(st.lookup_envs);
+    janet_v_free(st.lookup);
+    return out;
+}
+
 /* C functions */
 
 JANET_CORE_FN(cfun_env_lookup,
@@ -1599,6 +2025,81 @@ JANET_CORE_FN(cfun_env_lookup,
     return janet_wrap_table(janet_env_lookup(env));
 }
 
+/* Writers and readers for streamed marshaling to files and streams */
+
+static void marsh_write_file(void *userdata, const uint8_t *bytes, size_t len) {
+    if (fwrite(bytes, 1, len, (FILE *) userdata) != len) {
+        janet_panic("could not write to file");
+    }
+}
+
+static size_t marsh_read_file(void *userdata, uint8_t *dest, size_t max) {
+    FILE *f = (FILE *) userdata;
+    size_t got = fread(dest, 1, max, f);
+    if (got == 0 && ferror(f)) {
+        janet_panic("could not read from file");
+    }
+    return got;
+}
+
+#if defined(JANET_EV) && !defined(JANET_WINDOWS)
+
+/* Streams are non-blocking, so wait for them with poll. This blocks the
+ * whole thread rather than just the current fiber. */
+static void marsh_stream_wait(JanetStream *stream, short events) {
+    struct pollfd pfd;
+    pfd.fd = stream->handle;
+    pfd.events = events;
+    pfd.revents = 0;
+    int status;
+    do {
+        status = poll(&pfd, 1, -1);
+    } while (status < 0 && errno == EINTR);
+}
+
+static void marsh_write_stream(void *userdata, const uint8_t *bytes, size_t len) {
+    JanetStream *stream = (JanetStream *) userdata;
+    while (len) {
+        ssize_t nwrote = write(stream->handle, bytes, len);
+        if (nwrote < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                marsh_stream_wait(stream, POLLOUT);
+                continue;
+            }
+            janet_panicv(janet_ev_lasterr());
+        }
+        bytes += nwrote;
+        len -= (size_t) nwrote;
+    }
+}
+
+static size_t marsh_read_stream(void *userdata, uint8_t *dest, size_t max) {
+    JanetStream *stream = (JanetStream *) userdata;
+    for (;;) {
+        ssize_t nread = read(stream->handle, dest, max);
+        if (nread >= 0) return (size_t) nread;
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            marsh_stream_wait(stream, POLLIN);
+            continue;
+        }
+        janet_panicv(janet_ev_lasterr());
+    }
+}
+
+static JanetStream *marsh_getstream(Janet x, uint32_t flag) {
+    JanetStream *stream = janet_checkabstract(x, &janet_stream_type);
+    if (NULL == stream) return NULL;
+    if (stream->flags & JANET_STREAM_CLOSED) janet_panic("stream is closed");
+    if (!(stream->flags & flag)) {
+        janet_panicf("stream is not %s", flag == JANET_STREAM_READABLE ? "readable" : "writable");
+    }
+    return stream;
+}
+
+#endif
+
 JANET_CORE_FN(cfun_marshal,
               "(marshal x &opt reverse-lookup buffer no-cycles)",
               "Marshal a value into a buffer and return the buffer. The buffer "
@@ -1606,22 +2107,42 @@ JANET_CORE_FN(cfun_marshal,
               "Optionally, one can pass in a reverse lookup table to not marshal "
               "aliased values that are found in the table. Then a forward "
               "lookup table can be used to recover the original value when "
-              "unmarshalling.") {
+              "unmarshalling. If no-cycles is truthy, values are not checked for "
+              "sharing, which is faster for tree shaped data but copies shared values "
+              "and cannot handle cycles. In place of the buffer, a file or stream can be "
+              "given, in which case the output is written to it in chunks as it "
+              "is produced and the file or stream is returned. Writing to a "
+              "stream blocks the current thread until the whole value is written.") {
     janet_arity(argc, 1, 4);
     JanetBuffer *buffer;
     JanetTable *rreg = NULL;
     uint32_t flags = 0;
-    if (argc > 1) {
+    if (argc > 1 && !janet_checktype(argv[1], JANET_NIL)) {
         rreg = janet_gettable(argv, 1);
     }
+    if (argc > 3 && janet_truthy(argv[3])) {
+        flags |= JANET_MARSHAL_NO_CYCLES;
+    }
     if (argc > 2) {
+        JanetFile *file = janet_checkabstract(argv[2], &janet_file_type);
+        if (file) {
+            if (!(file->flags & (JANET_FILE_WRITE | JANET_FILE_APPEND | JANET_FILE_UPDATE)))
+                janet_panic("file is not writeable");
+            if (file->flags & JANET_FILE_CLOSED) janet_panic("file is closed");
+            janet_marshal_to(marsh_write_file, file->file, argv[0], rreg, flags);
+            return argv[2];
+        }
+#if defined(JANET_EV) && !defined(JANET_WINDOWS)
+        JanetStream *stream = marsh_getstream(argv[2], JANET_STREAM_WRITABLE);
+        if (stream) {
+            janet_marshal_to(marsh_write_stream, stream, argv[0], rreg, flags);
+            return argv[2];
+        }
+#endif
         buffer = janet_getbuffer(argv, 2);
     } else {
         buffer = janet_buffer(10);
     }
-    if (argc > 3 && janet_truthy(argv[3])) {
-        flags |= JANET_MARSHAL_NO_CYCLES;
-    }
     janet_marshal(buffer, argv[0], rreg, flags);
     return janet_wrap_buffer(buffer);
 }
@@ -1630,13 +2151,33 @@ JANET_CORE_FN(cfun_unmarshal,
               "(unmarshal buffer &opt lookup)",
               "Unmarshal a value from a buffer. An optional lookup table "
               "can be provided to allow for aliases to be resolved. Returns the value "
-              "unmarshalled from the buffer.") {
+              "unmarshalled from the buffer. A file or stream can be given instead of "
+              "the buffer, in which case input is read in chunks as it is needed and "
+              "does not have to fit in memory all at once. A file is left positioned "
+              "just after the value if it is seekable. A stream may be read past the "
+              "end of the value, and reading from it blocks the current thread.") {
     janet_arity(argc, 1, 2);
-    JanetByteView view = janet_getbytes(argv, 0);
     JanetTable *reg = NULL;
     if (argc > 1) {
         reg = janet_gettable(argv, 1);
     }
+    JanetFile *file = janet_checkabstract(argv[0], &janet_file_type);
+    if (file) {
+        if (!(file->flags & (JANET_FILE_READ | JANET_FILE_UPDATE)))
+            janet_panic("file is not readable");
+        if (file->flags & JANET_FILE_CLOSED) janet_panic("file is closed");
+        size_t unread = 0;
+        Janet out = janet_unmarshal_from(marsh_read_file, file->file, 0, reg, &unread);
+        if (unread) fseek(file->file, -(long) unread, SEEK_CUR);
+        return out;
+    }
+#if defined(JANET_EV) && !defined(JANET_WINDOWS)
+    JanetStream *stream = marsh_getstream(argv[0], JANET_STREAM_READABLE);
+    if (stream) {
+        return janet_unmarshal_from(marsh_read_stream, stream, 0, reg, NULL);
+    }
+#endif
+    JanetByteView view = janet_getbytes(argv, 0);
     return janet_unmarshal(view.bytes, (size_t) view.len, 0, reg, NULL);
 }
 
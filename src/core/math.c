@@ -148,6 +148,20 @@ JANET_CORE_FN(cfun_rng_uniform,
     return janet_wrap_number(janet_rng_double(rng));
 }
 
+/* Random integer in [0, max), or [0, 2^31 - 1] if max is -1 */
+static int32_t rng_int(JanetRNG *rng, int32_t max) {
+    if (max < 0) return (int32_t)(janet_rng_u32(rng) >> 1);
+    if (max == 0) return 0;
+    uint32_t modulo = (uint32_t) max;
+    uint32_t maxgen = INT32_MAX;
+    uint32_t maxword = maxgen - (maxgen % modulo);
+    uint32_t word;
+    do {
+        word = janet_rng_u32(rng) >> 1;
+    } while (word > maxword);
+    return (int32_t)(word % modulo);
+}
+
 JANET_CORE_FN(cfun_rng_int,
               "(math/rng-int rng &opt max)",
               "Extract a random integer in the range [0, max) for max > 0 from the RNG.  "
@@ -156,22 +170,53 @@ JANET_CORE_FN(cfun_rng_int,
     janet_arity(argc, 1, 2);
     JanetRNG *rng = janet_getabstract(argv, 0, &janet_rng_type);
     if (argc == 1) {
-        uint32_t word = janet_rng_u32(rng) >> 1;
-        return janet_wrap_integer(word);
+        return janet_wrap_integer(rng_int(rng, -1));
     } else {
         int32_t max = janet_optnat(argv, argc, 1, INT32_MAX);
-        if (max == 0) return janet_wrap_number(0.0);
-        uint32_t modulo = (uint32_t) max;
-        uint32_t maxgen = INT32_MAX;
-        uint32_t maxword = maxgen - (maxgen % modulo);
-        uint32_t word;
-        do {
-            word = janet_rng_u32(rng) >> 1;
-        } while (word > maxword);
-        return janet_wrap_integer(word % modulo);
+        return janet_wrap_integer(rng_int(rng, max));
     }
 }
 
+/* Make room for n more values at the end of an array */
+static Janet *rng_push_slots(JanetArray *array, int32_t n) {
+    if (n > INT32_MAX - array->count) janet_panic("array overflow");
+    janet_array_ensure(array, array->count + n, 2);
+    Janet *slots = array->data + array->count;
+    array->count += n;
+    return slots;
+}
+
+JANET_CORE_FN(cfun_rng_uniforms,
+              "(math/rng-uniforms rng n &opt arr)",
+              "Push n random numbers in the range [0, 1) from the RNG onto the array arr, or onto a "
+              "new array if arr is not given, and return the array. The numbers are the same as "
+              "from n calls to `math/rng-uniform`."
+             ) {
+    janet_arity(argc, 2, 3);
+    JanetRNG *rng = janet_getabstract(argv, 0, &janet_rng_type);
+    int32_t n = janet_getnat(argv, 1);
+    JanetArray *array = janet_optarray(argv, argc, 2, n);
+    Janet *slots = rng_push_slots(array, n);
+    for (int32_t i = 0; i < n; i++) slots[i] = janet_wrap_number(janet_rng_double(rng));
+    return janet_wrap_array(array);
+}
+
+JANET_CORE_FN(cfun_rng_ints,
+              "(math/rng-ints rng n &opt max arr)",
+              "Push n random integers in the range [0, max) from the RNG onto the array arr, or onto "
+              "a new array if arr is not given, and return the array. The integers are the same as "
+              "from n calls to `math/rng-int`."
+             ) {
+    janet_arity(argc, 2, 4);
+    JanetRNG *rng = janet_getabstract(argv, 0, &janet_rng_type);
+    int32_t n = janet_getnat(argv, 1);
+    int32_t max = (argc > 2 && !janet_checktype(argv[2], JANET_NIL)) ? janet_getnat(argv, 2) : -1;
+    JanetArray *array = janet_optarray(argv, argc, 3, n);
+    Janet *slots = rng_push_slots(array, n);
+    for (int32_t i = 0; i < n; i++) slots[i] = janet_wrap_integer(rng_int(rng, max));
+    return janet_wrap_array(array);
+}
+
 static void rng_get_4bytes(JanetRNG *rng, uint8_t *buf) {
     uint32_t word = janet_rng_u32(rng);
     buf[0] = word & 0xFF;
@@ -214,6 +259,8 @@ static const JanetMethod rng_methods[] = {
     {"uniform", cfun_rng_uniform},
     {"int", cfun_rng_int},
     {"buffer", cfun_rng_buffer},
+    {"uniforms", cfun_rng_uniforms},
+    {"ints", cfun_rng_ints},
     {NULL, NULL}
 };
 
@@ -349,12 +396,89 @@ JANET_CORE_FN(janet_cfun_lcm, "(math/lcm x y)",
     return janet_wrap_number(janet_lcm(x, y));
 }
 
+/* Check if f is a math function that always returns a number */
+int janet_math_returns_number(JanetCFunction f) {
+    static const JanetCFunction fns[] = {
+        janet_rand, janet_cos, janet_sin, janet_tan, janet_acos, janet_asin,
+        janet_atan, janet_exp, janet_log, janet_log10, janet_log2, janet_sqrt,
+        janet_cbrt, janet_floor, janet_ceil, janet_pow, janet_trunc, janet_round,
+        janet_atan2, janet_hypot, janet_cosh, janet_acosh, janet_sinh,
+        janet_asinh, janet_tanh, janet_atanh, janet_exp2, janet_expm1,
+        janet_log1p, janet_erf, janet_erfc, janet_nextafter, janet_cfun_gcd,
+        janet_cfun_lcm, janet_fabs, janet_tgamma, janet_lgamma
+    };
+    for (size_t i = 0; i < sizeof(fns) / sizeof(fns[0]); i++) {
+        if (fns[i] == f) return 1;
+    }
+    return 0;
+}
+
+/* Get the C function behind a unary math function, or NULL */
+JanetMathKernel janet_math_kernel(JanetCFunction f) {
+    static const struct {
+        JanetCFunction cfun;
+        JanetMathKernel kernel;
+    } kernels[] = {
+        {janet_acos, acos}, {janet_asin, asin}, {janet_atan, atan}, {janet_cos, cos},
+        {janet_cosh, cosh}, {janet_acosh, acosh}, {janet_sin, sin}, {janet_sinh, sinh},
+        {janet_asinh, asinh}, {janet_tan, tan}, {janet_tanh, tanh}, {janet_atanh, atanh},
+        {janet_exp, exp}, {janet_exp2, exp2}, {janet_expm1, expm1}, {janet_log, log},
+        {janet_log10, log10}, {janet_log2, log2}, {janet_sqrt, sqrt}, {janet_cbrt, cbrt},
+        {janet_ceil, ceil}, {janet_floor, floor}, {janet_trunc, trunc}, {janet_round, round},
+        {janet_log1p, log1p}, {janet_erf, erf}, {janet_erfc, erfc}, {janet_lgamma, lgamma},
+        {janet_fabs, fabs}, {janet_tgamma, tgamma}
+    };
+    for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+        if (kernels[i].cfun == f) return kernels[i].kernel;
+    }
+    return NULL;
+}
+
+JanetMathKernel janet_getmathkernel(const Janet *argv, int32_t n) {
+    JanetMathKernel kernel = NULL;
+    if (janet_checktype(argv[n], JANET_CFUNCTION)) {
+        kernel = janet_math_kernel(janet_unwrap_cfunction(argv[n]));
+    }
+    if (NULL == kernel) {
+        janet_panicf("bad slot #%d, expected a unary math function such as math/sin, got %v", n, argv[n]);
+    }
+    return kernel;
+}
+
+JANET_CORE_FN(janet_math_map,
+              "(math/map f xs &opt dest)",
+              "Apply the unary math function f, such as `math/sin` or `math/log`, to every number in "
+              "the array or tuple xs, in one call. Results go in the array dest, which can be xs "
+              "itself, or in a new array. Returns the results.") {
+    janet_arity(argc, 2, 3);
+    JanetMathKernel kernel = janet_getmathkernel(argv, 0);
+    JanetView xs = janet_getindexed(argv, 1);
+    for (int32_t i = 0; i < xs.len; i++) {
+        if (!janet_checktype(xs.items[i], JANET_NUMBER)) {
+            janet_panicf("expected number at index %d, got %v", i, xs.items[i]);
+        }
+    }
+    JanetArray *dest;
+    if (argc > 2 && !janet_checktype(argv[2], JANET_NIL)) {
+        dest = janet_getarray(argv, 2);
+        janet_array_setcount(dest, xs.len);
+    } else {
+        dest = janet_array(xs.len);
+        dest->count = xs.len;
+    }
+    for (int32_t i = 0; i < xs.len; i++) {
+        dest->data[i] = janet_wrap_number(kernel(janet_unwrap_number(xs.items[i])));
+    }
+    return janet_wrap_array(dest);
+}
+
 /* Module entry point */
 void janet_lib_math(JanetTable *env) {
     JanetRegExt math_cfuns[] = {
         JANET_CORE_REG("not", janet_not),
         JANET_CORE_REG("math/random", janet_rand),
         JANET_CORE_REG("math/seedrandom", janet_srand),
+        JANET_CORE_REG("math/map", janet_math_map),
         JANET_CORE_REG("math/cos", janet_cos),
         JANET_CORE_REG("math/sin", janet_sin),
         JANET_CORE_REG("math/tan", janet_tan),
@@ -382,6 +506,8 @@ void janet_lib_math(JanetTable *env) {
         JANET_CORE_REG("math/rng-uniform", cfun_rng_uniform),
         JANET_CORE_REG("math/rng-int", cfun_rng_int),
         JANET_CORE_REG("math/rng-buffer", cfun_rng_buffer),
+        JANET_CORE_REG("math/rng-uniforms", cfun_rng_uniforms),
+        JANET_CORE_REG("math/rng-ints", cfun_rng_ints),
         JANET_CORE_REG("math/hypot", janet_hypot),
         JANET_CORE_REG("math/exp2", janet_exp2),
         JANET_CORE_REG("math/log1p", janet_log1p),
@@ -271,6 +271,22 @@ static int janet_get_sockettype(Janet *argv, int32_t argc, int32_t n) {
     return socktype;
 }
 
+#ifndef JANET_WINDOWS
+static void janet_fill_unix_addr(struct sockaddr_un *saddr, const char *path) {
+    saddr->sun_family = AF_UNIX;
+    size_t path_size = sizeof(saddr->sun_path);
+#ifdef JANET_LINUX
+    if (path[0] == '@') {
+        saddr->sun_path[0] = '\0';
+        snprintf(saddr->sun_path + 1, path_size - 1, "%s", path + 1);
+    } else
+#endif
+    {
+        snprintf(saddr->sun_path, path_size, "%s", path);
+    }
+}
+#endif
+
 /* Needs argc >= offset + 2 */
 /* For unix paths, just rertuns a single sockaddr and sets *is_unix to 1,
  * otherwise 0. Also, ignores is_bind when is a unix socket. */
@@ -283,17 +299,7 @@ static struct addrinfo *janet_get_addrinfo(Janet *argv, int32_t offset, int sock
         if (saddr == NULL) {
             JANET_OUT_OF_MEMORY;
         }
-        saddr->sun_family = AF_UNIX;
-        size_t path_size = sizeof(saddr->sun_path);
-#ifdef JANET_LINUX
-        if (path[0] == '@') {
-            saddr->sun_path[0] = '\0';
-            snprintf(saddr->sun_path + 1, path_size - 1, "%s", path + 1);
-        } else
-#endif
-        {
-            snprintf(saddr->sun_path, path_size, "%s", path);
-        }
+        janet_fill_unix_addr(saddr, path);
         *is_unix = 1;
         return (struct addrinfo *) saddr;
     }
@@ -322,156 +328,276 @@ static struct addrinfo *janet_get_addrinfo(Janet *argv, int32_t offset, int sock
 }
 
 /*
- * C Funs
+ * Name resolution for net/address and net/connect. getaddrinfo can block for as long
+ * as the resolver takes, so names that are not numeric addresses are looked up on the
+ * thread pool while the calling fiber waits. Results are copied out of the addrinfo list
+ * so they can cross threads and be kept in the per-thread cache.
  */
 
-JANET_CORE_FN(cfun_net_sockaddr,
-              "(net/address host port &opt type multi)",
-              "Look up the connection information for a given hostname, port, and connection type. Returns "
-              "a handle that can be used to send datagrams over network without establishing a connection. "
-              "On Posix platforms, you can use :unix for host to connect to a unix domain socket, where the name is "
-              "given in the port argument. On Linux, abstract "
-              "unix domain sockets are specified with a leading '@' character in port. If `multi` is truthy, will "
-              "return all address that match in an array instead of just the first.") {
-    janet_sandbox_assert(JANET_SANDBOX_NET_CONNECT); /* connect OR listen */
-    janet_arity(argc, 2, 4);
-    int socktype = janet_get_sockettype(argv, argc, 2);
-    int is_unix = 0;
-    int make_arr = (argc >= 3 && janet_truthy(argv[3]));
-    struct addrinfo *ai = janet_get_addrinfo(argv, 0, socktype, 0, &is_unix);
-#ifndef JANET_WINDOWS
-    /* no unix domain socket support on windows yet */
-    if (is_unix) {
-        void *abst = janet_abstract(&janet_address_type, sizeof(struct sockaddr_un));
-        memcpy(abst, ai, sizeof(struct sockaddr_un));
-        Janet ret = janet_wrap_abstract(abst);
-        return make_arr ? janet_wrap_array(janet_array_n(&ret, 1)) : ret;
+typedef struct {
+    int family;
+    int socktype;
+    int protocol;
+    socklen_t addrlen;
+    struct sockaddr_storage addr;
+} NetAddr;
+
+typedef struct {
+    int32_t count;
+    NetAddr addrs[];
+} NetAddrList;
+
+struct JanetDnsEntry {
+    char *key;
+    double expires;
+    NetAddrList *addrs;
+};
+
+#define JANET_DNS_CACHE_MAX 256
+
+static NetAddrList *net_addrlist(int32_t count) {
+    NetAddrList *list = janet_malloc(sizeof(NetAddrList) + (size_t) count * sizeof(NetAddr));
+    if (NULL == list) {
+        JANET_OUT_OF_MEMORY;
     }
-#endif
-    if (make_arr) {
-        /* Select all */
-        JanetArray *arr = janet_array(10);
-        struct addrinfo *iter = ai;
-        while (NULL != iter) {
-            void *abst = janet_abstract(&janet_address_type, iter->ai_addrlen);
-            memcpy(abst, iter->ai_addr, iter->ai_addrlen);
-            janet_array_push(arr, janet_wrap_abstract(abst));
-            iter = iter->ai_next;
-        }
-        freeaddrinfo(ai);
-        return janet_wrap_array(arr);
-    } else {
-        /* Select first */
-        if (NULL == ai) {
-            janet_panic("no data for given address");
-        }
-        void *abst = janet_abstract(&janet_address_type, ai->ai_addrlen);
-        memcpy(abst, ai->ai_addr, ai->ai_addrlen);
+    list->count = count;
+    return list;
+}
+
+static NetAddrList *net_addrlist_copy(const NetAddrList *list) {
+    NetAddrList *copy = net_addrlist(list->count);
+    memcpy(copy->addrs, list->addrs, (size_t) list->count * sizeof(NetAddr));
+    return copy;
+}
+
+/* Safe to call from any thread. Returns a getaddrinfo status. */
+static int net_lookup(const char *host, const char *port, int socktype, int flags, NetAddrList **out) {
+    struct addrinfo *ai = NULL;
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = socktype;
+    hints.ai_flags = flags;
+    int status = getaddrinfo(host, port, &hints, &ai);
+    if (status) return status;
+    int32_t count = 0;
+    for (struct addrinfo *iter = ai; iter != NULL; iter = iter->ai_next) count++;
+    NetAddrList *list = janet_malloc(sizeof(NetAddrList) + (size_t) count * sizeof(NetAddr));
+    if (NULL == list) {
         freeaddrinfo(ai);
-        return janet_wrap_abstract(abst);
+        return EAI_MEMORY;
+    }
+    list->count = count;
+    NetAddr *addr = list->addrs;
+    for (struct addrinfo *iter = ai; iter != NULL; iter = iter->ai_next, addr++) {
+        addr->family = iter->ai_family;
+        addr->socktype = iter->ai_socktype;
+        addr->protocol = iter->ai_protocol;
+        addr->addrlen = (socklen_t) iter->ai_addrlen;
+        memcpy(&addr->addr, iter->ai_addr, iter->ai_addrlen);
     }
+    freeaddrinfo(ai);
+    *out = list;
+    return 0;
 }
 
-JANET_CORE_FN(cfun_net_connect,
-              "(net/connect host port &opt type bindhost bindport)",
-              "Open a connection to communicate with a server. Returns a duplex stream "
-              "that can be used to communicate with the server. Type is an optional keyword "
-              "to specify a connection type, either :stream or :datagram. The default is :stream. "
-              "Bindhost is an optional string to select from what address to make the outgoing "
-              "connection, with the default being the same as using the OS's preferred address. ") {
-    janet_sandbox_assert(JANET_SANDBOX_NET_CONNECT);
-    janet_arity(argc, 2, 5);
+static double net_now(void) {
+    struct timespec spec;
+    janet_gettime(&spec, JANET_TIME_MONOTONIC);
+    return (double) spec.tv_sec + (double) spec.tv_nsec * 1e-9;
+}
 
-    /* Check arguments */
-    int socktype = janet_get_sockettype(argv, argc, 2);
-    int is_unix = 0;
-    char *bindhost = (char *) janet_optcstring(argv, argc, 3, NULL);
-    char *bindport = NULL;
-    if (argc >= 5 && janet_checkint(argv[4])) {
-        bindport = (char *)janet_to_string(argv[4]);
-    } else {
-        bindport = (char *)janet_optcstring(argv, argc, 4, NULL);
+static char *net_cache_key(int socktype, const char *host, const char *port) {
+    size_t len = strlen(host) + (port ? strlen(port) : 0) + 16;
+    char *key = janet_malloc(len);
+    if (NULL == key) {
+        JANET_OUT_OF_MEMORY;
     }
+    snprintf(key, len, "%d %s %s", socktype, host, port ? port : "");
+    return key;
+}
 
-    /* Where we're connecting to */
-    struct addrinfo *ai = janet_get_addrinfo(argv, 0, socktype, 0, &is_unix);
+static void net_cache_remove(int32_t i) {
+    struct JanetDnsEntry *entry = janet_vm.dns_cache + i;
+    janet_free(entry->key);
+    janet_free(entry->addrs);
+    janet_vm.dns_cache[i] = janet_vm.dns_cache[--janet_vm.dns_cache_count];
+}
 
-    /* Check if we're binding address */
-    struct addrinfo *binding = NULL;
-    if (bindhost != NULL) {
-        if (is_unix) {
-            freeaddrinfo(ai);
-            janet_panic("bindhost not supported for unix domain sockets");
+static void net_cache_clear(void) {
+    while (janet_vm.dns_cache_count > 0) net_cache_remove(0);
+}
+
+/* Returns a copy of a cached result, or NULL */
+static NetAddrList *net_cache_get(int socktype, const char *host, const char *port) {
+    if (janet_vm.dns_cache_count == 0) return NULL;
+    char *key = net_cache_key(socktype, host, port);
+    double now = net_now();
+    NetAddrList *result = NULL;
+    for (int32_t i = 0; i < janet_vm.dns_cache_count; i++) {
+        struct JanetDnsEntry *entry = janet_vm.dns_cache + i;
+        if (strcmp(entry->key, key)) continue;
+        if (entry->expires <= now) {
+            net_cache_remove(i);
+        } else {
+            result = net_addrlist_copy(entry->addrs);
         }
-        /* getaddrinfo */
-        struct addrinfo hints;
-        memset(&hints, 0, sizeof(hints));
-        hints.ai_family = AF_UNSPEC;
-        hints.ai_socktype = socktype;
-        hints.ai_flags = 0;
-        int status = getaddrinfo(bindhost, bindport, &hints, &binding);
-        if (status) {
-            freeaddrinfo(ai);
-            janet_panicf("could not get address info for bindhost: %s", gai_strerror(status));
+        break;
+    }
+    janet_free(key);
+    return result;
+}
+
+static void net_cache_put(int socktype, const char *host, const char *port, const NetAddrList *addrs) {
+    if (janet_vm.dns_cache_ttl <= 0) return;
+    double now = net_now();
+    if (janet_vm.dns_cache_count == JANET_DNS_CACHE_MAX) {
+        /* Drop expired entries, or else the one closest to expiring */
+        for (int32_t i = janet_vm.dns_cache_count - 1; i >= 0; i--) {
+            if (janet_vm.dns_cache[i].expires <= now) net_cache_remove(i);
+        }
+        if (janet_vm.dns_cache_count == JANET_DNS_CACHE_MAX) {
+            int32_t oldest = 0;
+            for (int32_t i = 1; i < janet_vm.dns_cache_count; i++) {
+                if (janet_vm.dns_cache[i].expires < janet_vm.dns_cache[oldest].expires) oldest = i;
+            }
+            net_cache_remove(oldest);
+        }
+    }
+    if (NULL == janet_vm.dns_cache) {
+        janet_vm.dns_cache = janet_malloc(JANET_DNS_CACHE_MAX * sizeof(struct JanetDnsEntry));
+        if (NULL == janet_vm.dns_cache) {
+            JANET_OUT_OF_MEMORY;
+        }
+    }
+    char *key = net_cache_key(socktype, host, port);
+    for (int32_t i = 0; i < janet_vm.dns_cache_count; i++) {
+        if (!strcmp(janet_vm.dns_cache[i].key, key)) {
+            net_cache_remove(i);
+            break;
         }
     }
+    struct JanetDnsEntry *entry = janet_vm.dns_cache + janet_vm.dns_cache_count++;
+    entry->key = key;
+    entry->expires = now + janet_vm.dns_cache_ttl;
+    entry->addrs = net_addrlist_copy(addrs);
+}
 
-    /* Create socket */
-    JSock sock = JSOCKDEFAULT;
-    void *addr = NULL;
-    socklen_t addrlen = 0;
-#ifndef JANET_WINDOWS
-    if (is_unix) {
-        sock = socket(AF_UNIX, socktype | JSOCKFLAGS, 0);
-        if (!JSOCKVALID(sock)) {
-            Janet v = janet_ev_lasterr();
-            janet_free(ai);
-            janet_panicf("could not create socket: %V", v);
+/* Resolve without going to the thread pool if the answer is cached or the host
+ * is a numeric address. Returns 1 if the name needs a real lookup, and otherwise
+ * sets *status to the getaddrinfo result and *out on success. */
+static int net_lookup_quick(const char *host, const char *port, int socktype, NetAddrList **out, int *status) {
+    *status = 0;
+    *out = net_cache_get(socktype, host, port);
+    if (NULL != *out) return 0;
+    *status = net_lookup(host, port, socktype, AI_NUMERICHOST, out);
+    return *status == EAI_NONAME;
+}
+
+typedef struct {
+    int socktype;
+    int connect;
+    int multi;
+    uint32_t sched_id;
+    int status;
+    int bind_status;
+    int lookup_host;
+    int lookup_bind;
+    NetAddrList *addrs;
+    NetAddrList *binding;
+    char *host;
+    char *port;
+    char *bindhost;
+    char *bindport;
+} NetResolve;
+
+static char *net_strdup(const char *s) {
+    if (NULL == s) return NULL;
+    size_t len = strlen(s) + 1;
+    char *copy = janet_malloc(len);
+    if (NULL == copy) {
+        JANET_OUT_OF_MEMORY;
+    }
+    memcpy(copy, s, len);
+    return copy;
+}
+
+static void net_resolve_free(NetResolve *job) {
+    janet_free(job->addrs);
+    janet_free(job->binding);
+    janet_free(job->host);
+    janet_free(job->port);
+    janet_free(job->bindhost);
+    janet_free(job->bindport);
+    janet_free(job);
+}
+
+static JanetEVGenericMessage net_resolve_subr(JanetEVGenericMessage msg) {
+    NetResolve *job = msg.argp;
+    if (job->lookup_host) {
+        job->status = net_lookup(job->host, job->port, job->socktype, 0, &job->addrs);
+    }
+    if (job->lookup_bind && !job->status) {
+        job->bind_status = net_lookup(job->bindhost, job->bindport, job->socktype, 0, &job->binding);
+    }
+    return msg;
+}
+
+/* Build the result of net/address. Returns 0 if there is nothing to return. */
+static int net_address_value(const NetAddrList *list, int multi, Janet *out) {
+    if (multi) {
+        JanetArray *arr = janet_array(list->count);
+        for (int32_t i = 0; i < list->count; i++) {
+            void *abst = janet_abstract(&janet_address_type, list->addrs[i].addrlen);
+            memcpy(abst, &list->addrs[i].addr, list->addrs[i].addrlen);
+            janet_array_push(arr, janet_wrap_abstract(abst));
         }
-        addr = (void *) ai;
-        addrlen = sizeof(struct sockaddr_un);
-    } else
-#endif
-    {
-        struct addrinfo *rp = NULL;
-        for (rp = ai; rp != NULL; rp = rp->ai_next) {
+        *out = janet_wrap_array(arr);
+        return 1;
+    }
+    if (list->count == 0) return 0;
+    void *abst = janet_abstract(&janet_address_type, list->addrs[0].addrlen);
+    memcpy(abst, &list->addrs[0].addr, list->addrs[0].addrlen);
+    *out = janet_wrap_abstract(abst);
+    return 1;
+}
+
+/* Create a socket for the first usable address, bind it if requested, and start a
+ * non-blocking connect. Returns NULL and sets *err on failure. */
+static JanetStream *net_start_connect(const NetAddrList *addrs, const NetAddrList *binding, Janet *err) {
+    JSock sock = JSOCKDEFAULT;
+    const NetAddr *addr = NULL;
+    for (int32_t i = 0; i < addrs->count; i++) {
+        const NetAddr *rp = addrs->addrs + i;
 #ifdef JANET_WINDOWS
-            sock = WSASocketW(rp->ai_family, rp->ai_socktype, rp->ai_protocol, NULL, 0, WSA_FLAG_OVERLAPPED);
+        sock = WSASocketW(rp->family, rp->socktype, rp->protocol, NULL, 0, WSA_FLAG_OVERLAPPED);
 #else
-            sock = socket(rp->ai_family, rp->ai_socktype | JSOCKFLAGS, rp->ai_protocol);
+        sock = socket(rp->family, rp->socktype | JSOCKFLAGS, rp->protocol);
 #endif
-            if (JSOCKVALID(sock)) {
-                addr = rp->ai_addr;
-                addrlen = (socklen_t) rp->ai_addrlen;
-                break;
-            }
-        }
-        if (NULL == addr) {
-            Janet v = janet_ev_lasterr();
-            if (binding) freeaddrinfo(binding);
-            freeaddrinfo(ai);
-            janet_panicf("could not create socket: %V", v);
+        if (JSOCKVALID(sock)) {
+            addr = rp;
+            break;
         }
     }
+    if (NULL == addr) {
+        *err = janet_wrap_string(janet_formatc("could not create socket: %V", janet_ev_lasterr()));
+        return NULL;
+    }
 
     /* Bind to bindhost and bindport if given */
     if (binding) {
-        struct addrinfo *rp = NULL;
         int did_bind = 0;
-        for (rp = binding; rp != NULL; rp = rp->ai_next) {
-            if (bind(sock, rp->ai_addr, (int) rp->ai_addrlen) == 0) {
+        for (int32_t i = 0; i < binding->count; i++) {
+            const NetAddr *rp = binding->addrs + i;
+            if (bind(sock, (const struct sockaddr *) &rp->addr, (int) rp->addrlen) == 0) {
                 did_bind = 1;
                 break;
             }
         }
         if (!did_bind) {
-            Janet v = janet_ev_lasterr();
-            freeaddrinfo(binding);
-            freeaddrinfo(ai);
+            *err = janet_wrap_string(janet_formatc("could not bind outgoing address: %V", janet_ev_lasterr()));
             JSOCKCLOSE(sock);
-            janet_panicf("could not bind outgoing address: %V", v);
-        } else {
-            freeaddrinfo(binding);
+            return NULL;
         }
     }
 
@@ -483,37 +609,228 @@ JANET_CORE_FN(cfun_net_connect,
 
     /* Connect to socket */
 #ifdef JANET_WINDOWS
-    int status = WSAConnect(sock, addr, addrlen, NULL, NULL, NULL, NULL);
-    int err = WSAGetLastError();
-    freeaddrinfo(ai);
+    int status = WSAConnect(sock, (const struct sockaddr *) &addr->addr, addr->addrlen, NULL, NULL, NULL, NULL);
+    int wouldblock = WSAGetLastError() == WSAEWOULDBLOCK;
 #else
-    int status = connect(sock, addr, addrlen);
-    int err = errno;
+    int status = connect(sock, (const struct sockaddr *) &addr->addr, addr->addrlen);
+    int wouldblock = errno == EINPROGRESS;
+#endif
+    if (status != 0 && !wouldblock) {
+        *err = janet_wrap_string(janet_formatc("could not connect socket: %V", janet_ev_lasterr()));
+        janet_stream_close(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+static void net_resolve_callback(JanetEVGenericMessage msg) {
+    janet_ev_dec_refcount();
+    NetResolve *job = msg.argp;
+    JanetFiber *fiber = msg.fiber;
+    janet_gcunroot(janet_wrap_fiber(fiber));
+    if (job->lookup_host && !job->status) {
+        net_cache_put(job->socktype, job->host, job->port, job->addrs);
+    }
+    if (job->lookup_bind && !job->status && !job->bind_status) {
+        net_cache_put(job->socktype, job->bindhost, job->bindport, job->binding);
+    }
+    /* The fiber may have been canceled while we were waiting */
+    if (fiber->sched_id != job->sched_id) {
+        net_resolve_free(job);
+        return;
+    }
+    if (job->status) {
+        janet_cancel(fiber, janet_wrap_string(janet_formatc("could not get address info: %s",
+                     gai_strerror(job->status))));
+    } else if (job->bind_status) {
+        janet_cancel(fiber, janet_wrap_string(janet_formatc("could not get address info for bindhost: %s",
+                     gai_strerror(job->bind_status))));
+    } else if (job->connect) {
+        Janet err;
+        JanetStream *stream = net_start_connect(job->addrs, job->binding, &err);
+        if (NULL == stream) {
+            janet_cancel(fiber, err);
+        } else {
+            /* Listen on behalf of the waiting fiber */
+            JanetFiber *root = janet_vm.root_fiber;
+            janet_vm.root_fiber = fiber;
+            janet_ev_connect(stream, MSG_NOSIGNAL);
+            janet_vm.root_fiber = root;
+        }
+    } else {
+        Janet result;
+        if (net_address_value(job->addrs, job->multi, &result)) {
+            janet_schedule(fiber, result);
+        } else {
+            janet_cancel(fiber, janet_cstringv("no data for given address"));
+        }
+    }
+    net_resolve_free(job);
+}
+
+JANET_NO_RETURN static void net_resolve_await(NetResolve *job) {
+    JanetEVGenericMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.argp = job;
+    msg.fiber = janet_vm.root_fiber;
+    job->sched_id = msg.fiber->sched_id;
+    janet_gcroot(janet_wrap_fiber(msg.fiber));
+    janet_ev_threaded_call(net_resolve_subr, msg, net_resolve_callback);
+    janet_await();
+}
+
+/* Start a job from host and port arguments, resolving right away if that can be
+ * done without blocking. */
+static NetResolve *net_resolve_new(Janet *argv, int32_t argc, int socktype, int connect) {
+    const char *host = NULL;
+    const char *port = NULL;
+    int is_unix = 0;
+#ifndef JANET_WINDOWS
+    is_unix = janet_keyeq(argv[0], "unix");
+#endif
     if (is_unix) {
-        janet_free(ai);
+        port = janet_getcstring(argv, 1);
     } else {
-        freeaddrinfo(ai);
+        host = janet_getcstring(argv, 0);
+        if (janet_checkint(argv[1])) {
+            port = (const char *) janet_to_string(argv[1]);
+        } else {
+            port = janet_optcstring(argv, argc, 1, NULL);
+        }
+    }
+    NetResolve *job = janet_calloc(1, sizeof(NetResolve));
+    if (NULL == job) {
+        JANET_OUT_OF_MEMORY;
+    }
+    job->socktype = socktype;
+    job->connect = connect;
+#ifndef JANET_WINDOWS
+    if (is_unix) {
+        job->addrs = net_addrlist(1);
+        NetAddr *addr = job->addrs->addrs;
+        memset(addr, 0, sizeof(NetAddr));
+        addr->family = AF_UNIX;
+        addr->socktype = socktype;
+        addr->addrlen = sizeof(struct sockaddr_un);
+        janet_fill_unix_addr((struct sockaddr_un *) &addr->addr, port);
+        return job;
     }
 #endif
+    int status;
+    if (net_lookup_quick(host, port, socktype, &job->addrs, &status)) {
+        job->lookup_host = 1;
+        job->host = net_strdup(host);
+        job->port = net_strdup(port);
+    } else if (status) {
+        net_resolve_free(job);
+        janet_panicf("could not get address info: %s", gai_strerror(status));
+    }
+    return job;
+}
 
-    if (status != 0) {
-#ifdef JANET_WINDOWS
-        if (err != WSAEWOULDBLOCK) {
-#else
-        if (err != EINPROGRESS) {
-#endif
-            JSOCKCLOSE(sock);
-            Janet lasterr = janet_ev_lasterr();
-            janet_panicf("could not connect socket: %V", lasterr);
+/*
+ * C Funs
+ */
+
+JANET_CORE_FN(cfun_net_sockaddr,
+              "(net/address host port &opt type multi)",
+              "Look up the connection information for a given hostname, port, and connection type. Returns "
+              "a handle that can be used to send datagrams over network without establishing a connection. "
+              "On Posix platforms, you can use :unix for host to connect to a unix domain socket, where the name is "
+              "given in the port argument. On Linux, abstract "
+              "unix domain sockets are specified with a leading '@' character in port. If `multi` is truthy, will "
+              "return all address that match in an array instead of just the first. Host names that are not "
+              "numeric addresses are resolved on the thread pool, so the event loop is not blocked by a slow "
+              "resolver. See `net/dns-cache` to keep results for a while.") {
+    janet_sandbox_assert(JANET_SANDBOX_NET_CONNECT); /* connect OR listen */
+    janet_arity(argc, 2, 4);
+    int socktype = janet_get_sockettype(argv, argc, 2);
+    int multi = (argc >= 4 && janet_truthy(argv[3]));
+    NetResolve *job = net_resolve_new(argv, argc, socktype, 0);
+    job->multi = multi;
+    if (job->lookup_host) net_resolve_await(job);
+    Janet result;
+    int ok = net_address_value(job->addrs, job->multi, &result);
+    net_resolve_free(job);
+    if (!ok) {
+        janet_panic("no data for given address");
+    }
+    return result;
+}
+
+JANET_CORE_FN(cfun_net_connect,
+              "(net/connect host port &opt type bindhost bindport)",
+              "Open a connection to communicate with a server. Returns a duplex stream "
+              "that can be used to communicate with the server. Type is an optional keyword "
+              "to specify a connection type, either :stream or :datagram. The default is :stream. "
+              "Bindhost is an optional string to select from what address to make the outgoing "
+              "connection, with the default being the same as using the OS's preferred address. "
+              "Host names are resolved like `net/address`, without blocking the event loop.") {
+    janet_sandbox_assert(JANET_SANDBOX_NET_CONNECT);
+    janet_arity(argc, 2, 5);
+
+    /* Check arguments */
+    int socktype = janet_get_sockettype(argv, argc, 2);
+    const char *bindhost = janet_optcstring(argv, argc, 3, NULL);
+    const char *bindport = NULL;
+    if (argc >= 5 && janet_checkint(argv[4])) {
+        bindport = (const char *) janet_to_string(argv[4]);
+    } else {
+        bindport = janet_optcstring(argv, argc, 4, NULL);
+    }
+    if (bindhost != NULL && janet_keyeq(argv[0], "unix")) {
+        janet_panic("bindhost not supported for unix domain sockets");
+    }
+
+    /* Where we're connecting to */
+    NetResolve *job = net_resolve_new(argv, argc, socktype, 1);
+
+    /* Check if we're binding address */
+    if (bindhost != NULL) {
+        int status;
+        if (net_lookup_quick(bindhost, bindport, socktype, &job->binding, &status)) {
+            job->lookup_bind = 1;
+            job->bindhost = net_strdup(bindhost);
+            job->bindport = net_strdup(bindport);
+        } else if (status) {
+            net_resolve_free(job);
+            janet_panicf("could not get address info for bindhost: %s", gai_strerror(status));
         }
     }
 
+    /* Resolve names on the thread pool, then connect from the callback */
+    if (job->lookup_host || job->lookup_bind) net_resolve_await(job);
+
+    Janet err;
+    JanetStream *stream = net_start_connect(job->addrs, job->binding, &err);
+    net_resolve_free(job);
+    if (NULL == stream) {
+        janet_panicv(err);
+    }
+
     /* Handle the connect() result in the event loop*/
     janet_ev_connect(stream, MSG_NOSIGNAL);
 
     janet_await();
 }
 
+JANET_CORE_FN(cfun_net_dns_cache,
+              "(net/dns-cache &opt ttl)",
+              "Keep the results of name lookups made by `net/address` and `net/connect` on this thread "
+              "for `ttl` seconds, so that repeated connections to the same host skip the resolver. "
+              "A `ttl` of 0 disables the cache and drops what it holds, which is the default. Returns "
+              "the previous ttl.") {
+    janet_arity(argc, 0, 1);
+    double old = janet_vm.dns_cache_ttl;
+    if (argc > 0) {
+        double ttl = janet_getnumber(argv, 0);
+        if (!(ttl >= 0)) janet_panicf("expected non-negative ttl, got %v", argv[0]);
+        janet_vm.dns_cache_ttl = ttl;
+        if (ttl == 0) net_cache_clear();
+    }
+    return janet_wrap_number(old);
+}
+
 static const char *serverify_socket(JSock sfd) {
     /* Set various socket options */
     int enable = 1;
@@ -577,6 +894,29 @@ JANET_CORE_FN(cfun_net_shutdown,
     return argv[0];
 }
 
+JANET_CORE_FN(cfun_net_alive,
+              "(net/alive? stream)",
+              "Check without blocking whether an idle connection can still be used. Returns false if the "
+              "stream is closed, the peer has hung up, the socket has an error, or there is unread data "
+              "waiting on it, and true otherwise. Used by `net/pool` before handing out an idle connection.") {
+    janet_fixarity(argc, 1);
+    JanetStream *stream = janet_getabstract(argv, 0, &janet_stream_type);
+    if (stream->flags & JANET_STREAM_CLOSED) return janet_wrap_false();
+    janet_stream_flags(stream, JANET_STREAM_SOCKET);
+    char c;
+#ifdef JANET_WINDOWS
+    int status = recv((SOCKET) stream->handle, &c, 1, MSG_PEEK);
+    int wouldblock = status < 0 && WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    ssize_t status;
+    do {
+        status = recv(stream->handle, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    } while (status < 0 && errno == EINTR);
+    int wouldblock = status < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+#endif
+    return janet_wrap_boolean(wouldblock);
+}
+
 JANET_CORE_FN(cfun_net_listen,
               "(net/listen host port &opt type)",
               "Creates a server. Returns a new stream that is neither readable nor "
@@ -782,7 +1122,7 @@ JANET_CORE_FN(cfun_stream_read,
     janet_arity(argc, 2, 4);
     JanetStream *stream = janet_getabstract(argv, 0, &janet_stream_type);
     janet_stream_flags(stream, JANET_STREAM_READABLE | JANET_STREAM_SOCKET);
-    JanetBuffer *buffer = janet_optbuffer(argv, argc, 2, 10);
+    JanetBuffer *buffer = janet_optreadbuffer(argv, argc, 2, 10);
     double to = janet_optnumber(argv, argc, 3, INFINITY);
     if (janet_keyeq(argv[1], "all")) {
         if (to != INFINITY) janet_addtimeout(to);
@@ -803,7 +1143,7 @@ JANET_CORE_FN(cfun_stream_chunk,
     JanetStream *stream = janet_getabstract(argv, 0, &janet_stream_type);
     janet_stream_flags(stream, JANET_STREAM_READABLE | JANET_STREAM_SOCKET);
     int32_t n = janet_getnat(argv, 1);
-    JanetBuffer *buffer = janet_optbuffer(argv, argc, 2, 10);
+    JanetBuffer *buffer = janet_optreadbuffer(argv, argc, 2, 10);
     double to = janet_optnumber(argv, argc, 3, INFINITY);
     if (to != INFINITY) janet_addtimeout(to);
     janet_ev_recvchunk(stream, buffer, n, MSG_NOSIGNAL);
@@ -818,23 +1158,90 @@ JANET_CORE_FN(cfun_stream_recv_from,
     JanetStream *stream = janet_getabstract(argv, 0, &janet_stream_type);
     janet_stream_flags(stream, JANET_STREAM_UDPSERVER | JANET_STREAM_SOCKET);
     int32_t n = janet_getnat(argv, 1);
-    JanetBuffer *buffer = janet_getbuffer(argv, 2);
+    JanetBuffer *buffer = janet_checkabstract(argv[2], &janet_buffer_pool_type)
+                          ? janet_optreadbuffer(argv, argc, 2, 10)
+                          : janet_getbuffer(argv, 2);
     double to = janet_optnumber(argv, argc, 3, INFINITY);
     if (to != INFINITY) janet_addtimeout(to);
     janet_ev_recvfrom(stream, buffer, n, MSG_NOSIGNAL);
     janet_await();
 }
 
+JANET_CORE_FN(cfun_stream_recv_many,
+              "(net/recv-many stream nbytes buffers &opt addresses timeout)",
+              "Receives a batch of datagrams from a server stream, one per buffer in the array `buffers`. "
+              "Each buffer that receives a datagram is overwritten with it, and datagrams longer than "
+              "`nbytes` are truncated. If `addresses` is an array, the socket-address of datagram i is "
+              "stored at index i; address objects already there are overwritten in place when possible. "
+              "Waits for at least one datagram and returns the number received. "
+              "Takes an optional timeout in seconds, after which will return nil.") {
+    janet_arity(argc, 3, 5);
+    JanetStream *stream = janet_getabstract(argv, 0, &janet_stream_type);
+    janet_stream_flags(stream, JANET_STREAM_UDPSERVER | JANET_STREAM_SOCKET);
+    int32_t n = janet_getnat(argv, 1);
+    JanetArray *buffers = janet_getarray(argv, 2);
+    JanetArray *addresses = janet_optarray(argv, argc, 3, 0);
+    if (argc < 4 || janet_checktype(argv[3], JANET_NIL)) addresses = NULL;
+    double to = janet_optnumber(argv, argc, 4, INFINITY);
+    if (buffers->count == 0) janet_panic("expected at least one buffer");
+    for (int32_t i = 0; i < buffers->count; i++) {
+        if (!janet_checktype(buffers->data[i], JANET_BUFFER)) {
+            janet_panicf("expected buffer, got %v", buffers->data[i]);
+        }
+    }
+    if (to != INFINITY) janet_addtimeout(to);
+    janet_ev_recvmany(stream, buffers, addresses, n, MSG_NOSIGNAL);
+    janet_await();
+}
+
+JANET_CORE_FN(cfun_stream_send_many,
+              "(net/send-many stream dest packets &opt timeout)",
+              "Writes a batch of datagrams from a server stream. `packets` is an array or tuple of byte "
+              "sequences. `dest` is either one socket-address for all packets, or an array or tuple with "
+              "a socket-address for each packet. Takes an optional timeout in seconds, after which will return nil. "
+              "Returns nil.") {
+    janet_arity(argc, 3, 4);
+    JanetStream *stream = janet_getabstract(argv, 0, &janet_stream_type);
+    janet_stream_flags(stream, JANET_STREAM_UDPSERVER | JANET_STREAM_SOCKET);
+    JanetTuple packets = janet_ev_write_items(argv, 2);
+    JanetTuple dests;
+    if (janet_checkabstract(argv[1], &janet_address_type)) {
+        dests = janet_tuple_n(argv + 1, 1);
+    } else {
+        JanetView view = janet_getindexed(argv, 1);
+        if (view.len != janet_tuple_length(packets)) {
+            janet_panicf("expected %d addresses, got %d", janet_tuple_length(packets), view.len);
+        }
+        for (int32_t i = 0; i < view.len; i++) {
+            if (!janet_checkabstract(view.items[i], &janet_address_type)) {
+                janet_panicf("expected socket address, got %v", view.items[i]);
+            }
+        }
+        dests = janet_tuple_n(view.items, view.len);
+    }
+    double to = janet_optnumber(argv, argc, 3, INFINITY);
+    if (janet_tuple_length(packets) == 0) return janet_wrap_nil();
+    if (to != INFINITY) janet_addtimeout(to);
+    janet_ev_sendmany(stream, packets, dests, MSG_NOSIGNAL);
+    janet_await();
+}
+
 JANET_CORE_FN(cfun_stream_write,
               "(net/write stream data &opt timeout)",
               "Write data to a stream, suspending the current fiber until the write "
-              "completes. Takes an optional timeout in seconds, after which will return nil. "
+              "completes. `data` can also be an array or tuple of byte sequences, which are "
+              "sent in order with as few system calls as possible. "
+              "Takes an optional timeout in seconds, after which will return nil. "
               "Returns nil, or raises an error if the write failed.") {
     janet_arity(argc, 2, 3);
     JanetStream *stream = janet_getabstract(argv, 0, &janet_stream_type);
     janet_stream_flags(stream, JANET_STREAM_WRITABLE | JANET_STREAM_SOCKET);
     double to = janet_optnumber(argv, argc, 2, INFINITY);
-    if (janet_checktype(argv[1], JANET_BUFFER)) {
+    if (janet_checktypes(argv[1], JANET_TFLAG_INDEXED)) {
+        JanetTuple items = janet_ev_write_items(argv, 1);
+        if (to != INFINITY) janet_addtimeout(to);
+        janet_ev_send_vector(stream, items, MSG_NOSIGNAL);
+    } else if (janet_checktype(argv[1], JANET_BUFFER)) {
         if (to != INFINITY) janet_addtimeout(to);
         janet_ev_send_buffer(stream, janet_getbuffer(argv, 1), MSG_NOSIGNAL);
     } else {
@@ -845,6 +1252,29 @@ JANET_CORE_FN(cfun_stream_write,
     janet_await();
 }
 
+JANET_CORE_FN(cfun_stream_sendfile,
+              "(net/sendfile stream file &opt offset length timeout)",
+              "Send the contents of a file to a socket without copying them through a buffer, "
+              "suspending the current fiber until the transfer completes. `file` can be a core/file "
+              "or a stream opened with `os/open`. Sends from byte `offset` (default 0) up to `length` bytes, "
+              "or to the end of the file if `length` is nil. "
+              "Takes an optional timeout in seconds, after which will return nil. "
+              "Returns the number of bytes sent.") {
+    janet_arity(argc, 2, 5);
+    JanetStream *stream = janet_getabstract(argv, 0, &janet_stream_type);
+    janet_stream_flags(stream, JANET_STREAM_WRITABLE | JANET_STREAM_SOCKET);
+    int64_t offset = janet_optinteger64(argv, argc, 2, 0);
+    int64_t length = janet_optinteger64(argv, argc, 3, -1);
+    if (length < -1 || (length == -1 && argc > 3 && !janet_checktype(argv[3], JANET_NIL))) {
+        janet_panic("expected non-negative length");
+    }
+    double to = janet_optnumber(argv, argc, 4, INFINITY);
+    if (length == 0) return janet_wrap_integer(0);
+    if (to != INFINITY) janet_addtimeout(to);
+    janet_ev_sendfile(stream, argv[1], offset, length);
+    janet_await();
+}
+
 JANET_CORE_FN(cfun_stream_send_to,
               "(net/send-to stream dest data &opt timeout)",
               "Writes a datagram to a server stream. dest is a the destination address of the packet. "
@@ -1005,10 +1435,15 @@ void janet_lib_net(JanetTable *env) {
         JANET_CORE_REG("net/chunk", cfun_stream_chunk),
         JANET_CORE_REG("net/write", cfun_stream_write),
         JANET_CORE_REG("net/send-to", cfun_stream_send_to),
+        JANET_CORE_REG("net/sendfile", cfun_stream_sendfile),
         JANET_CORE_REG("net/recv-from", cfun_stream_recv_from),
+        JANET_CORE_REG("net/recv-many", cfun_stream_recv_many),
+        JANET_CORE_REG("net/send-many", cfun_stream_send_many),
         JANET_CORE_REG("net/flush", cfun_stream_flush),
         JANET_CORE_REG("net/connect", cfun_net_connect),
+        JANET_CORE_REG("net/dns-cache", cfun_net_dns_cache),
         JANET_CORE_REG("net/shutdown", cfun_net_shutdown),
+        JANET_CORE_REG("net/alive?", cfun_net_alive),
         JANET_CORE_REG("net/peername", cfun_net_getpeername),
         JANET_CORE_REG("net/localname", cfun_net_getsockname),
         JANET_CORE_REG("net/address-unpack", cfun_net_address_unpack),
@@ -1023,9 +1458,15 @@ void janet_net_init(void) {
     WSADATA wsaData;
     janet_assert(!WSAStartup(MAKEWORD(2, 2), &wsaData), "could not start winsock");
 #endif
+    janet_vm.dns_cache = NULL;
+    janet_vm.dns_cache_count = 0;
+    janet_vm.dns_cache_ttl = 0;
 }
 
 void janet_net_deinit(void) {
+    net_cache_clear();
+    janet_free(janet_vm.dns_cache);
+    janet_vm.dns_cache = NULL;
 #ifdef JANET_WINDOWS
     WSACleanup();
 #endif
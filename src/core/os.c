@@ -45,6 +45,7 @@
 
 #ifdef JANET_LINUX
 #include <sched.h>
+#include <sys/syscall.h>
 #endif
 
 #ifdef JANET_WINDOWS
@@ -58,6 +59,7 @@
 #include <utime.h>
 #include <unistd.h>
 #include <dirent.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #ifdef JANET_APPLE
@@ -489,21 +491,24 @@ static JanetEVGenericMessage janet_proc_wait_subr(JanetEVGenericMessage args) {
 
 #else /* windows check */
 
+/* Use POSIX shell semantics for interpreting signals */
+static int proc_decode_status(int status) {
+    if (WIFEXITED(status)) {
+        return WEXITSTATUS(status);
+    } else if (WIFSTOPPED(status)) {
+        return WSTOPSIG(status) + 128;
+    } else {
+        return WTERMSIG(status) + 128;
+    }
+}
+
 static int proc_get_status(JanetProc *proc) {
-    /* Use POSIX shell semantics for interpreting signals */
     int status = 0;
     pid_t result;
     do {
         result = waitpid(proc->pid, &status, 0);
     } while (result == -1 && errno == EINTR);
-    if (WIFEXITED(status)) {
-        status = WEXITSTATUS(status);
-    } else if (WIFSTOPPED(status)) {
-        status = WSTOPSIG(status) + 128;
-    } else {
-        status = WTERMSIG(status) + 128;
-    }
-    return status;
+    return proc_decode_status(status);
 }
 
 /* Function that is called in separate thread to wait on a pid */
@@ -515,26 +520,74 @@ static JanetEVGenericMessage janet_proc_wait_subr(JanetEVGenericMessage args) {
 
 #endif /* End windows check */
 
+/* Record the exit status and resume the waiting fiber */
+static void janet_proc_finish(JanetProc *proc, JanetFiber *fiber, int status) {
+    proc->return_code = (int32_t) status;
+    proc->flags |= JANET_PROC_WAITED;
+    proc->flags &= ~JANET_PROC_WAITING;
+    if ((status != 0) && (proc->flags & JANET_PROC_ERROR_NONZERO)) {
+        JanetString s = janet_formatc("command failed with non-zero exit code %d", status);
+        janet_cancel(fiber, janet_wrap_string(s));
+    } else {
+        janet_schedule(fiber, janet_wrap_integer(status));
+    }
+}
+
 /* Callback that is called in main thread when subroutine completes. */
 static void janet_proc_wait_cb(JanetEVGenericMessage args) {
     janet_ev_dec_refcount();
     JanetProc *proc = (JanetProc *) args.argp;
     if (NULL != proc) {
-        int status = args.tag;
-        proc->return_code = (int32_t) status;
-        proc->flags |= JANET_PROC_WAITED;
-        proc->flags &= ~JANET_PROC_WAITING;
         janet_gcunroot(janet_wrap_abstract(proc));
         janet_gcunroot(janet_wrap_fiber(args.fiber));
-        if ((status != 0) && (proc->flags & JANET_PROC_ERROR_NONZERO)) {
-            JanetString s = janet_formatc("command failed with non-zero exit code %d", status);
-            janet_cancel(args.fiber, janet_wrap_string(s));
-        } else {
-            janet_schedule(args.fiber, janet_wrap_integer(status));
+        janet_proc_finish(proc, args.fiber, args.tag);
+    }
+}
+
+#if defined(JANET_LINUX) && defined(SYS_pidfd_open)
+#define JANET_PROC_PIDFD
+
+/* On Linux, a pidfd becomes readable when the process exits, so the event loop
+ * can wait for it without parking a thread in waitpid. */
+typedef struct {
+    JanetListenerState head;
+    JanetProc *proc;
+} ProcWaitState;
+
+static JanetAsyncStatus janet_proc_wait_machine(JanetListenerState *s, JanetAsyncEvent event) {
+    ProcWaitState *state = (ProcWaitState *) s;
+    switch (event) {
+        default:
+            break;
+        case JANET_ASYNC_EVENT_MARK:
+            janet_mark(janet_wrap_abstract(state->proc));
+            break;
+        case JANET_ASYNC_EVENT_CANCEL:
+            /* The process can be waited on again later */
+            state->proc->flags &= ~JANET_PROC_WAITING;
+            break;
+        case JANET_ASYNC_EVENT_CLOSE:
+            state->proc->flags &= ~JANET_PROC_WAITING;
+            janet_cancel(s->fiber, janet_cstringv("stream closed"));
+            return JANET_ASYNC_STATUS_DONE;
+        case JANET_ASYNC_EVENT_READ:
+        case JANET_ASYNC_EVENT_HUP: {
+            int status = 0;
+            pid_t result;
+            do {
+                result = waitpid(state->proc->pid, &status, WNOHANG);
+            } while (result == -1 && errno == EINTR);
+            if (result == 0) break;
+            s->stream->flags |= JANET_STREAM_TOCLOSE;
+            janet_proc_finish(state->proc, s->fiber, proc_decode_status(status));
+            return JANET_ASYNC_STATUS_DONE;
         }
     }
+    return JANET_ASYNC_STATUS_NOT_DONE;
 }
 
+#endif
+
 #endif /* End ev check */
 
 static int janet_proc_gc(void *p, size_t s) {
@@ -580,6 +633,18 @@ os_proc_wait_impl(JanetProc *proc) {
         janet_panicf("cannot wait twice on a process");
     }
 #ifdef JANET_EV
+#ifdef JANET_PROC_PIDFD
+    int pidfd = (int) syscall(SYS_pidfd_open, proc->pid, 0);
+    if (pidfd >= 0) {
+        proc->flags |= JANET_PROC_WAITING;
+        JanetStream *stream = janet_stream(pidfd, JANET_STREAM_READABLE, NULL);
+        ProcWaitState *state = (ProcWaitState *) janet_listen(stream, janet_proc_wait_machine,
+                               JANET_ASYNC_LISTEN_READ, sizeof(ProcWaitState), NULL);
+        state->proc = proc;
+        janet_await();
+    }
+    /* Kernels older than 5.3 fall back to the thread pool */
+#endif
     /* Event loop implementation - threaded call */
     proc->flags |= JANET_PROC_WAITING;
     JanetEVGenericMessage targs;
@@ -1164,18 +1229,31 @@ static Janet os_execute_impl(int32_t argc, Janet *argv, int is_spawn) {
         posix_spawn_file_actions_addclose(&actions, new_err);
     }
 
+    /* Ask for vfork semantics where the C library still needs to be told. Newer glibc
+     * always spawns with clone(CLONE_VM | CLONE_VFORK) and ignores the flag. */
+    posix_spawnattr_t *attrp = NULL;
+#ifdef POSIX_SPAWN_USEVFORK
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_USEVFORK);
+    attrp = &attr;
+#endif
+
     pid_t pid;
     if (janet_flag_at(flags, 1)) {
         status = posix_spawnp(&pid,
-                              child_argv[0], &actions, NULL, cargv,
+                              child_argv[0], &actions, attrp, cargv,
                               use_environ ? environ : envp);
     } else {
         status = posix_spawn(&pid,
-                             child_argv[0], &actions, NULL, cargv,
+                             child_argv[0], &actions, attrp, cargv,
                              use_environ ? environ : envp);
     }
 
     posix_spawn_file_actions_destroy(&actions);
+#ifdef POSIX_SPAWN_USEVFORK
+    posix_spawnattr_destroy(&attr);
+#endif
 
     if (pipe_in != JANET_HANDLE_NONE) close(pipe_in);
     if (pipe_out != JANET_HANDLE_NONE) close(pipe_out);
@@ -2447,6 +2525,239 @@ JANET_CORE_FN(os_pipe,
 
 #endif
 
+/* Memory mapped files */
+
+#ifdef JANET_WINDOWS
+#define JANET_MMAP_ERROR(path) janet_panicf("%s: error code %d", (path), (int) GetLastError())
+#else
+#define JANET_MMAP_ERROR(path) janet_panicf("%s: %s", (path), strerror(errno))
+#endif
+
+typedef struct {
+    void *base; /* Start of the mapping, aligned down from data to the page size */
+    size_t base_len;
+    uint8_t *data;
+    int32_t len;
+    int writable;
+} JanetMmap;
+
+static const uint8_t mmap_empty[1] = {0};
+
+static void janet_mmap_unmap(JanetMmap *m) {
+    if (NULL == m->base) return;
+#ifdef JANET_WINDOWS
+    UnmapViewOfFile(m->base);
+#else
+    munmap(m->base, m->base_len);
+#endif
+    m->base = NULL;
+    m->base_len = 0;
+    m->data = NULL;
+    m->len = 0;
+}
+
+static int janet_mmap_gc(void *p, size_t s) {
+    (void) s;
+    janet_mmap_unmap((JanetMmap *) p);
+    return 0;
+}
+
+static int janet_mmap_get(void *p, Janet key, Janet *out);
+
+static void janet_mmap_put(void *p, Janet key, Janet value) {
+    JanetMmap *m = (JanetMmap *) p;
+    if (!m->writable) janet_panic("memory map is read-only");
+    if (!janet_checkint(key)) janet_panicf("expected integer key, got %v", key);
+    if (!janet_checkint(value)) janet_panicf("expected integer value, got %v", value);
+    int32_t index = janet_unwrap_integer(key);
+    if (index < 0 || index >= m->len) janet_panicf("index %d out of range [0,%d)", index, m->len);
+    m->data[index] = (uint8_t)(janet_unwrap_integer(value) & 0xFF);
+}
+
+static size_t janet_mmap_length(void *p, size_t s) {
+    (void) s;
+    return (size_t)((JanetMmap *) p)->len;
+}
+
+int janet_mmap_writable(void *p) {
+    return ((JanetMmap *) p)->writable;
+}
+
+static JanetByteView janet_mmap_bytes(void *p, size_t s) {
+    (void) s;
+    JanetMmap *m = (JanetMmap *) p;
+    JanetByteView view;
+    view.bytes = (NULL == m->data) ? mmap_empty : m->data;
+    view.len = m->len;
+    return view;
+}
+
+const JanetAbstractType janet_mmap_type = {
+    "core/mmap",
+    janet_mmap_gc,
+    NULL,
+    janet_mmap_get,
+    janet_mmap_put,
+    NULL, /* marshal */
+    NULL, /* unmarshal */
+    NULL, /* tostring */
+    NULL, /* compare */
+    NULL, /* hash */
+    NULL, /* next */
+    NULL, /* call */
+    janet_mmap_length,
+    janet_mmap_bytes
+};
+
+JANET_CORE_FN(os_mmap,
+              "(os/mmap path &opt mode offset length)",
+              "Map a file into memory and return a core/mmap object that can be used in place of a byte "
+              "sequence without copying the file, for example with `peg/match`, `string/find`, `buffer/blit` "
+              "or `unmarshal`. `mode` is :r (the default) for a read-only mapping, or :w for a read-write "
+              "mapping whose changes are written back to the file. Bytes can be read and, for :w mappings, "
+              "changed by indexing. `offset` and `length` select part of the file, and default to the "
+              "whole file. A mapping is limited to 2GiB. The mapping is released with `os/munmap` or when "
+              "it is garbage collected.") {
+    janet_arity(argc, 1, 4);
+    const char *path = janet_getcstring(argv, 0);
+    int writable = 0;
+    if (argc > 1 && !janet_checktype(argv[1], JANET_NIL)) {
+        const uint8_t *mode = janet_getkeyword(argv, 1);
+        if (!janet_cstrcmp(mode, "w")) {
+            writable = 1;
+        } else if (janet_cstrcmp(mode, "r")) {
+            janet_panicf("expected :r or :w, got %v", argv[1]);
+        }
+    }
+    janet_sandbox_assert(JANET_SANDBOX_FS_READ);
+    if (writable) janet_sandbox_assert(JANET_SANDBOX_FS_WRITE);
+    int64_t offset = janet_optinteger64(argv, argc, 2, 0);
+    int64_t length = -1;
+    if (offset < 0) janet_panic("expected non-negative offset");
+    if (argc > 3 && !janet_checktype(argv[3], JANET_NIL)) {
+        length = janet_getinteger64(argv, 3);
+        if (length < 0) janet_panic("expected non-negative length");
+    }
+    JanetMmap *m = janet_abstract(&janet_mmap_type, sizeof(JanetMmap));
+    m->base = NULL;
+    m->base_len = 0;
+    m->data = NULL;
+    m->len = 0;
+    m->writable = writable;
+#ifdef JANET_WINDOWS
+    HANDLE fh = CreateFileA(path, writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fh == INVALID_HANDLE_VALUE) JANET_MMAP_ERROR(path);
+    LARGE_INTEGER fsize;
+    if (!GetFileSizeEx(fh, &fsize)) {
+        CloseHandle(fh);
+        JANET_MMAP_ERROR(path);
+    }
+    int64_t file_size = (int64_t) fsize.QuadPart;
+#else
+    int fd;
+    do {
+        fd = open(path, (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    } while (fd == -1 && errno == EINTR);
+    if (fd == -1) JANET_MMAP_ERROR(path);
+    struct stat st;
+    if (fstat(fd, &st)) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        JANET_MMAP_ERROR(path);
+    }
+    int64_t file_size = (int64_t) st.st_size;
+#endif
+    if (offset > file_size) offset = file_size;
+    if (length < 0 || length > file_size - offset) length = file_size - offset;
+    if (length > INT32_MAX) {
+#ifdef JANET_WINDOWS
+        CloseHandle(fh);
+#else
+        close(fd);
+#endif
+        janet_panic("mapping is larger than 2GiB, use offset and length to map part of the file");
+    }
+    if (length > 0) {
+#ifdef JANET_WINDOWS
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        int64_t align = offset % info.dwAllocationGranularity;
+        int64_t start = offset - align;
+        HANDLE mapping = CreateFileMappingA(fh, NULL, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL);
+        if (NULL == mapping) {
+            DWORD err = GetLastError();
+            CloseHandle(fh);
+            SetLastError(err);
+            JANET_MMAP_ERROR(path);
+        }
+        void *base = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+                                   (DWORD)(start >> 32), (DWORD)(start & 0xFFFFFFFF),
+                                   (SIZE_T)(length + align));
+        DWORD err = GetLastError();
+        /* The view keeps the file and the mapping object alive */
+        CloseHandle(mapping);
+        CloseHandle(fh);
+        if (NULL == base) {
+            SetLastError(err);
+            JANET_MMAP_ERROR(path);
+        }
+#else
+        int64_t align = offset % (int64_t) sysconf(_SC_PAGESIZE);
+        int64_t start = offset - align;
+        void *base = mmap(NULL, (size_t)(length + align), writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                          MAP_SHARED, fd, (off_t) start);
+        if (base == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            errno = err;
+            JANET_MMAP_ERROR(path);
+        }
+        close(fd);
+#endif
+        m->base = base;
+        m->base_len = (size_t)(length + align);
+        m->data = (uint8_t *) base + align;
+        m->len = (int32_t) length;
+    } else {
+#ifdef JANET_WINDOWS
+        CloseHandle(fh);
+#else
+        close(fd);
+#endif
+    }
+    return janet_wrap_abstract(m);
+}
+
+JANET_CORE_FN(os_munmap,
+              "(os/munmap m)",
+              "Release a memory mapping made with `os/mmap`. Changes to a :w mapping are written back to "
+              "the file, and the mapping then behaves like an empty byte sequence. Returns nil.") {
+    janet_fixarity(argc, 1);
+    JanetMmap *m = janet_getabstract(argv, 0, &janet_mmap_type);
+    janet_mmap_unmap(m);
+    return janet_wrap_nil();
+}
+
+static const JanetMethod janet_mmap_methods[] = {
+    {"close", os_munmap},
+    {NULL, NULL}
+};
+
+static int janet_mmap_get(void *p, Janet key, Janet *out) {
+    JanetMmap *m = (JanetMmap *) p;
+    if (janet_checktype(key, JANET_KEYWORD)) {
+        return janet_getmethod(janet_unwrap_keyword(key), janet_mmap_methods, out);
+    }
+    if (!janet_checkint(key)) return 0;
+    int32_t index = janet_unwrap_integer(key);
+    if (index < 0 || index >= m->len) return 0;
+    *out = janet_wrap_integer(m->data[index]);
+    return 1;
+}
+
 #endif /* JANET_REDUCED_OS */
 
 /* Module entry point */
@@ -2537,6 +2848,8 @@ void janet_lib_os(JanetTable *env) {
         JANET_CORE_REG("os/open", os_open), /* fs read and write */
         JANET_CORE_REG("os/pipe", os_pipe),
 #endif
+        JANET_CORE_REG("os/mmap", os_mmap),
+        JANET_CORE_REG("os/munmap", os_munmap),
 #endif
         JANET_REG_END
     };
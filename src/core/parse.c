@@ -24,6 +24,7 @@
 #include "features.h"
 #include <janet.h>
 #include "util.h"
+#include "simd.h"
 #endif
 
 #define JANET_PARSER_DEAD 0x1
@@ -67,8 +68,10 @@ int janet_valid_utf8(const uint8_t *str, int32_t len) {
         uint8_t c = str[i];
 
         /* Check the number of bytes in code point */
-        if (c < 0x80) nexti = i + 1;
-        else if ((c >> 5) == 0x06) nexti = i + 2;
+        if (c < 0x80) {
+            i += janet_simd_ascii_span(str + i, len - i);
+            continue;
+        } else if ((c >> 5) == 0x06) nexti = i + 2;
         else if ((c >> 4) == 0x0E) nexti = i + 3;
         else if ((c >> 3) == 0x1E) nexti = i + 4;
         /* Don't allow 5 or 6 byte code points */
@@ -140,6 +143,22 @@ DEF_PARSER_STACK(_pushstate, JanetParseState, states, statecount, statecap)
 
 #undef DEF_PARSER_STACK
 
+/* Push a run of bytes onto the token buffer */
+static void push_buf_bytes(JanetParser *p, const uint8_t *bytes, size_t n) {
+    size_t newcount = p->bufcount + n;
+    if (newcount > p->bufcap) {
+        size_t newcap = 2 * newcount;
+        uint8_t *next = janet_realloc(p->buf, newcap);
+        if (NULL == next) {
+            JANET_OUT_OF_MEMORY;
+        }
+        p->buf = next;
+        p->bufcap = newcap;
+    }
+    memcpy(p->buf + p->bufcount, bytes, n);
+    p->bufcount = newcount;
+}
+
 #define PFLAG_CONTAINER 0x100
 #define PFLAG_BUFFER 0x200
 #define PFLAG_PARENS 0x400
@@ -508,15 +527,15 @@ static int comment(JanetParser *p, JanetParseState *state, uint8_t c) {
 static Janet close_tuple(JanetParser *p, JanetParseState *state, int32_t flag) {
     Janet *ret = janet_tuple_begin(state->argn);
     janet_tuple_flag(ret) |= flag;
-    for (int32_t i = state->argn - 1; i >= 0; i--)
-        ret[i] = p->args[--p->argcount];
+    p->argcount -= state->argn;
+    safe_memcpy(ret, p->args + p->argcount, sizeof(Janet) * state->argn);
     return janet_wrap_tuple(janet_tuple_end(ret));
 }
 
 static Janet close_array(JanetParser *p, JanetParseState *state) {
     JanetArray *array = janet_array(state->argn);
-    for (int32_t i = state->argn - 1; i >= 0; i--)
-        array->data[i] = p->args[--p->argcount];
+    p->argcount -= state->argn;
+    safe_memcpy(array->data, p->args + p->argcount, sizeof(Janet) * state->argn);
     array->count = state->argn;
     return janet_wrap_array(array);
 }
@@ -717,6 +736,92 @@ void janet_parser_consume(JanetParser *parser, uint8_t c) {
     parser->lookback = c;
 }
 
+/* Byte sets for the runs that janet_parser_consume_bytes can take in one step.
+ * None of them contain a newline, so a run only moves the column. */
+static const uint32_t string_stops[8] = {
+    0x00002400, 0x00000004, 0x10000000, 0, 0, 0, 0, 0 /* \n \r " \\ */
+};
+static const uint32_t comment_stops[8] = {
+    0x00002400, 0, 0, 0, 0, 0, 0, 0 /* \n \r */
+};
+static const uint32_t longstring_stops[8] = {
+    0x00002400, 0, 0, 0x00000001, 0, 0, 0, 0 /* \n \r ` */
+};
+static const uint32_t blanks[8] = {
+    0x00000200, 0x00000001, 0, 0, 0, 0, 0, 0 /* \t space */
+};
+
+/* Length of the prefix of bytes that are all in (or all not in) set. Most runs
+ * are short, so scan the first few bytes here and leave longer runs to the
+ * vector kernels. */
+#define PARSER_SHORT_RUN 16
+static int32_t parser_span(const uint8_t *bytes, int32_t len, const uint32_t *set, uint32_t in_set) {
+    int32_t max = len < PARSER_SHORT_RUN ? len : PARSER_SHORT_RUN;
+    int32_t i = 0;
+    while (i < max && ((set[bytes[i] >> 5] >> (bytes[i] & 0x1F)) & 1) == in_set) i++;
+    if (i == PARSER_SHORT_RUN)
+        i += janet_simd_span(bytes + i, len - i, set, (int) in_set);
+    return i;
+}
+#undef PARSER_SHORT_RUN
+
+/* Take the longest prefix of bytes that the current state would consume one byte
+ * at a time without changing state. Returns the number of bytes taken, which
+ * is 0 when the next byte needs the state machine. */
+static int32_t parser_run(JanetParser *parser, const uint8_t *bytes, int32_t len) {
+    JanetParseState *state = parser->states + parser->statecount - 1;
+    Consumer consumer = state->consumer;
+    int32_t n;
+    if (consumer == tokenchar) {
+        n = parser_span(bytes, len, symchars, 1);
+        if (!state->argn) {
+            for (int32_t i = 0; i < n; i++) {
+                if (bytes[i] > 127) {
+                    state->argn = 1; /* Use to indicate non ascii */
+                    break;
+                }
+            }
+        }
+    } else if (consumer == stringchar) {
+        n = parser_span(bytes, len, string_stops, 0);
+    } else if (consumer == comment) {
+        n = parser_span(bytes, len, comment_stops, 0);
+    } else if (consumer == longstring && (state->flags & PFLAG_INSTRING)) {
+        n = parser_span(bytes, len, longstring_stops, 0);
+    } else if (consumer == root) {
+        n = parser_span(bytes, len, blanks, 1);
+        if (n) {
+            parser->column += n;
+            parser->lookback = bytes[n - 1];
+        }
+        return n;
+    } else {
+        return 0;
+    }
+    if (n) {
+        push_buf_bytes(parser, bytes, n);
+        parser->column += n;
+        parser->lookback = bytes[n - 1];
+    }
+    return n;
+}
+
+size_t janet_parser_consume_bytes(JanetParser *parser, const uint8_t *bytes, size_t len) {
+    janet_parser_checkdead(parser);
+    size_t i = 0;
+    while (i < len) {
+        size_t left = len - i;
+        int32_t n = parser_run(parser, bytes + i, left > INT32_MAX ? INT32_MAX : (int32_t) left);
+        if (n) {
+            i += n;
+            continue;
+        }
+        janet_parser_consume(parser, bytes[i++]);
+        if (parser->error) break;
+    }
+    return i;
+}
+
 void janet_parser_eof(JanetParser *parser) {
     janet_parser_checkdead(parser);
     size_t oldcolumn = parser->column;
@@ -739,6 +844,7 @@ enum JanetParserStatus janet_parser_status(JanetParser *parser) {
 
 void janet_parser_flush(JanetParser *parser) {
     parser->argcount = 0;
+    parser->argstart = 0;
     parser->statecount = 1;
     parser->bufcount = 0;
     parser->pending = 0;
@@ -756,32 +862,32 @@ const char *janet_parser_error(JanetParser *parser) {
     return NULL;
 }
 
-Janet janet_parser_produce(JanetParser *parser) {
-    Janet ret;
-    size_t i;
-    if (parser->pending == 0) return janet_wrap_nil();
-    ret = janet_unwrap_tuple(parser->args[0])[0];
-    for (i = 1; i < parser->argcount; i++) {
-        parser->args[i - 1] = parser->args[i];
-    }
+/* Remove the oldest pending value. Values are taken from the front of args, so
+ * rather than shifting the rest down for every value, advance argstart and only
+ * move the remaining values once at least half of args has been produced. */
+static Janet parser_take_pending(JanetParser *parser) {
+    Janet ret = parser->args[parser->argstart++];
     parser->pending--;
-    parser->argcount--;
     parser->states[0].argn--;
+    if (parser->argstart == parser->argcount) {
+        parser->argstart = 0;
+        parser->argcount = 0;
+    } else if (2 * parser->argstart >= parser->argcount) {
+        parser->argcount -= parser->argstart;
+        memmove(parser->args, parser->args + parser->argstart, parser->argcount * sizeof(Janet));
+        parser->argstart = 0;
+    }
     return ret;
 }
 
+Janet janet_parser_produce(JanetParser *parser) {
+    if (parser->pending == 0) return janet_wrap_nil();
+    return janet_unwrap_tuple(parser_take_pending(parser))[0];
+}
+
 Janet janet_parser_produce_wrapped(JanetParser *parser) {
-    Janet ret;
-    size_t i;
     if (parser->pending == 0) return janet_wrap_nil();
-    ret = parser->args[0];
-    for (i = 1; i < parser->argcount; i++) {
-        parser->args[i - 1] = parser->args[i];
-    }
-    parser->pending--;
-    parser->argcount--;
-    parser->states[0].argn--;
-    return ret;
+    return parser_take_pending(parser);
 }
 
 void janet_parser_init(JanetParser *parser) {
@@ -790,6 +896,7 @@ void janet_parser_init(JanetParser *parser) {
     parser->buf = NULL;
     parser->argcount = 0;
     parser->argcap = 0;
+    parser->argstart = 0;
     parser->bufcount = 0;
     parser->bufcap = 0;
     parser->statecount = 0;
@@ -819,8 +926,9 @@ void janet_parser_clone(const JanetParser *src, JanetParser *dest) {
     dest->column = src->column;
     dest->error = src->error;
 
-    /* Keep counts */
-    dest->argcount = src->argcount;
+    /* Keep counts, dropping values that were already produced */
+    dest->argcount = src->argcount - src->argstart;
+    dest->argstart = 0;
     dest->bufcount = src->bufcount;
     dest->statecount = src->statecount;
 
@@ -841,7 +949,7 @@ void janet_parser_clone(const JanetParser *src, JanetParser *dest) {
     if (dest->argcap) {
         dest->args = janet_malloc(sizeof(Janet) * dest->argcap);
         if (!dest->args) goto nomem;
-        memcpy(dest->args, src->args, dest->argcap * sizeof(Janet));
+        memcpy(dest->args, src->args + src->argstart, dest->argcap * sizeof(Janet));
     }
     if (dest->statecap) {
         dest->states = janet_malloc(sizeof(JanetParseState) * dest->statecap);
@@ -865,7 +973,7 @@ static int parsermark(void *p, size_t size) {
     size_t i;
     JanetParser *parser = (JanetParser *)p;
     (void) size;
-    for (i = 0; i < parser->argcount; i++) {
+    for (i = parser->argstart; i < parser->argcount; i++) {
         janet_mark(parser->args[i]);
     }
     if (parser->flag & JANET_PARSER_GENERATED_ERROR) {
@@ -926,18 +1034,8 @@ JANET_CORE_FN(cfun_parse_consume,
         view.len -= offset;
         view.bytes += offset;
     }
-    int32_t i;
-    for (i = 0; i < view.len; i++) {
-        janet_parser_consume(p, view.bytes[i]);
-        switch (janet_parser_status(p)) {
-            case JANET_PARSE_ROOT:
-            case JANET_PARSE_PENDING:
-                break;
-            default:
-                return janet_wrap_integer(i + 1);
-        }
-    }
-    return janet_wrap_integer(i);
+    size_t n = janet_parser_consume_bytes(p, view.bytes, (size_t) view.len);
+    return janet_wrap_integer((int32_t) n);
 }
 
 JANET_CORE_FN(cfun_parse_eof,
@@ -26,11 +26,14 @@
 #include <string.h>
 #include "util.h"
 #include "vector.h"
-#include "util.h"
+#include "simd.h"
 #endif
 
 #ifdef JANET_PEG
 
+/* Set on RULE_CHOICE opcodes that are followed by first-byte sets */
+#define PEG_CHOICE_DISPATCH 0x100
+
 /*
  * Runtime
  */
@@ -51,6 +54,8 @@ typedef struct {
     int32_t depth;
     int32_t linemaplen;
     int32_t has_backref;
+    int32_t hit_end; /* Set when a rule needed bytes past text_end */
+    int32_t partial; /* Set when more text may follow text_end */
     enum {
         PEG_MODE_NORMAL,
         PEG_MODE_ACCUMULATE
@@ -117,7 +122,7 @@ static LineCol get_linecol_from_position(PegState *s, int32_t position) {
         for (const uint8_t *c = s->text_start; c < s->text_end; c++) {
             if (*c == '\n') newline_count++;
         }
-        int32_t *mem = janet_smalloc(sizeof(int32_t) * newline_count);
+        int32_t *mem = janet_sarena_alloc(sizeof(int32_t) * newline_count);
         size_t index = 0;
         for (const uint8_t *c = s->text_start; c < s->text_end; c++) {
             if (*c == '\n') mem[index++] = (int32_t)(c - s->text_start);
@@ -167,6 +172,22 @@ static int64_t peg_convert_u64_s64(uint64_t from, int width) {
 } while (0)
 #define up1(s) ((s)->depth++)
 
+/* Scan text for a RULE_SET or RULE_RANGE rule. If skip is set, returns the first
+ * byte not in the set, otherwise the first byte in the set, or end if there is none. */
+static const uint8_t *peg_scan_set(const uint32_t *rule, const uint8_t *text, const uint8_t *end, int skip) {
+    if ((rule[0] & 0x1F) == RULE_RANGE) {
+        uint8_t lo = rule[1] & 0xFF;
+        uint8_t hi = (rule[1] >> 16) & 0xFF;
+        if (!skip && lo == hi) {
+            const uint8_t *found = memchr(text, lo, end - text);
+            return NULL == found ? end : found;
+        }
+        while (text < end && ((text[0] >= lo && text[0] <= hi) == skip)) text++;
+        return text;
+    }
+    return text + janet_simd_span(text, (int32_t)(end - text), rule + 1, skip);
+}
+
 /* Evaluate a peg rule
  * Pre-conditions: s is in a valid state
  * Post-conditions: If there is a match, returns a pointer to the next text.
@@ -186,32 +207,49 @@ tail:
 
         case RULE_LITERAL: {
             uint32_t len = rule[1];
-            if (text + len > s->text_end) return NULL;
+            if (text + len > s->text_end) {
+                /* Only a prefix of the literal could match more text */
+                if (!memcmp(text, rule + 2, s->text_end - text)) s->hit_end = 1;
+                return NULL;
+            }
             return memcmp(text, rule + 2, len) ? NULL : text + len;
         }
 
         case RULE_NCHAR: {
             uint32_t n = rule[1];
-            return (text + n > s->text_end) ? NULL : text + n;
+            if (text + n > s->text_end) {
+                s->hit_end = 1;
+                return NULL;
+            }
+            return text + n;
         }
 
         case RULE_NOTNCHAR: {
             uint32_t n = rule[1];
-            return (text + n > s->text_end) ? text : NULL;
+            if (text + n > s->text_end) {
+                s->hit_end = 1;
+                return text;
+            }
+            return NULL;
         }
 
         case RULE_RANGE: {
             uint8_t lo = rule[1] & 0xFF;
             uint8_t hi = (rule[1] >> 16) & 0xFF;
-            return (text < s->text_end &&
-                    text[0] >= lo &&
-                    text[0] <= hi)
+            if (text >= s->text_end) {
+                s->hit_end = 1;
+                return NULL;
+            }
+            return (text[0] >= lo && text[0] <= hi)
                    ? text + 1
                    : NULL;
         }
 
         case RULE_SET: {
-            if (text >= s->text_end) return NULL;
+            if (text >= s->text_end) {
+                s->hit_end = 1;
+                return NULL;
+            }
             uint32_t word = rule[1 + (text[0] >> 5)];
             uint32_t mask = (uint32_t)1 << (text[0] & 0x1F);
             return (word & mask)
@@ -221,6 +259,7 @@ tail:
 
         case RULE_LOOK: {
             text += ((int32_t *)rule)[1];
+            if (text > s->text_end) s->hit_end = 1;
             if (text < s->text_start || text > s->text_end) return NULL;
             down1(s);
             const uint8_t *result = peg_rule(s, s->bytecode + rule[2], text);
@@ -233,9 +272,18 @@ tail:
             uint32_t len = rule[1];
             const uint32_t *args = rule + 2;
             if (len == 0) return NULL;
+            /* Skip rules that cannot start with the next byte */
+            const uint32_t *sets = NULL;
+            uint32_t word = 0, mask = 0;
+            if ((rule[0] & PEG_CHOICE_DISPATCH) && text < s->text_end) {
+                sets = args + len;
+                word = text[0] >> 5;
+                mask = (uint32_t)1 << (text[0] & 0x1F);
+            }
             down1(s);
             CapState cs = cap_save(s);
             for (uint32_t i = 0; i < len - 1; i++) {
+                if (sets && !(sets[8 * i + word] & mask)) continue;
                 const uint8_t *result = peg_rule(s, s->bytecode + args[i], text);
                 if (result) {
                     up1(s);
@@ -244,6 +292,7 @@ tail:
                 cap_load(s, cs);
             }
             up1(s);
+            if (sets && !(sets[8 * (len - 1) + word] & mask)) return NULL;
             rule = s->bytecode + args[len - 1];
             goto tail;
         }
@@ -306,6 +355,30 @@ tail:
         case RULE_THRU:
         case RULE_TO: {
             const uint32_t *rule_a = s->bytecode + rule[1];
+            /* Scan for literals and sets without calling peg_rule for each byte */
+            if ((rule_a[0] & 0x1F) == RULE_LITERAL && rule_a[1] > 0) {
+                uint32_t len = rule_a[1];
+                const uint8_t *lit = (const uint8_t *)(rule_a + 2);
+                for (;;) {
+                    const uint8_t *found = memchr(text, lit[0], s->text_end - text);
+                    if (NULL == found || found + len > s->text_end) {
+                        s->hit_end = 1;
+                        return NULL;
+                    }
+                    if (!memcmp(found, lit, len)) {
+                        return rule[0] == RULE_TO ? found : found + len;
+                    }
+                    text = found + 1;
+                }
+            }
+            if ((rule_a[0] & 0x1F) == RULE_SET || (rule_a[0] & 0x1F) == RULE_RANGE) {
+                const uint8_t *found = peg_scan_set(rule_a, text, s->text_end, 0);
+                if (found == s->text_end) {
+                    s->hit_end = 1;
+                    return NULL;
+                }
+                return rule[0] == RULE_TO ? found : found + 1;
+            }
             const uint8_t *next_text = NULL;
             CapState cs = cap_save(s);
             down1(s);
@@ -333,6 +406,14 @@ tail:
             const uint32_t *rule_a = s->bytecode + rule[3];
             uint32_t captured = 0;
             const uint8_t *next_text;
+            if ((rule_a[0] & 0x1F) == RULE_SET || (rule_a[0] & 0x1F) == RULE_RANGE) {
+                const uint8_t *limit = ((size_t)(s->text_end - text) > hi) ? text + hi : s->text_end;
+                next_text = peg_scan_set(rule_a, text, limit, 1);
+                /* The repetition stopped at the end of the text rather than at a byte */
+                if (next_text == s->text_end && (uint32_t)(next_text - text) < hi) s->hit_end = 1;
+                if ((uint32_t)(next_text - text) < lo) return NULL;
+                return next_text;
+            }
             CapState cs = cap_save(s);
             down1(s);
             while (captured < hi) {
@@ -537,6 +618,8 @@ tail:
             up1(s);
             s->mode = oldmode;
             if (!result) return NULL;
+            /* In a stream, the error may go away once more text arrives */
+            if (s->partial && s->hit_end) return NULL;
             if (s->captures->count > old_cap) {
                 /* Throw last capture */
                 janet_panicv(s->captures->data[s->captures->count - 1]);
@@ -558,8 +641,10 @@ tail:
                         return NULL;
                     const uint8_t *bytes = janet_unwrap_string(capture);
                     int32_t len = janet_string_length(bytes);
-                    if (text + len > s->text_end)
+                    if (text + len > s->text_end) {
+                        if (!memcmp(text, bytes, s->text_end - text)) s->hit_end = 1;
                         return NULL;
+                    }
                     return memcmp(text, bytes, len) ? NULL : text + len;
                 }
             }
@@ -603,7 +688,10 @@ tail:
             uint32_t signedness = rule[1] & 0x10;
             uint32_t endianess = rule[1] & 0x20;
             int width = (int)(rule[1] & 0xF);
-            if (text + width > s->text_end) return NULL;
+            if (text + width > s->text_end) {
+                s->hit_end = 1;
+                return NULL;
+            }
             uint64_t accum = 0;
             if (endianess) {
                 /* BE */
@@ -680,6 +768,7 @@ typedef struct {
     int depth;
     uint32_t nexttag;
     int has_backref;
+    uint32_t *choices; /* Choice rules that need first-byte sets */
 } Builder;
 
 /* Forward declaration to allow recursion */
@@ -692,6 +781,7 @@ static uint32_t peg_compile1(Builder *b, Janet peg);
 static void builder_cleanup(Builder *b) {
     janet_v_free(b->constants);
     janet_v_free(b->bytecode);
+    janet_v_free(b->choices);
 }
 
 JANET_NO_RETURN static void peg_panic(Builder *b, const char *msg) {
@@ -886,8 +976,24 @@ static void spec_variadic(Builder *b, int32_t argc, const Janet *argv, uint32_t
     }
 }
 
+/* Choices of two or more rules are followed by the first-byte set of each
+ * rule, [len, rules..., sets (8 words each)...], filled in once the whole
+ * peg is compiled. */
 static void spec_choice(Builder *b, int32_t argc, const Janet *argv) {
-    spec_variadic(b, argc, argv, RULE_CHOICE);
+    if (argc < 2) {
+        spec_variadic(b, argc, argv, RULE_CHOICE);
+        return;
+    }
+    uint32_t rule = janet_v_count(b->bytecode);
+    janet_v_push(b->bytecode, RULE_CHOICE | PEG_CHOICE_DISPATCH);
+    janet_v_push(b->bytecode, argc);
+    for (int32_t i = 0; i < 9 * argc; i++)
+        janet_v_push(b->bytecode, 0);
+    janet_v_push(b->choices, rule);
+    for (int32_t i = 0; i < argc; i++) {
+        uint32_t rulei = peg_compile1(b, argv[i]);
+        b->bytecode[rule + 2 + i] = rulei;
+    }
 }
 static void spec_sequence(Builder *b, int32_t argc, const Janet *argv) {
     spec_variadic(b, argc, argv, RULE_SEQUENCE);
@@ -1469,6 +1575,10 @@ static void *peg_unmarshal(JanetMarshalContext *ctx) {
                     op_flags[rule[2 + j]] |= 0x1;
                 }
                 i += 2 + len;
+                if (instr & PEG_CHOICE_DISPATCH) {
+                    if ((instr & 0x1F) != RULE_CHOICE) goto bad;
+                    i += 8 * len;
+                }
             }
             break;
             case RULE_IF:
@@ -1601,6 +1711,79 @@ static JanetPeg *make_peg(Builder *b) {
     return peg;
 }
 
+/*
+ * First-byte sets
+ */
+
+/* Add the bytes that a match of a rule can start with to set. Returns 1 if the
+ * rule might match without consuming a byte, or if the rule is too complex to
+ * tell, in which case set is meaningless. */
+static int peg_first(const uint32_t *bytecode, uint32_t at, uint32_t *set, int depth) {
+    const uint32_t *rule = bytecode + at;
+    if (depth <= 0) return 1;
+    switch (rule[0] & 0x1F) {
+        default:
+            return 1;
+        case RULE_LITERAL:
+            if (rule[1] == 0) return 1;
+            bitmap_set(set, ((const uint8_t *)(rule + 2))[0]);
+            return 0;
+        case RULE_NCHAR:
+        case RULE_READINT:
+            if ((rule[0] & 0x1F) == RULE_NCHAR && rule[1] == 0) return 1;
+            for (int i = 0; i < 8; i++) set[i] = UINT32_MAX;
+            return 0;
+        case RULE_RANGE:
+            for (uint32_t c = rule[1] & 0xFF; c <= ((rule[1] >> 16) & 0xFF); c++)
+                bitmap_set(set, (uint8_t) c);
+            return 0;
+        case RULE_SET:
+            for (int i = 0; i < 8; i++) set[i] |= rule[1 + i];
+            return 0;
+        case RULE_CHOICE:
+            for (uint32_t i = 0; i < rule[1]; i++)
+                if (peg_first(bytecode, rule[2 + i], set, depth - 1)) return 1;
+            return rule[1] == 0;
+        case RULE_SEQUENCE:
+            for (uint32_t i = 0; i < rule[1]; i++)
+                if (!peg_first(bytecode, rule[2 + i], set, depth - 1)) return 0;
+            return 1;
+        case RULE_IF:
+        case RULE_IFNOT:
+            return peg_first(bytecode, rule[2], set, depth - 1);
+        case RULE_BETWEEN:
+            if (rule[1] == 0) return 1;
+            return peg_first(bytecode, rule[3], set, depth - 1);
+        case RULE_CAPTURE:
+        case RULE_CAPTURE_NUM:
+        case RULE_ACCUMULATE:
+        case RULE_GROUP:
+        case RULE_REPLACE:
+        case RULE_MATCHTIME:
+        case RULE_ERROR:
+        case RULE_DROP:
+        case RULE_UNREF:
+        case RULE_LENPREFIX:
+            return peg_first(bytecode, rule[1], set, depth - 1);
+    }
+}
+
+/* Fill in the first-byte sets of choices. Rules whose first bytes are not
+ * known get a full set, so they are always tried. */
+static void peg_fill_choices(Builder *b) {
+    for (int32_t i = 0; i < janet_v_count(b->choices); i++) {
+        uint32_t *rule = b->bytecode + b->choices[i];
+        uint32_t len = rule[1];
+        for (uint32_t j = 0; j < len; j++) {
+            uint32_t *set = rule + 2 + len + 8 * j;
+            memset(set, 0, 8 * sizeof(uint32_t));
+            if (peg_first(b->bytecode, rule[2 + j], set, 32)) {
+                for (int k = 0; k < 8; k++) set[k] = UINT32_MAX;
+            }
+        }
+    }
+}
+
 /* Compiler entry point */
 static JanetPeg *compile_peg(Janet x) {
     Builder builder;
@@ -1619,7 +1802,9 @@ static JanetPeg *compile_peg(Janet x) {
     builder.form = x;
     builder.depth = JANET_RECURSION_GUARD;
     builder.has_backref = 0;
+    builder.choices = NULL;
     peg_compile1(&builder, x);
+    peg_fill_choices(&builder);
     JanetPeg *peg = make_peg(&builder);
     builder_cleanup(&builder);
     return peg;
@@ -1646,8 +1831,29 @@ typedef struct {
     JanetByteView bytes;
     Janet subst;
     int32_t start;
+    JanetSArenaMark mark; /* Scratch arena position before the call */
 } PegCall;
 
+/* Initialize the match state of a call, given its peg, bytes, and extra arguments */
+static void peg_call_init(PegCall *c) {
+    c->s.mode = PEG_MODE_NORMAL;
+    c->s.text_start = c->bytes.bytes;
+    c->s.text_end = c->bytes.bytes + c->bytes.len;
+    c->s.depth = JANET_RECURSION_GUARD;
+    c->s.captures = janet_array(0);
+    c->s.tagged_captures = janet_array(0);
+    c->s.scratch = janet_buffer(10);
+    c->s.tags = janet_buffer(10);
+    c->s.constants = c->peg->constants;
+    c->s.bytecode = c->peg->bytecode;
+    c->s.linemap = NULL;
+    c->s.linemaplen = -1;
+    c->s.has_backref = c->peg->has_backref;
+    c->s.hit_end = 0;
+    c->s.partial = 0;
+    c->mark = janet_sarena_mark();
+}
+
 /* Initialize state for peg cfunctions */
 static PegCall peg_cfun_init(int32_t argc, Janet *argv, int get_replace) {
     PegCall ret;
@@ -1674,19 +1880,7 @@ static PegCall peg_cfun_init(int32_t argc, Janet *argv, int get_replace) {
         ret.s.extrac = 0;
         ret.s.extrav = NULL;
     }
-    ret.s.mode = PEG_MODE_NORMAL;
-    ret.s.text_start = ret.bytes.bytes;
-    ret.s.text_end = ret.bytes.bytes + ret.bytes.len;
-    ret.s.depth = JANET_RECURSION_GUARD;
-    ret.s.captures = janet_array(0);
-    ret.s.tagged_captures = janet_array(0);
-    ret.s.scratch = janet_buffer(10);
-    ret.s.tags = janet_buffer(10);
-    ret.s.constants = ret.peg->constants;
-    ret.s.bytecode = ret.peg->bytecode;
-    ret.s.linemap = NULL;
-    ret.s.linemaplen = -1;
-    ret.s.has_backref = ret.peg->has_backref;
+    peg_call_init(&ret);
     return ret;
 }
 
@@ -1698,13 +1892,19 @@ static void peg_call_reset(PegCall *c) {
     c->s.tags->count = 0;
 }
 
+/* Release scratch memory used by the call */
+static Janet peg_call_finish(PegCall *c, Janet result) {
+    janet_sarena_reset(c->mark);
+    return result;
+}
+
 JANET_CORE_FN(cfun_peg_match,
               "(peg/match peg text &opt start & args)",
               "Match a Parsing Expression Grammar to a byte string and return an array of captured values. "
               "Returns nil if text does not match the language defined by peg. The syntax of PEGs is documented on the Janet website.") {
     PegCall c = peg_cfun_init(argc, argv, 0);
     const uint8_t *result = peg_rule(&c.s, c.s.bytecode, c.bytes.bytes + c.start);
-    return result ? janet_wrap_array(c.s.captures) : janet_wrap_nil();
+    return peg_call_finish(&c, result ? janet_wrap_array(c.s.captures) : janet_wrap_nil());
 }
 
 JANET_CORE_FN(cfun_peg_find,
@@ -1714,9 +1914,9 @@ JANET_CORE_FN(cfun_peg_find,
     for (int32_t i = c.start; i < c.bytes.len; i++) {
         peg_call_reset(&c);
         if (peg_rule(&c.s, c.s.bytecode, c.bytes.bytes + i))
-            return janet_wrap_integer(i);
+            return peg_call_finish(&c, janet_wrap_integer(i));
     }
-    return janet_wrap_nil();
+    return peg_call_finish(&c, janet_wrap_nil());
 }
 
 JANET_CORE_FN(cfun_peg_find_all,
@@ -1729,7 +1929,107 @@ JANET_CORE_FN(cfun_peg_find_all,
         if (peg_rule(&c.s, c.s.bytecode, c.bytes.bytes + i))
             janet_array_push(ret, janet_wrap_integer(i));
     }
-    return janet_wrap_array(ret);
+    return peg_call_finish(&c, janet_wrap_array(ret));
+}
+
+/* Parallel find-all. Each worker runs the peg at every start position in its
+ * range, on its own VM, and records the positions that match. */
+typedef struct {
+    JanetPeg *peg;
+    JanetByteView bytes;
+    const Janet *extrav;
+    int32_t extrac;
+    int32_t start;
+    int32_t chunk;
+    int32_t **results; /* janet_v of match positions, one per worker */
+    int *failed;
+} PegParallel;
+
+static void peg_parallel_worker(void *data, int32_t w) {
+    PegParallel *pp = (PegParallel *) data;
+    int32_t lo = pp->start + w * pp->chunk;
+    int32_t hi = (pp->bytes.len - lo > pp->chunk) ? lo + pp->chunk : pp->bytes.len;
+    /* Constants and text belong to the calling thread's heap, so this
+     * thread must never mark them */
+    int handle = janet_gclock();
+    JanetTryState tstate;
+    if (!janet_try(&tstate)) {
+        PegCall c;
+        c.peg = pp->peg;
+        c.bytes = pp->bytes;
+        c.s.extrac = pp->extrac;
+        c.s.extrav = pp->extrav;
+        peg_call_init(&c);
+        for (int32_t i = lo; i < hi; i++) {
+            peg_call_reset(&c);
+            if (peg_rule(&c.s, c.s.bytecode, c.bytes.bytes + i))
+                janet_v_push(pp->results[w], i);
+        }
+        peg_call_finish(&c, janet_wrap_nil());
+    } else {
+        pp->failed[w] = 1;
+    }
+    janet_restore(&tstate);
+    janet_gcunlock(handle);
+}
+
+/* Pegs that can call back into Janet must run on the calling thread */
+static int peg_parallel_safe(JanetPeg *peg, const Janet *extrav, int32_t extrac) {
+    for (uint32_t i = 0; i < peg->num_constants; i++) {
+        JanetType t = janet_type(peg->constants[i]);
+        if (t == JANET_FUNCTION || t == JANET_CFUNCTION || t == JANET_ABSTRACT) return 0;
+    }
+    for (int32_t i = 0; i < extrac; i++) {
+        JanetType t = janet_type(extrav[i]);
+        if (t == JANET_FUNCTION || t == JANET_CFUNCTION || t == JANET_ABSTRACT) return 0;
+    }
+    return 1;
+}
+
+JANET_CORE_FN(cfun_peg_find_all_parallel,
+              "(peg/find-all-parallel workers peg text &opt start & args)",
+              "Like `peg/find-all`, but runs the peg with up to `workers` threads. Small inputs, and pegs "
+              "that contain functions or abstract values, are matched on the current thread. "
+              "Returns an array of integers.") {
+    janet_arity(argc, 3, -1);
+    int32_t workers = janet_getnat(argv, 0);
+    PegCall c = peg_cfun_init(argc - 1, argv + 1, 0);
+    JanetArray *ret = janet_array(0);
+    workers = janet_parallel_workers(workers, c.bytes.len - c.start);
+    if (workers > 1 && peg_parallel_safe(c.peg, c.s.extrav, c.s.extrac)) {
+        PegParallel pp;
+        pp.peg = c.peg;
+        pp.bytes = c.bytes;
+        pp.extrav = c.s.extrav;
+        pp.extrac = c.s.extrac;
+        pp.start = c.start;
+        pp.chunk = (c.bytes.len - c.start + workers - 1) / workers;
+        pp.results = janet_smalloc(workers * sizeof(int32_t *));
+        pp.failed = janet_smalloc(workers * sizeof(int));
+        for (int32_t i = 0; i < workers; i++) {
+            pp.results[i] = NULL;
+            pp.failed[i] = 0;
+        }
+        janet_parallel(workers, peg_parallel_worker, &pp, 1);
+        int failed = 0;
+        for (int32_t i = 0; i < workers; i++) failed |= pp.failed[i];
+        for (int32_t i = 0; i < workers; i++) {
+            for (int32_t j = 0; !failed && j < janet_v_count(pp.results[i]); j++) {
+                janet_array_push(ret, janet_wrap_integer(pp.results[i][j]));
+            }
+            janet_v_free(pp.results[i]);
+        }
+        janet_sfree(pp.results);
+        janet_sfree(pp.failed);
+        /* Rerun on this thread so errors are raised normally */
+        if (!failed) return peg_call_finish(&c, janet_wrap_array(ret));
+    }
+    for (int32_t i = c.start; i < c.bytes.len; i++) {
+        peg_call_reset(&c);
+        if (peg_rule(&c.s, c.s.bytecode, c.bytes.bytes + i))
+            janet_array_push(ret, janet_wrap_integer(i));
+    }
+    return peg_call_finish(&c, janet_wrap_array(ret));
 }
 
 static Janet cfun_peg_replace_generic(int32_t argc, Janet *argv, int only_one) {
@@ -1758,7 +2058,7 @@ static Janet cfun_peg_replace_generic(int32_t argc, Janet *argv, int only_one) {
     if (trail < c.bytes.len) {
         janet_buffer_push_bytes(ret, c.bytes.bytes + trail, (c.bytes.len - trail));
     }
-    return janet_wrap_buffer(ret);
+    return peg_call_finish(&c, janet_wrap_buffer(ret));
 }
 
 JANET_CORE_FN(cfun_peg_replace_all,
@@ -1801,6 +2101,171 @@ static Janet peg_next(void *p, Janet key) {
     return janet_nextmethod(peg_methods, key);
 }
 
+/*
+ * Streaming matchers. Input is fed in chunks and buffered, and the peg is
+ * matched against the start of the buffered text. A match is only reported
+ * once no rule in it needed text past the end of the buffer, so more input
+ * cannot change it. Matched text is dropped from the buffer.
+ */
+
+typedef struct {
+    JanetPeg *peg;
+    JanetBuffer *tail; /* Text not yet matched */
+    JanetTuple extra; /* Extra arguments for the peg, or NULL */
+    int busy;
+} PegMatcher;
+
+static int peg_matcher_mark(void *p, size_t size) {
+    (void) size;
+    PegMatcher *m = (PegMatcher *) p;
+    janet_mark(janet_wrap_abstract(m->peg));
+    janet_mark(janet_wrap_buffer(m->tail));
+    if (NULL != m->extra) janet_mark(janet_wrap_tuple(m->extra));
+    return 0;
+}
+
+static size_t peg_matcher_length(void *p, size_t size) {
+    (void) size;
+    return (size_t)((PegMatcher *) p)->tail->count;
+}
+
+static int peg_matcher_get(void *p, Janet key, Janet *out);
+
+const JanetAbstractType janet_peg_matcher_type = {
+    "core/peg-matcher",
+    NULL,
+    peg_matcher_mark,
+    peg_matcher_get,
+    NULL, /* put */
+    NULL, /* marshal */
+    NULL, /* unmarshal */
+    NULL, /* tostring */
+    NULL, /* compare */
+    NULL, /* hash */
+    NULL, /* next */
+    NULL, /* call */
+    peg_matcher_length,
+    JANET_ATEND_LENGTH
+};
+
+/* Match as much of the buffered text as possible. If final is set, no more
+ * text will follow, and any text left over must match. */
+static JanetArray *peg_matcher_run(PegMatcher *m, int final) {
+    if (m->busy) janet_panic("peg matcher is already running");
+    JanetArray *out = janet_array(0);
+    JanetBuffer *tail = m->tail;
+    PegCall c;
+    c.peg = m->peg;
+    c.bytes.bytes = tail->data;
+    c.bytes.len = tail->count;
+    c.s.extrac = NULL == m->extra ? 0 : janet_tuple_length(m->extra);
+    c.s.extrav = m->extra;
+    peg_call_init(&c);
+    c.s.partial = !final;
+    int32_t pos = 0;
+    const char *err = NULL;
+    /* The peg may call functions, which must not feed the matcher while its text is in use */
+    m->busy = 1;
+    JanetTryState tstate;
+    JanetSignal sig = janet_try(&tstate);
+    if (!sig) {
+        while (pos < tail->count) {
+            peg_call_reset(&c);
+            c.s.text_start = tail->data + pos;
+            c.s.linemap = NULL;
+            c.s.linemaplen = -1;
+            c.s.hit_end = 0;
+            const uint8_t *result = peg_rule(&c.s, c.s.bytecode, c.s.text_start);
+            if (c.s.hit_end && !final) break;
+            if (NULL == result) {
+                err = "peg matcher input does not match";
+                break;
+            }
+            if (result == c.s.text_start) {
+                err = "peg matched no input";
+                break;
+            }
+            janet_array_push(out, janet_wrap_array(janet_array_n(c.s.captures->data, c.s.captures->count)));
+            pos += (int32_t)(result - c.s.text_start);
+        }
+    }
+    m->busy = 0;
+    janet_restore(&tstate);
+    if (sig) janet_panicv(tstate.payload);
+    if (pos > 0) {
+        memmove(tail->data, tail->data + pos, tail->count - pos);
+        tail->count -= pos;
+    }
+    peg_call_finish(&c, janet_wrap_nil());
+    if (NULL != err) janet_panic(err);
+    return out;
+}
+
+JANET_CORE_FN(cfun_peg_matcher,
+              "(peg/matcher peg & args)",
+              "Create a streaming matcher for `peg`. Text is given to the matcher in chunks with `peg/feed`, "
+              "and each time `peg` matches at the start of the unmatched text, the matched text is dropped "
+              "and the captures are returned. A match is only returned once more input cannot change it, "
+              "so `peg` should match a single message rather than the whole stream. Positions, lines, and "
+              "columns are relative to the start of each match. Extra `args` are passed to `peg` like with `peg/match`.") {
+    janet_arity(argc, 1, -1);
+    JanetPeg *peg;
+    if (janet_checktype(argv[0], JANET_ABSTRACT) &&
+            janet_abstract_type(janet_unwrap_abstract(argv[0])) == &janet_peg_type) {
+        peg = janet_unwrap_abstract(argv[0]);
+    } else {
+        peg = compile_peg(argv[0]);
+    }
+    JanetBuffer *tail = janet_buffer(0);
+    JanetTuple extra = argc > 1 ? janet_tuple_n(argv + 1, argc - 1) : NULL;
+    PegMatcher *m = janet_abstract(&janet_peg_matcher_type, sizeof(PegMatcher));
+    m->peg = peg;
+    m->tail = tail;
+    m->extra = extra;
+    m->busy = 0;
+    return janet_wrap_abstract(m);
+}
+
+JANET_CORE_FN(cfun_peg_feed,
+              "(peg/feed matcher bytes)",
+              "Give the next chunk of text to a streaming matcher made with `peg/matcher`. Returns an array "
+              "with an array of captures for each match completed by this chunk. Passing nil, as `ev/read` "
+              "does at the end of a stream, is the same as `peg/finish`. Raises an error if the "
+              "unmatched text can never match.") {
+    janet_fixarity(argc, 2);
+    PegMatcher *m = janet_getabstract(argv, 0, &janet_peg_matcher_type);
+    if (janet_checktype(argv[1], JANET_NIL)) {
+        return janet_wrap_array(peg_matcher_run(m, 1));
+    }
+    JanetByteView bytes = janet_getbytes(argv, 1);
+    if (m->busy) janet_panic("peg matcher is already running");
+    janet_buffer_push_bytes(m->tail, bytes.bytes, bytes.len);
+    return janet_wrap_array(peg_matcher_run(m, 0));
+}
+
+JANET_CORE_FN(cfun_peg_finish,
+              "(peg/finish matcher)",
+              "Tell a streaming matcher that no more text will follow, and match the remaining text. "
+              "Returns an array of capture arrays like `peg/feed`, or raises an error if the remaining "
+              "text does not match. The matcher is then empty and can be reused.") {
+    janet_fixarity(argc, 1);
+    PegMatcher *m = janet_getabstract(argv, 0, &janet_peg_matcher_type);
+    return janet_wrap_array(peg_matcher_run(m, 1));
+}
+
+static JanetMethod peg_matcher_methods[] = {
+    {"feed", cfun_peg_feed},
+    {"finish", cfun_peg_finish},
+    {NULL, NULL}
+};
+
+static int peg_matcher_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD))
+        return 0;
+    return janet_getmethod(janet_unwrap_keyword(key), peg_matcher_methods, out);
+}
+
 /* Load the peg module */
 void janet_lib_peg(JanetTable *env) {
     JanetRegExt cfuns[] = {
@@ -1808,8 +2273,12 @@ void janet_lib_peg(JanetTable *env) {
         JANET_CORE_REG("peg/match", cfun_peg_match),
         JANET_CORE_REG("peg/find", cfun_peg_find),
         JANET_CORE_REG("peg/find-all", cfun_peg_find_all),
+        JANET_CORE_REG("peg/find-all-parallel", cfun_peg_find_all_parallel),
         JANET_CORE_REG("peg/replace", cfun_peg_replace),
         JANET_CORE_REG("peg/replace-all", cfun_peg_replace_all),
+        JANET_CORE_REG("peg/matcher", cfun_peg_matcher),
+        JANET_CORE_REG("peg/feed", cfun_peg_feed),
+        JANET_CORE_REG("peg/finish", cfun_peg_finish),
         JANET_REG_END
     };
     janet_core_cfuns_ext(env, NULL, cfuns);
@@ -38,18 +38,29 @@
 /* Temporary buffer size */
 #define BUFSIZE 64
 
+/* Print a double that holds an integer of magnitude at most 2^63 without
+ * going through snprintf. */
+static int32_t integral_double_to_string(uint8_t *buf, double x) {
+    if (x < 0) {
+        buf[0] = '-';
+        return 1 + janet_u64_digits(buf + 1, (uint64_t) - x);
+    }
+    return janet_u64_digits(buf, (uint64_t) x);
+}
+
 static void number_to_string_b(JanetBuffer *buffer, double x) {
     janet_buffer_ensure(buffer, buffer->count + BUFSIZE, 2);
-    const char *fmt = (x == floor(x) &&
-                       x <= JANET_INTMAX_DOUBLE &&
-                       x >= JANET_INTMIN_DOUBLE) ? "%.0f" : "%g";
     int count;
     if (x == 0.0) {
         /* Prevent printing of '-0' */
         count = 1;
         buffer->data[buffer->count] = '0';
+    } else if (x == floor(x) &&
+               x <= JANET_INTMAX_DOUBLE &&
+               x >= JANET_INTMIN_DOUBLE) {
+        count = integral_double_to_string(buffer->data + buffer->count, x);
     } else {
-        count = snprintf((char *) buffer->data + buffer->count, BUFSIZE, fmt, x);
+        count = snprintf((char *) buffer->data + buffer->count, BUFSIZE, "%g", x);
     }
     buffer->count += count;
 }
@@ -349,16 +360,46 @@ const uint8_t *janet_to_string(Janet x) {
     }
 }
 
+/* Formatted output that goes somewhere other than a buffer is still built in a
+ * buffer, but everything past start is written out whenever it grows past
+ * FORMAT_CHUNK bytes, so the buffer never holds much more than one chunk. */
+#define FORMAT_CHUNK 4096
+struct FormatSink {
+    JanetFormatWriter write;
+    void *data;
+    int32_t start;
+    int64_t flushed;
+};
+
+/* Total number of bytes output so far */
+static int64_t format_position(JanetBuffer *b, struct FormatSink *sink) {
+    return sink ? sink->flushed + (b->count - sink->start) : b->count;
+}
+
+static void format_flush(JanetBuffer *b, struct FormatSink *sink, int force) {
+    if (NULL == sink) return;
+    int32_t n = b->count - sink->start;
+    if (n >= FORMAT_CHUNK || (force && n > 0)) {
+        sink->write(sink->data, b->data + sink->start, n);
+        sink->flushed += n;
+        b->count = sink->start;
+    }
+}
+
 /* Hold state for pretty printer. */
 struct pretty {
     JanetBuffer *buffer;
     int depth;
     int indent;
     int flags;
+    int stop;
     int32_t bufstartlen;
     int32_t *keysort_buffer;
     int32_t keysort_capacity;
     int32_t keysort_start;
+    struct FormatSink *sink;
+    int64_t outstart;
+    int64_t limit;
     JanetTable seen;
 };
 
@@ -372,11 +413,20 @@ static int print_jdn_one(struct pretty *S, Janet x, int depth) {
         case JANET_STRING:
             janet_description_b(S->buffer, x);
             break;
-        case JANET_NUMBER:
+        case JANET_NUMBER: {
+            double d = janet_unwrap_number(x);
             janet_buffer_ensure(S->buffer, S->buffer->count + BUFSIZE, 2);
-            int count = snprintf((char *) S->buffer->data + S->buffer->count, BUFSIZE, "%.17g", janet_unwrap_number(x));
+            uint8_t *buf = S->buffer->data + S->buffer->count;
+            int count;
+            /* Integers with at most 17 digits print the same as with %.17g */
+            if (d == floor(d) && d < 1e17 && d > -1e17 && (d != 0.0 || !signbit(d))) {
+                count = integral_double_to_string(buf, d);
+            } else {
+                count = snprintf((char *) buf, BUFSIZE, "%.17g", d);
+            }
             S->buffer->count += count;
             break;
+        }
         case JANET_SYMBOL:
         case JANET_KEYWORD:
             if (contains_bad_chars(janet_unwrap_keyword(x), janet_type(x) == JANET_SYMBOL)) return 1;
@@ -482,8 +532,24 @@ static const char *janet_pretty_colors[] = {
 #define JANET_PRETTY_DICT_LIMIT 30
 #define JANET_PRETTY_ARRAY_LIMIT 160
 
+/* Called between the items of a collection. Writes out buffered output, and
+ * checks the size limit. Returns 1 once the limit is reached, after which
+ * open collections are closed but nothing else is printed. */
+static int pretty_step(struct pretty *S) {
+    if (S->stop) return 1;
+    if (S->limit > 0 && format_position(S->buffer, S->sink) - S->outstart >= S->limit) {
+        S->stop = 1;
+        print_newline(S, 0);
+        janet_buffer_push_cstring(S->buffer, "...");
+        return 1;
+    }
+    format_flush(S->buffer, S->sink, 0);
+    return 0;
+}
+
 /* Helper for pretty printing */
 static void janet_pretty_one(struct pretty *S, Janet x, int is_dict_value) {
+    if (S->stop) return;
     /* Add to seen */
     switch (janet_type(x)) {
         case JANET_NIL:
@@ -551,17 +617,22 @@ static void janet_pretty_one(struct pretty *S, Janet x, int is_dict_value) {
                     for (i = 0; i < 3; i++) {
                         if (i) print_newline(S, 0);
                         janet_pretty_one(S, arr[i], 0);
+                        if (pretty_step(S)) break;
                     }
-                    print_newline(S, 0);
-                    janet_buffer_push_cstring(S->buffer, "...");
-                    for (i = 0; i < 3; i++) {
+                    if (!S->stop) {
+                        print_newline(S, 0);
+                        janet_buffer_push_cstring(S->buffer, "...");
+                    }
+                    for (i = 0; i < 3 && !S->stop; i++) {
                         print_newline(S, 0);
                         janet_pretty_one(S, arr[len - 3 + i], 0);
+                        if (pretty_step(S)) break;
                     }
                 } else {
                     for (i = 0; i < len; i++) {
                         if (i) print_newline(S, len < JANET_PRETTY_IND_ONELINE);
                         janet_pretty_one(S, arr[i], 0);
+                        if (pretty_step(S)) break;
                     }
                 }
             }
@@ -660,9 +731,10 @@ static void janet_pretty_one(struct pretty *S, Janet x, int is_dict_value) {
                     janet_pretty_one(S, kvs[j].key, 0);
                     janet_buffer_push_u8(S->buffer, ' ');
                     janet_pretty_one(S, kvs[j].value, 1);
+                    if (pretty_step(S)) break;
                 }
 
-                if (truncated) {
+                if (truncated && !S->stop) {
                     print_newline(S, 0);
                     janet_buffer_push_cstring(S->buffer, "...");
                 }
@@ -680,7 +752,8 @@ static void janet_pretty_one(struct pretty *S, Janet x, int is_dict_value) {
     return;
 }
 
-static JanetBuffer *janet_pretty_(JanetBuffer *buffer, int depth, int flags, Janet x, int32_t startlen) {
+static JanetBuffer *janet_pretty_(JanetBuffer *buffer, int depth, int flags, Janet x, int32_t startlen,
+                                  struct FormatSink *sink, int64_t limit) {
     struct pretty S;
     if (NULL == buffer) {
         buffer = janet_buffer(0);
@@ -689,10 +762,14 @@ static JanetBuffer *janet_pretty_(JanetBuffer *buffer, int depth, int flags, Jan
     S.depth = depth;
     S.indent = 0;
     S.flags = flags;
+    S.stop = 0;
     S.bufstartlen = startlen;
     S.keysort_capacity = 0;
     S.keysort_buffer = NULL;
     S.keysort_start = 0;
+    S.sink = sink;
+    S.outstart = format_position(buffer, sink);
+    S.limit = limit;
     janet_table_init(&S.seen, 10);
     janet_pretty_one(&S, x, 0);
     janet_table_deinit(&S.seen);
@@ -702,7 +779,23 @@ static JanetBuffer *janet_pretty_(JanetBuffer *buffer, int depth, int flags, Jan
 /* Helper for printing a janet value in a pretty form. Not meant to be used
  * for serialization or anything like that. */
 JanetBuffer *janet_pretty(JanetBuffer *buffer, int depth, int flags, Janet x) {
-    return janet_pretty_(buffer, depth, flags, x, buffer ? buffer->count : 0);
+    return janet_pretty_(buffer, depth, flags, x, buffer ? buffer->count : 0, NULL, 0);
+}
+
+/* Pretty print to a writer instead of a buffer. Output is passed to write in
+ * chunks as it is produced. If limit is positive, printing stops with "..."
+ * soon after limit bytes have been written. */
+void janet_pretty_to(JanetFormatWriter write, void *data, int depth, int flags, int32_t limit, Janet x) {
+    struct FormatSink sink;
+    JanetBuffer buffer;
+    janet_buffer_init(&buffer, FORMAT_CHUNK);
+    sink.write = write;
+    sink.data = data;
+    sink.start = 0;
+    sink.flushed = 0;
+    janet_pretty_(&buffer, depth, flags, x, 0, &sink, limit);
+    format_flush(&buffer, &sink, 1);
+    janet_buffer_deinit(&buffer);
 }
 
 static JanetBuffer *janet_jdn_(JanetBuffer *buffer, int depth, Janet x, int32_t startlen) {
@@ -714,10 +807,14 @@ static JanetBuffer *janet_jdn_(JanetBuffer *buffer, int depth, Janet x, int32_t
     S.depth = depth;
     S.indent = 0;
     S.flags = 0;
+    S.stop = 0;
     S.bufstartlen = startlen;
     S.keysort_capacity = 0;
     S.keysort_buffer = NULL;
     S.keysort_start = 0;
+    S.sink = NULL;
+    S.outstart = 0;
+    S.limit = 0;
     janet_table_init(&S.seen, 10);
     int res = print_jdn_one(&S, x, depth);
     janet_table_deinit(&S.seen);
@@ -930,7 +1027,7 @@ void janet_formatbv(JanetBuffer *b, const char *format, va_list args) {
                     flags |= has_color ? JANET_PRETTY_COLOR : 0;
                     flags |= has_oneline ? JANET_PRETTY_ONELINE : 0;
                     flags |= has_notrunc ? JANET_PRETTY_NOTRUNC : 0;
-                    janet_pretty_(b, depth, flags, va_arg(args, Janet), startlen);
+                    janet_pretty_(b, depth, flags, va_arg(args, Janet), startlen, NULL, 0);
                     break;
                 }
                 case 'j': {
@@ -987,18 +1084,36 @@ JanetBuffer *janet_formatb(JanetBuffer *buffer, const char *format, ...) {
     return buffer;
 }
 
-/* Shared implementation between string/format and
- * buffer/format */
-void janet_buffer_format(
+/* Size limit for pretty printed values, from (dyn *pretty-limit*) */
+static int64_t pretty_limit(void) {
+    Janet limit = janet_dyn("pretty-limit");
+    return janet_checktype(limit, JANET_NUMBER) ? (int64_t) janet_unwrap_number(limit) : 0;
+}
+
+/* Shared implementation between string/format, buffer/format, and printf.
+ * If write is not NULL, output is written out in chunks instead of being kept
+ * in b. */
+void janet_buffer_format_to(
     JanetBuffer *b,
     const char *strfrmt,
     int32_t argstart,
     int32_t argc,
-    Janet *argv) {
+    Janet *argv,
+    JanetFormatWriter write,
+    void *data) {
     size_t sfl = strlen(strfrmt);
     const char *strfrmt_end = strfrmt + sfl;
     int32_t arg = argstart;
     int32_t startlen = b->count;
+    struct FormatSink sinkstate;
+    struct FormatSink *sink = NULL;
+    if (NULL != write) {
+        sinkstate.write = write;
+        sinkstate.data = data;
+        sinkstate.start = b->count;
+        sinkstate.flushed = 0;
+        sink = &sinkstate;
+    }
     while (strfrmt < strfrmt_end) {
         if (*strfrmt != '%')
             janet_buffer_push_u8(b, (uint8_t) * strfrmt++);
@@ -1088,7 +1203,7 @@ void janet_buffer_format(
                     flags |= has_color ? JANET_PRETTY_COLOR : 0;
                     flags |= has_oneline ? JANET_PRETTY_ONELINE : 0;
                     flags |= has_notrunc ? JANET_PRETTY_NOTRUNC : 0;
-                    janet_pretty_(b, depth, flags, argv[arg], startlen);
+                    janet_pretty_(b, depth, flags, argv[arg], startlen, sink, pretty_limit());
                     break;
                 }
                 case 'j': {
@@ -1108,8 +1223,19 @@ void janet_buffer_format(
                 janet_panic("format buffer overflow");
             if (nb > 0)
                 janet_buffer_push_bytes(b, (uint8_t *) item, nb);
+            format_flush(b, sink, 0);
         }
     }
+    format_flush(b, sink, 1);
+}
+
+void janet_buffer_format(
+    JanetBuffer *b,
+    const char *strfrmt,
+    int32_t argstart,
+    int32_t argc,
+    Janet *argv) {
+    janet_buffer_format_to(b, strfrmt, argstart, argc, argv, NULL, NULL);
 }
 
 #undef HEX
@@ -0,0 +1,460 @@
+/*
+* Copyright (c) 2023 Calvin Rose
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to
+* deal in the Software without restriction, including without limitation the
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+* sell copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#ifndef JANET_AMALG
+#include "features.h"
+#include <janet.h>
+#include "simd.h"
+#endif
+
+#include <string.h>
+
+static int byteset_has(const uint32_t *set, uint8_t c) {
+    return (set[c >> 5] >> (c & 0x1F)) & 1;
+}
+
+void janet_byteset_init(uint32_t *set, const uint8_t *bytes, int32_t len) {
+    memset(set, 0, 8 * sizeof(uint32_t));
+    for (int32_t i = 0; i < len; i++) {
+        set[bytes[i] >> 5] |= (uint32_t) 1 << (bytes[i] & 0x1F);
+    }
+}
+
+/* Split a byte set into two 16 byte tables indexed by the low nibble of a
+ * byte. Bit k of lo[n] is set if the byte (k << 4 | n) is in the set, and hi
+ * holds the same for the bytes 0x80 and up. */
+#if defined(JANET_SIMD_AVX2) || defined(JANET_SIMD_NEON)
+static void byteset_nibbles(const uint32_t *set, uint8_t *lo, uint8_t *hi) {
+    memset(lo, 0, 16);
+    memset(hi, 0, 16);
+    for (int w = 0; w < 8; w++) {
+        uint32_t bits = set[w];
+        while (bits) {
+            int c = (w << 5) | janet_ctz32(bits);
+            bits &= bits - 1;
+            if (c < 0x80) {
+                lo[c & 0xF] |= (uint8_t)(1 << (c >> 4));
+            } else {
+                hi[c & 0xF] |= (uint8_t)(1 << ((c >> 4) - 8));
+            }
+        }
+    }
+}
+#endif
+
+/*
+ * Portable kernels
+ */
+
+static int32_t find_scalar(const uint8_t *text, int32_t textlen, const uint8_t *pat, int32_t patlen) {
+    if (patlen > textlen) return -1;
+    const uint8_t *p = text;
+    const uint8_t *last = text + textlen - patlen;
+    while (p <= last) {
+        p = memchr(p, pat[0], last - p + 1);
+        if (NULL == p) return -1;
+        if (p[patlen - 1] == pat[patlen - 1] && !memcmp(p, pat, patlen)) return (int32_t)(p - text);
+        p++;
+    }
+    return -1;
+}
+
+static int32_t span_scalar(const uint8_t *str, int32_t len, const uint32_t *set, int in_set) {
+    for (int32_t i = 0; i < len; i++) {
+        if (byteset_has(set, str[i]) != in_set) return i;
+    }
+    return len;
+}
+
+static int32_t rspan_scalar(const uint8_t *str, int32_t len, const uint32_t *set, int in_set) {
+    for (int32_t i = len; i > 0; i--) {
+        if (byteset_has(set, str[i - 1]) != in_set) return i;
+    }
+    return 0;
+}
+
+/* Flip the case of bytes in [base, base + 26) */
+static void case_scalar(uint8_t *dest, const uint8_t *src, int32_t len, uint8_t base) {
+    for (int32_t i = 0; i < len; i++) {
+        uint8_t c = src[i];
+        dest[i] = ((uint8_t)(c - base) < 26) ? (c ^ 0x20) : c;
+    }
+}
+
+static int32_t ascii_scalar(const uint8_t *str, int32_t len) {
+    for (int32_t i = 0; i < len; i++) {
+        if (str[i] & 0x80) return i;
+    }
+    return len;
+}
+
+/*
+ * SSE2 kernels
+ */
+
+#ifdef JANET_SIMD_SSE2
+
+/* Compare the first and last byte of the pattern at 16 positions at once, and
+ * only check the rest of the pattern where both match. Needs patlen >= 2. */
+static int32_t find_sse2(const uint8_t *text, int32_t textlen, const uint8_t *pat, int32_t patlen) {
+    const __m128i first = _mm_set1_epi8((char) pat[0]);
+    const __m128i last = _mm_set1_epi8((char) pat[patlen - 1]);
+    int32_t i = 0;
+    for (; i + patlen - 1 + 16 <= textlen; i += 16) {
+        __m128i bf = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i bl = _mm_loadu_si128((const __m128i *)(text + i + patlen - 1));
+        uint32_t mask = (uint32_t) _mm_movemask_epi8(
+                            _mm_and_si128(_mm_cmpeq_epi8(bf, first), _mm_cmpeq_epi8(bl, last)));
+        while (mask) {
+            int32_t k = i + janet_ctz32(mask);
+            if (!memcmp(text + k + 1, pat + 1, patlen - 2)) return k;
+            mask &= mask - 1;
+        }
+    }
+    int32_t result = find_scalar(text + i, textlen - i, pat, patlen);
+    return result < 0 ? -1 : i + result;
+}
+
+static void case_sse2(uint8_t *dest, const uint8_t *src, int32_t len, uint8_t base) {
+    /* Shift [base, base + 26) to the bottom of the signed byte range */
+    const __m128i shift = _mm_set1_epi8((char)(0x80 - base));
+    const __m128i limit = _mm_set1_epi8((char)(-128 + 26));
+    const __m128i flip = _mm_set1_epi8(0x20);
+    int32_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i in = _mm_cmplt_epi8(_mm_add_epi8(v, shift), limit);
+        _mm_storeu_si128((__m128i *)(dest + i), _mm_xor_si128(v, _mm_and_si128(in, flip)));
+    }
+    case_scalar(dest + i, src + i, len - i, base);
+}
+
+static int32_t ascii_sse2(const uint8_t *str, int32_t len) {
+    int32_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint32_t mask = (uint32_t) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(str + i)));
+        if (mask) return i + janet_ctz32(mask);
+    }
+    return i + ascii_scalar(str + i, len - i);
+}
+
+#endif
+
+/*
+ * AVX2 kernels
+ */
+
+#ifdef JANET_SIMD_AVX2
+
+#define JANET_AVX2 __attribute__((target("avx2")))
+
+JANET_AVX2
+static int32_t find_avx2(const uint8_t *text, int32_t textlen, const uint8_t *pat, int32_t patlen) {
+    const __m256i first = _mm256_set1_epi8((char) pat[0]);
+    const __m256i last = _mm256_set1_epi8((char) pat[patlen - 1]);
+    int32_t i = 0;
+    for (; i + patlen - 1 + 32 <= textlen; i += 32) {
+        __m256i bf = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i bl = _mm256_loadu_si256((const __m256i *)(text + i + patlen - 1));
+        uint32_t mask = (uint32_t) _mm256_movemask_epi8(
+                            _mm256_and_si256(_mm256_cmpeq_epi8(bf, first), _mm256_cmpeq_epi8(bl, last)));
+        while (mask) {
+            int32_t k = i + janet_ctz32(mask);
+            if (!memcmp(text + k + 1, pat + 1, patlen - 2)) return k;
+            mask &= mask - 1;
+        }
+    }
+    int32_t result = find_sse2(text + i, textlen - i, pat, patlen);
+    return result < 0 ? -1 : i + result;
+}
+
+/* Byte set tables, and a mask of which of the 32 bytes at str are not in the set */
+typedef struct {
+    __m256i lo;
+    __m256i hi;
+} SetAVX2;
+
+JANET_AVX2
+static SetAVX2 set_avx2(const uint32_t *set) {
+    uint8_t lo[16], hi[16];
+    byteset_nibbles(set, lo, hi);
+    SetAVX2 t;
+    t.lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) lo));
+    t.hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) hi));
+    return t;
+}
+
+JANET_AVX2
+static uint32_t notin_avx2(SetAVX2 t, const uint8_t *str) {
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i bits_lo = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+                            1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i bits_hi = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128,
+                            0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m256i v = _mm256_loadu_si256((const __m256i *) str);
+    __m256i lo = _mm256_and_si256(v, nibble);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+    __m256i hit = _mm256_or_si256(
+                      _mm256_and_si256(_mm256_shuffle_epi8(t.lo, lo), _mm256_shuffle_epi8(bits_lo, hi)),
+                      _mm256_and_si256(_mm256_shuffle_epi8(t.hi, lo), _mm256_shuffle_epi8(bits_hi, hi)));
+    return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hit, _mm256_setzero_si256()));
+}
+
+JANET_AVX2
+static int32_t span_avx2(const uint8_t *str, int32_t len, const uint32_t *set, int in_set) {
+    SetAVX2 t = set_avx2(set);
+    uint32_t flip = in_set ? 0 : 0xFFFFFFFFu;
+    int32_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        uint32_t stop = notin_avx2(t, str + i) ^ flip;
+        if (stop) return i + janet_ctz32(stop);
+    }
+    return i + span_scalar(str + i, len - i, set, in_set);
+}
+
+JANET_AVX2
+static int32_t rspan_avx2(const uint8_t *str, int32_t len, const uint32_t *set, int in_set) {
+    SetAVX2 t = set_avx2(set);
+    uint32_t flip = in_set ? 0 : 0xFFFFFFFFu;
+    int32_t i = len;
+    for (; i >= 32; i -= 32) {
+        uint32_t stop = notin_avx2(t, str + i - 32) ^ flip;
+        if (stop) return i - __builtin_clz(stop);
+    }
+    return rspan_scalar(str, i, set, in_set);
+}
+
+JANET_AVX2
+static void case_avx2(uint8_t *dest, const uint8_t *src, int32_t len, uint8_t base) {
+    const __m256i shift = _mm256_set1_epi8((char)(0x80 - base));
+    const __m256i limit = _mm256_set1_epi8((char)(-128 + 26));
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    int32_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i in = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, shift));
+        _mm256_storeu_si256((__m256i *)(dest + i), _mm256_xor_si256(v, _mm256_and_si256(in, flip)));
+    }
+    case_sse2(dest + i, src + i, len - i, base);
+}
+
+JANET_AVX2
+static int32_t ascii_avx2(const uint8_t *str, int32_t len) {
+    int32_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(str + i)));
+        if (mask) return i + janet_ctz32(mask);
+    }
+    return i + ascii_sse2(str + i, len - i);
+}
+
+#define HAS_AVX2() __builtin_cpu_supports("avx2")
+
+#endif
+
+/*
+ * NEON kernels
+ */
+
+#ifdef JANET_SIMD_NEON
+
+/* Narrow a byte comparison to 4 bits per byte */
+static uint64_t neon_mask(uint8x16_t eq) {
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+}
+
+static int32_t find_neon(const uint8_t *text, int32_t textlen, const uint8_t *pat, int32_t patlen) {
+    const uint8x16_t first = vdupq_n_u8(pat[0]);
+    const uint8x16_t last = vdupq_n_u8(pat[patlen - 1]);
+    int32_t i = 0;
+    for (; i + patlen - 1 + 16 <= textlen; i += 16) {
+        uint8x16_t bf = vld1q_u8(text + i);
+        uint8x16_t bl = vld1q_u8(text + i + patlen - 1);
+        uint64_t mask = neon_mask(vandq_u8(vceqq_u8(bf, first), vceqq_u8(bl, last)));
+        while (mask) {
+            int32_t k = i + (__builtin_ctzll(mask) >> 2);
+            if (!memcmp(text + k + 1, pat + 1, patlen - 2)) return k;
+            mask &= ~((uint64_t) 0xF << ((k - i) << 2));
+        }
+    }
+    int32_t result = find_scalar(text + i, textlen - i, pat, patlen);
+    return result < 0 ? -1 : i + result;
+}
+
+typedef struct {
+    uint8x16_t lo;
+    uint8x16_t hi;
+} SetNEON;
+
+static SetNEON set_neon(const uint32_t *set) {
+    uint8_t lo[16], hi[16];
+    byteset_nibbles(set, lo, hi);
+    SetNEON t;
+    t.lo = vld1q_u8(lo);
+    t.hi = vld1q_u8(hi);
+    return t;
+}
+
+static uint64_t notin_neon(SetNEON t, const uint8_t *str) {
+    static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t v = vld1q_u8(str);
+    uint8x16_t lo = vandq_u8(v, vdupq_n_u8(0x0F));
+    uint8x16_t hi = vshrq_n_u8(v, 4);
+    uint8x16_t row = vbslq_u8(vcltq_u8(hi, vdupq_n_u8(8)), vqtbl1q_u8(t.lo, lo), vqtbl1q_u8(t.hi, lo));
+    uint8x16_t hit = vandq_u8(row, vqtbl1q_u8(vld1q_u8(bits), hi));
+    return neon_mask(vceqq_u8(hit, vdupq_n_u8(0)));
+}
+
+static int32_t span_neon(const uint8_t *str, int32_t len, const uint32_t *set, int in_set) {
+    SetNEON t = set_neon(set);
+    uint64_t flip = in_set ? 0 : ~(uint64_t) 0;
+    int32_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint64_t stop = notin_neon(t, str + i) ^ flip;
+        if (stop) return i + (__builtin_ctzll(stop) >> 2);
+    }
+    return i + span_scalar(str + i, len - i, set, in_set);
+}
+
+static int32_t rspan_neon(const uint8_t *str, int32_t len, const uint32_t *set, int in_set) {
+    SetNEON t = set_neon(set);
+    uint64_t flip = in_set ? 0 : ~(uint64_t) 0;
+    int32_t i = len;
+    for (; i >= 16; i -= 16) {
+        uint64_t stop = notin_neon(t, str + i - 16) ^ flip;
+        if (stop) return i - (__builtin_clzll(stop) >> 2);
+    }
+    return rspan_scalar(str, i, set, in_set);
+}
+
+static void case_neon(uint8_t *dest, const uint8_t *src, int32_t len, uint8_t base) {
+    const uint8x16_t vbase = vdupq_n_u8(base);
+    const uint8x16_t limit = vdupq_n_u8(26);
+    const uint8x16_t flip = vdupq_n_u8(0x20);
+    int32_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint8x16_t in = vcltq_u8(vsubq_u8(v, vbase), limit);
+        vst1q_u8(dest + i, veorq_u8(v, vandq_u8(in, flip)));
+    }
+    case_scalar(dest + i, src + i, len - i, base);
+}
+
+static int32_t ascii_neon(const uint8_t *str, int32_t len) {
+    int32_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        if (vmaxvq_u8(vld1q_u8(str + i)) & 0x80) break;
+    }
+    return i + ascii_scalar(str + i, len - i);
+}
+
+#endif
+
+/*
+ * Dispatch
+ */
+
+/* Byte set kernels build lookup tables first, so short inputs are cheaper to
+ * check one byte at a time */
+#define JANET_SIMD_SPAN_MIN 64
+
+int32_t janet_simd_find(const uint8_t *text, int32_t textlen, const uint8_t *pat, int32_t patlen) {
+    if (patlen <= 0) return 0;
+    if (patlen > textlen) return -1;
+    if (patlen == 1) {
+        const uint8_t *p = memchr(text, pat[0], textlen);
+        return NULL == p ? -1 : (int32_t)(p - text);
+    }
+#ifdef JANET_SIMD_AVX2
+    if (HAS_AVX2()) return find_avx2(text, textlen, pat, patlen);
+#endif
+#if defined(JANET_SIMD_SSE2)
+    return find_sse2(text, textlen, pat, patlen);
+#elif defined(JANET_SIMD_NEON)
+    return find_neon(text, textlen, pat, patlen);
+#else
+    return find_scalar(text, textlen, pat, patlen);
+#endif
+}
+
+int32_t janet_simd_span(const uint8_t *str, int32_t len, const uint32_t *set, int in_set) {
+    in_set = !!in_set;
+    if (len >= JANET_SIMD_SPAN_MIN) {
+#ifdef JANET_SIMD_AVX2
+        if (HAS_AVX2()) return span_avx2(str, len, set, in_set);
+#endif
+#ifdef JANET_SIMD_NEON
+        return span_neon(str, len, set, in_set);
+#endif
+    }
+    return span_scalar(str, len, set, in_set);
+}
+
+int32_t janet_simd_rspan(const uint8_t *str, int32_t len, const uint32_t *set, int in_set) {
+    in_set = !!in_set;
+    if (len >= JANET_SIMD_SPAN_MIN) {
+#ifdef JANET_SIMD_AVX2
+        if (HAS_AVX2()) return rspan_avx2(str, len, set, in_set);
+#endif
+#ifdef JANET_SIMD_NEON
+        return rspan_neon(str, len, set, in_set);
+#endif
+    }
+    return rspan_scalar(str, len, set, in_set);
+}
+
+static void simd_case(uint8_t *dest, const uint8_t *src, int32_t len, uint8_t base) {
+#ifdef JANET_SIMD_AVX2
+    if (HAS_AVX2()) {
+        case_avx2(dest, src, len, base);
+        return;
+    }
+#endif
+#if defined(JANET_SIMD_SSE2)
+    case_sse2(dest, src, len, base);
+#elif defined(JANET_SIMD_NEON)
+    case_neon(dest, src, len, base);
+#else
+    case_scalar(dest, src, len, base);
+#endif
+}
+
+void janet_simd_ascii_lower(uint8_t *dest, const uint8_t *src, int32_t len) {
+    simd_case(dest, src, len, 'A');
+}
+
+void janet_simd_ascii_upper(uint8_t *dest, const uint8_t *src, int32_t len) {
+    simd_case(dest, src, len, 'a');
+}
+
+int32_t janet_simd_ascii_span(const uint8_t *str, int32_t len) {
+#ifdef JANET_SIMD_AVX2
+    if (HAS_AVX2()) return ascii_avx2(str, len);
+#endif
+#if defined(JANET_SIMD_SSE2)
+    return ascii_sse2(str, len);
+#elif defined(JANET_SIMD_NEON)
+    return ascii_neon(str, len);
+#else
+    return ascii_scalar(str, len);
+#endif
+}
@@ -0,0 +1,123 @@
+/*
+* Copyright (c) 2023 Calvin Rose
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to
+* deal in the Software without restriction, including without limitation the
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+* sell copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#ifndef JANET_SIMD_H_defined
+#define JANET_SIMD_H_defined
+
+#ifndef JANET_AMALG
+#include "features.h"
+#include <janet.h>
+#endif
+
+/* Byte kernels for the string, buffer, parser, and table functions. Each
+ * kernel has a portable version, and vector versions (SSE2, AVX2, or NEON) that
+ * are picked at runtime when the CPU supports them. Byte sets are 256 bit bitmaps stored
+ * as 8 uint32_t words, the same layout used by pegs. */
+
+/* Pick the vector instruction sets to build. SSE2 and NEON are part of the
+ * base x86-64 and AArch64 targets, while AVX2 is checked for at runtime. */
+#ifndef JANET_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JANET_SIMD_SSE2
+#include <emmintrin.h>
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define JANET_SIMD_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON) && defined(__GNUC__)
+#define JANET_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+/* Index of the lowest set bit. x must not be 0. */
+static inline int janet_ctz32(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(x);
+#elif defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return (int) i;
+#else
+    int n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/* Groups of 16 hash table control bytes. janet_simd_group_match returns a mask
+ * with one bit for each of the 16 bytes at group that equals c. Defined only
+ * when JANET_SIMD_GROUP is. */
+#if defined(JANET_SIMD_SSE2)
+#define JANET_SIMD_GROUP
+typedef uint32_t JanetGroupMask;
+static inline JanetGroupMask janet_simd_group_match(const uint8_t *group, uint8_t c) {
+    __m128i g = _mm_loadu_si128((const __m128i *) group);
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char) c)));
+}
+/* Index of the first byte in a mask, and a mask of the first n bytes */
+#define janet_simd_group_first(m) janet_ctz32(m)
+#define janet_simd_group_prefix(n) ((n) >= 16 ? 0xFFFFu : ((1u << (n)) - 1))
+#elif defined(JANET_SIMD_NEON)
+#define JANET_SIMD_GROUP
+typedef uint64_t JanetGroupMask;
+static inline JanetGroupMask janet_simd_group_match(const uint8_t *group, uint8_t c) {
+    uint8x16_t eq = vceqq_u8(vld1q_u8(group), vdupq_n_u8(c));
+    uint64_t m = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    return m & 0x8888888888888888ull;
+}
+#define janet_simd_group_first(m) (__builtin_ctzll(m) >> 2)
+#define janet_simd_group_prefix(n) ((n) >= 16 ? ~(uint64_t) 0 : (((uint64_t) 1 << ((n) << 2)) - 1))
+#endif
+
+/* Longest pattern janet_simd_find will search for. Longer patterns should use
+ * an algorithm with a linear worst case. */
+#define JANET_SIMD_FIND_MAX 32
+
+void janet_byteset_init(uint32_t *set, const uint8_t *bytes, int32_t len);
+
+/* Index of the first occurrence of pat in text, or -1 */
+int32_t janet_simd_find(const uint8_t *text, int32_t textlen, const uint8_t *pat, int32_t patlen);
+
+/* Length of the longest prefix of str whose bytes are all in (or, if in_set
+ * is 0, all not in) set */
+int32_t janet_simd_span(const uint8_t *str, int32_t len, const uint32_t *set, int in_set);
+
+/* Like janet_simd_span, but returns the length left after removing the longest
+ * such suffix */
+int32_t janet_simd_rspan(const uint8_t *str, int32_t len, const uint32_t *set, int in_set);
+
+/* ASCII case mapping of len bytes from src to dest */
+void janet_simd_ascii_lower(uint8_t *dest, const uint8_t *src, int32_t len);
+void janet_simd_ascii_upper(uint8_t *dest, const uint8_t *src, int32_t len);
+
+/* Length of the longest prefix of str that is plain ASCII */
+int32_t janet_simd_ascii_span(const uint8_t *str, int32_t len);
+
+#endif
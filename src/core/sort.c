@@ -0,0 +1,418 @@
+/*
+* Copyright (c) 2023 Calvin Rose
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to
+* deal in the Software without restriction, including without limitation the
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+* sell copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#ifndef JANET_AMALG
+#include "features.h"
+#include <janet.h>
+#include "util.h"
+#include <string.h>
+#endif
+
+/* Native sorting of arrays in the order of `<`, which is the order of
+ * janet_compare. Each element is paired with its sort key, and the pairs are
+ * sorted by one of three engines:
+ *
+ * - If every key is a number, keys are mapped to unsigned integers with the
+ *   same order, and sorted with an LSD radix sort that skips bytes that are
+ *   the same in every key.
+ * - If every key is a string, every key is a symbol, or every key is a
+ *   keyword, pairs are sorted by the first 8 bytes of the key, and only ties
+ *   compare the whole strings.
+ * - Anything else is sorted with janet_compare.
+ *
+ * All engines fall back to an introsort. The first two do not touch the VM,
+ * so they can sort chunks of a large array on several threads and then merge
+ * the chunks. */
+
+typedef struct {
+    uint64_t key;
+    Janet value;
+} SortNum;
+
+typedef struct {
+    uint64_t prefix;
+    const uint8_t *str;
+    Janet value;
+} SortStr;
+
+typedef struct {
+    Janet key;
+    Janet value;
+} SortAny;
+
+#define sort_num_less(a, b) ((a)->key < (b)->key)
+#define sort_any_less(a, b) (janet_compare((a)->key, (b)->key) < 0)
+
+static int sort_str_less(const SortStr *a, const SortStr *b) {
+    if (a->prefix != b->prefix) return a->prefix < b->prefix;
+    return janet_string_compare(a->str, b->str) < 0;
+}
+
+/* Introsort for an item type. Quicksort partitions around the
+ * median of three, switching to heapsort if partitions stay unbalanced, and
+ * to insertion sort for short runs. */
+#define JANET_DEFINE_SORT(NAME, T, LESS) \
+static void NAME##_insertion(T *a, size_t n) { \
+    for (size_t i = 1; i < n; i++) { \
+        T x = a[i]; \
+        size_t j = i; \
+        while (j > 0 && LESS(&x, &a[j - 1])) { \
+            a[j] = a[j - 1]; \
+            j--; \
+        } \
+        a[j] = x; \
+    } \
+} \
+static void NAME##_sift(T *a, size_t root, size_t n) { \
+    T x = a[root]; \
+    for (;;) { \
+        size_t child = 2 * root + 1; \
+        if (child >= n) break; \
+        if (child + 1 < n && LESS(&a[child], &a[child + 1])) child++; \
+        if (!LESS(&x, &a[child])) break; \
+        a[root] = a[child]; \
+        root = child; \
+    } \
+    a[root] = x; \
+} \
+static void NAME##_heapsort(T *a, size_t n) { \
+    for (size_t i = n / 2; i-- > 0;) NAME##_sift(a, i, n); \
+    while (n > 1) { \
+        T t = a[0]; \
+        a[0] = a[--n]; \
+        a[n] = t; \
+        NAME##_sift(a, 0, n); \
+    } \
+} \
+static void NAME##_intro(T *a, size_t n, int depth) { \
+    T t; \
+    while (n > 16) { \
+        if (depth-- == 0) { \
+            NAME##_heapsort(a, n); \
+            return; \
+        } \
+        size_t mid = n / 2; \
+        if (LESS(&a[mid], &a[1])) { t = a[mid]; a[mid] = a[1]; a[1] = t; } \
+        if (LESS(&a[n - 1], &a[mid])) { t = a[mid]; a[mid] = a[n - 1]; a[n - 1] = t; } \
+        if (LESS(&a[mid], &a[1])) { t = a[mid]; a[mid] = a[1]; a[1] = t; } \
+        t = a[0]; a[0] = a[mid]; a[mid] = t; \
+        /* a[1] and a[n - 1] stop the scans */ \
+        size_t i = 0, j = n; \
+        for (;;) { \
+            do i++; while (LESS(&a[i], &a[0])); \
+            do j--; while (LESS(&a[0], &a[j])); \
+            if (i >= j) break; \
+            t = a[i]; a[i] = a[j]; a[j] = t; \
+        } \
+        t = a[0]; a[0] = a[j]; a[j] = t; \
+        if (j < n - j) { \
+            NAME##_intro(a, j, depth); \
+            a += j + 1; \
+            n -= j + 1; \
+        } else { \
+            NAME##_intro(a + j + 1, n - j - 1, depth); \
+            n = j; \
+        } \
+    } \
+    NAME##_insertion(a, n); \
+} \
+static void NAME##_sort(T *a, size_t n) { \
+    int depth = 0; \
+    for (size_t m = n; m > 1; m >>= 1) depth += 2; \
+    NAME##_intro(a, n, depth); \
+}
+
+/* Merge two sorted runs into out */
+#define JANET_DEFINE_MERGE(NAME, T, LESS) \
+static void NAME##_merge(const T *a, size_t na, const T *b, size_t nb, T *out) { \
+    while (na && nb) { \
+        if (LESS(b, a)) { \
+            *out++ = *b++; \
+            nb--; \
+        } else { \
+            *out++ = *a++; \
+            na--; \
+        } \
+    } \
+    memcpy(out, a, na * sizeof(T)); \
+    memcpy(out + na, b, nb * sizeof(T)); \
+}
+
+JANET_DEFINE_SORT(sort_num, SortNum, sort_num_less)
+JANET_DEFINE_SORT(sort_str, SortStr, sort_str_less)
+JANET_DEFINE_SORT(sort_any, SortAny, sort_any_less)
+JANET_DEFINE_MERGE(sort_num, SortNum, sort_num_less)
+JANET_DEFINE_MERGE(sort_str, SortStr, sort_str_less)
+
+/* Map a double to an unsigned integer with the same order */
+static uint64_t sort_num_key(double d) {
+    union {
+        double d;
+        uint64_t u;
+    } x;
+    x.d = d;
+    return (x.u >> 63) ? ~x.u : (x.u | ((uint64_t) 1 << 63));
+}
+
+/* First 8 bytes of a string, big endian, padded with zeros */
+static uint64_t sort_str_prefix(const uint8_t *str) {
+    int32_t len = janet_string_length(str);
+    uint64_t prefix = 0;
+    for (int32_t i = 0; i < 8; i++) {
+        prefix = (prefix << 8) | (i < len ? str[i] : 0);
+    }
+    return prefix;
+}
+
+/* LSD radix sort on bytes of the key. tmp must hold n items. */
+static void sort_num_radix(SortNum *a, SortNum *tmp, size_t n) {
+    if (n < 256) {
+        sort_num_sort(a, n);
+        return;
+    }
+    size_t counts[8][256];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k = a[i].key;
+        for (int b = 0; b < 8; b++) counts[b][(k >> (8 * b)) & 0xFF]++;
+    }
+    SortNum *src = a, *dst = tmp;
+    for (int b = 0; b < 8; b++) {
+        size_t *count = counts[b];
+        if (count[(a[0].key >> (8 * b)) & 0xFF] == n) continue;
+        size_t sum = 0;
+        for (int d = 0; d < 256; d++) {
+            size_t c = count[d];
+            count[d] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < n; i++) {
+            dst[count[(src[i].key >> (8 * b)) & 0xFF]++] = src[i];
+        }
+        SortNum *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != a) memcpy(a, src, n * sizeof(SortNum));
+}
+
+/* Parallel sorting. Chunks are sorted in place, then merged pairwise back
+ * and forth between the items and a buffer of the same size. */
+
+#define JANET_SORT_NUM 0
+#define JANET_SORT_STR 1
+#define JANET_SORT_ANY 2
+
+typedef struct {
+    int kind;
+    size_t size;
+    char *items;
+    char *tmp;
+    size_t *bounds; /* workers + 1 chunk boundaries */
+    int32_t workers;
+    int32_t width; /* chunks per run in the current merge round */
+    char *src;
+    char *dst;
+} SortJob;
+
+static void sort_chunk(SortJob *job, size_t lo, size_t hi) {
+    size_t n = hi - lo;
+    switch (job->kind) {
+        case JANET_SORT_NUM:
+            sort_num_radix((SortNum *) job->items + lo, (SortNum *) job->tmp + lo, n);
+            break;
+        case JANET_SORT_STR:
+            sort_str_sort((SortStr *) job->items + lo, n);
+            break;
+        default:
+            sort_any_sort((SortAny *) job->items + lo, n);
+            break;
+    }
+}
+
+static void sort_chunk_worker(void *data, int32_t i) {
+    SortJob *job = (SortJob *) data;
+    sort_chunk(job, job->bounds[i], job->bounds[i + 1]);
+}
+
+static void sort_merge_worker(void *data, int32_t i) {
+    SortJob *job = (SortJob *) data;
+    int32_t first = i * 2 * job->width;
+    int32_t mid = first + job->width;
+    int32_t last = mid + job->width;
+    if (mid > job->workers) mid = job->workers;
+    if (last > job->workers) last = job->workers;
+    size_t lo = job->bounds[first], m = job->bounds[mid], hi = job->bounds[last];
+    size_t size = job->size;
+    if (m == hi) {
+        memcpy(job->dst + lo * size, job->src + lo * size, (hi - lo) * size);
+        return;
+    }
+    switch (job->kind) {
+        case JANET_SORT_NUM:
+            sort_num_merge((SortNum *) job->src + lo, m - lo,
+                           (SortNum *) job->src + m, hi - m, (SortNum *) job->dst + lo);
+            break;
+        default:
+            sort_str_merge((SortStr *) job->src + lo, m - lo,
+                           (SortStr *) job->src + m, hi - m, (SortStr *) job->dst + lo);
+            break;
+    }
+}
+
+static void sort_parallel(SortJob *job) {
+    int32_t workers = job->workers;
+    janet_parallel(workers, sort_chunk_worker, job, 0);
+    job->src = job->items;
+    job->dst = job->tmp;
+    for (job->width = 1; job->width < workers; job->width *= 2) {
+        int32_t runs = (workers + 2 * job->width - 1) / (2 * job->width);
+        janet_parallel(runs, sort_merge_worker, job, 0);
+        char *swap = job->src;
+        job->src = job->dst;
+        job->dst = swap;
+    }
+    job->items = job->src;
+}
+
+static Janet sort_array(int32_t workers, int32_t argc, Janet *argv, int offset) {
+    JanetArray *array = janet_getarray(argv, offset);
+    size_t n = (size_t) array->count;
+    const Janet *keys = array->data;
+    if (argc > offset + 1 && !janet_checktype(argv[offset + 1], JANET_NIL)) {
+        JanetView view = janet_getindexed(argv, offset + 1);
+        if (view.len != array->count) {
+            janet_panicf("expected %d keys, got %d", array->count, view.len);
+        }
+        keys = view.items;
+    }
+    int descending = argc > offset + 2 && janet_truthy(argv[offset + 2]);
+    if (n < 2) return janet_wrap_array(array);
+
+    /* Pick an engine */
+    JanetType first = janet_type(keys[0]);
+    int kind = JANET_SORT_ANY;
+    if (first == JANET_NUMBER) {
+        kind = JANET_SORT_NUM;
+    } else if (first == JANET_STRING || first == JANET_SYMBOL || first == JANET_KEYWORD) {
+        kind = JANET_SORT_STR;
+    }
+    for (size_t i = 1; i < n && kind != JANET_SORT_ANY; i++) {
+        if (!janet_checktype(keys[i], first)) kind = JANET_SORT_ANY;
+    }
+
+    /* Pair up keys and values */
+    SortJob job;
+    job.kind = kind;
+    job.size = kind == JANET_SORT_NUM ? sizeof(SortNum)
+               : kind == JANET_SORT_STR ? sizeof(SortStr)
+               : sizeof(SortAny);
+    job.items = janet_smalloc(n * job.size);
+    job.tmp = NULL;
+    for (size_t i = 0; i < n; i++) {
+        if (kind == JANET_SORT_NUM) {
+            SortNum *item = (SortNum *) job.items + i;
+            item->key = sort_num_key(janet_unwrap_number(keys[i]));
+            item->value = array->data[i];
+        } else if (kind == JANET_SORT_STR) {
+            SortStr *item = (SortStr *) job.items + i;
+            item->str = janet_unwrap_string(keys[i]);
+            item->prefix = sort_str_prefix(item->str);
+            item->value = array->data[i];
+        } else {
+            SortAny *item = (SortAny *) job.items + i;
+            item->key = keys[i];
+            item->value = array->data[i];
+        }
+    }
+
+    /* janet_compare uses the VM, so only the first two engines run on threads */
+    workers = kind == JANET_SORT_ANY ? 1 : janet_parallel_workers(workers, array->count);
+    char *items = job.items;
+    if (kind == JANET_SORT_NUM || workers > 1) {
+        job.tmp = janet_smalloc(n * job.size);
+    }
+    if (workers > 1) {
+        job.workers = workers;
+        job.bounds = janet_smalloc((workers + 1) * sizeof(size_t));
+        for (int32_t i = 0; i <= workers; i++) {
+            job.bounds[i] = n * (size_t) i / (size_t) workers;
+        }
+        sort_parallel(&job);
+        janet_sfree(job.bounds);
+    } else if (kind == JANET_SORT_ANY) {
+        /* The compare callbacks of abstract types can run arbitrary code and
+         * change the array, so the values being sorted may only be referenced
+         * from the items until they are written back */
+        int handle = janet_gclock();
+        sort_chunk(&job, 0, n);
+        janet_gcunlock(handle);
+    } else {
+        sort_chunk(&job, 0, n);
+    }
+
+    /* Write back */
+    if ((size_t) array->count != n) {
+        janet_panic("array was resized while sorting");
+    }
+    for (size_t i = 0; i < n; i++) {
+        size_t j = descending ? n - 1 - i : i;
+        const char *item = job.items + j * job.size;
+        array->data[i] = kind == JANET_SORT_NUM ? ((const SortNum *) item)->value
+                         : kind == JANET_SORT_STR ? ((const SortStr *) item)->value
+                         : ((const SortAny *) item)->value;
+    }
+    janet_sfree(items == job.items ? job.tmp : items);
+    janet_sfree(job.items);
+    return janet_wrap_array(array);
+}
+
+JANET_CORE_FN(cfun_array_sort,
+              "(array/sort arr &opt keys descending)",
+              "Sort `arr` in place in the order of `<` and return it. If `keys` is given, it must be "
+              "an array or tuple as long as `arr`, and each element of `arr` is ordered by the key "
+              "at the same index. If `descending` is truthy, sort from greatest to least. The sort "
+              "is not stable. Arrays of only numbers, or only strings, symbols or keywords, are "
+              "sorted faster than mixed arrays.") {
+    janet_arity(argc, 1, 3);
+    return sort_array(1, argc, argv, 0);
+}
+
+JANET_CORE_FN(cfun_array_sort_parallel,
+              "(array/sort-parallel workers arr &opt keys descending)",
+              "Like `array/sort`, but sorts with up to `workers` threads. Only arrays whose keys are "
+              "all numbers, or all strings, symbols or keywords, are sorted on more than one "
+              "thread, and small arrays are sorted on the calling thread.") {
+    janet_arity(argc, 2, 4);
+    int32_t workers = janet_getnat(argv, 0);
+    return sort_array(workers, argc, argv, 1);
+}
+
+/* Load the sort module */
+void janet_lib_sort(JanetTable *env) {
+    JanetRegExt sort_cfuns[] = {
+        JANET_CORE_REG("array/sort", cfun_array_sort),
+        JANET_CORE_REG("array/sort-parallel", cfun_array_sort_parallel),
+        JANET_REG_END
+    };
+    janet_core_cfuns_ext(env, NULL, sort_cfuns);
+}
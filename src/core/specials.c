@@ -1013,6 +1013,8 @@ static JanetSlot janetc_fn(JanetFopts opts, int32_t argn, const Janet *argv) {
         }
     }
 
+    c->scope->params = arity + vararg;
+
     /* Compile destructed params */
     int32_t j = 0;
     for (i = 0; i < paramcount; i++) {
@@ -1081,12 +1083,19 @@ static JanetSlot janetc_fn(JanetFopts opts, int32_t argn, const Janet *argv) {
 
     if (selfref) def->name = janet_unwrap_symbol(head);
     janet_def_addflags(def);
-    defindex = janetc_addfuncdef(c, def);
 
     /* Ensure enough slots for vararg function. */
     if (arity + vararg > def->slotcount) def->slotcount = arity + vararg;
 
+    /* A function that captures nothing can be made once, at compile time */
+    if (c->optimize && def->environments_length == 0) {
+        ret = janetc_cslot(janet_wrap_function(janet_thunk(def)));
+        ret.flags |= JANET_SLOT_HOISTED;
+        return ret;
+    }
+
     /* Instantiate closure */
+    defindex = janetc_addfuncdef(c, def);
     ret = janetc_gettarget(opts);
     janetc_emit_su(c, JOP_CLOSURE, ret, defindex, 1);
     return ret;
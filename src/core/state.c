@@ -59,3 +59,11 @@ void janet_interpreter_interrupt(JanetVM *vm) {
     vm = vm ? vm : &janet_vm;
     vm->auto_suspend = 1;
 }
+
+/* Request a profiler sample from the Janet vm at the next function call or
+ * backwards jump. Only writes a flag, so it is safe to call from a signal handler
+ * or another thread. Does nothing if the profiler is not running. */
+void janet_interpreter_sample(JanetVM *vm) {
+    vm = vm ? vm : &janet_vm;
+    vm->profile_sample = 1;
+}
@@ -34,11 +34,66 @@
 
 typedef int64_t JanetTimestamp;
 
+#ifdef JANET_GC_SLAB
+/* Number of size classes for the slab allocator. Classes are in
+ * steps of 16 bytes, so objects up to 256 bytes are slab allocated. */
+#define JANET_SLAB_CLASSES 16
+typedef struct JanetSlab JanetSlab;
+#endif
+
+/* Set on tables that inline caches have looked through as a prototype.
+ * Changes to these tables invalidate all inline caches. */
+#define JANET_TABLE_FLAG_PROTO 0x20000
+
+/* Tables allocated by janet_table carry their version after the public
+ * struct, so that the layout of JanetTable seen by native modules does not
+ * change. Tables initialized in other memory have no version and are never
+ * cached. */
+#define JANET_TABLE_FLAG_VERSIONED 0x100000
+typedef struct {
+    JanetTable table;
+    uint64_t version;
+} JanetVersionedTable;
+#define janet_table_version(t) (((JanetVersionedTable *)(t))->version)
+
+/* Inline caches for table lookups in the interpreter. There is one
+ * slot per instruction address modulo JANET_INLINE_CACHE_SIZE. */
+#define JANET_INLINE_CACHE_SIZE 256
+typedef struct {
+    JanetTable *table;
+    JanetTable *proto;
+    Janet key;
+    Janet value;
+    uint64_t version;
+    uint64_t epoch;
+} JanetInlineCache;
+
+/* Slots for dynamic binding lookups, picked by environment table and key.
+ * They are validated the same way as inline caches. */
+#define JANET_DYN_CACHE_SIZE 64
+
+/* Stacks of collected fibers are kept for reuse by new fibers. Only
+ * stacks of up to JANET_FIBER_POOL_STACK slots are kept. */
+#define JANET_FIBER_POOL_SIZE 64
+#define JANET_FIBER_POOL_STACK 1024
+typedef struct {
+    Janet *data;
+    int32_t capacity;
+} JanetFiberStack;
+
 typedef struct JanetScratch {
     JanetScratchFinalizer finalize;
     long long mem[]; /* for proper alignment */
 } JanetScratch;
 
+typedef struct JanetSArenaChunk JanetSArenaChunk;
+struct JanetSArenaChunk {
+    JanetSArenaChunk *prev;
+    size_t size;
+    size_t used;
+    long long mem[]; /* for proper alignment */
+};
+
 typedef struct {
     JanetGCObject *self;
     JanetGCObject *other;
@@ -53,6 +108,22 @@ typedef struct {
     void *data;
 } JanetQueue;
 
+#define JANET_EV_STATS_BUCKETS 8
+
+/* Counters for ev/stats */
+typedef struct {
+    uint64_t iterations;
+    uint64_t resumes;
+    uint64_t resume_buckets[JANET_EV_STATS_BUCKETS]; /* Iterations by fibers resumed: 0, 1, 2-3, 4-7, ... */
+    uint64_t slow_tasks;
+    uint64_t preemptions;
+    double poll_time;
+    double run_time;
+    int32_t threaded_calls;
+    double slow_threshold; /* 0 if the slow task hook is off */
+    JanetFunction *slow_hook;
+} JanetEVStats;
+
 typedef struct {
     JanetTimestamp when;
     JanetFiber *fiber;
@@ -91,22 +162,42 @@ struct JanetVM {
      * When this occurs, this flag will be reset to 0. */
     int auto_suspend;
 
+    /* Sampling profiler. If profile_sample is set, record the current stack
+     * on the next function call or backwards jump and reset the flag. */
+    int profile_sample;
+    JanetTable *profile_samples;
+    void *profiler;
+
+    /* Trace hook, see janet_trace_sethook. Events are only built when
+     * trace_hook is set. trace_ring is the ring used by debug/trace-start. */
+    JanetTraceHook trace_hook;
+    void *trace_data;
+    JanetTraceRing *trace_ring;
+
     /* The current running fiber on the current thread.
      * Set and unset by functions in vm.c */
     JanetFiber *fiber;
     JanetFiber *root_fiber;
 
+    /* Fiber stack pool and fiber memory counters */
+    JanetFiberStack fiber_pool[JANET_FIBER_POOL_SIZE];
+    int32_t fiber_pool_count;
+    size_t fiber_count;
+    size_t fiber_stack_bytes;
+
     /* The current pointer to the inner most jmp_buf. The current
      * return point for panics. */
     jmp_buf *signal_buf;
     Janet *return_reg;
 
     /* The global registry for c functions. Used to store meta-data
-     * along with otherwise bare c function pointers. */
+     * along with otherwise bare c function pointers. If registry_shared
+     * is set, the registry is shared with other VMs and is read only. */
     JanetCFunRegistry *registry;
     size_t registry_cap;
     size_t registry_count;
     int registry_dirty;
+    int registry_shared;
 
     /* Registry for abstract types that can be marshalled.
      * We need this to look up the constructors when unmarshalling. */
@@ -119,12 +210,29 @@ struct JanetVM {
     uint32_t cache_deleted;
     uint8_t gensym_counter[8];
 
+    /* Table versions and inline caches. Every change to a versioned table takes a
+     * new version from table_version, and changes to prototype tables also
+     * bump proto_epoch. Both are 64 bits wide so that they never wrap and
+     * a version is never reused. */
+    uint64_t table_version;
+    uint64_t proto_epoch;
+    JanetInlineCache *inline_cache;
+    JanetInlineCache *dyn_cache;
+
     /* Garbage collection */
     void *blocks;
     size_t gc_interval;
     size_t next_collection;
     size_t block_count;
     int gc_suspend;
+    void *sweep_blocks; /* Blocks from the last mark phase that have not been swept yet */
+    size_t gc_sweep_step; /* Blocks to sweep per slice, or 0 to sweep everything at once */
+    size_t heap_limit; /* Most bytes the heap may keep alive, or 0 for no limit */
+    size_t gc_headroom; /* Bytes that may be allocated before the heap limit is checked */
+    JanetGCStats gc_stats;
+#ifdef JANET_GC_SLAB
+    JanetSlab *slabs[JANET_SLAB_CLASSES]; /* Slabs with free blocks, one list per size class */
+#endif
 
     /* GC roots */
     Janet *roots;
@@ -136,6 +244,14 @@ struct JanetVM {
     size_t scratch_cap;
     size_t scratch_len;
 
+    /* Scratch arena. sarena is the newest chunk in use, and sarena_spare
+     * keeps one released chunk around for reuse. sarena_marks holds the
+     * arena position at each janet_try, indexed by stackn, so that
+     * JanetTryState keeps the layout native modules were built with. */
+    JanetSArenaChunk *sarena;
+    JanetSArenaChunk *sarena_spare;
+    JanetSArenaMark *sarena_marks;
+
     /* Sandbox flags */
     uint32_t sandbox_flags;
 
@@ -158,8 +274,10 @@ struct JanetVM {
     size_t listener_count;
     size_t listener_cap;
     size_t extra_listeners;
-    JanetTable threaded_abstracts; /* All abstract types that can be shared between threads (used in this thread) */
+    JanetTable threaded_abstracts; /* All abstract types and strings (keyed by pointer) that can be shared between threads (used in this thread) */
     JanetTable active_tasks; /* All possibly live task fibers - used just for tracking */
+    JanetEVStats ev_stats;
+    void *preempt; /* Time slice timer, see ev/preempt. NULL if preemption is off */
 #ifdef JANET_WINDOWS
     void **iocp;
 #elif defined(JANET_EV_EPOLL)
@@ -168,6 +286,9 @@ struct JanetVM {
     int epoll;
     int timerfd;
     int timer_enabled;
+#ifdef JANET_EV_URING
+    struct JanetUring *uring; /* NULL if io_uring is unavailable and epoll is used instead */
+#endif
 #elif defined(JANET_EV_KQUEUE)
     pthread_attr_t new_thread_attr;
     JanetHandle selfpipe[2];
@@ -181,6 +302,13 @@ struct JanetVM {
 #endif
 #endif
 
+    /* Cache of resolved host names, see net/dns-cache */
+#ifdef JANET_NET
+    struct JanetDnsEntry *dns_cache;
+    int32_t dns_cache_count;
+    double dns_cache_ttl;
+#endif
+
 };
 
 extern JANET_THREAD_LOCAL JanetVM janet_vm;
@@ -190,6 +318,17 @@ void janet_net_init(void);
 void janet_net_deinit(void);
 #endif
 
+void janet_profile_sample(void);
+void janet_profile_deinit(void);
+
+/* Report an event to the trace hook of the current thread, if any */
+void janet_trace_emit(JanetTraceEventType type, const void *fiber, const void *subject,
+                      const uint8_t *name, int64_t value);
+void janet_trace_deinit(void);
+#define janet_trace_event(TYPE, FIBER, SUBJECT, NAME, VALUE) do { \
+    if (janet_vm.trace_hook) janet_trace_emit((TYPE), (FIBER), (SUBJECT), (NAME), (VALUE)); \
+} while (0)
+
 #ifdef JANET_EV
 void janet_ev_init(void);
 void janet_ev_deinit(void);
@@ -26,6 +26,8 @@
 #include "gc.h"
 #include "util.h"
 #include "state.h"
+#include "vector.h"
+#include "simd.h"
 #endif
 
 #include <string.h>
@@ -89,7 +91,8 @@ const uint8_t *janet_cstring(const char *str) {
     return janet_string((const uint8_t *)str, (int32_t)strlen(str));
 }
 
-/* Knuth Morris Pratt Algorithm */
+/* Knuth Morris Pratt Algorithm. Short patterns are found with the vector
+ * search in simd.c instead, and do not need the lookup table. */
 
 struct kmp_state {
     int32_t i;
@@ -99,6 +102,7 @@ struct kmp_state {
     int32_t *lookup;
     const uint8_t *text;
     const uint8_t *pat;
+    JanetSArenaMark mark;
 };
 
 static void kmp_init(
@@ -108,17 +112,18 @@ static void kmp_init(
     if (patlen == 0) {
         janet_panic("expected non-empty pattern");
     }
-    int32_t *lookup = janet_calloc(patlen, sizeof(int32_t));
-    if (!lookup) {
-        JANET_OUT_OF_MEMORY;
-    }
-    s->lookup = lookup;
+    s->mark = janet_sarena_mark();
     s->i = 0;
     s->j = 0;
     s->text = text;
     s->pat = pat;
     s->textlen = textlen;
     s->patlen = patlen;
+    s->lookup = NULL;
+    if (patlen <= JANET_SIMD_FIND_MAX) return;
+    int32_t *lookup = janet_sarena_alloc(patlen * sizeof(int32_t));
+    lookup[0] = 0;
+    s->lookup = lookup;
     /* Init state machine */
     {
         int32_t i, j;
@@ -131,7 +136,7 @@ static void kmp_init(
 }
 
 static void kmp_deinit(struct kmp_state *state) {
-    janet_free(state->lookup);
+    janet_sarena_reset(state->mark);
 }
 
 static void kmp_seti(struct kmp_state *state, int32_t i) {
@@ -147,6 +152,15 @@ static int32_t kmp_next(struct kmp_state *state) {
     const uint8_t *text = state->text;
     const uint8_t *pat = state->pat;
     int32_t *lookup = state->lookup;
+    if (NULL == lookup) {
+        int32_t result = (i < textlen) ? janet_simd_find(text + i, textlen - i, pat, patlen) : -1;
+        if (result < 0) {
+            state->i = textlen;
+            return -1;
+        }
+        state->i = i + result + 1;
+        return i + result;
+    }
     while (i < textlen) {
         if (text[i] == pat[j]) {
             if (j == patlen - 1) {
@@ -168,8 +182,140 @@ static int32_t kmp_next(struct kmp_state *state) {
     return -1;
 }
 
+/* Bytes views. A view is a range of a byte sequence that keeps a reference
+ * to its parent instead of copying, and can be used anywhere a byte
+ * sequence is expected. Views of buffers see later changes to the buffer. */
+
+typedef struct {
+    Janet parent;
+    int32_t start;
+    int32_t length;
+} JanetBytesSlice;
+
+static const uint8_t bytes_view_empty[1] = {0};
+
+static JanetByteView bytes_view_get_bytes(JanetBytesSlice *view) {
+    JanetByteView out;
+    const uint8_t *bytes = NULL;
+    int32_t len = 0;
+    janet_bytes_view(view->parent, &bytes, &len);
+    int32_t n = len - view->start;
+    if (n > view->length) n = view->length;
+    if (n <= 0 || NULL == bytes) {
+        out.bytes = bytes_view_empty;
+        out.len = 0;
+    } else {
+        out.bytes = bytes + view->start;
+        out.len = n;
+    }
+    return out;
+}
+
+static int bytes_view_gcmark(void *p, size_t s) {
+    (void) s;
+    janet_mark(((JanetBytesSlice *) p)->parent);
+    return 0;
+}
+
+static int bytes_view_get(void *p, Janet key, Janet *out) {
+    if (!janet_checkint(key)) return 0;
+    int32_t index = janet_unwrap_integer(key);
+    JanetByteView bytes = bytes_view_get_bytes((JanetBytesSlice *) p);
+    if (index < 0 || index >= bytes.len) return 0;
+    *out = janet_wrap_integer(bytes.bytes[index]);
+    return 1;
+}
+
+static Janet bytes_view_next(void *p, Janet key) {
+    JanetByteView bytes = bytes_view_get_bytes((JanetBytesSlice *) p);
+    if (janet_checktype(key, JANET_NIL)) {
+        return bytes.len > 0 ? janet_wrap_integer(0) : janet_wrap_nil();
+    }
+    if (!janet_checkint(key)) return janet_wrap_nil();
+    int32_t next = janet_unwrap_integer(key) + 1;
+    return (next > 0 && next < bytes.len) ? janet_wrap_integer(next) : janet_wrap_nil();
+}
+
+static size_t bytes_view_length(void *p, size_t s) {
+    (void) s;
+    return (size_t) bytes_view_get_bytes((JanetBytesSlice *) p).len;
+}
+
+static JanetByteView bytes_view_bytes(void *p, size_t s) {
+    (void) s;
+    return bytes_view_get_bytes((JanetBytesSlice *) p);
+}
+
+static void bytes_view_marshal(void *p, JanetMarshalContext *ctx) {
+    JanetBytesSlice *view = (JanetBytesSlice *) p;
+    janet_marshal_abstract(ctx, p);
+    janet_marshal_janet(ctx, view->parent);
+    janet_marshal_int(ctx, view->start);
+    janet_marshal_int(ctx, view->length);
+}
+
+static void *bytes_view_unmarshal(JanetMarshalContext *ctx) {
+    JanetBytesSlice *view = janet_unmarshal_abstract(ctx, sizeof(JanetBytesSlice));
+    view->parent = janet_wrap_nil();
+    view->start = 0;
+    view->length = 0;
+    Janet parent = janet_unmarshal_janet(ctx);
+    int32_t start = janet_unmarshal_int(ctx);
+    int32_t length = janet_unmarshal_int(ctx);
+    const uint8_t *bytes;
+    int32_t len;
+    if (!janet_bytes_view(parent, &bytes, &len) || start < 0 || length < 0) {
+        janet_panic("invalid bytes view");
+    }
+    view->parent = parent;
+    view->start = start;
+    view->length = length;
+    return view;
+}
+
+const JanetAbstractType janet_bytes_view_type = {
+    "core/bytes-view",
+    NULL,
+    bytes_view_gcmark,
+    bytes_view_get,
+    NULL, /* put */
+    bytes_view_marshal,
+    bytes_view_unmarshal,
+    NULL, /* tostring */
+    NULL, /* compare */
+    NULL, /* hash */
+    bytes_view_next,
+    NULL, /* call */
+    bytes_view_length,
+    bytes_view_bytes
+};
+
 /* CFuns */
 
+JANET_CORE_FN(cfun_string_view,
+              "(string/view bytes &opt start end)",
+              "Takes a slice of a byte sequence like `string/slice`, but without copying. Returns a "
+              "read-only core/bytes-view that refers to the bytes of its parent, and can be used in "
+              "place of a byte sequence, for example with `string/find`, `peg/match`, or "
+              "`buffer/push`. Indexing a view gives byte values. A view of a buffer sees later "
+              "changes to the buffer. Use `string/slice` or `buffer/slice` on a view to copy its "
+              "bytes out, so the parent can be garbage collected.") {
+    JanetRange range = janet_getslice(argc, argv);
+    janet_getbytes(argv, 0);
+    Janet parent = argv[0];
+    int32_t start = range.start;
+    JanetBytesSlice *inner = janet_checkabstract(parent, &janet_bytes_view_type);
+    if (NULL != inner) {
+        parent = inner->parent;
+        start += inner->start;
+    }
+    JanetBytesSlice *view = janet_abstract(&janet_bytes_view_type, sizeof(JanetBytesSlice));
+    view->parent = parent;
+    view->start = start;
+    view->length = range.end - range.start;
+    return janet_wrap_abstract(view);
+}
+
 JANET_CORE_FN(cfun_string_slice,
               "(string/slice bytes &opt start end)",
               "Returns a substring from a byte sequence. The substring is from "
@@ -251,14 +397,7 @@ JANET_CORE_FN(cfun_string_asciilower,
     janet_fixarity(argc, 1);
     JanetByteView view = janet_getbytes(argv, 0);
     uint8_t *buf = janet_string_begin(view.len);
-    for (int32_t i = 0; i < view.len; i++) {
-        uint8_t c = view.bytes[i];
-        if (c >= 65 && c <= 90) {
-            buf[i] = c + 32;
-        } else {
-            buf[i] = c;
-        }
-    }
+    janet_simd_ascii_lower(buf, view.bytes, view.len);
     return janet_wrap_string(janet_string_end(buf));
 }
 
@@ -270,14 +409,7 @@ JANET_CORE_FN(cfun_string_asciiupper,
     janet_fixarity(argc, 1);
     JanetByteView view = janet_getbytes(argv, 0);
     uint8_t *buf = janet_string_begin(view.len);
-    for (int32_t i = 0; i < view.len; i++) {
-        uint8_t c = view.bytes[i];
-        if (c >= 97 && c <= 122) {
-            buf[i] = c - 32;
-        } else {
-            buf[i] = c;
-        }
-    }
+    janet_simd_ascii_upper(buf, view.bytes, view.len);
     return janet_wrap_string(janet_string_end(buf));
 }
 
@@ -464,30 +596,121 @@ JANET_CORE_FN(cfun_string_split,
     return janet_wrap_array(array);
 }
 
+/* Parallel searches. The start positions to search are cut into one range per
+ * worker, and each worker finds every match, overlapping or not, that starts in
+ * its range. Results are merged in order on the calling thread. */
+
+struct parallel_find {
+    const uint8_t *text;
+    const uint8_t *pat;
+    int32_t textlen;
+    int32_t patlen;
+    int32_t start;
+    int32_t chunk;
+    int32_t **results; /* janet_v of match positions, one per worker */
+};
+
+static void parallel_find_worker(void *data, int32_t w) {
+    struct parallel_find *pf = (struct parallel_find *) data;
+    int32_t last = pf->textlen - pf->patlen + 1;
+    int32_t lo = pf->start + w * pf->chunk;
+    int32_t hi = (last - lo > pf->chunk) ? lo + pf->chunk : last;
+    while (lo < hi) {
+        int32_t result = janet_simd_find(pf->text + lo, hi - lo + pf->patlen - 1, pf->pat, pf->patlen);
+        if (result < 0) break;
+        janet_v_push(pf->results[w], lo + result);
+        lo += result + 1;
+    }
+}
+
+static int32_t parallel_find_setup(int32_t argc, Janet *argv, struct parallel_find *pf) {
+    int32_t workers = janet_getnat(argv, 0);
+    JanetByteView pat = janet_getbytes(argv, 1);
+    JanetByteView text = janet_getbytes(argv, 2);
+    pf->start = 0;
+    if (argc >= 4) {
+        pf->start = janet_getinteger(argv, 3);
+        if (pf->start < 0) janet_panic("expected non-negative start index");
+    }
+    if (pat.len == 0) janet_panic("expected non-empty pattern");
+    pf->text = text.bytes;
+    pf->textlen = text.len;
+    pf->pat = pat.bytes;
+    pf->patlen = pat.len;
+    int32_t range = text.len - pat.len + 1 - pf->start;
+    if (range < 0) range = 0;
+    workers = janet_parallel_workers(workers, range);
+    pf->chunk = (range + workers - 1) / workers;
+    pf->results = janet_smalloc(workers * sizeof(int32_t *));
+    for (int32_t i = 0; i < workers; i++) pf->results[i] = NULL;
+    if (workers == 1) {
+        parallel_find_worker(pf, 0);
+    } else {
+        janet_parallel(workers, parallel_find_worker, pf, 0);
+    }
+    return workers;
+}
+
+static void parallel_find_deinit(struct parallel_find *pf, int32_t workers) {
+    for (int32_t i = 0; i < workers; i++) janet_v_free(pf->results[i]);
+    janet_sfree(pf->results);
+}
+
+JANET_CORE_FN(cfun_string_findall_parallel,
+              "(string/find-all-parallel workers patt str &opt start-index)",
+              "Like `string/find-all`, but searches with up to `workers` threads. Small inputs are "
+              "searched on the current thread. Returns an array of all indices of found patterns.") {
+    struct parallel_find pf;
+    janet_arity(argc, 3, 4);
+    int32_t workers = parallel_find_setup(argc, argv, &pf);
+    JanetArray *array = janet_array(0);
+    for (int32_t i = 0; i < workers; i++) {
+        for (int32_t j = 0; j < janet_v_count(pf.results[i]); j++) {
+            janet_array_push(array, janet_wrap_integer(pf.results[i][j]));
+        }
+    }
+    parallel_find_deinit(&pf, workers);
+    return janet_wrap_array(array);
+}
+
+JANET_CORE_FN(cfun_string_split_parallel,
+              "(string/split-parallel workers delim str &opt start limit)",
+              "Like `string/split`, but searches for `delim` with up to `workers` threads. Small inputs "
+              "are searched on the current thread. Returns an array of substrings.") {
+    struct parallel_find pf;
+    janet_arity(argc, 3, 5);
+    int32_t limit = -1, lastindex = 0;
+    if (argc == 5) {
+        limit = janet_getinteger(argv, 4);
+    }
+    int32_t workers = parallel_find_setup(argc, argv, &pf);
+    JanetArray *array = janet_array(0);
+    /* Skip overlapping matches, as string/split does */
+    for (int32_t i = 0; i < workers && limit; i++) {
+        for (int32_t j = 0; j < janet_v_count(pf.results[i]); j++) {
+            int32_t result = pf.results[i][j];
+            if (result < lastindex) continue;
+            if (!--limit) break;
+            janet_array_push(array, janet_stringv(pf.text + lastindex, result - lastindex));
+            lastindex = result + pf.patlen;
+        }
+    }
+    janet_array_push(array, janet_stringv(pf.text + lastindex, pf.textlen - lastindex));
+    parallel_find_deinit(&pf, workers);
+    return janet_wrap_array(array);
+}
+
 JANET_CORE_FN(cfun_string_checkset,
               "(string/check-set set str)",
               "Checks that the string `str` only contains bytes that appear in the string `set`. "
               "Returns true if all bytes in `str` appear in `set`, false if some bytes in `str` do "
               "not appear in `set`.") {
-    uint32_t bitset[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    uint32_t bitset[8];
     janet_fixarity(argc, 2);
     JanetByteView set = janet_getbytes(argv, 0);
     JanetByteView str = janet_getbytes(argv, 1);
-    /* Populate set */
-    for (int32_t i = 0; i < set.len; i++) {
-        int index = set.bytes[i] >> 5;
-        uint32_t mask = 1 << (set.bytes[i] & 0x1F);
-        bitset[index] |= mask;
-    }
-    /* Check set */
-    for (int32_t i = 0; i < str.len; i++) {
-        int index = str.bytes[i] >> 5;
-        uint32_t mask = 1 << (str.bytes[i] & 0x1F);
-        if (!(bitset[index] & mask)) {
-            return janet_wrap_false();
-        }
-    }
-    return janet_wrap_true();
+    janet_byteset_init(bitset, set.bytes, set.len);
+    return janet_wrap_boolean(janet_simd_span(str.bytes, str.len, bitset, 1) == str.len);
 }
 
 JANET_CORE_FN(cfun_string_join,
@@ -559,7 +782,9 @@ JANET_CORE_FN(cfun_string_format,
               "- `p`, `P`: pretty format, truncating if necessary\n"
               "- `m`, `M`: pretty format without truncating.\n"
               "- `q`, `Q`: pretty format on one line, truncating if necessary.\n"
-              "- `n`, `N`: pretty format on one line without truncation.\n") {
+              "- `n`, `N`: pretty format on one line without truncation.\n\n"
+              "If `(dyn *pretty-limit*)` is a positive number, pretty printing a value stops with `...` "
+              "once about that many bytes have been written, even without truncation.\n") {
     janet_arity(argc, 1, -1);
     JanetBuffer *buffer = janet_buffer(0);
     const char *strfrmt = (const char *) janet_getstring(argv, 0);
@@ -567,35 +792,22 @@ JANET_CORE_FN(cfun_string_format,
     return janet_stringv(buffer->data, buffer->count);
 }
 
-static int trim_help_checkset(JanetByteView set, uint8_t x) {
-    for (int32_t j = 0; j < set.len; j++)
-        if (set.bytes[j] == x)
-            return 1;
-    return 0;
-}
-
-static int32_t trim_help_leftedge(JanetByteView str, JanetByteView set) {
-    for (int32_t i = 0; i < str.len; i++)
-        if (!trim_help_checkset(set, str.bytes[i]))
-            return i;
-    return str.len;
+static int32_t trim_help_leftedge(JanetByteView str, const uint32_t *set) {
+    return janet_simd_span(str.bytes, str.len, set, 1);
 }
 
-static int32_t trim_help_rightedge(JanetByteView str, JanetByteView set) {
-    for (int32_t i = str.len - 1; i >= 0; i--)
-        if (!trim_help_checkset(set, str.bytes[i]))
-            return i + 1;
-    return 0;
+static int32_t trim_help_rightedge(JanetByteView str, const uint32_t *set) {
+    return janet_simd_rspan(str.bytes, str.len, set, 1);
 }
 
-static void trim_help_args(int32_t argc, Janet *argv, JanetByteView *str, JanetByteView *set) {
+static void trim_help_args(int32_t argc, Janet *argv, JanetByteView *str, uint32_t *set) {
     janet_arity(argc, 1, 2);
     *str = janet_getbytes(argv, 0);
     if (argc >= 2) {
-        *set = janet_getbytes(argv, 1);
+        JanetByteView setbytes = janet_getbytes(argv, 1);
+        janet_byteset_init(set, setbytes.bytes, setbytes.len);
     } else {
-        set->bytes = (const uint8_t *)(" \t\r\n\v\f");
-        set->len = 6;
+        janet_byteset_init(set, (const uint8_t *)(" \t\r\n\v\f"), 6);
     }
 }
 
@@ -603,8 +815,9 @@ JANET_CORE_FN(cfun_string_trim,
               "(string/trim str &opt set)",
               "Trim leading and trailing whitespace from a byte sequence. If the argument "
               "`set` is provided, consider only characters in `set` to be whitespace.") {
-    JanetByteView str, set;
-    trim_help_args(argc, argv, &str, &set);
+    JanetByteView str;
+    uint32_t set[8];
+    trim_help_args(argc, argv, &str, set);
     int32_t left_edge = trim_help_leftedge(str, set);
     int32_t right_edge = trim_help_rightedge(str, set);
     if (right_edge < left_edge)
@@ -616,8 +829,9 @@ JANET_CORE_FN(cfun_string_triml,
               "(string/triml str &opt set)",
               "Trim leading whitespace from a byte sequence. If the argument "
               "`set` is provided, consider only characters in `set` to be whitespace.") {
-    JanetByteView str, set;
-    trim_help_args(argc, argv, &str, &set);
+    JanetByteView str;
+    uint32_t set[8];
+    trim_help_args(argc, argv, &str, set);
     int32_t left_edge = trim_help_leftedge(str, set);
     return janet_stringv(str.bytes + left_edge, str.len - left_edge);
 }
@@ -626,8 +840,9 @@ JANET_CORE_FN(cfun_string_trimr,
               "(string/trimr str &opt set)",
               "Trim trailing whitespace from a byte sequence. If the argument "
               "`set` is provided, consider only characters in `set` to be whitespace.") {
-    JanetByteView str, set;
-    trim_help_args(argc, argv, &str, &set);
+    JanetByteView str;
+    uint32_t set[8];
+    trim_help_args(argc, argv, &str, set);
     int32_t right_edge = trim_help_rightedge(str, set);
     return janet_stringv(str.bytes, right_edge);
 }
@@ -636,6 +851,7 @@ JANET_CORE_FN(cfun_string_trimr,
 void janet_lib_string(JanetTable *env) {
     JanetRegExt string_cfuns[] = {
         JANET_CORE_REG("string/slice", cfun_string_slice),
+        JANET_CORE_REG("string/view", cfun_string_view),
         JANET_CORE_REG("keyword/slice", cfun_keyword_slice),
         JANET_CORE_REG("symbol/slice", cfun_symbol_slice),
         JANET_CORE_REG("string/repeat", cfun_string_repeat),
@@ -651,6 +867,8 @@ void janet_lib_string(JanetTable *env) {
         JANET_CORE_REG("string/replace", cfun_string_replace),
         JANET_CORE_REG("string/replace-all", cfun_string_replaceall),
         JANET_CORE_REG("string/split", cfun_string_split),
+        JANET_CORE_REG("string/find-all-parallel", cfun_string_findall_parallel),
+        JANET_CORE_REG("string/split-parallel", cfun_string_split_parallel),
         JANET_CORE_REG("string/check-set", cfun_string_checkset),
         JANET_CORE_REG("string/join", cfun_string_join),
         JANET_CORE_REG("string/format", cfun_string_format),
@@ -660,4 +878,5 @@ void janet_lib_string(JanetTable *env) {
         JANET_REG_END
     };
     janet_core_cfuns_ext(env, NULL, string_cfuns);
+    janet_register_abstract_type(&janet_bytes_view_type);
 }
@@ -48,6 +48,7 @@
 
 #include <math.h>
 #include <string.h>
+#include <float.h>
 
 /* Lookup table for getting values of characters when parsing numbers. Handles
  * digits 0-9 and a-z (and A-Z). A-Z have values of 10 to 35. */
@@ -245,6 +246,111 @@ static double convert(
            : bignat_extract(mant, exponent2);
 }
 
+/* Powers of ten that are exactly representable as doubles */
+static const double exact_pow10[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Fast path for plain base 10 numbers whose mantissa fits in 53 bits and whose
+ * exponent is small enough that the value is a single multiplication or
+ * division of two exact doubles, and so is correctly rounded. This covers
+ * almost every number found in source code and data files. Accepts a subset
+ * of what janet_scan_number_base accepts, and returns 0 for anything else so
+ * that the general path can handle it (or reject it). */
+static int scan_number_fast(const uint8_t *str, int32_t len, double *out) {
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+    /* Extended precision intermediates would round twice */
+    (void) str;
+    (void) len;
+    (void) out;
+    return 0;
+#else
+    const uint8_t *end = str + len;
+    uint64_t mant = 0;
+    int ndigits = 0;
+    int seenadigit = 0;
+    int seenpoint = 0;
+    int neg = 0;
+    int32_t ex = 0;
+    double d;
+
+    if (len <= 0 || len > INT32_MAX / 40) return 0;
+    if (*str == '-') {
+        neg = 1;
+        str++;
+    } else if (*str == '+') {
+        str++;
+    }
+
+    /* Mantissa. Radix prefixes and letters fall through to the general path. */
+    while (str < end) {
+        uint8_t c = *str;
+        if (c >= '0' && c <= '9') {
+            if (mant || c != '0') {
+                if (ndigits == 19) return 0;
+                mant = mant * 10 + (c - '0');
+                ndigits++;
+            }
+            if (seenpoint) ex--;
+            seenadigit = 1;
+        } else if (c == '.') {
+            if (seenpoint) return 0;
+            seenpoint = 1;
+        } else if (c == '_') {
+            if (!seenadigit) return 0;
+        } else if (c == 'e' || c == 'E' || c == '&') {
+            break;
+        } else {
+            return 0;
+        }
+        str++;
+    }
+    if (!seenadigit) return 0;
+
+    /* Exponent */
+    if (str < end) {
+        int eneg = 0;
+        int seenexp = 0;
+        int32_t ee = 0;
+        str++;
+        if (str < end && *str == '-') {
+            eneg = 1;
+            str++;
+        } else if (str < end && *str == '+') {
+            str++;
+        }
+        while (str < end) {
+            if (*str < '0' || *str > '9') return 0;
+            if (ee < 10000) ee = ee * 10 + (*str - '0');
+            seenexp = 1;
+            str++;
+        }
+        if (!seenexp) return 0;
+        ex += eneg ? -ee : ee;
+    }
+
+    if (mant == 0) {
+        *out = neg ? -0.0 : 0.0;
+        return 1;
+    }
+    if (mant > ((uint64_t) 1 << 53)) return 0;
+    if (ex < 0) {
+        if (ex < -22) return 0;
+        d = (double) mant / exact_pow10[-ex];
+    } else {
+        /* Move extra powers of ten into the mantissa while it stays exact */
+        for (; ex > 22; ex--) {
+            if (mant > ((uint64_t) 1 << 53) / 10) return 0;
+            mant *= 10;
+        }
+        d = (double) mant * exact_pow10[ex];
+    }
+    *out = neg ? -d : d;
+    return 1;
+#endif
+}
+
 /* Scan a real (double) from a string. If the string cannot be converted into
  * and integer, return 0. */
 int janet_scan_number_base(
@@ -259,6 +365,10 @@ int janet_scan_number_base(
     int foundexp = 0;
     int neg = 0;
     struct BigNat mant;
+
+    if ((base == 0 || base == 10) && scan_number_fast(str, len, out))
+        return 0;
+
     bignat_zero(&mant);
 
     /* Prevent some kinds of overflow bugs relating to the exponent
@@ -438,14 +548,17 @@ static int scan_uint64(
         seenadigit = 1;
         str++;
     }
-    /* Parse significant digits */
+    /* Parse significant digits. Divide once up front rather than for
+     * every digit to check for overflow. */
+    uint64_t maxaccum = UINT64_MAX / base;
     while (str < end) {
         if (*str == '_') {
             if (!seenadigit) return 0;
         } else {
             int digit = digit_lookup[*str & 0x7F];
             if (*str > 127 || digit >= base) return 0;
-            if (accum > (UINT64_MAX - digit) / base) return 0;
+            if (accum > maxaccum) return 0;
+            if (accum * base > UINT64_MAX - digit) return 0;
             accum = accum * base + digit;
             seenadigit = 1;
         }
@@ -28,11 +28,17 @@
 #include <math.h>
 #endif
 
-/* Begin creation of a struct */
-JanetKV *janet_struct_begin(int32_t count) {
-    /* Calculate capacity as power of 2 after 2 * count. */
+/* Calculate capacity as power of 2 after 2 * count. Every struct with
+ * count pairs has this capacity, which keeps equal structs laid out the same. */
+static int32_t janet_struct_calccap(int32_t count) {
     int32_t capacity = janet_tablen(2 * count);
     if (capacity < 0) capacity = janet_tablen(count + 1);
+    return capacity;
+}
+
+/* Begin creation of a struct */
+JanetKV *janet_struct_begin(int32_t count) {
+    int32_t capacity = janet_struct_calccap(count);
 
     size_t size = sizeof(JanetStructHead) + (size_t) capacity * sizeof(JanetKV);
     JanetStructHead *head = janet_gcalloc(JANET_MEMORY_STRUCT, size);
@@ -61,24 +67,19 @@ const JanetKV *janet_struct_find(const JanetKV *st, Janet key) {
     return NULL;
 }
 
-/* Put a kv pair into a struct that has not yet been fully constructed.
- * Nil keys and values are ignored, extra keys are ignore, and duplicate keys are
- * ignored.
+/* Insert a kv pair into the buckets of a struct with robinhood hashing.
+ * Returns 1 if the key was new and filled an empty slot. Otherwise returns 0
+ * and stores the previous value in *old, replacing it if replace is set.
  *
  * Runs will be in sorted order, as the collisions resolver essentially
  * preforms an in-place insertion sort. This ensures the internal structure of the
  * hash map is independent of insertion order.
  */
-void janet_struct_put_ext(JanetKV *st, Janet key, Janet value, int replace) {
-    int32_t cap = janet_struct_capacity(st);
+static int janet_struct_insert(JanetKV *st, int32_t cap, Janet key, Janet value, int replace, Janet *old) {
     int32_t hash = janet_hash(key);
     int32_t index = janet_maphash(cap, hash);
     int32_t i, j, dist;
     int32_t bounds[4] = {index, cap, 0, index};
-    if (janet_checktype(key, JANET_NIL) || janet_checktype(value, JANET_NIL)) return;
-    if (janet_checktype(key, JANET_NUMBER) && isnan(janet_unwrap_number(key))) return;
-    /* Avoid extra items */
-    if (janet_struct_hash(st) == janet_struct_length(st)) return;
     for (dist = 0, j = 0; j < 4; j += 2)
         for (i = bounds[j]; i < bounds[j + 1]; i++, dist++) {
             int status;
@@ -89,9 +90,7 @@ void janet_struct_put_ext(JanetKV *st, Janet key, Janet value, int replace) {
             if (janet_checktype(kv->key, JANET_NIL)) {
                 kv->key = key;
                 kv->value = value;
-                /* Update the temporary count */
-                janet_struct_hash(st)++;
-                return;
+                return 1;
             }
             /* Robinhood hashing - check if colliding kv pair
              * is closer to their source than current. We use robinhood
@@ -124,13 +123,30 @@ void janet_struct_put_ext(JanetKV *st, Janet key, Janet value, int replace) {
                 dist = otherdist;
                 hash = otherhash;
             } else if (status == 0) {
+                *old = kv->value;
                 if (replace) {
                     /* A key was added to the struct more than once - replace old value */
                     kv->value = value;
                 }
-                return;
+                return 0;
             }
         }
+    return 0;
+}
+
+/* Put a kv pair into a struct that has not yet been fully constructed.
+ * Nil keys and values are ignored, extra keys are ignore, and duplicate keys are
+ * ignored. */
+void janet_struct_put_ext(JanetKV *st, Janet key, Janet value, int replace) {
+    Janet old;
+    if (janet_checktype(key, JANET_NIL) || janet_checktype(value, JANET_NIL)) return;
+    if (janet_checktype(key, JANET_NUMBER) && isnan(janet_unwrap_number(key))) return;
+    /* Avoid extra items */
+    if (janet_struct_hash(st) == janet_struct_length(st)) return;
+    if (janet_struct_insert(st, janet_struct_capacity(st), key, value, replace, &old)) {
+        /* Update the temporary count */
+        janet_struct_hash(st)++;
+    }
 }
 
 void janet_struct_put(JanetKV *st, Janet key, Janet value) {
@@ -202,6 +218,140 @@ JanetTable *janet_struct_to_table(const JanetKV *st) {
     return table;
 }
 
+/* Struct builders. A builder keeps its pairs in malloc'd memory that is
+ * already laid out as a struct of the current size, and keeps the struct
+ * hash up to date on every put. Storage doubles on the same schedule as
+ * janet_struct_calccap, so freezing just hands the memory to the garbage
+ * collector. */
+
+typedef struct {
+    JanetStructHead *head;
+    int32_t count;
+    uint64_t hash;
+} JanetStructBuilder;
+
+static size_t janet_struct_size(int32_t capacity) {
+    return sizeof(JanetStructHead) + (size_t) capacity * sizeof(JanetKV);
+}
+
+static JanetStructHead *struct_builder_alloc(int32_t capacity) {
+    JanetStructHead *head = janet_malloc(janet_struct_size(capacity));
+    if (NULL == head) {
+        JANET_OUT_OF_MEMORY;
+    }
+    head->length = 0;
+    head->hash = 0;
+    head->capacity = capacity;
+    head->proto = NULL;
+    janet_memempty((JanetKV *) head->data, capacity);
+    return head;
+}
+
+static void struct_builder_reset(JanetStructBuilder *b) {
+    b->head = NULL;
+    b->count = 0;
+    b->hash = JANET_KV_HASH_INIT;
+}
+
+/* Re-lay out the pairs of a builder for a new capacity */
+static void struct_builder_rehash(JanetStructBuilder *b, int32_t capacity) {
+    JanetStructHead *head = struct_builder_alloc(capacity);
+    if (NULL != b->head) {
+        JanetKV *st = (JanetKV *) b->head->data;
+        for (int32_t i = 0; i < b->head->capacity; i++) {
+            Janet old;
+            if (!janet_checktype(st[i].key, JANET_NIL)) {
+                janet_struct_insert((JanetKV *) head->data, capacity, st[i].key, st[i].value, 1, &old);
+            }
+        }
+        janet_free(b->head);
+    }
+    b->head = head;
+}
+
+static void struct_builder_put(JanetStructBuilder *b, Janet key, Janet value) {
+    Janet old;
+    if (janet_checktype(key, JANET_NIL) || janet_checktype(value, JANET_NIL)) return;
+    if (janet_checktype(key, JANET_NUMBER) && isnan(janet_unwrap_number(key))) return;
+    if (b->count >= INT32_MAX / 2) janet_panic("struct too large");
+    int32_t capacity = janet_struct_calccap(b->count + 1);
+    if (NULL == b->head || capacity != b->head->capacity) {
+        /* Only grow if the key is new */
+        const JanetKV *kv = NULL == b->head ? NULL : janet_struct_find((JanetKV *) b->head->data, key);
+        if (NULL == kv || janet_checktype(kv->key, JANET_NIL)) {
+            struct_builder_rehash(b, capacity);
+        }
+    }
+    JanetKV *st = (JanetKV *) b->head->data;
+    if (janet_struct_insert(st, b->head->capacity, key, value, 1, &old)) {
+        b->count++;
+    } else {
+        b->hash -= janet_kv_hashpair(key, old);
+    }
+    b->hash += janet_kv_hashpair(key, value);
+}
+
+static JanetStruct struct_builder_freeze(JanetStructBuilder *b) {
+    if (NULL == b->head) {
+        return janet_struct_end(janet_struct_begin(0));
+    }
+    JanetStructHead *head = b->head;
+    head->length = b->count;
+    head->hash = janet_hash_fold(b->hash);
+    janet_gcadopt(JANET_MEMORY_STRUCT, head, janet_struct_size(head->capacity));
+    struct_builder_reset(b);
+    return (JanetStruct) head->data;
+}
+
+static int struct_builder_gc(void *p, size_t size) {
+    (void) size;
+    JanetStructBuilder *b = (JanetStructBuilder *) p;
+    janet_free(b->head);
+    return 0;
+}
+
+static int struct_builder_mark(void *p, size_t size) {
+    (void) size;
+    JanetStructBuilder *b = (JanetStructBuilder *) p;
+    if (NULL != b->head) {
+        JanetKV *st = (JanetKV *) b->head->data;
+        for (int32_t i = 0; i < b->head->capacity; i++) {
+            janet_mark(st[i].key);
+            janet_mark(st[i].value);
+        }
+    }
+    return 0;
+}
+
+static int struct_builder_get(void *p, Janet key, Janet *out);
+static Janet struct_builder_next(void *p, Janet key);
+
+static void struct_builder_putter(void *p, Janet key, Janet value) {
+    struct_builder_put((JanetStructBuilder *) p, key, value);
+}
+
+static size_t struct_builder_length(void *p, size_t size) {
+    (void) size;
+    return (size_t)((JanetStructBuilder *) p)->count;
+}
+
+const JanetAbstractType janet_struct_builder_type = {
+    "core/struct-builder",
+    struct_builder_gc,
+    struct_builder_mark,
+    struct_builder_get,
+    struct_builder_putter,
+    NULL, /* marshal */
+    NULL, /* unmarshal */
+    NULL, /* tostring */
+    NULL, /* compare */
+    NULL, /* hash */
+    struct_builder_next,
+    NULL, /* call */
+    struct_builder_length,
+    JANET_ATEND_LENGTH
+};
+
 /* C Functions */
 
 JANET_CORE_FN(cfun_struct_with_proto,
@@ -294,6 +444,62 @@ JANET_CORE_FN(cfun_struct_to_table,
     return janet_wrap_table(tab);
 }
 
+JANET_CORE_FN(cfun_struct_builder,
+              "(struct/builder & kvs)",
+              "Create a struct builder, optionally starting with the key value pairs kvs. "
+              "Pairs are added with `put` or `struct/builder-put`, and `struct/freeze` "
+              "turns the builder into a struct without copying. Use a builder to "
+              "make a large struct one pair at a time.") {
+    if (argc & 1)
+        janet_panic("expected even number of arguments");
+    JanetStructBuilder *b = janet_abstract(&janet_struct_builder_type, sizeof(JanetStructBuilder));
+    struct_builder_reset(b);
+    for (int32_t i = 0; i < argc; i += 2) {
+        struct_builder_put(b, argv[i], argv[i + 1]);
+    }
+    return janet_wrap_abstract(b);
+}
+
+JANET_CORE_FN(cfun_struct_builder_put,
+              "(struct/builder-put builder & kvs)",
+              "Add key value pairs to a struct builder, replacing the values of keys "
+              "already in it. Nil keys and values are ignored, as in `struct`. Returns the builder.") {
+    janet_arity(argc, 1, -1);
+    JanetStructBuilder *b = janet_getabstract(argv, 0, &janet_struct_builder_type);
+    if (!(argc & 1))
+        janet_panic("expected odd number of arguments");
+    for (int32_t i = 1; i < argc; i += 2) {
+        struct_builder_put(b, argv[i], argv[i + 1]);
+    }
+    return argv[0];
+}
+
+JANET_CORE_FN(cfun_struct_freeze,
+              "(struct/freeze builder)",
+              "Return a struct of all pairs put into a struct builder. The builder's "
+              "memory becomes the struct, and the builder is left empty.") {
+    janet_fixarity(argc, 1);
+    JanetStructBuilder *b = janet_getabstract(argv, 0, &janet_struct_builder_type);
+    return janet_wrap_struct(struct_builder_freeze(b));
+}
+
+static const JanetMethod struct_builder_methods[] = {
+    {"put", cfun_struct_builder_put},
+    {"freeze", cfun_struct_freeze},
+    {NULL, NULL}
+};
+
+static int struct_builder_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD)) return 0;
+    return janet_getmethod(janet_unwrap_keyword(key), struct_builder_methods, out);
+}
+
+static Janet struct_builder_next(void *p, Janet key) {
+    (void) p;
+    return janet_nextmethod(struct_builder_methods, key);
+}
+
 /* Load the struct module */
 void janet_lib_struct(JanetTable *env) {
     JanetRegExt struct_cfuns[] = {
@@ -301,6 +507,9 @@ void janet_lib_struct(JanetTable *env) {
         JANET_CORE_REG("struct/getproto", cfun_struct_getproto),
         JANET_CORE_REG("struct/proto-flatten", cfun_struct_flatten),
         JANET_CORE_REG("struct/to-table", cfun_struct_to_table),
+        JANET_CORE_REG("struct/builder", cfun_struct_builder),
+        JANET_CORE_REG("struct/builder-put", cfun_struct_builder_put),
+        JANET_CORE_REG("struct/freeze", cfun_struct_freeze),
         JANET_REG_END
     };
     janet_core_cfuns_ext(env, NULL, struct_cfuns);
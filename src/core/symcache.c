@@ -168,14 +168,151 @@ void janet_symbol_deinit(const uint8_t *sym) {
     }
 }
 
+#ifdef JANET_EV
+
+/* Shared symbols. Once enabled, symbols and keywords are interned in a
+ * process wide table as well as in the cache of each VM, so the same
+ * symbol is a single pointer in every thread and can be passed between
+ * threads without copying it. Shared symbols live outside of any heap and
+ * are never freed. Lookups do not take locks; a VM only goes to the shared
+ * table when its own cache misses, and takes a lock to add a symbol. Tables
+ * that have been grown out of are kept, as other threads may still be
+ * reading them. */
+
+typedef struct JanetSymbolTable JanetSymbolTable;
+struct JanetSymbolTable {
+    JanetSymbolTable *retired;
+    uint32_t capacity;
+    uint32_t count;
+    const uint8_t *slots[];
+};
+
+static JanetSymbolTable *janet_shared_symbols = NULL;
+static JanetOSMutex *janet_shared_symbols_lock = NULL;
+
+static JanetSymbolTable *janet_symtab_new(uint32_t capacity) {
+    JanetSymbolTable *tab = janet_calloc(1, sizeof(JanetSymbolTable) + capacity * sizeof(const uint8_t *));
+    if (NULL == tab) {
+        JANET_OUT_OF_MEMORY;
+    }
+    tab->capacity = capacity;
+    return tab;
+}
+
+static const uint8_t *janet_symtab_find(JanetSymbolTable *tab, const uint8_t *str, int32_t len, int32_t hash) {
+    uint32_t mask = tab->capacity - 1;
+    for (uint32_t i = (uint32_t) hash & mask;; i = (i + 1) & mask) {
+        const uint8_t *test = janet_atomic_load_ptr((void **) &tab->slots[i]);
+        if (NULL == test) return NULL;
+        if (janet_string_equalconst(test, str, len, hash)) return test;
+    }
+}
+
+static void janet_symtab_insert(JanetSymbolTable *tab, const uint8_t *sym) {
+    uint32_t mask = tab->capacity - 1;
+    uint32_t i = (uint32_t) janet_string_hash(sym) & mask;
+    while (!janet_atomic_cas_ptr((void **) &tab->slots[i], NULL, (void *) sym)) {
+        i = (i + 1) & mask;
+    }
+    tab->count++;
+}
+
+/* Turn on shared symbols for the whole process. Returns whether they were on already. */
+int janet_share_symbols(void) {
+    if (NULL != janet_atomic_load_ptr((void **) &janet_shared_symbols)) return 1;
+    if (NULL == janet_atomic_load_ptr((void **) &janet_shared_symbols_lock)) {
+        JanetOSMutex *lock = janet_malloc(janet_os_mutex_size());
+        if (NULL == lock) {
+            JANET_OUT_OF_MEMORY;
+        }
+        janet_os_mutex_init(lock);
+        if (!janet_atomic_cas_ptr((void **) &janet_shared_symbols_lock, NULL, lock)) {
+            janet_os_mutex_deinit(lock);
+            janet_free(lock);
+        }
+    }
+    JanetSymbolTable *tab = janet_symtab_new(1024);
+    if (!janet_atomic_cas_ptr((void **) &janet_shared_symbols, NULL, tab)) {
+        janet_free(tab);
+        return 1;
+    }
+    return 0;
+}
+
+int janet_symbol_is_shared(const uint8_t *sym) {
+    return (janet_string_head(sym)->gc.flags & JANET_MEM_TYPEBITS) == JANET_MEMORY_SHARED_SYMBOL;
+}
+
+/* Find or make a shared symbol */
+static const uint8_t *janet_shared_symbol(JanetSymbolTable *tab, const uint8_t *str, int32_t len, int32_t hash) {
+    const uint8_t *sym = janet_symtab_find(tab, str, len, hash);
+    if (NULL != sym) return sym;
+    janet_os_mutex_lock(janet_shared_symbols_lock);
+    tab = janet_shared_symbols;
+    sym = janet_symtab_find(tab, str, len, hash);
+    if (NULL == sym) {
+        if ((tab->count + 1) * 2 > tab->capacity) {
+            JanetSymbolTable *bigger = janet_symtab_new(tab->capacity * 2);
+            for (uint32_t i = 0; i < tab->capacity; i++) {
+                if (NULL != tab->slots[i]) janet_symtab_insert(bigger, tab->slots[i]);
+            }
+            bigger->retired = tab;
+            janet_atomic_cas_ptr((void **) &janet_shared_symbols, tab, bigger);
+            tab = bigger;
+        }
+        JanetStringHead *head = janet_malloc(sizeof(JanetStringHead) + (size_t) len + 1);
+        if (NULL == head) {
+            JANET_OUT_OF_MEMORY;
+        }
+        /* Always reachable, so collectors never write to the header */
+        head->gc.flags = JANET_MEMORY_SHARED_SYMBOL | JANET_MEM_REACHABLE;
+        head->gc.data.next = NULL;
+        head->length = len;
+        head->hash = hash;
+        uint8_t *data = (uint8_t *) head->data;
+        safe_memcpy(data, str, len);
+        data[len] = 0;
+        sym = data;
+        janet_symtab_insert(tab, sym);
+    }
+    janet_os_mutex_unlock(janet_shared_symbols_lock);
+    return sym;
+}
+
+/* Get the symbol this VM uses for a shared symbol from another thread. Symbols
+ * interned before sharing was turned on keep their old copy. */
+const uint8_t *janet_symbol_adopt(const uint8_t *sym) {
+    int success = 0;
+    const uint8_t **bucket = janet_symcache_find(sym, &success);
+    if (success) return *bucket;
+    janet_symcache_put(sym, bucket);
+    return sym;
+}
+
+#endif
+
 /* Create a symbol from a byte string */
 const uint8_t *janet_symbol(const uint8_t *str, int32_t len) {
     int32_t hash = janet_string_calchash(str, len);
     uint8_t *newstr;
     int success = 0;
     const uint8_t **bucket = janet_symcache_findmem(str, len, hash, &success);
-    if (success)
+    if (success) {
+        /* The cache holds symbols weakly - during an incremental sweep, make sure an
+         * unreachable symbol that has not been swept yet survives */
+        if (NULL != janet_vm.sweep_blocks && !janet_gc_reachable(janet_string_head(*bucket))) {
+            janet_gc_mark(janet_string_head(*bucket));
+        }
         return *bucket;
+    }
+#ifdef JANET_EV
+    JanetSymbolTable *shared = janet_atomic_load_ptr((void **) &janet_shared_symbols);
+    if (NULL != shared) {
+        newstr = (uint8_t *) janet_shared_symbol(shared, str, len, hash);
+        janet_symcache_put(newstr, bucket);
+        return newstr;
+    }
+#endif
     JanetStringHead *head = janet_gcalloc(JANET_MEMORY_SYMBOL, sizeof(JanetStringHead) + (size_t) len + 1);
     head->hash = hash;
     head->length = len;
@@ -25,37 +25,67 @@
 #include <janet.h>
 #include "gc.h"
 #include "util.h"
+#include "simd.h"
 #include <math.h>
 #endif
 
+#include <string.h>
+
 #define JANET_TABLE_FLAG_STACK 0x10000
 
-static void *janet_memalloc_empty_local(int32_t count) {
-    int32_t i;
-    void *mem = janet_smalloc((size_t) count * sizeof(JanetKV));
-    JanetKV *mmem = (JanetKV *)mem;
-    for (i = 0; i < count; i++) {
-        JanetKV *kv = mmem + i;
-        kv->key = janet_wrap_nil();
-        kv->value = janet_wrap_nil();
+/* Give a table a new version after it changes, so that inline caches
+ * in the interpreter are invalidated. Versions are unique across tables, so
+ * a table allocated where a collected table was never looks unchanged. */
+#define janet_table_touch(t) do { \
+    if ((t)->gc.flags & JANET_TABLE_FLAG_VERSIONED) \
+        janet_table_version(t) = ++janet_vm.table_version; \
+    if ((t)->gc.flags & JANET_TABLE_FLAG_PROTO) janet_vm.proto_epoch++; \
+} while (0)
+
+/* Control bytes. The buckets of a table are followed by one control byte per
+ * bucket, and then by copies of the first JANET_TABLE_CTRL_PAD control bytes so
+ * that a group of 16 can be loaded at any bucket. A control byte is empty,
+ * deleted, or the top 7 bits of the hash of the key in the bucket. Lookups
+ * compare a whole group of control bytes at once and only compare keys where
+ * the hash bits match. Buckets are probed in the same order as janet_dict_find,
+ * and buckets keep the same empty (nil, nil) and deleted (nil, false) markers. */
+#define JANET_CTRL_EMPTY 0x80
+#define JANET_CTRL_DELETED 0xFE
+#define JANET_TABLE_CTRL_PAD 15
+#define janet_table_ctrl(t) ((uint8_t *)((t)->data + (t)->capacity))
+#define janet_table_h2(hash) ((uint8_t)((uint32_t)(hash) >> 25))
+#define janet_table_bytes(cap) ((size_t)(cap) * (sizeof(JanetKV) + 1) + JANET_TABLE_CTRL_PAD)
+
+static JanetKV *janet_table_alloc(int32_t capacity, int islocal) {
+    size_t size = janet_table_bytes(capacity);
+    JanetKV *data;
+    if (islocal) {
+        data = janet_smalloc(size);
+    } else {
+        data = janet_malloc(size);
+        if (NULL == data) {
+            JANET_OUT_OF_MEMORY;
+        }
+        janet_vm.next_collection += size;
     }
-    return mem;
+    janet_memempty(data, capacity);
+    memset(data + capacity, JANET_CTRL_EMPTY, (size_t) capacity + JANET_TABLE_CTRL_PAD);
+    return data;
+}
+
+static void janet_table_setctrl(JanetTable *t, const JanetKV *bucket, uint8_t c) {
+    uint8_t *ctrl = janet_table_ctrl(t);
+    int32_t i = (int32_t)(bucket - t->data);
+    ctrl[i] = c;
+    if (i < JANET_TABLE_CTRL_PAD) ctrl[t->capacity + i] = c;
 }
 
 static JanetTable *janet_table_init_impl(JanetTable *table, int32_t capacity, int stackalloc) {
-    JanetKV *data;
     capacity = janet_tablen(capacity);
     if (stackalloc) table->gc.flags = JANET_TABLE_FLAG_STACK;
+    table->gc.flags &= ~JANET_TABLE_FLAG_VERSIONED;
     if (capacity) {
-        if (stackalloc) {
-            data = janet_memalloc_empty_local(capacity);
-        } else {
-            data = (JanetKV *) janet_memalloc_empty(capacity);
-            if (NULL == data) {
-                JANET_OUT_OF_MEMORY;
-            }
-        }
-        table->data = data;
+        table->data = janet_table_alloc(capacity, stackalloc);
         table->capacity = capacity;
     } else {
         table->data = NULL;
@@ -88,29 +118,81 @@ void janet_table_deinit(JanetTable *table) {
 
 /* Create a new table */
 JanetTable *janet_table(int32_t capacity) {
-    JanetTable *table = janet_gcalloc(JANET_MEMORY_TABLE, sizeof(JanetTable));
-    return janet_table_init_impl(table, capacity, 0);
+    JanetTable *table = janet_gcalloc(JANET_MEMORY_TABLE, sizeof(JanetVersionedTable));
+    janet_table_init_impl(table, capacity, 0);
+    table->gc.flags |= JANET_TABLE_FLAG_VERSIONED;
+    janet_table_version(table) = ++janet_vm.table_version;
+    return table;
+}
+
+/* Create a new table that does not keep its keys alive */
+JanetTable *janet_table_weakk(int32_t capacity) {
+    JanetTable *table = janet_table(capacity);
+    table->gc.flags |= JANET_TABLE_FLAG_WEAK_KEYS;
+    return table;
+}
+
+/* Create a new table that does not keep its values alive */
+JanetTable *janet_table_weakv(int32_t capacity) {
+    JanetTable *table = janet_table(capacity);
+    table->gc.flags |= JANET_TABLE_FLAG_WEAK_VALUES;
+    return table;
+}
+
+/* Create a new table that keeps neither its keys nor its values alive */
+JanetTable *janet_table_weakkv(int32_t capacity) {
+    JanetTable *table = janet_table(capacity);
+    table->gc.flags |= JANET_TABLE_FLAG_WEAK_KEYS | JANET_TABLE_FLAG_WEAK_VALUES;
+    return table;
 }
 
 /* Find the bucket that contains the given key. Will also return
  * bucket where key should go if not in the table. */
 JanetKV *janet_table_find(JanetTable *t, Janet key) {
+#ifdef JANET_SIMD_GROUP
+    int32_t cap = t->capacity;
+    if (cap == 0) return NULL;
+    int32_t hash = janet_hash(key);
+    int32_t index = janet_maphash(cap, hash);
+    uint8_t h2 = janet_table_h2(hash);
+    const uint8_t *ctrl = janet_table_ctrl(t);
+    JanetKV *first_bucket = NULL;
+    for (int32_t scanned = 0; scanned < cap; scanned += 16) {
+        int32_t pos = (index + scanned) & (cap - 1);
+        JanetGroupMask prefix = janet_simd_group_prefix(cap - scanned);
+        JanetGroupMask match = janet_simd_group_match(ctrl + pos, h2) & prefix;
+        JanetGroupMask empty = janet_simd_group_match(ctrl + pos, JANET_CTRL_EMPTY) & prefix;
+        JanetGroupMask deleted = janet_simd_group_match(ctrl + pos, JANET_CTRL_DELETED) & prefix;
+        if (empty) {
+            /* Only buckets before the first empty one are on the probe path */
+            JanetGroupMask before = (empty & (~empty + 1)) - 1;
+            match &= before;
+            deleted &= before;
+        }
+        while (match) {
+            JanetKV *kv = t->data + ((pos + janet_simd_group_first(match)) & (cap - 1));
+            if (janet_equals(kv->key, key)) return kv;
+            match &= match - 1;
+        }
+        if (NULL == first_bucket && deleted) {
+            first_bucket = t->data + ((pos + janet_simd_group_first(deleted)) & (cap - 1));
+        }
+        if (empty) {
+            return first_bucket ? first_bucket
+                   : t->data + ((pos + janet_simd_group_first(empty)) & (cap - 1));
+        }
+    }
+    return first_bucket;
+#else
     return (JanetKV *) janet_dict_find(t->data, t->capacity, key);
+#endif
 }
 
 /* Resize the dictionary table. */
 static void janet_table_rehash(JanetTable *t, int32_t size) {
     JanetKV *olddata = t->data;
-    JanetKV *newdata;
     int islocal = t->gc.flags & JANET_TABLE_FLAG_STACK;
-    if (islocal) {
-        newdata = (JanetKV *) janet_memalloc_empty_local(size);
-    } else {
-        newdata = (JanetKV *) janet_memalloc_empty(size);
-        if (NULL == newdata) {
-            JANET_OUT_OF_MEMORY;
-        }
-    }
+    JanetKV *newdata = janet_table_alloc(size, islocal);
     int32_t i, oldcapacity;
     oldcapacity = t->capacity;
     t->data = newdata;
@@ -121,6 +203,7 @@ static void janet_table_rehash(JanetTable *t, int32_t size) {
         if (!janet_checktype(kv->key, JANET_NIL)) {
             JanetKV *newkv = janet_table_find(t, kv->key);
             *newkv = *kv;
+            janet_table_setctrl(t, newkv, janet_table_h2(janet_hash(kv->key)));
         }
     }
     if (islocal) {
@@ -167,16 +250,47 @@ Janet janet_table_remove(JanetTable *t, Janet key) {
     JanetKV *bucket = janet_table_find(t, key);
     if (NULL != bucket && !janet_checktype(bucket->key, JANET_NIL)) {
         Janet ret = bucket->value;
+        janet_table_touch(t);
         t->count--;
-        t->deleted++;
         bucket->key = janet_wrap_nil();
-        bucket->value = janet_wrap_false();
+        int32_t mask = t->capacity - 1;
+        int32_t i = (int32_t)(bucket - t->data);
+        if (janet_checktype(t->data[(i + 1) & mask].key, JANET_NIL) &&
+                janet_checktype(t->data[(i + 1) & mask].value, JANET_NIL)) {
+            /* Probes that reach this bucket stop at the next one anyways, so it
+             * can be empty instead of deleted, and so can deleted buckets
+             * right before it. */
+            bucket->value = janet_wrap_nil();
+            janet_table_setctrl(t, bucket, JANET_CTRL_EMPTY);
+            for (int32_t n = t->capacity - 1; n > 0; n--) {
+                i = (i - 1) & mask;
+                JanetKV *kv = t->data + i;
+                if (!janet_checktype(kv->key, JANET_NIL) || !janet_checktype(kv->value, JANET_BOOLEAN)) break;
+                kv->value = janet_wrap_nil();
+                janet_table_setctrl(t, kv, JANET_CTRL_EMPTY);
+                t->deleted--;
+            }
+        } else {
+            t->deleted++;
+            bucket->value = janet_wrap_false();
+            janet_table_setctrl(t, bucket, JANET_CTRL_DELETED);
+        }
         return ret;
     } else {
         return janet_wrap_nil();
     }
 }
 
+/* Put a new key in an empty or deleted bucket */
+static void janet_table_fill(JanetTable *t, JanetKV *bucket, Janet key, Janet value) {
+    if (janet_checktype(bucket->value, JANET_BOOLEAN))
+        --t->deleted;
+    bucket->key = key;
+    bucket->value = value;
+    janet_table_setctrl(t, bucket, janet_table_h2(janet_hash(key)));
+    ++t->count;
+}
+
 /* Put a value into the object */
 void janet_table_put(JanetTable *t, Janet key, Janet value) {
     if (janet_checktype(key, JANET_NIL)) return;
@@ -185,18 +299,14 @@ void janet_table_put(JanetTable *t, Janet key, Janet value) {
         janet_table_remove(t, key);
     } else {
         JanetKV *bucket = janet_table_find(t, key);
+        janet_table_touch(t);
         if (NULL != bucket && !janet_checktype(bucket->key, JANET_NIL)) {
             bucket->value = value;
         } else {
             if (NULL == bucket || 2 * (t->count + t->deleted + 1) > t->capacity) {
                 janet_table_rehash(t, janet_tablen(2 * t->count + 2));
             }
-            bucket = janet_table_find(t, key);
-            if (janet_checktype(bucket->value, JANET_BOOLEAN))
-                --t->deleted;
-            bucket->key = key;
-            bucket->value = value;
-            ++t->count;
+            janet_table_fill(t, janet_table_find(t, key), key, value);
         }
     }
 }
@@ -207,15 +317,11 @@ static void janet_table_put_no_overwrite(JanetTable *t, Janet key, Janet value)
     JanetKV *bucket = janet_table_find(t, key);
     if (NULL != bucket && !janet_checktype(bucket->key, JANET_NIL))
         return;
+    janet_table_touch(t);
     if (NULL == bucket || 2 * (t->count + t->deleted + 1) > t->capacity) {
         janet_table_rehash(t, janet_tablen(2 * t->count + 2));
     }
-    bucket = janet_table_find(t, key);
-    if (janet_checktype(bucket->value, JANET_BOOLEAN))
-        --t->deleted;
-    bucket->key = key;
-    bucket->value = value;
-    ++t->count;
+    janet_table_fill(t, janet_table_find(t, key), key, value);
 }
 
 /* Clear a table */
@@ -223,22 +329,31 @@ void janet_table_clear(JanetTable *t) {
     int32_t capacity = t->capacity;
     JanetKV *data = t->data;
     janet_memempty(data, capacity);
+    if (capacity) memset(data + capacity, JANET_CTRL_EMPTY, (size_t) capacity + JANET_TABLE_CTRL_PAD);
+    janet_table_touch(t);
     t->count = 0;
     t->deleted = 0;
 }
 
 /* Clone a table. */
 JanetTable *janet_table_clone(JanetTable *table) {
-    JanetTable *newTable = janet_gcalloc(JANET_MEMORY_TABLE, sizeof(JanetTable));
+    JanetTable *newTable = janet_gcalloc(JANET_MEMORY_TABLE, sizeof(JanetVersionedTable));
+    newTable->gc.flags |= JANET_TABLE_FLAG_VERSIONED;
+    newTable->gc.flags |= table->gc.flags & (JANET_TABLE_FLAG_WEAK_KEYS | JANET_TABLE_FLAG_WEAK_VALUES);
     newTable->count = table->count;
     newTable->capacity = table->capacity;
     newTable->deleted = table->deleted;
     newTable->proto = table->proto;
-    newTable->data = janet_malloc(newTable->capacity * sizeof(JanetKV));
-    if (NULL == newTable->data) {
-        JANET_OUT_OF_MEMORY;
+    janet_table_version(newTable) = ++janet_vm.table_version;
+    if (table->capacity) {
+        newTable->data = janet_malloc(janet_table_bytes(table->capacity));
+        if (NULL == newTable->data) {
+            JANET_OUT_OF_MEMORY;
+        }
+        memcpy(newTable->data, table->data, janet_table_bytes(table->capacity));
+    } else {
+        newTable->data = NULL;
     }
-    memcpy(newTable->data, table->data, (size_t) table->capacity * sizeof(JanetKV));
     return newTable;
 }
 
@@ -291,6 +406,179 @@ JanetTable *janet_table_proto_flatten(JanetTable *t) {
     return newTable;
 }
 
+/*
+ * Bounded LRU cache. Entries live in a doubly linked list of nodes, most
+ * recently used first, and an index table maps keys to nodes, so lookups,
+ * inserts and evictions are all constant time. Nodes are kept in one array
+ * that grows up to the capacity of the cache and are reused after eviction.
+ */
+
+typedef struct {
+    Janet key;
+    Janet value;
+    int32_t prev;
+    int32_t next;
+} JanetLRUNode;
+
+typedef struct {
+    JanetTable index; /* Maps keys to node indices */
+    JanetLRUNode *nodes;
+    int32_t node_capacity;
+    int32_t node_count;
+    int32_t capacity;
+    int32_t head; /* Most recently used, -1 if empty */
+    int32_t tail; /* Least recently used, the next to be evicted */
+    int32_t free; /* List of unused nodes through next */
+} JanetLRU;
+
+static int janet_lru_gc(void *p, size_t len) {
+    (void) len;
+    JanetLRU *lru = (JanetLRU *) p;
+    janet_table_deinit(&lru->index);
+    janet_free(lru->nodes);
+    return 0;
+}
+
+static int janet_lru_mark(void *p, size_t len) {
+    (void) len;
+    JanetLRU *lru = (JanetLRU *) p;
+    for (int32_t i = lru->head; i >= 0; i = lru->nodes[i].next) {
+        janet_mark(lru->nodes[i].key);
+        janet_mark(lru->nodes[i].value);
+    }
+    return 0;
+}
+
+static void janet_lru_unlink(JanetLRU *lru, int32_t i) {
+    JanetLRUNode *node = lru->nodes + i;
+    if (node->prev >= 0) lru->nodes[node->prev].next = node->next;
+    else lru->head = node->next;
+    if (node->next >= 0) lru->nodes[node->next].prev = node->prev;
+    else lru->tail = node->prev;
+}
+
+static void janet_lru_push_front(JanetLRU *lru, int32_t i) {
+    JanetLRUNode *node = lru->nodes + i;
+    node->prev = -1;
+    node->next = lru->head;
+    if (lru->head >= 0) lru->nodes[lru->head].prev = i;
+    else lru->tail = i;
+    lru->head = i;
+}
+
+static int32_t janet_lru_lookup(JanetLRU *lru, Janet key) {
+    Janet index = janet_table_rawget(&lru->index, key);
+    return janet_checktype(index, JANET_NUMBER) ? (int32_t) janet_unwrap_number(index) : -1;
+}
+
+static void janet_lru_remove(JanetLRU *lru, int32_t i) {
+    janet_lru_unlink(lru, i);
+    janet_table_remove(&lru->index, lru->nodes[i].key);
+    lru->nodes[i].key = janet_wrap_nil();
+    lru->nodes[i].value = janet_wrap_nil();
+    lru->nodes[i].next = lru->free;
+    lru->free = i;
+}
+
+/* Get a node for a new entry, evicting the least recently used entry if full */
+static int32_t janet_lru_alloc(JanetLRU *lru) {
+    if (lru->free < 0 && lru->node_count == lru->capacity) {
+        janet_lru_remove(lru, lru->tail);
+    }
+    if (lru->free >= 0) {
+        int32_t i = lru->free;
+        lru->free = lru->nodes[i].next;
+        return i;
+    }
+    if (lru->node_count == lru->node_capacity) {
+        int32_t newcap = lru->node_capacity ? 2 * lru->node_capacity : 8;
+        if (newcap > lru->capacity) newcap = lru->capacity;
+        JanetLRUNode *nodes = janet_realloc(lru->nodes, (size_t) newcap * sizeof(JanetLRUNode));
+        if (NULL == nodes) {
+            JANET_OUT_OF_MEMORY;
+        }
+        lru->nodes = nodes;
+        lru->node_capacity = newcap;
+    }
+    return lru->node_count++;
+}
+
+static int janet_lru_get(void *p, Janet key, Janet *out) {
+    JanetLRU *lru = (JanetLRU *) p;
+    int32_t i = janet_lru_lookup(lru, key);
+    if (i < 0) return 0;
+    if (i != lru->head) {
+        janet_lru_unlink(lru, i);
+        janet_lru_push_front(lru, i);
+    }
+    *out = lru->nodes[i].value;
+    return 1;
+}
+
+static void janet_lru_put(void *p, Janet key, Janet value) {
+    JanetLRU *lru = (JanetLRU *) p;
+    if (janet_checktype(key, JANET_NIL)) return;
+    if (janet_checktype(key, JANET_NUMBER) && isnan(janet_unwrap_number(key))) return;
+    int32_t i = janet_lru_lookup(lru, key);
+    if (janet_checktype(value, JANET_NIL)) {
+        if (i >= 0) janet_lru_remove(lru, i);
+        return;
+    }
+    if (i >= 0) {
+        janet_lru_unlink(lru, i);
+    } else {
+        i = janet_lru_alloc(lru);
+        lru->nodes[i].key = key;
+        janet_table_put(&lru->index, key, janet_wrap_integer(i));
+    }
+    lru->nodes[i].value = value;
+    janet_lru_push_front(lru, i);
+}
+
+/* Iterate in node order rather than recency order, since getting the
+ * entries while iterating changes their recency. */
+static Janet janet_lru_next(void *p, Janet key) {
+    JanetLRU *lru = (JanetLRU *) p;
+    int32_t i = 0;
+    if (!janet_checktype(key, JANET_NIL)) {
+        i = janet_lru_lookup(lru, key);
+        if (i < 0) janet_panicf("key %v not in lru cache", key);
+        i++;
+    }
+    for (; i < lru->node_count; i++) {
+        if (!janet_checktype(lru->nodes[i].key, JANET_NIL)) return lru->nodes[i].key;
+    }
+    return janet_wrap_nil();
+}
+
+static size_t janet_lru_length(void *p, size_t len) {
+    (void) len;
+    JanetLRU *lru = (JanetLRU *) p;
+    return (size_t) lru->index.count;
+}
+
+static void janet_lru_tostring(void *p, JanetBuffer *buffer) {
+    JanetLRU *lru = (JanetLRU *) p;
+    janet_formatb(buffer, "%d/%d", lru->index.count, lru->capacity);
+}
+
+static const JanetAbstractType janet_lru_type = {
+    "core/lru",
+    janet_lru_gc,
+    janet_lru_mark,
+    janet_lru_get,
+    janet_lru_put,
+    NULL, /* marshal */
+    NULL, /* unmarshal */
+    janet_lru_tostring,
+    NULL, /* compare */
+    NULL, /* hash */
+    janet_lru_next,
+    NULL, /* call */
+    janet_lru_length,
+    JANET_ATEND_LENGTH
+};
+
 /* C Functions */
 
 JANET_CORE_FN(cfun_table_new,
@@ -304,6 +592,57 @@ JANET_CORE_FN(cfun_table_new,
     return janet_wrap_table(janet_table(cap));
 }
 
+JANET_CORE_FN(cfun_table_weak,
+              "(table/weak capacity)",
+              "Creates a new empty table with weak references to keys and values. Entries are removed "
+              "by the garbage collector once nothing else refers to their key or their value. Returns the new table.") {
+    janet_fixarity(argc, 1);
+    int32_t cap = janet_getnat(argv, 0);
+    return janet_wrap_table(janet_table_weakkv(cap));
+}
+
+JANET_CORE_FN(cfun_table_weak_keys,
+              "(table/weak-keys capacity)",
+              "Creates a new empty table with weak references to keys and normal references to values. "
+              "Entries are removed by the garbage collector once nothing else refers to their key, which "
+              "makes the table useful for attaching data to objects without keeping them alive. Returns the new table.") {
+    janet_fixarity(argc, 1);
+    int32_t cap = janet_getnat(argv, 0);
+    return janet_wrap_table(janet_table_weakk(cap));
+}
+
+JANET_CORE_FN(cfun_table_weak_values,
+              "(table/weak-values capacity)",
+              "Creates a new empty table with normal references to keys and weak references to values. "
+              "Entries are removed by the garbage collector once nothing else refers to their value, which "
+              "makes the table useful as a cache that does not keep its results alive. Returns the new table.") {
+    janet_fixarity(argc, 1);
+    int32_t cap = janet_getnat(argv, 0);
+    return janet_wrap_table(janet_table_weakv(cap));
+}
+
+JANET_CORE_FN(cfun_table_lru,
+              "(table/lru capacity)",
+              "Creates a cache that holds at most `capacity` entries. Use `get` and `put` like a table. "
+              "Getting a key marks it as recently used, and putting a new key into a full cache evicts "
+              "the least recently used entry. Putting nil removes a key. Entries can be iterated with `next` "
+              "or `eachp` in no particular order. Getting, putting and evicting all take constant time.") {
+    janet_fixarity(argc, 1);
+    int32_t cap = janet_getnat(argv, 0);
+    if (cap < 1) janet_panic("expected capacity of at least 1");
+    JanetLRU *lru = janet_abstract(&janet_lru_type, sizeof(JanetLRU));
+    lru->index.gc.flags = 0;
+    janet_table_init_raw(&lru->index, 0);
+    lru->nodes = NULL;
+    lru->node_capacity = 0;
+    lru->node_count = 0;
+    lru->capacity = cap;
+    lru->head = -1;
+    lru->tail = -1;
+    lru->free = -1;
+    return janet_wrap_abstract(lru);
+}
+
 JANET_CORE_FN(cfun_table_getproto,
               "(table/getproto tab)",
               "Get the prototype table of a table. Returns nil if the table "
@@ -325,6 +664,7 @@ JANET_CORE_FN(cfun_table_setproto,
         proto = janet_gettable(argv, 1);
     }
     table->proto = proto;
+    janet_table_touch(table);
     return argv[0];
 }
 
@@ -377,6 +717,10 @@ JANET_CORE_FN(cfun_table_proto_flatten,
 void janet_lib_table(JanetTable *env) {
     JanetRegExt table_cfuns[] = {
         JANET_CORE_REG("table/new", cfun_table_new),
+        JANET_CORE_REG("table/weak", cfun_table_weak),
+        JANET_CORE_REG("table/weak-keys", cfun_table_weak_keys),
+        JANET_CORE_REG("table/weak-values", cfun_table_weak_values),
+        JANET_CORE_REG("table/lru", cfun_table_lru),
         JANET_CORE_REG("table/to-struct", cfun_table_tostruct),
         JANET_CORE_REG("table/getproto", cfun_table_getproto),
         JANET_CORE_REG("table/setproto", cfun_table_setproto),
@@ -0,0 +1,706 @@
+/*
+* Copyright (c) 2023 Calvin Rose
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to
+* deal in the Software without restriction, including without limitation the
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+* sell copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*/
+
+#ifndef JANET_AMALG
+#include "features.h"
+#include <janet.h>
+#include "util.h"
+#endif
+
+#ifdef JANET_TYPED_ARRAY
+
+/* Typed arrays are views of numbers packed in byte storage - a buffer, a
+ * memory map, or any other byte sequence. The view does not own its
+ * memory, so the storage pointer is looked up again on every use, and a
+ * buffer that was resized or a map that was closed is caught by the range
+ * check instead of being read after it moved. */
+
+/* Element types, with the type that arithmetic on them is done in. Integer
+ * arithmetic is done unsigned so that overflow wraps instead of being
+ * undefined. */
+#define JANET_TARRAY_TYPES(X) \
+    X(u8, uint8_t, uint32_t) \
+    X(s8, int8_t, uint32_t) \
+    X(u16, uint16_t, uint32_t) \
+    X(s16, int16_t, uint32_t) \
+    X(u32, uint32_t, uint32_t) \
+    X(s32, int32_t, uint32_t) \
+    X(u64, uint64_t, uint64_t) \
+    X(s64, int64_t, uint64_t) \
+    X(f32, float, float) \
+    X(f64, double, double)
+
+typedef enum {
+#define X(name, T, A) JANET_TARRAY_##name,
+    JANET_TARRAY_TYPES(X)
+#undef X
+    JANET_TARRAY_TYPE_COUNT
+} JanetTArrayType;
+
+static const char *const tarray_type_names[] = {
+#define X(name, T, A) #name,
+    JANET_TARRAY_TYPES(X)
+#undef X
+};
+
+static const size_t tarray_type_sizes[] = {
+#define X(name, T, A) sizeof(T),
+    JANET_TARRAY_TYPES(X)
+#undef X
+};
+
+typedef struct {
+    Janet storage;
+    int32_t offset; /* In bytes */
+    int32_t size; /* In elements */
+    JanetTArrayType type;
+    int writable;
+} JanetTArray;
+
+/* Elements per step of the kernels. Each step loads a whole chunk before
+ * storing any of it, which lets the compiler use vector instructions even
+ * when the destination is one of the inputs. */
+#define TARRAY_CHUNK 8
+
+static JanetTArrayType tarray_gettype(const Janet *argv, int32_t n) {
+    const uint8_t *name = janet_getkeyword(argv, n);
+    for (int i = 0; i < JANET_TARRAY_TYPE_COUNT; i++) {
+        if (!janet_cstrcmp(name, tarray_type_names[i])) return (JanetTArrayType) i;
+    }
+    janet_panicf("bad slot #%d, expected typed array type, got %v", n, argv[n]);
+}
+
+/* Get the memory of a typed array, checking that it is still in range */
+static uint8_t *tarray_data(JanetTArray *ta) {
+    const uint8_t *bytes;
+    int32_t len;
+    janet_bytes_view(ta->storage, &bytes, &len);
+    size_t end = (size_t) ta->offset + (size_t) ta->size * tarray_type_sizes[ta->type];
+    if (end > (size_t) len) {
+        janet_panicf("typed array out of range of its %s storage",
+                     janet_type_names[janet_type(ta->storage)]);
+    }
+    uint8_t *data = (uint8_t *)(bytes + ta->offset);
+    if ((uintptr_t) data % tarray_type_sizes[ta->type]) {
+        janet_panic("typed array storage is not aligned for its element type");
+    }
+    return data;
+}
+
+static uint8_t *tarray_writable_data(JanetTArray *ta) {
+    if (!ta->writable) janet_panic("typed array is read-only");
+    return tarray_data(ta);
+}
+
+static int64_t tarray_toint(Janet x) {
+#ifdef JANET_INT_TYPES
+    if (janet_checktype(x, JANET_ABSTRACT)) return janet_unwrap_s64(x);
+#endif
+    if (!janet_checkint64(x)) janet_panicf("expected integer, got %v", x);
+    return (int64_t) janet_unwrap_number(x);
+}
+
+static uint64_t tarray_touint(Janet x) {
+#ifdef JANET_INT_TYPES
+    if (janet_checktype(x, JANET_ABSTRACT)) return janet_unwrap_u64(x);
+#endif
+    if (!janet_checkuint64(x)) janet_panicf("expected non-negative integer, got %v", x);
+    return (uint64_t) janet_unwrap_number(x);
+}
+
+static double tarray_tofloat(Janet x) {
+    if (!janet_checktype(x, JANET_NUMBER)) janet_panicf("expected number, got %v", x);
+    return janet_unwrap_number(x);
+}
+
+/* Convert a Janet value to an element, stored in place of a T */
+static void tarray_pack(JanetTArrayType type, void *to, Janet x) {
+    switch (type) {
+        case JANET_TARRAY_TYPE_COUNT:
+            break;
+        case JANET_TARRAY_u8:
+            *(uint8_t *) to = (uint8_t) tarray_toint(x);
+            break;
+        case JANET_TARRAY_s8:
+            *(int8_t *) to = (int8_t) tarray_toint(x);
+            break;
+        case JANET_TARRAY_u16:
+            *(uint16_t *) to = (uint16_t) tarray_toint(x);
+            break;
+        case JANET_TARRAY_s16:
+            *(int16_t *) to = (int16_t) tarray_toint(x);
+            break;
+        case JANET_TARRAY_u32:
+            *(uint32_t *) to = (uint32_t) tarray_toint(x);
+            break;
+        case JANET_TARRAY_s32:
+            *(int32_t *) to = (int32_t) tarray_toint(x);
+            break;
+        case JANET_TARRAY_u64:
+            *(uint64_t *) to = tarray_touint(x);
+            break;
+        case JANET_TARRAY_s64:
+            *(int64_t *) to = tarray_toint(x);
+            break;
+        case JANET_TARRAY_f32:
+            *(float *) to = (float) tarray_tofloat(x);
+            break;
+        case JANET_TARRAY_f64:
+            *(double *) to = tarray_tofloat(x);
+            break;
+    }
+}
+
+static Janet tarray_unpack(JanetTArrayType type, const void *from) {
+    switch (type) {
+        case JANET_TARRAY_TYPE_COUNT:
+            break;
+        case JANET_TARRAY_u8:
+            return janet_wrap_number(*(const uint8_t *) from);
+        case JANET_TARRAY_s8:
+            return janet_wrap_number(*(const int8_t *) from);
+        case JANET_TARRAY_u16:
+            return janet_wrap_number(*(const uint16_t *) from);
+        case JANET_TARRAY_s16:
+            return janet_wrap_number(*(const int16_t *) from);
+        case JANET_TARRAY_u32:
+            return janet_wrap_number(*(const uint32_t *) from);
+        case JANET_TARRAY_s32:
+            return janet_wrap_number(*(const int32_t *) from);
+#ifdef JANET_INT_TYPES
+        case JANET_TARRAY_u64:
+            return janet_wrap_u64(*(const uint64_t *) from);
+        case JANET_TARRAY_s64:
+            return janet_wrap_s64(*(const int64_t *) from);
+#else
+        case JANET_TARRAY_u64:
+            return janet_wrap_number((double) * (const uint64_t *) from);
+        case JANET_TARRAY_s64:
+            return janet_wrap_number((double) * (const int64_t *) from);
+#endif
+        case JANET_TARRAY_f32:
+            return janet_wrap_number(*(const float *) from);
+        case JANET_TARRAY_f64:
+            return janet_wrap_number(*(const double *) from);
+    }
+    return janet_wrap_nil();
+}
+
+/* Abstract type */
+
+static int tarray_gcmark(void *p, size_t s) {
+    (void) s;
+    janet_mark(((JanetTArray *) p)->storage);
+    return 0;
+}
+
+static int tarray_get(void *p, Janet key, Janet *out) {
+    JanetTArray *ta = (JanetTArray *) p;
+    if (!janet_checkint(key)) return 0;
+    int32_t index = janet_unwrap_integer(key);
+    if (index < 0 || index >= ta->size) return 0;
+    uint8_t *data = tarray_data(ta);
+    *out = tarray_unpack(ta->type, data + (size_t) index * tarray_type_sizes[ta->type]);
+    return 1;
+}
+
+static void tarray_put(void *p, Janet key, Janet value) {
+    JanetTArray *ta = (JanetTArray *) p;
+    if (!janet_checkint(key)) janet_panicf("expected integer key, got %v", key);
+    int32_t index = janet_unwrap_integer(key);
+    if (index < 0 || index >= ta->size) janet_panicf("index %d out of range [0,%d)", index, ta->size);
+    uint8_t *data = tarray_writable_data(ta);
+    tarray_pack(ta->type, data + (size_t) index * tarray_type_sizes[ta->type], value);
+}
+
+static Janet tarray_next(void *p, Janet key) {
+    JanetTArray *ta = (JanetTArray *) p;
+    if (janet_checktype(key, JANET_NIL)) {
+        return ta->size > 0 ? janet_wrap_integer(0) : janet_wrap_nil();
+    }
+    if (!janet_checkint(key)) return janet_wrap_nil();
+    int32_t next = janet_unwrap_integer(key) + 1;
+    return (next > 0 && next < ta->size) ? janet_wrap_integer(next) : janet_wrap_nil();
+}
+
+static size_t tarray_length(void *p, size_t s) {
+    (void) s;
+    return (size_t)((JanetTArray *) p)->size;
+}
+
+static JanetByteView tarray_bytes(void *p, size_t s) {
+    (void) s;
+    JanetTArray *ta = (JanetTArray *) p;
+    JanetByteView view;
+    view.bytes = tarray_data(ta);
+    view.len = (int32_t)((size_t) ta->size * tarray_type_sizes[ta->type]);
+    return view;
+}
+
+static void tarray_marshal(void *p, JanetMarshalContext *ctx) {
+    JanetTArray *ta = (JanetTArray *) p;
+    janet_marshal_abstract(ctx, p);
+    janet_marshal_byte(ctx, (uint8_t) ta->type);
+    janet_marshal_int(ctx, ta->size);
+    janet_marshal_bytes(ctx, tarray_data(ta), (size_t) ta->size * tarray_type_sizes[ta->type]);
+}
+
+static void *tarray_unmarshal(JanetMarshalContext *ctx) {
+    JanetTArray *ta = janet_unmarshal_abstract(ctx, sizeof(JanetTArray));
+    ta->storage = janet_wrap_nil();
+    ta->offset = 0;
+    ta->size = 0;
+    ta->type = JANET_TARRAY_u8;
+    ta->writable = 1;
+    uint8_t type = janet_unmarshal_byte(ctx);
+    if (type >= JANET_TARRAY_TYPE_COUNT) janet_panic("invalid typed array type");
+    int32_t size = janet_unmarshal_int(ctx);
+    if (size < 0 || (size_t) size > INT32_MAX / tarray_type_sizes[type]) {
+        janet_panic("invalid typed array size");
+    }
+    int32_t byte_size = (int32_t)((size_t) size * tarray_type_sizes[type]);
+    JanetBuffer *buffer = janet_buffer(byte_size);
+    janet_unmarshal_bytes(ctx, buffer->data, (size_t) byte_size);
+    buffer->count = byte_size;
+    ta->storage = janet_wrap_buffer(buffer);
+    ta->type = (JanetTArrayType) type;
+    ta->size = size;
+    return ta;
+}
+
+const JanetAbstractType janet_tarray_type = {
+    "core/tarray",
+    NULL,
+    tarray_gcmark,
+    tarray_get,
+    tarray_put,
+    tarray_marshal,
+    tarray_unmarshal,
+    NULL, /* tostring */
+    NULL, /* compare */
+    NULL, /* hash */
+    tarray_next,
+    NULL, /* call */
+    tarray_length,
+    tarray_bytes
+};
+
+static JanetTArray *tarray_new(JanetTArrayType type, int32_t size) {
+    if ((size_t) size > INT32_MAX / tarray_type_sizes[type]) janet_panic("typed array too large");
+    int32_t byte_size = (int32_t)((size_t) size * tarray_type_sizes[type]);
+    JanetBuffer *buffer = janet_buffer(byte_size);
+    memset(buffer->data, 0, (size_t) byte_size);
+    buffer->count = byte_size;
+    JanetTArray *ta = janet_abstract(&janet_tarray_type, sizeof(JanetTArray));
+    ta->storage = janet_wrap_buffer(buffer);
+    ta->offset = 0;
+    ta->size = size;
+    ta->type = type;
+    ta->writable = 1;
+    return ta;
+}
+
+static JanetTArray *tarray_getarray(const Janet *argv, int32_t n) {
+    return (JanetTArray *) janet_getabstract(argv, n, &janet_tarray_type);
+}
+
+/* Only buffers and writable memory maps can be changed through a view */
+static int tarray_storage_writable(Janet storage) {
+    if (janet_checktype(storage, JANET_BUFFER)) return 1;
+#ifndef JANET_REDUCED_OS
+    void *m = janet_checkabstract(storage, &janet_mmap_type);
+    if (NULL != m) return janet_mmap_writable(m);
+#endif
+    return 0;
+}
+
+/* Kernels */
+
+#define TARRAY_BINOP_LOOP(T, A, OP) do { \
+    T *d = (T *) dest; \
+    const T *x = (const T *) a; \
+    int32_t i = 0; \
+    if (NULL == b) { \
+        A y = (A) *(const T *) scalar; \
+        for (; i + TARRAY_CHUNK <= n; i += TARRAY_CHUNK) { \
+            T t[TARRAY_CHUNK]; \
+            for (int j = 0; j < TARRAY_CHUNK; j++) t[j] = (T)((A) x[i + j] OP y); \
+            for (int j = 0; j < TARRAY_CHUNK; j++) d[i + j] = t[j]; \
+        } \
+        for (; i < n; i++) d[i] = (T)((A) x[i] OP y); \
+    } else { \
+        const T *y = (const T *) b; \
+        for (; i + TARRAY_CHUNK <= n; i += TARRAY_CHUNK) { \
+            T t[TARRAY_CHUNK]; \
+            for (int j = 0; j < TARRAY_CHUNK; j++) t[j] = (T)((A) x[i + j] OP (A) y[i + j]); \
+            for (int j = 0; j < TARRAY_CHUNK; j++) d[i + j] = t[j]; \
+        } \
+        for (; i < n; i++) d[i] = (T)((A) x[i] OP (A) y[i]); \
+    } \
+} while (0)
+
+/* Element-wise dest = a op b, where b is either an array or, when NULL, the
+ * single element at scalar */
+static void tarray_binop(JanetTArrayType type, char op, void *dest, const void *a,
+                         const void *b, const void *scalar, int32_t n) {
+    switch (type) {
+        case JANET_TARRAY_TYPE_COUNT:
+            break;
+#define X(name, T, A) \
+        case JANET_TARRAY_##name: \
+            if (op == '+') TARRAY_BINOP_LOOP(T, A, +); \
+            else if (op == '-') TARRAY_BINOP_LOOP(T, A, -); \
+            else TARRAY_BINOP_LOOP(T, A, *); \
+            break;
+            JANET_TARRAY_TYPES(X)
+#undef X
+    }
+}
+
+/* Sum of elements, or of products of elements when b is not NULL. Several
+ * partial sums are kept so the additions do not wait on each other. */
+static double tarray_reduce(JanetTArrayType type, const void *a, const void *b, int32_t n) {
+    double acc[TARRAY_CHUNK] = {0};
+    double total = 0;
+    int32_t i = 0;
+    switch (type) {
+        case JANET_TARRAY_TYPE_COUNT:
+            break;
+#define X(name, T, A) \
+        case JANET_TARRAY_##name: { \
+            const T *x = (const T *) a; \
+            const T *y = (const T *) b; \
+            if (NULL == y) { \
+                for (; i + TARRAY_CHUNK <= n; i += TARRAY_CHUNK) \
+                    for (int j = 0; j < TARRAY_CHUNK; j++) acc[j] += (double) x[i + j]; \
+                for (; i < n; i++) total += (double) x[i]; \
+            } else { \
+                for (; i + TARRAY_CHUNK <= n; i += TARRAY_CHUNK) \
+                    for (int j = 0; j < TARRAY_CHUNK; j++) acc[j] += (double) x[i + j] * (double) y[i + j]; \
+                for (; i < n; i++) total += (double) x[i] * (double) y[i]; \
+            } \
+            break; \
+        }
+            JANET_TARRAY_TYPES(X)
+#undef X
+    }
+    for (int j = 0; j < TARRAY_CHUNK; j++) total += acc[j];
+    return total;
+}
+
+/* Index of the smallest element, or the largest if max is set */
+static int32_t tarray_extreme(JanetTArrayType type, const void *a, int32_t n, int max) {
+    int32_t best = 0;
+    switch (type) {
+        case JANET_TARRAY_TYPE_COUNT:
+            break;
+#define X(name, T, A) \
+        case JANET_TARRAY_##name: { \
+            const T *x = (const T *) a; \
+            for (int32_t i = 1; i < n; i++) { \
+                if (max ? (x[i] > x[best]) : (x[i] < x[best])) best = i; \
+            } \
+            break; \
+        }
+            JANET_TARRAY_TYPES(X)
+#undef X
+    }
+    return best;
+}
+
+/* C Functions */
+
+JANET_CORE_FN(cfun_tarray_new,
+              "(tarray/new type size)",
+              "Create a typed array of size zeroed elements of type, stored in a new buffer. "
+              "type is one of :u8, :s8, :u16, :s16, :u32, :s32, :u64, :s64, :f32, or :f64. "
+              "A typed array can be indexed with `get` and `put` and its elements iterated like "
+              "an array, and can be used in place of a byte sequence, for example as an "
+              "`ffi/read` source or a pointer argument to an FFI call.") {
+    janet_fixarity(argc, 2);
+    JanetTArrayType type = tarray_gettype(argv, 0);
+    int32_t size = janet_getnat(argv, 1);
+    return janet_wrap_abstract(tarray_new(type, size));
+}
+
+JANET_CORE_FN(cfun_tarray_view,
+              "(tarray/view type bytes &opt offset size)",
+              "Create a typed array that reads and writes the memory of bytes without copying "
+              "it. bytes can be a buffer, a memory map from `os/mmap`, or any other byte "
+              "sequence, and only buffers and writable memory maps can be changed through the "
+              "view. offset is in bytes and defaults to 0, and size is in elements and defaults "
+              "to as many as fit. Resizing a viewed buffer does not change the view, and a view "
+              "that no longer fits in its storage raises an error when used.") {
+    janet_arity(argc, 2, 4);
+    JanetTArrayType type = tarray_gettype(argv, 0);
+    JanetByteView bytes = janet_getbytes(argv, 1);
+    int32_t offset = janet_optnat(argv, argc, 2, 0);
+    size_t elsize = tarray_type_sizes[type];
+    if (offset > bytes.len) janet_panicf("offset %d out of range [0,%d]", offset, bytes.len);
+    if (offset % elsize) janet_panicf("offset must be a multiple of %d", (int32_t) elsize);
+    int32_t fit = (int32_t)((size_t)(bytes.len - offset) / elsize);
+    int32_t size = janet_optnat(argv, argc, 3, fit);
+    if (size > fit) janet_panicf("size %d too large for %d bytes", size, bytes.len - offset);
+    JanetTArray *ta = janet_abstract(&janet_tarray_type, sizeof(JanetTArray));
+    ta->storage = argv[1];
+    ta->offset = offset;
+    ta->size = size;
+    ta->type = type;
+    ta->writable = tarray_storage_writable(argv[1]);
+    tarray_data(ta);
+    return janet_wrap_abstract(ta);
+}
+
+JANET_CORE_FN(cfun_tarray_from,
+              "(tarray/from type xs)",
+              "Create a typed array of type from the numbers in the array or tuple xs.") {
+    janet_fixarity(argc, 2);
+    JanetTArrayType type = tarray_gettype(argv, 0);
+    JanetView view = janet_getindexed(argv, 1);
+    JanetTArray *ta = tarray_new(type, view.len);
+    uint8_t *data = tarray_data(ta);
+    for (int32_t i = 0; i < view.len; i++) {
+        tarray_pack(type, data + (size_t) i * tarray_type_sizes[type], view.items[i]);
+    }
+    return janet_wrap_abstract(ta);
+}
+
+JANET_CORE_FN(cfun_tarray_to_array,
+              "(tarray/to-array ta)",
+              "Return a new array of the elements of a typed array.") {
+    janet_fixarity(argc, 1);
+    JanetTArray *ta = tarray_getarray(argv, 0);
+    uint8_t *data = tarray_data(ta);
+    JanetArray *array = janet_array(ta->size);
+    for (int32_t i = 0; i < ta->size; i++) {
+        array->data[i] = tarray_unpack(ta->type, data + (size_t) i * tarray_type_sizes[ta->type]);
+    }
+    array->count = ta->size;
+    return janet_wrap_array(array);
+}
+
+JANET_CORE_FN(cfun_tarray_properties,
+              "(tarray/properties ta)",
+              "Return a struct describing a typed array, with keys :type, :size, :offset, "
+              ":byte-size, :writable, and :storage.") {
+    janet_fixarity(argc, 1);
+    JanetTArray *ta = tarray_getarray(argv, 0);
+    JanetKV *st = janet_struct_begin(6);
+    janet_struct_put(st, janet_ckeywordv("type"), janet_ckeywordv(tarray_type_names[ta->type]));
+    janet_struct_put(st, janet_ckeywordv("size"), janet_wrap_integer(ta->size));
+    janet_struct_put(st, janet_ckeywordv("offset"), janet_wrap_integer(ta->offset));
+    janet_struct_put(st, janet_ckeywordv("byte-size"),
+                     janet_wrap_number((double) ta->size * tarray_type_sizes[ta->type]));
+    janet_struct_put(st, janet_ckeywordv("writable"), janet_wrap_boolean(ta->writable));
+    janet_struct_put(st, janet_ckeywordv("storage"), ta->storage);
+    return janet_wrap_struct(janet_struct_end(st));
+}
+
+JANET_CORE_FN(cfun_tarray_fill,
+              "(tarray/fill ta x)",
+              "Set every element of a typed array to x. Returns ta.") {
+    janet_fixarity(argc, 2);
+    JanetTArray *ta = tarray_getarray(argv, 0);
+    uint8_t *data = tarray_writable_data(ta);
+    size_t elsize = tarray_type_sizes[ta->type];
+    uint64_t element;
+    tarray_pack(ta->type, &element, argv[1]);
+    for (int32_t i = 0; i < ta->size; i++) {
+        memcpy(data + (size_t) i * elsize, &element, elsize);
+    }
+    return argv[0];
+}
+
+static Janet tarray_binop_cfun(int32_t argc, Janet *argv, char op) {
+    janet_arity(argc, 2, 3);
+    JanetTArray *a = tarray_getarray(argv, 0);
+    JanetTArray *b = (JanetTArray *) janet_checkabstract(argv[1], &janet_tarray_type);
+    JanetTArray *dest;
+    if (argc > 2 && !janet_checktype(argv[2], JANET_NIL)) {
+        dest = tarray_getarray(argv, 2);
+    } else {
+        dest = tarray_new(a->type, a->size);
+    }
+    if (dest->type != a->type || (NULL != b && b->type != a->type)) {
+        janet_panic("expected typed arrays of the same type");
+    }
+    if (dest->size != a->size || (NULL != b && b->size != a->size)) {
+        janet_panic("expected typed arrays of the same size");
+    }
+    uint64_t scalar = 0;
+    if (NULL == b) tarray_pack(a->type, &scalar, argv[1]);
+    uint8_t *to = tarray_writable_data(dest);
+    tarray_binop(a->type, op, to, tarray_data(a), NULL == b ? NULL : tarray_data(b), &scalar, a->size);
+    return janet_wrap_abstract(dest);
+}
+
+JANET_CORE_FN(cfun_tarray_add,
+              "(tarray/add a b &opt dest)",
+              "Add typed array a to b element by element, where b is a typed array of the same "
+              "type and size or a single number. The result goes in dest, which can be a or b, "
+              "or a new typed array if dest is not given. Integer results wrap around. "
+              "Returns the result.") {
+    return tarray_binop_cfun(argc, argv, '+');
+}
+
+JANET_CORE_FN(cfun_tarray_sub,
+              "(tarray/sub a b &opt dest)",
+              "Subtract b from typed array a element by element, as with `tarray/add`.") {
+    return tarray_binop_cfun(argc, argv, '-');
+}
+
+JANET_CORE_FN(cfun_tarray_mul,
+              "(tarray/mul a b &opt dest)",
+              "Multiply typed array a by b element by element, as with `tarray/add`.") {
+    return tarray_binop_cfun(argc, argv, '*');
+}
+
+JANET_CORE_FN(cfun_tarray_sum,
+              "(tarray/sum ta)",
+              "Return the sum of the elements of a typed array as a number.") {
+    janet_fixarity(argc, 1);
+    JanetTArray *ta = tarray_getarray(argv, 0);
+    return janet_wrap_number(tarray_reduce(ta->type, tarray_data(ta), NULL, ta->size));
+}
+
+JANET_CORE_FN(cfun_tarray_dot,
+              "(tarray/dot a b)",
+              "Return the sum of the products of the elements of two typed arrays of the same "
+              "type and size, as a number.") {
+    janet_fixarity(argc, 2);
+    JanetTArray *a = tarray_getarray(argv, 0);
+    JanetTArray *b = tarray_getarray(argv, 1);
+    if (a->type != b->type) janet_panic("expected typed arrays of the same type");
+    if (a->size != b->size) janet_panic("expected typed arrays of the same size");
+    return janet_wrap_number(tarray_reduce(a->type, tarray_data(a), tarray_data(b), a->size));
+}
+
+JANET_CORE_FN(cfun_tarray_random,
+              "(tarray/random ta &opt rng)",
+              "Fill a typed array with random numbers from rng, or from the generator used by "
+              "`math/random` if rng is not given. Elements of float typed arrays are in the range "
+              "[0, 1), and elements of integer typed arrays are random bits. Returns ta.") {
+    janet_arity(argc, 1, 2);
+    JanetTArray *ta = tarray_getarray(argv, 0);
+    JanetRNG *rng = (argc > 1 && !janet_checktype(argv[1], JANET_NIL))
+                    ? (JanetRNG *) janet_getabstract(argv, 1, &janet_rng_type)
+                    : janet_default_rng();
+    uint8_t *data = tarray_writable_data(ta);
+    int32_t n = ta->size;
+    if (ta->type == JANET_TARRAY_f64) {
+        double *d = (double *) data;
+        for (int32_t i = 0; i < n; i++) d[i] = janet_rng_double(rng);
+    } else if (ta->type == JANET_TARRAY_f32) {
+        float *d = (float *) data;
+        for (int32_t i = 0; i < n; i++) d[i] = (float)(janet_rng_u32(rng) >> 8) * (1.0f / 16777216.0f);
+    } else {
+        size_t bytes = (size_t) n * tarray_type_sizes[ta->type];
+        size_t i = 0;
+        for (; i + 4 <= bytes; i += 4) {
+            uint32_t word = janet_rng_u32(rng);
+            memcpy(data + i, &word, 4);
+        }
+        if (i < bytes) {
+            uint32_t word = janet_rng_u32(rng);
+            memcpy(data + i, &word, bytes - i);
+        }
+    }
+    return argv[0];
+}
+
+JANET_CORE_FN(cfun_tarray_map,
+              "(tarray/map f ta &opt dest)",
+              "Apply the unary math function f, such as `math/sin` or `math/log`, to every element "
+              "of a float typed array. The result goes in dest, which can be ta, or a new typed "
+              "array if dest is not given. Returns the result.") {
+    janet_arity(argc, 2, 3);
+    JanetMathKernel kernel = janet_getmathkernel(argv, 0);
+    JanetTArray *a = tarray_getarray(argv, 1);
+    if (a->type != JANET_TARRAY_f64 && a->type != JANET_TARRAY_f32) {
+        janet_panic("expected a float typed array");
+    }
+    JanetTArray *dest = (argc > 2 && !janet_checktype(argv[2], JANET_NIL))
+                        ? tarray_getarray(argv, 2)
+                        : tarray_new(a->type, a->size);
+    if (dest->type != a->type) janet_panic("expected typed arrays of the same type");
+    if (dest->size != a->size) janet_panic("expected typed arrays of the same size");
+    uint8_t *to = tarray_writable_data(dest);
+    const uint8_t *from = tarray_data(a);
+    int32_t n = a->size;
+    if (a->type == JANET_TARRAY_f64) {
+        const double *x = (const double *) from;
+        double *d = (double *) to;
+        for (int32_t i = 0; i < n; i++) d[i] = kernel(x[i]);
+    } else {
+        const float *x = (const float *) from;
+        float *d = (float *) to;
+        for (int32_t i = 0; i < n; i++) d[i] = (float) kernel((double) x[i]);
+    }
+    return janet_wrap_abstract(dest);
+}
+
+static Janet tarray_extreme_cfun(int32_t argc, Janet *argv, int max) {
+    janet_fixarity(argc, 1);
+    JanetTArray *ta = tarray_getarray(argv, 0);
+    if (ta->size == 0) return janet_wrap_nil();
+    uint8_t *data = tarray_data(ta);
+    int32_t i = tarray_extreme(ta->type, data, ta->size, max);
+    return tarray_unpack(ta->type, data + (size_t) i * tarray_type_sizes[ta->type]);
+}
+
+JANET_CORE_FN(cfun_tarray_min,
+              "(tarray/min ta)",
+              "Return the smallest element of a typed array, or nil if it is empty.") {
+    return tarray_extreme_cfun(argc, argv, 0);
+}
+
+JANET_CORE_FN(cfun_tarray_max,
+              "(tarray/max ta)",
+              "Return the largest element of a typed array, or nil if it is empty.") {
+    return tarray_extreme_cfun(argc, argv, 1);
+}
+
+/* Load the typed array module */
+void janet_lib_typed_array(JanetTable *env) {
+    JanetRegExt tarray_cfuns[] = {
+        JANET_CORE_REG("tarray/new", cfun_tarray_new),
+        JANET_CORE_REG("tarray/view", cfun_tarray_view),
+        JANET_CORE_REG("tarray/from", cfun_tarray_from),
+        JANET_CORE_REG("tarray/to-array", cfun_tarray_to_array),
+        JANET_CORE_REG("tarray/properties", cfun_tarray_properties),
+        JANET_CORE_REG("tarray/fill", cfun_tarray_fill),
+        JANET_CORE_REG("tarray/add", cfun_tarray_add),
+        JANET_CORE_REG("tarray/sub", cfun_tarray_sub),
+        JANET_CORE_REG("tarray/mul", cfun_tarray_mul),
+        JANET_CORE_REG("tarray/sum", cfun_tarray_sum),
+        JANET_CORE_REG("tarray/dot", cfun_tarray_dot),
+        JANET_CORE_REG("tarray/min", cfun_tarray_min),
+        JANET_CORE_REG("tarray/max", cfun_tarray_max),
+        JANET_CORE_REG("tarray/random", cfun_tarray_random),
+        JANET_CORE_REG("tarray/map", cfun_tarray_map),
+        JANET_REG_END
+    };
+    janet_core_cfuns_ext(env, NULL, tarray_cfuns);
+    janet_register_abstract_type(&janet_tarray_type);
+}
+
+#endif
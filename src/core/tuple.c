@@ -53,6 +53,110 @@ const Janet *janet_tuple_n(const Janet *values, int32_t n) {
     return janet_tuple_end(t);
 }
 
+/* Tuple builders. A builder grows its elements in malloc'd memory that
+ * starts with a tuple header, and hashes each element as it is pushed, so
+ * freezing only trims the memory and hands it to the garbage collector. */
+
+typedef struct {
+    JanetTupleHead *head;
+    int32_t capacity;
+    uint64_t hash;
+} JanetTupleBuilder;
+
+static size_t janet_tuple_size(int32_t length) {
+    return sizeof(JanetTupleHead) + (size_t) length * sizeof(Janet);
+}
+
+static void tuple_builder_reset(JanetTupleBuilder *b) {
+    b->head = NULL;
+    b->capacity = 0;
+    b->hash = JANET_ARRAY_HASH_INIT;
+}
+
+static void tuple_builder_push(JanetTupleBuilder *b, const Janet *xs, int32_t n) {
+    int32_t length = NULL == b->head ? 0 : b->head->length;
+    if (n == 0) return;
+    if (n > INT32_MAX - length) janet_panic("tuple too large");
+    if (length + n > b->capacity) {
+        int64_t capacity = 2 * (int64_t)(length + n);
+        if (capacity < 4) capacity = 4;
+        if (capacity > INT32_MAX) capacity = INT32_MAX;
+        JanetTupleHead *head = janet_realloc(b->head, janet_tuple_size((int32_t) capacity));
+        if (NULL == head) {
+            JANET_OUT_OF_MEMORY;
+        }
+        head->length = length;
+        b->head = head;
+        b->capacity = (int32_t) capacity;
+    }
+    Janet *data = (Janet *) b->head->data;
+    for (int32_t i = 0; i < n; i++) {
+        data[length + i] = xs[i];
+        b->hash = janet_array_hashstep(b->hash, xs[i]);
+    }
+    b->head->length = length + n;
+}
+
+static const Janet *tuple_builder_freeze(JanetTupleBuilder *b) {
+    if (NULL == b->head) {
+        return janet_tuple_end(janet_tuple_begin(0));
+    }
+    size_t size = janet_tuple_size(b->head->length);
+    JanetTupleHead *head = janet_realloc(b->head, size);
+    if (NULL == head) {
+        JANET_OUT_OF_MEMORY;
+    }
+    head->hash = janet_hash_fold(b->hash);
+    head->sm_line = -1;
+    head->sm_column = -1;
+    janet_gcadopt(JANET_MEMORY_TUPLE, head, size);
+    tuple_builder_reset(b);
+    return head->data;
+}
+
+static int tuple_builder_gc(void *p, size_t size) {
+    (void) size;
+    janet_free(((JanetTupleBuilder *) p)->head);
+    return 0;
+}
+
+static int tuple_builder_mark(void *p, size_t size) {
+    (void) size;
+    JanetTupleBuilder *b = (JanetTupleBuilder *) p;
+    if (NULL != b->head) {
+        for (int32_t i = 0; i < b->head->length; i++) {
+            janet_mark(b->head->data[i]);
+        }
+    }
+    return 0;
+}
+
+static int tuple_builder_get(void *p, Janet key, Janet *out);
+static Janet tuple_builder_next(void *p, Janet key);
+
+static size_t tuple_builder_length(void *p, size_t size) {
+    (void) size;
+    JanetTupleBuilder *b = (JanetTupleBuilder *) p;
+    return NULL == b->head ? 0 : (size_t) b->head->length;
+}
+
+const JanetAbstractType janet_tuple_builder_type = {
+    "core/tuple-builder",
+    tuple_builder_gc,
+    tuple_builder_mark,
+    tuple_builder_get,
+    NULL, /* put */
+    NULL, /* marshal */
+    NULL, /* unmarshal */
+    NULL, /* tostring */
+    NULL, /* compare */
+    NULL, /* hash */
+    tuple_builder_next,
+    NULL, /* call */
+    tuple_builder_length,
+    JANET_ATEND_LENGTH
+};
+
 /* C Functions */
 
 JANET_CORE_FN(cfun_tuple_brackets,
@@ -116,6 +220,53 @@ JANET_CORE_FN(cfun_tuple_setmap,
     return argv[0];
 }
 
+JANET_CORE_FN(cfun_tuple_builder,
+              "(tuple/builder & xs)",
+              "Create a tuple builder, optionally starting with the values xs. Values "
+              "are appended with `tuple/builder-push`, and `tuple/freeze` turns the "
+              "builder into a tuple without copying. Use a builder to make a large "
+              "tuple one value at a time.") {
+    JanetTupleBuilder *b = janet_abstract(&janet_tuple_builder_type, sizeof(JanetTupleBuilder));
+    tuple_builder_reset(b);
+    tuple_builder_push(b, argv, argc);
+    return janet_wrap_abstract(b);
+}
+
+JANET_CORE_FN(cfun_tuple_builder_push,
+              "(tuple/builder-push builder & xs)",
+              "Append values to a tuple builder. Returns the builder.") {
+    janet_arity(argc, 1, -1);
+    JanetTupleBuilder *b = janet_getabstract(argv, 0, &janet_tuple_builder_type);
+    tuple_builder_push(b, argv + 1, argc - 1);
+    return argv[0];
+}
+
+JANET_CORE_FN(cfun_tuple_freeze,
+              "(tuple/freeze builder)",
+              "Return a tuple of all values pushed to a tuple builder. The builder's "
+              "memory becomes the tuple, and the builder is left empty.") {
+    janet_fixarity(argc, 1);
+    JanetTupleBuilder *b = janet_getabstract(argv, 0, &janet_tuple_builder_type);
+    return janet_wrap_tuple(tuple_builder_freeze(b));
+}
+
+static const JanetMethod tuple_builder_methods[] = {
+    {"push", cfun_tuple_builder_push},
+    {"freeze", cfun_tuple_freeze},
+    {NULL, NULL}
+};
+
+static int tuple_builder_get(void *p, Janet key, Janet *out) {
+    (void) p;
+    if (!janet_checktype(key, JANET_KEYWORD)) return 0;
+    return janet_getmethod(janet_unwrap_keyword(key), tuple_builder_methods, out);
+}
+
+static Janet tuple_builder_next(void *p, Janet key) {
+    (void) p;
+    return janet_nextmethod(tuple_builder_methods, key);
+}
+
 /* Load the tuple module */
 void janet_lib_tuple(JanetTable *env) {
     JanetRegExt tuple_cfuns[] = {
@@ -124,6 +275,9 @@ void janet_lib_tuple(JanetTable *env) {
         JANET_CORE_REG("tuple/type", cfun_tuple_type),
         JANET_CORE_REG("tuple/sourcemap", cfun_tuple_sourcemap),
         JANET_CORE_REG("tuple/setmap", cfun_tuple_setmap),
+        JANET_CORE_REG("tuple/builder", cfun_tuple_builder),
+        JANET_CORE_REG("tuple/builder-push", cfun_tuple_builder_push),
+        JANET_CORE_REG("tuple/freeze", cfun_tuple_freeze),
         JANET_REG_END
     };
     janet_core_cfuns_ext(env, NULL, tuple_cfuns);
@@ -28,11 +28,17 @@
 #include "gc.h"
 #ifdef JANET_WINDOWS
 #include <windows.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #else
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#ifdef JANET_THREADS
+#include <pthread.h>
+#endif
 #endif
 #endif
 
@@ -115,15 +121,93 @@ const char *const janet_status_names[16] = {
     "alive"
 };
 
+/* Hashing. Strings, numbers, and pointers are hashed with a seed that is
+ * shared by all threads, so that a value hashes the same in every VM. The
+ * seed is set with janet_init_hash_key before the first janet_init. The string
+ * hash is a wyhash style multiply and fold, and is replaced by halfsiphash
+ * when JANET_PRF is defined. */
+
+#define JANET_HASH_P0 0xa0761d6478bd642fULL
+#define JANET_HASH_P1 0xe7037ed1a0b428dbULL
+
+static uint64_t hash_seed = JANET_HASH_P0;
+
+/* 64 by 64 bit multiply, folding the high half of the product into the low half */
+static uint64_t hash_mum(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t) a * b;
+    return (uint64_t) r ^ (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t hi;
+    uint64_t lo = _umul128(a, b, &hi);
+    return lo ^ hi;
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t) a, lb = (uint32_t) b;
+    uint64_t rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t lo = t + (rm1 << 32);
+    uint64_t hi = ha * hb + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+    return lo ^ hi;
+#endif
+}
+
+int32_t janet_hash_fold(uint64_t h) {
+    return (int32_t)(uint32_t)(h ^ (h >> 32));
+}
+
+/* Hash 64 bits of a number or pointer */
+int32_t janet_hash_u64(uint64_t x) {
+    return janet_hash_fold(hash_mum(x ^ hash_seed, JANET_HASH_P1));
+}
+
 #ifndef JANET_PRF
 
+void janet_init_hash_key(uint8_t new_key[JANET_HASH_KEY_SIZE]) {
+    uint64_t a, b;
+    memcpy(&a, new_key, 8);
+    memcpy(&b, new_key + 8, 8);
+    hash_seed = hash_mum(a ^ JANET_HASH_P0, b ^ JANET_HASH_P1) ^ JANET_HASH_P0;
+}
+
+static uint64_t hash_read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t hash_read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
 int32_t janet_string_calchash(const uint8_t *str, int32_t len) {
-    if (NULL == str) return 5381;
-    const uint8_t *end = str + len;
-    uint32_t hash = 5381;
-    while (str < end)
-        hash = (hash << 5) + hash + *str++;
-    return (int32_t) hash;
+    size_t n = (NULL == str || len < 0) ? 0 : (size_t) len;
+    uint64_t seed = hash_seed;
+    uint64_t a, b;
+    if (n <= 16) {
+        if (n >= 4) {
+            size_t mid = (n >> 3) << 2;
+            a = (hash_read32(str) << 32) | hash_read32(str + mid);
+            b = (hash_read32(str + n - 4) << 32) | hash_read32(str + n - 4 - mid);
+        } else if (n > 0) {
+            a = ((uint64_t) str[0] << 16) | ((uint64_t) str[n >> 1] << 8) | str[n - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = n;
+        const uint8_t *p = str;
+        while (i > 16) {
+            seed = hash_mum(hash_read64(p) ^ JANET_HASH_P1, hash_read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = hash_read64(p + i - 16);
+        b = hash_read64(p + i - 8);
+    }
+    return janet_hash_fold(hash_mum(hash_mum(a ^ JANET_HASH_P1, b ^ seed) ^ JANET_HASH_P0, n ^ JANET_HASH_P1));
 }
 
 #else
@@ -225,7 +309,11 @@ static uint32_t halfsiphash(const uint8_t *in, const size_t inlen, const uint8_t
 static uint8_t hash_key[JANET_HASH_KEY_SIZE] = {0};
 
 void janet_init_hash_key(uint8_t new_key[JANET_HASH_KEY_SIZE]) {
+    uint64_t a, b;
     memcpy(hash_key, new_key, sizeof(hash_key));
+    memcpy(&a, new_key, 8);
+    memcpy(&b, new_key + 8, 8);
+    hash_seed = hash_mum(a ^ JANET_HASH_P0, b ^ JANET_HASH_P1) ^ JANET_HASH_P0;
 }
 
 /* Calculate hash for string */
@@ -243,26 +331,40 @@ uint32_t janet_hash_mix(uint32_t input, uint32_t more) {
     return input ^ (0x9e3779b9 + (mix1 << 6) + (mix1 >> 2));
 }
 
+/* Add one value to a running array hash. Hashing one element at a time
+ * lets a tuple that grows one element at a time keep its hash up to date. */
+uint64_t janet_array_hashstep(uint64_t state, Janet x) {
+    return hash_mum(state ^ (uint32_t) janet_hash(x), JANET_HASH_P1);
+}
+
 /* Computes hash of an array of values */
 int32_t janet_array_calchash(const Janet *array, int32_t len) {
     const Janet *end = array + len;
-    uint32_t hash = 33;
+    uint64_t hash = JANET_ARRAY_HASH_INIT;
     while (array < end) {
-        hash = janet_hash_mix(hash, janet_hash(*array++));
+        hash = janet_array_hashstep(hash, *array++);
     }
-    return (int32_t) hash;
+    return janet_hash_fold(hash);
 }
 
-/* Computes hash of an array of values */
+/* Hash of one key value pair. A struct hash is the sum of its pair hashes,
+ * so it does not depend on bucket layout and can be updated one pair at a time. */
+uint64_t janet_kv_hashpair(Janet key, Janet value) {
+    uint64_t kv = ((uint64_t)(uint32_t) janet_hash(key) << 32) | (uint32_t) janet_hash(value);
+    return hash_mum(kv ^ JANET_HASH_P0, JANET_HASH_P1);
+}
+
+/* Computes hash of an array of key value pairs, skipping empty buckets */
 int32_t janet_kv_calchash(const JanetKV *kvs, int32_t len) {
     const JanetKV *end = kvs + len;
-    uint32_t hash = 33;
+    uint64_t hash = JANET_KV_HASH_INIT;
     while (kvs < end) {
-        hash = janet_hash_mix(hash, janet_hash(kvs->key));
-        hash = janet_hash_mix(hash, janet_hash(kvs->value));
+        if (!janet_checktype(kvs->key, JANET_NIL)) {
+            hash += janet_kv_hashpair(kvs->key, kvs->value);
+        }
         kvs++;
     }
-    return (int32_t) hash;
+    return janet_hash_fold(hash);
 }
 
 /* Calculate next power of 2. May overflow. If n is 0,
@@ -277,6 +379,33 @@ int32_t janet_tablen(int32_t n) {
     return n + 1;
 }
 
+/* Write the decimal digits of x to out, which must have room for 20 bytes.
+ * Returns the number of bytes written. Two digits are written at a time. */
+int32_t janet_u64_digits(uint8_t *out, uint64_t x) {
+    static const char pairs[201] =
+        "00010203040506070809101112131415161718192021222324"
+        "25262728293031323334353637383940414243444546474849"
+        "50515253545556575859606162636465666768697071727374"
+        "75767778798081828384858687888990919293949596979899";
+    uint8_t tmp[20];
+    int32_t i = 20;
+    while (x >= 100) {
+        uint32_t r = (uint32_t)(x % 100) * 2;
+        x /= 100;
+        tmp[--i] = (uint8_t) pairs[r + 1];
+        tmp[--i] = (uint8_t) pairs[r];
+    }
+    if (x >= 10) {
+        uint32_t r = (uint32_t) x * 2;
+        tmp[--i] = (uint8_t) pairs[r + 1];
+        tmp[--i] = (uint8_t) pairs[r];
+    } else {
+        tmp[--i] = (uint8_t)('0' + x);
+    }
+    memcpy(out, tmp + i, 20 - i);
+    return 20 - i;
+}
+
 /* Avoid some undefined behavior that was common in the code base. */
 void safe_memcpy(void *dest, const void *src, size_t len) {
     if (!len) return;
@@ -442,6 +571,18 @@ void janet_registry_put(
     const char *name_prefix,
     const char *source_file,
     int32_t source_line) {
+    if (janet_vm.registry_shared) {
+        /* Copy on write */
+        size_t newcap = janet_vm.registry_count * 2 + 1;
+        JanetCFunRegistry *newmem = janet_malloc(newcap * sizeof(JanetCFunRegistry));
+        if (NULL == newmem) {
+            JANET_OUT_OF_MEMORY;
+        }
+        safe_memcpy(newmem, janet_vm.registry, janet_vm.registry_count * sizeof(JanetCFunRegistry));
+        janet_vm.registry = newmem;
+        janet_vm.registry_cap = newcap;
+        janet_vm.registry_shared = 0;
+    }
     if (janet_vm.registry_count == janet_vm.registry_cap) {
         size_t newcap = (janet_vm.registry_count + 1) * 2;
         /* Size it nicely with core by default */
@@ -466,6 +607,59 @@ void janet_registry_put(
     janet_vm.registry_dirty = 1;
 }
 
+#ifdef JANET_EV
+
+/* The registry of the core environment, shared by all VMs in the process */
+typedef struct {
+    size_t count;
+    JanetCFunRegistry items[];
+} JanetSharedRegistry;
+
+static JanetSharedRegistry *janet_shared_registry = NULL;
+
+static int janet_registry_equal(const JanetCFunRegistry *a, const JanetCFunRegistry *b, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (a[i].cfun != b[i].cfun ||
+                a[i].name != b[i].name ||
+                a[i].name_prefix != b[i].name_prefix ||
+                a[i].source_file != b[i].source_file ||
+                a[i].source_line != b[i].source_line) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Replace the registry of this VM with the shared registry if they are the
+ * same. The first VM to call this publishes its registry as the shared one. */
+void janet_registry_share(void) {
+    if (janet_vm.registry_shared) return;
+    if (janet_vm.registry_dirty) janet_registry_sort();
+    size_t count = janet_vm.registry_count;
+    JanetSharedRegistry *shared = janet_atomic_load_ptr((void **) &janet_shared_registry);
+    if (NULL == shared) {
+        JanetSharedRegistry *mine = janet_malloc(sizeof(JanetSharedRegistry) + count * sizeof(JanetCFunRegistry));
+        if (NULL == mine) {
+            JANET_OUT_OF_MEMORY;
+        }
+        mine->count = count;
+        safe_memcpy(mine->items, janet_vm.registry, count * sizeof(JanetCFunRegistry));
+        if (janet_atomic_cas_ptr((void **) &janet_shared_registry, NULL, mine)) {
+            shared = mine;
+        } else {
+            janet_free(mine);
+            shared = janet_atomic_load_ptr((void **) &janet_shared_registry);
+        }
+    }
+    if (shared->count != count || !janet_registry_equal(shared->items, janet_vm.registry, count)) return;
+    janet_free(janet_vm.registry);
+    janet_vm.registry = shared->items;
+    janet_vm.registry_cap = count;
+    janet_vm.registry_shared = 1;
+}
+
+#endif
+
 JanetCFunRegistry *janet_registry_get(JanetCFunction key) {
     if (janet_vm.registry_dirty) {
         janet_registry_sort();
@@ -739,7 +933,7 @@ Janet janet_resolve_core(const char *name) {
     return out;
 }
 
-/* Read both tuples and arrays as c pointers + int32_t length. Return 1 if the
+/* Read tuples, arrays, and array views as c pointers + int32_t length. Return 1 if the
  * view can be constructed, 0 if an invalid type. */
 int janet_indexed_view(Janet seq, const Janet **data, int32_t *len) {
     if (janet_checktype(seq, JANET_ARRAY)) {
@@ -750,6 +944,9 @@ int janet_indexed_view(Janet seq, const Janet **data, int32_t *len) {
         *data = janet_unwrap_tuple(seq);
         *len = janet_tuple_length(janet_unwrap_tuple(seq));
         return 1;
+    } else if (janet_checkabstract(seq, &janet_array_view_type)) {
+        *len = janet_array_view_items(janet_unwrap_abstract(seq), data);
+        return 1;
     }
     return 0;
 }
@@ -1003,6 +1200,92 @@ int janet_cryptorand(uint8_t *out, size_t n) {
 #endif
 }
 
+/* Parallel loops */
+
+typedef struct {
+    JanetParallelFn fn;
+    void *data;
+    int32_t i;
+    int with_vm;
+} JanetParallelTask;
+
+#ifdef JANET_THREADS
+static void janet_parallel_task(JanetParallelTask *task) {
+    if (task->with_vm) janet_init();
+    task->fn(task->data, task->i);
+    if (task->with_vm) janet_deinit();
+}
+
+#ifdef JANET_WINDOWS
+static DWORD WINAPI janet_parallel_thread(LPVOID p) {
+    janet_parallel_task((JanetParallelTask *) p);
+    return 0;
+}
+#else
+static void *janet_parallel_thread(void *p) {
+    janet_parallel_task((JanetParallelTask *) p);
+    return NULL;
+}
+#endif
+#endif
+
+void janet_parallel(int32_t n, JanetParallelFn fn, void *data, int with_vm) {
+    if (n <= 0) return;
+#ifdef JANET_THREADS
+    JanetParallelTask *tasks = janet_malloc(n * sizeof(JanetParallelTask));
+    if (NULL == tasks) {
+        JANET_OUT_OF_MEMORY;
+    }
+#ifdef JANET_WINDOWS
+    HANDLE *threads = janet_malloc(n * sizeof(HANDLE));
+#else
+    pthread_t *threads = janet_malloc(n * sizeof(pthread_t));
+#endif
+    int *started = janet_malloc(n * sizeof(int));
+    if (NULL == threads || NULL == started) {
+        JANET_OUT_OF_MEMORY;
+    }
+    for (int32_t i = 0; i < n; i++) {
+        tasks[i].fn = fn;
+        tasks[i].data = data;
+        tasks[i].i = i;
+        tasks[i].with_vm = with_vm;
+#ifdef JANET_WINDOWS
+        threads[i] = CreateThread(NULL, 0, janet_parallel_thread, tasks + i, 0, NULL);
+        started[i] = NULL != threads[i];
+#else
+        started[i] = !pthread_create(threads + i, NULL, janet_parallel_thread, tasks + i);
+#endif
+    }
+    /* Chunks that did not get a thread run here, without a new VM */
+    for (int32_t i = 0; i < n; i++) {
+        if (!started[i]) fn(data, i);
+    }
+    for (int32_t i = 0; i < n; i++) {
+        if (!started[i]) continue;
+#ifdef JANET_WINDOWS
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif
+    }
+    janet_free(started);
+    janet_free(threads);
+    janet_free(tasks);
+#else
+    (void) with_vm;
+    for (int32_t i = 0; i < n; i++) fn(data, i);
+#endif
+}
+
+int32_t janet_parallel_workers(int32_t requested, int32_t work) {
+    int32_t max = work / JANET_PARALLEL_MIN_CHUNK;
+    if (max > JANET_PARALLEL_MAX_WORKERS) max = JANET_PARALLEL_MAX_WORKERS;
+    if (requested > max) requested = max;
+    return requested < 1 ? 1 : requested;
+}
+
 /* Dynamic library loading */
 
 char *get_processed_name(const char *name) {
@@ -58,6 +58,8 @@
 #endif
 
 #define JANET_MARSHAL_DECREF 0x40000
+/* Skip bytecode verification when unmarshalling images built with this binary */
+#define JANET_MARSHAL_TRUSTED 0x80000
 
 #define janet_assert(c, m) do { \
     if (!(c)) JANET_EXIT((m)); \
@@ -65,14 +67,21 @@
 
 /* Utils */
 uint32_t janet_hash_mix(uint32_t input, uint32_t more);
+int32_t janet_hash_u64(uint64_t x);
+int32_t janet_hash_fold(uint64_t h);
 #define janet_maphash(cap, hash) ((uint32_t)(hash) & (cap - 1))
 int janet_valid_utf8(const uint8_t *str, int32_t len);
 int janet_is_symbol_char(uint8_t c);
 extern const char janet_base64[65];
+#define JANET_ARRAY_HASH_INIT 33
+#define JANET_KV_HASH_INIT 33
+uint64_t janet_array_hashstep(uint64_t state, Janet x);
 int32_t janet_array_calchash(const Janet *array, int32_t len);
+uint64_t janet_kv_hashpair(Janet key, Janet value);
 int32_t janet_kv_calchash(const JanetKV *kvs, int32_t len);
 int32_t janet_string_calchash(const uint8_t *str, int32_t len);
 int32_t janet_tablen(int32_t n);
+int32_t janet_u64_digits(uint8_t *out, uint64_t x);
 void safe_memcpy(void *dest, const void *src, size_t len);
 void janet_buffer_push_types(JanetBuffer *buffer, int types);
 const JanetKV *janet_dict_find(const JanetKV *buckets, int32_t cap, Janet key);
@@ -91,6 +100,14 @@ void janet_buffer_format(
     int32_t argstart,
     int32_t argc,
     Janet *argv);
+void janet_buffer_format_to(
+    JanetBuffer *b,
+    const char *strfrmt,
+    int32_t argstart,
+    int32_t argc,
+    Janet *argv,
+    JanetFormatWriter write,
+    void *data);
 Janet janet_next_impl(Janet ds, Janet key, int is_interpreter);
 JanetBinding janet_binding_from_entry(Janet entry);
 JanetByteView janet_text_substitution(
@@ -108,6 +125,35 @@ void janet_registry_put(
     int32_t source_line);
 JanetCFunRegistry *janet_registry_get(JanetCFunction key);
 
+/* Set in the gc flags of a funcdef whose bytecode and source map are shared
+ * with other VMs. Such a funcdef does not own these arrays, and must be given
+ * its own copy with janet_def_unshare before they can be changed. */
+#define JANET_FUNCDEF_SHARED_CODE 0x10000
+void janet_def_unshare(JanetFuncDef *def);
+
+/* Look up a dynamic binding in a fiber environment through the dyn cache */
+Janet janet_dyn_get(JanetTable *env, Janet key);
+
+/* Core functions known to type inference in the compiler */
+int janet_math_returns_number(JanetCFunction f);
+
+/* Unary math functions that can be applied to many numbers in one call */
+typedef double (*JanetMathKernel)(double);
+JanetMathKernel janet_math_kernel(JanetCFunction f);
+JanetMathKernel janet_getmathkernel(const Janet *argv, int32_t n);
+int janet_core_is_type(JanetCFunction f);
+
+/* Baseline JIT */
+#ifdef JANET_JIT
+#ifndef JANET_JIT_THRESHOLD
+#define JANET_JIT_THRESHOLD 1000
+#endif
+int janet_jit_compile(JanetFuncDef *def);
+uint32_t janet_jit_run(JanetFuncDef *def, Janet *stack, const uint32_t *pc);
+void janet_jit_free(JanetFuncDef *def);
+void janet_jit_disable(JanetFuncDef *def);
+#endif
+
 /* Inside the janet core, defining globals is different
  * at bootstrap time and normal runtime */
 #ifdef JANET_BOOTSTRAP
@@ -134,6 +180,18 @@ enum JanetTimeSource {
 int janet_gettime(struct timespec *spec, enum JanetTimeSource source);
 #endif
 
+/* Run fn(data, i) for each i in [0, n) on its own thread and wait for all of
+ * them. If with_vm is set, each thread gets a fresh Janet VM. Runs on the
+ * calling thread, one after the other, when threads are not available. */
+typedef void (*JanetParallelFn)(void *data, int32_t i);
+void janet_parallel(int32_t n, JanetParallelFn fn, void *data, int with_vm);
+
+/* Number of workers to use for `work` units of work, so that each worker
+ * gets at least JANET_PARALLEL_MIN_CHUNK units. Always at least 1. */
+#define JANET_PARALLEL_MIN_CHUNK 65536
+#define JANET_PARALLEL_MAX_WORKERS 64
+int32_t janet_parallel_workers(int32_t requested, int32_t work);
+
 /* strdup */
 #ifdef JANET_WINDOWS
 #define strdup(x) _strdup(x)
@@ -166,16 +224,42 @@ char *get_processed_name(const char *name);
 
 #define RETRY_EINTR(RC, CALL) do { (RC) = CALL; } while((RC) < 0 && errno == EINTR)
 
+/* Binary operators with a fast path for int/s64 and int/u64 in the VM */
+typedef enum {
+    JANET_INTOP_ADD,
+    JANET_INTOP_SUB,
+    JANET_INTOP_MUL,
+    JANET_INTOP_DIV,
+    JANET_INTOP_DIVF,
+    JANET_INTOP_MOD,
+    JANET_INTOP_REM,
+    JANET_INTOP_AND,
+    JANET_INTOP_OR,
+    JANET_INTOP_XOR,
+    JANET_INTOP_LSHIFT,
+    JANET_INTOP_RSHIFT
+} JanetIntOp;
+
 /* Initialize builtin libraries */
 void janet_lib_io(JanetTable *env);
 void janet_lib_math(JanetTable *env);
 void janet_lib_array(JanetTable *env);
+extern const JanetAbstractType janet_array_view_type;
+int32_t janet_array_view_items(void *p, const Janet **data);
 void janet_lib_tuple(JanetTable *env);
 void janet_lib_buffer(JanetTable *env);
+extern const JanetAbstractType janet_buffer_pool_type;
+JanetBuffer *janet_optreadbuffer(const Janet *argv, int32_t argc, int32_t n, int32_t dflt_len);
 void janet_lib_table(JanetTable *env);
 void janet_lib_struct(JanetTable *env);
+void janet_lib_hamt(JanetTable *env);
+void janet_lib_sort(JanetTable *env);
 void janet_lib_fiber(JanetTable *env);
 void janet_lib_os(JanetTable *env);
+#ifndef JANET_REDUCED_OS
+extern const JanetAbstractType janet_mmap_type;
+int janet_mmap_writable(void *p);
+#endif
 void janet_lib_string(JanetTable *env);
 void janet_lib_marsh(JanetTable *env);
 void janet_lib_parse(JanetTable *env);
@@ -192,6 +276,7 @@ void janet_lib_typed_array(JanetTable *env);
 #endif
 #ifdef JANET_INT_TYPES
 void janet_lib_inttypes(JanetTable *env);
+int janet_int_binop(JanetIntOp op, Janet lhs, Janet rhs, Janet *out);
 #endif
 #ifdef JANET_NET
 void janet_lib_net(JanetTable *env);
@@ -201,6 +286,26 @@ extern const JanetAbstractType janet_address_type;
 void janet_lib_ev(JanetTable *env);
 void janet_ev_mark(void);
 int janet_make_pipe(JanetHandle handles[2], int mode);
+JanetTuple janet_ev_write_items(const Janet *argv, int32_t n);
+const uint8_t *janet_string_threaded(const uint8_t *bytes, int32_t len);
+int janet_string_is_threaded(const uint8_t *str);
+int32_t janet_string_incref(const uint8_t *str);
+int32_t janet_string_decref(const uint8_t *str);
+int janet_share_symbols(void);
+int janet_symbol_is_shared(const uint8_t *sym);
+const uint8_t *janet_symbol_adopt(const uint8_t *sym);
+void *janet_atomic_load_ptr(void **slot);
+int janet_atomic_cas_ptr(void **slot, void *expected, void *value);
+uint32_t janet_atomic_load_u32(uint32_t *slot);
+void janet_atomic_store_u32(uint32_t *slot, uint32_t value);
+typedef struct JanetImageCode JanetImageCode;
+Janet janet_unmarshal_shared(
+    const uint8_t *bytes,
+    size_t len,
+    int flags,
+    JanetTable *reg,
+    JanetImageCode **code);
+void janet_registry_share(void);
 #endif
 #ifdef JANET_FFI
 void janet_lib_ffi(JanetTable *env);
@@ -296,15 +296,6 @@ int janet_equals(Janet x, Janet y) {
     return 1;
 }
 
-static uint64_t murmur64(uint64_t h) {
-    h ^= h >> 33;
-    h *= 0xff51afd7ed558ccdUL;
-    h ^= h >> 33;
-    h *= 0xc4ceb9fe1a85ec53UL;
-    h ^= h >> 33;
-    return h;
-}
-
 /* Computes a hash value for a function */
 int32_t janet_hash(Janet x) {
     int32_t hash = 0;
@@ -334,10 +325,7 @@ int32_t janet_hash(Janet x) {
             } as;
             as.d = janet_unwrap_number(x);
             as.d += 0.0; /* normalize negative 0 */
-            uint32_t lo = (uint32_t)(as.u & 0xFFFFFFFF);
-            uint32_t hi = (uint32_t)(as.u >> 32);
-            uint32_t hilo = (hi ^ lo) * 2654435769u;
-            hash = (int32_t)((hilo << 16) | (hilo >> 16));
+            hash = janet_hash_u64(as.u);
             break;
         }
         case JANET_ABSTRACT: {
@@ -350,16 +338,7 @@ int32_t janet_hash(Janet x) {
         }
         /* fallthrough */
         default:
-            if (sizeof(double) == sizeof(void *)) {
-                /* Assuming 8 byte pointer (8 byte aligned) */
-                uint64_t i = murmur64(janet_u64(x));
-                hash = (int32_t)(i >> 32);
-            } else {
-                /* Assuming 4 byte pointer (or smaller) */
-                uintptr_t diff = (uintptr_t) janet_unwrap_pointer(x);
-                uint32_t hilo = (uint32_t) diff * 2654435769u;
-                hash = (int32_t)((hilo << 16) | (hilo >> 16));
-            }
+            hash = janet_hash_u64((uint64_t)(uintptr_t) janet_unwrap_pointer(x));
             break;
     }
     return hash;
@@ -91,11 +91,27 @@
 
 /* Next instruction variations */
 #define maybe_collect() do {\
-    if (janet_vm.next_collection >= janet_vm.gc_interval) janet_collect(); } while (0)
+    if (janet_vm.next_collection >= janet_vm.gc_interval || \
+            janet_vm.next_collection >= janet_vm.gc_headroom) { \
+        vm_commit(); \
+        janet_gc_safepoint(); \
+    } \
+    else if (NULL != janet_vm.sweep_blocks) janet_gc_sweep_step(); } while (0)
 #define vm_checkgc_next() maybe_collect(); vm_next()
 #define vm_pcnext() pc++; vm_next()
 #define vm_checkgc_pcnext() maybe_collect(); vm_pcnext()
 
+/* Continue a fused instruction with the instruction that follows it, jumping
+ * straight to its handler instead of dispatching. The second instruction is
+ * left in the bytecode, so if it is not what we expect (a breakpoint was set on
+ * it, for example), just dispatch normally. */
+#ifdef JANET_USE_COMPUTED_GOTOS
+#define vm_fused_next(op) { pc++; if ((*pc & 0xFF) == (op)) goto label_##op; vm_next(); }
+#else
+#define vm_fused_next(op) { pc++; vm_next(); }
+#endif
+#define vm_checkgc_fused_next(op) maybe_collect(); vm_fused_next(op)
+
 /* Handle certain errors in main vm loop */
 #define vm_throw(e) do { vm_commit(); janet_panic(e); } while (0)
 #define vm_assert(cond, e) do {if (!(cond)) vm_throw((e)); } while (0)
@@ -111,10 +127,17 @@
         janet_panicf("expected %T, got %v", (TS), (X)); \
     } \
 } while (0)
+#define vm_maybe_profile(COND) do { \
+    if ((COND) && janet_vm.profile_sample) { \
+        vm_commit(); \
+        janet_profile_sample(); \
+    } \
+} while (0)
 #ifdef JANET_NO_INTERPRETER_INTERRUPT
-#define vm_maybe_auto_suspend(COND)
+#define vm_maybe_auto_suspend(COND) vm_maybe_profile(COND)
 #else
 #define vm_maybe_auto_suspend(COND) do { \
+    vm_maybe_profile(COND); \
     if ((COND) && janet_vm.auto_suspend) { \
         janet_vm.auto_suspend = 0; \
         fiber->flags |= (JANET_FIBER_RESUME_NO_USEVAL | JANET_FIBER_RESUME_NO_SKIP); \
@@ -123,28 +146,43 @@
 } while (0)
 #endif
 
+/* Run native code for the current function if it is hot, starting at pc. Functions
+ * get hot by being called or by looping. */
+#ifdef JANET_JIT
+#define vm_maybe_jit(COND) do { \
+    if (COND) { \
+        JanetFuncDef *_def = func->def; \
+        if (NULL != _def->jit || \
+                (_def->jit_count >= 0 && ++_def->jit_count == JANET_JIT_THRESHOLD && janet_jit_compile(_def))) { \
+            pc = _def->bytecode + janet_jit_run(_def, stack, pc); \
+        } \
+    } \
+} while (0)
+#else
+#define vm_maybe_jit(COND)
+#endif
+
 /* Templates for certain patterns in opcodes */
-#define vm_binop_immediate(op)\
+#define _vm_binop_immediate(op, intop, next, checkgc_next)\
     {\
         Janet op1 = stack[B];\
         if (!janet_checktype(op1, JANET_NUMBER)) {\
             vm_commit();\
-            Janet _argv[2] = { op1, janet_wrap_number(CS) };\
-            stack[A] = janet_mcall(#op, 2, _argv);\
-            vm_checkgc_pcnext();\
+            stack[A] = janet_binop_imm(intop, #op, op1, janet_wrap_number(CS));\
+            checkgc_next;\
         } else {\
             double x1 = janet_unwrap_number(op1);\
             stack[A] = janet_wrap_number(x1 op CS);\
-            vm_pcnext();\
+            next;\
         }\
     }
-#define _vm_bitop_immediate(op, type1, rangecheck, msg)\
+#define vm_binop_immediate(op, intop) _vm_binop_immediate(op, intop, vm_pcnext(), vm_checkgc_pcnext())
+#define _vm_bitop_immediate(op, intop, type1, rangecheck, msg)\
     {\
         Janet op1 = stack[B];\
         if (!janet_checktype(op1, JANET_NUMBER)) {\
             vm_commit();\
-            Janet _argv[2] = { op1, janet_wrap_number(CS) };\
-            stack[A] = janet_mcall(#op, 2, _argv);\
+            stack[A] = janet_binop_imm(intop, #op, op1, janet_wrap_number(CS));\
             vm_checkgc_pcnext();\
         } else {\
             double y1 = janet_unwrap_number(op1);\
@@ -154,9 +192,9 @@
             vm_pcnext();\
         }\
     }
-#define vm_bitop_immediate(op) _vm_bitop_immediate(op, int32_t, janet_checkintrange, "32-bit signed integers");
-#define vm_bitopu_immediate(op) _vm_bitop_immediate(op, uint32_t, janet_checkuintrange, "32-bit unsigned integers");
-#define _vm_binop(op, wrap)\
+#define vm_bitop_immediate(op, intop) _vm_bitop_immediate(op, intop, int32_t, janet_checkintrange, "32-bit signed integers");
+#define vm_bitopu_immediate(op, intop) _vm_bitop_immediate(op, intop, uint32_t, janet_checkuintrange, "32-bit unsigned integers");
+#define _vm_binop(op, intop, wrap)\
     {\
         Janet op1 = stack[B];\
         Janet op2 = stack[C];\
@@ -167,12 +205,12 @@
             vm_pcnext();\
         } else {\
             vm_commit();\
-            stack[A] = janet_binop_call(#op, "r" #op, op1, op2);\
+            stack[A] = janet_binop_int(intop, #op, "r" #op, op1, op2);\
             vm_checkgc_pcnext();\
         }\
     }
-#define vm_binop(op) _vm_binop(op, janet_wrap_number)
-#define _vm_bitop(op, type1, rangecheck, msg)\
+#define vm_binop(op, intop) _vm_binop(op, intop, janet_wrap_number)
+#define _vm_bitop(op, intop, type1, rangecheck, msg)\
     {\
         Janet op1 = stack[B];\
         Janet op2 = stack[C];\
@@ -187,13 +225,13 @@
             vm_pcnext();\
         } else {\
             vm_commit();\
-            stack[A] = janet_binop_call(#op, "r" #op, op1, op2);\
+            stack[A] = janet_binop_int(intop, #op, "r" #op, op1, op2);\
             vm_checkgc_pcnext();\
         }\
     }
-#define vm_bitop(op) _vm_bitop(op, int32_t, janet_checkintrange, "32-bit signed integers")
-#define vm_bitopu(op) _vm_bitop(op, uint32_t, janet_checkuintrange, "32-bit unsigned integers")
-#define vm_compop(op) \
+#define vm_bitop(op, intop) _vm_bitop(op, intop, int32_t, janet_checkintrange, "32-bit signed integers")
+#define vm_bitopu(op, intop) _vm_bitop(op, intop, uint32_t, janet_checkuintrange, "32-bit unsigned integers")
+#define _vm_compop(op, next, checkgc_next) \
     {\
         Janet op1 = stack[B];\
         Janet op2 = stack[C];\
@@ -201,30 +239,55 @@
             double x1 = janet_unwrap_number(op1);\
             double x2 = janet_unwrap_number(op2);\
             stack[A] = janet_wrap_boolean(x1 op x2);\
-            vm_pcnext();\
+            next;\
         } else {\
             vm_commit();\
             stack[A] = janet_wrap_boolean(janet_compare(op1, op2) op 0);\
-            vm_checkgc_pcnext();\
+            checkgc_next;\
         }\
     }
-#define vm_compop_imm(op) \
+#define _vm_compop_imm(op, next, checkgc_next) \
     {\
         Janet op1 = stack[B];\
         if (janet_checktype(op1, JANET_NUMBER)) {\
             double x1 = janet_unwrap_number(op1);\
             double x2 = (double) CS; \
             stack[A] = janet_wrap_boolean(x1 op x2);\
-            vm_pcnext();\
+            next;\
         } else {\
             vm_commit();\
             stack[A] = janet_wrap_boolean(janet_compare(op1, janet_wrap_integer(CS)) op 0);\
-            vm_checkgc_pcnext();\
+            checkgc_next;\
         }\
     }
+#define vm_compop(op) _vm_compop(op, vm_pcnext(), vm_checkgc_pcnext())
+#define vm_compop_imm(op) _vm_compop_imm(op, vm_pcnext(), vm_checkgc_pcnext())
+
+/* Arithmetic and comparisons on slots the compiler has proven to be numbers.
+ * NaNs are canonicalized so that bad bytecode cannot make pointers. */
+#define vm_numop(op)\
+    {\
+        double x1 = janet_unwrap_number(stack[B]);\
+        double x2 = janet_unwrap_number(stack[C]);\
+        double r = x1 op x2;\
+        stack[A] = janet_wrap_number(isnan(r) ? NAN : r);\
+        vm_pcnext();\
+    }
+#define vm_numcompop(op)\
+    {\
+        double x1 = janet_unwrap_number(stack[B]);\
+        double x2 = janet_unwrap_number(stack[C]);\
+        stack[A] = janet_wrap_boolean(x1 op x2);\
+        vm_pcnext();\
+    }
 
-/* Trace a function call */
+/* Trace a function call. Calls are reported to the trace hook if there is
+ * one, and printed to stderr otherwise. */
 static void vm_do_trace(JanetFunction *func, int32_t argc, const Janet *argv) {
+    if (janet_vm.trace_hook) {
+        janet_trace_emit(JANET_TRACE_CALL, janet_vm.fiber, func, func->def->name, argc);
+        return;
+    }
     if (func->def->name) {
         janet_eprintf("trace (%S", func->def->name);
     } else {
@@ -236,6 +299,19 @@ static void vm_do_trace(JanetFunction *func, int32_t argc, const Janet *argv) {
     janet_eprintf(")\n");
 }
 
+/* Mark the frame of a traced function so that its return is reported */
+static void vm_trace_frame(JanetFiber *fiber) {
+    if (janet_vm.trace_hook) {
+        janet_fiber_frame(fiber)->flags |= JANET_STACKFRAME_TRACE;
+    }
+}
+
+/* Report the return of a traced function */
+static void vm_trace_return(JanetStackFrame *frame) {
+    frame->flags &= ~JANET_STACKFRAME_TRACE;
+    janet_trace_event(JANET_TRACE_RETURN, janet_vm.fiber, frame->func, frame->func->def->name, 0);
+}
+
 /* Invoke a method once we have looked it up */
 static Janet janet_method_invoke(Janet method, int32_t argc, Janet *argv) {
     switch (janet_type(method)) {
@@ -281,16 +357,155 @@ static Janet call_nonfn(JanetFiber *fiber, Janet callee) {
     return janet_method_invoke(callee, argc, fiber->data + fiber->stacktop);
 }
 
+/* Set up the frame for a call to a function from a JOP_CALL instruction. Calls
+ * with exactly as many arguments as parameters and no varargs are the common
+ * case. The arguments are already in place as the first slots of the new frame,
+ * so only the other slots need to be cleared. Other calls, and calls that need
+ * the stack to grow, go through janet_fiber_funcframe. */
+static int vm_funcframe(JanetFiber *fiber, JanetFunction *func) {
+#ifndef JANET_DEBUG
+    JanetFuncDef *def = func->def;
+    int32_t nextframe = fiber->stackstart;
+    int32_t nextstacktop = nextframe + def->slotcount + JANET_FRAME_SIZE;
+    if (fiber->stacktop - nextframe == def->arity &&
+            !(def->flags & JANET_FUNCDEF_FLAG_VARARG) &&
+            nextstacktop <= fiber->capacity) {
+        for (int32_t i = fiber->stacktop; i < nextstacktop; i++) {
+            fiber->data[i] = janet_wrap_nil();
+        }
+        JanetStackFrame *frame = janet_stack_frame(fiber->data + nextframe);
+        frame->prevframe = fiber->frame;
+        frame->pc = def->bytecode;
+        frame->func = func;
+        frame->env = NULL;
+        frame->flags = 0;
+        fiber->frame = nextframe;
+        fiber->stacktop = fiber->stackstart = nextstacktop;
+        return 0;
+    }
+#endif
+    return janet_fiber_funcframe(fiber, func);
+}
+
+/* Call a cfunction with the arguments on the fiber stack. This is
+ * janet_fiber_cframe and janet_fiber_popframe without the function calls, as a
+ * cfunction frame has no closure environment to detach. */
+static Janet vm_call_cfunction(JanetFiber *fiber, JanetCFunction cfun) {
+    int32_t argc = fiber->stacktop - fiber->stackstart;
+    int32_t nextframe = fiber->stackstart;
+    int32_t nextstacktop = fiber->stacktop + JANET_FRAME_SIZE;
+#ifndef JANET_DEBUG
+    if (nextstacktop <= fiber->capacity) {
+        JanetStackFrame *frame = janet_stack_frame(fiber->data + nextframe);
+        frame->prevframe = fiber->frame;
+        frame->pc = (uint32_t *) cfun;
+        frame->func = NULL;
+        frame->env = NULL;
+        frame->flags = 0;
+        fiber->frame = nextframe;
+        fiber->stacktop = fiber->stackstart = nextstacktop;
+    } else
+#endif
+    {
+        janet_fiber_cframe(fiber, cfun);
+    }
+    Janet ret = cfun(argc, fiber->data + fiber->frame);
+    JanetStackFrame *frame = janet_fiber_frame(fiber);
+    fiber->stacktop = fiber->stackstart = fiber->frame;
+    fiber->frame = frame->prevframe;
+    return ret;
+}
+
+/* Get the values of an array or tuple, for the fast paths of the indexing
+ * and iteration instructions. Returns 0 for other types. */
+static int vm_indexed_view(Janet ds, const Janet **data, int32_t *len) {
+    if (janet_checktype(ds, JANET_ARRAY)) {
+        JanetArray *array = janet_unwrap_array(ds);
+        *data = array->data;
+        *len = array->count;
+        return 1;
+    }
+    if (janet_checktype(ds, JANET_TUPLE)) {
+        const Janet *tuple = janet_unwrap_tuple(ds);
+        *data = tuple;
+        *len = janet_tuple_length(tuple);
+        return 1;
+    }
+    return 0;
+}
+
+/* Compare keys for the inline cache. Only identical values match, which
+ * is enough for keywords and symbols, the common case. */
+#if defined(JANET_NANBOX_64) || defined(JANET_NANBOX_32)
+#define janet_cache_keyeq(a, b) ((a).u64 == (b).u64)
+#else
+#define janet_cache_keyeq(a, b) ((a).type == (b).type && (a).as.u64 == (b).as.u64)
+#endif
+
+/* Get a value from a table, using an inline cache slot. A slot is valid as
+ * long as the table has the same version and prototype, and no prototype
+ * looked through by any slot has changed since. Tables without a version
+ * are looked up directly. */
+static Janet vm_table_get_ic(JanetInlineCache *ic, JanetTable *t, Janet key) {
+    int versioned = t->gc.flags & JANET_TABLE_FLAG_VERSIONED;
+    if (versioned &&
+            ic->table == t &&
+            ic->version == janet_table_version(t) &&
+            ic->proto == t->proto &&
+            ic->epoch == janet_vm.proto_epoch &&
+            janet_cache_keyeq(ic->key, key)) {
+        return ic->value;
+    }
+    Janet value = janet_wrap_nil();
+    JanetTable *p = t;
+    for (int i = JANET_MAX_PROTO_DEPTH; p && i; p = p->proto, --i) {
+        if (p != t) p->gc.flags |= JANET_TABLE_FLAG_PROTO;
+        JanetKV *bucket = janet_table_find(p, key);
+        if (NULL != bucket && !janet_checktype(bucket->key, JANET_NIL)) {
+            value = bucket->value;
+            break;
+        }
+    }
+    if (!versioned) return value;
+    ic->table = t;
+    ic->proto = t->proto;
+    ic->version = janet_table_version(t);
+    ic->epoch = janet_vm.proto_epoch;
+    ic->key = key;
+    ic->value = value;
+    return value;
+}
+
+/* Use the inline cache slot of the instruction at pc */
+static Janet vm_table_get_cached(JanetTable *t, Janet key, const uint32_t *pc) {
+    JanetInlineCache *ic = janet_vm.inline_cache +
+                           ((((uintptr_t) pc) >> 2) & (JANET_INLINE_CACHE_SIZE - 1));
+    return vm_table_get_ic(ic, t, key);
+}
+
+/* Dynamic bindings are usually read through deep prototype chains of fiber
+ * environments, so cache them by environment and key. setdyn and
+ * fiber/setenv change the table version or the table itself, which
+ * invalidates the slot. */
+Janet janet_dyn_get(JanetTable *env, Janet key) {
+    uint32_t slot = (uint32_t)(((uintptr_t) env) >> 4) ^ (uint32_t) janet_hash(key);
+    JanetInlineCache *ic = janet_vm.dyn_cache + (slot & (JANET_DYN_CACHE_SIZE - 1));
+    return vm_table_get_ic(ic, env, key);
+}
+
 /* Method lookup could potentially handle tables specially... */
 static Janet method_to_fun(Janet method, Janet obj) {
     return janet_get(obj, method);
 }
 
 /* Get a callable from a keyword method name and ensure that it is valid. */
-static Janet resolve_method(Janet name, JanetFiber *fiber) {
+static Janet resolve_method(Janet name, JanetFiber *fiber, const uint32_t *pc) {
     int32_t argc = fiber->stacktop - fiber->stackstart;
     if (argc < 1) janet_panicf("method call (%v) takes at least 1 argument, got 0", name);
-    Janet callee = method_to_fun(name, fiber->data[fiber->stackstart]);
+    Janet self = fiber->data[fiber->stackstart];
+    Janet callee = janet_checktype(self, JANET_TABLE)
+                   ? vm_table_get_cached(janet_unwrap_table(self), name, pc)
+                   : method_to_fun(name, self);
     if (janet_checktype(callee, JANET_NIL))
         janet_panicf("unknown method %v invoked on %v", name, fiber->data[fiber->stackstart]);
     return callee;
@@ -330,6 +545,30 @@ static Janet janet_binop_call(const char *lmethod, const char *rmethod, Janet lh
     }
 }
 
+/* Binary operator on at least one non-number operand. int/s64 and int/u64
+ * operands skip the method lookup by name. */
+static Janet janet_binop_int(JanetIntOp intop, const char *lmethod, const char *rmethod, Janet lhs, Janet rhs) {
+#ifdef JANET_INT_TYPES
+    Janet out;
+    if (janet_int_binop(intop, lhs, rhs, &out)) return out;
+#else
+    (void) intop;
+#endif
+    return janet_binop_call(lmethod, rmethod, lhs, rhs);
+}
+
+/* Same as above for immediate operands, which only try the method of lhs */
+static Janet janet_binop_imm(JanetIntOp intop, const char *method, Janet lhs, Janet rhs) {
+#ifdef JANET_INT_TYPES
+    Janet out;
+    if (janet_checktype(lhs, JANET_ABSTRACT) && janet_int_binop(intop, lhs, rhs, &out)) return out;
+#else
+    (void) intop;
+#endif
+    Janet argv[2] = { lhs, rhs };
+    return janet_mcall(method, 2, argv);
+}
+
 /* Forward declaration */
 static JanetSignal janet_check_can_resume(JanetFiber *fiber, Janet *out, int is_cancel);
 static JanetSignal janet_continue_no_check(JanetFiber *fiber, Janet in, Janet *out);
@@ -417,28 +656,28 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
         &&label_JOP_NOT_EQUALS,
         &&label_JOP_NOT_EQUALS_IMMEDIATE,
         &&label_JOP_CANCEL,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
-        &&label_unknown_op,
+        &&label_JOP_LESS_THAN_JUMP_IF_NOT,
+        &&label_JOP_LESS_THAN_IMMEDIATE_JUMP_IF_NOT,
+        &&label_JOP_LESS_THAN_EQUAL_JUMP_IF_NOT,
+        &&label_JOP_GREATER_THAN_JUMP_IF_NOT,
+        &&label_JOP_GREATER_THAN_IMMEDIATE_JUMP_IF_NOT,
+        &&label_JOP_GREATER_THAN_EQUAL_JUMP_IF_NOT,
+        &&label_JOP_EQUALS_JUMP_IF_NOT,
+        &&label_JOP_EQUALS_IMMEDIATE_JUMP_IF_NOT,
+        &&label_JOP_NOT_EQUALS_JUMP_IF_NOT,
+        &&label_JOP_NOT_EQUALS_IMMEDIATE_JUMP_IF_NOT,
+        &&label_JOP_ADD_IMMEDIATE_JUMP,
+        &&label_JOP_LOAD_CONSTANT_GET,
+        &&label_JOP_LOAD_CONSTANT_CALL,
+        &&label_JOP_PUSH_CALL,
+        &&label_JOP_ADD_NUMBER,
+        &&label_JOP_SUBTRACT_NUMBER,
+        &&label_JOP_MULTIPLY_NUMBER,
+        &&label_JOP_DIVIDE_NUMBER,
+        &&label_JOP_LESS_THAN_NUMBER,
+        &&label_JOP_LESS_THAN_EQUAL_NUMBER,
+        &&label_JOP_GREATER_THAN_NUMBER,
+        &&label_JOP_GREATER_THAN_EQUAL_NUMBER,
         &&label_unknown_op,
         &&label_unknown_op,
         &&label_unknown_op,
@@ -659,7 +898,9 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
 
     VM_OP(JOP_RETURN) {
         Janet retval = stack[D];
-        int entrance_frame = janet_stack_frame(stack)->flags & JANET_STACKFRAME_ENTRANCE;
+        JanetStackFrame *frame = janet_stack_frame(stack);
+        if (frame->flags & JANET_STACKFRAME_TRACE) vm_trace_return(frame);
+        int entrance_frame = frame->flags & JANET_STACKFRAME_ENTRANCE;
         janet_fiber_popframe(fiber);
         if (entrance_frame) vm_return_no_restore(JANET_SIGNAL_OK, retval);
         vm_restore();
@@ -669,7 +910,9 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
 
     VM_OP(JOP_RETURN_NIL) {
         Janet retval = janet_wrap_nil();
-        int entrance_frame = janet_stack_frame(stack)->flags & JANET_STACKFRAME_ENTRANCE;
+        JanetStackFrame *frame = janet_stack_frame(stack);
+        if (frame->flags & JANET_STACKFRAME_TRACE) vm_trace_return(frame);
+        int entrance_frame = frame->flags & JANET_STACKFRAME_ENTRANCE;
         janet_fiber_popframe(fiber);
         if (entrance_frame) vm_return_no_restore(JANET_SIGNAL_OK, retval);
         vm_restore();
@@ -678,28 +921,28 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
     }
 
     VM_OP(JOP_ADD_IMMEDIATE)
-    vm_binop_immediate(+);
+    vm_binop_immediate(+, JANET_INTOP_ADD);
 
     VM_OP(JOP_ADD)
-    vm_binop(+);
+    vm_binop(+, JANET_INTOP_ADD);
 
     VM_OP(JOP_SUBTRACT_IMMEDIATE)
-    vm_binop_immediate(-);
+    vm_binop_immediate(-, JANET_INTOP_SUB);
 
     VM_OP(JOP_SUBTRACT)
-    vm_binop(-);
+    vm_binop(-, JANET_INTOP_SUB);
 
     VM_OP(JOP_MULTIPLY_IMMEDIATE)
-    vm_binop_immediate(*);
+    vm_binop_immediate(*, JANET_INTOP_MUL);
 
     VM_OP(JOP_MULTIPLY)
-    vm_binop(*);
+    vm_binop(*, JANET_INTOP_MUL);
 
     VM_OP(JOP_DIVIDE_IMMEDIATE)
-    vm_binop_immediate( /);
+    vm_binop_immediate( /, JANET_INTOP_DIV);
 
     VM_OP(JOP_DIVIDE)
-    vm_binop( /);
+    vm_binop( /, JANET_INTOP_DIV);
 
     VM_OP(JOP_DIVIDE_FLOOR) {
         Janet op1 = stack[B];
@@ -711,7 +954,7 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
             vm_pcnext();
         } else {
             vm_commit();
-            stack[A] = janet_binop_call("div", "rdiv", op1, op2);
+            stack[A] = janet_binop_int(JANET_INTOP_DIVF, "div", "rdiv", op1, op2);
             vm_checkgc_pcnext();
         }
     }
@@ -731,7 +974,7 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
             vm_pcnext();
         } else {
             vm_commit();
-            stack[A] = janet_binop_call("mod", "rmod", op1, op2);
+            stack[A] = janet_binop_int(JANET_INTOP_MOD, "mod", "rmod", op1, op2);
             vm_checkgc_pcnext();
         }
     }
@@ -746,19 +989,19 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
             vm_pcnext();
         } else {
             vm_commit();
-            stack[A] = janet_binop_call("%", "r%", op1, op2);
+            stack[A] = janet_binop_int(JANET_INTOP_REM, "%", "r%", op1, op2);
             vm_checkgc_pcnext();
         }
     }
 
     VM_OP(JOP_BAND)
-    vm_bitop(&);
+    vm_bitop(&, JANET_INTOP_AND);
 
     VM_OP(JOP_BOR)
-    vm_bitop( |);
+    vm_bitop( |, JANET_INTOP_OR);
 
     VM_OP(JOP_BXOR)
-    vm_bitop(^);
+    vm_bitop(^, JANET_INTOP_XOR);
 
     VM_OP(JOP_BNOT) {
         Janet op = stack[E];
@@ -773,22 +1016,22 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
     }
 
     VM_OP(JOP_SHIFT_RIGHT_UNSIGNED)
-    vm_bitopu( >>);
+    vm_bitopu( >>, JANET_INTOP_RSHIFT);
 
     VM_OP(JOP_SHIFT_RIGHT_UNSIGNED_IMMEDIATE)
-    vm_bitopu_immediate( >>);
+    vm_bitopu_immediate( >>, JANET_INTOP_RSHIFT);
 
     VM_OP(JOP_SHIFT_RIGHT)
-    vm_bitop( >>);
+    vm_bitop( >>, JANET_INTOP_RSHIFT);
 
     VM_OP(JOP_SHIFT_RIGHT_IMMEDIATE)
-    vm_bitop_immediate( >>);
+    vm_bitop_immediate( >>, JANET_INTOP_RSHIFT);
 
     VM_OP(JOP_SHIFT_LEFT)
-    vm_bitop( <<);
+    vm_bitop( <<, JANET_INTOP_LSHIFT);
 
     VM_OP(JOP_SHIFT_LEFT_IMMEDIATE)
-    vm_bitop_immediate( <<);
+    vm_bitop_immediate( <<, JANET_INTOP_LSHIFT);
 
     VM_OP(JOP_MOVE_NEAR)
     stack[A] = stack[E];
@@ -798,15 +1041,21 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
     stack[E] = stack[A];
     vm_pcnext();
 
-    VM_OP(JOP_JUMP)
-    pc += DS;
-    vm_maybe_auto_suspend(DS < 0);
-    vm_next();
+    VM_OP(JOP_JUMP) {
+        /* Read the offset before moving pc, which changes what DS refers to */
+        int32_t offset = DS;
+        pc += offset;
+        vm_maybe_auto_suspend(offset < 0);
+        vm_maybe_jit(offset < 0);
+        vm_next();
+    }
 
     VM_OP(JOP_JUMP_IF)
     if (janet_truthy(stack[A])) {
-        pc += ES;
-        vm_maybe_auto_suspend(ES < 0);
+        int32_t offset = ES;
+        pc += offset;
+        vm_maybe_auto_suspend(offset < 0);
+        vm_maybe_jit(offset < 0);
     } else {
         pc++;
     }
@@ -816,15 +1065,19 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
     if (janet_truthy(stack[A])) {
         pc++;
     } else {
-        pc += ES;
-        vm_maybe_auto_suspend(ES < 0);
+        int32_t offset = ES;
+        pc += offset;
+        vm_maybe_auto_suspend(offset < 0);
+        vm_maybe_jit(offset < 0);
     }
     vm_next();
 
     VM_OP(JOP_JUMP_IF_NIL)
     if (janet_checktype(stack[A], JANET_NIL)) {
-        pc += ES;
-        vm_maybe_auto_suspend(ES < 0);
+        int32_t offset = ES;
+        pc += offset;
+        vm_maybe_auto_suspend(offset < 0);
+        vm_maybe_jit(offset < 0);
     } else {
         pc++;
     }
@@ -834,8 +1087,10 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
     if (janet_checktype(stack[A], JANET_NIL)) {
         pc++;
     } else {
-        pc += ES;
-        vm_maybe_auto_suspend(ES < 0);
+        int32_t offset = ES;
+        pc += offset;
+        vm_maybe_auto_suspend(offset < 0);
+        vm_maybe_jit(offset < 0);
     }
     vm_next();
 
@@ -877,7 +1132,21 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
     stack[A] = janet_wrap_integer(janet_compare(stack[B], stack[C]));
     vm_pcnext();
 
-    VM_OP(JOP_NEXT)
+    VM_OP(JOP_NEXT) {
+        const Janet *data;
+        int32_t len;
+        if (vm_indexed_view(stack[B], &data, &len)) {
+            if (janet_checktype(stack[C], JANET_NIL)) {
+                stack[A] = len > 0 ? janet_wrap_integer(0) : janet_wrap_nil();
+                vm_pcnext();
+            }
+            if (janet_checkint(stack[C])) {
+                int32_t i = janet_unwrap_integer(stack[C]) + 1;
+                stack[A] = (i >= 0 && i < len) ? janet_wrap_integer(i) : janet_wrap_nil();
+                vm_pcnext();
+            }
+        }
+    }
     vm_commit();
     {
         Janet temp = janet_next_impl(stack[B], stack[C], 1);
@@ -982,18 +1251,37 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
     }
 
     VM_OP(JOP_PUSH)
-    janet_fiber_push(fiber, stack[D]);
-    stack = fiber->data + fiber->frame;
+    if (fiber->stacktop < fiber->capacity) {
+        fiber->data[fiber->stacktop++] = stack[D];
+    } else {
+        janet_fiber_push(fiber, stack[D]);
+        stack = fiber->data + fiber->frame;
+    }
     vm_checkgc_pcnext();
 
     VM_OP(JOP_PUSH_2)
-    janet_fiber_push2(fiber, stack[A], stack[E]);
-    stack = fiber->data + fiber->frame;
+    if (fiber->stacktop + 2 <= fiber->capacity) {
+        Janet *top = fiber->data + fiber->stacktop;
+        top[0] = stack[A];
+        top[1] = stack[E];
+        fiber->stacktop += 2;
+    } else {
+        janet_fiber_push2(fiber, stack[A], stack[E]);
+        stack = fiber->data + fiber->frame;
+    }
     vm_checkgc_pcnext();
 
     VM_OP(JOP_PUSH_3)
-    janet_fiber_push3(fiber, stack[A], stack[B], stack[C]);
-    stack = fiber->data + fiber->frame;
+    if (fiber->stacktop + 3 <= fiber->capacity) {
+        Janet *top = fiber->data + fiber->stacktop;
+        top[0] = stack[A];
+        top[1] = stack[B];
+        top[2] = stack[C];
+        fiber->stacktop += 3;
+    } else {
+        janet_fiber_push3(fiber, stack[A], stack[B], stack[C]);
+        stack = fiber->data + fiber->frame;
+    }
     vm_checkgc_pcnext();
 
     VM_OP(JOP_PUSH_ARRAY) {
@@ -1016,7 +1304,7 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
         }
         if (janet_checktype(callee, JANET_KEYWORD)) {
             vm_commit();
-            callee = resolve_method(callee, fiber);
+            callee = resolve_method(callee, fiber, pc);
         }
         if (janet_checktype(callee, JANET_FUNCTION)) {
             func = janet_unwrap_function(callee);
@@ -1024,20 +1312,19 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
                 vm_do_trace(func, fiber->stacktop - fiber->stackstart, fiber->data + fiber->stackstart);
             }
             vm_commit();
-            if (janet_fiber_funcframe(fiber, func)) {
+            if (vm_funcframe(fiber, func)) {
                 int32_t n = fiber->stacktop - fiber->stackstart;
                 janet_panicf("%v called with %d argument%s, expected %d",
                              callee, n, n == 1 ? "" : "s", func->def->arity);
             }
+            if (func->gc.flags & JANET_FUNCFLAG_TRACE) vm_trace_frame(fiber);
             stack = fiber->data + fiber->frame;
             pc = func->def->bytecode;
+            vm_maybe_jit(1);
             vm_checkgc_next();
         } else if (janet_checktype(callee, JANET_CFUNCTION)) {
             vm_commit();
-            int32_t argc = fiber->stacktop - fiber->stackstart;
-            janet_fiber_cframe(fiber, janet_unwrap_cfunction(callee));
-            Janet ret = janet_unwrap_cfunction(callee)(argc, fiber->data + fiber->frame);
-            janet_fiber_popframe(fiber);
+            Janet ret = vm_call_cfunction(fiber, janet_unwrap_cfunction(callee));
             stack = fiber->data + fiber->frame;
             stack[A] = ret;
             vm_checkgc_pcnext();
@@ -1054,9 +1341,12 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
         if (fiber->stacktop > fiber->maxstack) {
             vm_throw("stack overflow");
         }
+        if (janet_stack_frame(stack)->flags & JANET_STACKFRAME_TRACE) {
+            vm_trace_return(janet_stack_frame(stack));
+        }
         if (janet_checktype(callee, JANET_KEYWORD)) {
             vm_commit();
-            callee = resolve_method(callee, fiber);
+            callee = resolve_method(callee, fiber, pc);
         }
         if (janet_checktype(callee, JANET_FUNCTION)) {
             func = janet_unwrap_function(callee);
@@ -1069,18 +1359,17 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
                 janet_panicf("%v called with %d argument%s, expected %d",
                              callee, n, n == 1 ? "" : "s", func->def->arity);
             }
+            if (func->gc.flags & JANET_FUNCFLAG_TRACE) vm_trace_frame(fiber);
             stack = fiber->data + fiber->frame;
             pc = func->def->bytecode;
+            vm_maybe_jit(1);
             vm_checkgc_next();
         } else {
             Janet retreg;
             int entrance_frame = janet_stack_frame(stack)->flags & JANET_STACKFRAME_ENTRANCE;
             vm_commit();
             if (janet_checktype(callee, JANET_CFUNCTION)) {
-                int32_t argc = fiber->stacktop - fiber->stackstart;
-                janet_fiber_cframe(fiber, janet_unwrap_cfunction(callee));
-                retreg = janet_unwrap_cfunction(callee)(argc, fiber->data + fiber->frame);
-                janet_fiber_popframe(fiber);
+                retreg = vm_call_cfunction(fiber, janet_unwrap_cfunction(callee));
             } else {
                 retreg = call_nonfn(fiber, callee);
             }
@@ -1104,12 +1393,15 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
             janet_panicv(retreg);
         }
         fiber->child = child;
+        vm_commit();
         JanetSignal sig = janet_continue_no_check(child, stack[C], &retreg);
+        /* The child may have moved our code, see janet_def_unshare */
+        stack = fiber->data + fiber->frame;
+        pc = janet_stack_frame(stack)->pc;
         if (sig != JANET_SIGNAL_OK && !(child->flags & (1 << sig))) {
             vm_return(sig, retreg);
         }
         fiber->child = NULL;
-        stack = fiber->data + fiber->frame;
         stack[A] = retreg;
         vm_checkgc_pcnext();
     }
@@ -1144,12 +1436,15 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
             janet_panicv(retreg);
         }
         fiber->child = child;
+        vm_commit();
         JanetSignal sig = janet_continue_signal(child, stack[C], &retreg, JANET_SIGNAL_ERROR);
+        /* The child may have moved our code, see janet_def_unshare */
+        stack = fiber->data + fiber->frame;
+        pc = janet_stack_frame(stack)->pc;
         if (sig != JANET_SIGNAL_OK && !(child->flags & (1 << sig))) {
             vm_return(sig, retreg);
         }
         fiber->child = NULL;
-        stack = fiber->data + fiber->frame;
         stack[A] = retreg;
         vm_checkgc_pcnext();
     }
@@ -1168,14 +1463,42 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
     fiber->flags &= ~JANET_FIBER_RESUME_NO_USEVAL;
     vm_checkgc_pcnext();
 
-    VM_OP(JOP_IN)
-    vm_commit();
-    stack[A] = janet_in(stack[B], stack[C]);
+    VM_OP(JOP_IN) {
+        const Janet *data;
+        int32_t len;
+        if (vm_indexed_view(stack[B], &data, &len) && janet_checkint(stack[C])) {
+            int32_t i = janet_unwrap_integer(stack[C]);
+            if (i >= 0 && i < len) {
+                stack[A] = data[i];
+                vm_pcnext();
+            }
+        }
+    }
+    if (janet_checktype(stack[B], JANET_TABLE)) {
+        stack[A] = vm_table_get_cached(janet_unwrap_table(stack[B]), stack[C], pc);
+    } else {
+        vm_commit();
+        stack[A] = janet_in(stack[B], stack[C]);
+    }
     vm_pcnext();
 
-    VM_OP(JOP_GET)
-    vm_commit();
-    stack[A] = janet_get(stack[B], stack[C]);
+    VM_OP(JOP_GET) {
+        const Janet *data;
+        int32_t len;
+        if (vm_indexed_view(stack[B], &data, &len) && janet_checkint(stack[C])) {
+            int32_t i = janet_unwrap_integer(stack[C]);
+            if (i >= 0 && i < len) {
+                stack[A] = data[i];
+                vm_pcnext();
+            }
+        }
+    }
+    if (janet_checktype(stack[B], JANET_TABLE)) {
+        stack[A] = vm_table_get_cached(janet_unwrap_table(stack[B]), stack[C], pc);
+    } else {
+        vm_commit();
+        stack[A] = janet_get(stack[B], stack[C]);
+    }
     vm_pcnext();
 
     VM_OP(JOP_GET_INDEX)
@@ -1263,6 +1586,93 @@ static JanetSignal run_vm(JanetFiber *fiber, Janet in) {
         vm_checkgc_pcnext();
     }
 
+    /* Fused instructions. Each does the work of its first instruction with the
+     * operands of that instruction, then continues with the next instruction. */
+
+    VM_OP(JOP_LESS_THAN_JUMP_IF_NOT)
+    _vm_compop( <, vm_fused_next(JOP_JUMP_IF_NOT), vm_checkgc_fused_next(JOP_JUMP_IF_NOT));
+
+    VM_OP(JOP_LESS_THAN_IMMEDIATE_JUMP_IF_NOT)
+    _vm_compop_imm( <, vm_fused_next(JOP_JUMP_IF_NOT), vm_checkgc_fused_next(JOP_JUMP_IF_NOT));
+
+    VM_OP(JOP_LESS_THAN_EQUAL_JUMP_IF_NOT)
+    _vm_compop( <=, vm_fused_next(JOP_JUMP_IF_NOT), vm_checkgc_fused_next(JOP_JUMP_IF_NOT));
+
+    VM_OP(JOP_GREATER_THAN_JUMP_IF_NOT)
+    _vm_compop( >, vm_fused_next(JOP_JUMP_IF_NOT), vm_checkgc_fused_next(JOP_JUMP_IF_NOT));
+
+    VM_OP(JOP_GREATER_THAN_IMMEDIATE_JUMP_IF_NOT)
+    _vm_compop_imm( >, vm_fused_next(JOP_JUMP_IF_NOT), vm_checkgc_fused_next(JOP_JUMP_IF_NOT));
+
+    VM_OP(JOP_GREATER_THAN_EQUAL_JUMP_IF_NOT)
+    _vm_compop( >=, vm_fused_next(JOP_JUMP_IF_NOT), vm_checkgc_fused_next(JOP_JUMP_IF_NOT));
+
+    VM_OP(JOP_EQUALS_JUMP_IF_NOT)
+    stack[A] = janet_wrap_boolean(janet_equals(stack[B], stack[C]));
+    vm_fused_next(JOP_JUMP_IF_NOT);
+
+    VM_OP(JOP_EQUALS_IMMEDIATE_JUMP_IF_NOT)
+    stack[A] = janet_wrap_boolean(janet_unwrap_number(stack[B]) == (double) CS);
+    vm_fused_next(JOP_JUMP_IF_NOT);
+
+    VM_OP(JOP_NOT_EQUALS_JUMP_IF_NOT)
+    stack[A] = janet_wrap_boolean(!janet_equals(stack[B], stack[C]));
+    vm_fused_next(JOP_JUMP_IF_NOT);
+
+    VM_OP(JOP_NOT_EQUALS_IMMEDIATE_JUMP_IF_NOT)
+    stack[A] = janet_wrap_boolean(janet_unwrap_number(stack[B]) != (double) CS);
+    vm_fused_next(JOP_JUMP_IF_NOT);
+
+    VM_OP(JOP_ADD_IMMEDIATE_JUMP)
+    _vm_binop_immediate(+, JANET_INTOP_ADD, vm_fused_next(JOP_JUMP), vm_checkgc_fused_next(JOP_JUMP));
+
+    VM_OP(JOP_LOAD_CONSTANT_GET) {
+        int32_t cindex = (int32_t)E;
+        vm_assert(cindex < func->def->constants_length, "invalid constant");
+        stack[A] = func->def->constants[cindex];
+        vm_fused_next(JOP_GET);
+    }
+
+    VM_OP(JOP_LOAD_CONSTANT_CALL) {
+        int32_t cindex = (int32_t)E;
+        vm_assert(cindex < func->def->constants_length, "invalid constant");
+        stack[A] = func->def->constants[cindex];
+        vm_fused_next(JOP_CALL);
+    }
+
+    VM_OP(JOP_PUSH_CALL)
+    if (fiber->stacktop < fiber->capacity) {
+        fiber->data[fiber->stacktop++] = stack[D];
+    } else {
+        janet_fiber_push(fiber, stack[D]);
+        stack = fiber->data + fiber->frame;
+    }
+    vm_checkgc_fused_next(JOP_CALL);
+
+    VM_OP(JOP_ADD_NUMBER)
+    vm_numop(+);
+
+    VM_OP(JOP_SUBTRACT_NUMBER)
+    vm_numop(-);
+
+    VM_OP(JOP_MULTIPLY_NUMBER)
+    vm_numop(*);
+
+    VM_OP(JOP_DIVIDE_NUMBER)
+    vm_numop(/);
+
+    VM_OP(JOP_LESS_THAN_NUMBER)
+    vm_numcompop( <);
+
+    VM_OP(JOP_LESS_THAN_EQUAL_NUMBER)
+    vm_numcompop( <=);
+
+    VM_OP(JOP_GREATER_THAN_NUMBER)
+    vm_numcompop( >);
+
+    VM_OP(JOP_GREATER_THAN_EQUAL_NUMBER)
+    vm_numcompop( >=);
+
     VM_END()
 }
 
@@ -1283,6 +1693,12 @@ JanetSignal janet_step(JanetFiber *fiber, Janet in, Janet *out) {
     /* Get PC for setting breakpoints */
     uint32_t *pc = janet_stack_frame(fiber->data + fiber->frame)->pc;
 
+#ifdef JANET_JIT
+    /* Native code does not stop at breakpoints */
+    JanetFunction *func = janet_stack_frame(fiber->data + fiber->frame)->func;
+    if (NULL != func) janet_jit_disable(func->def);
+#endif
+
     /* Check current opcode (sans debug flag). This tells us where the next or next two candidate
      * instructions will be. Usually it's the next instruction in memory,
      * but for branching instructions it is also the target of the branch. */
@@ -1367,6 +1783,7 @@ Janet janet_call(JanetFunction *fun, int32_t argc, const Janet *argv) {
         janet_panicf("arity mismatch in %v, expected at most %d, got %d", funv, max, argc);
     }
     janet_fiber_frame(janet_vm.fiber)->flags |= JANET_STACKFRAME_ENTRANCE;
+    if (fun->gc.flags & JANET_FUNCFLAG_TRACE) vm_trace_frame(janet_vm.fiber);
 
     /* Set up */
     int32_t oldn = janet_vm.stackn++;
@@ -1431,6 +1848,9 @@ void janet_try_init(JanetTryState *state) {
     state->vm_fiber = janet_vm.fiber;
     state->vm_jmp_buf = janet_vm.signal_buf;
     state->vm_return_reg = janet_vm.return_reg;
+    if (state->stackn < JANET_RECURSION_GUARD) {
+        janet_vm.sarena_marks[state->stackn] = janet_sarena_mark();
+    }
     janet_vm.return_reg = &(state->payload);
     janet_vm.signal_buf = &(state->buf);
 }
@@ -1441,6 +1861,9 @@ void janet_restore(JanetTryState *state) {
     janet_vm.fiber = state->vm_fiber;
     janet_vm.signal_buf = state->vm_jmp_buf;
     janet_vm.return_reg = state->vm_return_reg;
+    if (state->stackn < JANET_RECURSION_GUARD) {
+        janet_sarena_reset(janet_vm.sarena_marks[state->stackn]);
+    }
 }
 
 static JanetSignal janet_continue_no_check(JanetFiber *fiber, Janet in, Janet *out) {
@@ -1567,6 +1990,122 @@ JanetSignal janet_pcall(
     return janet_continue(fiber, janet_wrap_nil(), out);
 }
 
+/* A call context keeps one rooted fiber that is reset for every call, and an
+ * array that holds the results of the last batch. */
+void janet_call_context_init(JanetCallContext *ctx) {
+    ctx->fiber = NULL;
+    ctx->results = janet_array(0);
+    janet_gcroot(janet_wrap_array(ctx->results));
+}
+
+void janet_call_context_deinit(JanetCallContext *ctx) {
+    if (NULL != ctx->fiber) {
+        janet_gcunroot(janet_wrap_fiber(ctx->fiber));
+        ctx->fiber = NULL;
+    }
+    if (NULL != ctx->results) {
+        janet_gcunroot(janet_wrap_array(ctx->results));
+        ctx->results = NULL;
+    }
+}
+
+/* Get the context fiber ready to call fun, or return NULL on arity mismatch */
+static JanetFiber *call_context_fiber(JanetCallContext *ctx, JanetFunction *fun,
+                                      int32_t argc, const Janet *argv) {
+    JanetFiber *fiber = ctx->fiber;
+    if (NULL == fiber) {
+        fiber = janet_fiber(fun, 64, argc, argv);
+        if (NULL != fiber) {
+            ctx->fiber = fiber;
+            janet_gcroot(janet_wrap_fiber(fiber));
+        }
+        return fiber;
+    }
+#ifdef JANET_EV
+    /* A call that suspended on the event loop is abandoned */
+    janet_fiber_did_resume(fiber);
+#endif
+    return janet_fiber_reset(fiber, fun, argc, argv);
+}
+
+/* Call fun once for each group of argc arguments in argv, entering the VM
+ * only once. Results go in out, which must be reachable by the garbage
+ * collector. Stops at the first call that does not return normally. */
+static JanetSignal call_context_run(JanetCallContext *ctx, JanetFunction *fun,
+                                    int32_t count, int32_t argc, const Janet *argv,
+                                    Janet *out, int32_t *done) {
+    volatile int32_t i = 0;
+    if (janet_vm.stackn >= JANET_RECURSION_GUARD) {
+        out[0] = janet_cstringv("C stack recursed too deeply");
+        *done = 0;
+        return JANET_SIGNAL_ERROR;
+    }
+    JanetTryState tstate;
+    JanetSignal sig = janet_try(&tstate);
+    if (!sig) {
+        for (; i < count; i++) {
+            JanetFiber *fiber = call_context_fiber(ctx, fun, argc, argv + (size_t) i * argc);
+            if (NULL == fiber) {
+                tstate.payload = janet_cstringv("arity mismatch");
+                sig = JANET_SIGNAL_ERROR;
+                break;
+            }
+            if (janet_vm.root_fiber == NULL) janet_vm.root_fiber = fiber;
+            janet_vm.fiber = fiber;
+            janet_fiber_set_status(fiber, JANET_STATUS_ALIVE);
+            sig = run_vm(fiber, janet_wrap_nil());
+            janet_fiber_set_status(fiber, sig);
+            fiber->last_value = tstate.payload;
+            out[i] = tstate.payload;
+            if (sig != JANET_SIGNAL_OK) break;
+        }
+    } else if (NULL != ctx->fiber) {
+        janet_fiber_set_status(ctx->fiber, sig);
+        ctx->fiber->last_value = tstate.payload;
+    }
+    if (NULL != ctx->fiber && janet_vm.root_fiber == ctx->fiber) janet_vm.root_fiber = NULL;
+    janet_restore(&tstate);
+    if (sig != JANET_SIGNAL_OK) out[i] = tstate.payload;
+    *done = i;
+    return sig;
+}
+
+/* Call fun once for each group of argc arguments in argv, in order. Results
+ * are put in ctx->results, which is valid until the next call on the context.
+ * Stops at the first call that does not return normally, and returns its
+ * signal with the signal value as the last result. If done is not NULL, it
+ * is set to the number of calls that returned normally. The values in argv
+ * are not rooted while the batch runs, so the caller must keep them reachable. */
+JanetSignal janet_call_context_batch(
+    JanetCallContext *ctx,
+    JanetFunction *fun,
+    int32_t count,
+    int32_t argc,
+    const Janet *argv,
+    int32_t *done) {
+    JanetArray *results = ctx->results;
+    int32_t n = count > 0 ? count : 1;
+    int32_t ran;
+    janet_array_ensure(results, n, 1);
+    for (int32_t i = 0; i < n; i++) results->data[i] = janet_wrap_nil();
+    results->count = n;
+    JanetSignal sig = call_context_run(ctx, fun, count, argc, argv, results->data, &ran);
+    results->count = sig == JANET_SIGNAL_OK ? ran : ran + 1;
+    if (done) *done = ran;
+    return sig;
+}
+
+/* Like janet_pcall, but reuse the fiber of the call context */
+JanetSignal janet_call_context_pcall(
+    JanetCallContext *ctx,
+    JanetFunction *fun,
+    int32_t argc,
+    const Janet *argv,
+    Janet *out) {
+    int32_t ran;
+    return call_context_run(ctx, fun, 1, argc, argv, out, &ran);
+}
+
 Janet janet_mcall(const char *name, int32_t argc, Janet *argv) {
     /* At least 1 argument */
     if (argc < 1) {
@@ -1589,6 +2128,16 @@ int janet_init(void) {
     janet_vm.next_collection = 0;
     janet_vm.gc_interval = 0x400000;
     janet_vm.block_count = 0;
+    janet_vm.sweep_blocks = NULL;
+    janet_vm.gc_sweep_step = 0;
+    janet_vm.heap_limit = 0;
+    janet_vm.gc_headroom = SIZE_MAX;
+    memset(&janet_vm.gc_stats, 0, sizeof(janet_vm.gc_stats));
+#ifdef JANET_GC_SLAB
+    for (int i = 0; i < JANET_SLAB_CLASSES; i++) {
+        janet_vm.slabs[i] = NULL;
+    }
+#endif
 
     janet_symcache_init();
 
@@ -1602,6 +2151,12 @@ int janet_init(void) {
     janet_vm.scratch_mem = NULL;
     janet_vm.scratch_len = 0;
     janet_vm.scratch_cap = 0;
+    janet_vm.sarena = NULL;
+    janet_vm.sarena_spare = NULL;
+    janet_vm.sarena_marks = janet_malloc(JANET_RECURSION_GUARD * sizeof(JanetSArenaMark));
+    if (NULL == janet_vm.sarena_marks) {
+        JANET_OUT_OF_MEMORY;
+    }
 
     /* Sandbox flags */
     janet_vm.sandbox_flags = 0;
@@ -1611,6 +2166,7 @@ int janet_init(void) {
     janet_vm.registry_cap = 0;
     janet_vm.registry_count = 0;
     janet_vm.registry_dirty = 0;
+    janet_vm.registry_shared = 0;
 
     /* Intialize abstract registry */
     janet_vm.abstract_registry = janet_table(0);
@@ -1621,12 +2177,32 @@ int janet_init(void) {
     janet_vm.traversal_base = NULL;
     janet_vm.traversal_top = NULL;
 
+    /* Inline caches */
+    janet_vm.table_version = 0;
+    janet_vm.proto_epoch = 0;
+    janet_vm.inline_cache = janet_calloc(JANET_INLINE_CACHE_SIZE + JANET_DYN_CACHE_SIZE,
+                                         sizeof(JanetInlineCache));
+    if (NULL == janet_vm.inline_cache) {
+        JANET_OUT_OF_MEMORY;
+    }
+    janet_vm.dyn_cache = janet_vm.inline_cache + JANET_INLINE_CACHE_SIZE;
+
     /* Core env */
     janet_vm.core_env = NULL;
 
     /* Auto suspension */
     janet_vm.auto_suspend = 0;
 
+    /* Profiler */
+    janet_vm.profile_sample = 0;
+    janet_vm.profile_samples = NULL;
+    janet_vm.profiler = NULL;
+
+    /* Tracing */
+    janet_vm.trace_hook = NULL;
+    janet_vm.trace_data = NULL;
+    janet_vm.trace_ring = NULL;
+
     /* Dynamic bindings */
     janet_vm.top_dyns = NULL;
 
@@ -1637,6 +2213,9 @@ int janet_init(void) {
     janet_vm.fiber = NULL;
     janet_vm.root_fiber = NULL;
     janet_vm.stackn = 0;
+    janet_vm.fiber_pool_count = 0;
+    janet_vm.fiber_count = 0;
+    janet_vm.fiber_stack_bytes = 0;
 
 #ifdef JANET_EV
     janet_ev_init();
@@ -1661,6 +2240,8 @@ void janet_sandbox_assert(uint32_t forbidden_flags) {
 
 /* Clear all memory associated with the VM */
 void janet_deinit(void) {
+    janet_profile_deinit();
+    janet_trace_deinit();
     janet_clear_memory();
     janet_symcache_deinit();
     janet_free(janet_vm.roots);
@@ -1672,9 +2253,12 @@ void janet_deinit(void) {
     janet_vm.top_dyns = NULL;
     janet_vm.user = NULL;
     janet_free(janet_vm.traversal_base);
+    janet_free(janet_vm.inline_cache);
+    janet_vm.inline_cache = NULL;
+    janet_vm.dyn_cache = NULL;
     janet_vm.fiber = NULL;
     janet_vm.root_fiber = NULL;
-    janet_free(janet_vm.registry);
+    if (!janet_vm.registry_shared) janet_free(janet_vm.registry);
     janet_vm.registry = NULL;
 #ifdef JANET_EV
     janet_ev_deinit();
@@ -204,6 +204,11 @@ extern "C" {
 #define JANET_PEG
 #endif
 
+/* Enable or disable typed arrays */
+#ifndef JANET_NO_TYPED_ARRAY
+#define JANET_TYPED_ARRAY
+#endif
+
 /* Enable or disable event loop */
 #if !defined(JANET_NO_EV) && !defined(__EMSCRIPTEN__)
 #define JANET_EV
@@ -224,6 +229,11 @@ extern "C" {
 #define JANET_EV_EPOLL
 #endif
 
+/* io_uring is opt-in, and needs epoll as a fallback */
+#if defined(JANET_EV_URING) && !defined(JANET_EV_EPOLL)
+#undef JANET_EV_URING
+#endif
+
 /* Enable or disable kqueue on BSD */
 #if defined(JANET_BSD) && !defined(JANET_EV_NO_KQUEUE)
 #define JANET_EV_KQUEUE
@@ -607,6 +617,9 @@ struct JanetStream {
      * this constraint may be lifted later but allowing such would require more internal book keeping
      * for some implementations. You can read and write at the same time on the same stream, though. */
     int _mask;
+#ifdef JANET_EV_URING
+    int32_t _slot; /* internal - io_uring poll slot, or -1 */
+#endif
 };
 
 /* Interface for state machine based event loop */
@@ -915,6 +928,7 @@ struct JanetFiber {
     JanetListenerState *waiting;
     uint32_t sched_id; /* Increment everytime fiber is scheduled by event loop */
     void *supervisor_channel; /* Channel to push self to when complete */
+    double time_slice; /* Seconds the fiber may run before it is preempted, 0 for the ev/preempt default */
 #endif
 };
 
@@ -924,6 +938,9 @@ struct JanetFiber {
 /* Mark if a stack frame is an entrance frame */
 #define JANET_STACKFRAME_ENTRANCE 2
 
+/* Mark if returning from a stack frame should be reported to the trace hook */
+#define JANET_STACKFRAME_TRACE 4
+
 /* A stack frame on the fiber. Is stored along with the stack values. */
 struct JanetStackFrame {
     JanetFunction *func;
@@ -1016,6 +1033,7 @@ struct JanetAbstractHead {
 #define JANET_FUNCDEF_FLAG_HASSOURCEMAP 0x800000
 #define JANET_FUNCDEF_FLAG_STRUCTARG 0x1000000
 #define JANET_FUNCDEF_FLAG_HASCLOBITSET 0x2000000
+#define JANET_FUNCDEF_FLAG_NOESCAPE 0x4000000
 #define JANET_FUNCDEF_FLAG_TAG 0xFFFF
 
 /* Source mapping structure for a bytecode instruction */
@@ -1057,6 +1075,10 @@ struct JanetFuncDef {
     int32_t environments_length;
     int32_t defs_length;
     int32_t symbolmap_length;
+#ifdef JANET_JIT
+    int32_t jit_count; /* Calls and loop iterations so far, or -1 to never compile */
+    void *jit; /* Native code, or NULL */
+#endif
 };
 
 /* A function environment */
@@ -1107,6 +1129,7 @@ struct JanetParser {
     size_t pending;
     int lookback;
     int flag;
+    size_t argstart; /* Values before argstart in args have already been produced */
 };
 
 /* A context for marshaling and unmarshaling abstract types */
@@ -1206,6 +1229,12 @@ struct JanetFile {
     int32_t flags;
 };
 
+/* Position in the scratch arena, for janet_sarena_mark and janet_sarena_reset */
+typedef struct {
+    void *chunk;
+    size_t used;
+} JanetSArenaMark;
+
 /* For janet_try and janet_restore */
 typedef struct {
     /* old state */
@@ -1219,6 +1248,47 @@ typedef struct {
     Janet payload;
 } JanetTryState;
 
+/* For calling Janet functions from C many times without making a new fiber
+ * for each call. See janet_call_context_init. */
+typedef struct {
+    JanetFiber *fiber;
+    JanetArray *results;
+} JanetCallContext;
+
+/* Events reported to a trace hook. See janet_trace_sethook. */
+typedef enum {
+    JANET_TRACE_CALL,
+    JANET_TRACE_RETURN,
+    JANET_TRACE_FIBER_SPAWN,
+    JANET_TRACE_FIBER_RESUME,
+    JANET_TRACE_FIBER_YIELD,
+    JANET_TRACE_GC_BEGIN,
+    JANET_TRACE_GC_END,
+    JANET_TRACE_LISTEN,
+    JANET_TRACE_UNLISTEN
+} JanetTraceEventType;
+
+typedef struct {
+    JanetTraceEventType type;
+    int64_t value; /* Argument count, signal, live heap bytes, or listener mask */
+    uint64_t time; /* Monotonic clock in nanoseconds */
+    const void *fiber; /* Fiber running when the event happened, if any */
+    const void *subject; /* Function, fiber, or stream the event is about */
+    const char *name; /* Function name or NULL, only valid during the hook */
+} JanetTraceEvent;
+
+typedef void (*JanetTraceHook)(const JanetTraceEvent *event, void *data);
+
+/* A trace event copied out of a JanetTraceRing. The name of the event
+ * points into the record, and may be truncated. */
+#define JANET_TRACE_NAME_SIZE 48
+typedef struct {
+    JanetTraceEvent event;
+    char name[JANET_TRACE_NAME_SIZE];
+} JanetTraceRecord;
+
+typedef struct JanetTraceRing JanetTraceRing;
+
 /***** END SECTION TYPES *****/
 
 /***** START SECTION OPCODES *****/
@@ -1332,6 +1402,28 @@ enum JanetOpCode {
     JOP_NOT_EQUALS,
     JOP_NOT_EQUALS_IMMEDIATE,
     JOP_CANCEL,
+    JOP_LESS_THAN_JUMP_IF_NOT,
+    JOP_LESS_THAN_IMMEDIATE_JUMP_IF_NOT,
+    JOP_LESS_THAN_EQUAL_JUMP_IF_NOT,
+    JOP_GREATER_THAN_JUMP_IF_NOT,
+    JOP_GREATER_THAN_IMMEDIATE_JUMP_IF_NOT,
+    JOP_GREATER_THAN_EQUAL_JUMP_IF_NOT,
+    JOP_EQUALS_JUMP_IF_NOT,
+    JOP_EQUALS_IMMEDIATE_JUMP_IF_NOT,
+    JOP_NOT_EQUALS_JUMP_IF_NOT,
+    JOP_NOT_EQUALS_IMMEDIATE_JUMP_IF_NOT,
+    JOP_ADD_IMMEDIATE_JUMP,
+    JOP_LOAD_CONSTANT_GET,
+    JOP_LOAD_CONSTANT_CALL,
+    JOP_PUSH_CALL,
+    JOP_ADD_NUMBER,
+    JOP_SUBTRACT_NUMBER,
+    JOP_MULTIPLY_NUMBER,
+    JOP_DIVIDE_NUMBER,
+    JOP_LESS_THAN_NUMBER,
+    JOP_LESS_THAN_EQUAL_NUMBER,
+    JOP_GREATER_THAN_NUMBER,
+    JOP_GREATER_THAN_EQUAL_NUMBER,
     JOP_INSTRUCTION_COUNT
 };
 
@@ -1484,18 +1576,24 @@ JANET_API void janet_ev_readchunk(JanetStream *stream, JanetBuffer *buf, int32_t
 JANET_API void janet_ev_recv(JanetStream *stream, JanetBuffer *buf, int32_t nbytes, int flags);
 JANET_API void janet_ev_recvchunk(JanetStream *stream, JanetBuffer *buf, int32_t nbytes, int flags);
 JANET_API void janet_ev_recvfrom(JanetStream *stream, JanetBuffer *buf, int32_t nbytes, int flags);
+JANET_API void janet_ev_recvmany(JanetStream *stream, JanetArray *buffers, JanetArray *addresses, int32_t nbytes, int flags);
 JANET_API void janet_ev_connect(JanetStream *stream, int flags);
 #endif
 
 /* Write async to a stream */
 JANET_API void janet_ev_write_buffer(JanetStream *stream, JanetBuffer *buf);
 JANET_API void janet_ev_write_string(JanetStream *stream, JanetString str);
+JANET_API void janet_ev_write_vector(JanetStream *stream, JanetTuple items);
 #ifdef JANET_NET
 JANET_API void janet_ev_send_buffer(JanetStream *stream, JanetBuffer *buf, int flags);
 JANET_API void janet_ev_send_string(JanetStream *stream, JanetString str, int flags);
+JANET_API void janet_ev_send_vector(JanetStream *stream, JanetTuple items, int flags);
 JANET_API void janet_ev_sendto_buffer(JanetStream *stream, JanetBuffer *buf, void *dest, int flags);
 JANET_API void janet_ev_sendto_string(JanetStream *stream, JanetString str, void *dest, int flags);
+JANET_API void janet_ev_sendmany(JanetStream *stream, JanetTuple packets, JanetTuple dests, int flags);
+JANET_API void janet_ev_sendfile(JanetStream *stream, Janet file, int64_t offset, int64_t length);
 #endif
+JANET_API void janet_ev_splice(JanetStream *dest, JanetStream *src, int64_t length);
 
 #endif
 
@@ -1504,6 +1602,7 @@ extern JANET_API const JanetAbstractType janet_parser_type;
 JANET_API void janet_parser_init(JanetParser *parser);
 JANET_API void janet_parser_deinit(JanetParser *parser);
 JANET_API void janet_parser_consume(JanetParser *parser, uint8_t c);
+JANET_API size_t janet_parser_consume_bytes(JanetParser *parser, const uint8_t *bytes, size_t len);
 JANET_API enum JanetParserStatus janet_parser_status(JanetParser *parser);
 JANET_API Janet janet_parser_produce(JanetParser *parser);
 JANET_API Janet janet_parser_produce_wrapped(JanetParser *parser);
@@ -1674,6 +1773,9 @@ JANET_API const JanetKV *janet_struct_find(JanetStruct st, Janet key);
 
 /* Table functions */
 JANET_API JanetTable *janet_table(int32_t capacity);
+JANET_API JanetTable *janet_table_weakk(int32_t capacity);
+JANET_API JanetTable *janet_table_weakv(int32_t capacity);
+JANET_API JanetTable *janet_table_weakkv(int32_t capacity);
 JANET_API JanetTable *janet_table_init(JanetTable *table, int32_t capacity);
 JANET_API JanetTable *janet_table_init_raw(JanetTable *table, int32_t capacity);
 JANET_API void janet_table_deinit(JanetTable *table);
@@ -1733,6 +1835,26 @@ JANET_API Janet janet_unmarshal(
     int flags,
     JanetTable *reg,
     const uint8_t **next);
+
+/* Streamed marshaling. A writer is handed the output in chunks as it is
+ * produced. A reader fills up to max bytes at dest and returns how many it
+ * wrote, or 0 at the end of input; it should panic on errors. The reader may
+ * be asked for more than the value needs, and the number of bytes read past
+ * the end of the value is reported in unread. */
+typedef void (*JanetMarshalWriter)(void *userdata, const uint8_t *bytes, size_t len);
+typedef size_t (*JanetUnmarshalReader)(void *userdata, uint8_t *dest, size_t max);
+JANET_API void janet_marshal_to(
+    JanetMarshalWriter writer,
+    void *userdata,
+    Janet x,
+    JanetTable *rreg,
+    int flags);
+JANET_API Janet janet_unmarshal_from(
+    JanetUnmarshalReader reader,
+    void *userdata,
+    int flags,
+    JanetTable *reg,
+    size_t *unread);
 JANET_API JanetTable *janet_env_lookup(JanetTable *env);
 JANET_API void janet_env_lookup_into(JanetTable *renv, JanetTable *env, const char *prefix, int recurse);
 
@@ -1747,6 +1869,28 @@ JANET_API int janet_gcunrootall(Janet root);
 JANET_API int janet_gclock(void);
 JANET_API void janet_gcunlock(int handle);
 JANET_API void janet_gcpressure(size_t s);
+JANET_API void janet_gcsetlimit(size_t limit);
+
+/* GC statistics. Live object counts are indexed by memory type, in the order
+ * none, string, symbol, array, tuple, table, struct, fiber, buffer, function,
+ * abstract, funcenv, funcdef, threaded abstract, threaded string. Bucket i of
+ * a pause histogram counts pauses shorter than 2^i microseconds, and the last
+ * bucket counts all longer pauses. */
+#define JANET_GC_MEMORY_TYPES 15
+#define JANET_GC_HISTOGRAM_BUCKETS 24
+typedef struct {
+    size_t live_count[JANET_GC_MEMORY_TYPES]; /* Objects reached by the last mark phase */
+    size_t live_bytes[JANET_GC_MEMORY_TYPES]; /* Bytes used by those objects, including owned buffers */
+    size_t total_allocated; /* Bytes allocated over the life of the VM */
+    uint64_t collections;
+    uint64_t mark_ns; /* Total time spent marking */
+    uint64_t sweep_ns; /* Total time spent sweeping */
+    uint64_t mark_histogram[JANET_GC_HISTOGRAM_BUCKETS];
+    uint64_t sweep_histogram[JANET_GC_HISTOGRAM_BUCKETS];
+    size_t heap_live; /* Sum of live_bytes */
+    uint64_t limit_errors; /* Errors raised for going over the heap limit */
+} JanetGCStats;
+JANET_API const JanetGCStats *janet_gcstats(void);
 
 /* Functions */
 JANET_API JanetFuncDef *janet_funcdef_alloc(void);
@@ -1758,12 +1902,12 @@ JANET_API int janet_verify(JanetFuncDef *def);
 #define JANET_PRETTY_ONELINE 2
 #define JANET_PRETTY_NOTRUNC 4
 JANET_API JanetBuffer *janet_pretty(JanetBuffer *buffer, int depth, int flags, Janet x);
+typedef void (*JanetFormatWriter)(void *data, const uint8_t *bytes, int32_t len);
+JANET_API void janet_pretty_to(JanetFormatWriter write, void *data, int depth, int flags, int32_t limit, Janet x);
 
 /* Misc */
-#ifdef JANET_PRF
 #define JANET_HASH_KEY_SIZE 16
 JANET_API void janet_init_hash_key(uint8_t key[JANET_HASH_KEY_SIZE]);
-#endif
 JANET_API void janet_try_init(JanetTryState *state);
 #if defined(JANET_BSD) || defined(JANET_APPLE)
 #define janet_try(state) (janet_try_init(state), (JanetSignal) _setjmp((state)->buf))
@@ -1799,9 +1943,20 @@ JANET_API void janet_vm_free(JanetVM *vm);
 JANET_API void janet_vm_save(JanetVM *into);
 JANET_API void janet_vm_load(JanetVM *from);
 JANET_API void janet_interpreter_interrupt(JanetVM *vm);
+JANET_API void janet_interpreter_sample(JanetVM *vm);
+JANET_API void janet_trace_sethook(JanetTraceHook hook, void *data);
+JANET_API JanetTraceRing *janet_trace_ring_new(int32_t capacity);
+JANET_API void janet_trace_ring_free(JanetTraceRing *ring);
+JANET_API void janet_trace_ring_hook(const JanetTraceEvent *event, void *ring);
+JANET_API int janet_trace_ring_pop(JanetTraceRing *ring, JanetTraceRecord *record);
+JANET_API uint32_t janet_trace_ring_dropped(JanetTraceRing *ring);
 JANET_API JanetSignal janet_continue(JanetFiber *fiber, Janet in, Janet *out);
 JANET_API JanetSignal janet_continue_signal(JanetFiber *fiber, Janet in, Janet *out, JanetSignal sig);
 JANET_API JanetSignal janet_pcall(JanetFunction *fun, int32_t argn, const Janet *argv, Janet *out, JanetFiber **f);
+JANET_API void janet_call_context_init(JanetCallContext *ctx);
+JANET_API void janet_call_context_deinit(JanetCallContext *ctx);
+JANET_API JanetSignal janet_call_context_pcall(JanetCallContext *ctx, JanetFunction *fun, int32_t argc, const Janet *argv, Janet *out);
+JANET_API JanetSignal janet_call_context_batch(JanetCallContext *ctx, JanetFunction *fun, int32_t count, int32_t argc, const Janet *argv, int32_t *done);
 JANET_API JanetSignal janet_step(JanetFiber *fiber, Janet in, Janet *out);
 JANET_API Janet janet_call(JanetFunction *fun, int32_t argc, const Janet *argv);
 JANET_API Janet janet_mcall(const char *name, int32_t argc, Janet *argv);
@@ -1838,6 +1993,12 @@ JANET_API void *janet_scalloc(size_t nmemb, size_t size);
 JANET_API void janet_sfinalizer(void *mem, JanetScratchFinalizer finalizer);
 JANET_API void janet_sfree(void *mem);
 
+/* Scratch arena API. Memory from janet_sarena_alloc is released all at once by
+ * janet_sarena_reset, or when the enclosing janet_try returns or is unwound by a panic. */
+JANET_API JanetSArenaMark janet_sarena_mark(void);
+JANET_API void janet_sarena_reset(JanetSArenaMark mark);
+JANET_API void *janet_sarena_alloc(size_t size);
+
 /* C Library helpers */
 typedef enum {
     JANET_BINDING_NONE,
@@ -1123,21 +1123,31 @@ int main(int argc, char **argv) {
     atexit(clear_at_exit);
 #endif
 
-#if defined(JANET_PRF)
-    uint8_t hash_key[JANET_HASH_KEY_SIZE + 1];
+    /* Hashes use a fixed seed unless JANET_HASHSEED asks for another one, so
+     * that table order and marshalled tables are the same on every run. A
+     * random seed (JANET_HASHSEED=random, or the default with JANET_PRF) stops
+     * table keys from untrusted input being chosen to collide. */
+    uint8_t hash_key[JANET_HASH_KEY_SIZE + 1] = {0};
 #ifdef JANET_REDUCED_OS
     char *envvar = NULL;
 #else
     char *envvar = getenv("JANET_HASHSEED");
 #endif
-    if (NULL != envvar) {
+#ifdef JANET_PRF
+    int random_seed = NULL == envvar || !strcmp(envvar, "random");
+#else
+    int random_seed = NULL != envvar && !strcmp(envvar, "random");
+#endif
+    if (random_seed) {
+        if (janet_cryptorand(hash_key, JANET_HASH_KEY_SIZE) != 0) {
+            fputs("unable to initialize janet hash function.\n", stderr);
+            return 1;
+        }
+        janet_init_hash_key(hash_key);
+    } else if (NULL != envvar) {
         strncpy((char *) hash_key, envvar, sizeof(hash_key) - 1);
-    } else if (janet_cryptorand(hash_key, JANET_HASH_KEY_SIZE) != 0) {
-        fputs("unable to initialize janet PRF hash function.\n", stderr);
-        return 1;
+        janet_init_hash_key(hash_key);
     }
-    janet_init_hash_key(hash_key);
-#endif
 
     /* Set up VM */
     janet_init();